@@ -0,0 +1,470 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+/*
+ * Packet rate benchmark between two libmemif endpoints.
+ *
+ * A slave interface generates packets on one thread and a master interface
+ * on the same socket receives and drops them on another, while the main
+ * thread handles the control channel. The slave either copies every packet
+ * into a memif buffer (memif_buffer_alloc + memif_tx_burst) or, with -z,
+ * lends buffers from its own region (memif_lend_tx_buffers) and takes them
+ * back once the master has received them.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <getopt.h>
+
+#include <libmemif.h>
+
+#define APP_NAME "memif_bench"
+#define IF_NAME  "memif_bench"
+
+#define INFO(...) do {                                              \
+                    printf ("INFO: "__VA_ARGS__);                   \
+                    printf ("\n");                                  \
+                } while (0)
+
+#define BENCH_DEFAULT_SOCKET    "/tmp/memif-bench.sock"
+#define BENCH_BUFFER_SIZE       2048
+#define BENCH_MAX_BURST         256
+
+typedef struct
+{
+  memif_conn_handle_t conn;
+  volatile uint8_t connected;
+  pthread_t thread;
+
+  /* updated by the data thread only */
+  volatile uint64_t packets;
+  volatile uint64_t bytes;
+  int err;
+} bench_endpoint_t;
+
+typedef struct
+{
+  /* arguments */
+  char *socket;
+  int seconds;
+  uint16_t packet_size;
+  uint16_t burst;
+  uint8_t log2_ring_size;
+  memif_rx_mode_t rx_mode;
+  uint8_t zero_copy;
+
+  /* slave tx buffers in zero-copy mode */
+  void *region;
+  void **free_bufs;
+  uint32_t n_free_bufs;
+
+  /* packet written by the copying generator */
+  uint8_t template[BENCH_BUFFER_SIZE];
+
+  bench_endpoint_t tx;		/* slave */
+  bench_endpoint_t rx;		/* master */
+  volatile uint8_t stop;
+} bench_main_t;
+
+bench_main_t bench_main;
+
+static double
+bench_time_now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+bench_signal_handler (int sig)
+{
+  bench_main.stop = 1;
+}
+
+static int
+on_connect (memif_conn_handle_t conn, void *private_ctx)
+{
+  bench_endpoint_t *ep = private_ctx;
+  INFO ("%s connected", (ep == &bench_main.tx) ? "slave" : "master");
+  ep->connected = 1;
+  return 0;
+}
+
+static int
+on_disconnect (memif_conn_handle_t conn, void *private_ctx)
+{
+  bench_endpoint_t *ep = private_ctx;
+  INFO ("%s disconnected", (ep == &bench_main.tx) ? "slave" : "master");
+  ep->connected = 0;
+  return 0;
+}
+
+static void *
+bench_rx_thread (void *arg)
+{
+  bench_main_t *bm = &bench_main;
+  bench_endpoint_t *ep = arg;
+  memif_buffer_t bufs[BENCH_MAX_BURST];
+  uint16_t rx, i;
+  uint64_t bytes;
+  int err;
+
+  if ((err = memif_set_rx_mode (ep->conn, bm->rx_mode, 0)))
+    goto done;
+
+  while (!bm->stop && ep->connected)
+    {
+      if (bm->rx_mode != MEMIF_RX_MODE_POLLING)
+	{
+	  /* no-op while the queue polls, control fds are served by main */
+	  if ((err = memif_rx_wait (ep->conn, 0, 100)))
+	    goto done;
+	}
+
+      err = memif_rx_burst (ep->conn, 0, bufs, bm->burst, &rx);
+      if (err != MEMIF_ERR_SUCCESS && err != MEMIF_ERR_NOBUF)
+	goto done;
+      if (rx == 0)
+	continue;
+
+      bytes = 0;
+      for (i = 0; i < rx; i++)
+	bytes += bufs[i].len;
+
+      /* master hands the buffers back by moving the tail */
+      if ((err = memif_refill_queue (ep->conn, 0, rx, 0)))
+	goto done;
+
+      ep->packets += rx;
+      ep->bytes += bytes;
+    }
+  err = MEMIF_ERR_SUCCESS;
+
+done:
+  ep->err = err;
+  return NULL;
+}
+
+static void *
+bench_tx_thread (void *arg)
+{
+  bench_main_t *bm = &bench_main;
+  bench_endpoint_t *ep = arg;
+  memif_buffer_t bufs[BENCH_MAX_BURST];
+  uint16_t n, tx, i;
+  int err;
+
+  while (!bm->stop && ep->connected)
+    {
+      err = memif_buffer_alloc (ep->conn, 0, bufs, bm->burst, &n,
+				bm->packet_size);
+      if (err != MEMIF_ERR_SUCCESS && err != MEMIF_ERR_NOBUF_RING)
+	goto done;
+
+      for (i = 0; i < n; i++)
+	{
+	  memcpy (bufs[i].data, bm->template, bm->packet_size);
+	  bufs[i].len = bm->packet_size;
+	}
+
+      if ((err = memif_tx_burst (ep->conn, 0, bufs, n, &tx)))
+	goto done;
+
+      ep->packets += tx;
+      ep->bytes += (uint64_t) tx *bm->packet_size;
+    }
+  err = MEMIF_ERR_SUCCESS;
+
+done:
+  ep->err = err;
+  return NULL;
+}
+
+static void *
+bench_tx_zero_copy_thread (void *arg)
+{
+  bench_main_t *bm = &bench_main;
+  bench_endpoint_t *ep = arg;
+  memif_buffer_t bufs[BENCH_MAX_BURST];
+  uint16_t n, tx, i;
+  int err;
+
+  while (!bm->stop && ep->connected)
+    {
+      /* buffers the master is done with */
+      if ((err = memif_reclaim_tx_buffers (ep->conn, 0, bufs, bm->burst,
+					   &n)))
+	goto done;
+      for (i = 0; i < n; i++)
+	bm->free_bufs[bm->n_free_bufs++] = bufs[i].data;
+
+      n = (bm->n_free_bufs < bm->burst) ? bm->n_free_bufs : bm->burst;
+      for (i = 0; i < n; i++)
+	{
+	  bufs[i].data = bm->free_bufs[--bm->n_free_bufs];
+	  bufs[i].len = bm->packet_size;
+	  bufs[i].flags = 0;
+	}
+
+      err = memif_lend_tx_buffers (ep->conn, 0, bufs, n, &tx);
+      if (err != MEMIF_ERR_SUCCESS && err != MEMIF_ERR_NOBUF_RING)
+	goto done;
+
+      /* put back what did not fit on the ring */
+      for (i = tx; i < n; i++)
+	bm->free_bufs[bm->n_free_bufs++] = bufs[i].data;
+
+      ep->packets += tx;
+      ep->bytes += (uint64_t) tx *bm->packet_size;
+    }
+  err = MEMIF_ERR_SUCCESS;
+
+done:
+  ep->err = err;
+  return NULL;
+}
+
+static int
+bench_create (bench_main_t * bm)
+{
+  memif_conn_args_t args;
+  uint32_t n_bufs, i;
+  int err;
+
+  memset (&args, 0, sizeof (args));
+  args.socket_filename = (uint8_t *) bm->socket;
+  args.buffer_size = BENCH_BUFFER_SIZE;
+  args.log2_ring_size = bm->log2_ring_size;
+  args.interface_id = 0;
+  strncpy ((char *) args.interface_name, IF_NAME, strlen (IF_NAME));
+
+  args.is_master = 1;
+  if ((err = memif_create (&bm->rx.conn, &args, on_connect, on_disconnect,
+			   NULL, &bm->rx)))
+    return err;
+
+  args.is_master = 0;
+  if ((err = memif_create (&bm->tx.conn, &args, on_connect, on_disconnect,
+			   NULL, &bm->tx)))
+    return err;
+
+  if (!bm->zero_copy)
+    return MEMIF_ERR_SUCCESS;
+
+  /* enough buffers to fill the ring with a burst in hand */
+  n_bufs = (1 << bm->log2_ring_size) + bm->burst;
+  if ((err = memif_add_buffer_region (bm->tx.conn,
+				      n_bufs * BENCH_BUFFER_SIZE, -1,
+				      &bm->region)))
+    return err;
+
+  bm->free_bufs = malloc (n_bufs * sizeof (void *));
+  if (bm->free_bufs == NULL)
+    return MEMIF_ERR_NOMEM;
+  for (i = 0; i < n_bufs; i++)
+    {
+      void *b = bm->region + i * BENCH_BUFFER_SIZE;
+      /* written once, the buffers go out as they are */
+      memcpy (b, bm->template, bm->packet_size);
+      bm->free_bufs[bm->n_free_bufs++] = b;
+    }
+
+  return MEMIF_ERR_SUCCESS;
+}
+
+static void
+bench_print (char *what, uint64_t packets, uint64_t bytes, double dt)
+{
+  printf ("%-8s %10.3f Mpps %8.3f Gbps %14" PRIu64 " packets\n", what,
+	  packets / dt * 1e-6, bytes * 8 / dt * 1e-9, packets);
+}
+
+static void
+print_help ()
+{
+  printf ("Usage: memif-bench [options]\n");
+  printf ("  -s <socket>     socket filename (default %s)\n",
+	  BENCH_DEFAULT_SOCKET);
+  printf ("  -t <seconds>    test duration (default 10)\n");
+  printf ("  -l <bytes>      packet size (default 64)\n");
+  printf ("  -b <packets>    burst size (default 64, max %u)\n",
+	  BENCH_MAX_BURST);
+  printf ("  -r <log2>       log2 ring size (default 10)\n");
+  printf ("  -m <mode>       master rx mode: interrupt, polling or adaptive "
+	  "(default polling)\n");
+  printf ("  -z              zero-copy slave, transmit lent buffers\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+  bench_main_t *bm = &bench_main;
+  uint64_t last_rx = 0, last_tx = 0;
+  double start, last, now;
+  void *(*tx_fn) (void *);
+  int opt, err;
+
+  memset (bm, 0, sizeof (*bm));
+  bm->socket = BENCH_DEFAULT_SOCKET;
+  bm->seconds = 10;
+  bm->packet_size = 64;
+  bm->burst = 64;
+  bm->log2_ring_size = 10;
+  bm->rx_mode = MEMIF_RX_MODE_POLLING;
+
+  while ((opt = getopt (argc, argv, "s:t:l:b:r:m:zh")) != -1)
+    {
+      switch (opt)
+	{
+	case 's':
+	  bm->socket = optarg;
+	  break;
+	case 't':
+	  bm->seconds = atoi (optarg);
+	  break;
+	case 'l':
+	  bm->packet_size = atoi (optarg);
+	  break;
+	case 'b':
+	  bm->burst = atoi (optarg);
+	  break;
+	case 'r':
+	  bm->log2_ring_size = atoi (optarg);
+	  break;
+	case 'm':
+	  if (strcmp (optarg, "interrupt") == 0)
+	    bm->rx_mode = MEMIF_RX_MODE_INTERRUPT;
+	  else if (strcmp (optarg, "polling") == 0)
+	    bm->rx_mode = MEMIF_RX_MODE_POLLING;
+	  else if (strcmp (optarg, "adaptive") == 0)
+	    bm->rx_mode = MEMIF_RX_MODE_ADAPTIVE;
+	  else
+	    {
+	      print_help ();
+	      return -1;
+	    }
+	  break;
+	case 'z':
+	  bm->zero_copy = 1;
+	  break;
+	default:
+	  print_help ();
+	  return (opt == 'h') ? 0 : -1;
+	}
+    }
+
+  if (bm->packet_size < 60 || bm->packet_size > BENCH_BUFFER_SIZE ||
+      bm->burst == 0 || bm->burst > BENCH_MAX_BURST)
+    {
+      print_help ();
+      return -1;
+    }
+
+  /* broadcast ethernet frame, the payload is never looked at */
+  memset (bm->template, 0xff, 12);
+  bm->template[12] = 0x08;
+  bm->template[13] = 0x00;
+
+  signal (SIGINT, bench_signal_handler);
+
+  /* libmemif handles the control fds, memif_poll_event below */
+  if ((err = memif_init (NULL, APP_NAME, NULL, NULL)))
+    {
+      INFO ("memif_init: %s", memif_strerror (err));
+      return -1;
+    }
+
+  if ((err = bench_create (bm)))
+    {
+      INFO ("create: %s", memif_strerror (err));
+      goto done;
+    }
+
+  INFO ("%s slave, %s master rx, %u byte packets, burst %u, ring %u",
+	bm->zero_copy ? "zero-copy" : "copying",
+	(bm->rx_mode == MEMIF_RX_MODE_INTERRUPT) ? "interrupt" :
+	(bm->rx_mode == MEMIF_RX_MODE_POLLING) ? "polling" : "adaptive",
+	bm->packet_size, bm->burst, 1 << bm->log2_ring_size);
+
+  /* the slave connects on its next timer tick */
+  while (!bm->stop && !(bm->rx.connected && bm->tx.connected))
+    if ((err = memif_poll_event (100)))
+      {
+	INFO ("memif_poll_event: %s", memif_strerror (err));
+	goto done;
+      }
+  if (bm->stop)
+    goto done;
+
+  tx_fn = bm->zero_copy ? bench_tx_zero_copy_thread : bench_tx_thread;
+  pthread_create (&bm->rx.thread, NULL, bench_rx_thread, &bm->rx);
+  pthread_create (&bm->tx.thread, NULL, tx_fn, &bm->tx);
+
+  start = last = bench_time_now ();
+  while (!bm->stop && bm->rx.connected && bm->tx.connected)
+    {
+      if ((err = memif_poll_event (100)))
+	{
+	  INFO ("memif_poll_event: %s", memif_strerror (err));
+	  break;
+	}
+
+      now = bench_time_now ();
+      if (now - last >= 1)
+	{
+	  uint64_t rx = bm->rx.packets, tx = bm->tx.packets;
+	  printf ("tx %8.3f Mpps  rx %8.3f Mpps\n",
+		  (tx - last_tx) / (now - last) * 1e-6,
+		  (rx - last_rx) / (now - last) * 1e-6);
+	  last_rx = rx;
+	  last_tx = tx;
+	  last = now;
+	}
+      if (now - start >= bm->seconds)
+	break;
+    }
+
+  bm->stop = 1;
+  pthread_join (bm->tx.thread, NULL);
+  pthread_join (bm->rx.thread, NULL);
+  now = bench_time_now ();
+
+  if (bm->tx.err)
+    INFO ("tx: %s", memif_strerror (bm->tx.err));
+  if (bm->rx.err)
+    INFO ("rx: %s", memif_strerror (bm->rx.err));
+
+  printf ("\n");
+  bench_print ("tx", bm->tx.packets, bm->tx.bytes, now - start);
+  bench_print ("rx", bm->rx.packets, bm->rx.bytes, now - start);
+
+done:
+  memif_delete (&bm->tx.conn);
+  memif_delete (&bm->rx.conn);
+  memif_cleanup ();
+  free (bm->free_bufs);
+  return err ? -1 : 0;
+}
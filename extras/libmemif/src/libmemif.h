@@ -198,7 +198,8 @@ typedef struct
 typedef enum
 {
   MEMIF_RX_MODE_INTERRUPT = 0,	/*!< interrupt mode */
-  MEMIF_RX_MODE_POLLING		/*!< polling mode */
+  MEMIF_RX_MODE_POLLING,	/*!< polling mode */
+  MEMIF_RX_MODE_ADAPTIVE	/*!< polling while busy, interrupt when idle */
 } memif_rx_mode_t;
 
 /** \brief Memif buffer
@@ -314,6 +315,12 @@ int memif_get_queue_efd (memif_conn_handle_t conn, uint16_t qid, int *fd);
     @param rx_mode - receive mode
     @param qid - queue id
 
+    In polling and adaptive mode the peer does not signal the queue event fd
+    and memif_rx_burst does no syscalls. An adaptive mode queue turns
+    interrupts back on after about a thousand empty memif_rx_burst calls in
+    a row, and off again once packets are received; use memif_rx_wait to
+    sleep while it is idle.
+
     \return memif_err_t
 */
 int memif_set_rx_mode (memif_conn_handle_t conn, memif_rx_mode_t rx_mode,
@@ -452,6 +459,9 @@ int memif_buffer_enq_tx (memif_conn_handle_t conn, uint16_t qid,
     @param count_out - returns number of allocated buffers
     @param size - buffer size, may return chained buffers if size > buffer_size
 
+    Master disconnects and returns MEMIF_ERR_DISCONNECTED if the slave put
+    a descriptor out of its regions on the ring.
+
     \return memif_err_t
 */
 int memif_buffer_alloc (memif_conn_handle_t conn, uint16_t qid,
@@ -488,11 +498,113 @@ int memif_tx_burst (memif_conn_handle_t conn, uint16_t qid,
     @param count - number of memif buffers to receive
     @param rx - returns number of received buffers
 
+    Master disconnects and returns MEMIF_ERR_DISCONNECTED if the slave put
+    a descriptor out of its regions on the ring.
+
     \return memif_err_t
 */
 int memif_rx_burst (memif_conn_handle_t conn, uint16_t qid,
 		    memif_buffer_t * bufs, uint16_t count, uint16_t * rx);
 
+/** \brief Memif wait for receive
+    @param conn - memif conenction handle
+    @param qid - number indentifying queue
+    @param timeout - timeout in milliseconds, -1 = wait until packets arrive
+
+    Busy-poll companion of memif_rx_burst which does not go through epoll.
+    Returns immediately if the queue is in polling mode (or in the polling
+    phase of adaptive mode) or already has packets. Otherwise it blocks on the
+    queue event fd only, so control fds still have to be handled elsewhere,
+    e.g. by memif_poll_event in another thread.
+
+    \return memif_err_t
+*/
+int memif_rx_wait (memif_conn_handle_t conn, uint16_t qid, int timeout);
+
+/**
+ * @defgroup ZERO_COPY Zero-copy mode
+ * @ingroup API_CALLS
+ *
+ * In zero-copy mode (slave only) the application owns the packet buffers.
+ * It registers one or more buffer regions before the connection is
+ * established, carves buffers out of them as it likes, and lends them to
+ * the rings: empty buffers to rx queues with memif_lend_rx_buffers and full
+ * ones to tx queues with memif_lend_tx_buffers. Buffers returned by
+ * memif_rx_burst and memif_reclaim_tx_buffers belong to the application
+ * again, they can be lent to any queue without copying, e.g. to forward a
+ * received packet. memif_buffer_alloc, memif_buffer_enq_tx and
+ * memif_refill_queue are not available on a zero-copy connection.
+ *
+ * @{
+ */
+
+/** \brief Memif add buffer region
+    @param conn - memif conenction handle
+    @param size - region size in bytes
+    @param fd - memfd backing the region, -1 = let libmemif create one
+    @param[out] addr - returns address of the region
+
+    Puts the connection in zero-copy mode. Must be called while the
+    connection is down, the region is kept until memif_delete. If the fd is
+    supplied by the application it stays open, it has to be sealable
+    (MFD_ALLOW_SEALING) and the region has to fit in it.
+
+    \return memif_err_t
+*/
+int memif_add_buffer_region (memif_conn_handle_t conn, uint32_t size,
+			     int fd, void **addr);
+
+/** \brief Memif lend rx buffers
+    @param conn - memif conenction handle
+    @param qid - number indentifying queue
+    @param bufs - application buffers, data and len set
+    @param count - number of buffers to lend
+    @param count_out - returns number of buffers placed on ring
+
+    Posts empty buffers on the rx ring. The peer fills them and
+    memif_rx_burst hands them back with the received length.
+
+    \return memif_err_t
+*/
+int memif_lend_rx_buffers (memif_conn_handle_t conn, uint16_t qid,
+			   memif_buffer_t * bufs, uint16_t count,
+			   uint16_t * count_out);
+
+/** \brief Memif lend tx buffers
+    @param conn - memif conenction handle
+    @param qid - number indentifying queue
+    @param bufs - application buffers, data, len and flags set
+    @param count - number of buffers to transmit
+    @param tx - returns number of transmitted buffers
+
+    Transmits the buffers in place. They are lent to the peer until they are
+    returned by memif_reclaim_tx_buffers.
+
+    \return memif_err_t
+*/
+int memif_lend_tx_buffers (memif_conn_handle_t conn, uint16_t qid,
+			   memif_buffer_t * bufs, uint16_t count,
+			   uint16_t * tx);
+
+/** \brief Memif reclaim tx buffers
+    @param conn - memif conenction handle
+    @param qid - number indentifying queue
+    @param bufs - memif buffers
+    @param count - max number of buffers to reclaim
+    @param count_out - returns number of reclaimed buffers
+
+    Returns the buffers lent by memif_lend_tx_buffers which the peer is done
+    with, in transmit order.
+
+    \return memif_err_t
+*/
+int memif_reclaim_tx_buffers (memif_conn_handle_t conn, uint16_t qid,
+			      memif_buffer_t * bufs, uint16_t count,
+			      uint16_t * count_out);
+
+#define MEMIF_HAVE_ZERO_COPY 1
+/** @} */
+
 /** \brief Memif poll event
     @param timeout - timeout in seconds
 
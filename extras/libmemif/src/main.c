@@ -44,6 +44,7 @@
 #include <sys/eventfd.h>
 #include <sys/timerfd.h>
 #include <sys/epoll.h>
+#include <poll.h>
 #include <signal.h>
 #include <linux/memfd.h>
 
@@ -586,8 +587,16 @@ memif_set_rx_mode (memif_conn_handle_t c, memif_rx_mode_t rx_mode,
   if (qid >= num)
     return MEMIF_ERR_QID;
 
-  conn->rx_queues[qid].ring->flags = rx_mode;
-  DBG ("rx_mode flag: %u", conn->rx_queues[qid].ring->flags);
+  if (rx_mode > MEMIF_RX_MODE_ADAPTIVE)
+    return MEMIF_ERR_INVAL_ARG;
+
+  memif_queue_t *mq = &conn->rx_queues[qid];
+  mq->rx_mode = rx_mode;
+  mq->idle_polls = 0;
+  /* adaptive mode starts polling */
+  mq->ring->flags =
+    (rx_mode == MEMIF_RX_MODE_INTERRUPT) ? 0 : MEMIF_RING_FLAG_MASK_INT;
+  DBG ("rx_mode flag: %u", mq->ring->flags);
   return MEMIF_ERR_SUCCESS;
 }
 
@@ -1084,6 +1093,7 @@ memif_disconnect_internal (memif_connection_t * c)
   uint16_t num;
   int err = MEMIF_ERR_SUCCESS, i;	/* 0 */
   memif_queue_t *mq;
+  memif_region_t *mr;
   libmemif_main_t *lm = &libmemif_main;
   memif_list_elt_t *e;
 
@@ -1151,13 +1161,20 @@ memif_disconnect_internal (memif_connection_t * c)
 
   if (c->regions != NULL)
     {
-      if (munmap (c->regions[0].shm, c->regions[0].region_size) < 0)
-	return memif_syscall_error_handler (errno);
-      if (c->regions[0].fd > 0)
-	close (c->regions[0].fd);
-      c->regions[0].fd = -1;
+      /* slave regions past 0 are buffer regions, kept until memif_delete */
+      num = (c->args.is_master) ? c->regions_num : 1;
+      for (i = 0; i < num; i++)
+	{
+	  mr = &c->regions[i];
+	  if (mr->shm != NULL && munmap (mr->shm, mr->region_size) < 0)
+	    return memif_syscall_error_handler (errno);
+	  if (mr->fd > 0)
+	    close (mr->fd);
+	  mr->fd = -1;
+	}
       lm->free (c->regions);
       c->regions = NULL;
+      c->regions_num = 0;
     }
 
   memset (&c->run_args, 0, sizeof (memif_conn_run_args_t));
@@ -1192,6 +1209,7 @@ memif_delete (memif_conn_handle_t * conn)
   libmemif_main_t *lm = &libmemif_main;
   memif_list_elt_t *e = NULL;
   memif_socket_t *ms = NULL;
+  int i;
 
   int err = MEMIF_ERR_SUCCESS;
 
@@ -1244,6 +1262,17 @@ memif_delete (memif_conn_handle_t * conn)
 	}
     }
 
+  for (i = 0; i < c->buffer_regions_num; i++)
+    {
+      memif_region_t *mr = &c->buffer_regions[i];
+      munmap (mr->shm, mr->region_size);
+      if (!mr->is_external)
+	close (mr->fd);
+    }
+  if (c->buffer_regions)
+    lm->free (c->buffer_regions);
+  c->buffer_regions = NULL;
+
   if (c->args.socket_filename)
     lm->free (c->args.socket_filename);
   c->args.socket_filename = NULL;
@@ -1264,7 +1293,7 @@ memif_connect1 (memif_connection_t * c)
   int i;
   uint16_t num;
 
-  if (mr != NULL)
+  for (i = 0; mr != NULL && i < c->regions_num; i++, mr++)
     {
       if (!mr->shm)
 	{
@@ -1274,6 +1303,7 @@ memif_connect1 (memif_connection_t * c)
 	  if ((mr->shm = mmap (NULL, mr->region_size, PROT_READ | PROT_WRITE,
 			       MAP_SHARED, mr->fd, 0)) == MAP_FAILED)
 	    {
+	      mr->shm = NULL;
 	      return memif_syscall_error_handler (errno);
 	    }
 	}
@@ -1293,8 +1323,8 @@ memif_connect1 (memif_connection_t * c)
 	      DBG ("wrong cookie on tx ring %u", i);
 	      return MEMIF_ERR_COOKIE;
 	    }
-	  mq->ring->head = mq->ring->tail = mq->last_head = mq->alloc_bufs =
-	    0;
+	  mq->ring->head = mq->ring->tail = mq->last_head = mq->last_tail =
+	    mq->alloc_bufs = 0;
 	}
     }
   num =
@@ -1311,8 +1341,8 @@ memif_connect1 (memif_connection_t * c)
 	      DBG ("wrong cookie on rx ring %u", i);
 	      return MEMIF_ERR_COOKIE;
 	    }
-	  mq->ring->head = mq->ring->tail = mq->last_head = mq->alloc_bufs =
-	    0;
+	  mq->ring->head = mq->ring->tail = mq->last_head = mq->last_tail =
+	    mq->alloc_bufs = 0;
 	}
     }
 
@@ -1330,10 +1360,21 @@ memif_init_regions_and_queues (memif_connection_t * conn)
   libmemif_main_t *lm = &libmemif_main;
   memif_list_elt_t e;
 
-  conn->regions = (memif_region_t *) lm->alloc (sizeof (memif_region_t));
+  int zero_copy = conn->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY;
+
+  /* region 0 holds the rings, and the buffers unless the application
+     provides them */
+  conn->regions_num = 1 + conn->buffer_regions_num;
+  conn->regions = (memif_region_t *) lm->alloc (sizeof (memif_region_t) *
+						conn->regions_num);
   if (conn->regions == NULL)
     return MEMIF_ERR_NOMEM;
   r = conn->regions;
+  memset (r, 0, sizeof (memif_region_t));
+  r->fd = -1;
+  if (conn->buffer_regions_num)
+    memcpy (r + 1, conn->buffer_regions,
+	    sizeof (memif_region_t) * conn->buffer_regions_num);
 
   r->buffer_offset =
     (conn->run_args.num_s2m_rings +
@@ -1341,12 +1382,12 @@ memif_init_regions_and_queues (memif_connection_t * conn)
 				      sizeof (memif_desc_t) *
 				      (1 << conn->run_args.log2_ring_size));
 
-  r->region_size = r->buffer_offset +
-    conn->run_args.buffer_size * (1 << conn->run_args.log2_ring_size) *
-    (conn->run_args.num_s2m_rings + conn->run_args.num_m2s_rings);
+  r->region_size = r->buffer_offset;
+  if (!zero_copy)
+    r->region_size += conn->run_args.buffer_size *
+      (1 << conn->run_args.log2_ring_size) *
+      (conn->run_args.num_s2m_rings + conn->run_args.num_m2s_rings);
 
-  if ((r->fd =
-       memfd_create ("memif region 0", MFD_ALLOW_SEALING)) == -1)
   if ((r->fd = memfd_create ("memif region 0", MFD_ALLOW_SEALING)) == -1)
     return memif_syscall_error_handler (errno);
 
@@ -1371,9 +1412,10 @@ memif_init_regions_and_queues (memif_connection_t * conn)
 	{
 	  uint16_t slot = i * (1 << conn->run_args.log2_ring_size) + j;
 	  ring->desc[j].region = 0;
-	  ring->desc[j].offset = r->buffer_offset +
+	  /* zero-copy descriptors are filled when buffers are lent */
+	  ring->desc[j].offset = zero_copy ? 0 : r->buffer_offset +
 	    (uint32_t) (slot * conn->run_args.buffer_size);
-	  ring->desc[j].length = conn->run_args.buffer_size;
+	  ring->desc[j].length = zero_copy ? 0 : conn->run_args.buffer_size;
 	}
     }
   for (i = 0; i < conn->run_args.num_m2s_rings; i++)
@@ -1390,9 +1432,9 @@ memif_init_regions_and_queues (memif_connection_t * conn)
 	     conn->run_args.num_s2m_rings) *
 	    (1 << conn->run_args.log2_ring_size) + j;
 	  ring->desc[j].region = 0;
-	  ring->desc[j].offset = r->buffer_offset +
+	  ring->desc[j].offset = zero_copy ? 0 : r->buffer_offset +
 	    (uint32_t) (slot * conn->run_args.buffer_size);
-	  ring->desc[j].length = conn->run_args.buffer_size;
+	  ring->desc[j].length = zero_copy ? 0 : conn->run_args.buffer_size;
 	}
     }
   memif_queue_t *mq;
@@ -1417,8 +1459,10 @@ memif_init_regions_and_queues (memif_connection_t * conn)
       mq[x].region = 0;
       mq[x].offset =
 	(void *) mq[x].ring - (void *) conn->regions[mq->region].shm;
-      mq[x].last_head = 0;
+      mq[x].last_head = mq[x].last_tail = 0;
       mq[x].alloc_bufs = 0;
+      mq[x].rx_mode = MEMIF_RX_MODE_INTERRUPT;
+      mq[x].idle_polls = 0;
     }
   conn->tx_queues = mq;
 
@@ -1442,8 +1486,10 @@ memif_init_regions_and_queues (memif_connection_t * conn)
       mq[x].region = 0;
       mq[x].offset =
 	(void *) mq[x].ring - (void *) conn->regions[mq->region].shm;
-      mq[x].last_head = 0;
+      mq[x].last_head = mq[x].last_tail = 0;
       mq[x].alloc_bufs = 0;
+      mq[x].rx_mode = MEMIF_RX_MODE_INTERRUPT;
+      mq[x].idle_polls = 0;
     }
   conn->rx_queues = mq;
 
@@ -1469,6 +1515,8 @@ memif_buffer_enq_tx (memif_conn_handle_t conn, uint16_t qid,
     return MEMIF_ERR_INVAL_ARG;
   if (EXPECT_FALSE (c->args.is_master))
     return MEMIF_ERR_INVAL_ARG;
+  if (EXPECT_FALSE (c->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY))
+    return MEMIF_ERR_INVAL_ARG;
 
   memif_queue_t *mq = &c->tx_queues[qid];
   memif_ring_t *ring = mq->ring;
@@ -1531,6 +1579,17 @@ error:
   return err;
 }
 
+/* peer put a descriptor out of its regions on the ring, its rings can not
+   be trusted anymore */
+static int
+memif_desc_error (memif_connection_t * c)
+{
+  DBG ("invalid descriptor");
+  strncpy ((char *) c->remote_disconnect_string, "invalid descriptor", 19);
+  memif_disconnect_internal (c);
+  return MEMIF_ERR_DISCONNECTED;
+}
+
 int
 memif_buffer_alloc (memif_conn_handle_t conn, uint16_t qid,
 		    memif_buffer_t * bufs, uint16_t count,
@@ -1548,6 +1607,9 @@ memif_buffer_alloc (memif_conn_handle_t conn, uint16_t qid,
     return MEMIF_ERR_QID;
   if (EXPECT_FALSE (!count_out))
     return MEMIF_ERR_INVAL_ARG;
+  /* zero-copy slave transmits application buffers */
+  if (EXPECT_FALSE (c->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY))
+    return MEMIF_ERR_INVAL_ARG;
 
   memif_queue_t *mq = &c->tx_queues[qid];
   memif_ring_t *ring = mq->ring;
@@ -1559,6 +1621,8 @@ memif_buffer_alloc (memif_conn_handle_t conn, uint16_t qid,
   uint16_t dst_left, src_left;
   uint16_t saved_count;
   memif_buffer_t *saved_b;
+  void *peer_data = NULL;
+  uint32_t peer_len;
   *count_out = 0;
 
   ring_size = (1 << mq->log2_ring_size);
@@ -1583,8 +1647,15 @@ memif_buffer_alloc (memif_conn_handle_t conn, uint16_t qid,
       ring->desc[slot & mask].flags = 0;
 
       /* slave can produce buffer with original length */
-      dst_left = (c->args.is_master) ? ring->desc[slot & mask].length :
-	c->run_args.buffer_size;
+      if (c->args.is_master)
+	{
+	  peer_data = memif_get_peer_buffer (c, ring, slot & mask, &peer_len);
+	  if (EXPECT_FALSE (peer_data == NULL))
+	    goto bad_desc;
+	  dst_left = peer_len;
+	}
+      else
+	dst_left = c->run_args.buffer_size;
       src_left = size;
 
       while (src_left)
@@ -1605,9 +1676,16 @@ memif_buffer_alloc (memif_conn_handle_t conn, uint16_t qid,
 
 		  b0 = (bufs + *count_out);
 		  b0->desc_index = slot;
-		  dst_left =
-		    (c->args.is_master) ? ring->desc[slot & mask].length : c->
-		    run_args.buffer_size;
+		  if (c->args.is_master)
+		    {
+		      peer_data = memif_get_peer_buffer (c, ring, slot & mask,
+							 &peer_len);
+		      if (EXPECT_FALSE (peer_data == NULL))
+			goto bad_desc;
+		      dst_left = peer_len;
+		    }
+		  else
+		    dst_left = c->run_args.buffer_size;
 		  ring->desc[slot & mask].flags = 0;
 		}
 	      else
@@ -1632,7 +1710,9 @@ memif_buffer_alloc (memif_conn_handle_t conn, uint16_t qid,
 		c->regions->buffer_offset + (x * c->run_args.buffer_size);
 	    }
 
-	  b0->data = c->regions->shm + ring->desc[slot & mask].offset;
+	  /* master fills the buffers the slave put on the ring */
+	  b0->data = (c->args.is_master) ? peer_data :
+	    memif_get_buffer (c, ring, slot & mask);
 
 	  src_left -= b0->len;
 	  dst_left -= b0->len;
@@ -1658,6 +1738,10 @@ no_ns:
 
 error:
   return err;
+
+bad_desc:
+  *count_out = 0;
+  return memif_desc_error (c);
 }
 
 int
@@ -1680,6 +1764,9 @@ memif_refill_queue (memif_conn_handle_t conn, uint16_t qid, uint16_t count,
   uint16_t mask = (1 << mq->log2_ring_size) - 1;
   uint16_t slot;
 
+  if (EXPECT_FALSE (c->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY))
+    return MEMIF_ERR_INVAL_ARG;
+
   if (c->args.is_master)
     {
       MEMIF_MEMORY_BARRIER ();
@@ -1782,6 +1869,29 @@ memif_tx_burst (memif_conn_handle_t conn, uint16_t qid,
   return MEMIF_ERR_SUCCESS;	/* 0 */
 }
 
+/* adaptive rx mode: poll while there is traffic, re-enable interrupts
+   once the queue has been idle for a while. Returns 1 if interrupts
+   were just re-enabled. */
+static inline int
+memif_queue_adapt (memif_queue_t * mq, memif_ring_t * ring, uint16_t ns)
+{
+  if (ns)
+    {
+      mq->idle_polls = 0;
+      if ((ring->flags & MEMIF_RING_FLAG_MASK_INT) == 0)
+	ring->flags |= MEMIF_RING_FLAG_MASK_INT;
+    }
+  else if (mq->idle_polls < MEMIF_ADAPTIVE_IDLE_POLLS)
+    {
+      if (++mq->idle_polls == MEMIF_ADAPTIVE_IDLE_POLLS)
+	{
+	  ring->flags &= ~MEMIF_RING_FLAG_MASK_INT;
+	  return 1;
+	}
+    }
+  return 0;
+}
+
 int
 memif_rx_burst (memif_conn_handle_t conn, uint16_t qid,
 		memif_buffer_t * bufs, uint16_t count, uint16_t * rx)
@@ -1805,29 +1915,59 @@ memif_rx_burst (memif_conn_handle_t conn, uint16_t qid,
   uint16_t ns;
   uint16_t mask = (1 << mq->log2_ring_size) - 1;
   memif_buffer_t *b0, *b1;
+  uint32_t len;
   *rx = 0;
 
-  uint64_t b;
-  ssize_t r = read (mq->int_fd, &b, sizeof (b));
-  if (EXPECT_FALSE ((r == -1) && (errno != EAGAIN)))
-    return memif_syscall_error_handler (errno);
+  /* the event fd is only signalled while interrupts are on, a polling
+     queue does no syscalls here */
+  if ((ring->flags & MEMIF_RING_FLAG_MASK_INT) == 0)
+    {
+      uint64_t b;
+      ssize_t r = read (mq->int_fd, &b, sizeof (b));
+      if (EXPECT_FALSE ((r == -1) && (errno != EAGAIN)))
+	return memif_syscall_error_handler (errno);
+    }
 
   cur_slot = (c->args.is_master) ? mq->last_head : mq->last_tail;
   last_slot = (c->args.is_master) ? ring->head : ring->tail;
+  ns = last_slot - cur_slot;
+
+  if (mq->rx_mode == MEMIF_RX_MODE_ADAPTIVE &&
+      memif_queue_adapt (mq, ring, ns))
+    {
+      /* the peer does not signal what it enqueued before it saw
+         interrupts on, take that now or nobody wakes up for it */
+      __sync_synchronize ();
+      last_slot = (c->args.is_master) ? ring->head : ring->tail;
+      ns = last_slot - cur_slot;
+    }
+
   if (cur_slot == last_slot)
     return MEMIF_ERR_SUCCESS;
 
-  ns = last_slot - cur_slot;
-
   while (ns && count)
     {
       b0 = (bufs + *rx);
 
       b0->desc_index = cur_slot;
-      b0->data = memif_get_buffer (c, ring, cur_slot & mask);
-      b0->len = ring->desc[cur_slot & mask].length;
-      /* slave resets buffer length */
-      if (c->args.is_master == 0)
+      if (c->args.is_master)
+	{
+	  b0->data = memif_get_peer_buffer (c, ring, cur_slot & mask, &len);
+	  if (EXPECT_FALSE (b0->data == NULL))
+	    {
+	      *rx = 0;
+	      return memif_desc_error (c);
+	    }
+	  b0->len = len;
+	}
+      else
+	{
+	  b0->data = memif_get_buffer (c, ring, cur_slot & mask);
+	  b0->len = ring->desc[cur_slot & mask].length;
+	}
+      /* slave resets buffer length, zero-copy buffers are lent again */
+      if (c->args.is_master == 0 &&
+	  (c->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY) == 0)
 	{
 	  ring->desc[cur_slot & mask].length = c->run_args.buffer_size;
 	}
@@ -1867,6 +2007,306 @@ memif_rx_burst (memif_conn_handle_t conn, uint16_t qid,
   return MEMIF_ERR_SUCCESS;	/* 0 */
 }
 
+int
+memif_rx_wait (memif_conn_handle_t conn, uint16_t qid, int timeout)
+{
+  memif_connection_t *c = (memif_connection_t *) conn;
+  if (EXPECT_FALSE (c == NULL))
+    return MEMIF_ERR_NOCONN;
+  if (EXPECT_FALSE (c->fd < 0))
+    return MEMIF_ERR_DISCONNECTED;
+  uint8_t num =
+    (c->args.is_master) ? c->run_args.num_s2m_rings : c->run_args.
+    num_m2s_rings;
+  if (EXPECT_FALSE (qid >= num))
+    return MEMIF_ERR_QID;
+
+  memif_queue_t *mq = &c->rx_queues[qid];
+  memif_ring_t *ring = mq->ring;
+  uint16_t cur_slot, last_slot;
+  struct pollfd pfd;
+
+  if (ring->flags & MEMIF_RING_FLAG_MASK_INT)
+    return MEMIF_ERR_SUCCESS;
+
+  /* interrupts are on, so the peer signals anything it enqueues after
+     this check */
+  __sync_synchronize ();
+  cur_slot = (c->args.is_master) ? mq->last_head : mq->last_tail;
+  last_slot = (c->args.is_master) ? ring->head : ring->tail;
+  if (cur_slot != last_slot)
+    return MEMIF_ERR_SUCCESS;
+
+  pfd.fd = mq->int_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll (&pfd, 1, timeout) < 0 && errno != EINTR)
+    return memif_syscall_error_handler (errno);
+
+  return MEMIF_ERR_SUCCESS;	/* 0 */
+}
+
+int
+memif_add_buffer_region (memif_conn_handle_t conn, uint32_t size, int fd,
+			 void **addr)
+{
+  memif_connection_t *c = (memif_connection_t *) conn;
+  libmemif_main_t *lm = &libmemif_main;
+  memif_region_t *mr;
+  int err;
+  if (c == NULL)
+    return MEMIF_ERR_NOCONN;
+  /* master uses the regions of the slave */
+  if (c->args.is_master || size == 0 || addr == NULL)
+    return MEMIF_ERR_INVAL_ARG;
+  if (c->regions != NULL)
+    return MEMIF_ERR_ALRCONN;
+  if (c->buffer_regions_num + 1 >= MEMIF_MAX_REGION)
+    return MEMIF_ERR_MAXREG;
+
+  mr = (memif_region_t *) lm->alloc (sizeof (memif_region_t) *
+				     (c->buffer_regions_num + 1));
+  if (mr == NULL)
+    return MEMIF_ERR_NOMEM;
+  if (c->buffer_regions != NULL)
+    {
+      memcpy (mr, c->buffer_regions,
+	      sizeof (memif_region_t) * c->buffer_regions_num);
+      lm->free (c->buffer_regions);
+    }
+  c->buffer_regions = mr;
+  mr += c->buffer_regions_num;
+  memset (mr, 0, sizeof (memif_region_t));
+  mr->region_size = size;
+  mr->is_external = (fd >= 0);
+
+  if (fd < 0)
+    {
+      if ((fd = memfd_create ("memif buffer region", MFD_ALLOW_SEALING)) ==
+	  -1)
+	return memif_syscall_error_handler (errno);
+
+      if ((fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK)) == -1 ||
+	  (ftruncate (fd, size)) == -1)
+	{
+	  err = memif_syscall_error_handler (errno);
+	  close (fd);
+	  return err;
+	}
+    }
+
+  if ((mr->shm = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		       fd, 0)) == MAP_FAILED)
+    {
+      err = memif_syscall_error_handler (errno);
+      if (!mr->is_external)
+	close (fd);
+      return err;
+    }
+  mr->fd = fd;
+
+  c->buffer_regions_num++;
+  c->flags |= MEMIF_CONNECTION_FLAG_ZERO_COPY;
+  *addr = mr->shm;
+
+  DBG ("buffer region %u: %u bytes at %p", c->buffer_regions_num, size,
+       mr->shm);
+
+  return MEMIF_ERR_SUCCESS;	/* 0 */
+}
+
+/* point descriptor at application buffer, fails if the buffer is not
+   inside a buffer region */
+static inline int
+memif_buffer_to_desc (memif_connection_t * c, memif_buffer_t * b,
+		      memif_desc_t * d)
+{
+  memif_region_t *mr;
+  int i;
+
+  for (i = 1; i < c->regions_num; i++)
+    {
+      mr = &c->regions[i];
+      if (b->data >= mr->shm &&
+	  b->data + b->len <= mr->shm + mr->region_size)
+	{
+	  d->region = i;
+	  d->offset = (uint32_t) (b->data - mr->shm);
+	  d->length = b->len;
+	  return 0;
+	}
+    }
+
+  DBG ("buffer %p not in a buffer region", b->data);
+  return -1;
+}
+
+int
+memif_lend_rx_buffers (memif_conn_handle_t conn, uint16_t qid,
+		       memif_buffer_t * bufs, uint16_t count,
+		       uint16_t * count_out)
+{
+  memif_connection_t *c = (memif_connection_t *) conn;
+  if (EXPECT_FALSE (c == NULL))
+    return MEMIF_ERR_NOCONN;
+  if (EXPECT_FALSE (c->fd < 0))
+    return MEMIF_ERR_DISCONNECTED;
+  /* zero-copy connection is always slave */
+  if (EXPECT_FALSE ((c->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY) == 0))
+    return MEMIF_ERR_INVAL_ARG;
+  if (EXPECT_FALSE (qid >= c->run_args.num_m2s_rings))
+    return MEMIF_ERR_QID;
+  if (EXPECT_FALSE (!count_out))
+    return MEMIF_ERR_INVAL_ARG;
+
+  memif_queue_t *mq = &c->rx_queues[qid];
+  memif_ring_t *ring = mq->ring;
+  uint16_t mask = (1 << mq->log2_ring_size) - 1;
+  uint16_t head = ring->head;
+  uint16_t ns = (1 << mq->log2_ring_size) - head + mq->last_tail;
+  int err = MEMIF_ERR_SUCCESS;	/* 0 */
+  *count_out = 0;
+
+  while (count && ns)
+    {
+      memif_desc_t *d = &ring->desc[head & mask];
+      if (EXPECT_FALSE (memif_buffer_to_desc (c, bufs + *count_out, d)))
+	{
+	  err = MEMIF_ERR_INVAL_ARG;
+	  break;
+	}
+      d->flags = 0;
+
+      head++;
+      ns--;
+      count--;
+      *count_out += 1;
+    }
+
+  MEMIF_MEMORY_BARRIER ();
+  ring->head = head;
+
+  if (count && err == MEMIF_ERR_SUCCESS)
+    {
+      DBG ("ring buffer full! qid: %u", qid);
+      err = MEMIF_ERR_NOBUF_RING;
+    }
+
+  return err;
+}
+
+int
+memif_lend_tx_buffers (memif_conn_handle_t conn, uint16_t qid,
+		       memif_buffer_t * bufs, uint16_t count, uint16_t * tx)
+{
+  memif_connection_t *c = (memif_connection_t *) conn;
+  if (EXPECT_FALSE (c == NULL))
+    return MEMIF_ERR_NOCONN;
+  if (EXPECT_FALSE (c->fd < 0))
+    return MEMIF_ERR_DISCONNECTED;
+  if (EXPECT_FALSE ((c->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY) == 0))
+    return MEMIF_ERR_INVAL_ARG;
+  if (EXPECT_FALSE (qid >= c->run_args.num_s2m_rings))
+    return MEMIF_ERR_QID;
+  if (EXPECT_FALSE (!tx))
+    return MEMIF_ERR_INVAL_ARG;
+
+  memif_queue_t *mq = &c->tx_queues[qid];
+  memif_ring_t *ring = mq->ring;
+  uint16_t mask = (1 << mq->log2_ring_size) - 1;
+  uint16_t head = ring->head;
+  uint16_t ns = (1 << mq->log2_ring_size) - head + mq->last_tail;
+  memif_buffer_t *b0;
+  int err = MEMIF_ERR_SUCCESS;	/* 0 */
+  *tx = 0;
+
+  while (count && ns)
+    {
+      memif_desc_t *d = &ring->desc[head & mask];
+      b0 = bufs + *tx;
+      if (EXPECT_FALSE (memif_buffer_to_desc (c, b0, d)))
+	{
+	  err = MEMIF_ERR_INVAL_ARG;
+	  break;
+	}
+      d->flags = (b0->flags & MEMIF_BUFFER_FLAG_NEXT) ?
+	MEMIF_DESC_FLAG_NEXT : 0;
+      b0->desc_index = head;
+      b0->ring = ring;
+
+      head++;
+      ns--;
+      count--;
+      *tx += 1;
+    }
+
+  if (count && err == MEMIF_ERR_SUCCESS)
+    {
+      DBG ("ring buffer full! qid: %u", qid);
+      err = MEMIF_ERR_NOBUF_RING;
+    }
+
+  if (EXPECT_FALSE (*tx == 0))
+    return err;
+
+  MEMIF_MEMORY_BARRIER ();
+  ring->head = head;
+
+  if ((ring->flags & MEMIF_RING_FLAG_MASK_INT) == 0)
+    {
+      uint64_t a = 1;
+      int r = write (mq->int_fd, &a, sizeof (a));
+      if (r < 0)
+	return MEMIF_ERR_INT_WRITE;
+    }
+
+  return err;
+}
+
+int
+memif_reclaim_tx_buffers (memif_conn_handle_t conn, uint16_t qid,
+			  memif_buffer_t * bufs, uint16_t count,
+			  uint16_t * count_out)
+{
+  memif_connection_t *c = (memif_connection_t *) conn;
+  if (EXPECT_FALSE (c == NULL))
+    return MEMIF_ERR_NOCONN;
+  if (EXPECT_FALSE (c->fd < 0))
+    return MEMIF_ERR_DISCONNECTED;
+  if (EXPECT_FALSE ((c->flags & MEMIF_CONNECTION_FLAG_ZERO_COPY) == 0))
+    return MEMIF_ERR_INVAL_ARG;
+  if (EXPECT_FALSE (qid >= c->run_args.num_s2m_rings))
+    return MEMIF_ERR_QID;
+  if (EXPECT_FALSE (!count_out))
+    return MEMIF_ERR_INVAL_ARG;
+
+  memif_queue_t *mq = &c->tx_queues[qid];
+  memif_ring_t *ring = mq->ring;
+  uint16_t mask = (1 << mq->log2_ring_size) - 1;
+  uint16_t cur_slot = mq->last_tail;
+  uint16_t last_slot = ring->tail;
+  memif_buffer_t *b0;
+  *count_out = 0;
+
+  while (count && cur_slot != last_slot)
+    {
+      b0 = bufs + *count_out;
+      b0->desc_index = cur_slot;
+      b0->ring = ring;
+      b0->data = memif_get_buffer (c, ring, cur_slot & mask);
+      b0->len = ring->desc[cur_slot & mask].length;
+      b0->flags = 0;
+
+      cur_slot++;
+      count--;
+      *count_out += 1;
+    }
+
+  mq->last_tail = cur_slot;
+
+  return MEMIF_ERR_SUCCESS;	/* 0 */
+}
+
 int
 memif_get_details (memif_conn_handle_t conn, memif_details_t * md,
 		   char *buf, ssize_t buflen)
@@ -50,6 +50,9 @@ _Static_assert (strlen (MEMIF_DEFAULT_APP_NAME) <= MEMIF_NAME_LEN,
 
 #define MEMIF_MAX_FDS 512
 
+/* empty polls before an adaptive mode queue re-enables interrupts */
+#define MEMIF_ADAPTIVE_IDLE_POLLS 1024
+
 #define memif_min(a,b) (((a) < (b)) ? (a) : (b))
 
 #define EXPECT_TRUE(x) __builtin_expect((x),1)
@@ -71,6 +74,7 @@ typedef struct
   uint32_t region_size;
   uint32_t buffer_offset;
   int fd;
+  uint8_t is_external;		/* fd belongs to the application */
 } memif_region_t;
 
 typedef struct
@@ -87,6 +91,9 @@ typedef struct
 
   uint64_t int_count;
   uint32_t alloc_bufs;
+
+  memif_rx_mode_t rx_mode;
+  uint16_t idle_polls;
 } memif_queue_t;
 
 typedef struct memif_msg_queue_elt
@@ -134,12 +141,19 @@ typedef struct memif_connection
   uint8_t remote_disconnect_string[96];
 
   memif_region_t *regions;
+  uint16_t regions_num;
+
+  /* application owned buffer regions (zero-copy mode), exported to peer
+     as regions 1 .. buffer_regions_num */
+  memif_region_t *buffer_regions;
+  uint8_t buffer_regions_num;
 
   memif_queue_t *rx_queues;
   memif_queue_t *tx_queues;
 
   uint16_t flags;
 #define MEMIF_CONNECTION_FLAG_WRITE (1 << 0)
+#define MEMIF_CONNECTION_FLAG_ZERO_COPY (1 << 1)
 } memif_connection_t;
 
 typedef struct
@@ -230,6 +244,24 @@ memif_get_buffer (memif_connection_t * conn, memif_ring_t * ring,
 	  ring->desc[index].offset);
 }
 
+/* descriptors written by the peer may point anywhere, so master checks
+   them against the peer's regions before touching the memory they
+   describe. Returns NULL for a descriptor out of bounds. */
+static inline void *
+memif_get_peer_buffer (memif_connection_t * conn, memif_ring_t * ring,
+		       uint16_t index, uint32_t * length)
+{
+  memif_desc_t d = ring->desc[index];
+
+  if (EXPECT_FALSE (d.region >= conn->regions_num ||
+		    (uint64_t) d.offset + d.length >
+		    conn->regions[d.region].region_size))
+    return NULL;
+
+  *length = d.length;
+  return conn->regions[d.region].shm + d.offset;
+}
+
 #ifndef F_LINUX_SPECIFIC_BASE
 #define F_LINUX_SPECIFIC_BASE 1024
 #endif
@@ -350,6 +350,13 @@ memif_msg_receive_hello (memif_connection_t * c, memif_msg_t * msg)
       return MEMIF_ERR_PROTO;
     }
 
+  /* region 0 plus the zero-copy buffer regions */
+  if (c->buffer_regions_num > h->max_region)
+    {
+      DBG ("peer supports only %u regions", h->max_region + 1);
+      return MEMIF_ERR_MAXREG;
+    }
+
   c->run_args.num_s2m_rings = memif_min (h->max_s2m_ring + 1,
 					 c->args.num_s2m_rings);
   c->run_args.num_m2s_rings = memif_min (h->max_m2s_ring + 1,
@@ -492,6 +499,11 @@ memif_msg_receive_add_region (memif_connection_t * c, memif_msg_t * msg,
   if (ar->index > MEMIF_MAX_REGION)
     return MEMIF_ERR_MAXREG;
 
+  /* regions come in order, an index out of it could leave gaps or
+     overwrite a region already mapped */
+  if (ar->index != c->regions_num)
+    return MEMIF_ERR_MFMSG;
+
   mr =
     (memif_region_t *) realloc (c->regions,
 				sizeof (memif_region_t) * (ar->index + 1));
@@ -501,6 +513,8 @@ memif_msg_receive_add_region (memif_connection_t * c, memif_msg_t * msg,
   c->regions[ar->index].fd = fd;
   c->regions[ar->index].region_size = ar->size;
   c->regions[ar->index].shm = NULL;
+  c->regions[ar->index].is_external = 0;
+  c->regions_num++;
 
   return MEMIF_ERR_SUCCESS;	/* 0 */
 }
@@ -718,8 +732,12 @@ memif_msg_receive (int ifd)
 	return err;
       if ((err = memif_msg_enq_init (c)) != MEMIF_ERR_SUCCESS)
 	return err;
-      if ((err = memif_msg_enq_add_region (c, 0)) != MEMIF_ERR_SUCCESS)
-	return err;
+      for (i = 0; i < c->regions_num; i++)
+	{
+	  if ((err =
+	       memif_msg_enq_add_region (c, i)) != MEMIF_ERR_SUCCESS)
+	    return err;
+	}
       for (i = 0; i < c->run_args.num_s2m_rings; i++)
 	{
 	  if ((err =
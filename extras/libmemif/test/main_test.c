@@ -674,6 +674,230 @@ START_TEST (test_rx_burst)
   ck_assert_ptr_eq (conn, NULL);
 }
 
+END_TEST
+START_TEST (test_zero_copy)
+{
+  int err, i;
+  uint16_t max_buf = 10, buf, rx, tx;
+  memif_buffer_t *bufs;
+  memif_ring_t *ring;
+  void *region = NULL;
+  ready_called = 0;
+  memif_conn_handle_t conn = NULL;
+  memif_conn_args_t args;
+  memset (&args, 0, sizeof (args));
+  args.num_s2m_rings = 1;
+  args.num_m2s_rings = 1;
+
+  libmemif_main_t *lm = &libmemif_main;
+
+  if ((err =
+       memif_init (control_fd_update, TEST_APP_NAME, NULL,
+		   NULL)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  strncpy ((char *) args.interface_name, TEST_IF_NAME, strlen (TEST_IF_NAME));
+
+  if ((err = memif_create (&conn, &args, on_connect,
+			   on_disconnect, on_interrupt,
+			   NULL)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  memif_connection_t *c = (memif_connection_t *) conn;
+
+  if ((err =
+       memif_add_buffer_region (conn, max_buf * 2048, -1,
+				&region)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+  ck_assert_ptr_ne (region, NULL);
+
+  c->run_args.num_s2m_rings = 1;
+  c->run_args.num_m2s_rings = 1;
+  c->run_args.log2_ring_size = 10;
+  c->run_args.buffer_size = 2048;
+
+  if ((err = memif_init_regions_and_queues (c)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  /* region 0 holds the rings only */
+  ck_assert_uint_eq (c->regions_num, 2);
+  ck_assert_ptr_eq (c->regions[1].shm, region);
+  ck_assert_uint_eq (c->regions[0].region_size, c->regions[0].buffer_offset);
+
+  c->fd = 69;
+
+  bufs = malloc (sizeof (memif_buffer_t) * max_buf);
+  for (i = 0; i < max_buf; i++)
+    {
+      bufs[i].data = region + i * 2048;
+      bufs[i].len = 2048;
+      bufs[i].flags = 0;
+    }
+
+  /* copying api is not available in zero-copy mode */
+  err = memif_buffer_alloc (conn, 0, bufs, max_buf, &buf, 64);
+  ck_assert_int_eq (err, MEMIF_ERR_INVAL_ARG);
+
+  /* lend empty buffers to rx queue */
+  if ((err =
+       memif_lend_rx_buffers (conn, 0, bufs, max_buf,
+			      &buf)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  ck_assert_uint_eq (buf, max_buf);
+  ring = c->rx_queues[0].ring;
+  ck_assert_uint_eq (ring->head, max_buf);
+  ck_assert_uint_eq (ring->desc[1].region, 1);
+  ck_assert_uint_eq (ring->desc[1].offset, 2048);
+
+  /* peer fills them */
+  for (i = 0; i < max_buf; i++)
+    ring->desc[i].length = 64;
+  ring->tail += max_buf;
+
+  memset (bufs, 0, sizeof (memif_buffer_t) * max_buf);
+  if ((err =
+       memif_rx_burst (conn, 0, bufs, max_buf, &rx)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  ck_assert_uint_eq (rx, max_buf);
+  for (i = 0; i < max_buf; i++)
+    {
+      ck_assert_ptr_eq (bufs[i].data, region + i * 2048);
+      ck_assert_uint_eq (bufs[i].len, 64);
+    }
+
+  /* transmit received buffers in place */
+  if ((err =
+       memif_lend_tx_buffers (conn, 0, bufs, max_buf,
+			      &tx)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  ck_assert_uint_eq (tx, max_buf);
+  ring = c->tx_queues[0].ring;
+  ck_assert_uint_eq (ring->head, max_buf);
+
+  /* nothing to reclaim until peer is done with them */
+  if ((err =
+       memif_reclaim_tx_buffers (conn, 0, bufs, max_buf,
+				 &buf)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+  ck_assert_uint_eq (buf, 0);
+
+  ring->tail += max_buf;
+
+  memset (bufs, 0, sizeof (memif_buffer_t) * max_buf);
+  if ((err =
+       memif_reclaim_tx_buffers (conn, 0, bufs, max_buf,
+				 &buf)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  ck_assert_uint_eq (buf, max_buf);
+  for (i = 0; i < max_buf; i++)
+    ck_assert_ptr_eq (bufs[i].data, region + i * 2048);
+
+  /* buffer outside of buffer regions (negative) */
+  bufs[0].data = c->regions[0].shm;
+  err = memif_lend_tx_buffers (conn, 0, bufs, 1, &tx);
+  ck_assert_int_eq (err, MEMIF_ERR_INVAL_ARG);
+  ck_assert_uint_eq (tx, 0);
+
+  if (lm->timerfd > 0)
+    close (lm->timerfd);
+  lm->timerfd = -1;
+  free (bufs);
+  bufs = NULL;
+
+  memif_delete (&conn);
+  ck_assert_ptr_eq (conn, NULL);
+}
+
+END_TEST
+START_TEST (test_rx_mode_adaptive)
+{
+  int err, i;
+  uint16_t max_buf = 10, rx;
+  memif_buffer_t *bufs;
+  memif_ring_t *ring;
+  ready_called = 0;
+  memif_conn_handle_t conn = NULL;
+  memif_conn_args_t args;
+  memset (&args, 0, sizeof (args));
+  args.num_s2m_rings = 1;
+  args.num_m2s_rings = 1;
+
+  libmemif_main_t *lm = &libmemif_main;
+
+  if ((err =
+       memif_init (control_fd_update, TEST_APP_NAME, NULL,
+		   NULL)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  strncpy ((char *) args.interface_name, TEST_IF_NAME, strlen (TEST_IF_NAME));
+
+  if ((err = memif_create (&conn, &args, on_connect,
+			   on_disconnect, on_interrupt,
+			   NULL)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  memif_connection_t *c = (memif_connection_t *) conn;
+
+  c->run_args.num_s2m_rings = 1;
+  c->run_args.num_m2s_rings = 1;
+  c->run_args.log2_ring_size = 10;
+  c->run_args.buffer_size = 2048;
+
+  if ((err = memif_init_regions_and_queues (c)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  c->fd = 69;
+  ring = c->rx_queues[0].ring;
+
+  if ((err =
+       memif_set_rx_mode (conn, MEMIF_RX_MODE_ADAPTIVE,
+			  0)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  /* starts polling */
+  ck_assert_uint_eq (ring->flags & MEMIF_RING_FLAG_MASK_INT,
+		     MEMIF_RING_FLAG_MASK_INT);
+
+  bufs = malloc (sizeof (memif_buffer_t) * max_buf);
+
+  /* idle queue turns interrupts on */
+  for (i = 0; i < MEMIF_ADAPTIVE_IDLE_POLLS; i++)
+    {
+      if ((err =
+	   memif_rx_burst (conn, 0, bufs, max_buf,
+			   &rx)) != MEMIF_ERR_SUCCESS)
+	ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+      ck_assert_uint_eq (rx, 0);
+    }
+  ck_assert_uint_eq (ring->flags & MEMIF_RING_FLAG_MASK_INT, 0);
+
+  /* pending packets, no need to wait for the interrupt */
+  ring->tail += max_buf;
+  if ((err = memif_rx_wait (conn, 0, 1000)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+
+  /* traffic turns them off again */
+  if ((err =
+       memif_rx_burst (conn, 0, bufs, max_buf, &rx)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+  ck_assert_uint_eq (rx, max_buf);
+  ck_assert_uint_eq (ring->flags & MEMIF_RING_FLAG_MASK_INT,
+		     MEMIF_RING_FLAG_MASK_INT);
+
+  if (lm->timerfd > 0)
+    close (lm->timerfd);
+  lm->timerfd = -1;
+  free (bufs);
+  bufs = NULL;
+
+  memif_delete (&conn);
+  ck_assert_ptr_eq (conn, NULL);
+}
+
 END_TEST
 START_TEST (test_get_details)
 {
@@ -934,6 +1158,8 @@ main_suite ()
   tcase_add_test (tc_api, test_buffer_alloc);
   tcase_add_test (tc_api, test_tx_burst);
   tcase_add_test (tc_api, test_rx_burst);
+  tcase_add_test (tc_api, test_zero_copy);
+  tcase_add_test (tc_api, test_rx_mode_adaptive);
   tcase_add_test (tc_api, test_get_details);
 
   /* create internal test case */
@@ -439,6 +439,7 @@ START_TEST (test_recv_add_region)
   int err;
   memif_connection_t conn;
   conn.regions = NULL;
+  conn.regions_num = 0;
   memif_msg_t msg;
   msg.type = MEMIF_MSG_TYPE_ADD_REGION;
   msg.add_region.size = 2048;
@@ -455,6 +456,23 @@ START_TEST (test_recv_add_region)
   ck_assert_uint_eq (mr->fd, fd);
   ck_assert_uint_eq (mr->region_size, 2048);
   ck_assert_ptr_eq (mr->shm, NULL);
+  ck_assert_uint_eq (conn.regions_num, 1);
+
+  /* region indexes must be sequential */
+  err = memif_msg_receive_add_region (&conn, &msg, fd);
+  ck_assert_uint_eq (err, MEMIF_ERR_MFMSG);
+  msg.add_region.index = 2;
+  err = memif_msg_receive_add_region (&conn, &msg, fd);
+  ck_assert_uint_eq (err, MEMIF_ERR_MFMSG);
+  ck_assert_uint_eq (conn.regions_num, 1);
+
+  msg.add_region.index = 1;
+  if ((err =
+       memif_msg_receive_add_region (&conn, &msg, fd)) != MEMIF_ERR_SUCCESS)
+    ck_abort_msg ("err code: %u, err msg: %s", err, memif_strerror (err));
+  ck_assert_uint_eq (conn.regions_num, 2);
+
+  free (conn.regions);
 }
 
 END_TEST
@@ -52,6 +52,7 @@
 
 #include "fa_node.h"
 #include "public_inlines.h"
+#include "bitvector_lookup.h"
 
 acl_main_t acl_main;
 
@@ -124,7 +125,8 @@ acl_set_heap (acl_main_t * am)
 	  u64 per_worker_slack = 1000000LL;
 	  u64 per_worker_size =
 	    per_worker_slack +
-	    ((u64) am->fa_conn_table_max_entries) * sizeof (fa_session_t);
+	    ((u64) am->fa_conn_table_max_entries) *
+	    (sizeof (fa_session_t) + sizeof (tw_timer_1t_3w_1024sl_ov_t));
 	  u64 per_worker_size_with_slack = per_worker_slack + per_worker_size;
 	  u64 main_slack = 2000000LL;
 	  u64 bihash_size = (u64) am->fa_conn_table_hash_memory_size;
@@ -3246,6 +3248,23 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       am->use_hash_acl_matching = (val != 0);
       goto done;
     }
+  if (unformat (input, "use-bitvector-acl-matching"))
+    {
+      u32 lc_index = ~0;
+      if (unformat (input, "lc_index %u %u", &lc_index, &val))
+	{
+	  if (pool_is_free_index (am->acl_lookup_contexts, lc_index))
+	    error = clib_error_return (0, "no lookup context %u", lc_index);
+	  else
+	    bitvector_acl_set_enabled (am, lc_index, val != 0);
+	}
+      else if (unformat (input, "%u", &val))
+	am->use_bitvector_acl_matching = (val != 0);
+      else
+	error = clib_error_return (0, "expecting [lc_index N] 0|1, got `%U`",
+				   format_unformat_error, input);
+      goto done;
+    }
   if (unformat (input, "l4-match-nonfirst-fragment %u", &val))
     {
       am->l4_match_nonfirst_fragment = (val != 0);
@@ -3879,6 +3898,15 @@ acl_plugin_show_sessions (acl_main_t * am,
 		       pw->cnt_already_deleted_sessions);
       vlib_cli_output (vm, "  Session timers restarted: %lu",
 		       pw->cnt_session_timer_restarted);
+      vlib_cli_output (vm, "  Sessions expired by timer: %lu",
+		       pw->cnt_timer_expired_sessions);
+      vlib_cli_output (vm, "  Timer expiry latency: avg %.3f max %.3f msec",
+		       pw->cnt_timer_expired_sessions ?
+		       1e3 * pw->timer_expiry_latency_total /
+		       pw->cnt_timer_expired_sessions /
+		       vm->clib_time.clocks_per_second : 0.0,
+		       1e3 * pw->timer_expiry_latency_max /
+		       vm->clib_time.clocks_per_second);
       vlib_cli_output (vm, "  Swipe until this time: %lu",
 		       pw->swipe_end_time);
       vlib_cli_output (vm, "  sw_if_index serviced bitmap: %U",
@@ -3946,6 +3974,7 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
   int show_applied_info = 0;
   int show_mask_type = 0;
   int show_bihash = 0;
+  int show_bitvector = 0;
   u32 show_bihash_verbose = 0;
 
   if (unformat (input, "acl"))
@@ -3969,16 +3998,22 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
       show_bihash = 1;
       unformat (input, "verbose %u", &show_bihash_verbose);
     }
+  else if (unformat (input, "bitvector"))
+    {
+      show_bitvector = 1;
+      unformat (input, "lc_index %u", &lc_index);
+    }
 
   if (!
       (show_mask_type || show_acl_hash_info || show_applied_info
-       || show_bihash))
+       || show_bihash || show_bitvector))
     {
       /* if no qualifiers specified, show all */
       show_mask_type = 1;
       show_acl_hash_info = 1;
       show_applied_info = 1;
       show_bihash = 1;
+      show_bitvector = 1;
     }
   if (show_mask_type)
     acl_plugin_show_tables_mask_type ();
@@ -3988,6 +4023,8 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
     acl_plugin_show_tables_applied_info (lc_index);
   if (show_bihash)
     acl_plugin_show_tables_bihash (show_bihash_verbose);
+  if (show_bitvector)
+    acl_plugin_show_tables_bitvector (lc_index);
 
   return error;
 }
@@ -4003,6 +4040,214 @@ acl_clear_aclplugin_fn (vlib_main_t * vm,
   return error;
 }
 
+/*
+ * Benchmark of the scalar and the batch 5-tuple match on one synthetic
+ * ACL. Rules come in four mask types (/32 or /24 source, tcp or udp)
+ * and a quarter of the tuples do not match anything.
+ */
+/* The low bits of random_u32 have a short period, use the high ones */
+static u32
+acl_match_bench_random (u32 * seed, u32 n)
+{
+  return (random_u32 (seed) >> 8) % n;
+}
+
+static void
+acl_match_bench_rule (vl_api_acl_rule_t * r, u32 i, int is_ip6)
+{
+  u32 src = clib_host_to_net_u32 ((i & 0xffff) << 8 | 1);
+
+  memset (r, 0, sizeof (*r));
+  r->is_permit = i & 1;
+  r->is_ipv6 = is_ip6;
+  if (is_ip6)
+    {
+      r->src_ip_addr[0] = 0x20;
+      r->src_ip_addr[1] = 0x01;
+      clib_memcpy (&r->src_ip_addr[12], &src, sizeof (src));
+      r->dst_ip_addr[0] = 0xfd;
+      r->dst_ip_addr[12] = i >> 16;
+      r->dst_ip_addr[14] = i & 0xff;
+      r->src_ip_prefix_len = (i & 2) ? 120 : 128;
+      r->dst_ip_prefix_len = 120;
+    }
+  else
+    {
+      clib_memcpy (r->src_ip_addr, &src, sizeof (src));
+      r->src_ip_addr[0] = 10;
+      r->dst_ip_addr[0] = 192;
+      r->dst_ip_addr[1] = 168 + (i >> 16);
+      r->dst_ip_addr[2] = i & 0xff;
+      r->src_ip_prefix_len = (i & 2) ? 24 : 32;
+      r->dst_ip_prefix_len = 24;
+    }
+  if (i & 2)
+    r->src_ip_addr[is_ip6 ? 15 : 3] = 0;
+  r->proto = (i & 1) ? IP_PROTOCOL_UDP : IP_PROTOCOL_TCP;
+  r->srcport_or_icmptype_last = 0xffff;
+  r->dstport_or_icmpcode_first = clib_host_to_net_u16 (1000 + i % 1000);
+  r->dstport_or_icmpcode_last = r->dstport_or_icmpcode_first;
+}
+
+static void
+acl_match_bench_tuple (fa_5tuple_t * t, vl_api_acl_rule_t * r, u32 * seed)
+{
+  memset (t, 0, sizeof (*t));
+  if (r->is_ipv6)
+    {
+      clib_memcpy (&t->ip6_addr[0], r->src_ip_addr, 16);
+      clib_memcpy (&t->ip6_addr[1], r->dst_ip_addr, 16);
+      t->ip6_addr[1].as_u8[15] = 1 + acl_match_bench_random (seed, 254);
+      t->pkt.is_ip6 = 1;
+    }
+  else
+    {
+      clib_memcpy (&t->ip4_addr[0], r->src_ip_addr, 4);
+      clib_memcpy (&t->ip4_addr[1], r->dst_ip_addr, 4);
+      t->ip4_addr[1].as_u8[3] = 1 + acl_match_bench_random (seed, 254);
+    }
+  if (r->is_ipv6 && r->src_ip_prefix_len == 120)
+    t->ip6_addr[0].as_u8[15] = 1 + acl_match_bench_random (seed, 254);
+  else if (!r->is_ipv6 && r->src_ip_prefix_len == 24)
+    t->ip4_addr[0].as_u8[3] = 1 + acl_match_bench_random (seed, 254);
+  t->l4.proto = r->proto;
+  t->l4.port[0] = 1024 + acl_match_bench_random (seed, 60000);
+  t->l4.port[1] = clib_net_to_host_u16 (r->dstport_or_icmpcode_first);
+  t->pkt.l4_valid = 1;
+  /* miss: a destination no rule covers */
+  if (acl_match_bench_random (seed, 4) == 0)
+    t->l4.port[1] = 80;
+}
+
+static clib_error_t *
+acl_test_aclplugin_match_fn (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  acl_main_t *am = &acl_main;
+  clib_error_t *error = 0;
+  u32 n_rules = 1000, n_tuples = 1 << 16, n_rounds = 10, is_ip6 = 0;
+  u32 acl_index = ~0, *acl_vec = 0, user_id, seed = 0xdeadbeef;
+  vl_api_acl_rule_t *rules = 0;
+  fa_5tuple_t *tuples = 0;
+  u8 *actions = 0, *batch_actions = 0;
+  u32 *acl_pos = 0, *acl_match = 0, *rule_match = 0, *batch_acl_match = 0;
+  u32 i, j, n, round, trace_bitmap = 0, n_matched = 0, n_mismatch = 0;
+  u64 t0, scalar_clocks = 0, batch_clocks = 0;
+  int lc_index, rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "rules %u", &n_rules))
+	;
+      else if (unformat (input, "tuples %u", &n_tuples))
+	;
+      else if (unformat (input, "rounds %u", &n_rounds))
+	;
+      else if (unformat (input, "ip6"))
+	is_ip6 = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+  if (n_rules == 0 || n_tuples == 0)
+    return clib_error_return (0, "need at least one rule and one tuple");
+
+  vec_validate (rules, n_rules - 1);
+  for (i = 0; i < n_rules; i++)
+    acl_match_bench_rule (&rules[i], i, is_ip6);
+  rv = acl_add_list (n_rules, rules, &acl_index, (u8 *) "match benchmark");
+  if (rv)
+    {
+      error = clib_error_return (0, "acl_add_list returned %d", rv);
+      goto done;
+    }
+
+  user_id = acl_plugin.register_user_module ("match benchmark", "run", 0);
+  lc_index = acl_plugin.get_lookup_context_index (user_id, 0, 0);
+  if (lc_index < 0)
+    {
+      error = clib_error_return (0, "no lookup context: %d", lc_index);
+      acl_del_list (acl_index);
+      goto done;
+    }
+  /* The batching is about the hash backend */
+  bitvector_acl_set_enabled (am, lc_index, 0);
+  vec_add1 (acl_vec, acl_index);
+  acl_plugin.set_acl_vec_for_context (lc_index, acl_vec);
+
+  vec_validate (tuples, n_tuples - 1);
+  for (i = 0; i < n_tuples; i++)
+    acl_match_bench_tuple (&tuples[i],
+			   &rules[acl_match_bench_random (&seed, n_rules)],
+			   &seed);
+  vec_validate (actions, n_tuples - 1);
+  vec_validate (batch_actions, n_tuples - 1);
+  vec_validate (acl_pos, n_tuples - 1);
+  vec_validate (acl_match, n_tuples - 1);
+  vec_validate (rule_match, n_tuples - 1);
+  vec_validate (batch_acl_match, n_tuples - 1);
+
+  for (round = 0; round < n_rounds; round++)
+    {
+      t0 = clib_cpu_time_now ();
+      for (i = 0; i < n_tuples; i++)
+	if (!acl_plugin_match_5tuple_inline
+	    (am, lc_index, (fa_5tuple_opaque_t *) & tuples[i], is_ip6,
+	     &actions[i], &acl_pos[i], &acl_match[i], &rule_match[i],
+	     &trace_bitmap))
+	  acl_match[i] = ~0;
+      scalar_clocks += clib_cpu_time_now () - t0;
+
+      /* A frame worth of tuples per call, as a graph node would do */
+      t0 = clib_cpu_time_now ();
+      for (i = 0; i < n_tuples; i += n)
+	{
+	  n = clib_min (VLIB_FRAME_SIZE, n_tuples - i);
+	  acl_plugin_match_5tuple_batch_inline
+	    (am, lc_index, (fa_5tuple_opaque_t *) & tuples[i], n, is_ip6,
+	     &batch_actions[i], &acl_pos[i], &batch_acl_match[i],
+	     &rule_match[i], &trace_bitmap);
+	}
+      batch_clocks += clib_cpu_time_now () - t0;
+    }
+
+  for (j = 0; j < n_tuples; j++)
+    {
+      n_matched += acl_match[j] != ~0;
+      if (acl_match[j] != batch_acl_match[j]
+	  || (acl_match[j] != ~0 && actions[j] != batch_actions[j]))
+	n_mismatch++;
+    }
+
+  vlib_cli_output (vm, "%u %s rules, %u tuples, %u matched, %u rounds",
+		   n_rules, is_ip6 ? "ip6" : "ip4", n_tuples, n_matched,
+		   n_rounds);
+  vlib_cli_output (vm, "  scalar: %.2f clocks/lookup",
+		   (f64) scalar_clocks / n_tuples / n_rounds);
+  vlib_cli_output (vm, "  batch:  %.2f clocks/lookup (%.2fx)",
+		   (f64) batch_clocks / n_tuples / n_rounds,
+		   (f64) scalar_clocks / clib_max (batch_clocks, 1));
+  if (n_mismatch)
+    error = clib_error_return (0, "%u batch results differ from scalar",
+			       n_mismatch);
+
+  acl_plugin.put_lookup_context_index (lc_index);
+  acl_del_list (acl_index);
+
+done:
+  vec_free (rules);
+  vec_free (acl_vec);
+  vec_free (tuples);
+  vec_free (actions);
+  vec_free (batch_actions);
+  vec_free (acl_pos);
+  vec_free (acl_match);
+  vec_free (rule_match);
+  vec_free (batch_acl_match);
+  return error;
+}
+
  /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (aclplugin_set_command, static) = {
     .path = "set acl-plugin",
@@ -4054,7 +4299,7 @@ VLIB_CLI_COMMAND (aclplugin_show_sessions_command, static) = {
 
 VLIB_CLI_COMMAND (aclplugin_show_tables_command, static) = {
     .path = "show acl-plugin tables",
-    .short_help = "show acl-plugin tables [ acl [index N] | applied [ lc_index N ] | mask | hash [verbose N] ]",
+    .short_help = "show acl-plugin tables [ acl [index N] | applied [ lc_index N ] | mask | hash [verbose N] | bitvector [ lc_index N ] ]",
     .function = acl_show_aclplugin_tables_fn,
 };
 
@@ -4075,6 +4320,12 @@ VLIB_CLI_COMMAND (aclplugin_clear_command, static) = {
     .short_help = "clear acl-plugin sessions",
     .function = acl_clear_aclplugin_fn,
 };
+
+VLIB_CLI_COMMAND (aclplugin_test_match_command, static) = {
+    .path = "test acl-plugin match-5tuple",
+    .short_help = "test acl-plugin match-5tuple [rules N] [tuples N] [rounds N] [ip6]",
+    .function = acl_test_aclplugin_match_fn,
+};
 /* *INDENT-ON* */
 
 static clib_error_t *
@@ -4120,6 +4371,8 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
       else if (unformat (input, "reclassify sessions %d",
 			 &reclassify_sessions))
 	am->reclassify_sessions = reclassify_sessions;
+      else if (unformat (input, "use bitvector acl matching"))
+	am->use_bitvector_acl_matching = 1;
 
       else
 	return clib_error_return (0, "unknown input '%U'",
@@ -4163,6 +4416,17 @@ acl_init (vlib_main_t * vm)
 
   acl_setup_fa_nodes ();
 
+  am->expiry_latency_total_counter.name = "idle session expiry latency";
+  am->expiry_latency_total_counter.stat_segment_name =
+    "/acl/sessions/expiry-latency-total-usec";
+  vlib_validate_simple_counter (&am->expiry_latency_total_counter, 0);
+  vlib_zero_simple_counter (&am->expiry_latency_total_counter, 0);
+  am->expiry_latency_max_counter.name = "idle session expiry latency max";
+  am->expiry_latency_max_counter.stat_segment_name =
+    "/acl/sessions/expiry-latency-max-usec";
+  vlib_validate_simple_counter (&am->expiry_latency_max_counter, 0);
+  vlib_zero_simple_counter (&am->expiry_latency_max_counter, 0);
+
   am->acl_mheap_size = 0;	/* auto size when initializing */
   am->hash_lookup_mheap_size = ACL_PLUGIN_HASH_LOOKUP_HEAP_SIZE;
 
@@ -31,6 +31,7 @@
 #include "types.h"
 #include "fa_node.h"
 #include "hash_lookup_types.h"
+#include "bitvector_lookup_types.h"
 #include "lookup_context.h"
 
 #define  ACL_PLUGIN_VERSION_MAJOR 1
@@ -42,6 +43,9 @@
 
 #define SESSION_PURGATORY_TIMEOUT_USEC 10
 
+/* Granularity of the per-worker session idle timer wheels */
+#define SESSION_TIMER_TICK_SEC 0.1
+
 #define ACL_PLUGIN_HASH_LOOKUP_HEAP_SIZE (2 << 25)
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_BUCKETS 65536
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_MEMORY (2 << 25)
@@ -200,6 +204,12 @@ typedef struct {
   /* vec of vectors of all info of all mask types present in ACEs contained in each lc_index */
   hash_applied_mask_info_t **hash_applied_mask_info_vec_by_lc_index;
 
+  /* compiled bit vector classifiers, indexed by lc_index */
+  bitvector_acl_classifier_t *bitvector_classifier_by_lc_index;
+
+  /* Do new lookup contexts use the bit vector classifier instead of hash */
+  int use_bitvector_acl_matching;
+
   /*
    * Classify tables used to grab the packets for the ACL check,
    * and serving as the 5-tuple session tables at the same time
@@ -315,6 +325,10 @@ typedef struct {
   foreach_fa_cleaner_counter
 #undef _
 
+  /* idle timer expiry latency per thread in usec, total and maximum */
+  vlib_simple_counter_main_t expiry_latency_total_counter;
+  vlib_simple_counter_main_t expiry_latency_max_counter;
+
   /* convenience */
   vlib_main_t * vlib_main;
   vnet_main_t * vnet_main;
@@ -377,4 +391,6 @@ extern acl_main_t acl_main;
 
 void *acl_plugin_set_heap();
 
+int acl_fa_expire_idle_sessions (acl_main_t * am, u16 thread_index, u64 now);
+
 #endif
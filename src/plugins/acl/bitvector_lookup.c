@@ -0,0 +1,316 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+/*
+ * Bit vector classifier backend.
+ *
+ * For each of the five fields of the 5-tuple the rule boundaries cut the
+ * key space into elementary intervals. Every interval carries a bit vector
+ * with one bit per applied rule, set if the rule covers the interval, and
+ * an aggregate bit vector with one bit per non-zero word of it.
+ *
+ * A lookup is five binary searches plus an AND of the five aggregate and
+ * then the five rule bit vectors; since bits are in applied entry order,
+ * the first rule left standing is the match. The lookup cost depends on
+ * the number of intervals and rules, not on the number of distinct mask
+ * types, so it stays flat for port ranges and mixed prefix lengths that
+ * make the tuple-space hash probe many tables.
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <acl/acl.h>
+#include <acl/public_inlines.h>
+
+#include "bitvector_lookup.h"
+
+static int
+bitvector_acl_key_cmp (void *a1, void *a2)
+{
+  bitvector_acl_key_t *k1 = a1, *k2 = a2;
+
+  if (k1->hi != k2->hi)
+    return k1->hi < k2->hi ? -1 : 1;
+  if (k1->lo != k2->lo)
+    return k1->lo < k2->lo ? -1 : 1;
+  return 0;
+}
+
+static void
+bitvector_acl_prefix_range (ip46_address_t * addr, u8 prefixlen, int is_ip6,
+			    bitvector_acl_key_t * first,
+			    bitvector_acl_key_t * last)
+{
+  u64 mask_hi, mask_lo;
+  u32 mask;
+
+  if (is_ip6)
+    {
+      mask_hi = prefixlen >= 64 ? ~0ULL :
+	(prefixlen ? ~0ULL << (64 - prefixlen) : 0);
+      mask_lo = prefixlen >= 128 ? ~0ULL :
+	(prefixlen > 64 ? ~0ULL << (128 - prefixlen) : 0);
+      first->hi = clib_net_to_host_u64 (addr->ip6.as_u64[0]) & mask_hi;
+      first->lo = clib_net_to_host_u64 (addr->ip6.as_u64[1]) & mask_lo;
+      last->hi = first->hi | ~mask_hi;
+      last->lo = first->lo | ~mask_lo;
+    }
+  else
+    {
+      mask = prefixlen >= 32 ? ~0U :
+	(prefixlen ? ~0U << (32 - prefixlen) : 0);
+      first->hi = last->hi = 0;
+      first->lo = clib_net_to_host_u32 (addr->ip4.as_u32) & mask;
+      last->lo = (u32) (first->lo | ~mask);
+    }
+}
+
+/* The range of field values a rule matches */
+static void
+bitvector_acl_rule_range (acl_rule_t * r, int field,
+			  bitvector_acl_key_t * first,
+			  bitvector_acl_key_t * last)
+{
+  memset (first, 0, sizeof (*first));
+  memset (last, 0, sizeof (*last));
+
+  switch (field)
+    {
+    case BITVECTOR_ACL_FIELD_SRC:
+      bitvector_acl_prefix_range (&r->src, r->src_prefixlen, r->is_ipv6,
+				  first, last);
+      break;
+    case BITVECTOR_ACL_FIELD_DST:
+      bitvector_acl_prefix_range (&r->dst, r->dst_prefixlen, r->is_ipv6,
+				  first, last);
+      break;
+    case BITVECTOR_ACL_FIELD_PROTO:
+      first->lo = r->proto;
+      last->lo = r->proto ? r->proto : 0xff;
+      break;
+    /* Ports are only looked at if the rule has a protocol */
+    case BITVECTOR_ACL_FIELD_SPORT:
+      first->lo = r->proto ? r->src_port_or_type_first : 0;
+      last->lo = r->proto ? r->src_port_or_type_last : 0xffff;
+      break;
+    case BITVECTOR_ACL_FIELD_DPORT:
+      first->lo = r->proto ? r->dst_port_or_code_first : 0;
+      last->lo = r->proto ? r->dst_port_or_code_last : 0xffff;
+      break;
+    }
+}
+
+static void
+bitvector_acl_build_field (bitvector_acl_table_t * t, int field)
+{
+  bitvector_acl_field_t *bf = &t->fields[field];
+  bitvector_acl_key_t first, last, zero = { 0 }, *points = 0;
+  u32 i, j, n, a, b, n_rules = vec_len (t->rules);
+
+  /* Interval boundaries: where rules start and right after they end */
+  vec_add1 (points, zero);
+  for (i = 0; i < n_rules; i++)
+    {
+      bitvector_acl_rule_range (&t->rules[i], field, &first, &last);
+      vec_add1 (points, first);
+      if (++last.lo == 0 && ++last.hi == 0)
+	continue;		/* ends at the top of the key space */
+      vec_add1 (points, last);
+    }
+  vec_sort_with_function (points, bitvector_acl_key_cmp);
+  for (i = 1, n = 1; i < vec_len (points); i++)
+    if (bitvector_acl_key_cmp (&points[i], &points[n - 1]))
+      points[n++] = points[i];
+  _vec_len (points) = n;
+  bf->starts = points;
+
+  if (!n_rules)
+    return;
+
+  vec_validate (bf->bits, n * t->n_words - 1);
+  vec_validate (bf->summary, n * t->n_summary_words - 1);
+  for (i = 0; i < n_rules; i++)
+    {
+      bitvector_acl_rule_range (&t->rules[i], field, &first, &last);
+      a = bitvector_acl_find_interval (bf->starts, &first);
+      b = bitvector_acl_find_interval (bf->starts, &last);
+      for (j = a; j <= b; j++)
+	bf->bits[j * t->n_words + i / BITS (uword)] |=
+	  (uword) 1 << (i % BITS (uword));
+    }
+  for (j = 0; j < n; j++)
+    for (i = 0; i < t->n_words; i++)
+      if (bf->bits[j * t->n_words + i])
+	bf->summary[j * t->n_summary_words + i / BITS (uword)] |=
+	  (uword) 1 << (i % BITS (uword));
+}
+
+static void
+bitvector_acl_free_table (bitvector_acl_table_t * t)
+{
+  int f;
+
+  for (f = 0; f < BITVECTOR_ACL_N_FIELDS; f++)
+    {
+      vec_free (t->fields[f].starts);
+      vec_free (t->fields[f].bits);
+      vec_free (t->fields[f].summary);
+    }
+  vec_free (t->rules);
+  vec_free (t->applied_entry_index);
+  memset (t, 0, sizeof (*t));
+}
+
+static void
+bitvector_acl_build_table (acl_main_t * am,
+			   applied_hash_ace_entry_t * applied_hash_aces,
+			   int is_ip6, bitvector_acl_table_t * t)
+{
+  applied_hash_ace_entry_t *pae;
+  acl_list_t *a;
+  acl_rule_t *r;
+  u32 i;
+  int f;
+
+  for (i = 0; i < vec_len (applied_hash_aces); i++)
+    {
+      pae = vec_elt_at_index (applied_hash_aces, i);
+      if (pool_is_free_index (am->acls, pae->acl_index))
+	continue;
+      a = pool_elt_at_index (am->acls, pae->acl_index);
+      if (pae->ace_index >= a->count)
+	continue;
+      r = &a->rules[pae->ace_index];
+      if (r->is_ipv6 != is_ip6)
+	continue;
+      vec_add1 (t->rules, *r);
+      vec_add1 (t->applied_entry_index, i);
+    }
+
+  t->n_words = (vec_len (t->rules) + BITS (uword) - 1) / BITS (uword);
+  t->n_summary_words = (t->n_words + BITS (uword) - 1) / BITS (uword);
+  for (f = 0; f < BITVECTOR_ACL_N_FIELDS; f++)
+    bitvector_acl_build_field (t, f);
+}
+
+void
+bitvector_acl_build (acl_main_t * am, u32 lc_index)
+{
+  bitvector_acl_classifier_t *bc;
+  bitvector_acl_table_t new_tables[2];
+  applied_hash_ace_entry_t *applied_hash_aces = 0;
+  void *oldheap = 0;
+  int is_ip6;
+
+  if (lc_index >= vec_len (am->bitvector_classifier_by_lc_index))
+    return;
+  bc = vec_elt_at_index (am->bitvector_classifier_by_lc_index, lc_index);
+  if (!bc->is_enabled)
+    return;
+
+  if (am->hash_lookup_mheap)
+    oldheap = clib_mem_set_heap (am->hash_lookup_mheap);
+  if (lc_index < vec_len (am->hash_entry_vec_by_lc_index))
+    applied_hash_aces = am->hash_entry_vec_by_lc_index[lc_index];
+
+  /* Build aside, so the old tables are intact until swapped */
+  memset (new_tables, 0, sizeof (new_tables));
+  for (is_ip6 = 0; is_ip6 < 2; is_ip6++)
+    bitvector_acl_build_table (am, applied_hash_aces, is_ip6,
+			       &new_tables[is_ip6]);
+  for (is_ip6 = 0; is_ip6 < 2; is_ip6++)
+    {
+      bitvector_acl_free_table (&bc->tables[is_ip6]);
+      bc->tables[is_ip6] = new_tables[is_ip6];
+    }
+
+  if (oldheap)
+    clib_mem_set_heap (oldheap);
+}
+
+void
+bitvector_acl_set_enabled (acl_main_t * am, u32 lc_index, int is_enabled)
+{
+  bitvector_acl_classifier_t *bc;
+  void *oldheap = acl_plugin_set_heap ();
+
+  vec_validate (am->bitvector_classifier_by_lc_index, lc_index);
+  clib_mem_set_heap (oldheap);
+  bc = vec_elt_at_index (am->bitvector_classifier_by_lc_index, lc_index);
+
+  if (is_enabled)
+    {
+      bc->is_enabled = 1;
+      bitvector_acl_build (am, lc_index);
+      return;
+    }
+
+  /* Fall back to the hash backend before freeing the tables */
+  bc->is_enabled = 0;
+  if (am->hash_lookup_mheap)
+    oldheap = clib_mem_set_heap (am->hash_lookup_mheap);
+  bitvector_acl_free_table (&bc->tables[0]);
+  bitvector_acl_free_table (&bc->tables[1]);
+  if (am->hash_lookup_mheap)
+    clib_mem_set_heap (oldheap);
+}
+
+void
+acl_plugin_show_tables_bitvector (u32 lc_index)
+{
+  acl_main_t *am = &acl_main;
+  vlib_main_t *vm = am->vlib_main;
+  bitvector_acl_classifier_t *bc;
+  bitvector_acl_table_t *t;
+  bitvector_acl_field_t *bf;
+  u32 lci, is_ip6;
+  uword bytes;
+  int f;
+  static char *field_names[] = {
+#define _(N, n) #n,
+    foreach_bitvector_acl_field
+#undef _
+  };
+
+  vlib_cli_output (vm, "Bit vector classifiers for lookup contexts");
+  for (lci = 0; lci < vec_len (am->bitvector_classifier_by_lc_index); lci++)
+    {
+      if ((lc_index != ~0) && (lc_index != lci))
+	continue;
+      bc = vec_elt_at_index (am->bitvector_classifier_by_lc_index, lci);
+      if (!bc->is_enabled)
+	continue;
+      vlib_cli_output (vm, "lc_index %d:", lci);
+      for (is_ip6 = 0; is_ip6 < 2; is_ip6++)
+	{
+	  t = &bc->tables[is_ip6];
+	  bytes = vec_bytes (t->rules) + vec_bytes (t->applied_entry_index);
+	  for (f = 0; f < BITVECTOR_ACL_N_FIELDS; f++)
+	    {
+	      bf = &t->fields[f];
+	      bytes += vec_bytes (bf->starts) + vec_bytes (bf->bits)
+		+ vec_bytes (bf->summary);
+	    }
+	  vlib_cli_output (vm, "  %s: %d rules, %d words per interval, %U",
+			   is_ip6 ? "ip6" : "ip4", vec_len (t->rules),
+			   t->n_words, format_memory_size, bytes);
+	  for (f = 0; f < BITVECTOR_ACL_N_FIELDS; f++)
+	    vlib_cli_output (vm, "    %s: %d intervals", field_names[f],
+			     vec_len (t->fields[f].starts));
+	}
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_BITVECTOR_LOOKUP_H_
+#define _ACL_BITVECTOR_LOOKUP_H_
+
+#include "acl.h"
+
+/*
+ * Recompile the classifier of a lookup context from its applied
+ * hash ACE entries. A no-op if the context does not use it.
+ */
+void bitvector_acl_build(acl_main_t *am, u32 lc_index);
+
+/* Select the bit vector (1) or the hash (0) backend for a context */
+void bitvector_acl_set_enabled(acl_main_t *am, u32 lc_index, int is_enabled);
+
+void acl_plugin_show_tables_bitvector (u32 lc_index);
+
+#endif
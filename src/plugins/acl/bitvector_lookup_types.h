@@ -0,0 +1,74 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_BITVECTOR_LOOKUP_TYPES_H_
+#define _ACL_BITVECTOR_LOOKUP_TYPES_H_
+
+#include "types.h"
+
+/*
+ * The fields a 5-tuple is classified on. Each of them is cut into
+ * elementary intervals by the rule boundaries, and each interval has
+ * a bit vector of the rules which cover it.
+ */
+#define foreach_bitvector_acl_field \
+  _(SRC, src)                       \
+  _(DST, dst)                       \
+  _(PROTO, proto)                   \
+  _(SPORT, sport)                   \
+  _(DPORT, dport)
+
+typedef enum {
+#define _(N, n) BITVECTOR_ACL_FIELD_##N,
+  foreach_bitvector_acl_field
+#undef _
+  BITVECTOR_ACL_N_FIELDS,
+} bitvector_acl_field_id_t;
+
+/* Field value in host byte order; only IPv6 addresses use "hi" */
+typedef struct {
+  u64 hi;
+  u64 lo;
+} bitvector_acl_key_t;
+
+typedef struct {
+  /* sorted first values of the elementary intervals, starts[0] is 0 */
+  bitvector_acl_key_t *starts;
+  /* n_words bits per interval, bit N set if rule N covers the interval */
+  uword *bits;
+  /* n_summary_words per interval, bit N set if bits word N is non-zero */
+  uword *summary;
+} bitvector_acl_field_t;
+
+typedef struct {
+  bitvector_acl_field_t fields[BITVECTOR_ACL_N_FIELDS];
+  /* copies of the rules of this address family, in applied order */
+  acl_rule_t *rules;
+  /* index of the applied hash ACE entry for each of the rules */
+  u32 *applied_entry_index;
+  u32 n_words;
+  u32 n_summary_words;
+} bitvector_acl_table_t;
+
+typedef struct {
+  /* per address family tables, indexed by is_ip6 */
+  bitvector_acl_table_t tables[2];
+  /* whether the lookup context uses this backend */
+  u8 is_enabled;
+} bitvector_acl_classifier_t;
+
+#endif
@@ -94,6 +94,10 @@ acl_fa_node_fn (vlib_main_t * vm,
 
   error_node = vlib_node_get_runtime (vm, acl_fa_node->index);
 
+  /* expire a bounded batch of idle sessions whenever a timer tick is due */
+  if (PREDICT_FALSE (acl_fa_session_timers_due (am, pw, now)))
+    acl_fa_expire_idle_sessions (am, thread_index, now);
+
   vlib_get_buffers (vm, from, bufs, frame->n_vectors);
   /* set the initial values for the current buffer the next pointers */
   b = bufs;
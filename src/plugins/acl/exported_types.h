@@ -74,6 +74,21 @@ typedef int (*acl_plugin_match_5tuple_fn_t) (u32 lc_index,
                                            u32 * r_rule_match_p,
                                            u32 * trace_bitmap);
 
+/*
+ * Match n_tuples 5-tuples within one lookup context. The per-tuple
+ * results are stored at the same index of the r_* arrays; on a miss
+ * r_acl_match_p[i] is ~0. Returns the number of tuples that matched.
+ */
+
+typedef u32 (*acl_plugin_match_5tuple_batch_fn_t) (u32 lc_index,
+                                           fa_5tuple_opaque_t * pkt_5tuples,
+                                           u32 n_tuples, int is_ip6,
+                                           u8 * r_action,
+                                           u32 * r_acl_pos_p,
+                                           u32 * r_acl_match_p,
+                                           u32 * r_rule_match_p,
+                                           u32 * trace_bitmap);
+
 
 #define foreach_acl_plugin_exported_method_name \
 _(acl_exists)                          \
@@ -82,7 +97,8 @@ _(get_lookup_context_index)            \
 _(put_lookup_context_index)            \
 _(set_acl_vec_for_context)             \
 _(fill_5tuple)                         \
-_(match_5tuple)                        
+_(match_5tuple)                        \
+_(match_5tuple_batch)
 
 #define _(name) acl_plugin_ ## name ## _fn_t name;
 typedef struct {
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <vppinfra/bihash_16_8.h>
 #include <vppinfra/bihash_40_8.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 
 #include <plugins/acl/exported_types.h>
 
@@ -94,7 +95,8 @@ typedef struct {
   u8 link_list_id;        /* +1 bytes = 17 */
   u8 deleted;             /* +1 bytes = 18 */
   u8 is_ip6;              /* +1 bytes = 19 */
-  u8 reserved1[5];        /* +5 bytes = 24 */
+  u8 reserved1[1];        /* +1 bytes = 20 */
+  u32 timer_handle;       /* +4 bytes = 24 */
   u64 reserved2[5];       /* +5*8 bytes = 64 */
 } fa_session_t;
 
@@ -155,8 +157,18 @@ typedef struct {
   u64 *fa_session_adds_by_sw_if_index;
   /* sessions deleted due to epoch change */
   u64 *fa_session_epoch_change_by_sw_if_index;
-  /* Vector of expired connections retrieved from lists */
+  /* Vector of expired connections retrieved from lists and timers */
   u32 *expired;
+  /* idle timers of the sessions in the timeout lists */
+  tw_timer_wheel_1t_3w_1024sl_ov_t session_timer_wheel;
+  /* sessions whose timers fired, checked a bounded batch at a time */
+  u32 *expired_timers;
+  u32 expired_timers_head;
+  /* Counter of sessions whose idle timer fired after their timeout */
+  u64 cnt_timer_expired_sessions;
+  /* Total and worst delay from the timeout to the timer firing, in clocks */
+  u64 timer_expiry_latency_total;
+  u64 timer_expiry_latency_max;
   /* the earliest next expiry time */
   u64 next_expiry_time;
   /* if not zero, look at all the elements until their enqueue timestamp is after below one */
@@ -31,6 +31,7 @@
 
 #include "hash_lookup.h"
 #include "hash_lookup_private.h"
+#include "bitvector_lookup.h"
 
 
 always_inline applied_hash_ace_entry_t **get_applied_hash_aces(acl_main_t *am, u32 lc_index)
@@ -428,6 +429,7 @@ hash_acl_apply(acl_main_t *am, u32 lc_index, int acl_index, u32 acl_position)
     activate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, new_index);
   }
   remake_hash_applied_mask_info_vec(am, applied_hash_aces, lc_index);
+  bitvector_acl_build(am, lc_index);
 done:
   clib_mem_set_heap (oldheap);
 }
@@ -618,6 +620,7 @@ hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index)
   _vec_len((*applied_hash_aces)) -= vec_len(ha->rules);
 
   remake_hash_applied_mask_info_vec(am, applied_hash_aces, lc_index);
+  bitvector_acl_build(am, lc_index);
 
   clib_mem_set_heap (oldheap);
 }
@@ -18,6 +18,7 @@
 #include <vlib/unix/plugin.h>
 #include <plugins/acl/public_inlines.h>
 #include "hash_lookup.h"
+#include "bitvector_lookup.h"
 #include "elog_acl_trace.h"
 
 /* check if a given ACL exists */
@@ -110,6 +111,7 @@ static int acl_plugin_get_lookup_context_index (u32 acl_user_id, u32 val1, u32 v
 
   u32 new_context_id = acontext - am->acl_lookup_contexts;
   vec_add1(am->acl_users[acl_user_id].lookup_contexts, new_context_id);
+  bitvector_acl_set_enabled(am, new_context_id, am->use_bitvector_acl_matching);
 
   clib_mem_set_heap (oldheap);
   return new_context_id;
@@ -200,6 +202,7 @@ static void acl_plugin_put_lookup_context_index (u32 lc_index)
   vec_del1(am->acl_users[acontext->context_user_id].lookup_contexts, index);
   unapply_acl_vec(lc_index, acontext->acl_indices);
   unlock_acl_vec(lc_index, acontext->acl_indices);
+  bitvector_acl_set_enabled(am, lc_index, 0);
   vec_free(acontext->acl_indices);
   pool_put(am->acl_lookup_contexts, acontext);
   clib_mem_set_heap (oldheap);
@@ -301,6 +304,18 @@ static int acl_plugin_match_5tuple (u32 lc_index,
   return acl_plugin_match_5tuple_inline (&acl_main, lc_index, pkt_5tuple, is_ip6, r_action, r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
 }
 
+static u32 acl_plugin_match_5tuple_batch (u32 lc_index,
+                                           fa_5tuple_opaque_t * pkt_5tuples,
+                                           u32 n_tuples, int is_ip6,
+                                           u8 * r_action,
+                                           u32 * r_acl_pos_p,
+                                           u32 * r_acl_match_p,
+                                           u32 * r_rule_match_p,
+                                           u32 * trace_bitmap)
+{
+  return acl_plugin_match_5tuple_batch_inline (&acl_main, lc_index, pkt_5tuples, n_tuples, is_ip6, r_action, r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
+}
+
 
 void
 acl_plugin_show_lookup_user (u32 user_index)
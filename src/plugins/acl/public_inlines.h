@@ -634,6 +634,112 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
   return curr_match_index;
 }
 
+/*
+ * Up to this many tuples go through the hash lookup stages together,
+ * so the bucket and data fetches of one overlap with the work on others.
+ */
+#define ACL_PLUGIN_MATCH_BATCH_SIZE 16
+
+/*
+ * Batch version of multi_acl_match_get_applied_ace_index, for tuples of
+ * the same lookup context. For each mask type it masks and hashes the
+ * keys and prefetches the buckets of all tuples still in play, then
+ * prefetches the data, and only then searches.
+ */
+always_inline void
+multi_acl_match_get_applied_ace_index_batch (acl_main_t * am, int is_ip6,
+					     fa_5tuple_t ** matches,
+					     u32 n_matches, u32 * match_index)
+{
+  clib_bihash_kv_48_8_t kv[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  clib_bihash_kv_48_8_t result;
+  hash_acl_lookup_value_t *result_val =
+    (hash_acl_lookup_value_t *) & result.value;
+  u64 hash[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u32 todo[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u64 *pmatch, *pmask, *pkey;
+  int mask_type_index, order_index;
+  u32 i, j, n_todo;
+
+  ASSERT (n_matches <= ACL_PLUGIN_MATCH_BATCH_SIZE);
+
+  u32 lc_index = matches[0]->pkt.lc_index;
+  applied_hash_ace_entry_t **applied_hash_aces =
+    vec_elt_at_index (am->hash_entry_vec_by_lc_index, lc_index);
+
+  hash_applied_mask_info_t **hash_applied_mask_info_vec =
+    vec_elt_at_index (am->hash_applied_mask_info_vec_by_lc_index, lc_index);
+
+  hash_applied_mask_info_t *minfo;
+
+  for (i = 0; i < n_matches; i++)
+    match_index[i] = (~0 - 1);
+
+  for (order_index = 0; order_index < vec_len ((*hash_applied_mask_info_vec));
+       order_index++)
+    {
+      minfo = vec_elt_at_index ((*hash_applied_mask_info_vec), order_index);
+
+      /* Skip the tuples which already have a better candidate */
+      n_todo = 0;
+      for (i = 0; i < n_matches; i++)
+	if (minfo->first_rule_index <= match_index[i])
+	  todo[n_todo++] = i;
+      if (n_todo == 0)
+	break;
+
+      mask_type_index = minfo->mask_type_index;
+      ace_mask_type_entry_t *mte =
+	vec_elt_at_index (am->ace_mask_type_pool, mask_type_index);
+
+      /* Stage 1: mask, hash and prefetch the bucket */
+      for (j = 0; j < n_todo; j++)
+	{
+	  pmatch = (u64 *) matches[todo[j]];
+	  pmask = (u64 *) & mte->mask;
+	  pkey = (u64 *) kv[j].key;
+
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+
+	  ((fa_5tuple_t *) kv[j].key)->pkt.mask_type_index_lsb =
+	    mask_type_index;
+	  hash[j] = clib_bihash_hash_48_8 (&kv[j]);
+	  clib_bihash_prefetch_bucket_48_8 (&am->acl_lookup_hash, hash[j]);
+	}
+
+      /* Stage 2: prefetch the key/value page */
+      for (j = 0; j < n_todo; j++)
+	clib_bihash_prefetch_data_48_8 (&am->acl_lookup_hash, hash[j]);
+
+      /* Stage 3: search, and check the collision vector on a hit */
+      for (j = 0; j < n_todo; j++)
+	{
+	  if (clib_bihash_search_inline_2_with_hash_48_8
+	      (&am->acl_lookup_hash, hash[j], &kv[j], &result))
+	    continue;
+
+	  u32 *curr_match_index = &match_index[todo[j]];
+	  applied_hash_ace_entry_t *pae =
+	    vec_elt_at_index ((*applied_hash_aces),
+			      result_val->applied_entry_index);
+	  collision_match_rule_t *crs = pae->colliding_rules;
+	  for (i = 0; i < vec_len (crs); i++)
+	    {
+	      if (crs[i].applied_entry_index >= *curr_match_index)
+		continue;
+	      if (single_rule_match_5tuple (&crs[i].rule, is_ip6,
+					    matches[todo[j]]))
+		*curr_match_index = crs[i].applied_entry_index;
+	    }
+	}
+    }
+}
+
 always_inline int
 hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5tuple,
                        int is_ip6, u8 *action, u32 *acl_pos_p, u32 * acl_match_p,
@@ -654,6 +760,154 @@ hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5
   return 0;
 }
 
+/*
+ * Bit vector classifier lookup, see bitvector_lookup.c
+ */
+always_inline u32
+bitvector_acl_find_interval (bitvector_acl_key_t * starts,
+			     bitvector_acl_key_t * key)
+{
+  u32 lo = 0, hi = vec_len (starts) - 1, mid;
+
+  /* starts[0] is 0, so there always is an interval */
+  while (lo < hi)
+    {
+      mid = (lo + hi + 1) / 2;
+      if (starts[mid].hi < key->hi
+	  || (starts[mid].hi == key->hi && starts[mid].lo <= key->lo))
+	lo = mid;
+      else
+	hi = mid - 1;
+    }
+  return lo;
+}
+
+always_inline void
+bitvector_acl_5tuple_key (fa_5tuple_t * match, int is_ip6, int field,
+			  bitvector_acl_key_t * key)
+{
+  ip6_address_t *a6;
+
+  key->hi = 0;
+  switch (field)
+    {
+    case BITVECTOR_ACL_FIELD_SRC:
+    case BITVECTOR_ACL_FIELD_DST:
+      if (is_ip6)
+	{
+	  a6 = &match->ip6_addr[field == BITVECTOR_ACL_FIELD_DST];
+	  key->hi = clib_net_to_host_u64 (a6->as_u64[0]);
+	  key->lo = clib_net_to_host_u64 (a6->as_u64[1]);
+	}
+      else
+	key->lo = clib_net_to_host_u32
+	  (match->ip4_addr[field == BITVECTOR_ACL_FIELD_DST].as_u32);
+      break;
+    case BITVECTOR_ACL_FIELD_PROTO:
+      key->lo = match->l4.proto;
+      break;
+    case BITVECTOR_ACL_FIELD_SPORT:
+      key->lo = match->l4.port[0];
+      break;
+    default:
+      key->lo = match->l4.port[1];
+      break;
+    }
+}
+
+/* What the intervals do not encode: l4 validity and tcp flags */
+always_inline int
+bitvector_acl_rule_match_l4 (acl_rule_t * r, fa_5tuple_t * match)
+{
+  if (!r->proto)
+    return 1;
+  if (PREDICT_FALSE (!match->pkt.l4_valid))
+    return 0;
+  /* as in the hash backend, a flags mask needs the flags of the packet */
+  if (r->proto == IP_PROTOCOL_TCP && r->tcp_flags_mask
+      && (!match->pkt.tcp_flags_valid
+	  || ((match->pkt.tcp_flags & r->tcp_flags_mask) !=
+	      r->tcp_flags_value)))
+    return 0;
+  return 1;
+}
+
+always_inline u32
+bitvector_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6,
+					   fa_5tuple_t * match)
+{
+  bitvector_acl_classifier_t *bc =
+    vec_elt_at_index (am->bitvector_classifier_by_lc_index,
+		      match->pkt.lc_index);
+  bitvector_acl_table_t *t = &bc->tables[is_ip6];
+  uword *bits[BITVECTOR_ACL_N_FIELDS], *summary[BITVECTOR_ACL_N_FIELDS];
+  uword s, m;
+  bitvector_acl_key_t key;
+  u32 f, k, w, i, rule;
+
+  for (f = 0; f < BITVECTOR_ACL_N_FIELDS; f++)
+    {
+      bitvector_acl_5tuple_key (match, is_ip6, f, &key);
+      i = bitvector_acl_find_interval (t->fields[f].starts, &key);
+      bits[f] = t->fields[f].bits + i * t->n_words;
+      summary[f] = t->fields[f].summary + i * t->n_summary_words;
+    }
+
+  /* Only visit the words which are non-zero in all five fields */
+  for (k = 0; k < t->n_summary_words; k++)
+    {
+      s = summary[0][k] & summary[1][k] & summary[2][k] & summary[3][k]
+	& summary[4][k];
+      while (s)
+	{
+	  w = k * BITS (uword) + count_trailing_zeros (s);
+	  m = bits[0][w] & bits[1][w] & bits[2][w] & bits[3][w] & bits[4][w];
+	  while (m)
+	    {
+	      rule = w * BITS (uword) + count_trailing_zeros (m);
+	      if (bitvector_acl_rule_match_l4 (&t->rules[rule], match))
+		return t->applied_entry_index[rule];
+	      m &= m - 1;
+	    }
+	  s &= s - 1;
+	}
+    }
+  return ~0;
+}
+
+always_inline int
+bitvector_acl_lc_is_enabled (acl_main_t * am, u32 lc_index)
+{
+  return (lc_index < vec_len (am->bitvector_classifier_by_lc_index)
+	  && am->bitvector_classifier_by_lc_index[lc_index].is_enabled);
+}
+
+always_inline int
+bitvector_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index,
+				  fa_5tuple_t * pkt_5tuple, int is_ip6,
+				  u8 * action, u32 * acl_pos_p,
+				  u32 * acl_match_p, u32 * rule_match_p,
+				  u32 * trace_bitmap)
+{
+  acl_main_t *am = p_acl_main;
+  applied_hash_ace_entry_t **applied_hash_aces =
+    vec_elt_at_index (am->hash_entry_vec_by_lc_index, lc_index);
+  u32 match_index =
+    bitvector_acl_match_get_applied_ace_index (am, is_ip6, pkt_5tuple);
+  applied_hash_ace_entry_t *pae;
+
+  if (match_index < vec_len ((*applied_hash_aces)))
+    {
+      pae = vec_elt_at_index ((*applied_hash_aces), match_index);
+      pae->hitcount++;
+      *acl_pos_p = pae->acl_position;
+      *acl_match_p = pae->acl_index;
+      *rule_match_p = pae->ace_index;
+      *action = pae->action;
+      return 1;
+    }
+  return 0;
+}
 
 
 always_inline int
@@ -678,6 +932,9 @@ acl_plugin_match_5tuple_inline (void *p_acl_main, u32 lc_index,
        */
       return linear_multi_acl_match_5tuple(p_acl_main, lc_index, pkt_5tuple_internal, is_ip6, r_action,
                                  r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
+    } else if (bitvector_acl_lc_is_enabled(am, lc_index)) {
+      return bitvector_multi_acl_match_5tuple(p_acl_main, lc_index, pkt_5tuple_internal, is_ip6, r_action,
+                                 r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
     } else {
       return hash_multi_acl_match_5tuple(p_acl_main, lc_index, pkt_5tuple_internal, is_ip6, r_action,
                                  r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
@@ -689,5 +946,79 @@ acl_plugin_match_5tuple_inline (void *p_acl_main, u32 lc_index,
 }
 
 
+/*
+ * Batch version of acl_plugin_match_5tuple_inline. Tuples the hash
+ * backend can take are collected and looked up together, the others
+ * (non-first fragments, other backends) are matched one by one.
+ */
+always_inline u32
+acl_plugin_match_5tuple_batch_inline (void *p_acl_main, u32 lc_index,
+				      fa_5tuple_opaque_t * pkt_5tuples,
+				      u32 n_tuples, int is_ip6,
+				      u8 * r_action, u32 * r_acl_pos_p,
+				      u32 * r_acl_match_p,
+				      u32 * r_rule_match_p,
+				      u32 * trace_bitmap)
+{
+  acl_main_t *am = p_acl_main;
+  fa_5tuple_t *batch[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u32 batch_index[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u32 match_index[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  applied_hash_ace_entry_t **applied_hash_aces, *pae;
+  fa_5tuple_t *pkt_5tuple_internal;
+  u32 i, j, n_batch, n_matched = 0;
+  int use_hash = am->use_hash_acl_matching
+    && !bitvector_acl_lc_is_enabled (am, lc_index);
+
+  for (i = 0; i < n_tuples; i++)
+    {
+      pkt_5tuple_internal = (fa_5tuple_t *) & pkt_5tuples[i];
+      pkt_5tuple_internal->pkt.lc_index = lc_index;
+      r_acl_match_p[i] = ~0;
+    }
+
+  i = 0;
+  while (i < n_tuples)
+    {
+      n_batch = 0;
+      for (; i < n_tuples && n_batch < ACL_PLUGIN_MATCH_BATCH_SIZE; i++)
+	{
+	  pkt_5tuple_internal = (fa_5tuple_t *) & pkt_5tuples[i];
+	  if (use_hash && !pkt_5tuple_internal->pkt.is_nonfirst_fragment)
+	    {
+	      batch[n_batch] = pkt_5tuple_internal;
+	      batch_index[n_batch++] = i;
+	    }
+	  else if (acl_plugin_match_5tuple_inline
+		   (p_acl_main, lc_index, &pkt_5tuples[i], is_ip6,
+		    &r_action[i], &r_acl_pos_p[i], &r_acl_match_p[i],
+		    &r_rule_match_p[i], trace_bitmap))
+	    n_matched++;
+	  else
+	    r_acl_match_p[i] = ~0;
+	}
+      if (n_batch == 0)
+	continue;
+
+      multi_acl_match_get_applied_ace_index_batch (am, is_ip6, batch,
+						   n_batch, match_index);
+      applied_hash_aces =
+	vec_elt_at_index (am->hash_entry_vec_by_lc_index, lc_index);
+      for (j = 0; j < n_batch; j++)
+	{
+	  if (match_index[j] >= vec_len ((*applied_hash_aces)))
+	    continue;
+	  pae = vec_elt_at_index ((*applied_hash_aces), match_index[j]);
+	  pae->hitcount++;
+	  r_acl_pos_p[batch_index[j]] = pae->acl_position;
+	  r_acl_match_p[batch_index[j]] = pae->acl_index;
+	  r_rule_match_p[batch_index[j]] = pae->ace_index;
+	  r_action[batch_index[j]] = pae->action;
+	  n_matched++;
+	}
+    }
+  return n_matched;
+}
+
 
 #endif
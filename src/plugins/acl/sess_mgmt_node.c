@@ -33,22 +33,6 @@
 // #include <vppinfra/bihash_40_8.h>
 
 
-static u64
-fa_session_get_shortest_timeout (acl_main_t * am)
-{
-  int timeout_type;
-  u64 timeout = ~0LL;
-  for (timeout_type = ACL_TIMEOUT_UDP_IDLE;
-       timeout_type < ACL_N_USER_TIMEOUTS; timeout_type++)
-    {
-      if (timeout > am->session_timeout_sec[timeout_type])
-	{
-	  timeout = am->session_timeout_sec[timeout_type];
-	}
-    }
-  return timeout;
-}
-
 static u8 *
 format_ip6_session_bihash_kv (u8 * s, va_list * args)
 {
@@ -108,6 +92,15 @@ acl_fa_verify_init_sessions (acl_main_t * am)
 	   */
 	  pool_init_fixed (pw->fa_sessions_pool,
 			   am->fa_conn_table_max_entries);
+
+	  /* ... the idle timer wheel, expiring a bounded batch per run */
+	  void *oldheap = clib_mem_set_heap (am->acl_mheap);
+	  tw_timer_wheel_init_1t_3w_1024sl_ov (&pw->session_timer_wheel, 0,
+					       SESSION_TIMER_TICK_SEC,
+					       am->fa_max_deleted_sessions_per_interval);
+	  pw->session_timer_wheel.last_run_time =
+	    acl_fa_session_timer_now (am, clib_cpu_time_now ());
+	  clib_mem_set_heap (oldheap);
 	}
 
       /* ... and the interface session hash table */
@@ -130,24 +123,28 @@ acl_fa_verify_init_sessions (acl_main_t * am)
 }
 
 
-/*
- * Get the timeout of the session in a list since its enqueue time.
- */
+/* *INDENT-OFF* */
+#define foreach_acl_fa_worker_cleaner_error \
+_(TIMER_EXPIRED, "idle sessions expired by timer")  \
+/* end  of errors */
 
-static u64
-fa_session_get_list_timeout (acl_main_t * am, fa_session_t * sess)
+typedef enum
 {
-  u64 timeout = am->vlib_main->clib_time.clocks_per_second / 1000;
-  /*
-   * we have the shortest possible timeout type in all the lists
-   * (see README-multicore for the rationale)
-   */
-  if (sess->link_list_id == ACL_TIMEOUT_PURGATORY)
-    timeout = fa_session_get_timeout (am, sess);
-  else
-    timeout *= fa_session_get_shortest_timeout (am);
-  return timeout;
-}
+#define _(sym,str) ACL_FA_WORKER_CLEANER_ERROR_##sym,
+  foreach_acl_fa_worker_cleaner_error
+#undef _
+    ACL_FA_WORKER_CLEANER_N_ERROR,
+} acl_fa_worker_cleaner_error_t;
+
+static char *acl_fa_worker_cleaner_error_strings[] = {
+#define _(sym,string) string,
+  foreach_acl_fa_worker_cleaner_error
+#undef _
+};
+
+/* *INDENT-ON* */
+
+static vlib_node_registration_t acl_fa_worker_session_cleaner_process_node;
 
 static u64
 acl_fa_get_list_head_expiry_time (acl_main_t * am,
@@ -164,12 +161,109 @@ acl_fa_conn_time_to_check (acl_main_t * am, acl_fa_per_worker_data_t * pw,
   if (session_index == FA_SESSION_BOGUS_INDEX)
     return 0;
   fa_session_t *sess = get_session_ptr (am, thread_index, session_index);
-  u64 timeout_time =
-    sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
+  /* the sessions in the timeout lists are checked when their timers fire */
+  if (sess->link_list_id != ACL_TIMEOUT_PURGATORY)
+    return (sess->link_enqueue_time <= pw->swipe_end_time);
+  u64 timeout_time = sess->link_enqueue_time + fa_session_get_timeout (am,
+								       sess);
   return (timeout_time < now)
     || (sess->link_enqueue_time <= pw->swipe_end_time);
 }
 
+/*
+ * Collect the sessions whose idle timers have fired, and take up to
+ * fa_max_deleted_sessions_per_interval of them off their lists for
+ * checking. The wheel hands out all the timers of a slot at once,
+ * so the rest wait in expired_timers for the next run. Also account
+ * for how late past the idle timeout the sessions get checked.
+ */
+static void
+acl_fa_collect_timer_expired_sessions (acl_main_t * am, u16 thread_index,
+				       u64 now)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  fa_full_session_id_t fsid;
+  u32 *expired_timers;
+  u64 latency, latency_total = 0;
+  u32 i, n_timeouts = 0;
+  int n_expired = 0;
+
+  fsid.thread_index = thread_index;
+  if (acl_fa_session_timer_now (am, now) >=
+      pw->session_timer_wheel.next_run_time)
+    {
+      void *oldheap = clib_mem_set_heap (am->acl_mheap);
+      expired_timers =
+	tw_timer_expire_timers_1t_3w_1024sl_ov (&pw->session_timer_wheel,
+						acl_fa_session_timer_now (am,
+									  now));
+      clib_mem_set_heap (oldheap);
+      for (i = 0; i < vec_len (expired_timers); i++)
+	{
+	  fa_session_t *sess =
+	    get_session_ptr (am, thread_index, expired_timers[i]);
+	  /* the timer is gone, the session waits on its list to be checked */
+	  sess->timer_handle = ~0;
+	  vec_add1 (pw->expired_timers, expired_timers[i]);
+	}
+    }
+
+  while (pw->expired_timers_head < vec_len (pw->expired_timers)
+	 && n_expired < am->fa_max_deleted_sessions_per_interval)
+    {
+      fsid.session_index = pw->expired_timers[pw->expired_timers_head++];
+      if (pool_is_free_index (pw->fa_sessions_pool, fsid.session_index))
+	continue;
+      fa_session_t *sess =
+	get_session_ptr (am, thread_index, fsid.session_index);
+      /*
+       * Skip the stale entries: the session has been requeued with
+       * a new timer, or moved to the purgatory, since the timer fired.
+       */
+      if ((~0 != sess->timer_handle)
+	  || (sess->link_list_id == ACL_TIMEOUT_PURGATORY))
+	continue;
+      u64 sess_timeout_time =
+	sess->last_active_time + fa_session_get_timeout (am, sess);
+      if (now >= sess_timeout_time)
+	{
+	  latency = now - sess_timeout_time;
+	  latency_total += latency;
+	  if (latency > pw->timer_expiry_latency_max)
+	    pw->timer_expiry_latency_max = latency;
+	  n_timeouts++;
+	}
+      acl_fa_conn_list_delete_session (am, fsid, now);
+      vec_add1 (pw->expired, fsid.session_index);
+      n_expired++;
+    }
+  if (pw->expired_timers_head == vec_len (pw->expired_timers))
+    {
+      pw->expired_timers_head = 0;
+      if (pw->expired_timers)
+	_vec_len (pw->expired_timers) = 0;
+    }
+
+  if (n_timeouts)
+    {
+      vlib_main_t *vm = vlib_get_main ();
+      f64 usec_per_clock = 1e6 / vm->clib_time.clocks_per_second;
+      pw->cnt_timer_expired_sessions += n_timeouts;
+      pw->timer_expiry_latency_total += latency_total;
+      vlib_node_increment_counter (vm,
+				   acl_fa_worker_session_cleaner_process_node.
+				   index,
+				   ACL_FA_WORKER_CLEANER_ERROR_TIMER_EXPIRED,
+				   n_timeouts);
+      /* the total is a counter, the maximum a gauge */
+      vlib_increment_simple_counter (&am->expiry_latency_total_counter,
+				     thread_index, 0,
+				     latency_total * usec_per_clock);
+      am->expiry_latency_max_counter.counters[thread_index][0] =
+	pw->timer_expiry_latency_max * usec_per_clock;
+    }
+}
+
 /*
  * see if there are sessions ready to be checked,
  * do the maintenance (requeue or delete), and
@@ -209,6 +303,8 @@ acl_fa_check_idle_sessions (acl_main_t * am, u16 thread_index, u64 now)
 	    acl_fa_conn_list_delete_session (am, fsid, now);
 	  }
       }
+    if (acl_fa_session_timers_due (am, pw, now))
+      acl_fa_collect_timer_expired_sessions (am, thread_index, now);
     for (tt = 0; tt < ACL_N_TIMEOUTS; tt++)
       {
 	u32 session_index = pw->fa_conn_list_head[tt];
@@ -311,6 +407,22 @@ acl_fa_check_idle_sessions (acl_main_t * am, u16 thread_index, u64 now)
   return (total_expired);
 }
 
+/*
+ * Run the idle timers of this thread from the data path, so the expiry
+ * work is spread over the dispatches rather than done in bursts
+ * by the cleaner interrupts. Clearing the interfaces is left to
+ * the cleaner, which owns the swipe.
+ */
+int
+acl_fa_expire_idle_sessions (acl_main_t * am, u16 thread_index, u64 now)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+
+  if (pw->clear_in_process)
+    return 0;
+  return acl_fa_check_idle_sessions (am, thread_index, now);
+}
+
 /*
  * This process ensures the connection cleanup happens every so often
  * even in absence of traffic, as well as provides general orchestration
@@ -340,7 +452,6 @@ static char *acl_fa_cleaner_error_strings[] = {
 /* *INDENT-ON* */
 
 static vlib_node_registration_t acl_fa_session_cleaner_process_node;
-static vlib_node_registration_t acl_fa_worker_session_cleaner_process_node;
 
 static void
 send_one_worker_interrupt (vlib_main_t * vm, acl_main_t * am,
@@ -894,6 +1005,8 @@ VLIB_REGISTER_NODE (acl_fa_worker_session_cleaner_process_node, static) = {
   .name = "acl-plugin-fa-worker-cleaner-process",
   .type = VLIB_NODE_TYPE_INPUT,
   .state = VLIB_NODE_STATE_INTERRUPT,
+  .n_errors = ARRAY_LEN (acl_fa_worker_cleaner_error_strings),
+  .error_strings = acl_fa_worker_cleaner_error_strings,
 };
 
 VLIB_REGISTER_NODE (acl_fa_session_cleaner_process_node, static) = {
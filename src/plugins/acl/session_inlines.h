@@ -140,6 +140,54 @@ is_valid_session_ptr (acl_main_t * am, u16 thread_index, fa_session_t * sess)
 	      pool_len (pw->fa_sessions_pool)));
 }
 
+/*
+ * Sessions in the timeout lists also have an idle timer on the wheel
+ * of their worker, set to fire when the session would be idle for its
+ * timeout if no more packets arrived. When it fires, the session
+ * is either expired or requeued, which starts a new timer.
+ */
+
+always_inline f64
+acl_fa_session_timer_now (acl_main_t * am, u64 now)
+{
+  return (f64) now *am->vlib_main->clib_time.seconds_per_clock;
+}
+
+always_inline int
+acl_fa_session_timers_due (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			   u64 now)
+{
+  if (pw->expired_timers_head < vec_len (pw->expired_timers))
+    return 1;
+  return (pw->session_timer_wheel.timers != 0) &&
+    (acl_fa_session_timer_now (am, now) >=
+     pw->session_timer_wheel.next_run_time);
+}
+
+always_inline u32
+acl_fa_session_timer_ticks (acl_main_t * am, fa_session_t * sess, u64 now)
+{
+  f64 clocks_per_tick =
+    am->vlib_main->clib_time.clocks_per_second * SESSION_TIMER_TICK_SEC;
+  u64 timeout = fa_session_get_timeout (am, sess);
+  u64 expiry_time = sess->last_active_time + timeout;
+  u64 remaining = (expiry_time > now) ? expiry_time - now : 0;
+
+  /*
+   * A FIN or RST seen by another thread shortens the timeout of an
+   * established TCP session, and only the owner can restart its timer:
+   * look at those at least as often as the transient timeout.
+   */
+  if (sess->link_list_id == ACL_TIMEOUT_TCP_IDLE)
+    {
+      u64 transient_timeout = am->vlib_main->clib_time.clocks_per_second *
+	am->session_timeout_sec[ACL_TIMEOUT_TCP_TRANSIENT];
+      if (remaining > transient_timeout)
+	remaining = transient_timeout;
+    }
+  return 1 + (u32) (remaining / clocks_per_tick);
+}
+
 always_inline void
 acl_fa_conn_list_add_session (acl_main_t * am, fa_full_session_id_t sess_id,
 			      u64 now)
@@ -169,6 +217,19 @@ acl_fa_conn_list_add_session (acl_main_t * am, fa_full_session_id_t sess_id,
     }
   pw->fa_conn_list_tail[list_id] = sess_id.session_index;
 
+  /* the purgatory is short enough to be checked by walking the list */
+  sess->timer_handle = ~0;
+  if (list_id != ACL_TIMEOUT_PURGATORY)
+    {
+      void *oldheap = clib_mem_set_heap (am->acl_mheap);
+      sess->timer_handle =
+	tw_timer_start_1t_3w_1024sl_ov (&pw->session_timer_wheel,
+					sess_id.session_index, 0,
+					acl_fa_session_timer_ticks (am, sess,
+								    now));
+      clib_mem_set_heap (oldheap);
+    }
+
 #ifdef FA_NODE_VERBOSE_DEBUG
   clib_warning
     ("FA-SESSION-DEBUG: add session id %d on thread %d sw_if_index %d",
@@ -210,6 +271,14 @@ acl_fa_conn_list_delete_session (acl_main_t * am,
 	("Attempting to delete session belonging to thread %d by thread %d",
 	 sess->thread_index, thread_index);
     }
+  if (~0 != sess->timer_handle)
+    {
+      void *oldheap = clib_mem_set_heap (am->acl_mheap);
+      tw_timer_stop_1t_3w_1024sl_ov (&pw->session_timer_wheel,
+				     sess->timer_handle);
+      clib_mem_set_heap (oldheap);
+      sess->timer_handle = ~0;
+    }
   if (FA_SESSION_BOGUS_INDEX != sess->link_prev_idx)
     {
       fa_session_t *prev_sess =
@@ -553,6 +622,7 @@ acl_fa_add_session (acl_main_t * am, int is_input, int is_ip6,
   sess->link_next_idx = FA_SESSION_BOGUS_INDEX;
   sess->deleted = 0;
   sess->is_ip6 = is_ip6;
+  sess->timer_handle = ~0;
 
   acl_fa_conn_list_add_session (am, f_sess_id, now);
 
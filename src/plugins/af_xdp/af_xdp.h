@@ -0,0 +1,250 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef __included_af_xdp_h__
+#define __included_af_xdp_h__
+
+#include <linux/if_xdp.h>
+
+#include <vlib/log.h>
+
+#define foreach_af_xdp_device_flags \
+  _(0, INITIALIZED, "initialized") \
+  _(1, ERROR, "error") \
+  _(2, ADMIN_UP, "admin-up") \
+  _(3, ZERO_COPY, "zero-copy") \
+  _(4, SHARED_TXQ_LOCK, "shared-txq-lock") \
+  _(5, STEER_ALL, "steer-all")
+
+enum
+{
+#define _(a, b, c) AF_XDP_DEVICE_F_##b = (1 << a),
+  foreach_af_xdp_device_flags
+#undef _
+};
+
+#define foreach_af_xdp_mode \
+  _(0, AUTO, "auto") \
+  _(1, COPY, "copy") \
+  _(2, ZERO_COPY, "zero-copy")
+
+typedef enum
+{
+#define _(a, b, c) AF_XDP_MODE_##b = (a),
+  foreach_af_xdp_mode
+#undef _
+} af_xdp_mode_t;
+
+#define AF_XDP_RING_SZ 1024
+#define AF_XDP_MAX_QUEUES 64
+#define AF_XDP_MAX_FLOWS 1024
+
+/*
+ * A kernel ring shared with the socket. The producer and consumer
+ * indices run freely, the slot is the index masked by size - 1.
+ */
+typedef struct
+{
+  volatile u32 *producer;
+  volatile u32 *consumer;
+  volatile u32 *flags;
+  void *descs;
+  u32 size;
+  /* our side of the ring, the producer or consumer index */
+  u32 next;
+  void *map;
+  uword map_size;
+} af_xdp_ring_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  int fd;
+  af_xdp_ring_t rx;
+  af_xdp_ring_t fill;
+  /* buffers handed to the kernel on the fill ring and not yet received */
+  u32 n_bufs;
+} af_xdp_rxq_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  clib_spinlock_t lock;
+  int fd;
+  af_xdp_ring_t tx;
+  af_xdp_ring_t comp;
+  /* buffers on the tx ring and not yet completed */
+  u32 n_bufs;
+} af_xdp_txq_t;
+
+/*
+ * Key of the steering program's flow table, in network byte order. The
+ * program looks a packet up with its ethertype, ip protocol and l4
+ * destination port, then with the port, the protocol and finally the
+ * ethertype wildcarded (zero).
+ */
+typedef struct
+{
+  u16 ethertype;
+  u8 protocol;
+  u8 pad0;
+  u16 port;
+  u16 pad1;
+} af_xdp_flow_key_t;
+
+STATIC_ASSERT_SIZEOF (af_xdp_flow_key_t, 8);
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  u32 flags;
+  u32 per_interface_next_index;
+
+  u32 dev_instance;
+  u32 sw_if_index;
+  u32 hw_if_index;
+
+  u8 *host_if_name;
+  int host_if_index;
+  u8 hwaddr[6];
+
+  /* the umem is the vlib buffer pool, registered by each socket */
+  uword umem_start;
+  uword umem_size;
+  u32 umem_chunk_size;
+
+  /* queues, queue pair n shares the socket bound to host queue n */
+  af_xdp_rxq_t *rxqs;
+  af_xdp_txq_t *txqs;
+
+  /* steering program and its maps */
+  int prog_fd;
+  int xsks_map_fd;
+  int flows_map_fd;
+  af_xdp_flow_key_t *flows;
+
+  /* error */
+  clib_error_t *error;
+} af_xdp_device_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  vlib_buffer_t buffer_template;
+} af_xdp_per_thread_data_t;
+
+typedef struct
+{
+  af_xdp_device_t *devices;
+  af_xdp_per_thread_data_t *per_thread_data;
+  vlib_log_class_t log_class;
+} af_xdp_main_t;
+
+extern af_xdp_main_t af_xdp_main;
+
+typedef struct
+{
+  u8 *host_if_name;
+  u16 rxq_num;
+  af_xdp_mode_t mode;
+  /* only steer the flows added later, instead of all traffic */
+  int steer_flows;
+  /* return */
+  int rv;
+  u32 sw_if_index;
+  clib_error_t *error;
+} af_xdp_create_if_args_t;
+
+void af_xdp_create_if (vlib_main_t * vm, af_xdp_create_if_args_t * args);
+void af_xdp_delete_if (vlib_main_t * vm, af_xdp_device_t * ad);
+
+extern vlib_node_registration_t af_xdp_input_node;
+extern vnet_device_class_t af_xdp_device_class;
+uword af_xdp_interface_tx (vlib_main_t * vm, vlib_node_runtime_t * node,
+			   vlib_frame_t * frame);
+
+#define foreach_af_xdp_tx_func_error \
+  _(NO_FREE_SLOTS, "no free tx slots") \
+  _(TOO_LONG, "chained packet too long") \
+  _(SENDTO, "tx kick failed")
+
+typedef enum
+{
+#define _(f,s) AF_XDP_TX_ERROR_##f,
+  foreach_af_xdp_tx_func_error
+#undef _
+    AF_XDP_TX_N_ERROR,
+} af_xdp_tx_func_error_t;
+
+/* bpf.c */
+clib_error_t *af_xdp_bpf_load (af_xdp_device_t * ad);
+clib_error_t *af_xdp_bpf_attach (af_xdp_device_t * ad, af_xdp_mode_t mode);
+void af_xdp_bpf_detach (af_xdp_device_t * ad);
+void af_xdp_bpf_unload (af_xdp_device_t * ad);
+clib_error_t *af_xdp_bpf_set_xsk (af_xdp_device_t * ad, u32 qid, int fd);
+clib_error_t *af_xdp_bpf_test_run (af_xdp_device_t * ad, u8 * data, u32 len,
+				   u32 * verdict);
+clib_error_t *af_xdp_flow_add_del (af_xdp_device_t * ad,
+				   af_xdp_flow_key_t * key, int is_add);
+u64 af_xdp_flow_hits (af_xdp_device_t * ad, af_xdp_flow_key_t * key);
+
+/* format.c */
+format_function_t format_af_xdp_device;
+format_function_t format_af_xdp_device_name;
+format_function_t format_af_xdp_flow_key;
+format_function_t format_af_xdp_input_trace;
+
+/* The umem offset of a buffer's header, which is where its chunk starts */
+static_always_inline u64
+af_xdp_buffer_index_to_addr (af_xdp_device_t * ad, u32 bi)
+{
+  return ((u64) bi << CLIB_LOG2_CACHE_LINE_BYTES) +
+    buffer_main.buffer_mem_start - ad->umem_start;
+}
+
+/* Descriptor addresses carry the data offset in the chunk in the high bits */
+static_always_inline u32
+af_xdp_addr_to_buffer_index (af_xdp_device_t * ad, u64 addr)
+{
+  addr &= XSK_UNALIGNED_BUF_ADDR_MASK;
+  return (addr + ad->umem_start - buffer_main.buffer_mem_start) >>
+    CLIB_LOG2_CACHE_LINE_BYTES;
+}
+
+static_always_inline i16
+af_xdp_addr_to_current_data (u64 addr)
+{
+  return (addr >> XSK_UNALIGNED_BUF_OFFSET_SHIFT) - sizeof (vlib_buffer_t);
+}
+
+typedef struct
+{
+  u32 next_index;
+  u32 hw_if_index;
+  u16 qid;
+  u32 len;
+} af_xdp_input_trace_t;
+
+#endif /* __included_af_xdp_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,521 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+/*
+ * The steering program and its maps. The program is small and fixed, so
+ * it is assembled here and loaded with the bpf syscall instead of being
+ * compiled from C and loaded from an object file, which would need clang
+ * and libbpf.
+ *
+ * For every packet the program builds an af_xdp_flow_key_t on the stack
+ * and looks it up in the flows map, widening the key one field at a time
+ * as described in af_xdp.h. On a hit it redirects the packet to the
+ * socket of the receiving queue in the xsks map and, when that succeeds,
+ * counts it in the entry's value. On a miss, or when the queue has no
+ * socket, the packet goes on to the kernel stack.
+ */
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+
+#include <vlib/vlib.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/ip/ip.h>
+#include <vnet/devices/netlink.h>
+
+#include <af_xdp/af_xdp.h>
+
+typedef enum
+{
+  AF_XDP_BPF_LABEL_IP4,
+  AF_XDP_BPF_LABEL_IP6,
+  AF_XDP_BPF_LABEL_L4,
+  AF_XDP_BPF_LABEL_PORT,
+  AF_XDP_BPF_LABEL_LOOKUP,
+  AF_XDP_BPF_LABEL_HIT,
+  AF_XDP_BPF_LABEL_EXIT,
+  AF_XDP_BPF_N_LABEL,
+} af_xdp_bpf_label_t;
+
+typedef struct
+{
+  struct bpf_insn *insns;
+  /* instruction index of each label */
+  u32 labels[AF_XDP_BPF_N_LABEL];
+  /* jumps to fix up, their offset holds the label until then */
+  u32 *jumps;
+} af_xdp_bpf_asm_t;
+
+/* offset of the flow key on the stack, and of its fields from r10 */
+#define AF_XDP_BPF_KEY (-(i16) sizeof (af_xdp_flow_key_t))
+#define AF_XDP_BPF_KEY_FIELD(f) \
+  (AF_XDP_BPF_KEY + (i16) STRUCT_OFFSET_OF (af_xdp_flow_key_t, f))
+
+static int
+af_xdp_bpf (int cmd, union bpf_attr *attr)
+{
+  return syscall (__NR_bpf, cmd, attr, sizeof (*attr));
+}
+
+static void
+af_xdp_asm_emit (af_xdp_bpf_asm_t * a, u8 code, u8 dst, u8 src, i16 off,
+		 i32 imm)
+{
+  struct bpf_insn *i;
+
+  vec_add2 (a->insns, i, 1);
+  i->code = code;
+  i->dst_reg = dst;
+  i->src_reg = src;
+  i->off = off;
+  i->imm = imm;
+}
+
+static void
+af_xdp_asm_label (af_xdp_bpf_asm_t * a, af_xdp_bpf_label_t label)
+{
+  a->labels[label] = vec_len (a->insns);
+}
+
+static void
+af_xdp_asm_jmp (af_xdp_bpf_asm_t * a, u8 op, u8 src, u8 dst, u8 reg,
+		i32 imm, af_xdp_bpf_label_t label)
+{
+  vec_add1 (a->jumps, vec_len (a->insns));
+  af_xdp_asm_emit (a, BPF_JMP | op | src, dst, reg, label, imm);
+}
+
+#define af_xdp_asm_mov_reg(a, dst, src) \
+  af_xdp_asm_emit (a, BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0)
+#define af_xdp_asm_mov_imm(a, dst, imm) \
+  af_xdp_asm_emit (a, BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm)
+#define af_xdp_asm_alu_imm(a, op, dst, imm) \
+  af_xdp_asm_emit (a, BPF_ALU64 | op | BPF_K, dst, 0, 0, imm)
+#define af_xdp_asm_alu_reg(a, op, dst, src) \
+  af_xdp_asm_emit (a, BPF_ALU64 | op | BPF_X, dst, src, 0, 0)
+#define af_xdp_asm_ldx(a, size, dst, src, off) \
+  af_xdp_asm_emit (a, BPF_LDX | BPF_MEM | size, dst, src, off, 0)
+#define af_xdp_asm_stx(a, size, dst, src, off) \
+  af_xdp_asm_emit (a, BPF_STX | BPF_MEM | size, dst, src, off, 0)
+#define af_xdp_asm_st(a, size, dst, off, imm) \
+  af_xdp_asm_emit (a, BPF_ST | BPF_MEM | size, dst, 0, off, imm)
+#define af_xdp_asm_call(a, fn) \
+  af_xdp_asm_emit (a, BPF_JMP | BPF_CALL, 0, 0, 0, fn)
+#define af_xdp_asm_exit(a) \
+  af_xdp_asm_emit (a, BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+#define af_xdp_asm_jmp_imm(a, op, dst, imm, label) \
+  af_xdp_asm_jmp (a, op, BPF_K, dst, 0, imm, label)
+#define af_xdp_asm_jmp_reg(a, op, dst, reg, label) \
+  af_xdp_asm_jmp (a, op, BPF_X, dst, reg, 0, label)
+#define af_xdp_asm_ja(a, label) \
+  af_xdp_asm_jmp (a, BPF_JA, BPF_K, 0, 0, 0, label)
+
+/* the map fd is replaced by the map by the kernel, in a 16 byte insn */
+static void
+af_xdp_asm_ld_map (af_xdp_bpf_asm_t * a, u8 dst, int map_fd)
+{
+  af_xdp_asm_emit (a, BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0,
+		   map_fd);
+  af_xdp_asm_emit (a, 0, 0, 0, 0, 0);
+}
+
+/* r2 = ptr + len, goto label if that is past the end of the packet */
+static void
+af_xdp_asm_check_len (af_xdp_bpf_asm_t * a, u8 ptr, i32 len,
+		      af_xdp_bpf_label_t label)
+{
+  af_xdp_asm_mov_reg (a, BPF_REG_2, ptr);
+  af_xdp_asm_alu_imm (a, BPF_ADD, BPF_REG_2, len);
+  af_xdp_asm_jmp_reg (a, BPF_JGT, BPF_REG_2, BPF_REG_8, label);
+}
+
+/* The test program is the same without the hit count */
+static void
+af_xdp_bpf_assemble (af_xdp_bpf_asm_t * a, af_xdp_device_t * ad,
+		     int is_test)
+{
+  int l2 = sizeof (ethernet_header_t);
+  int i;
+
+  /*
+   * r6 = ctx, r7 = packet, r8 = packet end, r9 = l4 header
+   * r3 = ip protocol
+   */
+  af_xdp_asm_mov_reg (a, BPF_REG_6, BPF_REG_1);
+  af_xdp_asm_ldx (a, BPF_W, BPF_REG_7, BPF_REG_6,
+		  STRUCT_OFFSET_OF (struct xdp_md, data));
+  af_xdp_asm_ldx (a, BPF_W, BPF_REG_8, BPF_REG_6,
+		  STRUCT_OFFSET_OF (struct xdp_md, data_end));
+  af_xdp_asm_st (a, BPF_DW, BPF_REG_10, AF_XDP_BPF_KEY, 0);
+
+  /* ethertype, untagged frames only */
+  af_xdp_asm_check_len (a, BPF_REG_7, l2, AF_XDP_BPF_LABEL_LOOKUP);
+  af_xdp_asm_ldx (a, BPF_H, BPF_REG_2, BPF_REG_7,
+		  STRUCT_OFFSET_OF (ethernet_header_t, type));
+  af_xdp_asm_stx (a, BPF_H, BPF_REG_10, BPF_REG_2,
+		  AF_XDP_BPF_KEY_FIELD (ethertype));
+  af_xdp_asm_jmp_imm (a, BPF_JEQ, BPF_REG_2,
+		      clib_host_to_net_u16 (ETHERNET_TYPE_IP4),
+		      AF_XDP_BPF_LABEL_IP4);
+  af_xdp_asm_jmp_imm (a, BPF_JEQ, BPF_REG_2,
+		      clib_host_to_net_u16 (ETHERNET_TYPE_IP6),
+		      AF_XDP_BPF_LABEL_IP6);
+  af_xdp_asm_ja (a, AF_XDP_BPF_LABEL_LOOKUP);
+
+  /* ip4, fragments other than the first have no port */
+  af_xdp_asm_label (a, AF_XDP_BPF_LABEL_IP4);
+  af_xdp_asm_check_len (a, BPF_REG_7, l2 + sizeof (ip4_header_t),
+			AF_XDP_BPF_LABEL_LOOKUP);
+  af_xdp_asm_ldx (a, BPF_B, BPF_REG_3, BPF_REG_7,
+		  l2 + STRUCT_OFFSET_OF (ip4_header_t, protocol));
+  af_xdp_asm_stx (a, BPF_B, BPF_REG_10, BPF_REG_3,
+		  AF_XDP_BPF_KEY_FIELD (protocol));
+  af_xdp_asm_ldx (a, BPF_H, BPF_REG_2, BPF_REG_7,
+		  l2 + STRUCT_OFFSET_OF (ip4_header_t,
+					 flags_and_fragment_offset));
+  af_xdp_asm_alu_imm (a, BPF_AND, BPF_REG_2,
+		      clib_host_to_net_u16
+		      (IP4_HEADER_FLAG_MORE_FRAGMENTS - 1));
+  af_xdp_asm_jmp_imm (a, BPF_JNE, BPF_REG_2, 0, AF_XDP_BPF_LABEL_LOOKUP);
+  af_xdp_asm_ldx (a, BPF_B, BPF_REG_9, BPF_REG_7,
+		  l2 + STRUCT_OFFSET_OF (ip4_header_t,
+					 ip_version_and_header_length));
+  af_xdp_asm_alu_imm (a, BPF_AND, BPF_REG_9, 0xf);
+  af_xdp_asm_alu_imm (a, BPF_LSH, BPF_REG_9, 2);
+  af_xdp_asm_alu_reg (a, BPF_ADD, BPF_REG_9, BPF_REG_7);
+  af_xdp_asm_alu_imm (a, BPF_ADD, BPF_REG_9, l2);
+  af_xdp_asm_ja (a, AF_XDP_BPF_LABEL_L4);
+
+  /* ip6, a port is only found right after the fixed header */
+  af_xdp_asm_label (a, AF_XDP_BPF_LABEL_IP6);
+  af_xdp_asm_check_len (a, BPF_REG_7, l2 + sizeof (ip6_header_t),
+			AF_XDP_BPF_LABEL_LOOKUP);
+  af_xdp_asm_ldx (a, BPF_B, BPF_REG_3, BPF_REG_7,
+		  l2 + STRUCT_OFFSET_OF (ip6_header_t, protocol));
+  af_xdp_asm_stx (a, BPF_B, BPF_REG_10, BPF_REG_3,
+		  AF_XDP_BPF_KEY_FIELD (protocol));
+  af_xdp_asm_mov_reg (a, BPF_REG_9, BPF_REG_7);
+  af_xdp_asm_alu_imm (a, BPF_ADD, BPF_REG_9, l2 + sizeof (ip6_header_t));
+
+  /* the destination port follows the source port in tcp, udp and sctp */
+  af_xdp_asm_label (a, AF_XDP_BPF_LABEL_L4);
+  af_xdp_asm_jmp_imm (a, BPF_JEQ, BPF_REG_3, IP_PROTOCOL_TCP,
+		      AF_XDP_BPF_LABEL_PORT);
+  af_xdp_asm_jmp_imm (a, BPF_JEQ, BPF_REG_3, IP_PROTOCOL_UDP,
+		      AF_XDP_BPF_LABEL_PORT);
+  af_xdp_asm_jmp_imm (a, BPF_JEQ, BPF_REG_3, IP_PROTOCOL_SCTP,
+		      AF_XDP_BPF_LABEL_PORT);
+  af_xdp_asm_ja (a, AF_XDP_BPF_LABEL_LOOKUP);
+
+  af_xdp_asm_label (a, AF_XDP_BPF_LABEL_PORT);
+  af_xdp_asm_check_len (a, BPF_REG_9, 4, AF_XDP_BPF_LABEL_LOOKUP);
+  af_xdp_asm_ldx (a, BPF_H, BPF_REG_2, BPF_REG_9, 2);
+  af_xdp_asm_stx (a, BPF_H, BPF_REG_10, BPF_REG_2,
+		  AF_XDP_BPF_KEY_FIELD (port));
+
+  /* look up the key, then wildcard port, protocol and ethertype in turn */
+  af_xdp_asm_label (a, AF_XDP_BPF_LABEL_LOOKUP);
+  for (i = 0; i < 4; i++)
+    {
+      af_xdp_asm_ld_map (a, BPF_REG_1, ad->flows_map_fd);
+      af_xdp_asm_mov_reg (a, BPF_REG_2, BPF_REG_10);
+      af_xdp_asm_alu_imm (a, BPF_ADD, BPF_REG_2, AF_XDP_BPF_KEY);
+      af_xdp_asm_call (a, BPF_FUNC_map_lookup_elem);
+      af_xdp_asm_jmp_imm (a, BPF_JNE, BPF_REG_0, 0, AF_XDP_BPF_LABEL_HIT);
+      if (i == 0)
+	af_xdp_asm_st (a, BPF_H, BPF_REG_10, AF_XDP_BPF_KEY_FIELD (port), 0);
+      else if (i == 1)
+	af_xdp_asm_st (a, BPF_B, BPF_REG_10, AF_XDP_BPF_KEY_FIELD (protocol),
+		       0);
+      else if (i == 2)
+	af_xdp_asm_st (a, BPF_H, BPF_REG_10, AF_XDP_BPF_KEY_FIELD (ethertype),
+		       0);
+    }
+  af_xdp_asm_mov_imm (a, BPF_REG_0, XDP_PASS);
+  af_xdp_asm_exit (a);
+
+  /*
+   * redirect to the queue's socket if it has one, and count the hit only
+   * then, r7 = the entry's value
+   */
+  af_xdp_asm_label (a, AF_XDP_BPF_LABEL_HIT);
+  af_xdp_asm_mov_reg (a, BPF_REG_7, BPF_REG_0);
+  af_xdp_asm_ld_map (a, BPF_REG_1, ad->xsks_map_fd);
+  af_xdp_asm_ldx (a, BPF_W, BPF_REG_2, BPF_REG_6,
+		  STRUCT_OFFSET_OF (struct xdp_md, rx_queue_index));
+  af_xdp_asm_mov_imm (a, BPF_REG_3, XDP_PASS);
+  af_xdp_asm_call (a, BPF_FUNC_redirect_map);
+  if (!is_test)
+    {
+      af_xdp_asm_jmp_imm (a, BPF_JNE, BPF_REG_0, XDP_REDIRECT,
+			  AF_XDP_BPF_LABEL_EXIT);
+      af_xdp_asm_mov_imm (a, BPF_REG_1, 1);
+      af_xdp_asm_emit (a, BPF_STX | BPF_XADD | BPF_DW, BPF_REG_7, BPF_REG_1,
+		       0, 0);
+    }
+  af_xdp_asm_label (a, AF_XDP_BPF_LABEL_EXIT);
+  af_xdp_asm_exit (a);
+
+  for (i = 0; i < vec_len (a->jumps); i++)
+    {
+      struct bpf_insn *j = vec_elt_at_index (a->insns, a->jumps[i]);
+      j->off = a->labels[j->off] - (a->jumps[i] + 1);
+    }
+}
+
+static clib_error_t *
+af_xdp_bpf_map_create (char *name, u32 type, u32 key_size, u32 value_size,
+		       u32 max_entries, int *fd)
+{
+  union bpf_attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.map_type = type;
+  attr.key_size = key_size;
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+  strncpy (attr.map_name, name, sizeof (attr.map_name) - 1);
+
+  if ((*fd = af_xdp_bpf (BPF_MAP_CREATE, &attr)) < 0)
+    return clib_error_return_unix (0, "bpf map '%s' create", name);
+  return 0;
+}
+
+static clib_error_t *
+af_xdp_bpf_prog_load (af_xdp_device_t * ad, int is_test, int *fd)
+{
+  af_xdp_bpf_asm_t a = { 0 };
+  union bpf_attr attr;
+  clib_error_t *err = 0;
+  char *license = "Apache-2.0";
+  u8 *log = 0;
+
+  af_xdp_bpf_assemble (&a, ad, is_test);
+
+  memset (&attr, 0, sizeof (attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = pointer_to_uword (a.insns);
+  attr.insn_cnt = vec_len (a.insns);
+  attr.license = pointer_to_uword (license);
+  strncpy (attr.prog_name, is_test ? "af_xdp_test" : "af_xdp_steer",
+	   sizeof (attr.prog_name) - 1);
+
+  if ((*fd = af_xdp_bpf (BPF_PROG_LOAD, &attr)) < 0)
+    {
+      /* load again for the verifier's account of what it refused */
+      vec_validate (log, 64 << 10);
+      attr.log_level = 1;
+      attr.log_buf = pointer_to_uword (log);
+      attr.log_size = vec_len (log);
+      if ((*fd = af_xdp_bpf (BPF_PROG_LOAD, &attr)) < 0)
+	err = clib_error_return_unix (0, "bpf program load: %s", log);
+      vec_free (log);
+    }
+
+  vec_free (a.insns);
+  vec_free (a.jumps);
+  return err;
+}
+
+clib_error_t *
+af_xdp_bpf_load (af_xdp_device_t * ad)
+{
+  clib_error_t *err;
+
+  err = af_xdp_bpf_map_create ("af_xdp_xsks", BPF_MAP_TYPE_XSKMAP,
+			       sizeof (u32), sizeof (u32),
+			       vec_len (ad->rxqs), &ad->xsks_map_fd);
+  if (err)
+    return err;
+
+  err = af_xdp_bpf_map_create ("af_xdp_flows", BPF_MAP_TYPE_HASH,
+			       sizeof (af_xdp_flow_key_t), sizeof (u64),
+			       AF_XDP_MAX_FLOWS, &ad->flows_map_fd);
+  if (err)
+    return err;
+
+  return af_xdp_bpf_prog_load (ad, 0, &ad->prog_fd);
+}
+
+void
+af_xdp_bpf_unload (af_xdp_device_t * ad)
+{
+  if (ad->prog_fd >= 0)
+    close (ad->prog_fd);
+  if (ad->flows_map_fd >= 0)
+    close (ad->flows_map_fd);
+  if (ad->xsks_map_fd >= 0)
+    close (ad->xsks_map_fd);
+  ad->prog_fd = ad->flows_map_fd = ad->xsks_map_fd = -1;
+  vec_free (ad->flows);
+}
+
+/*
+ * Zero copy needs the driver's own xdp support, otherwise the kernel picks
+ * native mode when the driver has it and generic mode when not.
+ */
+clib_error_t *
+af_xdp_bpf_attach (af_xdp_device_t * ad, af_xdp_mode_t mode)
+{
+  u32 flags = XDP_FLAGS_UPDATE_IF_NOEXIST;
+
+  if (mode == AF_XDP_MODE_ZERO_COPY)
+    flags |= XDP_FLAGS_DRV_MODE;
+
+  return vnet_netlink_set_link_xdp_fd (ad->host_if_index, ad->prog_fd,
+				       flags);
+}
+
+void
+af_xdp_bpf_detach (af_xdp_device_t * ad)
+{
+  clib_error_t *err;
+
+  err = vnet_netlink_set_link_xdp_fd (ad->host_if_index, -1, 0);
+  if (err)
+    {
+      vlib_log_warn (af_xdp_main.log_class, "%U: xdp detach: %U",
+		     format_af_xdp_device_name, ad->dev_instance,
+		     format_clib_error, err);
+      clib_error_free (err);
+    }
+}
+
+clib_error_t *
+af_xdp_bpf_set_xsk (af_xdp_device_t * ad, u32 qid, int fd)
+{
+  union bpf_attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.map_fd = ad->xsks_map_fd;
+  attr.key = pointer_to_uword (&qid);
+  attr.value = pointer_to_uword (&fd);
+
+  if (af_xdp_bpf (BPF_MAP_UPDATE_ELEM, &attr) < 0)
+    return clib_error_return_unix (0, "xsks map update, queue %u", qid);
+  return 0;
+}
+
+/*
+ * Run the steering program once on a packet, as received on queue 0. A
+ * copy without the hit count runs, so tests leave the counters alone.
+ */
+clib_error_t *
+af_xdp_bpf_test_run (af_xdp_device_t * ad, u8 * data, u32 len, u32 * verdict)
+{
+  union bpf_attr attr;
+  clib_error_t *err;
+  int fd, rv;
+
+  if ((err = af_xdp_bpf_prog_load (ad, 1, &fd)))
+    return err;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.test.prog_fd = fd;
+  attr.test.data_in = pointer_to_uword (data);
+  attr.test.data_size_in = len;
+  attr.test.repeat = 1;
+
+  rv = af_xdp_bpf (BPF_PROG_TEST_RUN, &attr);
+  close (fd);
+  if (rv < 0)
+    return clib_error_return_unix (0, "bpf program test run");
+  *verdict = attr.test.retval;
+  return 0;
+}
+
+static int
+af_xdp_flow_find (af_xdp_device_t * ad, af_xdp_flow_key_t * key)
+{
+  af_xdp_flow_key_t *k;
+
+  vec_foreach (k, ad->flows)
+    if (!memcmp (k, key, sizeof (*k)))
+    return k - ad->flows;
+  return -1;
+}
+
+clib_error_t *
+af_xdp_flow_add_del (af_xdp_device_t * ad, af_xdp_flow_key_t * key,
+		     int is_add)
+{
+  union bpf_attr attr;
+  u64 hits = 0;
+  int i;
+
+  key->pad0 = key->pad1 = 0;
+  i = af_xdp_flow_find (ad, key);
+
+  if (is_add && i >= 0)
+    return clib_error_return (0, "flow %U exists", format_af_xdp_flow_key,
+			      key);
+  if (!is_add && i < 0)
+    return clib_error_return (0, "flow %U not found",
+			      format_af_xdp_flow_key, key);
+
+  memset (&attr, 0, sizeof (attr));
+  attr.map_fd = ad->flows_map_fd;
+  attr.key = pointer_to_uword (key);
+
+  if (is_add)
+    {
+      attr.value = pointer_to_uword (&hits);
+      attr.flags = BPF_NOEXIST;
+      if (af_xdp_bpf (BPF_MAP_UPDATE_ELEM, &attr) < 0)
+	return clib_error_return_unix (0, "flows map update");
+      vec_add1 (ad->flows, *key);
+    }
+  else
+    {
+      if (af_xdp_bpf (BPF_MAP_DELETE_ELEM, &attr) < 0)
+	return clib_error_return_unix (0, "flows map delete");
+      vec_delete (ad->flows, 1, i);
+    }
+
+  if (key->ethertype == 0)
+    {
+      if (is_add)
+	ad->flags |= AF_XDP_DEVICE_F_STEER_ALL;
+      else
+	ad->flags &= ~AF_XDP_DEVICE_F_STEER_ALL;
+    }
+  return 0;
+}
+
+u64
+af_xdp_flow_hits (af_xdp_device_t * ad, af_xdp_flow_key_t * key)
+{
+  union bpf_attr attr;
+  u64 hits = 0;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.map_fd = ad->flows_map_fd;
+  attr.key = pointer_to_uword (key);
+  attr.value = pointer_to_uword (&hits);
+  af_xdp_bpf (BPF_MAP_LOOKUP_ELEM, &attr);
+  return hits;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,415 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <linux/bpf.h>
+
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/ip/ip.h>
+#include <vnet/udp/udp_packet.h>
+
+#include <af_xdp/af_xdp.h>
+
+static clib_error_t *
+af_xdp_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			  vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  af_xdp_create_if_args_t args;
+  clib_error_t *error = 0;
+  u32 tmp;
+
+  memset (&args, 0, sizeof (af_xdp_create_if_args_t));
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "host-if %s", &args.host_if_name))
+	;
+      else if (unformat (line_input, "num-rx-queues %u", &tmp))
+	args.rxq_num = tmp;
+      else if (unformat (line_input, "mode auto"))
+	args.mode = AF_XDP_MODE_AUTO;
+      else if (unformat (line_input, "mode copy"))
+	args.mode = AF_XDP_MODE_COPY;
+      else if (unformat (line_input, "mode zero-copy"))
+	args.mode = AF_XDP_MODE_ZERO_COPY;
+      else if (unformat (line_input, "steer-flows"))
+	args.steer_flows = 1;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (args.host_if_name == 0)
+    {
+      error = clib_error_return (0, "missing host interface name");
+      goto done;
+    }
+
+  af_xdp_create_if (vm, &args);
+  if (args.error == 0)
+    vlib_cli_output (vm, "%U\n", format_vnet_sw_if_index_name,
+		     vnet_get_main (), args.sw_if_index);
+  error = args.error;
+
+done:
+  vec_free (args.host_if_name);
+  unformat_free (line_input);
+  return error;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (af_xdp_create_command, static) = {
+  .path = "create interface af_xdp",
+  .short_help = "create interface af_xdp host-if <ifname> "
+    "[num-rx-queues <n>] [mode auto|copy|zero-copy] [steer-flows]",
+  .function = af_xdp_create_command_fn,
+};
+/* *INDENT-ON* */
+
+static af_xdp_device_t *
+af_xdp_device_from_sw_if_index (u32 sw_if_index)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_hw_interface_t *hw;
+
+  hw = vnet_get_sup_hw_interface (vnm, sw_if_index);
+  if (hw == NULL || af_xdp_device_class.index != hw->dev_class_index)
+    return 0;
+  return pool_elt_at_index (af_xdp_main.devices, hw->dev_instance);
+}
+
+static clib_error_t *
+af_xdp_delete_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			  vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 sw_if_index = ~0;
+  af_xdp_device_t *ad;
+  vnet_main_t *vnm = vnet_get_main ();
+  clib_error_t *error = 0;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "sw_if_index %d", &sw_if_index))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+			 vnm, &sw_if_index))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "please specify interface name or "
+				 "sw_if_index");
+      goto done;
+    }
+
+  if ((ad = af_xdp_device_from_sw_if_index (sw_if_index)) == 0)
+    {
+      error = clib_error_return (0, "not an AF_XDP interface");
+      goto done;
+    }
+
+  af_xdp_delete_if (vm, ad);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (af_xdp_delete_command, static) = {
+  .path = "delete interface af_xdp",
+  .short_help = "delete interface af_xdp "
+    "{<interface> | sw_if_index <sw_idx>}",
+  .function = af_xdp_delete_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+af_xdp_flow_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  af_xdp_flow_key_t key = { 0 };
+  u32 sw_if_index = ~0, ethertype = 0, port = 0;
+  int is_add = -1, all = 0;
+  clib_error_t *error = 0;
+  af_xdp_device_t *ad;
+  u8 protocol = 0;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "add"))
+	is_add = 1;
+      else if (unformat (line_input, "del"))
+	is_add = 0;
+      else if (unformat (line_input, "all"))
+	all = 1;
+      else if (unformat (line_input, "ip4"))
+	ethertype = ETHERNET_TYPE_IP4;
+      else if (unformat (line_input, "ip6"))
+	ethertype = ETHERNET_TYPE_IP6;
+      else if (unformat (line_input, "ethertype 0x%x", &ethertype))
+	;
+      else if (unformat (line_input, "proto %U", unformat_ip_protocol,
+			 &protocol))
+	;
+      else if (unformat (line_input, "port %u", &port))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+			 vnm, &sw_if_index))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (is_add == -1)
+    {
+      error = clib_error_return (0, "please specify add or del");
+      goto done;
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "please specify interface name");
+      goto done;
+    }
+
+  if ((ad = af_xdp_device_from_sw_if_index (sw_if_index)) == 0)
+    {
+      error = clib_error_return (0, "not an AF_XDP interface");
+      goto done;
+    }
+
+  if (all == (ethertype != 0) || ethertype > 0xffff)
+    {
+      error = clib_error_return (0, "please specify all, ip4, ip6 or "
+				 "ethertype <x>");
+      goto done;
+    }
+
+  if ((protocol && ethertype != ETHERNET_TYPE_IP4 &&
+       ethertype != ETHERNET_TYPE_IP6) || (port && !protocol)
+      || port > 0xffff)
+    {
+      error = clib_error_return (0, "a port needs a protocol, "
+				 "and a protocol needs ip4 or ip6");
+      goto done;
+    }
+
+  key.ethertype = clib_host_to_net_u16 (ethertype);
+  key.protocol = protocol;
+  key.port = clib_host_to_net_u16 (port);
+
+  error = af_xdp_flow_add_del (ad, &key, is_add);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Steer packets received on the host interface of an AF_XDP interface
+ * to VPP. Packets matching no flow stay with the kernel. A flow matches
+ * on the ethertype and, for ip4 and ip6, the ip protocol and the tcp,
+ * udp or sctp destination port. The most specific matching flow counts
+ * the packet, see the steered flows in 'show hardware-interfaces
+ * verbose'.
+ *
+ * @cliexpar
+ * Steer udp port 4789 and all ip6 traffic to VPP:
+ * @cliexcmd{af_xdp flow add af_xdp-veth0 ip4 proto udp port 4789}
+ * @cliexcmd{af_xdp flow add af_xdp-veth0 ip6}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (af_xdp_flow_command, static) = {
+  .path = "af_xdp flow",
+  .short_help = "af_xdp flow {add|del} <interface> "
+    "{all | ip4 | ip6 | ethertype 0x<x>} [proto <p> [port <n>]]",
+  .function = af_xdp_flow_command_fn,
+};
+/* *INDENT-ON* */
+
+static u8 *
+format_af_xdp_verdict (u8 * s, va_list * args)
+{
+  u32 verdict = va_arg (*args, u32);
+  char *names[] = {[XDP_ABORTED] = "aborted",[XDP_DROP] = "drop",
+    [XDP_PASS] = "pass",[XDP_TX] = "tx",[XDP_REDIRECT] = "redirect"
+  };
+
+  if (verdict < ARRAY_LEN (names))
+    return format (s, "%s", names[verdict]);
+  return format (s, "unknown %u", verdict);
+}
+
+static clib_error_t *
+af_xdp_test_flow_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0, ethertype = 0, port = 0, verdict;
+  u8 packet[128] = { 0 }, protocol = 0;
+  ethernet_header_t *eth = (ethernet_header_t *) packet;
+  udp_header_t *l4 = 0;
+  clib_error_t *error = 0;
+  af_xdp_device_t *ad;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "ip4"))
+	ethertype = ETHERNET_TYPE_IP4;
+      else if (unformat (line_input, "ip6"))
+	ethertype = ETHERNET_TYPE_IP6;
+      else if (unformat (line_input, "ethertype 0x%x", &ethertype))
+	;
+      else if (unformat (line_input, "proto %U", unformat_ip_protocol,
+			 &protocol))
+	;
+      else if (unformat (line_input, "port %u", &port))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+			 vnm, &sw_if_index))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "please specify interface name");
+      goto done;
+    }
+
+  if ((ad = af_xdp_device_from_sw_if_index (sw_if_index)) == 0)
+    {
+      error = clib_error_return (0, "not an AF_XDP interface");
+      goto done;
+    }
+
+  if (ethertype == 0 || ethertype > 0xffff || port > 0xffff)
+    {
+      error = clib_error_return (0, "please specify ip4, ip6 or "
+				 "ethertype <x>");
+      goto done;
+    }
+
+  /* tcp, udp and sctp all have the destination port at the same offset */
+  eth->type = clib_host_to_net_u16 (ethertype);
+  if (ethertype == ETHERNET_TYPE_IP4)
+    {
+      ip4_header_t *ip4 = (ip4_header_t *) (eth + 1);
+      ip4->ip_version_and_header_length = 0x45;
+      ip4->ttl = 64;
+      ip4->protocol = protocol;
+      l4 = (udp_header_t *) (ip4 + 1);
+    }
+  else if (ethertype == ETHERNET_TYPE_IP6)
+    {
+      ip6_header_t *ip6 = (ip6_header_t *) (eth + 1);
+      ip6->ip_version_traffic_class_and_flow_label =
+	clib_host_to_net_u32 (0x6 << 28);
+      ip6->hop_limit = 64;
+      ip6->protocol = protocol;
+      l4 = (udp_header_t *) (ip6 + 1);
+    }
+  if (l4)
+    l4->dst_port = clib_host_to_net_u16 (port);
+
+  error = af_xdp_bpf_test_run (ad, packet, sizeof (packet), &verdict);
+  if (error == 0)
+    vlib_cli_output (vm, "verdict %U", format_af_xdp_verdict, verdict);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Run the steering program of an AF_XDP interface on a made up packet
+ * with the given ethertype, ip protocol and destination port, and show
+ * the program's verdict: redirect when a flow steers the packet to VPP,
+ * pass when it stays with the kernel. The flows' packet counts are left
+ * alone.
+ *
+ * @cliexpar
+ * @cliexstart{test af_xdp flow af_xdp-veth0 ip4 proto udp port 4789}
+ * verdict redirect
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (af_xdp_test_flow_command, static) = {
+  .path = "test af_xdp flow",
+  .short_help = "test af_xdp flow <interface> "
+    "{ip4 | ip6 | ethertype 0x<x>} [proto <p>] [port <n>]",
+  .function = af_xdp_test_flow_command_fn,
+};
+/* *INDENT-ON* */
+
+clib_error_t *
+af_xdp_cli_init (vlib_main_t * vm)
+{
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (af_xdp_cli_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
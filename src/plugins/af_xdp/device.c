@@ -0,0 +1,503 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <net/if.h>
+#include <linux/bpf.h>
+
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/devices/netlink.h>
+
+#include <af_xdp/af_xdp.h>
+
+af_xdp_main_t af_xdp_main;
+
+static clib_error_t *
+af_xdp_ring_mmap (int fd, af_xdp_ring_t * ring, struct xdp_ring_offset *off,
+		  u64 pgoff, u32 desc_size)
+{
+  ring->map_size = off->desc + ring->size * desc_size;
+  ring->map = mmap (0, ring->map_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_POPULATE, fd, pgoff);
+  if (ring->map == MAP_FAILED)
+    {
+      ring->map = 0;
+      return clib_error_return_unix (0, "mmap");
+    }
+
+  ring->producer = ring->map + off->producer;
+  ring->consumer = ring->map + off->consumer;
+  ring->flags = ring->map + off->flags;
+  ring->descs = ring->map + off->desc;
+  ring->next = 0;
+  return 0;
+}
+
+static void
+af_xdp_ring_unmap (af_xdp_ring_t * ring)
+{
+  if (ring->map)
+    munmap (ring->map, ring->map_size);
+  ring->map = 0;
+}
+
+/*
+ * Open the socket of queue pair qid. Every socket registers the whole
+ * buffer pool as its umem, so received buffers are vlib buffers and
+ * transmitted ones need no copy. The umem headroom puts the start of
+ * received data at data[0] of the buffer, as the kernel adds
+ * XDP_PACKET_HEADROOM to it in both copy and zero copy mode.
+ */
+static clib_error_t *
+af_xdp_socket_init (af_xdp_device_t * ad, u32 qid, af_xdp_mode_t mode)
+{
+  af_xdp_rxq_t *rxq = vec_elt_at_index (ad->rxqs, qid);
+  af_xdp_txq_t *txq = vec_elt_at_index (ad->txqs, qid);
+  struct xdp_umem_reg mr = { 0 };
+  struct xdp_mmap_offsets off;
+  struct sockaddr_xdp sxdp = { 0 };
+  struct xdp_options opt;
+  clib_error_t *err;
+  socklen_t len;
+  u32 size = AF_XDP_RING_SZ;
+  int fd;
+
+  if ((fd = socket (AF_XDP, SOCK_RAW, 0)) < 0)
+    return clib_error_return_unix (0, "socket(AF_XDP)");
+  rxq->fd = txq->fd = fd;
+
+  mr.addr = ad->umem_start;
+  mr.len = ad->umem_size;
+  mr.chunk_size = ad->umem_chunk_size;
+  STATIC_ASSERT (sizeof (vlib_buffer_t) >= XDP_PACKET_HEADROOM,
+		 "umem headroom must not be negative");
+  mr.headroom = sizeof (vlib_buffer_t) - XDP_PACKET_HEADROOM;
+  mr.flags = XDP_UMEM_UNALIGNED_CHUNK_FLAG;
+  if (setsockopt (fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof (mr)) < 0)
+    return clib_error_return_unix (0, "setsockopt(XDP_UMEM_REG)");
+
+  if (setsockopt (fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof (size)) < 0
+      || setsockopt (fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size,
+		     sizeof (size)) < 0
+      || setsockopt (fd, SOL_XDP, XDP_RX_RING, &size, sizeof (size)) < 0
+      || setsockopt (fd, SOL_XDP, XDP_TX_RING, &size, sizeof (size)) < 0)
+    return clib_error_return_unix (0, "setsockopt(ring size)");
+
+  len = sizeof (off);
+  if (getsockopt (fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &len) < 0)
+    return clib_error_return_unix (0, "getsockopt(XDP_MMAP_OFFSETS)");
+
+  rxq->fill.size = txq->comp.size = rxq->rx.size = txq->tx.size = size;
+  if ((err = af_xdp_ring_mmap (fd, &rxq->fill, &off.fr,
+			       XDP_UMEM_PGOFF_FILL_RING, sizeof (u64))))
+    return err;
+  if ((err = af_xdp_ring_mmap (fd, &txq->comp, &off.cr,
+			       XDP_UMEM_PGOFF_COMPLETION_RING, sizeof (u64))))
+    return err;
+  if ((err = af_xdp_ring_mmap (fd, &rxq->rx, &off.rx, XDP_PGOFF_RX_RING,
+			       sizeof (struct xdp_desc))))
+    return err;
+  if ((err = af_xdp_ring_mmap (fd, &txq->tx, &off.tx, XDP_PGOFF_TX_RING,
+			       sizeof (struct xdp_desc))))
+    return err;
+
+  sxdp.sxdp_family = AF_XDP;
+  sxdp.sxdp_ifindex = ad->host_if_index;
+  sxdp.sxdp_queue_id = qid;
+  sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP;
+
+  if (mode != AF_XDP_MODE_COPY)
+    {
+      sxdp.sxdp_flags |= XDP_ZEROCOPY;
+      if (bind (fd, (struct sockaddr *) &sxdp, sizeof (sxdp)) == 0)
+	goto bound;
+      if (mode == AF_XDP_MODE_ZERO_COPY)
+	return clib_error_return_unix (0, "bind queue %u (zero-copy)", qid);
+      sxdp.sxdp_flags &= ~XDP_ZEROCOPY;
+    }
+
+  sxdp.sxdp_flags |= XDP_COPY;
+  if (bind (fd, (struct sockaddr *) &sxdp, sizeof (sxdp)) < 0)
+    return clib_error_return_unix (0, "bind queue %u", qid);
+
+bound:
+  len = sizeof (opt);
+  if (getsockopt (fd, SOL_XDP, XDP_OPTIONS, &opt, &len) < 0)
+    return clib_error_return_unix (0, "getsockopt(XDP_OPTIONS)");
+  if (opt.flags & XDP_OPTIONS_ZEROCOPY)
+    ad->flags |= AF_XDP_DEVICE_F_ZERO_COPY;
+
+  return 0;
+}
+
+/*
+ * Free the buffers still in the rings of a queue pair, which are those
+ * the kernel has not consumed from the fill and tx rings and those we
+ * have not consumed from the rx and completion rings. Buffers a zero
+ * copy driver still holds are not in any ring and cannot be recovered.
+ */
+static void
+af_xdp_queue_free_buffers (vlib_main_t * vm, af_xdp_device_t * ad, u32 qid)
+{
+  af_xdp_rxq_t *rxq = vec_elt_at_index (ad->rxqs, qid);
+  af_xdp_txq_t *txq = vec_elt_at_index (ad->txqs, qid);
+  u32 *bufs = 0, n_held, i;
+
+  if (rxq->fill.map && rxq->rx.map)
+    {
+      u64 *fill = rxq->fill.descs;
+      struct xdp_desc *rx = rxq->rx.descs;
+
+      for (i = *rxq->fill.consumer; i != rxq->fill.next; i++)
+	vec_add1 (bufs, af_xdp_addr_to_buffer_index
+		  (ad, fill[i & (rxq->fill.size - 1)]));
+      for (i = rxq->rx.next; i != *rxq->rx.producer; i++)
+	vec_add1 (bufs, af_xdp_addr_to_buffer_index
+		  (ad, rx[i & (rxq->rx.size - 1)].addr));
+    }
+  n_held = rxq->n_bufs;
+
+  if (txq->tx.map && txq->comp.map)
+    {
+      struct xdp_desc *tx = txq->tx.descs;
+      u64 *comp = txq->comp.descs;
+
+      for (i = *txq->tx.consumer; i != txq->tx.next; i++)
+	vec_add1 (bufs, af_xdp_addr_to_buffer_index
+		  (ad, tx[i & (txq->tx.size - 1)].addr));
+      for (i = txq->comp.next; i != *txq->comp.producer; i++)
+	vec_add1 (bufs, af_xdp_addr_to_buffer_index
+		  (ad, comp[i & (txq->comp.size - 1)]));
+    }
+  n_held += txq->n_bufs;
+
+  if (vec_len (bufs) < n_held)
+    vlib_log_warn (af_xdp_main.log_class,
+		   "%U: queue %u: %u buffers held by the driver are lost",
+		   format_af_xdp_device_name, ad->dev_instance, qid,
+		   n_held - vec_len (bufs));
+
+  if (vec_len (bufs))
+    vlib_buffer_free (vm, bufs, vec_len (bufs));
+  vec_free (bufs);
+}
+
+void
+af_xdp_delete_if (vlib_main_t * vm, af_xdp_device_t * ad)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  af_xdp_main_t *axm = &af_xdp_main;
+  int i;
+
+  if (ad->hw_if_index)
+    {
+      vnet_hw_interface_set_flags (vnm, ad->hw_if_index, 0);
+      vec_foreach_index (i, ad->rxqs)
+	vnet_hw_interface_unassign_rx_thread (vnm, ad->hw_if_index, i);
+      ethernet_delete_interface (vnm, ad->hw_if_index);
+    }
+
+  /* stop the steering first, so the kernel keeps the traffic again */
+  if (ad->flags & AF_XDP_DEVICE_F_INITIALIZED)
+    af_xdp_bpf_detach (ad);
+
+  /* *INDENT-OFF* */
+  vec_foreach_index (i, ad->rxqs)
+    {
+      af_xdp_rxq_t *rxq = vec_elt_at_index (ad->rxqs, i);
+      af_xdp_txq_t *txq = vec_elt_at_index (ad->txqs, i);
+      af_xdp_queue_free_buffers (vm, ad, i);
+      af_xdp_ring_unmap (&rxq->fill);
+      af_xdp_ring_unmap (&rxq->rx);
+      af_xdp_ring_unmap (&txq->comp);
+      af_xdp_ring_unmap (&txq->tx);
+      if (rxq->fd >= 0)
+	close (rxq->fd);
+      clib_spinlock_free (&txq->lock);
+    }
+  /* *INDENT-ON* */
+  vec_free (ad->rxqs);
+  vec_free (ad->txqs);
+
+  af_xdp_bpf_unload (ad);
+
+  vec_free (ad->host_if_name);
+  clib_error_free (ad->error);
+  memset (ad, 0, sizeof (*ad));
+  pool_put (axm->devices, ad);
+}
+
+static clib_error_t *
+af_xdp_get_host_hwaddr (af_xdp_device_t * ad)
+{
+  struct ifreq ifr = { 0 };
+  clib_error_t *err = 0;
+  int fd;
+
+  if ((fd = socket (AF_UNIX, SOCK_DGRAM, 0)) < 0)
+    return clib_error_return_unix (0, "socket");
+
+  strncpy (ifr.ifr_name, (char *) ad->host_if_name, sizeof (ifr.ifr_name) - 1);
+  if (ioctl (fd, SIOCGIFHWADDR, &ifr) < 0)
+    err = clib_error_return_unix (0, "ioctl(SIOCGIFHWADDR)");
+  else
+    clib_memcpy (ad->hwaddr, ifr.ifr_hwaddr.sa_data, 6);
+
+  close (fd);
+  return err;
+}
+/*
+ * Before 5.8 copy mode receives at the umem headroom without adding
+ * XDP_PACKET_HEADROOM, which would put packet data over the buffer
+ * header.
+ */
+static clib_error_t *
+af_xdp_check_kernel (void)
+{
+  struct utsname u;
+  unsigned major = 0, minor = 0;
+
+  if (uname (&u) < 0)
+    return clib_error_return_unix (0, "uname");
+  if (sscanf (u.release, "%u.%u", &major, &minor) != 2)
+    return clib_error_return (0, "unknown kernel release %s", u.release);
+  if (major < 5 || (major == 5 && minor < 8))
+    return clib_error_return (0, "kernel %s is older than 5.8", u.release);
+  return 0;
+}
+
+void
+af_xdp_create_if (vlib_main_t * vm, af_xdp_create_if_args_t * args)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  af_xdp_main_t *axm = &af_xdp_main;
+  vlib_buffer_free_list_t *fl;
+  vlib_buffer_pool_t *bp;
+  af_xdp_device_t *ad;
+  af_xdp_flow_key_t all = { 0 };
+  clib_error_t *error = 0;
+  int i;
+
+  if (args->rxq_num == 0)
+    args->rxq_num = 1;
+
+  if (args->rxq_num > AF_XDP_MAX_QUEUES)
+    {
+      args->rv = VNET_API_ERROR_INVALID_VALUE;
+      args->error = clib_error_return (0, "too many queues (max %u)",
+				       AF_XDP_MAX_QUEUES);
+      return;
+    }
+
+  /* *INDENT-OFF* */
+  pool_foreach (ad, axm->devices, ({
+    if (!strcmp ((char *) ad->host_if_name, (char *) args->host_if_name))
+      {
+	args->rv = VNET_API_ERROR_INVALID_INTERFACE;
+	args->error = clib_error_return (0, "host-if %s already in use",
+					 args->host_if_name);
+	return;
+      }
+  }));
+  /* *INDENT-ON* */
+
+  pool_get (axm->devices, ad);
+  ad->dev_instance = ad - axm->devices;
+  ad->per_interface_next_index = ~0;
+  ad->host_if_name = format (0, "%s%c", args->host_if_name, 0);
+  ad->prog_fd = ad->xsks_map_fd = ad->flows_map_fd = -1;
+
+  vec_validate_aligned (ad->rxqs, args->rxq_num - 1, CLIB_CACHE_LINE_BYTES);
+  vec_validate_aligned (ad->txqs, args->rxq_num - 1, CLIB_CACHE_LINE_BYTES);
+  vec_foreach_index (i, ad->rxqs)
+  {
+    ad->rxqs[i].fd = ad->txqs[i].fd = -1;
+    if (args->rxq_num < tm->n_vlib_mains)
+      clib_spinlock_init (&ad->txqs[i].lock);
+  }
+  if (args->rxq_num < tm->n_vlib_mains)
+    ad->flags |= AF_XDP_DEVICE_F_SHARED_TXQ_LOCK;
+
+  if ((error = af_xdp_check_kernel ()))
+    goto error;
+
+  if ((ad->host_if_index = if_nametoindex ((char *) ad->host_if_name)) == 0)
+    {
+      error = clib_error_return_unix (0, "if_nametoindex");
+      goto error;
+    }
+
+  /* the umem must be the memory vlib_buffer_alloc hands out */
+  fl = vlib_buffer_get_free_list (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
+  bp = vlib_buffer_pool_get (fl->buffer_pool_index);
+  if (buffer_main.callbacks_registered || bp->buffer_size == 0)
+    {
+      error = clib_error_return (0, "buffers are not vlib native buffers");
+      goto error;
+    }
+  ad->umem_start = bp->start;
+  ad->umem_size = bp->size;
+  ad->umem_chunk_size = bp->buffer_size;
+
+  if ((error = af_xdp_get_host_hwaddr (ad)))
+    goto error;
+
+  if ((error = af_xdp_bpf_load (ad)))
+    goto error;
+
+  if (!args->steer_flows && (error = af_xdp_flow_add_del (ad, &all, 1)))
+    goto error;
+
+  if ((error = af_xdp_bpf_attach (ad, args->mode)))
+    goto error;
+  ad->flags |= AF_XDP_DEVICE_F_INITIALIZED;
+
+  vec_foreach_index (i, ad->rxqs)
+  {
+    if ((error = af_xdp_socket_init (ad, i, args->mode)))
+      goto error;
+    if ((error = af_xdp_bpf_set_xsk (ad, i, ad->rxqs[i].fd)))
+      goto error;
+  }
+
+  if ((error = vnet_netlink_set_link_state (ad->host_if_index, 1)))
+    goto error;
+
+  /* create interface */
+  error = ethernet_register_interface (vnm, af_xdp_device_class.index,
+				       ad->dev_instance, ad->hwaddr,
+				       &ad->hw_if_index, 0);
+  if (error)
+    goto error;
+
+  vnet_sw_interface_t *sw = vnet_get_hw_sw_interface (vnm, ad->hw_if_index);
+  ad->sw_if_index = sw->sw_if_index;
+
+  vnet_hw_interface_set_input_node (vnm, ad->hw_if_index,
+				    af_xdp_input_node.index);
+
+  vec_foreach_index (i, ad->rxqs)
+    vnet_hw_interface_assign_rx_thread (vnm, ad->hw_if_index, i, ~0);
+
+  args->sw_if_index = ad->sw_if_index;
+  return;
+
+error:
+  af_xdp_delete_if (vm, ad);
+  args->rv = VNET_API_ERROR_INVALID_INTERFACE;
+  args->error = clib_error_return (error, "host-if %s", args->host_if_name);
+  vlib_log_err (axm->log_class, "%U", format_clib_error, args->error);
+}
+
+static clib_error_t *
+af_xdp_interface_admin_up_down (vnet_main_t * vnm, u32 hw_if_index,
+				u32 flags)
+{
+  vnet_hw_interface_t *hi = vnet_get_hw_interface (vnm, hw_if_index);
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_device_t *ad = vec_elt_at_index (axm->devices, hi->dev_instance);
+  uword is_up = (flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) != 0;
+
+  if (ad->flags & AF_XDP_DEVICE_F_ERROR)
+    return clib_error_return (0, "device is in error state");
+
+  if (is_up)
+    {
+      vnet_hw_interface_set_flags (vnm, ad->hw_if_index,
+				   VNET_HW_INTERFACE_FLAG_LINK_UP);
+      ad->flags |= AF_XDP_DEVICE_F_ADMIN_UP;
+    }
+  else
+    {
+      vnet_hw_interface_set_flags (vnm, ad->hw_if_index, 0);
+      ad->flags &= ~AF_XDP_DEVICE_F_ADMIN_UP;
+    }
+  return 0;
+}
+
+static void
+af_xdp_set_interface_next_node (vnet_main_t * vnm, u32 hw_if_index,
+				u32 node_index)
+{
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, hw_if_index);
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_device_t *ad = pool_elt_at_index (axm->devices, hw->dev_instance);
+
+  /* Shut off redirection */
+  if (node_index == ~0)
+    {
+      ad->per_interface_next_index = node_index;
+      return;
+    }
+
+  ad->per_interface_next_index =
+    vlib_node_add_next (vlib_get_main (), af_xdp_input_node.index,
+			node_index);
+}
+
+static char *af_xdp_tx_func_error_strings[] = {
+#define _(n,s) s,
+  foreach_af_xdp_tx_func_error
+#undef _
+};
+
+/* *INDENT-OFF* */
+VNET_DEVICE_CLASS (af_xdp_device_class,) =
+{
+  .name = "AF_XDP interface",
+  .tx_function = af_xdp_interface_tx,
+  .tx_function_n_errors = AF_XDP_TX_N_ERROR,
+  .tx_function_error_strings = af_xdp_tx_func_error_strings,
+  .format_device = format_af_xdp_device,
+  .format_device_name = format_af_xdp_device_name,
+  .admin_up_down_function = af_xdp_interface_admin_up_down,
+  .rx_redirect_to_node = af_xdp_set_interface_next_node,
+};
+/* *INDENT-ON* */
+
+clib_error_t *
+af_xdp_init (vlib_main_t * vm)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+
+  vec_validate_aligned (axm->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+
+  axm->log_class = vlib_log_register_class ("af_xdp_plugin", 0);
+  vlib_log_debug (axm->log_class, "initialized");
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (af_xdp_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
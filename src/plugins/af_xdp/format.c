@@ -0,0 +1,132 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/ip/ip.h>
+
+#include <af_xdp/af_xdp.h>
+
+u8 *
+format_af_xdp_device_name (u8 * s, va_list * args)
+{
+  u32 i = va_arg (*args, u32);
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_device_t *ad = vec_elt_at_index (axm->devices, i);
+
+  s = format (s, "af_xdp-%s", ad->host_if_name);
+  return s;
+}
+
+static u8 *
+format_af_xdp_device_flags (u8 * s, va_list * args)
+{
+  af_xdp_device_t *ad = va_arg (*args, af_xdp_device_t *);
+  u8 *t = 0;
+
+#define _(a, b, c) if (ad->flags & (1 << a)) \
+t = format (t, "%s%s", t ? " ":"", c);
+  foreach_af_xdp_device_flags
+#undef _
+    s = format (s, "%v", t);
+  vec_free (t);
+  return s;
+}
+
+u8 *
+format_af_xdp_flow_key (u8 * s, va_list * args)
+{
+  af_xdp_flow_key_t *k = va_arg (*args, af_xdp_flow_key_t *);
+  u16 ethertype = clib_net_to_host_u16 (k->ethertype);
+
+  if (ethertype == 0)
+    return format (s, "all");
+
+  if (ethertype == ETHERNET_TYPE_IP4)
+    s = format (s, "ip4");
+  else if (ethertype == ETHERNET_TYPE_IP6)
+    s = format (s, "ip6");
+  else
+    s = format (s, "ethertype 0x%04x", ethertype);
+
+  if (k->protocol)
+    s = format (s, " proto %U", format_ip_protocol, k->protocol);
+  if (k->port)
+    s = format (s, " port %u", clib_net_to_host_u16 (k->port));
+  return s;
+}
+
+u8 *
+format_af_xdp_device (u8 * s, va_list * args)
+{
+  u32 i = va_arg (*args, u32);
+  int verbose = va_arg (*args, int);
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_device_t *ad = vec_elt_at_index (axm->devices, i);
+  u32 indent = format_get_indent (s);
+  af_xdp_flow_key_t *k;
+  int q;
+
+  s = format (s, "flags: %U", format_af_xdp_device_flags, ad);
+  s = format (s, "\n%Uhost-if %s (%d) rx-queues %u tx-queues %u",
+	      format_white_space, indent, ad->host_if_name,
+	      ad->host_if_index, vec_len (ad->rxqs), vec_len (ad->txqs));
+  if (ad->error)
+    s = format (s, "\n%Uerror %U", format_white_space, indent,
+		format_clib_error, ad->error);
+
+  if (!verbose)
+    return s;
+
+  vec_foreach_index (q, ad->rxqs)
+    s = format (s, "\n%Uqueue %u: fd %d rx-bufs %u tx-bufs %u",
+		format_white_space, indent, q, ad->rxqs[q].fd,
+		ad->rxqs[q].n_bufs, ad->txqs[q].n_bufs);
+
+  s = format (s, "\n%Usteered flows:", format_white_space, indent);
+  vec_foreach (k, ad->flows)
+    s = format (s, "\n%U%-32U %llu packets", format_white_space, indent + 2,
+		format_af_xdp_flow_key, k, af_xdp_flow_hits (ad, k));
+  return s;
+}
+
+u8 *
+format_af_xdp_input_trace (u8 * s, va_list * args)
+{
+  vlib_main_t *vm = va_arg (*args, vlib_main_t *);
+  vlib_node_t *node = va_arg (*args, vlib_node_t *);
+  af_xdp_input_trace_t *t = va_arg (*args, af_xdp_input_trace_t *);
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_hw_interface_t *hi = vnet_get_hw_interface (vnm, t->hw_if_index);
+  u32 indent = format_get_indent (s);
+
+  s = format (s, "af_xdp: %v (%d) next-node %U",
+	      hi->name, t->hw_if_index, format_vlib_next_node_name, vm,
+	      node->index, t->next_index);
+  s = format (s, "\n%Uqueue %u length %u", format_white_space, indent + 2,
+	      t->qid, t->len);
+
+  return s;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
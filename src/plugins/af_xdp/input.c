@@ -0,0 +1,258 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <sys/socket.h>
+
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/devices/devices.h>
+
+#include <af_xdp/af_xdp.h>
+
+#define foreach_af_xdp_input_error \
+  _(BUFFER_ALLOC, "buffer alloc error") \
+  _(BAD_DESC, "descriptor offset inside buffer header")
+
+typedef enum
+{
+#define _(f,s) AF_XDP_INPUT_ERROR_##f,
+  foreach_af_xdp_input_error
+#undef _
+    AF_XDP_INPUT_N_ERROR,
+} af_xdp_input_error_t;
+
+static __clib_unused char *af_xdp_input_error_strings[] = {
+#define _(n,s) s,
+  foreach_af_xdp_input_error
+#undef _
+};
+
+#define AF_XDP_INPUT_REFILL_TRESHOLD 32
+
+/*
+ * Give the kernel buffers to receive into, keeping all the buffers it
+ * holds, received or not, within one fill ring.
+ */
+static_always_inline void
+af_xdp_rxq_refill (vlib_main_t * vm, vlib_node_runtime_t * node,
+		   af_xdp_device_t * ad, af_xdp_rxq_t * rxq)
+{
+  af_xdp_ring_t *fill = &rxq->fill;
+  u64 *addrs = fill->descs;
+  u32 n_refill, n_alloc, mask, i;
+
+  n_refill = fill->size - rxq->n_bufs;
+  if (PREDICT_TRUE (n_refill < AF_XDP_INPUT_REFILL_TRESHOLD))
+    return;
+
+  u32 buffers[n_refill];
+
+  n_refill &= ~7;		/* round to 8 */
+  n_alloc = vlib_buffer_alloc (vm, buffers, n_refill);
+
+  if (PREDICT_FALSE (n_alloc != n_refill))
+    {
+      vlib_error_count (vm, node->node_index,
+			AF_XDP_INPUT_ERROR_BUFFER_ALLOC, 1);
+      if (n_alloc == 0)
+	return;
+    }
+
+  mask = fill->size - 1;
+  for (i = 0; i < n_alloc; i++)
+    addrs[(fill->next + i) & mask] =
+      af_xdp_buffer_index_to_addr (ad, buffers[i]);
+
+  fill->next += n_alloc;
+  __atomic_store_n (fill->producer, fill->next, __ATOMIC_RELEASE);
+  rxq->n_bufs += n_alloc;
+
+  if (*fill->flags & XDP_RING_NEED_WAKEUP)
+    recvfrom (rxq->fd, 0, 0, MSG_DONTWAIT, 0, 0);
+}
+
+static_always_inline uword
+af_xdp_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			    vlib_frame_t * frame, af_xdp_device_t * ad,
+			    u16 qid)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 thr_idx = vlib_get_thread_index ();
+  af_xdp_per_thread_data_t *ptd =
+    vec_elt_at_index (axm->per_thread_data, thr_idx);
+  af_xdp_rxq_t *rxq = vec_elt_at_index (ad->rxqs, qid);
+  af_xdp_ring_t *rx = &rxq->rx;
+  struct xdp_desc *descs = rx->descs;
+  u64 *fill = rxq->fill.descs;
+  u32 mask = rx->size - 1;
+  u32 n_rx_packets = 0, n_rx_bytes = 0, n_descs, n_bad = 0, i;
+  u32 buffer_indices[VLIB_FRAME_SIZE];
+  u16 nexts[VLIB_FRAME_SIZE];
+  vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
+  vlib_buffer_t *bt = &ptd->buffer_template;
+  u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+  i16 current_data[VLIB_FRAME_SIZE];
+  u16 lengths[VLIB_FRAME_SIZE];
+  uword n_trace;
+
+  n_descs = __atomic_load_n (rx->producer, __ATOMIC_ACQUIRE) - rx->next;
+  n_descs = clib_min (n_descs, VLIB_FRAME_SIZE);
+
+  if (n_descs == 0)
+    goto refill;
+
+  /* the kernel may reuse the slots once the consumer index is released */
+  for (i = 0; i < n_descs; i++)
+    {
+      struct xdp_desc *d = descs + ((rx->next + i) & mask);
+      u32 bi = af_xdp_addr_to_buffer_index (ad, d->addr);
+      i16 cd = af_xdp_addr_to_current_data (d->addr);
+
+      /* data written over the buffer header, the buffer goes straight
+         back to the kernel without touching its header */
+      if (PREDICT_FALSE (cd < 0))
+	{
+	  fill[rxq->fill.next++ & (rxq->fill.size - 1)] =
+	    af_xdp_buffer_index_to_addr (ad, bi);
+	  n_bad++;
+	  continue;
+	}
+      buffer_indices[n_rx_packets] = bi;
+      current_data[n_rx_packets] = cd;
+      lengths[n_rx_packets] = d->len;
+      n_rx_packets++;
+    }
+  rx->next += n_descs;
+  __atomic_store_n (rx->consumer, rx->next, __ATOMIC_RELEASE);
+  rxq->n_bufs -= n_rx_packets;
+
+  if (PREDICT_FALSE (n_bad))
+    {
+      __atomic_store_n (rxq->fill.producer, rxq->fill.next,
+			__ATOMIC_RELEASE);
+      vlib_error_count (vm, node->node_index, AF_XDP_INPUT_ERROR_BAD_DESC,
+			n_bad);
+      if (n_rx_packets == 0)
+	goto refill;
+    }
+
+  vlib_get_buffers (vm, buffer_indices, bufs, n_rx_packets);
+
+  vnet_buffer (bt)->sw_if_index[VLIB_RX] = ad->sw_if_index;
+  vnet_buffer (bt)->sw_if_index[VLIB_TX] = ~0;
+
+  if (PREDICT_FALSE (ad->per_interface_next_index != ~0))
+    next_index = ad->per_interface_next_index;
+
+  /* as all packets belong to the same interface feature arc lookup
+     can be done once and result stored */
+  if (PREDICT_FALSE (vnet_device_input_have_features (ad->sw_if_index)))
+    vnet_feature_start_device_input_x1 (ad->sw_if_index, &next_index, bt);
+
+  b = bufs;
+  for (i = 0; i < n_rx_packets; i++)
+    {
+      if (i + 4 < n_rx_packets)
+	vlib_prefetch_buffer_header (b[4], STORE);
+
+      b[0]->current_data = current_data[i];
+      b[0]->current_length = lengths[i];
+      n_rx_bytes += lengths[i];
+      b[0]->current_config_index = bt->current_config_index;
+      vnet_buffer (b[0])->feature_arc_index =
+	vnet_buffer (bt)->feature_arc_index;
+      clib_memcpy (vnet_buffer (b[0])->sw_if_index,
+		   vnet_buffer (bt)->sw_if_index, 2 * sizeof (u32));
+      VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b[0]);
+      b++;
+    }
+  vnet_buffer (bt)->feature_arc_index = 0;
+  bt->current_config_index = 0;
+
+  clib_memset_u16 (nexts, next_index, n_rx_packets);
+
+  /* packet trace if enabled */
+  if (PREDICT_FALSE ((n_trace = vlib_get_trace_count (vm, node))))
+    {
+      for (i = 0; n_trace && i < n_rx_packets; i++)
+	{
+	  af_xdp_input_trace_t *tr;
+	  vlib_trace_buffer (vm, node, nexts[i], bufs[i],
+			     /* follow_chain */ 0);
+	  tr = vlib_add_trace (vm, node, bufs[i], sizeof (*tr));
+	  tr->next_index = nexts[i];
+	  tr->hw_if_index = ad->hw_if_index;
+	  tr->qid = qid;
+	  tr->len = lengths[i];
+	  n_trace--;
+	}
+      vlib_set_trace_count (vm, node, n_trace);
+    }
+
+  vlib_buffer_enqueue_to_next (vm, node, buffer_indices, nexts, n_rx_packets);
+  vlib_increment_combined_counter (vnm->interface_main.combined_sw_if_counters
+				   + VNET_INTERFACE_COUNTER_RX, thr_idx,
+				   ad->hw_if_index, n_rx_packets, n_rx_bytes);
+
+refill:
+  af_xdp_rxq_refill (vm, node, ad, rxq);
+  return n_rx_packets;
+}
+
+VLIB_NODE_FN (af_xdp_input_node) (vlib_main_t * vm,
+				  vlib_node_runtime_t * node,
+				  vlib_frame_t * frame)
+{
+  u32 n_rx = 0;
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_device_input_runtime_t *rt = (void *) node->runtime_data;
+  vnet_device_and_queue_t *dq;
+
+  foreach_device_and_queue (dq, rt->devices_and_queues)
+  {
+    af_xdp_device_t *ad;
+    ad = vec_elt_at_index (axm->devices, dq->dev_instance);
+    if ((ad->flags & AF_XDP_DEVICE_F_ADMIN_UP) == 0)
+      continue;
+    n_rx += af_xdp_device_input_inline (vm, node, frame, ad, dq->queue_id);
+  }
+  return n_rx;
+}
+
+#ifndef CLIB_MARCH_VARIANT
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (af_xdp_input_node) = {
+  .name = "af_xdp-input",
+  .sibling_of = "device-input",
+  .format_trace = format_af_xdp_input_trace,
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+  .n_errors = AF_XDP_INPUT_N_ERROR,
+  .error_strings = af_xdp_input_error_strings,
+};
+/* *INDENT-ON* */
+#endif
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,183 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/devices/devices.h>
+
+#include <af_xdp/af_xdp.h>
+
+/* Take back the buffers the kernel has sent */
+static_always_inline void
+af_xdp_txq_complete (vlib_main_t * vm, af_xdp_device_t * ad,
+		     af_xdp_txq_t * txq)
+{
+  af_xdp_ring_t *comp = &txq->comp;
+  u64 *addrs = comp->descs;
+  u32 n_done, mask = comp->size - 1, i;
+
+  n_done = __atomic_load_n (comp->producer, __ATOMIC_ACQUIRE) - comp->next;
+  if (n_done == 0)
+    return;
+
+  u32 buffers[n_done];
+
+  for (i = 0; i < n_done; i++)
+    buffers[i] = af_xdp_addr_to_buffer_index
+      (ad, addrs[(comp->next + i) & mask]);
+  comp->next += n_done;
+  __atomic_store_n (comp->consumer, comp->next, __ATOMIC_RELEASE);
+  txq->n_bufs -= n_done;
+
+  vlib_buffer_free_no_next (vm, buffers, n_done);
+}
+
+/*
+ * A descriptor holds one buffer, so chained packets are copied into a
+ * single buffer. Returns the buffer to send, or ~0 if it does not fit.
+ */
+static_always_inline u32
+af_xdp_tx_linearize (vlib_main_t * vm, u32 bi)
+{
+  vlib_buffer_t *b = vlib_get_buffer (vm, bi), *nb;
+  u32 nbi;
+
+  if (vlib_buffer_length_in_chain (vm, b) > VLIB_BUFFER_DATA_SIZE)
+    return ~0;
+  if (vlib_buffer_alloc (vm, &nbi, 1) != 1)
+    return ~0;
+
+  nb = vlib_get_buffer (vm, nbi);
+  nb->current_data = 0;
+  nb->current_length = vlib_buffer_contents (vm, bi, nb->data);
+  vlib_buffer_free (vm, &bi, 1);
+  return nbi;
+}
+
+uword
+CLIB_MULTIARCH_FN (af_xdp_interface_tx) (vlib_main_t * vm,
+					 vlib_node_runtime_t * node,
+					 vlib_frame_t * frame)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_interface_output_runtime_t *rd = (void *) node->runtime_data;
+  af_xdp_device_t *ad = pool_elt_at_index (axm->devices, rd->dev_instance);
+  u32 thread_index = vlib_get_thread_index ();
+  af_xdp_txq_t *txq =
+    vec_elt_at_index (ad->txqs, thread_index % vec_len (ad->txqs));
+  af_xdp_ring_t *tx = &txq->tx;
+  struct xdp_desc *descs = tx->descs;
+  u32 *buffers = vlib_frame_args (frame);
+  u32 n_left = frame->n_vectors;
+  u32 mask = tx->size - 1;
+  u32 n_tx = 0, n_too_long = 0, n_free;
+  u32 too_long[VLIB_FRAME_SIZE];
+
+  clib_spinlock_lock_if_init (&txq->lock);
+
+  af_xdp_txq_complete (vm, ad, txq);
+
+  /* buffers waiting for completion count too, so the
+     completion ring cannot overflow */
+  n_free = tx->size - txq->n_bufs;
+
+  while (n_left && n_tx < n_free)
+    {
+      u32 bi = buffers[0];
+      vlib_buffer_t *b = vlib_get_buffer (vm, bi);
+      struct xdp_desc *d;
+
+      if (PREDICT_FALSE (b->flags & VLIB_BUFFER_NEXT_PRESENT))
+	{
+	  if ((bi = af_xdp_tx_linearize (vm, bi)) == ~0)
+	    {
+	      too_long[n_too_long++] = buffers[0];
+	      buffers++;
+	      n_left--;
+	      continue;
+	    }
+	  b = vlib_get_buffer (vm, bi);
+	}
+
+      d = descs + ((tx->next + n_tx) & mask);
+      d->addr = af_xdp_buffer_index_to_addr (ad, bi) |
+	((u64) (sizeof (vlib_buffer_t) + b->current_data) <<
+	 XSK_UNALIGNED_BUF_OFFSET_SHIFT);
+      d->len = b->current_length;
+      d->options = 0;
+
+      n_tx++;
+      buffers++;
+      n_left--;
+    }
+
+  tx->next += n_tx;
+  __atomic_store_n (tx->producer, tx->next, __ATOMIC_RELEASE);
+  txq->n_bufs += n_tx;
+
+  /* copy mode always, and zero copy drivers when idle, need a kick */
+  if (n_tx && (*tx->flags & XDP_RING_NEED_WAKEUP) &&
+      sendto (txq->fd, 0, 0, MSG_DONTWAIT, 0, 0) < 0 &&
+      errno != EAGAIN && errno != EBUSY && errno != ENOBUFS &&
+      errno != ENETDOWN)
+    vlib_error_count (vm, node->node_index, AF_XDP_TX_ERROR_SENDTO, 1);
+
+  clib_spinlock_unlock_if_init (&txq->lock);
+
+  if (PREDICT_FALSE (n_too_long))
+    {
+      vlib_error_count (vm, node->node_index, AF_XDP_TX_ERROR_TOO_LONG,
+			n_too_long);
+      vlib_buffer_free (vm, too_long, n_too_long);
+    }
+
+  if (PREDICT_FALSE (n_left))
+    {
+      vlib_error_count (vm, node->node_index, AF_XDP_TX_ERROR_NO_FREE_SLOTS,
+			n_left);
+      vlib_buffer_free (vm, buffers, n_left);
+    }
+
+  return n_tx;
+}
+
+#ifndef CLIB_MARCH_VARIANT
+#if __x86_64__
+vlib_node_function_t __clib_weak af_xdp_interface_tx_avx512;
+vlib_node_function_t __clib_weak af_xdp_interface_tx_avx2;
+static void __clib_constructor
+af_xdp_interface_tx_multiarch_select (void)
+{
+  if (af_xdp_interface_tx_avx512 && clib_cpu_supports_avx512f ())
+    af_xdp_device_class.tx_function = af_xdp_interface_tx_avx512;
+  else if (af_xdp_interface_tx_avx2 && clib_cpu_supports_avx2 ())
+    af_xdp_device_class.tx_function = af_xdp_interface_tx_avx2;
+}
+#endif
+#endif
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -26,7 +26,8 @@
   _(3, IOVA, "iova") \
   _(4, LINK_UP, "link-up") \
   _(5, SHARED_TXQ_LOCK, "shared-txq-lock") \
-  _(6, ELOG, "elog")
+  _(6, ELOG, "elog") \
+  _(7, RX_FLOW_OFFLOAD, "rx-flow-offload")
 
 enum
 {
@@ -76,6 +77,21 @@ typedef struct
   u16 n_bufs;
 } avf_txq_t;
 
+typedef struct
+{
+  u32 flow_index;
+  u32 mark;
+  /* rule id returned by the PF */
+  u32 fdir_id;
+} avf_flow_entry_t;
+
+typedef struct
+{
+  u32 flow_id;
+  u16 next_index;
+  i16 buffer_advance;
+} avf_flow_lookup_entry_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -113,6 +129,12 @@ typedef struct
   u32 rss_lut_size;
   virtchnl_link_speed_t link_speed;
 
+  /* flow related */
+  avf_flow_entry_t *flow_entries;	/* pool */
+  avf_flow_lookup_entry_t *flow_lookup_entries;	/* pool */
+  u32 *parked_lookup_indexes;	/* vector */
+  u32 parked_loop_count;
+
   /* stats */
   virtchnl_eth_stats_t eth_stats;
 
@@ -143,6 +165,8 @@ typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   avf_rx_vector_entry_t rx_vector[AVF_RX_VECTOR_SZ];
+  /* flow director rule mark of each packet, 0 if none */
+  u32 fdir_marks[AVF_RX_VECTOR_SZ];
   u32 *to_free;
   vlib_buffer_t buffer_template;
 } avf_per_thread_data_t;
@@ -151,9 +175,13 @@ typedef struct
 {
   u8 next_node;
   i8 buffer_advance;
+  /* tcp or udp, the hardware validates the l4 checksum */
+  u8 l4_csum;
   u32 flags;
 } avf_ptype_t;
 
+STATIC_ASSERT_SIZEOF (avf_ptype_t, 8);
+
 STATIC_ASSERT (VNET_DEVICE_INPUT_N_NEXT_NODES < 256, "too many next nodes");
 
 typedef struct
@@ -175,6 +203,7 @@ typedef struct
 {
   vlib_pci_addr_t addr;
   int enable_elog;
+  u16 rxq_num;
   /* return */
   int rv;
   clib_error_t *error;
@@ -188,6 +217,26 @@ extern vnet_device_class_t avf_device_class;
 uword avf_interface_tx (vlib_main_t * vm, vlib_node_runtime_t * node,
 			vlib_frame_t * frame);
 
+#define foreach_avf_tx_func_error \
+  _(NO_FREE_SLOTS, "no free tx slots") \
+  _(TOO_MANY_SEGMENTS, "too many buffers in chain")
+
+typedef enum
+{
+#define _(f,s) AVF_TX_ERROR_##f,
+  foreach_avf_tx_func_error
+#undef _
+    AVF_TX_N_ERROR,
+} avf_tx_func_error_t;
+
+clib_error_t *avf_send_to_pf (vlib_main_t * vm, avf_device_t * ad,
+			      virtchnl_ops_t op, void *in, int in_len,
+			      void *out, int out_len);
+
+/* flow.c */
+vnet_flow_dev_ops_function_t avf_flow_ops_fn;
+format_function_t format_avf_flow;
+
 /* format.c */
 format_function_t format_avf_device;
 format_function_t format_avf_device_name;
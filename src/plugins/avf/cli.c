@@ -32,6 +32,7 @@ avf_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 {
   unformat_input_t _line_input, *line_input = &_line_input;
   avf_create_if_args_t args;
+  u32 tmp;
 
   memset (&args, 0, sizeof (avf_create_if_args_t));
 
@@ -45,6 +46,8 @@ avf_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 	;
       else if (unformat (line_input, "elog"))
 	args.enable_elog = 1;
+      else if (unformat (line_input, "num-rx-queues %u", &tmp))
+	args.rxq_num = tmp;
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
@@ -60,7 +63,8 @@ avf_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (avf_create_command, static) = {
   .path = "create interface avf",
-  .short_help = "create interface avf <pci-address>",
+  .short_help = "create interface avf <pci-address> "
+    "[num-rx-queues <n>] [elog]",
   .function = avf_create_command_fn,
 };
 /* *INDENT-ON* */
@@ -22,10 +22,13 @@
 
 #include <avf/avf.h>
 
-#define AVF_MBOX_LEN 64
-#define AVF_MBOX_BUF_SZ 512
+#define AVF_MBOX_LEN 32
+#define AVF_MBOX_BUF_SZ 4096
+/* buffers above this size need the large buffer flag */
+#define AVF_MBOX_SMALL_BUF_SZ 512
 #define AVF_RXQ_SZ 512
 #define AVF_TXQ_SZ 512
+#define AVF_MAX_RXQ_NUM 16
 #define AVF_ITR_INT 8160
 
 #define PCI_VENDOR_ID_INTEL			0x8086
@@ -119,6 +122,8 @@ avf_aq_desc_enq (vlib_main_t * vm, avf_device_t * ad, avf_aq_desc_t * dt,
       clib_memcpy (ad->atq_bufs + ad->atq_next_slot * AVF_MBOX_BUF_SZ, data,
 		   len);
       d->flags |= AVF_AQ_F_BUF;
+      if (len > AVF_MBOX_SMALL_BUF_SZ)
+	d->flags |= AVF_AQ_F_LB;
     }
 
   if (ad->flags & AVF_DEVICE_F_ELOG)
@@ -295,7 +300,7 @@ avf_arq_slot_init (avf_device_t * ad, u16 slot)
   u64 pa = ad->arq_bufs_pa + slot * AVF_MBOX_BUF_SZ;
   d = &ad->arq[slot];
   memset (d, 0, sizeof (avf_aq_desc_t));
-  d->flags = AVF_AQ_F_BUF;
+  d->flags = AVF_AQ_F_BUF | AVF_AQ_F_LB;
   d->datalen = AVF_MBOX_BUF_SZ;
   d->addr_hi = (u32) (pa >> 32);
   d->addr_lo = (u32) pa;
@@ -480,7 +485,7 @@ avf_op_get_vf_resources (vlib_main_t * vm, avf_device_t * ad,
 {
   u32 bitmap = (VIRTCHNL_VF_OFFLOAD_L2 | VIRTCHNL_VF_OFFLOAD_RSS_PF |
 		VIRTCHNL_VF_OFFLOAD_WB_ON_ITR | VIRTCHNL_VF_OFFLOAD_VLAN |
-		VIRTCHNL_VF_OFFLOAD_RX_POLLING);
+		VIRTCHNL_VF_OFFLOAD_RX_POLLING | VIRTCHNL_VF_OFFLOAD_FDIR_PF);
 
   return avf_send_to_pf (vm, ad, VIRTCHNL_OP_GET_VF_RESOURCES, &bitmap,
 			 sizeof (u32), res, sizeof (virtchnl_vf_resource_t));
@@ -490,6 +495,7 @@ clib_error_t *
 avf_op_config_rss_lut (vlib_main_t * vm, avf_device_t * ad)
 {
   int msg_len = sizeof (virtchnl_rss_lut_t) + ad->rss_lut_size - 1;
+  int i;
   u8 msg[msg_len];
   virtchnl_rss_lut_t *rl;
 
@@ -498,10 +504,51 @@ avf_op_config_rss_lut (vlib_main_t * vm, avf_device_t * ad)
   rl->vsi_id = ad->vsi_id;
   rl->lut_entries = ad->rss_lut_size;
 
+  /* spread flows evenly over the rx queues */
+  for (i = 0; i < ad->rss_lut_size; i++)
+    rl->lut[i] = i % vec_len (ad->rxqs);
+
   return avf_send_to_pf (vm, ad, VIRTCHNL_OP_CONFIG_RSS_LUT, msg, msg_len, 0,
 			 0);
 }
 
+clib_error_t *
+avf_op_config_rss_key (vlib_main_t * vm, avf_device_t * ad)
+{
+  int msg_len = sizeof (virtchnl_rss_key_t) + ad->rss_key_size - 1;
+  u32 seed = (u32) clib_cpu_time_now ();
+  int i;
+  u8 msg[msg_len];
+  virtchnl_rss_key_t *rk;
+
+  memset (msg, 0, msg_len);
+  rk = (virtchnl_rss_key_t *) msg;
+  rk->vsi_id = ad->vsi_id;
+  rk->key_len = ad->rss_key_size;
+
+  for (i = 0; i < ad->rss_key_size; i++)
+    rk->key[i] = random_u32 (&seed);
+
+  return avf_send_to_pf (vm, ad, VIRTCHNL_OP_CONFIG_RSS_KEY, msg, msg_len, 0,
+			 0);
+}
+
+clib_error_t *
+avf_op_get_rss_hena_caps (vlib_main_t * vm, avf_device_t * ad,
+			  virtchnl_rss_hena_t * hena)
+{
+  return avf_send_to_pf (vm, ad, VIRTCHNL_OP_GET_RSS_HENA_CAPS, 0, 0, hena,
+			 sizeof (virtchnl_rss_hena_t));
+}
+
+clib_error_t *
+avf_op_set_rss_hena (vlib_main_t * vm, avf_device_t * ad,
+		     virtchnl_rss_hena_t * hena)
+{
+  return avf_send_to_pf (vm, ad, VIRTCHNL_OP_SET_RSS_HENA, hena,
+			 sizeof (virtchnl_rss_hena_t), 0, 0);
+}
+
 clib_error_t *
 avf_op_disable_vlan_stripping (vlib_main_t * vm, avf_device_t * ad)
 {
@@ -553,10 +600,10 @@ avf_op_config_vsi_queues (vlib_main_t * vm, avf_device_t * ad)
 	  avf_reg_write (ad, AVF_QRX_TAIL (i), q->size - 1);
 	}
 
-      avf_txq_t *q = vec_elt_at_index (ad->txqs, i);
       txq->vsi_id = ad->vsi_id;
       if (i < vec_len (ad->txqs))
 	{
+	  avf_txq_t *q = vec_elt_at_index (ad->txqs, i);
 	  txq->queue_id = i;
 	  txq->ring_len = q->size;
 	  txq->dma_ring_addr = avf_dma_addr (vm, ad, q->descs);
@@ -582,7 +629,7 @@ avf_op_config_irq_map (vlib_main_t * vm, avf_device_t * ad)
 
   imi->vecmap[0].vector_id = 1;
   imi->vecmap[0].vsi_id = ad->vsi_id;
-  imi->vecmap[0].rxq_map = 1;
+  imi->vecmap[0].rxq_map = pow2_mask (vec_len (ad->rxqs));
   return avf_send_to_pf (vm, ad, VIRTCHNL_OP_CONFIG_IRQ_MAP, msg, msg_len, 0,
 			 0);
 }
@@ -611,11 +658,16 @@ clib_error_t *
 avf_op_enable_queues (vlib_main_t * vm, avf_device_t * ad, u32 rx, u32 tx)
 {
   virtchnl_queue_select_t qs = { 0 };
+  int i;
   qs.vsi_id = ad->vsi_id;
   qs.rx_queues = rx;
   qs.tx_queues = tx;
-  avf_rxq_t *rxq = vec_elt_at_index (ad->rxqs, 0);
-  avf_reg_write (ad, AVF_QRX_TAIL (0), rxq->n_bufs);
+  for (i = 0; i < vec_len (ad->rxqs); i++)
+    if (rx & (1 << i))
+      {
+	avf_rxq_t *rxq = vec_elt_at_index (ad->rxqs, i);
+	avf_reg_write (ad, AVF_QRX_TAIL (i), rxq->n_bufs);
+      }
   return avf_send_to_pf (vm, ad, VIRTCHNL_OP_ENABLE_QUEUES, &qs,
 			 sizeof (virtchnl_queue_select_t), 0, 0);
 }
@@ -658,12 +710,15 @@ retry:
 }
 
 clib_error_t *
-avf_device_init (vlib_main_t * vm, avf_device_t * ad)
+avf_device_init (vlib_main_t * vm, avf_device_t * ad,
+		 avf_create_if_args_t * args)
 {
   virtchnl_version_info_t ver = { 0 };
   virtchnl_vf_resource_t res = { 0 };
+  virtchnl_rss_hena_t hena = { 0 };
   clib_error_t *error;
   vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u16 rxq_num;
   int i;
 
   avf_adminq_init (vm, ad);
@@ -712,15 +767,36 @@ avf_device_init (vlib_main_t * vm, avf_device_t * ad)
   if ((error = avf_config_promisc_mode (vm, ad)))
     return error;
 
-  if ((ad->feature_bitmap & VIRTCHNL_VF_OFFLOAD_RSS_PF) &&
-      (error = avf_op_config_rss_lut (vm, ad)))
-    return error;
-
   /*
    * Init Queues
    */
-  if ((error = avf_rxq_init (vm, ad, 0)))
-    return error;
+  /* one rx queue per worker unless asked otherwise */
+  rxq_num = args->rxq_num;
+  if (rxq_num == 0)
+    rxq_num = clib_max (1, tm->n_vlib_mains - 1);
+  if ((ad->feature_bitmap & VIRTCHNL_VF_OFFLOAD_RSS_PF) == 0)
+    rxq_num = 1;
+  rxq_num = clib_min (rxq_num, clib_min (ad->num_queue_pairs,
+					 AVF_MAX_RXQ_NUM));
+
+  for (i = 0; i < rxq_num; i++)
+    if ((error = avf_rxq_init (vm, ad, i)))
+      return error;
+
+  if (ad->feature_bitmap & VIRTCHNL_VF_OFFLOAD_RSS_PF)
+    {
+      if ((error = avf_op_config_rss_key (vm, ad)))
+	return error;
+
+      if ((error = avf_op_config_rss_lut (vm, ad)))
+	return error;
+
+      if ((error = avf_op_get_rss_hena_caps (vm, ad, &hena)))
+	return error;
+
+      if ((error = avf_op_set_rss_hena (vm, ad, &hena)))
+	return error;
+    }
 
   for (i = 0; i < tm->n_vlib_mains; i++)
     if ((error = avf_txq_init (vm, ad, i)))
@@ -738,7 +814,7 @@ avf_device_init (vlib_main_t * vm, avf_device_t * ad)
   if ((error = avf_op_add_eth_addr (vm, ad, 1, ad->hwaddr)))
     return error;
 
-  if ((error = avf_op_enable_queues (vm, ad, 1, 0)))
+  if ((error = avf_op_enable_queues (vm, ad, pow2_mask (rxq_num), 0)))
     return error;
 
   if ((error = avf_op_enable_queues (vm, ad, 0, 1)))
@@ -1013,7 +1089,8 @@ avf_delete_if (vlib_main_t * vm, avf_device_t * ad)
   if (ad->hw_if_index)
     {
       vnet_hw_interface_set_flags (vnm, ad->hw_if_index, 0);
-      vnet_hw_interface_unassign_rx_thread (vnm, ad->hw_if_index, 0);
+      vec_foreach_index (i, ad->rxqs)
+	vnet_hw_interface_unassign_rx_thread (vnm, ad->hw_if_index, i);
       ethernet_delete_interface (vnm, ad->hw_if_index);
     }
 
@@ -1053,6 +1130,10 @@ avf_delete_if (vlib_main_t * vm, avf_device_t * ad)
   /* *INDENT-ON* */
   vec_free (ad->txqs);
 
+  pool_free (ad->flow_entries);
+  pool_free (ad->flow_lookup_entries);
+  vec_free (ad->parked_lookup_indexes);
+
   clib_error_free (ad->error);
   memset (ad, 0, sizeof (*ad));
   pool_put (am->devices, ad);
@@ -1066,6 +1147,7 @@ avf_create_if (vlib_main_t * vm, avf_create_if_args_t * args)
   avf_device_t *ad;
   vlib_pci_dev_handle_t h;
   clib_error_t *error = 0;
+  int i;
 
   pool_get (am->devices, ad);
   ad->dev_instance = ad - am->devices;
@@ -1141,7 +1223,7 @@ avf_create_if (vlib_main_t * vm, avf_create_if_args_t * args)
   /* FIXME detect */
   ad->flags |= AVF_DEVICE_F_IOVA;
 
-  if ((error = avf_device_init (vm, ad)))
+  if ((error = avf_device_init (vm, ad, args)))
     goto error;
 
   /* create interface */
@@ -1155,9 +1237,16 @@ avf_create_if (vlib_main_t * vm, avf_create_if_args_t * args)
   vnet_sw_interface_t *sw = vnet_get_hw_sw_interface (vnm, ad->hw_if_index);
   ad->sw_if_index = sw->sw_if_index;
 
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, ad->hw_if_index);
+  hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD |
+    VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO;
+
   vnet_hw_interface_set_input_node (vnm, ad->hw_if_index,
 				    avf_input_node.index);
 
+  vec_foreach_index (i, ad->rxqs)
+    vnet_hw_interface_assign_rx_thread (vnm, ad->hw_if_index, i, ~0);
+
   if (pool_elts (am->devices) == 1)
     vlib_process_signal_event (vm, avf_process_node.index,
 			       AVF_PROCESS_EVENT_START, 0);
@@ -1188,7 +1277,6 @@ avf_interface_admin_up_down (vnet_main_t * vnm, u32 hw_if_index, u32 flags)
       vnet_hw_interface_set_flags (vnm, ad->hw_if_index,
 				   VNET_HW_INTERFACE_FLAG_LINK_UP);
       ad->flags |= AVF_DEVICE_F_ADMIN_UP;
-      vnet_hw_interface_assign_rx_thread (vnm, ad->hw_if_index, 0, ~0);
     }
   else
     {
@@ -1198,14 +1286,24 @@ avf_interface_admin_up_down (vnet_main_t * vnm, u32 hw_if_index, u32 flags)
   return 0;
 }
 
+static char *avf_tx_func_error_strings[] = {
+#define _(n,s) s,
+  foreach_avf_tx_func_error
+#undef _
+};
+
 /* *INDENT-OFF* */
 VNET_DEVICE_CLASS (avf_device_class,) =
 {
   .name = "Adaptive Virtual Function (AVF) interface",
   .tx_function = avf_interface_tx,
+  .tx_function_n_errors = AVF_TX_N_ERROR,
+  .tx_function_error_strings = avf_tx_func_error_strings,
   .format_device = format_avf_device,
   .format_device_name = format_avf_device_name,
   .admin_up_down_function = avf_interface_admin_up_down,
+  .format_flow = format_avf_flow,
+  .flow_ops_function = avf_flow_ops_fn,
 };
 /* *INDENT-ON* */
 
@@ -1242,6 +1340,9 @@ avf_init (vlib_main_t * vm)
 	}
       else
 	p->next_node = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+      /* non-tunneled ipv4/ipv6 udp and tcp */
+      if (i == 24 || i == 26 || i == 90 || i == 92)
+	p->l4_csum = 1;
       p->buffer_advance = device_input_next_node_advance[p->next_node];
       p->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
     }
@@ -0,0 +1,391 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vlib/pci/pci.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/ip/ip.h>
+#include <vnet/udp/udp_packet.h>
+#include <vnet/tcp/tcp_packet.h>
+#include <vnet/flow/flow.h>
+
+#include <avf/avf.h>
+
+#define AVF_SUPPORTED_FLOW_ACTIONS (VNET_FLOW_ACTION_MARK | \
+				    VNET_FLOW_ACTION_BUFFER_ADVANCE | \
+				    VNET_FLOW_ACTION_REDIRECT_TO_NODE | \
+				    VNET_FLOW_ACTION_REDIRECT_TO_QUEUE | \
+				    VNET_FLOW_ACTION_DROP)
+
+static_always_inline int
+avf_flow_mask_is_exact (void *mask, void *match, int len)
+{
+  u8 *m = mask;
+  int i, all_ones = 1, all_zeros = 1;
+
+  for (i = 0; i < len; i++)
+    {
+      all_ones &= m[i] == 0xff;
+      all_zeros &= m[i] == 0;
+    }
+
+  /* the flow director matches whole fields only */
+  if (all_ones)
+    return 1;
+  if (all_zeros)
+    {
+      memset (match, 0, len);
+      return 0;
+    }
+  return -1;
+}
+
+static virtchnl_proto_hdr_t *
+avf_flow_add_hdr (virtchnl_proto_hdrs_t * hdrs,
+		  virtchnl_proto_hdr_type_t type)
+{
+  virtchnl_proto_hdr_t *hdr = hdrs->proto_hdr + hdrs->count++;
+  hdr->type = type;
+  return hdr;
+}
+
+static int
+avf_flow_set_field (virtchnl_proto_hdr_t * hdr,
+		    virtchnl_proto_hdr_field_t field, void *mask, void *val,
+		    int len)
+{
+  int rv = avf_flow_mask_is_exact (mask, val, len);
+
+  if (rv < 0)
+    return VNET_FLOW_ERROR_NOT_SUPPORTED;
+  if (rv)
+    hdr->field_selector |= VIRTCHNL_PROTO_HDR_FIELD_BIT (field);
+  return 0;
+}
+
+static int
+avf_flow_add (vlib_main_t * vm, avf_device_t * ad, vnet_flow_t * f,
+	      avf_flow_entry_t * fe)
+{
+  virtchnl_fdir_add_t add = { 0 };
+  virtchnl_proto_hdrs_t *hdrs = &add.rule_cfg.proto_hdrs;
+  virtchnl_filter_action_set_t *as = &add.rule_cfg.action_set;
+  virtchnl_filter_action_t *act;
+  virtchnl_proto_hdr_t *hdr;
+  ip_port_and_mask_t src_port, dst_port;
+  u8 protocol;
+  clib_error_t *err;
+  int rv = 0;
+
+  add.vsi_id = ad->vsi_id;
+
+  /* any ethernet header */
+  avf_flow_add_hdr (hdrs, VIRTCHNL_PROTO_HDR_ETH);
+
+  if (f->type == VNET_FLOW_TYPE_IP4_N_TUPLE)
+    {
+      vnet_flow_ip4_n_tuple_t *t4 = &f->ip4_n_tuple;
+      ip4_header_t *ip4;
+
+      hdr = avf_flow_add_hdr (hdrs, VIRTCHNL_PROTO_HDR_IPV4);
+      ip4 = (ip4_header_t *) hdr->buffer;
+      ip4->src_address = t4->src_addr.addr;
+      ip4->dst_address = t4->dst_addr.addr;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_IPV4_SRC,
+				    &t4->src_addr.mask, &ip4->src_address,
+				    sizeof (ip4_address_t))))
+	return rv;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_IPV4_DST,
+				    &t4->dst_addr.mask, &ip4->dst_address,
+				    sizeof (ip4_address_t))))
+	return rv;
+
+      src_port = t4->src_port;
+      dst_port = t4->dst_port;
+      protocol = t4->protocol;
+    }
+  else if (f->type == VNET_FLOW_TYPE_IP6_N_TUPLE)
+    {
+      vnet_flow_ip6_n_tuple_t *t6 = &f->ip6_n_tuple;
+      ip6_header_t *ip6;
+
+      hdr = avf_flow_add_hdr (hdrs, VIRTCHNL_PROTO_HDR_IPV6);
+      ip6 = (ip6_header_t *) hdr->buffer;
+      ip6->src_address = t6->src_addr.addr;
+      ip6->dst_address = t6->dst_addr.addr;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_IPV6_SRC,
+				    &t6->src_addr.mask, &ip6->src_address,
+				    sizeof (ip6_address_t))))
+	return rv;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_IPV6_DST,
+				    &t6->dst_addr.mask, &ip6->dst_address,
+				    sizeof (ip6_address_t))))
+	return rv;
+
+      src_port = t6->src_port;
+      dst_port = t6->dst_port;
+      protocol = t6->protocol;
+    }
+  else
+    return VNET_FLOW_ERROR_NOT_SUPPORTED;
+
+  /* layer 4, ports are matched in network order */
+  src_port.port = clib_host_to_net_u16 (src_port.port);
+  dst_port.port = clib_host_to_net_u16 (dst_port.port);
+
+  if (protocol == IP_PROTOCOL_UDP)
+    {
+      udp_header_t *udp;
+
+      hdr = avf_flow_add_hdr (hdrs, VIRTCHNL_PROTO_HDR_UDP);
+      udp = (udp_header_t *) hdr->buffer;
+      udp->src_port = src_port.port;
+      udp->dst_port = dst_port.port;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_UDP_SRC_PORT,
+				    &src_port.mask, &udp->src_port,
+				    sizeof (u16))))
+	return rv;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_UDP_DST_PORT,
+				    &dst_port.mask, &udp->dst_port,
+				    sizeof (u16))))
+	return rv;
+    }
+  else if (protocol == IP_PROTOCOL_TCP)
+    {
+      tcp_header_t *tcp;
+
+      hdr = avf_flow_add_hdr (hdrs, VIRTCHNL_PROTO_HDR_TCP);
+      tcp = (tcp_header_t *) hdr->buffer;
+      tcp->src_port = src_port.port;
+      tcp->dst_port = dst_port.port;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_TCP_SRC_PORT,
+				    &src_port.mask, &tcp->src_port,
+				    sizeof (u16))))
+	return rv;
+      if ((rv = avf_flow_set_field (hdr, VIRTCHNL_PROTO_HDR_TCP_DST_PORT,
+				    &dst_port.mask, &tcp->dst_port,
+				    sizeof (u16))))
+	return rv;
+    }
+  else
+    return VNET_FLOW_ERROR_NOT_SUPPORTED;
+
+  /* actions */
+  act = as->actions + as->count++;
+  if (f->actions & VNET_FLOW_ACTION_DROP)
+    act->type = VIRTCHNL_ACTION_DROP;
+  else if (f->actions & VNET_FLOW_ACTION_REDIRECT_TO_QUEUE)
+    {
+      if (f->redirect_queue >= vec_len (ad->rxqs))
+	return VNET_FLOW_ERROR_NOT_SUPPORTED;
+      act->type = VIRTCHNL_ACTION_QUEUE;
+      act->act_conf.queue.index = f->redirect_queue;
+    }
+  else
+    act->type = VIRTCHNL_ACTION_PASSTHRU;
+
+  if (fe->mark)
+    {
+      act = as->actions + as->count++;
+      act->type = VIRTCHNL_ACTION_MARK;
+      act->act_conf.mark_id = fe->mark;
+    }
+
+  err = avf_send_to_pf (vm, ad, VIRTCHNL_OP_ADD_FDIR_FILTER, &add,
+			sizeof (add), &add, sizeof (add));
+  if (err)
+    {
+      clib_error_report (err);
+      return VNET_FLOW_ERROR_INTERNAL;
+    }
+
+  if (add.status == VIRTCHNL_FDIR_FAILURE_RULE_EXIST)
+    return VNET_FLOW_ERROR_ALREADY_EXISTS;
+  if (add.status != VIRTCHNL_FDIR_SUCCESS)
+    return VNET_FLOW_ERROR_NOT_SUPPORTED;
+
+  fe->fdir_id = add.flow_id;
+  return 0;
+}
+
+static int
+avf_flow_del (vlib_main_t * vm, avf_device_t * ad, avf_flow_entry_t * fe)
+{
+  virtchnl_fdir_del_t del = { 0 };
+  clib_error_t *err;
+
+  del.vsi_id = ad->vsi_id;
+  del.flow_id = fe->fdir_id;
+
+  err = avf_send_to_pf (vm, ad, VIRTCHNL_OP_DEL_FDIR_FILTER, &del,
+			sizeof (del), &del, sizeof (del));
+  if (err)
+    {
+      clib_error_report (err);
+      return VNET_FLOW_ERROR_INTERNAL;
+    }
+
+  if (del.status == VIRTCHNL_FDIR_FAILURE_RULE_NONEXIST)
+    return VNET_FLOW_ERROR_NO_SUCH_ENTRY;
+  if (del.status != VIRTCHNL_FDIR_SUCCESS)
+    return VNET_FLOW_ERROR_INTERNAL;
+
+  return 0;
+}
+
+int
+avf_flow_ops_fn (vnet_main_t * vnm, vnet_flow_dev_op_t op, u32 dev_instance,
+		 u32 flow_index, uword * private_data)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  avf_main_t *am = &avf_main;
+  vnet_flow_t *flow = vnet_get_flow (flow_index);
+  avf_device_t *ad = vec_elt_at_index (am->devices, dev_instance);
+  avf_flow_entry_t *fe;
+  avf_flow_lookup_entry_t *fle = 0;
+  int rv;
+
+  if ((ad->feature_bitmap & VIRTCHNL_VF_OFFLOAD_FDIR_PF) == 0)
+    return VNET_FLOW_ERROR_NOT_SUPPORTED;
+
+  /* recycle old flow lookup entries only after the main loop counter
+     increases - i.e. previously DMA'ed packets were handled */
+  if (vec_len (ad->parked_lookup_indexes) > 0 &&
+      ad->parked_loop_count != vm->main_loop_count)
+    {
+      u32 *fl_index;
+
+      vec_foreach (fl_index, ad->parked_lookup_indexes)
+	pool_put_index (ad->flow_lookup_entries, *fl_index);
+      vec_reset_length (ad->parked_lookup_indexes);
+    }
+
+  if (op == VNET_FLOW_DEV_OP_DEL_FLOW)
+    {
+      fe = pool_elt_at_index (ad->flow_entries, *private_data);
+
+      if ((rv = avf_flow_del (vm, ad, fe)))
+	return rv;
+
+      if (fe->mark)
+	{
+	  /* make sure no action is taken for in-flight (marked) packets */
+	  fle = pool_elt_at_index (ad->flow_lookup_entries, fe->mark);
+	  memset (fle, -1, sizeof (*fle));
+	  vec_add1 (ad->parked_lookup_indexes, fe->mark);
+	  ad->parked_loop_count = vm->main_loop_count;
+	}
+
+      memset (fe, 0, sizeof (*fe));
+      pool_put (ad->flow_entries, fe);
+
+      goto disable_rx_offload;
+    }
+
+  if (op != VNET_FLOW_DEV_OP_ADD_FLOW)
+    return VNET_FLOW_ERROR_NOT_SUPPORTED;
+
+  if (flow->actions == 0 || (flow->actions & ~AVF_SUPPORTED_FLOW_ACTIONS))
+    return VNET_FLOW_ERROR_NOT_SUPPORTED;
+
+  pool_get (ad->flow_entries, fe);
+  fe->flow_index = flow->index;
+
+  /* if we need to mark packets, assign one mark */
+  if (flow->actions & (VNET_FLOW_ACTION_MARK |
+		       VNET_FLOW_ACTION_REDIRECT_TO_NODE |
+		       VNET_FLOW_ACTION_BUFFER_ADVANCE))
+    {
+      /* reserve slot 0 */
+      if (ad->flow_lookup_entries == 0)
+	pool_get_aligned (ad->flow_lookup_entries, fle,
+			  CLIB_CACHE_LINE_BYTES);
+      pool_get_aligned (ad->flow_lookup_entries, fle, CLIB_CACHE_LINE_BYTES);
+      fe->mark = fle - ad->flow_lookup_entries;
+
+      /* install entry in the lookup table */
+      memset (fle, -1, sizeof (*fle));
+      if (flow->actions & VNET_FLOW_ACTION_MARK)
+	fle->flow_id = flow->mark_flow_id;
+      if (flow->actions & VNET_FLOW_ACTION_REDIRECT_TO_NODE)
+	fle->next_index = flow->redirect_device_input_next_index;
+      if (flow->actions & VNET_FLOW_ACTION_BUFFER_ADVANCE)
+	fle->buffer_advance = flow->buffer_advance;
+    }
+  else
+    fe->mark = 0;
+
+  if ((rv = avf_flow_add (vm, ad, flow, fe)))
+    goto done;
+
+  ad->flags |= AVF_DEVICE_F_RX_FLOW_OFFLOAD;
+  *private_data = fe - ad->flow_entries;
+
+done:
+  if (rv)
+    {
+      memset (fe, 0, sizeof (*fe));
+      pool_put (ad->flow_entries, fe);
+      if (fle)
+	{
+	  memset (fle, -1, sizeof (*fle));
+	  pool_put (ad->flow_lookup_entries, fle);
+	}
+    }
+disable_rx_offload:
+  if (pool_elts (ad->flow_entries) == 0)
+    ad->flags &= ~AVF_DEVICE_F_RX_FLOW_OFFLOAD;
+
+  return rv;
+}
+
+u8 *
+format_avf_flow (u8 * s, va_list * args)
+{
+  u32 dev_instance = va_arg (*args, u32);
+  u32 flow_index = va_arg (*args, u32);
+  uword private_data = va_arg (*args, uword);
+  avf_main_t *am = &avf_main;
+  avf_device_t *ad = vec_elt_at_index (am->devices, dev_instance);
+  avf_flow_entry_t *fe;
+
+  if (flow_index == ~0)
+    {
+      if (ad->feature_bitmap & VIRTCHNL_VF_OFFLOAD_FDIR_PF)
+	s = format (s, "%-25s: %U\n", "supported flow actions",
+		    format_flow_actions, AVF_SUPPORTED_FLOW_ACTIONS);
+      else
+	s = format (s, "%-25s: %s\n", "supported flow actions",
+		    "none (no flow director on PF)");
+      return s;
+    }
+
+  if (pool_is_free_index (ad->flow_entries, private_data))
+    return format (s, "unknown flow");
+
+  fe = pool_elt_at_index (ad->flow_entries, private_data);
+  s = format (s, "mark %u fdir-id %u", fe->mark, fe->fdir_id);
+  return s;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
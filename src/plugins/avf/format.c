@@ -97,6 +97,8 @@ format_avf_device (u8 * s, va_list * args)
 	      "rss-key-size %u rss-lut-size %u", format_white_space, indent,
 	      ad->num_queue_pairs, ad->max_vectors, ad->max_mtu,
 	      ad->rss_key_size, ad->rss_lut_size);
+  s = format (s, "\n%Urx-queues %u tx-queues %u", format_white_space, indent,
+	      vec_len (ad->rxqs), vec_len (ad->txqs));
   s = format (s, "\n%Uspeed %U", format_white_space, indent,
 	      format_virtchnl_link_speed, ad->link_speed);
   if (ad->error)
@@ -44,6 +44,25 @@ static __clib_unused char *avf_input_error_strings[] = {
 #define AVF_RX_DESC_STATUS(x)		(1 << x)
 #define AVF_RX_DESC_STATUS_DD		AVF_RX_DESC_STATUS(0)
 #define AVF_RX_DESC_STATUS_EOP		AVF_RX_DESC_STATUS(1)
+#define AVF_RX_DESC_STATUS_L3L4P	AVF_RX_DESC_STATUS(3)
+#define AVF_RX_DESC_STATUS_FLM		AVF_RX_DESC_STATUS(11)
+
+#define AVF_RX_DESC_ERROR(x)		(1 << x)
+#define AVF_RX_DESC_ERROR_RXE		AVF_RX_DESC_ERROR(0)
+#define AVF_RX_DESC_ERROR_RECIPE	AVF_RX_DESC_ERROR(1)
+#define AVF_RX_DESC_ERROR_HBO		AVF_RX_DESC_ERROR(2)
+#define AVF_RX_DESC_ERROR_IPE		AVF_RX_DESC_ERROR(3)
+#define AVF_RX_DESC_ERROR_L4E		AVF_RX_DESC_ERROR(4)
+#define AVF_RX_DESC_ERROR_EIPE		AVF_RX_DESC_ERROR(5)
+#define AVF_RX_DESC_ERROR_OVERSIZE	AVF_RX_DESC_ERROR(6)
+#define AVF_RX_DESC_ERROR_PPRS		AVF_RX_DESC_ERROR(7)
+
+/* checksum errors are left to the ip nodes, everything else is dropped */
+#define AVF_RX_DESC_ERROR_DROP (AVF_RX_DESC_ERROR_RXE | \
+				AVF_RX_DESC_ERROR_RECIPE | \
+				AVF_RX_DESC_ERROR_HBO | \
+				AVF_RX_DESC_ERROR_OVERSIZE | \
+				AVF_RX_DESC_ERROR_PPRS)
 
 #define AVF_INPUT_REFILL_TRESHOLD 32
 static_always_inline void
@@ -157,16 +176,25 @@ static_always_inline void
 avf_check_for_error (vlib_node_runtime_t * node, avf_rx_vector_entry_t * rxve,
 		     vlib_buffer_t * b, u16 * next)
 {
-  avf_main_t *am = &avf_main;
-  avf_ptype_t *ptype;
-  if (PREDICT_FALSE (rxve->error))
+  if (PREDICT_TRUE (rxve->error == 0))
+    return;
+
+  if (rxve->error & AVF_RX_DESC_ERROR_DROP)
     {
       b->error = node->errors[AVF_INPUT_ERROR_RX_PACKET_ERROR];
-      ptype = am->ptypes + rxve->ptype;
       /* retract */
-      vlib_buffer_advance (b, --ptype->buffer_advance);
+      vlib_buffer_advance (b, -device_input_next_node_advance[*next]);
       *next = VNET_DEVICE_INPUT_NEXT_DROP;
+      return;
     }
+
+  /* let ip4-input verify the header and count the bad checksum */
+  if ((rxve->error & AVF_RX_DESC_ERROR_IPE) &&
+      *next == VNET_DEVICE_INPUT_NEXT_IP4_NCS_INPUT)
+    *next = VNET_DEVICE_INPUT_NEXT_IP4_INPUT;
+
+  if (rxve->error & AVF_RX_DESC_ERROR_L4E)
+    b->flags &= ~VNET_BUFFER_F_L4_CHECKSUM_CORRECT;
 }
 
 static_always_inline u32
@@ -181,9 +209,59 @@ avf_find_next (avf_rx_vector_entry_t * rxve, vlib_buffer_t * b,
   ptype = am->ptypes + rxve->ptype;
   vlib_buffer_advance (b, ptype->buffer_advance);
   b->flags |= ptype->flags;
+
+  /* the ip header checksum is only known to be good if it was checked */
+  if (PREDICT_TRUE (rxve->status & AVF_RX_DESC_STATUS_L3L4P))
+    {
+      if (ptype->l4_csum)
+	b->flags |= VNET_BUFFER_F_L4_CHECKSUM_COMPUTED |
+	  VNET_BUFFER_F_L4_CHECKSUM_CORRECT;
+    }
+  else if (ptype->next_node == VNET_DEVICE_INPUT_NEXT_IP4_NCS_INPUT)
+    return VNET_DEVICE_INPUT_NEXT_IP4_INPUT;
+
   return ptype->next_node;
 }
 
+static_always_inline u32
+avf_rx_desc_fdir_mark (avf_rx_desc_t * d)
+{
+  /* with 32 byte descriptors the flow director id is in the 4th qword */
+  if (d->qword[1] & AVF_RX_DESC_STATUS_FLM)
+    return d->qword[3] >> 32;
+  return 0;
+}
+
+static_always_inline void
+avf_process_flow_offload (avf_device_t * ad, avf_per_thread_data_t * ptd,
+			  vlib_buffer_t ** b, u16 * next, u32 n_rxv)
+{
+  avf_flow_lookup_entry_t *fle;
+  u32 n, mark;
+
+  for (n = 0; n < n_rxv; n++)
+    {
+      mark = ptd->fdir_marks[n];
+      if (mark == 0 || pool_is_free_index (ad->flow_lookup_entries, mark))
+	continue;
+
+      fle = pool_elt_at_index (ad->flow_lookup_entries, mark);
+
+      if (fle->next_index != (u16) ~ 0)
+	{
+	  /* the redirect target gets the packet from the ethernet header */
+	  vlib_buffer_advance (b[n], -(i16) b[n]->current_data);
+	  next[n] = fle->next_index;
+	}
+
+      if (fle->flow_id != ~0)
+	b[n]->flow_id = fle->flow_id;
+
+      if (fle->buffer_advance != ~0)
+	vlib_buffer_advance (b[n], fle->buffer_advance);
+    }
+}
+
 
 static_always_inline uword
 avf_process_rx_burst (vlib_main_t * vm, vlib_node_runtime_t * node,
@@ -338,6 +416,7 @@ avf_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   vlib_buffer_t *bufs[AVF_RX_VECTOR_SZ];
   vlib_buffer_t *bt = &ptd->buffer_template;
   int known_next = 0;
+  int with_flows = (ad->flags & AVF_DEVICE_F_RX_FLOW_OFFLOAD) != 0;
   u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
 
   STATIC_ASSERT_SIZEOF (avf_rx_vector_entry_t, 8);
@@ -398,6 +477,14 @@ avf_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       u64x4_store_unaligned (v, ptd->rx_vector + n_rxv);
       maybe_error |= !u64x4_is_all_zero (err4);
 
+      if (PREDICT_FALSE (with_flows))
+	{
+	  ptd->fdir_marks[n_rxv + 0] = avf_rx_desc_fdir_mark (d + 0);
+	  ptd->fdir_marks[n_rxv + 1] = avf_rx_desc_fdir_mark (d + 1);
+	  ptd->fdir_marks[n_rxv + 2] = avf_rx_desc_fdir_mark (d + 2);
+	  ptd->fdir_marks[n_rxv + 3] = avf_rx_desc_fdir_mark (d + 3);
+	}
+
       clib_memcpy (bi, rxq->bufs + rxq->next, 4 * sizeof (u32));
 
       /* next */
@@ -420,6 +507,8 @@ avf_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       rxve->ptype = avf_get_u64_bits (d, 8, 37, 30);
       rxve->length = avf_get_u64_bits (d, 8, 63, 38);
       maybe_error |= rxve->error;
+      if (PREDICT_FALSE (with_flows))
+	ptd->fdir_marks[n_rxv] = avf_rx_desc_fdir_mark (d);
 
       /* deal with chained buffers */
       while (PREDICT_FALSE ((d->qword[1] & AVF_RX_DESC_STATUS_EOP) == 0))
@@ -477,6 +566,10 @@ avf_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
     n_rx_bytes = avf_process_rx_burst (vm, node, bt, ptd->rx_vector, bufs,
 				       nexts, n_rxv, maybe_error, 0);
 
+  /* flow offload - process if rx flow offload enabled */
+  if (PREDICT_FALSE (with_flows))
+    avf_process_flow_offload (ad, ptd, bufs, nexts, n_rxv);
+
   /* packet trace if enabled */
   if (PREDICT_FALSE ((n_trace = vlib_get_trace_count (vm, node))))
     {
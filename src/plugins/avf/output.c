@@ -20,6 +20,9 @@
 #include <vlib/pci/pci.h>
 #include <vnet/ethernet/ethernet.h>
 #include <vnet/devices/devices.h>
+#include <vnet/ip/ip.h>
+#include <vnet/tcp/tcp_packet.h>
+#include <vnet/udp/udp_packet.h>
 
 #include <avf/avf.h>
 
@@ -27,6 +30,34 @@
 #define AVF_TXQ_DESC_CMD_EOP		AVF_TXQ_DESC_CMD(0)
 #define AVF_TXQ_DESC_CMD_RS		AVF_TXQ_DESC_CMD(1)
 #define AVF_TXQ_DESC_CMD_RSV		AVF_TXQ_DESC_CMD(2)
+#define AVF_TXQ_DESC_CMD_IIPT_IPV6	AVF_TXQ_DESC_CMD(5)
+#define AVF_TXQ_DESC_CMD_IIPT_IPV4	AVF_TXQ_DESC_CMD(6)
+#define AVF_TXQ_DESC_CMD_IIPT_IPV4_CSUM	(AVF_TXQ_DESC_CMD(5) | \
+					 AVF_TXQ_DESC_CMD(6))
+#define AVF_TXQ_DESC_CMD_L4T_TCP	AVF_TXQ_DESC_CMD(8)
+#define AVF_TXQ_DESC_CMD_L4T_UDP	(AVF_TXQ_DESC_CMD(8) | \
+					 AVF_TXQ_DESC_CMD(9))
+
+#define AVF_TXQ_DESC_MACLEN(x)		((u64) ((x) >> 1) << 16)
+#define AVF_TXQ_DESC_IPLEN(x)		((u64) ((x) >> 2) << 23)
+#define AVF_TXQ_DESC_L4LEN(x)		((u64) ((x) >> 2) << 30)
+#define AVF_TXQ_DESC_BUF_SZ(x)		((u64) (x) << 34)
+
+#define AVF_TXQ_CTX_DESC_DTYP		0x1
+#define AVF_TXQ_CTX_DESC_CMD_TSO	(1 << 4)
+#define AVF_TXQ_CTX_DESC_TSO_LEN(x)	((u64) (x) << 30)
+#define AVF_TXQ_CTX_DESC_MSS(x)		((u64) (x) << 50)
+
+/* without TSO a packet may not span more data descriptors than this */
+#define AVF_TX_MAX_DATA_DESC		8
+
+/* slots of context descriptors do not hold a buffer */
+#define AVF_TXQ_NO_BUFFER		((u32) ~0)
+
+#define AVF_TX_OFFLOAD_FLAGS (VNET_BUFFER_F_OFFLOAD_IP_CKSUM | \
+			      VNET_BUFFER_F_OFFLOAD_TCP_CKSUM | \
+			      VNET_BUFFER_F_OFFLOAD_UDP_CKSUM | \
+			      VNET_BUFFER_F_GSO)
 
 static_always_inline u8
 avf_tx_desc_get_dtyp (avf_tx_desc_t * d)
@@ -34,6 +65,217 @@ avf_tx_desc_get_dtyp (avf_tx_desc_t * d)
   return d->qword[1] & 0x0f;
 }
 
+/*
+ * Fill the offload fields of the data descriptors of a packet. The L4
+ * checksum field is seeded with the pseudo header sum, which for TSO must
+ * not include the length as the hardware adds it for every segment.
+ */
+static_always_inline u64
+avf_tx_prepare_cksum (vlib_buffer_t * b, int is_tso)
+{
+  u64 flags = 0;
+  u16 l2_len = vnet_buffer (b)->l3_hdr_offset - b->current_data;
+  u16 l3_len = vnet_buffer (b)->l4_hdr_offset -
+    vnet_buffer (b)->l3_hdr_offset;
+  tcp_header_t *th = (tcp_header_t *) (b->data +
+				       vnet_buffer (b)->l4_hdr_offset);
+  udp_header_t *uh = (udp_header_t *) th;
+  int is_tcp = is_tso || (b->flags & VNET_BUFFER_F_OFFLOAD_TCP_CKSUM);
+  int is_udp = !is_tcp && (b->flags & VNET_BUFFER_F_OFFLOAD_UDP_CKSUM);
+  ip_csum_t sum = 0;
+  u32 l4_len = 0;
+  int i;
+
+  if (b->flags & VNET_BUFFER_F_IS_IP4)
+    {
+      ip4_header_t *ip4 = (ip4_header_t *) (b->data +
+					    vnet_buffer (b)->l3_hdr_offset);
+      l3_len = ip4_header_bytes (ip4);
+      if (is_tso || (b->flags & VNET_BUFFER_F_OFFLOAD_IP_CKSUM))
+	{
+	  ip4->checksum = 0;
+	  flags |= AVF_TXQ_DESC_CMD_IIPT_IPV4_CSUM;
+	}
+      else
+	flags |= AVF_TXQ_DESC_CMD_IIPT_IPV4;
+
+      if (is_tcp || is_udp)
+	{
+	  if (!is_tso)
+	    l4_len = clib_net_to_host_u16 (ip4->length) - l3_len;
+	  sum = ip_csum_with_carry (sum,
+				    clib_mem_unaligned (&ip4->src_address,
+							u32));
+	  sum = ip_csum_with_carry (sum,
+				    clib_mem_unaligned (&ip4->dst_address,
+							u32));
+	}
+    }
+  else
+    {
+      ip6_header_t *ip6 = (ip6_header_t *) (b->data +
+					    vnet_buffer (b)->l3_hdr_offset);
+      flags |= AVF_TXQ_DESC_CMD_IIPT_IPV6;
+
+      if (is_tcp || is_udp)
+	{
+	  if (!is_tso)
+	    l4_len = clib_net_to_host_u16 (ip6->payload_length) +
+	      sizeof (ip6_header_t) - l3_len;
+	  for (i = 0; i < ARRAY_LEN (ip6->src_address.as_uword); i++)
+	    {
+	      sum = ip_csum_with_carry
+		(sum, clib_mem_unaligned (&ip6->src_address.as_uword[i],
+					  uword));
+	      sum = ip_csum_with_carry
+		(sum, clib_mem_unaligned (&ip6->dst_address.as_uword[i],
+					  uword));
+	    }
+	}
+    }
+
+  flags |= AVF_TXQ_DESC_MACLEN (l2_len) | AVF_TXQ_DESC_IPLEN (l3_len);
+
+  if (is_tcp)
+    {
+      sum = ip_csum_with_carry (sum, clib_host_to_net_u32 (l4_len +
+							   (IP_PROTOCOL_TCP
+							    << 16)));
+      th->checksum = ip_csum_fold (sum);
+      flags |= AVF_TXQ_DESC_CMD_L4T_TCP |
+	AVF_TXQ_DESC_L4LEN (tcp_header_bytes (th));
+    }
+  else if (is_udp)
+    {
+      sum = ip_csum_with_carry (sum, clib_host_to_net_u32 (l4_len +
+							   (IP_PROTOCOL_UDP
+							    << 16)));
+      uh->checksum = ip_csum_fold (sum);
+      flags |= AVF_TXQ_DESC_CMD_L4T_UDP |
+	AVF_TXQ_DESC_L4LEN (sizeof (udp_header_t));
+    }
+
+  return flags;
+}
+
+/*
+ * Enqueue a packet which needs more than a single plain data descriptor:
+ * buffer chains, checksum offload and TSO. Returns the number of
+ * descriptors used, 0 if the ring is full and ~0 if the packet can not be
+ * sent.
+ */
+static never_inline u16
+avf_tx_enqueue_one (vlib_main_t * vm, avf_txq_t * txq, u32 bi,
+		    u16 n_desc_left)
+{
+  vlib_buffer_t *b = vlib_get_buffer (vm, bi), *s = b;
+  u64 cmd = AVF_TXQ_DESC_CMD_RSV;
+  u16 mask = txq->size - 1;
+  u16 n_desc = 1;
+  int is_tso;
+  avf_tx_desc_t *d;
+
+  while (s->flags & VLIB_BUFFER_NEXT_PRESENT)
+    {
+      s = vlib_get_buffer (vm, s->next_buffer);
+      n_desc++;
+    }
+
+  is_tso = (b->flags & VNET_BUFFER_F_GSO) &&
+    (b->flags & (VNET_BUFFER_F_IS_IP4 | VNET_BUFFER_F_IS_IP6));
+
+  if (PREDICT_FALSE (!is_tso && n_desc > AVF_TX_MAX_DATA_DESC))
+    return ~0;
+
+  if (is_tso)
+    n_desc++;
+
+  if (PREDICT_FALSE (n_desc > n_desc_left))
+    return 0;
+
+  if (b->flags & AVF_TX_OFFLOAD_FLAGS)
+    cmd |= avf_tx_prepare_cksum (b, is_tso);
+
+  if (is_tso)
+    {
+      tcp_header_t *th = (tcp_header_t *) (b->data +
+					   vnet_buffer (b)->l4_hdr_offset);
+      u32 l234_len = vnet_buffer (b)->l4_hdr_offset - b->current_data +
+	tcp_header_bytes (th);
+      u32 tso_len = vlib_buffer_length_in_chain (vm, b) - l234_len;
+
+      d = txq->descs + txq->next;
+      d->qword[0] = 0;
+      d->qword[1] = AVF_TXQ_CTX_DESC_DTYP | AVF_TXQ_CTX_DESC_CMD_TSO |
+	AVF_TXQ_CTX_DESC_TSO_LEN (tso_len) |
+	AVF_TXQ_CTX_DESC_MSS (vnet_buffer2 (b)->gso_size);
+      txq->bufs[txq->next] = AVF_TXQ_NO_BUFFER;
+      txq->next = (txq->next + 1) & mask;
+    }
+
+  s = b;
+  while (1)
+    {
+      d = txq->descs + txq->next;
+      txq->bufs[txq->next] = bi;
+      d->qword[0] = pointer_to_uword (s->data) + s->current_data;
+      txq->next = (txq->next + 1) & mask;
+
+      if ((s->flags & VLIB_BUFFER_NEXT_PRESENT) == 0)
+	break;
+
+      d->qword[1] = AVF_TXQ_DESC_BUF_SZ (s->current_length) | cmd;
+      bi = s->next_buffer;
+      s = vlib_get_buffer (vm, bi);
+    }
+
+  /* the hardware only reports completion of the last descriptor */
+  d->qword[1] = AVF_TXQ_DESC_BUF_SZ (s->current_length) | cmd |
+    AVF_TXQ_DESC_CMD_EOP | AVF_TXQ_DESC_CMD_RS;
+
+  txq->n_bufs += n_desc;
+  return n_desc;
+}
+
+static_always_inline void
+avf_tx_free_done (vlib_main_t * vm, avf_txq_t * txq)
+{
+  u16 mask = txq->size - 1;
+  u16 first, slot, n = 0, n_done = 0, n_free = 0;
+  avf_tx_desc_t *d;
+
+  first = slot = (txq->next - txq->n_bufs) & mask;
+
+  /* only the last descriptor of each packet is written back, the ones
+     before it are done once it is */
+  while (n < txq->n_bufs)
+    {
+      d = txq->descs + slot;
+      if (avf_tx_desc_get_dtyp (d) == 0x0F)
+	n_done = n + 1;
+      else if (avf_tx_desc_get_dtyp (d) == 0 &&
+	       (d->qword[1] & AVF_TXQ_DESC_CMD_EOP))
+	break;
+      n++;
+      slot = (slot + 1) & mask;
+    }
+
+  if (n_done == 0)
+    return;
+
+  u32 to_free[n_done];
+  slot = first;
+  for (n = 0; n < n_done; n++)
+    {
+      if (txq->bufs[slot] != AVF_TXQ_NO_BUFFER)
+	to_free[n_free++] = txq->bufs[slot];
+      slot = (slot + 1) & mask;
+    }
+
+  txq->n_bufs -= n_done;
+  vlib_buffer_free_no_next (vm, to_free, n_free);
+}
+
 uword
 CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
 				      vlib_node_runtime_t * node,
@@ -51,6 +293,8 @@ CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
   u16 n_left = frame->n_vectors;
   vlib_buffer_t *b0, *b1, *b2, *b3;
   u16 mask = txq->size - 1;
+  u16 n_desc_left, n;
+  u32 or_flags;
   u64 bits = (AVF_TXQ_DESC_CMD_EOP | AVF_TXQ_DESC_CMD_RS |
 	      AVF_TXQ_DESC_CMD_RSV);
 
@@ -58,26 +302,12 @@ CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
 
   /* release cosumed bufs */
   if (txq->n_bufs)
-    {
-      u16 first, slot, n_free = 0;
-      first = slot = (txq->next - txq->n_bufs) & mask;
-      d0 = txq->descs + slot;
-      while (n_free < txq->n_bufs && avf_tx_desc_get_dtyp (d0) == 0x0F)
-	{
-	  n_free++;
-	  slot = (slot + 1) & mask;
-	  d0 = txq->descs + slot;
-	}
+    avf_tx_free_done (vm, txq);
 
-      if (n_free)
-	{
-	  txq->n_bufs -= n_free;;
-	  vlib_buffer_free_from_ring (vm, txq->bufs, first, txq->size,
-				      n_free);
-	}
-    }
+  /* the ring is full when the tail would catch up with the head */
+  n_desc_left = txq->size - 1 - txq->n_bufs;
 
-  while (n_left >= 7)
+  while (n_left >= 7 && n_desc_left >= 4)
     {
       u16 slot0, slot1, slot2, slot3;
 
@@ -86,6 +316,38 @@ CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
       vlib_prefetch_buffer_with_index (vm, buffers[6], LOAD);
       vlib_prefetch_buffer_with_index (vm, buffers[7], LOAD);
 
+      bi0 = buffers[0];
+      bi1 = buffers[1];
+      bi2 = buffers[2];
+      bi3 = buffers[3];
+
+      b0 = vlib_get_buffer (vm, bi0);
+      b1 = vlib_get_buffer (vm, bi1);
+      b2 = vlib_get_buffer (vm, bi2);
+      b3 = vlib_get_buffer (vm, bi3);
+
+      or_flags = b0->flags | b1->flags | b2->flags | b3->flags;
+
+      /* chains and offloads are enqueued one by one */
+      if (PREDICT_FALSE (or_flags & (VLIB_BUFFER_NEXT_PRESENT |
+				     AVF_TX_OFFLOAD_FLAGS)))
+	{
+	  n = avf_tx_enqueue_one (vm, txq, bi0, n_desc_left);
+	  if (n == 0)
+	    break;
+	  if (PREDICT_FALSE (n == (u16) ~ 0))
+	    {
+	      vlib_error_count (vm, node->node_index,
+				AVF_TX_ERROR_TOO_MANY_SEGMENTS, 1);
+	      vlib_buffer_free (vm, buffers, 1);
+	      n = 0;
+	    }
+	  n_desc_left -= n;
+	  buffers += 1;
+	  n_left -= 1;
+	  continue;
+	}
+
       slot0 = txq->next;
       slot1 = (txq->next + 1) & mask;
       slot2 = (txq->next + 2) & mask;
@@ -96,19 +358,10 @@ CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
       d2 = txq->descs + slot2;
       d3 = txq->descs + slot3;
 
-      bi0 = buffers[0];
-      bi1 = buffers[1];
-      bi2 = buffers[2];
-      bi3 = buffers[3];
-
       txq->bufs[slot0] = bi0;
       txq->bufs[slot1] = bi1;
       txq->bufs[slot2] = bi2;
       txq->bufs[slot3] = bi3;
-      b0 = vlib_get_buffer (vm, bi0);
-      b1 = vlib_get_buffer (vm, bi1);
-      b2 = vlib_get_buffer (vm, bi2);
-      b3 = vlib_get_buffer (vm, bi3);
 
 #if 0
       d->qword[0] = vlib_get_buffer_data_physical_address (vm, bi0) +
@@ -127,17 +380,38 @@ CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
 
       txq->next = (txq->next + 4) & mask;
       txq->n_bufs += 4;
+      n_desc_left -= 4;
       buffers += 4;
       n_left -= 4;
     }
 
-  while (n_left)
+  while (n_left && n_desc_left)
     {
-      d0 = txq->descs + txq->next;
       bi0 = buffers[0];
-      txq->bufs[txq->next] = bi0;
       b0 = vlib_get_buffer (vm, bi0);
 
+      if (PREDICT_FALSE (b0->flags & (VLIB_BUFFER_NEXT_PRESENT |
+				      AVF_TX_OFFLOAD_FLAGS)))
+	{
+	  n = avf_tx_enqueue_one (vm, txq, bi0, n_desc_left);
+	  if (n == 0)
+	    break;
+	  if (PREDICT_FALSE (n == (u16) ~ 0))
+	    {
+	      vlib_error_count (vm, node->node_index,
+				AVF_TX_ERROR_TOO_MANY_SEGMENTS, 1);
+	      vlib_buffer_free (vm, buffers, 1);
+	      n = 0;
+	    }
+	  n_desc_left -= n;
+	  buffers++;
+	  n_left--;
+	  continue;
+	}
+
+      d0 = txq->descs + txq->next;
+      txq->bufs[txq->next] = bi0;
+
 #if 0
       d->qword[0] = vlib_get_buffer_data_physical_address (vm, bi0) +
 	b0->current_data;
@@ -148,6 +422,7 @@ CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
 
       txq->next = (txq->next + 1) & mask;
       txq->n_bufs++;
+      n_desc_left--;
       buffers++;
       n_left--;
     }
@@ -156,6 +431,13 @@ CLIB_MULTIARCH_FN (avf_interface_tx) (vlib_main_t * vm,
 
   clib_spinlock_unlock_if_init (&txq->lock);
 
+  if (PREDICT_FALSE (n_left))
+    {
+      vlib_error_count (vm, node->node_index, AVF_TX_ERROR_NO_FREE_SLOTS,
+			n_left);
+      vlib_buffer_free (vm, buffers, n_left);
+    }
+
   return frame->n_vectors - n_left;
 }
 
@@ -80,7 +80,9 @@
   _(26, SET_RSS_HENA)				\
   _(27, ENABLE_VLAN_STRIPPING)			\
   _(28, DISABLE_VLAN_STRIPPING)			\
-  _(29, REQUEST_QUEUES)
+  _(29, REQUEST_QUEUES)				\
+  _(47, ADD_FDIR_FILTER)			\
+  _(48, DEL_FDIR_FILTER)
 
 typedef enum
 {
@@ -114,7 +116,8 @@ typedef enum
   _(19, RSS_PF, "rss-pf") \
   _(20, ENCAP, "encap") \
   _(21, ENCAP_CSUM, "encap-csum") \
-  _(22, RX_ENCAP_CSUM, "rx-encap-csum")
+  _(22, RX_ENCAP_CSUM, "rx-encap-csum") \
+  _(28, FDIR_PF, "fdir-pf")
 
 typedef enum
 {
@@ -352,6 +355,152 @@ typedef struct
 
 STATIC_ASSERT_SIZEOF (virtchnl_rss_lut_t, 6);
 
+typedef struct
+{
+  u64 hena;
+} virtchnl_rss_hena_t;
+
+STATIC_ASSERT_SIZEOF (virtchnl_rss_hena_t, 8);
+
+/* flow director */
+#define VIRTCHNL_MAX_NUM_PROTO_HDRS	32
+#define VIRTCHNL_MAX_NUM_ACTIONS	8
+#define VIRTCHNL_PROTO_HDR_SHIFT	5
+#define VIRTCHNL_PROTO_HDR_FIELD_BIT(f) \
+  (1 << ((f) & ((1 << VIRTCHNL_PROTO_HDR_SHIFT) - 1)))
+
+typedef enum
+{
+  VIRTCHNL_PROTO_HDR_NONE,
+  VIRTCHNL_PROTO_HDR_ETH,
+  VIRTCHNL_PROTO_HDR_S_VLAN,
+  VIRTCHNL_PROTO_HDR_C_VLAN,
+  VIRTCHNL_PROTO_HDR_IPV4,
+  VIRTCHNL_PROTO_HDR_IPV6,
+  VIRTCHNL_PROTO_HDR_TCP,
+  VIRTCHNL_PROTO_HDR_UDP,
+  VIRTCHNL_PROTO_HDR_SCTP,
+} virtchnl_proto_hdr_type_t;
+
+#define _(t) ((VIRTCHNL_PROTO_HDR_##t) << VIRTCHNL_PROTO_HDR_SHIFT)
+typedef enum
+{
+  VIRTCHNL_PROTO_HDR_IPV4_SRC = _(IPV4),
+  VIRTCHNL_PROTO_HDR_IPV4_DST,
+  VIRTCHNL_PROTO_HDR_IPV4_DSCP,
+  VIRTCHNL_PROTO_HDR_IPV4_TTL,
+  VIRTCHNL_PROTO_HDR_IPV4_PROT,
+  VIRTCHNL_PROTO_HDR_IPV6_SRC = _(IPV6),
+  VIRTCHNL_PROTO_HDR_IPV6_DST,
+  VIRTCHNL_PROTO_HDR_IPV6_TC,
+  VIRTCHNL_PROTO_HDR_IPV6_HOP_LIMIT,
+  VIRTCHNL_PROTO_HDR_IPV6_PROT,
+  VIRTCHNL_PROTO_HDR_TCP_SRC_PORT = _(TCP),
+  VIRTCHNL_PROTO_HDR_TCP_DST_PORT,
+  VIRTCHNL_PROTO_HDR_UDP_SRC_PORT = _(UDP),
+  VIRTCHNL_PROTO_HDR_UDP_DST_PORT,
+} virtchnl_proto_hdr_field_t;
+#undef _
+
+typedef struct
+{
+  virtchnl_proto_hdr_type_t type;
+  u32 field_selector;
+  /* header in network order, only the selected fields are matched */
+  u8 buffer[64];
+} virtchnl_proto_hdr_t;
+
+STATIC_ASSERT_SIZEOF (virtchnl_proto_hdr_t, 72);
+
+typedef struct
+{
+  u8 tunnel_level;
+  int count;
+  virtchnl_proto_hdr_t proto_hdr[VIRTCHNL_MAX_NUM_PROTO_HDRS];
+} virtchnl_proto_hdrs_t;
+
+STATIC_ASSERT_SIZEOF (virtchnl_proto_hdrs_t, 2312);
+
+typedef enum
+{
+  VIRTCHNL_ACTION_DROP = 0,
+  VIRTCHNL_ACTION_TC_REDIRECT,
+  VIRTCHNL_ACTION_PASSTHRU,
+  VIRTCHNL_ACTION_QUEUE,
+  VIRTCHNL_ACTION_Q_REGION,
+  VIRTCHNL_ACTION_MARK,
+  VIRTCHNL_ACTION_COUNT,
+} virtchnl_action_t;
+
+typedef struct
+{
+  virtchnl_action_t type;
+  union
+  {
+    struct
+    {
+      u16 index;
+      u8 region;
+    } queue;
+    struct
+    {
+      u8 shared;
+      u32 id;
+    } count;
+    u32 mark_id;
+    u8 reserve[32];
+  } act_conf;
+} virtchnl_filter_action_t;
+
+STATIC_ASSERT_SIZEOF (virtchnl_filter_action_t, 36);
+
+typedef struct
+{
+  int count;
+  virtchnl_filter_action_t actions[VIRTCHNL_MAX_NUM_ACTIONS];
+} virtchnl_filter_action_set_t;
+
+typedef struct
+{
+  virtchnl_proto_hdrs_t proto_hdrs;
+  virtchnl_filter_action_set_t action_set;
+} virtchnl_fdir_rule_t;
+
+STATIC_ASSERT_SIZEOF (virtchnl_fdir_rule_t, 2604);
+
+typedef enum
+{
+  VIRTCHNL_FDIR_SUCCESS = 0,
+  VIRTCHNL_FDIR_FAILURE_RULE_NORESOURCE,
+  VIRTCHNL_FDIR_FAILURE_RULE_EXIST,
+  VIRTCHNL_FDIR_FAILURE_RULE_CONFLICT,
+  VIRTCHNL_FDIR_FAILURE_RULE_NONEXIST,
+  VIRTCHNL_FDIR_FAILURE_RULE_INVALID,
+  VIRTCHNL_FDIR_FAILURE_RULE_TIMEOUT,
+  VIRTCHNL_FDIR_FAILURE_QUERY_INVALID,
+} virtchnl_fdir_prgm_status_t;
+
+typedef struct
+{
+  u16 vsi_id;
+  u16 validate_only;
+  u32 flow_id;
+  virtchnl_fdir_rule_t rule_cfg;
+  virtchnl_fdir_prgm_status_t status;
+} virtchnl_fdir_add_t;
+
+STATIC_ASSERT_SIZEOF (virtchnl_fdir_add_t, 2616);
+
+typedef struct
+{
+  u16 vsi_id;
+  u16 pad;
+  u32 flow_id;
+  virtchnl_fdir_prgm_status_t status;
+} virtchnl_fdir_del_t;
+
+STATIC_ASSERT_SIZEOF (virtchnl_fdir_del_t, 12);
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
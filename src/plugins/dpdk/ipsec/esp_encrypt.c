@@ -46,7 +46,8 @@ typedef enum
  _(ENQ_FAIL, "Enqueue failed to crypto device")     \
  _(DISCARD, "Not enough crypto operations, discarding frame")  \
  _(SESSION, "Failed to get crypto session")         \
- _(NOSUP, "Cipher/Auth not supported")
+ _(NOSUP, "Cipher/Auth not supported")             \
+ _(HANDOFF_CONGESTED, "SA owner queue congested (packet dropped)")
 
 
 typedef enum
@@ -124,10 +125,24 @@ dpdk_esp_encrypt_node_fn (vlib_main_t * vm,
   crypto_worker_main_t *cwm =
     vec_elt_at_index (dcm->workers_main, thread_idx);
   struct rte_crypto_op **ops = cwm->ops;
+  u32 local[VLIB_FRAME_SIZE], n_congested, n_rx;
 
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
 
+  /* packets of SAs pinned to other threads continue there */
+  if (PREDICT_FALSE (dcm->encrypt_fq_index != ~0))
+    {
+      n_left_from = ipsec_handoff (vm, dcm->encrypt_fq_index, from,
+				   n_left_from, local, &n_congested);
+      from = local;
+      if (n_congested)
+	vlib_node_increment_counter (vm, dpdk_esp_encrypt_node.index,
+				     ESP_ENCRYPT_ERROR_HANDOFF_CONGESTED,
+				     n_congested);
+    }
+  n_rx = n_left_from;
+
   ret = crypto_alloc_ops (numa, ops, n_left_from);
   if (ret)
     {
@@ -518,13 +533,12 @@ dpdk_esp_encrypt_node_fn (vlib_main_t * vm,
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
   vlib_node_increment_counter (vm, dpdk_esp_encrypt_node.index,
-			       ESP_ENCRYPT_ERROR_RX_PKTS,
-			       from_frame->n_vectors);
+			       ESP_ENCRYPT_ERROR_RX_PKTS, n_rx);
 
   crypto_enqueue_ops (vm, cwm, 1, dpdk_esp_encrypt_node.index,
 		      ESP_ENCRYPT_ERROR_ENQ_FAIL, numa);
 
-  crypto_free_ops (numa, ops, cwm->ops + from_frame->n_vectors - ops);
+  crypto_free_ops (numa, ops, cwm->ops + n_rx - ops);
 
   return from_frame->n_vectors;
 }
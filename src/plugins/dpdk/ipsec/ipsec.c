@@ -1016,6 +1016,8 @@ dpdk_ipsec_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 
   n_mains = tm->n_vlib_mains;
   skip_master = vlib_num_workers () > 0;
+  dcm->encrypt_fq_index = ~0;
+  dcm->decrypt_fq_index = ~0;
 
   algos_init (n_mains - skip_master);
 
@@ -1075,6 +1077,18 @@ dpdk_ipsec_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
   im->esp_decrypt_next_index =
     vlib_node_add_next (vm, node->index, next_node->index);
 
+  /* the replay window and the sequence number of an SA are only touched
+     by its owner thread, here as in the native nodes */
+  if (n_mains > 1)
+    {
+      vlib_worker_thread_barrier_sync (vm);
+      dcm->encrypt_fq_index =
+	vlib_frame_queue_main_init (im->esp_encrypt_node_index, 0);
+      dcm->decrypt_fq_index =
+	vlib_frame_queue_main_init (im->esp_decrypt_node_index, 0);
+      vlib_worker_thread_barrier_release (vm);
+    }
+
   im->cb.check_support_cb = dpdk_ipsec_check_support;
   im->cb.add_del_sa_sess_cb = add_del_sa_session;
 
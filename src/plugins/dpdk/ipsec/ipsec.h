@@ -157,6 +157,9 @@ typedef struct
   crypto_data_t *data;
   crypto_drv_t *drv;
   u64 session_timeout;		/* nsec */
+  /* frame queues handing packets to the thread owning the SA */
+  u32 encrypt_fq_index;
+  u32 decrypt_fq_index;
   u8 enabled;
 } dpdk_crypto_main_t;
 
@@ -217,24 +217,23 @@ ip_udp_gtpu_rewrite (gtpu_tunnel_t * t, bool is_ip6)
 {
   union
   {
-    ip4_gtpu_header_t *h4;
-    ip6_gtpu_header_t *h6;
-    u8 *rw;
-  } r =
-  {
-  .rw = 0};
-  int len = is_ip6 ? sizeof *r.h6 : sizeof *r.h4;
+    ip4_gtpu_header_t h4;
+    ip6_gtpu_header_t h6;
+  } r;
+  ip4_gtpu_header_t *h4 = &r.h4;
+  ip6_gtpu_header_t *h6 = &r.h6;
+  int len = is_ip6 ? sizeof *h6 : sizeof *h4;
 
-  vec_validate_aligned (r.rw, len - 1, CLIB_CACHE_LINE_BYTES);
+  memset (&r, 0, sizeof (r));
 
   udp_header_t *udp;
   gtpu_header_t *gtpu;
   /* Fixed portion of the (outer) ip header */
   if (!is_ip6)
     {
-      ip4_header_t *ip = &r.h4->ip4;
-      udp = &r.h4->udp;
-      gtpu = &r.h4->gtpu;
+      ip4_header_t *ip = &h4->ip4;
+      udp = &h4->udp;
+      gtpu = &h4->gtpu;
       ip->ip_version_and_header_length = 0x45;
       ip->ttl = 254;
       ip->protocol = IP_PROTOCOL_UDP;
@@ -247,9 +246,9 @@ ip_udp_gtpu_rewrite (gtpu_tunnel_t * t, bool is_ip6)
     }
   else
     {
-      ip6_header_t *ip = &r.h6->ip6;
-      udp = &r.h6->udp;
-      gtpu = &r.h6->gtpu;
+      ip6_header_t *ip = &h6->ip6;
+      udp = &h6->udp;
+      gtpu = &h6->gtpu;
       ip->ip_version_traffic_class_and_flow_label =
 	clib_host_to_net_u32 (6 << 28);
       ip->hop_limit = 255;
@@ -268,9 +267,8 @@ ip_udp_gtpu_rewrite (gtpu_tunnel_t * t, bool is_ip6)
   gtpu->type = GTPU_TYPE_GTPU;
   gtpu->teid = clib_host_to_net_u32 (t->teid);
 
-  t->rewrite = r.rw;
   /* Now only support 8-byte gtpu header. TBD */
-  _vec_len (t->rewrite) = sizeof (ip4_gtpu_header_t) - 4;
+  vnet_rewrite_set_data (*t, &r, len - 4);
 
   return;
 }
@@ -362,32 +360,26 @@ int vnet_gtpu_add_del_tunnel
   gtpu_main_t *gtm = &gtpu_main;
   gtpu_tunnel_t *t = 0;
   vnet_main_t *vnm = gtm->vnet_main;
-  uword *p;
   u32 hw_if_index = ~0;
   u32 sw_if_index = ~0;
-  gtpu4_tunnel_key_t key4;
-  gtpu6_tunnel_key_t key6;
+  u32 tunnel_index;
   u32 is_ip6 = a->is_ip6;
+  u32 teid = clib_host_to_net_u32 (a->teid);
 
+  /* decap src in key is encap dst in config */
   if (!is_ip6)
-    {
-      key4.src = a->dst.ip4.as_u32;	/* decap src in key is encap dst in config */
-      key4.teid = clib_host_to_net_u32 (a->teid);
-      p = hash_get (gtm->gtpu4_tunnel_by_key, key4.as_u64);
-    }
+    tunnel_index = udp_tunnel_demux_find4 (&gtm->tunnel_demux,
+					   a->dst.ip4.as_u32, teid);
   else
-    {
-      key6.src = a->dst.ip6;
-      key6.teid = clib_host_to_net_u32 (a->teid);
-      p = hash_get_mem (gtm->gtpu6_tunnel_by_key, &key6);
-    }
+    tunnel_index = udp_tunnel_demux_find6 (&gtm->tunnel_demux,
+					   &a->dst.ip6, teid);
 
   if (a->is_add)
     {
       l2input_main_t *l2im = &l2input_main;
 
       /* adding a tunnel: tunnel must not already exist */
-      if (p)
+      if (tunnel_index != ~0)
 	return VNET_API_ERROR_TUNNEL_EXIST;
 
       /*if not set explicitly, default to l2 */
@@ -408,10 +400,11 @@ int vnet_gtpu_add_del_tunnel
 
       /* copy the key */
       if (is_ip6)
-	hash_set_mem_alloc (&gtm->gtpu6_tunnel_by_key, &key6,
-			    t - gtm->tunnels);
+	udp_tunnel_demux_add_del6 (&gtm->tunnel_demux, &a->dst.ip6, teid,
+				   t - gtm->tunnels, 1 /* is_add */ );
       else
-	hash_set (gtm->gtpu4_tunnel_by_key, key4.as_u64, t - gtm->tunnels);
+	udp_tunnel_demux_add_del4 (&gtm->tunnel_demux, a->dst.ip4.as_u32,
+				   teid, t - gtm->tunnels, 1 /* is_add */ );
 
       vnet_hw_interface_t *hi;
       if (vec_len (gtm->free_gtpu_tunnel_hw_if_indices) > 0)
@@ -567,10 +560,10 @@ int vnet_gtpu_add_del_tunnel
   else
     {
       /* deleting a tunnel: tunnel must exist */
-      if (!p)
+      if (tunnel_index == ~0)
 	return VNET_API_ERROR_NO_SUCH_ENTRY;
 
-      t = pool_elt_at_index (gtm->tunnels, p[0]);
+      t = pool_elt_at_index (gtm->tunnels, tunnel_index);
       sw_if_index = t->sw_if_index;
 
       vnet_sw_interface_set_flags (vnm, t->sw_if_index, 0 /* down */ );
@@ -585,9 +578,11 @@ int vnet_gtpu_add_del_tunnel
       gtm->tunnel_index_by_sw_if_index[t->sw_if_index] = ~0;
 
       if (!is_ip6)
-	hash_unset (gtm->gtpu4_tunnel_by_key, key4.as_u64);
+	udp_tunnel_demux_add_del4 (&gtm->tunnel_demux, a->dst.ip4.as_u32,
+				   teid, tunnel_index, 0 /* is_add */ );
       else
-	hash_unset_mem_free (&gtm->gtpu6_tunnel_by_key, &key6);
+	udp_tunnel_demux_add_del6 (&gtm->tunnel_demux, &a->dst.ip6, teid,
+				   tunnel_index, 0 /* is_add */ );
 
       if (!ip46_address_is_multicast (&t->dst))
 	{
@@ -601,7 +596,6 @@ int vnet_gtpu_add_del_tunnel
 	}
 
       fib_node_deinit (&t->node);
-      vec_free (t->rewrite);
       pool_put (gtm->tunnels, t);
     }
 
@@ -1081,10 +1075,9 @@ gtpu_init (vlib_main_t * vm)
   gtm->vnet_main = vnet_get_main ();
   gtm->vlib_main = vm;
 
+  udp_tunnel_demux_init (&gtm->tunnel_demux, "gtpu");
+
   /* initialize the ip6 hash */
-  gtm->gtpu6_tunnel_by_key = hash_create_mem (0,
-					      sizeof (gtpu6_tunnel_key_t),
-					      sizeof (uword));
   gtm->vtep6 = hash_create_mem (0, sizeof (ip6_address_t), sizeof (uword));
   gtm->mcast_shared = hash_create_mem (0,
 				       sizeof (ip46_address_t),
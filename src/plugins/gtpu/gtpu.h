@@ -30,6 +30,8 @@
 #include <vnet/ip/ip4_packet.h>
 #include <vnet/ip/ip6_packet.h>
 #include <vnet/udp/udp.h>
+#include <vnet/udp/udp_tunnel_demux.h>
+#include <vnet/udp/udp_tunnel_encap.h>
 #include <vnet/dpo/dpo.h>
 #include <vnet/adj/adj_types.h>
 #include <vnet/fib/fib_table.h>
@@ -126,9 +128,6 @@ typedef struct
   /* Required for pool_get_aligned  */
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
 
-  /* Rewrite string */
-  u8 *rewrite;
-
   /* FIB DPO for IP forwarding of gtpu encap packet */
   dpo_id_t next_dpo;
 
@@ -171,6 +170,9 @@ typedef struct
    * The tunnels sibling index on the FIB entry's dependency list.
    */
   u32 sibling_index;
+
+  /* outer ip/udp/gtpu header, see udp_tunnel_encap_stamp */
+  vnet_declare_rewrite (VLIB_BUFFER_PRE_DATA_SIZE);
 } gtpu_tunnel_t;
 
 #define foreach_gtpu_input_next        \
@@ -200,9 +202,8 @@ typedef struct
   /* vector of encap tunnel instances */
   gtpu_tunnel_t *tunnels;
 
-  /* lookup tunnel by key */
-  uword *gtpu4_tunnel_by_key;	/* keyed on ipv4.dst + teid */
-  uword *gtpu6_tunnel_by_key;	/* keyed on ipv6.dst + teid */
+  /* lookup tunnel by key, keyed on ip dst + teid */
+  udp_tunnel_demux_t tunnel_demux;
 
   /* local VTEP IPs ref count used by gtpu-bypass node to check if
      received gtpu packet DIP matches any local VTEP address */
@@ -67,6 +67,12 @@ validate_gtpu_fib (vlib_buffer_t *b, gtpu_tunnel_t *t, u32 is_ip4)
   return (fib_index == t->encap_fib_index);
 }
 
+static_always_inline u32
+gtpu_tunnel_id (void * h)
+{
+  return ((gtpu_header_t *) h)->teid;
+}
+
 always_inline uword
 gtpu_input (vlib_main_t * vm,
              vlib_node_runtime_t * node,
@@ -77,21 +83,17 @@ gtpu_input (vlib_main_t * vm,
   gtpu_main_t * gtm = &gtpu_main;
   vnet_main_t * vnm = gtm->vnet_main;
   vnet_interface_main_t * im = &vnm->interface_main;
-  u32 last_tunnel_index = ~0;
-  gtpu4_tunnel_key_t last_key4;
-  gtpu6_tunnel_key_t last_key6;
+  u32 tunnel_indices[VLIB_FRAME_SIZE], * ti = tunnel_indices;
   u32 pkts_decapsulated = 0;
   u32 thread_index = vlib_get_thread_index();
   u32 stats_sw_if_index, stats_n_packets, stats_n_bytes;
 
-  if (is_ip4)
-    last_key4.as_u64 = ~0;
-  else
-    memset (&last_key6, 0xff, sizeof (last_key6));
-
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
 
+  udp_tunnel_demux_lookup_buffers (vm, &gtm->tunnel_demux, from, n_left_from,
+                                   tunnel_indices, is_ip4, gtpu_tunnel_id);
+
   next_index = node->cached_next_index;
   stats_sw_if_index = node->runtime_data[0];
   stats_n_packets = stats_n_bytes = 0;
@@ -111,7 +113,7 @@ gtpu_input (vlib_main_t * vm,
           ip6_header_t * ip6_0, * ip6_1;
           gtpu_header_t * gtpu0, * gtpu1;
           u32 gtpu_hdr_len0 = 0, gtpu_hdr_len1 =0 ;
-	  uword * p0, * p1;
+	  u32 mcast_index0, mcast_index1;
           u32 tunnel_index0, tunnel_index1;
           gtpu_tunnel_t * t0, * t1, * mt0 = NULL, * mt1 = NULL;
           gtpu4_tunnel_key_t key4_0, key4_1;
@@ -192,25 +194,15 @@ gtpu_input (vlib_main_t * vm,
 
 	  /* Manipulate packet 0 */
           if (is_ip4) {
-            key4_0.src = ip4_0->src_address.as_u32;
-            key4_0.teid = gtpu0->teid;
-
  	    /* Make sure GTPU tunnel exist according to packet SIP and teid
  	     * SIP identify a GTPU path, and teid identify a tunnel in a given GTPU path */
-           if (PREDICT_FALSE (key4_0.as_u64 != last_key4.as_u64))
+            tunnel_index0 = ti[0];
+            if (PREDICT_FALSE (tunnel_index0 == ~0))
               {
-                p0 = hash_get (gtm->gtpu4_tunnel_by_key, key4_0.as_u64);
-                if (PREDICT_FALSE (p0 == NULL))
-                  {
-                    error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
-                    next0 = GTPU_INPUT_NEXT_DROP;
-                    goto trace0;
-                  }
-                last_key4.as_u64 = key4_0.as_u64;
-                tunnel_index0 = last_tunnel_index = p0[0];
+                error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
+                next0 = GTPU_INPUT_NEXT_DROP;
+                goto trace0;
               }
-            else
-              tunnel_index0 = last_tunnel_index;
 	    t0 = pool_elt_at_index (gtm->tunnels, tunnel_index0);
 
 	    /* Validate GTPU tunnel encap-fib index agaist packet */
@@ -229,10 +221,11 @@ gtpu_input (vlib_main_t * vm,
 		key4_0.src = ip4_0->dst_address.as_u32;
 		key4_0.teid = gtpu0->teid;
 		/* Make sure mcast GTPU tunnel exist by packet DIP and teid */
-		p0 = hash_get (gtm->gtpu4_tunnel_by_key, key4_0.as_u64);
-		if (PREDICT_TRUE (p0 != NULL))
+		mcast_index0 = udp_tunnel_demux_find4
+		  (&gtm->tunnel_demux, key4_0.src, key4_0.teid);
+		if (PREDICT_TRUE (mcast_index0 != ~0))
 		  {
-		    mt0 = pool_elt_at_index (gtm->tunnels, p0[0]);
+		    mt0 = pool_elt_at_index (gtm->tunnels, mcast_index0);
 		    goto next0; /* valid packet */
 		  }
 	      }
@@ -241,26 +234,15 @@ gtpu_input (vlib_main_t * vm,
 	    goto trace0;
 
          } else /* !is_ip4 */ {
-            key6_0.src.as_u64[0] = ip6_0->src_address.as_u64[0];
-            key6_0.src.as_u64[1] = ip6_0->src_address.as_u64[1];
-            key6_0.teid = gtpu0->teid;
-
  	    /* Make sure GTPU tunnel exist according to packet SIP and teid
  	     * SIP identify a GTPU path, and teid identify a tunnel in a given GTPU path */
-            if (PREDICT_FALSE (memcmp(&key6_0, &last_key6, sizeof(last_key6)) != 0))
+            tunnel_index0 = ti[0];
+            if (PREDICT_FALSE (tunnel_index0 == ~0))
               {
-                p0 = hash_get_mem (gtm->gtpu6_tunnel_by_key, &key6_0);
-                if (PREDICT_FALSE (p0 == NULL))
-                  {
-                    error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
-                    next0 = GTPU_INPUT_NEXT_DROP;
-                    goto trace0;
-                  }
-                clib_memcpy (&last_key6, &key6_0, sizeof(key6_0));
-                tunnel_index0 = last_tunnel_index = p0[0];
+                error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
+                next0 = GTPU_INPUT_NEXT_DROP;
+                goto trace0;
               }
-            else
-              tunnel_index0 = last_tunnel_index;
 	    t0 = pool_elt_at_index (gtm->tunnels, tunnel_index0);
 
 	    /* Validate GTPU tunnel encap-fib index agaist packet */
@@ -280,10 +262,11 @@ gtpu_input (vlib_main_t * vm,
 		key6_0.src.as_u64[0] = ip6_0->dst_address.as_u64[0];
 		key6_0.src.as_u64[1] = ip6_0->dst_address.as_u64[1];
 		key6_0.teid = gtpu0->teid;
-		p0 = hash_get_mem (gtm->gtpu6_tunnel_by_key, &key6_0);
-		if (PREDICT_TRUE (p0 != NULL))
+		mcast_index0 = udp_tunnel_demux_find6
+		  (&gtm->tunnel_demux, &key6_0.src, key6_0.teid);
+		if (PREDICT_TRUE (mcast_index0 != ~0))
 		  {
-		    mt0 = pool_elt_at_index (gtm->tunnels, p0[0]);
+		    mt0 = pool_elt_at_index (gtm->tunnels, mcast_index0);
 		    goto next0; /* valid packet */
 		  }
 	      }
@@ -366,25 +349,15 @@ gtpu_input (vlib_main_t * vm,
 
           /* Manipulate packet 1 */
           if (is_ip4) {
-            key4_1.src = ip4_1->src_address.as_u32;
-            key4_1.teid = gtpu1->teid;
-
  	    /* Make sure GTPU tunnel exist according to packet SIP and teid
  	     * SIP identify a GTPU path, and teid identify a tunnel in a given GTPU path */
-	    if (PREDICT_FALSE (key4_1.as_u64 != last_key4.as_u64))
+            tunnel_index1 = ti[1];
+            if (PREDICT_FALSE (tunnel_index1 == ~0))
               {
-                p1 = hash_get (gtm->gtpu4_tunnel_by_key, key4_1.as_u64);
-                if (PREDICT_FALSE (p1 == NULL))
-                  {
-                    error1 = GTPU_ERROR_NO_SUCH_TUNNEL;
-                    next1 = GTPU_INPUT_NEXT_DROP;
-                    goto trace1;
-                  }
-                last_key4.as_u64 = key4_1.as_u64;
-                tunnel_index1 = last_tunnel_index = p1[0];
+                error1 = GTPU_ERROR_NO_SUCH_TUNNEL;
+                next1 = GTPU_INPUT_NEXT_DROP;
+                goto trace1;
               }
-            else
-              tunnel_index1 = last_tunnel_index;
  	    t1 = pool_elt_at_index (gtm->tunnels, tunnel_index1);
 
 	    /* Validate GTPU tunnel encap-fib index agaist packet */
@@ -403,10 +376,11 @@ gtpu_input (vlib_main_t * vm,
 		key4_1.src = ip4_1->dst_address.as_u32;
 		key4_1.teid = gtpu1->teid;
 		/* Make sure mcast GTPU tunnel exist by packet DIP and teid */
-		p1 = hash_get (gtm->gtpu4_tunnel_by_key, key4_1.as_u64);
-		if (PREDICT_TRUE (p1 != NULL))
+		mcast_index1 = udp_tunnel_demux_find4
+		  (&gtm->tunnel_demux, key4_1.src, key4_1.teid);
+		if (PREDICT_TRUE (mcast_index1 != ~0))
 		  {
-		    mt1 = pool_elt_at_index (gtm->tunnels, p1[0]);
+		    mt1 = pool_elt_at_index (gtm->tunnels, mcast_index1);
 		    goto next1; /* valid packet */
 		  }
 	      }
@@ -415,28 +389,15 @@ gtpu_input (vlib_main_t * vm,
 	    goto trace1;
 
          } else /* !is_ip4 */ {
-            key6_1.src.as_u64[0] = ip6_1->src_address.as_u64[0];
-            key6_1.src.as_u64[1] = ip6_1->src_address.as_u64[1];
-            key6_1.teid = gtpu1->teid;
-
  	    /* Make sure GTPU tunnel exist according to packet SIP and teid
  	     * SIP identify a GTPU path, and teid identify a tunnel in a given GTPU path */
-            if (PREDICT_FALSE (memcmp(&key6_1, &last_key6, sizeof(last_key6)) != 0))
+            tunnel_index1 = ti[1];
+            if (PREDICT_FALSE (tunnel_index1 == ~0))
               {
-                p1 = hash_get_mem (gtm->gtpu6_tunnel_by_key, &key6_1);
-
-                if (PREDICT_FALSE (p1 == NULL))
-                  {
-                    error1 = GTPU_ERROR_NO_SUCH_TUNNEL;
-                    next1 = GTPU_INPUT_NEXT_DROP;
-                    goto trace1;
-                  }
-
-                clib_memcpy (&last_key6, &key6_1, sizeof(key6_1));
-                tunnel_index1 = last_tunnel_index = p1[0];
+                error1 = GTPU_ERROR_NO_SUCH_TUNNEL;
+                next1 = GTPU_INPUT_NEXT_DROP;
+                goto trace1;
               }
-            else
-              tunnel_index1 = last_tunnel_index;
  	    t1 = pool_elt_at_index (gtm->tunnels, tunnel_index1);
 
 	    /* Validate GTPU tunnel encap-fib index agaist packet */
@@ -456,10 +417,11 @@ gtpu_input (vlib_main_t * vm,
 		key6_1.src.as_u64[0] = ip6_1->dst_address.as_u64[0];
 		key6_1.src.as_u64[1] = ip6_1->dst_address.as_u64[1];
 		key6_1.teid = gtpu1->teid;
-		p1 = hash_get_mem (gtm->gtpu6_tunnel_by_key, &key6_1);
-		if (PREDICT_TRUE (p1 != NULL))
+		mcast_index1 = udp_tunnel_demux_find6
+		  (&gtm->tunnel_demux, &key6_1.src, key6_1.teid);
+		if (PREDICT_TRUE (mcast_index1 != ~0))
 		  {
-		    mt1 = pool_elt_at_index (gtm->tunnels, p1[0]);
+		    mt1 = pool_elt_at_index (gtm->tunnels, mcast_index1);
 		    goto next1; /* valid packet */
 		  }
 	      }
@@ -533,6 +495,8 @@ gtpu_input (vlib_main_t * vm,
               tr->teid = clib_net_to_host_u32(gtpu1->teid);
             }
 
+	  ti += 2;
+
 	  vlib_validate_buffer_enqueue_x2 (vm, node, next_index,
 					   to_next, n_left_to_next,
 					   bi0, bi1, next0, next1);
@@ -547,7 +511,7 @@ gtpu_input (vlib_main_t * vm,
           ip6_header_t * ip6_0;
           gtpu_header_t * gtpu0;
           u32 gtpu_hdr_len0 = 0;
-	  uword * p0;
+	  u32 mcast_index0;
           u32 tunnel_index0;
           gtpu_tunnel_t * t0, * mt0 = NULL;
           gtpu4_tunnel_key_t key4_0;
@@ -595,25 +559,15 @@ gtpu_input (vlib_main_t * vm,
 	    }
 
           if (is_ip4) {
-            key4_0.src = ip4_0->src_address.as_u32;
-            key4_0.teid = gtpu0->teid;
-
  	    /* Make sure GTPU tunnel exist according to packet SIP and teid
  	     * SIP identify a GTPU path, and teid identify a tunnel in a given GTPU path */
-            if (PREDICT_FALSE (key4_0.as_u64 != last_key4.as_u64))
+            tunnel_index0 = ti[0];
+            if (PREDICT_FALSE (tunnel_index0 == ~0))
               {
-                p0 = hash_get (gtm->gtpu4_tunnel_by_key, key4_0.as_u64);
-                if (PREDICT_FALSE (p0 == NULL))
-                  {
-                    error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
-                    next0 = GTPU_INPUT_NEXT_DROP;
-                    goto trace00;
-                  }
-                last_key4.as_u64 = key4_0.as_u64;
-                tunnel_index0 = last_tunnel_index = p0[0];
+                error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
+                next0 = GTPU_INPUT_NEXT_DROP;
+                goto trace00;
               }
-            else
-              tunnel_index0 = last_tunnel_index;
 	    t0 = pool_elt_at_index (gtm->tunnels, tunnel_index0);
 
 	    /* Validate GTPU tunnel encap-fib index agaist packet */
@@ -632,10 +586,11 @@ gtpu_input (vlib_main_t * vm,
 		key4_0.src = ip4_0->dst_address.as_u32;
 		key4_0.teid = gtpu0->teid;
 		/* Make sure mcast GTPU tunnel exist by packet DIP and teid */
-		p0 = hash_get (gtm->gtpu4_tunnel_by_key, key4_0.as_u64);
-		if (PREDICT_TRUE (p0 != NULL))
+		mcast_index0 = udp_tunnel_demux_find4
+		  (&gtm->tunnel_demux, key4_0.src, key4_0.teid);
+		if (PREDICT_TRUE (mcast_index0 != ~0))
 		  {
-		    mt0 = pool_elt_at_index (gtm->tunnels, p0[0]);
+		    mt0 = pool_elt_at_index (gtm->tunnels, mcast_index0);
 		    goto next00; /* valid packet */
 		  }
 	      }
@@ -644,26 +599,15 @@ gtpu_input (vlib_main_t * vm,
 	    goto trace00;
 
           } else /* !is_ip4 */ {
-            key6_0.src.as_u64[0] = ip6_0->src_address.as_u64[0];
-            key6_0.src.as_u64[1] = ip6_0->src_address.as_u64[1];
-            key6_0.teid = gtpu0->teid;
-
  	    /* Make sure GTPU tunnel exist according to packet SIP and teid
  	     * SIP identify a GTPU path, and teid identify a tunnel in a given GTPU path */
-            if (PREDICT_FALSE (memcmp(&key6_0, &last_key6, sizeof(last_key6)) != 0))
+            tunnel_index0 = ti[0];
+            if (PREDICT_FALSE (tunnel_index0 == ~0))
               {
-                p0 = hash_get_mem (gtm->gtpu6_tunnel_by_key, &key6_0);
-                if (PREDICT_FALSE (p0 == NULL))
-                  {
-                    error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
-                    next0 = GTPU_INPUT_NEXT_DROP;
-                    goto trace00;
-                  }
-                clib_memcpy (&last_key6, &key6_0, sizeof(key6_0));
-                tunnel_index0 = last_tunnel_index = p0[0];
+                error0 = GTPU_ERROR_NO_SUCH_TUNNEL;
+                next0 = GTPU_INPUT_NEXT_DROP;
+                goto trace00;
               }
-            else
-              tunnel_index0 = last_tunnel_index;
 	    t0 = pool_elt_at_index (gtm->tunnels, tunnel_index0);
 
 	    /* Validate GTPU tunnel encap-fib index agaist packet */
@@ -683,10 +627,11 @@ gtpu_input (vlib_main_t * vm,
 		key6_0.src.as_u64[0] = ip6_0->dst_address.as_u64[0];
 		key6_0.src.as_u64[1] = ip6_0->dst_address.as_u64[1];
 		key6_0.teid = gtpu0->teid;
-		p0 = hash_get_mem (gtm->gtpu6_tunnel_by_key, &key6_0);
-		if (PREDICT_TRUE (p0 != NULL))
+		mcast_index0 = udp_tunnel_demux_find6
+		  (&gtm->tunnel_demux, &key6_0.src, key6_0.teid);
+		if (PREDICT_TRUE (mcast_index0 != ~0))
 		  {
-		    mt0 = pool_elt_at_index (gtm->tunnels, p0[0]);
+		    mt0 = pool_elt_at_index (gtm->tunnels, mcast_index0);
 		    goto next00; /* valid packet */
 		  }
 	      }
@@ -759,6 +704,8 @@ gtpu_input (vlib_main_t * vm,
               tr->tunnel_index = tunnel_index0;
               tr->teid = clib_net_to_host_u32(gtpu0->teid);
             }
+	  ti += 1;
+
 	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
 					   to_next, n_left_to_next,
 					   bi0, next0);
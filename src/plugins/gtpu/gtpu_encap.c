@@ -23,11 +23,13 @@
 #define foreach_gtpu_encap_error    \
 _(ENCAPSULATED, "good packets encapsulated")
 
+#ifndef CLIB_MARCH_VARIANT
 static char * gtpu_encap_error_strings[] = {
 #define _(sym,string) string,
   foreach_gtpu_encap_error
 #undef _
 };
+#endif
 
 typedef enum {
 #define _(sym,str) GTPU_ENCAP_ERROR_##sym,
@@ -53,6 +55,7 @@ typedef struct {
   u32 teid;
 } gtpu_encap_trace_t;
 
+#ifndef CLIB_MARCH_VARIANT
 u8 * format_gtpu_encap_trace (u8 * s, va_list * args)
 {
   CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
@@ -64,13 +67,7 @@ u8 * format_gtpu_encap_trace (u8 * s, va_list * args)
 	      t->tunnel_index, t->teid);
   return s;
 }
-
-
-#define foreach_fixed_header4_offset            \
-    _(0) _(1) _(2) _(3)
-
-#define foreach_fixed_header6_offset            \
-    _(0) _(1) _(2) _(3) _(4) _(5) _(6)
+#endif
 
 always_inline uword
 gtpu_encap_inline (vlib_main_t * vm,
@@ -78,566 +75,112 @@ gtpu_encap_inline (vlib_main_t * vm,
 		    vlib_frame_t * from_frame,
 		    u32 is_ip4)
 {
-  u32 n_left_from, next_index, * from, * to_next;
+  u32 n_left_from, * from;
   gtpu_main_t * gtm = &gtpu_main;
   vnet_main_t * vnm = gtm->vnet_main;
   vnet_interface_main_t * im = &vnm->interface_main;
-  u32 pkts_encapsulated = 0;
-  u16 old_l0 = 0, old_l1 = 0, old_l2 = 0, old_l3 = 0;
+  vlib_buffer_t * bufs[VLIB_FRAME_SIZE], ** b = bufs;
+  u16 nexts[VLIB_FRAME_SIZE], * next = nexts;
+  u16 src_ports[VLIB_FRAME_SIZE], * src_port = src_ports;
   u32 thread_index = vlib_get_thread_index();
   u32 stats_sw_if_index, stats_n_packets, stats_n_bytes;
-  u32 sw_if_index0 = 0, sw_if_index1 = 0, sw_if_index2 = 0, sw_if_index3 = 0;
-  u32 next0 = 0, next1 = 0, next2 = 0, next3 = 0;
-  vnet_hw_interface_t * hi0, * hi1, * hi2, * hi3;
-  gtpu_tunnel_t * t0 = NULL, * t1 = NULL, * t2 = NULL, * t3 = NULL;
+  u32 sw_if_index0 = ~0;
+  u16 next0 = 0;
+  u16 gtpu_offset = is_ip4 ?
+    sizeof (ip4_header_t) + sizeof (udp_header_t) :
+    sizeof (ip6_header_t) + sizeof (udp_header_t);
+  vnet_hw_interface_t * hi0;
+  gtpu_tunnel_t * t0 = NULL;
 
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
+  vlib_get_buffers (vm, from, bufs, n_left_from);
 
-  next_index = node->cached_next_index;
   stats_sw_if_index = node->runtime_data[0];
   stats_n_packets = stats_n_bytes = 0;
 
   while (n_left_from > 0)
     {
-      u32 n_left_to_next;
+      gtpu_header_t * gtpu0;
+      u32 len0;
 
-      vlib_get_next_frame (vm, node, next_index,
-			   to_next, n_left_to_next);
-
-      while (n_left_from >= 8 && n_left_to_next >= 4)
+      if (n_left_from > 2)
 	{
-          u32 bi0, bi1, bi2, bi3;
-	  vlib_buffer_t * b0, * b1, * b2, * b3;
-          u32 flow_hash0, flow_hash1, flow_hash2, flow_hash3;
-	  u32 len0, len1, len2, len3;
-          ip4_header_t * ip4_0, * ip4_1, * ip4_2, * ip4_3;
-          ip6_header_t * ip6_0, * ip6_1, * ip6_2, * ip6_3;
-          udp_header_t * udp0, * udp1, * udp2, * udp3;
-          gtpu_header_t * gtpu0, * gtpu1, * gtpu2, * gtpu3;
-          u64 * copy_src0, * copy_dst0;
-          u64 * copy_src1, * copy_dst1;
-          u64 * copy_src2, * copy_dst2;
-          u64 * copy_src3, * copy_dst3;
-          u32 * copy_src_last0, * copy_dst_last0;
-          u32 * copy_src_last1, * copy_dst_last1;
-          u32 * copy_src_last2, * copy_dst_last2;
-          u32 * copy_src_last3, * copy_dst_last3;
-          u16 new_l0, new_l1, new_l2, new_l3;
-          ip_csum_t sum0, sum1, sum2, sum3;
-
-	  /* Prefetch next iteration. */
-	  {
-	    vlib_buffer_t * p4, * p5, * p6, * p7;
-
-	    p4 = vlib_get_buffer (vm, from[4]);
-	    p5 = vlib_get_buffer (vm, from[5]);
-	    p6 = vlib_get_buffer (vm, from[6]);
-	    p7 = vlib_get_buffer (vm, from[7]);
-
-	    vlib_prefetch_buffer_header (p4, LOAD);
-	    vlib_prefetch_buffer_header (p5, LOAD);
-	    vlib_prefetch_buffer_header (p6, LOAD);
-	    vlib_prefetch_buffer_header (p7, LOAD);
-
-	    CLIB_PREFETCH (p4->data, 2*CLIB_CACHE_LINE_BYTES, LOAD);
-	    CLIB_PREFETCH (p5->data, 2*CLIB_CACHE_LINE_BYTES, LOAD);
-	    CLIB_PREFETCH (p6->data, 2*CLIB_CACHE_LINE_BYTES, LOAD);
-	    CLIB_PREFETCH (p7->data, 2*CLIB_CACHE_LINE_BYTES, LOAD);
-	  }
-
-	  bi0 = from[0];
-	  bi1 = from[1];
-	  bi2 = from[2];
-	  bi3 = from[3];
-	  to_next[0] = bi0;
-	  to_next[1] = bi1;
-	  to_next[2] = bi2;
-	  to_next[3] = bi3;
-	  from += 4;
-	  to_next += 4;
-	  n_left_to_next -= 4;
-	  n_left_from -= 4;
-
-	  b0 = vlib_get_buffer (vm, bi0);
-	  b1 = vlib_get_buffer (vm, bi1);
-	  b2 = vlib_get_buffer (vm, bi2);
-	  b3 = vlib_get_buffer (vm, bi3);
-
-          flow_hash0 = vnet_l2_compute_flow_hash (b0);
-          flow_hash1 = vnet_l2_compute_flow_hash (b1);
-          flow_hash2 = vnet_l2_compute_flow_hash (b2);
-          flow_hash3 = vnet_l2_compute_flow_hash (b3);
-
-	  /* Get next node index and adj index from tunnel next_dpo */
-	  sw_if_index0 = vnet_buffer(b0)->sw_if_index[VLIB_TX];
-	  sw_if_index1 = vnet_buffer(b1)->sw_if_index[VLIB_TX];
-	  sw_if_index2 = vnet_buffer(b2)->sw_if_index[VLIB_TX];
-	  sw_if_index3 = vnet_buffer(b3)->sw_if_index[VLIB_TX];
-	  hi0 = vnet_get_sup_hw_interface (vnm, sw_if_index0);
-	  hi1 = vnet_get_sup_hw_interface (vnm, sw_if_index1);
-	  hi2 = vnet_get_sup_hw_interface (vnm, sw_if_index2);
-	  hi3 = vnet_get_sup_hw_interface (vnm, sw_if_index3);
-	  t0 = &gtm->tunnels[hi0->dev_instance];
-	  t1 = &gtm->tunnels[hi1->dev_instance];
-	  t2 = &gtm->tunnels[hi2->dev_instance];
-	  t3 = &gtm->tunnels[hi3->dev_instance];
-
-	  /* Note: change to always set next0 if it may be set to drop */
-	  next0 = t0->next_dpo.dpoi_next_node;
-          vnet_buffer(b0)->ip.adj_index[VLIB_TX] = t0->next_dpo.dpoi_index;
-	  next1 = t1->next_dpo.dpoi_next_node;
-          vnet_buffer(b1)->ip.adj_index[VLIB_TX] = t1->next_dpo.dpoi_index;
-	  next2 = t2->next_dpo.dpoi_next_node;
-          vnet_buffer(b2)->ip.adj_index[VLIB_TX] = t2->next_dpo.dpoi_index;
-	  next3 = t3->next_dpo.dpoi_next_node;
-          vnet_buffer(b3)->ip.adj_index[VLIB_TX] = t3->next_dpo.dpoi_index;
-
-          /* Apply the rewrite string. $$$$ vnet_rewrite? */
-          vlib_buffer_advance (b0, -(word)_vec_len(t0->rewrite));
-          vlib_buffer_advance (b1, -(word)_vec_len(t1->rewrite));
-          vlib_buffer_advance (b2, -(word)_vec_len(t2->rewrite));
-          vlib_buffer_advance (b3, -(word)_vec_len(t3->rewrite));
-
-	  if (is_ip4)
-	    {
-	      ip4_0 = vlib_buffer_get_current(b0);
-	      ip4_1 = vlib_buffer_get_current(b1);
-	      ip4_2 = vlib_buffer_get_current(b2);
-	      ip4_3 = vlib_buffer_get_current(b3);
-
-	      /* Copy the fixed header */
-	      copy_dst0 = (u64 *) ip4_0;
-	      copy_src0 = (u64 *) t0->rewrite;
-	      copy_dst1 = (u64 *) ip4_1;
-	      copy_src1 = (u64 *) t1->rewrite;
-	      copy_dst2 = (u64 *) ip4_2;
-	      copy_src2 = (u64 *) t2->rewrite;
-	      copy_dst3 = (u64 *) ip4_3;
-	      copy_src3 = (u64 *) t3->rewrite;
-
-	      /* Copy first 32 octets 8-bytes at a time */
-#define _(offs) copy_dst0[offs] = copy_src0[offs];
-	      foreach_fixed_header4_offset;
-#undef _
-#define _(offs) copy_dst1[offs] = copy_src1[offs];
-	      foreach_fixed_header4_offset;
-#undef _
-#define _(offs) copy_dst2[offs] = copy_src2[offs];
-	      foreach_fixed_header4_offset;
-#undef _
-#define _(offs) copy_dst3[offs] = copy_src3[offs];
-	      foreach_fixed_header4_offset;
-#undef _
-	      /* Last 4 octets. Hopefully gcc will be our friend */
-              copy_dst_last0 = (u32 *)(&copy_dst0[4]);
-              copy_src_last0 = (u32 *)(&copy_src0[4]);
-              copy_dst_last0[0] = copy_src_last0[0];
-              copy_dst_last1 = (u32 *)(&copy_dst1[4]);
-              copy_src_last1 = (u32 *)(&copy_src1[4]);
-              copy_dst_last1[0] = copy_src_last1[0];
-              copy_dst_last2 = (u32 *)(&copy_dst2[4]);
-              copy_src_last2 = (u32 *)(&copy_src2[4]);
-              copy_dst_last2[0] = copy_src_last2[0];
-              copy_dst_last3 = (u32 *)(&copy_dst3[4]);
-              copy_src_last3 = (u32 *)(&copy_src3[4]);
-              copy_dst_last3[0] = copy_src_last3[0];
-
-	      /* Fix the IP4 checksum and length */
-	      sum0 = ip4_0->checksum;
-	      new_l0 = /* old_l0 always 0, see the rewrite setup */
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b0));
-              sum0 = ip_csum_update (sum0, old_l0, new_l0, ip4_header_t,
-				     length /* changed member */);
-	      ip4_0->checksum = ip_csum_fold (sum0);
-	      ip4_0->length = new_l0;
-	      sum1 = ip4_1->checksum;
-	      new_l1 = /* old_l1 always 0, see the rewrite setup */
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b1));
-              sum1 = ip_csum_update (sum1, old_l1, new_l1, ip4_header_t,
-				     length /* changed member */);
-	      ip4_1->checksum = ip_csum_fold (sum1);
-	      ip4_1->length = new_l1;
-	      sum2 = ip4_2->checksum;
-	      new_l2 = /* old_l0 always 0, see the rewrite setup */
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b2));
-              sum2 = ip_csum_update (sum2, old_l2, new_l2, ip4_header_t,
-				     length /* changed member */);
-	      ip4_2->checksum = ip_csum_fold (sum2);
-	      ip4_2->length = new_l2;
-	      sum3 = ip4_3->checksum;
-	      new_l3 = /* old_l1 always 0, see the rewrite setup */
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b3));
-              sum3 = ip_csum_update (sum3, old_l3, new_l3, ip4_header_t,
-				     length /* changed member */);
-	      ip4_3->checksum = ip_csum_fold (sum3);
-	      ip4_3->length = new_l3;
-
-	      /* Fix UDP length and set source port */
-	      udp0 = (udp_header_t *)(ip4_0+1);
-	      new_l0 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b0)
-					     - sizeof (*ip4_0));
-	      udp0->length = new_l0;
-	      udp0->src_port = flow_hash0;
-	      udp1 = (udp_header_t *)(ip4_1+1);
-	      new_l1 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b1)
-					     - sizeof (*ip4_1));
-	      udp1->length = new_l1;
-	      udp1->src_port = flow_hash1;
-	      udp2 = (udp_header_t *)(ip4_2+1);
-	      new_l2 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b2)
-					     - sizeof (*ip4_2));
-	      udp2->length = new_l2;
-	      udp2->src_port = flow_hash2;
-	      udp3 = (udp_header_t *)(ip4_3+1);
-	      new_l3 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b3)
-					     - sizeof (*ip4_3));
-	      udp3->length = new_l3;
-	      udp3->src_port = flow_hash3;
-
-	      /* Fix GTPU length */
-	      gtpu0 = (gtpu_header_t *)(udp0+1);
-	      new_l0 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b0)
-					     - sizeof (*ip4_0) - sizeof(*udp0));
-	      gtpu0->length = new_l0;
-	      gtpu1 = (gtpu_header_t *)(udp1+1);
-	      new_l1 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b1)
-					     - sizeof (*ip4_1) - sizeof(*udp1));
-	      gtpu1->length = new_l1;
-	      gtpu2 = (gtpu_header_t *)(udp2+1);
-	      new_l2 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b2)
-					     - sizeof (*ip4_2) - sizeof(*udp2));
-	      gtpu2->length = new_l2;
-	      gtpu3 = (gtpu_header_t *)(udp1+3);
-	      new_l3 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b3)
-					     - sizeof (*ip4_3) - sizeof(*udp3));
-	      gtpu3->length = new_l3;
-	    }
-	  else /* ipv6 */
-	    {
-              int bogus = 0;
-
-	      ip6_0 = vlib_buffer_get_current(b0);
-	      ip6_1 = vlib_buffer_get_current(b1);
-	      ip6_2 = vlib_buffer_get_current(b2);
-	      ip6_3 = vlib_buffer_get_current(b3);
-
-	      /* Copy the fixed header */
-	      copy_dst0 = (u64 *) ip6_0;
-	      copy_src0 = (u64 *) t0->rewrite;
-	      copy_dst1 = (u64 *) ip6_1;
-	      copy_src1 = (u64 *) t1->rewrite;
-	      copy_dst2 = (u64 *) ip6_2;
-	      copy_src2 = (u64 *) t2->rewrite;
-	      copy_dst3 = (u64 *) ip6_3;
-	      copy_src3 = (u64 *) t3->rewrite;
-	      /* Copy first 56 (ip6) octets 8-bytes at a time */
-#define _(offs) copy_dst0[offs] = copy_src0[offs];
-	      foreach_fixed_header6_offset;
-#undef _
-#define _(offs) copy_dst1[offs] = copy_src1[offs];
-	      foreach_fixed_header6_offset;
-#undef _
-#define _(offs) copy_dst2[offs] = copy_src2[offs];
-	      foreach_fixed_header6_offset;
-#undef _
-#define _(offs) copy_dst3[offs] = copy_src3[offs];
-	      foreach_fixed_header6_offset;
-#undef _
-	      /* Fix IP6 payload length */
-	      new_l0 =
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b0)
-				      - sizeof(*ip6_0));
-	      ip6_0->payload_length = new_l0;
-	      new_l1 =
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b1)
-				      - sizeof(*ip6_1));
-	      ip6_1->payload_length = new_l1;
-	      new_l2 =
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b2)
-				      - sizeof(*ip6_2));
-	      ip6_2->payload_length = new_l2;
-	      new_l3 =
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b3)
-				      - sizeof(*ip6_3));
-	      ip6_3->payload_length = new_l3;
-
-	      /* Fix UDP length  and set source port */
-	      udp0 = (udp_header_t *)(ip6_0+1);
-	      udp0->length = new_l0;
-	      udp0->src_port = flow_hash0;
-	      udp1 = (udp_header_t *)(ip6_1+1);
-	      udp1->length = new_l1;
-	      udp1->src_port = flow_hash1;
-	      udp2 = (udp_header_t *)(ip6_2+1);
-	      udp2->length = new_l2;
-	      udp2->src_port = flow_hash2;
-	      udp3 = (udp_header_t *)(ip6_3+1);
-	      udp3->length = new_l3;
-	      udp3->src_port = flow_hash3;
-
-	      /* IPv6 UDP checksum is mandatory */
-	      udp0->checksum = ip6_tcp_udp_icmp_compute_checksum(vm, b0,
-								 ip6_0, &bogus);
-	      if (udp0->checksum == 0)
-		udp0->checksum = 0xffff;
-	      udp1->checksum = ip6_tcp_udp_icmp_compute_checksum(vm, b1,
-                                                        ip6_1, &bogus);
-	      if (udp1->checksum == 0)
-		udp1->checksum = 0xffff;
-	      udp2->checksum = ip6_tcp_udp_icmp_compute_checksum(vm, b2,
-								 ip6_2, &bogus);
-	      if (udp2->checksum == 0)
-		udp2->checksum = 0xffff;
-	      udp3->checksum = ip6_tcp_udp_icmp_compute_checksum(vm, b3,
-                                                        ip6_3, &bogus);
-	      if (udp3->checksum == 0)
-		udp3->checksum = 0xffff;
-
-	      /* Fix GTPU length */
-	      gtpu0 = (gtpu_header_t *)(udp0+1);
-	      new_l0 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b0)
-					     - sizeof (*ip4_0) - sizeof(*udp0));
-	      gtpu0->length = new_l0;
-	      gtpu1 = (gtpu_header_t *)(udp1+1);
-	      new_l1 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b1)
-					     - sizeof (*ip4_1) - sizeof(*udp1));
-	      gtpu1->length = new_l1;
-	      gtpu2 = (gtpu_header_t *)(udp2+1);
-	      new_l2 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b2)
-					     - sizeof (*ip4_2) - sizeof(*udp2));
-	      gtpu2->length = new_l2;
-	      gtpu3 = (gtpu_header_t *)(udp3+1);
-	      new_l3 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b3)
-					     - sizeof (*ip4_3) - sizeof(*udp3));
-	      gtpu3->length = new_l3;
-	    }
-
-          pkts_encapsulated += 4;
- 	  len0 = vlib_buffer_length_in_chain (vm, b0);
- 	  len1 = vlib_buffer_length_in_chain (vm, b1);
- 	  len2 = vlib_buffer_length_in_chain (vm, b2);
- 	  len3 = vlib_buffer_length_in_chain (vm, b3);
-	  stats_n_packets += 4;
-	  stats_n_bytes += len0 + len1 + len2 + len3;
-
-	  /* Batch stats increment on the same gtpu tunnel so counter is not
-	     incremented per packet. Note stats are still incremented for deleted
-	     and admin-down tunnel where packets are dropped. It is not worthwhile
-	     to check for this rare case and affect normal path performance. */
-	  if (PREDICT_FALSE ((sw_if_index0 != stats_sw_if_index) ||
-			     (sw_if_index1 != stats_sw_if_index) ||
-			     (sw_if_index2 != stats_sw_if_index) ||
-			     (sw_if_index3 != stats_sw_if_index) ))
-	    {
-	      stats_n_packets -= 4;
-	      stats_n_bytes -= len0 + len1 + len2 + len3;
-	      if ( (sw_if_index0 == sw_if_index1 ) &&
-		   (sw_if_index1 == sw_if_index2 ) &&
-		   (sw_if_index2 == sw_if_index3 ) )
-	        {
-		  if (stats_n_packets)
-		    vlib_increment_combined_counter
-		      (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
-		       thread_index, stats_sw_if_index,
-		       stats_n_packets, stats_n_bytes);
-		  stats_sw_if_index = sw_if_index0;
-		  stats_n_packets = 4;
-		  stats_n_bytes = len0 + len1 + len2 + len3;
-	        }
-	      else
-	        {
-		  vlib_increment_combined_counter
-		      (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
-		       thread_index, sw_if_index0, 1, len0);
-		  vlib_increment_combined_counter
-		      (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
-		       thread_index, sw_if_index1, 1, len1);
-		  vlib_increment_combined_counter
-		      (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
-		       thread_index, sw_if_index2, 1, len2);
-		  vlib_increment_combined_counter
-		      (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
-		       thread_index, sw_if_index3, 1, len3);
-		}
-	    }
-
-	  if (PREDICT_FALSE(b0->flags & VLIB_BUFFER_IS_TRACED))
-            {
-              gtpu_encap_trace_t *tr =
-                vlib_add_trace (vm, node, b0, sizeof (*tr));
-              tr->tunnel_index = t0 - gtm->tunnels;
-              tr->teid = t0->teid;
-           }
-
-          if (PREDICT_FALSE(b1->flags & VLIB_BUFFER_IS_TRACED))
-            {
-              gtpu_encap_trace_t *tr =
-                vlib_add_trace (vm, node, b1, sizeof (*tr));
-              tr->tunnel_index = t1 - gtm->tunnels;
-              tr->teid = t1->teid;
-            }
-
-	  vlib_validate_buffer_enqueue_x4 (vm, node, next_index,
-					   to_next, n_left_to_next,
-					   bi0, bi1, bi2, bi3,
-					   next0, next1, next2, next3);
+	  vlib_prefetch_buffer_header (b[2], LOAD);
+	  CLIB_PREFETCH (b[2]->data, 2 * CLIB_CACHE_LINE_BYTES, LOAD);
 	}
 
-      while (n_left_from > 0 && n_left_to_next > 0)
+      src_port[0] = udp_tunnel_encap_src_port
+	(vnet_l2_compute_flow_hash (b[0]));
+
+      /* Get next node index and adj index from tunnel next_dpo */
+      if (sw_if_index0 != vnet_buffer(b[0])->sw_if_index[VLIB_TX])
 	{
-	  u32 bi0;
-	  vlib_buffer_t * b0;
-          u32 flow_hash0;
-	  u32 len0;
-          ip4_header_t * ip4_0;
-          ip6_header_t * ip6_0;
-          udp_header_t * udp0;
-          gtpu_header_t * gtpu0;
-          u64 * copy_src0, * copy_dst0;
-          u32 * copy_src_last0, * copy_dst_last0;
-          u16 new_l0;
-          ip_csum_t sum0;
-
-	  bi0 = from[0];
-	  to_next[0] = bi0;
-	  from += 1;
-	  to_next += 1;
-	  n_left_from -= 1;
-	  n_left_to_next -= 1;
-
-	  b0 = vlib_get_buffer (vm, bi0);
-
-          flow_hash0 = vnet_l2_compute_flow_hash(b0);
-
-	  /* Get next node index and adj index from tunnel next_dpo */
-	  sw_if_index0 = vnet_buffer(b0)->sw_if_index[VLIB_TX];
+	  sw_if_index0 = vnet_buffer(b[0])->sw_if_index[VLIB_TX];
 	  hi0 = vnet_get_sup_hw_interface (vnm, sw_if_index0);
 	  t0 = &gtm->tunnels[hi0->dev_instance];
 	  /* Note: change to always set next0 if it may be set to drop */
 	  next0 = t0->next_dpo.dpoi_next_node;
-	  vnet_buffer(b0)->ip.adj_index[VLIB_TX] = t0->next_dpo.dpoi_index;
+	}
 
-          /* Apply the rewrite string. $$$$ vnet_rewrite? */
-          vlib_buffer_advance (b0, -(word)_vec_len(t0->rewrite));
+      ASSERT (t0 != NULL);
 
-	  if (is_ip4)
-	    {
-	      ip4_0 = vlib_buffer_get_current(b0);
+      vnet_buffer(b[0])->ip.adj_index[VLIB_TX] = t0->next_dpo.dpoi_index;
+      next[0] = next0;
 
-	      /* Copy the fixed header */
-	      copy_dst0 = (u64 *) ip4_0;
-	      copy_src0 = (u64 *) t0->rewrite;
-	      /* Copy first 32 octets 8-bytes at a time */
-#define _(offs) copy_dst0[offs] = copy_src0[offs];
-	      foreach_fixed_header4_offset;
-#undef _
-	      /* Last 4 octets. Hopefully gcc will be our friend */
-              copy_dst_last0 = (u32 *)(&copy_dst0[4]);
-              copy_src_last0 = (u32 *)(&copy_src0[4]);
-              copy_dst_last0[0] = copy_src_last0[0];
-
-	      /* Fix the IP4 checksum and length */
-	      sum0 = ip4_0->checksum;
-	      new_l0 = /* old_l0 always 0, see the rewrite setup */
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b0));
-              sum0 = ip_csum_update (sum0, old_l0, new_l0, ip4_header_t,
-				     length /* changed member */);
-	      ip4_0->checksum = ip_csum_fold (sum0);
-	      ip4_0->length = new_l0;
-
-	      /* Fix UDP length and set source port */
-	      udp0 = (udp_header_t *)(ip4_0+1);
-	      new_l0 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b0)
-					     - sizeof (*ip4_0));
-	      udp0->length = new_l0;
-	      udp0->src_port = flow_hash0;
-
-	      /* Fix GTPU length */
-	      gtpu0 = (gtpu_header_t *)(udp0+1);
-	      new_l0 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b0)
-					     - sizeof (*ip4_0) - sizeof(*udp0));
-	      gtpu0->length = new_l0;
-	    }
-
-	  else /* ip6 path */
-	    {
-              int bogus = 0;
-
-	      ip6_0 = vlib_buffer_get_current(b0);
-	      /* Copy the fixed header */
-	      copy_dst0 = (u64 *) ip6_0;
-	      copy_src0 = (u64 *) t0->rewrite;
-	      /* Copy first 56 (ip6) octets 8-bytes at a time */
-#define _(offs) copy_dst0[offs] = copy_src0[offs];
-	      foreach_fixed_header6_offset;
-#undef _
-	      /* Fix IP6 payload length */
-	      new_l0 =
-                clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, b0)
-				      - sizeof(*ip6_0));
-	      ip6_0->payload_length = new_l0;
-
-	      /* Fix UDP length  and set source port */
-	      udp0 = (udp_header_t *)(ip6_0+1);
-	      udp0->length = new_l0;
-	      udp0->src_port = flow_hash0;
-
-	      /* IPv6 UDP checksum is mandatory */
-	      udp0->checksum = ip6_tcp_udp_icmp_compute_checksum(vm, b0,
-								 ip6_0, &bogus);
-	      if (udp0->checksum == 0)
-		udp0->checksum = 0xffff;
-
-	      /* Fix GTPU length */
-	      gtpu0 = (gtpu_header_t *)(udp0+1);
-	      new_l0 = clib_host_to_net_u16 (vlib_buffer_length_in_chain(vm, b0)
-					     - sizeof (*ip4_0) - sizeof(*udp0));
-	      gtpu0->length = new_l0;
-	    }
-
-          pkts_encapsulated ++;
-	  len0 = vlib_buffer_length_in_chain (vm, b0);
-	  stats_n_packets += 1;
-	  stats_n_bytes += len0;
-
-	  /* Batch stats increment on the same gtpu tunnel so counter is not
-	     incremented per packet. Note stats are still incremented for deleted
-	     and admin-down tunnel where packets are dropped. It is not worthwhile
-	     to check for this rare case and affect normal path performance. */
-	  if (PREDICT_FALSE (sw_if_index0 != stats_sw_if_index))
-	    {
-	      stats_n_packets -= 1;
-	      stats_n_bytes -= len0;
-	      if (stats_n_packets)
-		vlib_increment_combined_counter
-		  (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
-		   thread_index, stats_sw_if_index,
-		   stats_n_packets, stats_n_bytes);
-	      stats_n_packets = 1;
-	      stats_n_bytes = len0;
-	      stats_sw_if_index = sw_if_index0;
-	    }
-
-          if (PREDICT_FALSE(b0->flags & VLIB_BUFFER_IS_TRACED))
-            {
-              gtpu_encap_trace_t *tr =
-                vlib_add_trace (vm, node, b0, sizeof (*tr));
-              tr->tunnel_index = t0 - gtm->tunnels;
-              tr->teid = t0->teid;
-            }
-	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
-					   to_next, n_left_to_next,
-					   bi0, next0);
+      /* Apply the rewrite, ip and udp fields are fixed below */
+      udp_tunnel_encap_stamp (b[0], t0);
+
+      len0 = vlib_buffer_length_in_chain (vm, b[0]);
+
+      /* Fix GTPU length */
+      gtpu0 = vlib_buffer_get_current (b[0]) + gtpu_offset;
+      gtpu0->length = clib_host_to_net_u16 (len0 - gtpu_offset);
+
+      /* Batch stats increment on the same gtpu tunnel so counter is not
+	 incremented per packet. Note stats are still incremented for deleted
+	 and admin-down tunnel where packets are dropped. It is not worthwhile
+	 to check for this rare case and affect normal path performance. */
+      if (PREDICT_FALSE (sw_if_index0 != stats_sw_if_index))
+	{
+	  if (stats_n_packets)
+	    vlib_increment_combined_counter
+	      (im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX,
+	       thread_index, stats_sw_if_index,
+	       stats_n_packets, stats_n_bytes);
+	  stats_sw_if_index = sw_if_index0;
+	  stats_n_packets = stats_n_bytes = 0;
 	}
+      stats_n_packets += 1;
+      stats_n_bytes += len0;
 
-      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+      if (PREDICT_FALSE(b[0]->flags & VLIB_BUFFER_IS_TRACED))
+	{
+	  gtpu_encap_trace_t *tr =
+	    vlib_add_trace (vm, node, b[0], sizeof (*tr));
+	  tr->tunnel_index = t0 - gtm->tunnels;
+	  tr->teid = t0->teid;
+	}
+
+      b += 1;
+      next += 1;
+      src_port += 1;
+      n_left_from -= 1;
     }
 
+  if (is_ip4)
+    udp_tunnel_encap_fixup4 (vm, bufs, src_ports, from_frame->n_vectors,
+			     /* ip4_csum */ 1);
+  else
+    udp_tunnel_encap_fixup6 (vm, bufs, src_ports, from_frame->n_vectors,
+			     /* udp_csum */ 1);
+
+  vlib_buffer_enqueue_to_next (vm, node, from, nexts, from_frame->n_vectors);
+
   /* Do we still need this now that tunnel tx stats is kept? */
   vlib_node_increment_counter (vm, node->node_index,
                                GTPU_ENCAP_ERROR_ENCAPSULATED,
-                               pkts_encapsulated);
+                               from_frame->n_vectors);
 
   /* Increment any remaining batch stats */
   if (stats_n_packets)
@@ -651,24 +194,22 @@ gtpu_encap_inline (vlib_main_t * vm,
   return from_frame->n_vectors;
 }
 
-static uword
-gtpu4_encap (vlib_main_t * vm,
-	      vlib_node_runtime_t * node,
-	      vlib_frame_t * from_frame)
+VLIB_NODE_FN (gtpu4_encap_node) (vlib_main_t * vm,
+				 vlib_node_runtime_t * node,
+				 vlib_frame_t * from_frame)
 {
   return gtpu_encap_inline (vm, node, from_frame, /* is_ip4 */ 1);
 }
 
-static uword
-gtpu6_encap (vlib_main_t * vm,
-	      vlib_node_runtime_t * node,
-	      vlib_frame_t * from_frame)
+VLIB_NODE_FN (gtpu6_encap_node) (vlib_main_t * vm,
+				 vlib_node_runtime_t * node,
+				 vlib_frame_t * from_frame)
 {
   return gtpu_encap_inline (vm, node, from_frame, /* is_ip4 */ 0);
 }
 
+#ifndef CLIB_MARCH_VARIANT
 VLIB_REGISTER_NODE (gtpu4_encap_node) = {
-  .function = gtpu4_encap,
   .name = "gtpu4-encap",
   .vector_size = sizeof (u32),
   .format_trace = format_gtpu_encap_trace,
@@ -683,10 +224,7 @@ VLIB_REGISTER_NODE (gtpu4_encap_node) = {
   },
 };
 
-VLIB_NODE_FUNCTION_MULTIARCH (gtpu4_encap_node, gtpu4_encap)
-
 VLIB_REGISTER_NODE (gtpu6_encap_node) = {
-  .function = gtpu6_encap,
   .name = "gtpu6-encap",
   .vector_size = sizeof (u32),
   .format_trace = format_gtpu_encap_trace,
@@ -700,6 +238,4 @@ VLIB_REGISTER_NODE (gtpu6_encap_node) = {
 #undef _
   },
 };
-
-VLIB_NODE_FUNCTION_MULTIARCH (gtpu6_encap_node, gtpu6_encap)
-
+#endif
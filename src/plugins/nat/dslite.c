@@ -164,6 +164,25 @@ dslite_set_b4_ip4_addr (dslite_main_t * dm, ip4_address_t * addr)
   return 0;
 }
 
+static void
+dslite_address_init_free_ports (dslite_main_t * dm, snat_address_t * a)
+{
+  u32 t, *threads = 0;
+
+  for (t = 0; t < clib_max (dm->num_workers, 1); t++)
+    vec_add1 (threads, dm->first_worker_index + t);
+  nat_address_init_free_ports (a, dm->port_per_thread, threads);
+  vec_free (threads);
+}
+
+void
+dslite_init_free_ports (dslite_main_t * dm)
+{
+  snat_address_t *a;
+
+  vec_foreach (a, dm->addr_pool) dslite_address_init_free_ports (dm, a);
+}
+
 int
 dslite_add_del_pool_addr (dslite_main_t * dm, ip4_address_t * addr, u8 is_add)
 {
@@ -197,7 +216,8 @@ dslite_add_del_pool_addr (dslite_main_t * dm, ip4_address_t * addr, u8 is_add)
       vec_validate_init_empty (a->busy_##n##_ports_per_thread, tm->n_vlib_mains - 1, 0);
       foreach_snat_protocol
 #undef _
-	dslite_dpo_create (DPO_PROTO_IP4, 0, &dpo_v4);
+	dslite_address_init_free_ports (dm, a);
+      dslite_dpo_create (DPO_PROTO_IP4, 0, &dpo_v4);
       fib_table_entry_special_dpo_add (0, &pfx, FIB_SOURCE_PLUGIN_HI,
 				       FIB_ENTRY_FLAG_EXCLUSIVE, &dpo_v4);
       dpo_reset (&dpo_v4);
@@ -211,6 +231,7 @@ dslite_add_del_pool_addr (dslite_main_t * dm, ip4_address_t * addr, u8 is_add)
       vec_free (a->busy_##n##_ports_per_thread);
       foreach_snat_protocol
 #undef _
+	nat_address_free_free_ports (a);
 	fib_table_entry_special_remove (0, &pfx, FIB_SOURCE_PLUGIN_HI);
       vec_del1 (dm->addr_pool, i);
     }
@@ -133,6 +133,7 @@ extern vlib_node_registration_t dslite_ce_decap_node;
 
 void dslite_init (vlib_main_t * vm);
 void dslite_set_ce (dslite_main_t * dm, u8 set);
+void dslite_init_free_ports (dslite_main_t * dm);
 int dslite_set_aftr_ip6_addr (dslite_main_t * dm, ip6_address_t * addr);
 int dslite_set_b4_ip6_addr (dslite_main_t * dm, ip6_address_t * addr);
 int dslite_set_aftr_ip4_addr (dslite_main_t * dm, ip4_address_t * addr);
@@ -312,6 +312,7 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
 {
   snat_user_t *u;
   snat_session_t *s;
+  snat_session_cold_t *c;
   clib_bihash_kv_8_8_t kv0;
   snat_session_key_t key1;
   u32 address_index = ~0;
@@ -373,13 +374,14 @@ static u32 slow_path (snat_main_t *sm, vlib_buffer_t *b0,
   if (is_sm)
     s->flags |= SNAT_SESSION_FLAG_STATIC_MAPPING;
   user_session_increment (sm, u, is_sm);
-  s->outside_address_index = address_index;
+  c = nat44_session_cold (&sm->per_thread_data[thread_index], s);
+  c->outside_address_index = address_index;
   s->in2out = *key0;
   s->out2in = key1;
   s->out2in.protocol = key0->protocol;
   s->out2in.fib_index = outside_fib_index;
-  s->ext_host_addr.as_u32 = ip0->dst_address.as_u32;
-  s->ext_host_port = udp0->dst_port;
+  c->ext_host_addr.as_u32 = ip0->dst_address.as_u32;
+  c->ext_host_port = udp0->dst_port;
   *sessionp = s;
 
   /* Add to translation hashes */
@@ -984,7 +986,8 @@ static inline u32 icmp_in2out_slow_path (snat_main_t *sm,
         snat_icmp_hairpinning(sm, b0, ip0, icmp0, sm->endpoint_dependent);
       /* Accounting */
       nat44_session_update_counters (s0, now,
-                                     vlib_buffer_length_in_chain (sm->vlib_main, b0));
+                                     vlib_buffer_length_in_chain (sm->vlib_main, b0),
+                                     thread_index);
       /* Per-user LRU list maintenance */
       nat44_session_update_lru (sm, s0, thread_index);
     }
@@ -1271,7 +1274,8 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
         trace00:
@@ -1431,7 +1435,8 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
 
           /* Accounting */
           nat44_session_update_counters (s1, now,
-                                         vlib_buffer_length_in_chain (vm, b1));
+                                         vlib_buffer_length_in_chain (vm, b1),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s1, thread_index);
         trace01:
@@ -1628,7 +1633,8 @@ snat_in2out_node_fn_inline (vlib_main_t * vm,
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
 
@@ -2194,11 +2200,14 @@ nat44_in2out_reass_node_fn (vlib_main_t * vm,
 
           /* Hairpinning */
           nat44_reass_hairpinning (sm, b0, ip0, s0->out2in.port,
-                                   s0->ext_host_port, proto0);
+                                   nat44_session_cold (per_thread_data,
+                                                       s0)->ext_host_port,
+                                   proto0);
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
 
@@ -2352,6 +2361,7 @@ slow_path_ed (snat_main_t *sm,
               u32 thread_index)
 {
   snat_session_t *s;
+  snat_session_cold_t *c;
   snat_user_t *u;
   snat_session_key_t key0, key1;
   u8 lb = 0, is_sm = 0;
@@ -2411,9 +2421,10 @@ slow_path_ed (snat_main_t *sm,
   if (lb)
     s->flags |= SNAT_SESSION_FLAG_LOAD_BALANCING;
   s->flags |= SNAT_SESSION_FLAG_ENDPOINT_DEPENDENT;
-  s->outside_address_index = address_index;
-  s->ext_host_addr = key->r_addr;
-  s->ext_host_port = key->r_port;
+  c = nat44_session_cold (tsm, s);
+  c->outside_address_index = address_index;
+  c->ext_host_addr = key->r_addr;
+  c->ext_host_port = key->r_port;
   s->in2out = key0;
   s->out2in = key1;
   s->out2in.protocol = key0.protocol;
@@ -2525,7 +2536,8 @@ nat_not_translate_output_feature_fwd (snat_main_t * sm, ip4_header_t * ip,
           nat44_session_update_lru (sm, s, thread_index);
           /* Accounting */
           nat44_session_update_counters (s, now,
-                                         vlib_buffer_length_in_chain (vm, b));
+                                         vlib_buffer_length_in_chain (vm, b),
+                                         thread_index);
           return 1;
         }
       else
@@ -2725,10 +2737,10 @@ nat44_ed_in2out_unknown_proto (snat_main_t *sm,
   u32 old_addr, new_addr = 0;
   ip_csum_t sum;
   snat_user_t *u;
-  dlist_elt_t *head, *elt;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
-  u32 elt_index, head_index, ses_index;
+  u32 *ses_index;
   snat_session_t * s;
+  snat_session_cold_t *c;
   u32 address_index = ~0;
   int i;
   u8 is_sm = 0;
@@ -2775,28 +2787,15 @@ nat44_ed_in2out_unknown_proto (snat_main_t *sm,
       else
         {
           /* Choose same out address as for TCP/UDP session to same destination */
-          head_index = u->sessions_per_user_list_head_index;
-          head = pool_elt_at_index (tsm->list_pool, head_index);
-          elt_index = head->next;
-	  if (PREDICT_FALSE (elt_index == ~0))
-	    ses_index = ~0;
-	  else
-	    {
-	      elt = pool_elt_at_index (tsm->list_pool, elt_index);
-	      ses_index = elt->value;
-	    }
-
-          while (ses_index != ~0)
+          vec_foreach (ses_index, u->sessions)
             {
-              s =  pool_elt_at_index (tsm->sessions, ses_index);
-              elt_index = elt->next;
-              elt = pool_elt_at_index (tsm->list_pool, elt_index);
-              ses_index = elt->value;
+              s = pool_elt_at_index (tsm->sessions, ses_index[0]);
+              c = nat44_session_cold (tsm, s);
 
-              if (s->ext_host_addr.as_u32 == ip->dst_address.as_u32)
+              if (c->ext_host_addr.as_u32 == ip->dst_address.as_u32)
                 {
                   new_addr = ip->src_address.as_u32 = s->out2in.addr.as_u32;
-                  address_index = s->outside_address_index;
+                  address_index = c->outside_address_index;
 
                   make_ed_kv (&s_kv, &s->out2in.addr, &ip->dst_address,
                               ip->protocol, sm->outside_fib_index, 0, 0);
@@ -2830,10 +2829,11 @@ create_ses:
           return 0;
         }
 
-      s->ext_host_addr.as_u32 = ip->dst_address.as_u32;
+      c = nat44_session_cold (tsm, s);
+      c->ext_host_addr.as_u32 = ip->dst_address.as_u32;
       s->flags |= SNAT_SESSION_FLAG_UNKNOWN_PROTO;
       s->flags |= SNAT_SESSION_FLAG_ENDPOINT_DEPENDENT;
-      s->outside_address_index = address_index;
+      c->outside_address_index = address_index;
       s->out2in.addr.as_u32 = new_addr;
       s->out2in.fib_index = sm->outside_fib_index;
       s->in2out.addr.as_u32 = old_addr;
@@ -2863,7 +2863,8 @@ create_ses:
   ip->checksum = ip_csum_fold (sum);
 
   /* Accounting */
-  nat44_session_update_counters (s, now, vlib_buffer_length_in_chain (vm, b));
+  nat44_session_update_counters (s, now, vlib_buffer_length_in_chain (vm, b),
+                                         thread_index);
   /* Per-user LRU list maintenance */
   nat44_session_update_lru (sm, s, thread_index);
 
@@ -2877,6 +2878,50 @@ create_ses:
   return s;
 }
 
+/* Build the in2out keys of a frame and search them all at once */
+static_always_inline void
+nat44_ed_in2out_lookup_batch (vlib_main_t * vm,
+                              snat_main_per_thread_data_t * tsm, u32 * from,
+                              u32 n, int is_output_feature,
+                              nat_ed_lookup_batch_t * batch)
+{
+  vlib_buffer_t *b, *p;
+  ip4_header_t *ip;
+  udp_header_t *udp;
+  u32 i, sw_if_index, last_sw_if_index = ~0, fib_index = ~0;
+
+  for (i = 0; i < n; i++)
+    {
+      if (i + 4 < n)
+        {
+          p = vlib_get_buffer (vm, from[i + 4]);
+          vlib_prefetch_buffer_header (p, LOAD);
+          CLIB_PREFETCH (p->data, CLIB_CACHE_LINE_BYTES, LOAD);
+        }
+
+      b = vlib_get_buffer (vm, from[i]);
+      ip = vlib_buffer_get_current (b);
+      if (is_output_feature)
+        ip = (ip4_header_t *) ((u8 *) ip +
+                               vnet_buffer (b)->ip.save_rewrite_length);
+
+      sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_RX];
+      if (PREDICT_FALSE (sw_if_index != last_sw_if_index))
+        {
+          fib_index = fib_table_get_index_for_sw_if_index (FIB_PROTOCOL_IP4,
+                                                           sw_if_index);
+          last_sw_if_index = sw_if_index;
+        }
+
+      /* Keys of non TCP/UDP packets are never used, no need to skip them */
+      udp = ip4_next_header (ip);
+      make_ed_kv (&batch->kv[i], &ip->src_address, &ip->dst_address,
+                  ip->protocol, fib_index, udp->src_port, udp->dst_port);
+    }
+
+  nat_ed_lookup_batch_search (&tsm->in2out_ed, batch, n);
+}
+
 static inline uword
 nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
                                 vlib_node_runtime_t * node,
@@ -2889,6 +2934,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
   f64 now = vlib_time_now (vm);
   u32 thread_index = vlib_get_thread_index ();
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  nat_ed_lookup_batch_t batch;
 
   stats_node_index = is_slow_path ? nat44_ed_in2out_slowpath_node.index :
     nat44_ed_in2out_node.index;
@@ -2897,6 +2943,12 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
   n_left_from = frame->n_vectors;
   next_index = node->cached_next_index;
 
+  /* The fast path only looks sessions up, search the whole frame first */
+  batch.is_valid = 0;
+  if (!is_slow_path)
+    nat44_ed_in2out_lookup_batch (vm, tsm, from, n_left_from,
+                                  is_output_feature, &batch);
+
   while (n_left_from > 0)
     {
       u32 n_left_to_next;
@@ -2905,7 +2957,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
 
       while (n_left_from >= 4 && n_left_to_next >= 2)
 	{
-          u32 bi0, bi1;
+          u32 bi0, bi1, i0, i1;
 	  vlib_buffer_t *b0, *b1;
           u32 next0, sw_if_index0, rx_fib_index0, iph_offset0 = 0, proto0,
               new_addr0, old_addr0;
@@ -2917,6 +2969,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
           tcp_header_t *tcp0, *tcp1;
           icmp46_header_t *icmp0, *icmp1;
           snat_session_t *s0 = 0, *s1 = 0;
+          snat_session_cold_t *c0, *c1;
           clib_bihash_kv_16_8_t kv0, value0, kv1, value1;
           ip_csum_t sum0, sum1;
 
@@ -2935,6 +2988,8 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
 	  }
 
           /* speculatively enqueue b0 and b1 to the current next frame */
+	  i0 = frame->n_vectors - n_left_from;
+	  i1 = i0 + 1;
 	  to_next[0] = bi0 = from[0];
 	  to_next[1] = bi1 = from[1];
 	  from += 2;
@@ -2999,7 +3054,10 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
                 {
                   if (PREDICT_FALSE(nat_not_translate_output_feature_fwd(
                       sm, ip0, thread_index, now, vm, b0)))
-                    goto trace00;
+                    {
+                      batch.is_valid = 0;
+                      goto trace00;
+                    }
                 }
 
               if (PREDICT_FALSE (proto0 == ~0 || proto0 == SNAT_PROTOCOL_ICMP))
@@ -3019,7 +3077,8 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
           make_ed_kv (&kv0, &ip0->src_address, &ip0->dst_address, ip0->protocol,
                       rx_fib_index0, udp0->src_port, udp0->dst_port);
 
-          if (clib_bihash_search_16_8 (&tsm->in2out_ed, &kv0, &value0))
+          if (nat_ed_lookup_batch_get (&tsm->in2out_ed, &batch, i0, &kv0,
+                                        &value0))
             {
               if (is_slow_path)
                 {
@@ -3055,6 +3114,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               s0 = pool_elt_at_index (tsm->sessions, value0.value);
             }
 
+          c0 = nat44_session_cold (tsm, s0);
           b0->flags |= VNET_BUFFER_F_IS_NATED;
 
           if (!is_output_feature)
@@ -3067,7 +3127,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
                                  src_address);
           if (PREDICT_FALSE (is_twice_nat_session (s0)))
             sum0 = ip_csum_update (sum0, ip0->dst_address.as_u32,
-                                   s0->ext_host_addr.as_u32, ip4_header_t,
+                                   c0->ext_host_addr.as_u32, ip4_header_t,
                                    dst_address);
           ip0->checksum = ip_csum_fold (sum0);
 
@@ -3084,17 +3144,20 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               if (PREDICT_FALSE (is_twice_nat_session (s0)))
                 {
                   sum0 = ip_csum_update (sum0, ip0->dst_address.as_u32,
-                                         s0->ext_host_addr.as_u32,
+                                         c0->ext_host_addr.as_u32,
                                          ip4_header_t, dst_address);
                   sum0 = ip_csum_update (sum0, tcp0->dst_port,
-                                         s0->ext_host_port, ip4_header_t,
+                                         c0->ext_host_port, ip4_header_t,
                                          length);
-                  tcp0->dst_port = s0->ext_host_port;
-                  ip0->dst_address.as_u32 = s0->ext_host_addr.as_u32;
+                  tcp0->dst_port = c0->ext_host_port;
+                  ip0->dst_address.as_u32 = c0->ext_host_addr.as_u32;
                 }
               tcp0->checksum = ip_csum_fold(sum0);
               if (nat44_set_tcp_session_state_i2o (sm, s0, tcp0, thread_index))
-                goto trace00;
+                {
+                  batch.is_valid = 0;
+                  goto trace00;
+                }
             }
           else
             {
@@ -3102,14 +3165,15 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               udp0->checksum = 0;
               if (PREDICT_FALSE (is_twice_nat_session (s0)))
                 {
-                  udp0->dst_port = s0->ext_host_port;
-                  ip0->dst_address.as_u32 = s0->ext_host_addr.as_u32;
+                  udp0->dst_port = c0->ext_host_port;
+                  ip0->dst_address.as_u32 = c0->ext_host_addr.as_u32;
                 }
             }
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
 
@@ -3184,7 +3248,10 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
                 {
                   if (PREDICT_FALSE(nat_not_translate_output_feature_fwd(
                       sm, ip1, thread_index, now, vm, b1)))
-                    goto trace01;
+                    {
+                      batch.is_valid = 0;
+                      goto trace01;
+                    }
                 }
 
               if (PREDICT_FALSE (proto1 == ~0 || proto1 == SNAT_PROTOCOL_ICMP))
@@ -3204,7 +3271,8 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
           make_ed_kv (&kv1, &ip1->src_address, &ip1->dst_address, ip1->protocol,
                       rx_fib_index1, udp1->src_port, udp1->dst_port);
 
-          if (clib_bihash_search_16_8 (&tsm->in2out_ed, &kv1, &value1))
+          if (nat_ed_lookup_batch_get (&tsm->in2out_ed, &batch, i1, &kv1,
+                                        &value1))
             {
               if (is_slow_path)
                 {
@@ -3240,6 +3308,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               s1 = pool_elt_at_index (tsm->sessions, value1.value);
             }
 
+          c1 = nat44_session_cold (tsm, s1);
           b1->flags |= VNET_BUFFER_F_IS_NATED;
 
           if (!is_output_feature)
@@ -3252,7 +3321,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
                                  src_address);
           if (PREDICT_FALSE (is_twice_nat_session (s1)))
             sum1 = ip_csum_update (sum1, ip1->dst_address.as_u32,
-                                   s1->ext_host_addr.as_u32, ip4_header_t,
+                                   c1->ext_host_addr.as_u32, ip4_header_t,
                                    dst_address);
           ip1->checksum = ip_csum_fold (sum1);
 
@@ -3269,17 +3338,20 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               if (PREDICT_FALSE (is_twice_nat_session (s1)))
                 {
                   sum1 = ip_csum_update (sum1, ip1->dst_address.as_u32,
-                                         s1->ext_host_addr.as_u32,
+                                         c1->ext_host_addr.as_u32,
                                          ip4_header_t, dst_address);
                   sum1 = ip_csum_update (sum1, tcp1->dst_port,
-                                         s1->ext_host_port, ip4_header_t,
+                                         c1->ext_host_port, ip4_header_t,
                                          length);
-                  tcp1->dst_port = s1->ext_host_port;
-                  ip1->dst_address.as_u32 = s1->ext_host_addr.as_u32;
+                  tcp1->dst_port = c1->ext_host_port;
+                  ip1->dst_address.as_u32 = c1->ext_host_addr.as_u32;
                 }
               tcp1->checksum = ip_csum_fold(sum1);
               if (nat44_set_tcp_session_state_i2o (sm, s1, tcp1, thread_index))
-                goto trace01;
+                {
+                  batch.is_valid = 0;
+                  goto trace01;
+                }
             }
           else
             {
@@ -3287,14 +3359,15 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               udp1->checksum = 0;
               if (PREDICT_FALSE (is_twice_nat_session (s1)))
                 {
-                  udp1->dst_port = s1->ext_host_port;
-                  ip1->dst_address.as_u32 = s1->ext_host_addr.as_u32;
+                  udp1->dst_port = c1->ext_host_port;
+                  ip1->dst_address.as_u32 = c1->ext_host_addr.as_u32;
                 }
             }
 
           /* Accounting */
           nat44_session_update_counters (s1, now,
-                                         vlib_buffer_length_in_chain (vm, b1));
+                                         vlib_buffer_length_in_chain (vm, b1),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s1, thread_index);
 
@@ -3322,7 +3395,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
 
       while (n_left_from > 0 && n_left_to_next > 0)
 	{
-          u32 bi0;
+          u32 bi0, i0;
 	  vlib_buffer_t *b0;
           u32 next0, sw_if_index0, rx_fib_index0, iph_offset0 = 0, proto0,
               new_addr0, old_addr0;
@@ -3332,10 +3405,12 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
           tcp_header_t *tcp0;
           icmp46_header_t * icmp0;
           snat_session_t *s0 = 0;
+          snat_session_cold_t *c0;
           clib_bihash_kv_16_8_t kv0, value0;
           ip_csum_t sum0;
 
           /* speculatively enqueue b0 to the current next frame */
+	  i0 = frame->n_vectors - n_left_from;
 	  bi0 = from[0];
 	  to_next[0] = bi0;
 	  from += 1;
@@ -3398,7 +3473,10 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
                 {
                   if (PREDICT_FALSE(nat_not_translate_output_feature_fwd(
                       sm, ip0, thread_index, now, vm, b0)))
-                    goto trace0;
+                    {
+                      batch.is_valid = 0;
+                      goto trace0;
+                    }
                 }
 
               if (PREDICT_FALSE (proto0 == ~0 || proto0 == SNAT_PROTOCOL_ICMP))
@@ -3418,7 +3496,8 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
           make_ed_kv (&kv0, &ip0->src_address, &ip0->dst_address, ip0->protocol,
                       rx_fib_index0, udp0->src_port, udp0->dst_port);
 
-          if (clib_bihash_search_16_8 (&tsm->in2out_ed, &kv0, &value0))
+          if (nat_ed_lookup_batch_get (&tsm->in2out_ed, &batch, i0, &kv0,
+                                        &value0))
             {
               if (is_slow_path)
                 {
@@ -3454,6 +3533,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               s0 = pool_elt_at_index (tsm->sessions, value0.value);
             }
 
+          c0 = nat44_session_cold (tsm, s0);
           b0->flags |= VNET_BUFFER_F_IS_NATED;
 
           if (!is_output_feature)
@@ -3466,7 +3546,7 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
                                  src_address);
           if (PREDICT_FALSE (is_twice_nat_session (s0)))
             sum0 = ip_csum_update (sum0, ip0->dst_address.as_u32,
-                                   s0->ext_host_addr.as_u32, ip4_header_t,
+                                   c0->ext_host_addr.as_u32, ip4_header_t,
                                    dst_address);
           ip0->checksum = ip_csum_fold (sum0);
 
@@ -3483,17 +3563,20 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               if (PREDICT_FALSE (is_twice_nat_session (s0)))
                 {
                   sum0 = ip_csum_update (sum0, ip0->dst_address.as_u32,
-                                         s0->ext_host_addr.as_u32,
+                                         c0->ext_host_addr.as_u32,
                                          ip4_header_t, dst_address);
                   sum0 = ip_csum_update (sum0, tcp0->dst_port,
-                                         s0->ext_host_port, ip4_header_t,
+                                         c0->ext_host_port, ip4_header_t,
                                          length);
-                  tcp0->dst_port = s0->ext_host_port;
-                  ip0->dst_address.as_u32 = s0->ext_host_addr.as_u32;
+                  tcp0->dst_port = c0->ext_host_port;
+                  ip0->dst_address.as_u32 = c0->ext_host_addr.as_u32;
                 }
               tcp0->checksum = ip_csum_fold(sum0);
               if (nat44_set_tcp_session_state_i2o (sm, s0, tcp0, thread_index))
-                goto trace0;
+                {
+                  batch.is_valid = 0;
+                  goto trace0;
+                }
             }
           else
             {
@@ -3501,14 +3584,15 @@ nat44_ed_in2out_node_fn_inline (vlib_main_t * vm,
               udp0->checksum = 0;
               if (PREDICT_FALSE (is_twice_nat_session (s0)))
                 {
-                  udp0->dst_port = s0->ext_host_port;
-                  ip0->dst_address.as_u32 = s0->ext_host_addr.as_u32;
+                  udp0->dst_port = c0->ext_host_port;
+                  ip0->dst_address.as_u32 = c0->ext_host_addr.as_u32;
                 }
             }
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
 
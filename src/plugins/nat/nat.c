@@ -194,13 +194,14 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index)
   snat_address_t *a;
   snat_main_per_thread_data_t *tsm =
     vec_elt_at_index (sm->per_thread_data, thread_index);
+  snat_session_cold_t *c = nat44_session_cold (tsm, s);
 
   if (is_fwd_bypass_session (s))
     {
       ed_key.l_addr = s->in2out.addr;
-      ed_key.r_addr = s->ext_host_addr;
+      ed_key.r_addr = c->ext_host_addr;
       ed_key.l_port = s->in2out.port;
-      ed_key.r_port = s->ext_host_port;
+      ed_key.r_port = c->ext_host_port;
       ed_key.proto = snat_proto_to_ip_proto (s->in2out.protocol);
       ed_key.fib_index = 0;
       ed_kv.key[0] = ed_key.as_u64[0];
@@ -214,7 +215,7 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index)
   if (is_ed_session (s))
     {
       ed_key.l_addr = s->out2in.addr;
-      ed_key.r_addr = s->ext_host_addr;
+      ed_key.r_addr = c->ext_host_addr;
       ed_key.fib_index = s->out2in.fib_index;
       if (snat_is_unk_proto_session (s))
         {
@@ -226,7 +227,7 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index)
         {
           ed_key.proto = snat_proto_to_ip_proto (s->in2out.protocol);
           ed_key.l_port = s->out2in.port;
-          ed_key.r_port = s->ext_host_port;
+          ed_key.r_port = c->ext_host_port;
         }
       ed_kv.key[0] = ed_key.as_u64[0];
       ed_kv.key[1] = ed_key.as_u64[1];
@@ -239,8 +240,8 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index)
         ed_key.l_port = s->in2out.port;
       if (is_twice_nat_session (s))
         {
-          ed_key.r_addr = s->ext_host_nat_addr;
-          ed_key.r_port = s->ext_host_nat_port;
+          ed_key.r_addr = c->ext_host_nat_addr;
+          ed_key.r_port = c->ext_host_nat_port;
         }
       ed_kv.key[0] = ed_key.as_u64[0];
       ed_kv.key[1] = ed_key.as_u64[1];
@@ -274,9 +275,9 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index)
       for (i = 0; i < vec_len (sm->twice_nat_addresses); i++)
         {
           key.protocol = s->in2out.protocol;
-          key.port = s->ext_host_nat_port;
+          key.port = c->ext_host_nat_port;
           a = sm->twice_nat_addresses + i;
-          if (a->addr.as_u32 == s->ext_host_nat_addr.as_u32)
+          if (a->addr.as_u32 == c->ext_host_nat_addr.as_u32)
             {
               snat_free_outside_address_and_port (sm->twice_nat_addresses,
                                                   thread_index, &key, i);
@@ -288,9 +289,9 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index)
   if (snat_is_session_static (s))
     return;
 
-  if (s->outside_address_index != ~0)
+  if (c->outside_address_index != ~0)
     snat_free_outside_address_and_port (sm->addresses, thread_index,
-                                        &s->out2in, s->outside_address_index);
+                                        &s->out2in, c->outside_address_index);
 }
 
 snat_user_t *
@@ -301,7 +302,6 @@ nat_user_get_or_create (snat_main_t *sm, ip4_address_t *addr, u32 fib_index,
   snat_user_key_t user_key;
   clib_bihash_kv_8_8_t kv, value;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
-  dlist_elt_t * per_user_list_head_elt;
 
   user_key.addr.as_u32 = addr->as_u32;
   user_key.fib_index = fib_index;
@@ -316,13 +316,6 @@ nat_user_get_or_create (snat_main_t *sm, ip4_address_t *addr, u32 fib_index,
       u->addr.as_u32 = addr->as_u32;
       u->fib_index = fib_index;
 
-      pool_get (tsm->list_pool, per_user_list_head_elt);
-
-      u->sessions_per_user_list_head_index = per_user_list_head_elt -
-        tsm->list_pool;
-
-      clib_dlist_init (tsm->list_pool, u->sessions_per_user_list_head_index);
-
       kv.value = u - tsm->users;
 
       /* add user */
@@ -337,35 +330,50 @@ nat_user_get_or_create (snat_main_t *sm, ip4_address_t *addr, u32 fib_index,
   return u;
 }
 
+/**
+ * @brief Pick the session of a user to recycle, clock algorithm.
+ *
+ * The hand sweeps the sessions of the user. A session used since the hand
+ * last passed gets a second chance, the first one which was not is the
+ * victim. Packets only set a flag in the session, so keeping the order
+ * costs nothing on the forwarding path.
+ */
+static u32
+nat_user_clock_victim (snat_main_per_thread_data_t *tsm, snat_user_t *u)
+{
+  snat_session_t *s;
+  u32 i, n = vec_len (u->sessions);
+
+  ASSERT (n);
+
+  /* After a full turn all flags are clear, so this ends within n + 1 */
+  for (i = 0; i <= n; i++)
+    {
+      if (u->clock_hand >= n)
+        u->clock_hand = 0;
+      s = pool_elt_at_index (tsm->sessions, u->sessions[u->clock_hand]);
+      if (!(s->flags & SNAT_SESSION_FLAG_REFERENCED))
+        break;
+      s->flags &= ~SNAT_SESSION_FLAG_REFERENCED;
+      u->clock_hand++;
+    }
+
+  /* The recycled session is the last one the hand comes back to */
+  return u->sessions[u->clock_hand++];
+}
+
 snat_session_t *
 nat_session_alloc_or_recycle (snat_main_t *sm, snat_user_t *u, u32 thread_index)
 {
   snat_session_t *s;
+  snat_session_cold_t *c;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
-  u32 oldest_per_user_translation_list_index, session_index;
-  dlist_elt_t * oldest_per_user_translation_list_elt;
-  dlist_elt_t * per_user_translation_list_elt;
+  u32 session_index, per_user_index;
 
   /* Over quota? Recycle the least recently used translation */
   if ((u->nsessions + u->nstaticsessions) >= sm->max_translations_per_user)
     {
-      oldest_per_user_translation_list_index =
-        clib_dlist_remove_head (tsm->list_pool,
-                                u->sessions_per_user_list_head_index);
-
-      ASSERT (oldest_per_user_translation_list_index != ~0);
-
-      /* Add it back to the end of the LRU list */
-      clib_dlist_addtail (tsm->list_pool,
-                          u->sessions_per_user_list_head_index,
-                          oldest_per_user_translation_list_index);
-      /* Get the list element */
-      oldest_per_user_translation_list_elt =
-        pool_elt_at_index (tsm->list_pool,
-                           oldest_per_user_translation_list_index);
-
-      /* Get the session index from the list element */
-      session_index = oldest_per_user_translation_list_elt->value;
+      session_index = nat_user_clock_victim (tsm, u);
 
       /* Get the session */
       s = pool_elt_at_index (tsm->sessions, session_index);
@@ -374,34 +382,26 @@ nat_session_alloc_or_recycle (snat_main_t *sm, snat_user_t *u, u32 thread_index)
         u->nstaticsessions--;
       else
         u->nsessions--;
-      s->outside_address_index = ~0;
-      s->flags = 0;
-      s->total_bytes = 0;
-      s->total_pkts = 0;
-      s->state = 0;
-      s->ext_host_addr.as_u32 = 0;
-      s->ext_host_port = 0;
-      s->ext_host_nat_addr.as_u32 = 0;
-      s->ext_host_nat_port = 0;
+
+      /* Keep its place in the session vector of the user */
+      c = nat44_session_cold (tsm, s);
+      per_user_index = c->per_user_index;
+      memset (s, 0, sizeof (*s));
+      memset (c, 0, sizeof (*c));
+      c->per_user_index = per_user_index;
+      c->outside_address_index = ~0;
     }
   else
     {
-      pool_get (tsm->sessions, s);
+      pool_get_aligned (tsm->sessions, s, CLIB_CACHE_LINE_BYTES);
       memset (s, 0, sizeof (*s));
-      s->outside_address_index = ~0;
-
-      /* Create list elts */
-      pool_get (tsm->list_pool, per_user_translation_list_elt);
-      clib_dlist_init (tsm->list_pool,
-                       per_user_translation_list_elt - tsm->list_pool);
+      vec_validate (tsm->sessions_cold, s - tsm->sessions);
+      c = nat44_session_cold (tsm, s);
+      memset (c, 0, sizeof (*c));
+      c->outside_address_index = ~0;
 
-      per_user_translation_list_elt->value = s - tsm->sessions;
-      s->per_user_index = per_user_translation_list_elt - tsm->list_pool;
-      s->per_user_list_head_index = u->sessions_per_user_list_head_index;
-
-      clib_dlist_addtail (tsm->list_pool,
-                          s->per_user_list_head_index,
-                          per_user_translation_list_elt - tsm->list_pool);
+      c->per_user_index = vec_len (u->sessions);
+      vec_add1 (u->sessions, s - tsm->sessions);
     }
 
   return s;
@@ -663,6 +663,198 @@ snat_add_del_addr_to_fib (ip4_address_t * addr, u8 p_len, u32 sw_if_index,
                            FIB_SOURCE_PLUGIN_LOW);
 }
 
+static int
+nat_alloc_addr_and_port_default (snat_address_t * addresses,
+                                 u32 fib_index,
+                                 u32 thread_index,
+                                 snat_session_key_t * k,
+                                 u32 * address_indexp,
+                                 u16 port_per_thread,
+                                 u32 snat_thread_index);
+
+/* Free port ring of the thread port range the port belongs to, if any */
+static nat_free_ports_t *
+nat_free_ports_of_port (nat_free_ports_t * per_thread, u16 port)
+{
+  u32 t;
+
+  if (!vec_len (per_thread) || port < 1024)
+    return 0;
+  t = (port - 1024) / per_thread[0].n_ports;
+  if (t >= vec_len (per_thread))
+    return 0;
+  return vec_elt_at_index (per_thread, t);
+}
+
+/* Count the free ports of a range, the ring is filled on first use */
+static void
+nat_free_ports_init (nat_free_ports_t * fp, uword * busy_port_bitmap,
+                     u16 port_per_thread, u32 range_index, u32 thread_index)
+{
+  u32 i, n;
+
+  fp->ports = 0;
+  fp->head = 0;
+  fp->first_port = 1024 + range_index * port_per_thread;
+  fp->n_ports = port_per_thread;
+  fp->n_free = port_per_thread;
+  fp->thread_index = thread_index;
+  for (i = 0; i < port_per_thread; i += n)
+    {
+      n = clib_min (port_per_thread - i, BITS (uword));
+      fp->n_free -= count_set_bits
+        (clib_bitmap_get_multiple (busy_port_bitmap, fp->first_port + i, n));
+    }
+}
+
+/**
+ * @brief Fill the free port ring of a range from the busy port bitmap.
+ *
+ * Called by the thread of the range when it first takes a port from it,
+ * so only the ranges in use cost their 2 bytes per port.
+ */
+void
+nat_free_ports_fill (nat_free_ports_t * fp, uword * busy_port_bitmap)
+{
+  snat_main_t *sm = &snat_main;
+  u32 i, j;
+  u16 port;
+
+  vec_validate (fp->ports, fp->n_ports - 1);
+  fp->head = 0;
+  fp->n_free = 0;
+  for (i = 0; i < fp->n_ports; i++)
+    if (!clib_bitmap_get_no_check (busy_port_bitmap, fp->first_port + i))
+      fp->ports[fp->n_free++] = fp->first_port + i;
+
+  /* hand the ports out in random order, like the random port search did */
+  for (i = fp->n_free; i > 1; i--)
+    {
+      j = (random_u32 (&sm->random_seed) >> 8) % i;
+      port = fp->ports[i - 1];
+      fp->ports[i - 1] = fp->ports[j];
+      fp->ports[j] = port;
+    }
+}
+
+void
+nat_address_free_free_ports (snat_address_t * a)
+{
+  nat_free_ports_t *fp;
+
+#define _(N, i, n, s) \
+  vec_foreach (fp, a->free_##n##_ports_per_thread) \
+    vec_free (fp->ports); \
+  vec_free (a->free_##n##_ports_per_thread);
+  foreach_snat_protocol
+#undef _
+}
+
+/**
+ * @brief Set up the free port rings of an outside address.
+ *
+ * Thread range t holds the ports from 1024 + t * port_per_thread, and
+ * is only allocated from by thread threads[t], so the rings need no
+ * locking. Only the default allocation algorithm uses them.
+ */
+void
+nat_address_init_free_ports (snat_address_t * a, u16 port_per_thread,
+                             u32 * threads)
+{
+  snat_main_t *sm = &snat_main;
+  u32 t;
+
+  nat_address_free_free_ports (a);
+  if (sm->alloc_addr_and_port != nat_alloc_addr_and_port_default)
+    return;
+
+#define _(N, i, n, s) \
+  vec_validate (a->free_##n##_ports_per_thread, vec_len (threads) - 1); \
+  for (t = 0; t < vec_len (threads); t++) \
+    nat_free_ports_init (&a->free_##n##_ports_per_thread[t], \
+                         a->busy_##n##_port_bitmap, port_per_thread, \
+                         t, threads[t]);
+  foreach_snat_protocol
+#undef _
+}
+
+static void
+snat_address_init_free_ports (snat_main_t * sm, snat_address_t * a)
+{
+  u32 t, *threads = 0;
+
+  for (t = 0; t < sm->num_snat_thread; t++)
+    vec_add1 (threads, vec_len (sm->workers) ?
+              sm->first_worker_index + sm->workers[t] :
+              sm->first_worker_index);
+  nat_address_init_free_ports (a, sm->port_per_thread, threads);
+  vec_free (threads);
+}
+
+/* Resync the ports in use statistics with the outside addresses */
+static void
+nat_sync_busy_ports_counters (snat_main_t * sm)
+{
+  snat_address_t *a;
+  nat_free_ports_t *fp;
+  u32 i;
+
+  /* one more, to clear the one of a deleted address */
+#define _(N, j, n, s) \
+  vlib_validate_simple_counter (&sm->busy_##n##_ports_counters, \
+                                vec_len (sm->addresses)); \
+  for (i = 0; i <= vec_len (sm->addresses); i++) \
+    vlib_zero_simple_counter (&sm->busy_##n##_ports_counters, i); \
+  vec_foreach (a, sm->addresses) \
+    vec_foreach (fp, a->free_##n##_ports_per_thread) \
+      nat_free_ports_update_counter (&sm->busy_##n##_ports_counters, \
+                                     a - sm->addresses, fp);
+  foreach_snat_protocol
+#undef _
+}
+
+static void
+nat_init_free_ports (snat_main_t * sm)
+{
+  snat_address_t *a;
+
+  vec_foreach (a, sm->addresses)
+    snat_address_init_free_ports (sm, a);
+  vec_foreach (a, sm->twice_nat_addresses)
+    snat_address_init_free_ports (sm, a);
+  nat_sync_busy_ports_counters (sm);
+  dslite_init_free_ports (&dslite_main);
+}
+
+/* Keep the free port rings in sync with the ports of static mappings */
+static void
+nat_free_ports_static_port (snat_main_t * sm, snat_address_t * a,
+                            snat_protocol_t proto, u16 port, int is_add)
+{
+  nat_free_ports_t *fp;
+
+  switch (proto)
+    {
+#define _(N, i, n, s) \
+    case SNAT_PROTOCOL_##N: \
+      fp = nat_free_ports_of_port (a->free_##n##_ports_per_thread, port); \
+      if (!fp) \
+        return; \
+      if (!fp->ports) \
+        nat_free_ports_fill (fp, a->busy_##n##_port_bitmap); \
+      nat_free_ports_remove (fp, port); \
+      if (!is_add) \
+        nat_free_ports_put (fp, port); \
+      nat_free_ports_update_counter (&sm->busy_##n##_ports_counters, \
+                                     a - sm->addresses, fp); \
+      break;
+      foreach_snat_protocol
+#undef _
+    default:
+      break;
+    }
+}
+
 int snat_add_address (snat_main_t *sm, ip4_address_t *addr, u32 vrf_id,
                        u8 twice_nat)
 {
@@ -698,10 +890,13 @@ int snat_add_address (snat_main_t *sm, ip4_address_t *addr, u32 vrf_id,
   vec_validate_init_empty (ap->busy_##n##_ports_per_thread, tm->n_vlib_mains - 1, 0);
   foreach_snat_protocol
 #undef _
+  snat_address_init_free_ports (sm, ap);
 
   if (twice_nat)
     return 0;
 
+  nat_sync_busy_ports_counters (sm);
+
   /* Add external address to FIB */
   pool_foreach (i, sm->interfaces,
   ({
@@ -811,8 +1006,6 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
   snat_main_per_thread_data_t *tsm;
   snat_user_key_t u_key;
   snat_user_t *u;
-  dlist_elt_t * head, * elt;
-  u32 elt_index, head_index;
   u32 ses_index;
   u64 user_index;
   snat_session_t * s;
@@ -953,6 +1146,7 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
                       if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, e_port)) \
                         return VNET_API_ERROR_INVALID_VALUE; \
                       clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 1); \
+                      nat_free_ports_static_port (sm, a, proto, e_port, 1); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports++; \
@@ -1048,16 +1242,11 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
               u = pool_elt_at_index (tsm->users, user_index);
               if (u->nsessions)
                 {
-                  head_index = u->sessions_per_user_list_head_index;
-                  head = pool_elt_at_index (tsm->list_pool, head_index);
-                  elt_index = head->next;
-                  elt = pool_elt_at_index (tsm->list_pool, elt_index);
-                  ses_index = elt->value;
-                  while (ses_index != ~0)
+                  /* Backwards, a delete moves the last session into the slot */
+                  for (ses_index = vec_len (u->sessions); ses_index > 0; ses_index--)
                     {
-                      s =  pool_elt_at_index (tsm->sessions, ses_index);
-                      elt = pool_elt_at_index (tsm->list_pool, elt->next);
-                      ses_index = elt->value;
+                      s = pool_elt_at_index (tsm->sessions,
+                                             u->sessions[ses_index - 1]);
 
                       if (snat_is_session_static (s))
                         continue;
@@ -1098,6 +1287,7 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
 #define _(N, j, n, s) \
                     case SNAT_PROTOCOL_##N: \
                       clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 0); \
+                      nat_free_ports_static_port (sm, a, proto, e_port, 0); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports--; \
@@ -1147,16 +1337,11 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
               u = pool_elt_at_index (tsm->users, user_index);
               if (u->nstaticsessions)
                 {
-                  head_index = u->sessions_per_user_list_head_index;
-                  head = pool_elt_at_index (tsm->list_pool, head_index);
-                  elt_index = head->next;
-                  elt = pool_elt_at_index (tsm->list_pool, elt_index);
-                  ses_index = elt->value;
-                  while (ses_index != ~0)
+                  /* Backwards, a delete moves the last session into the slot */
+                  for (ses_index = vec_len (u->sessions); ses_index > 0; ses_index--)
                     {
-                      s =  pool_elt_at_index (tsm->sessions, ses_index);
-                      elt = pool_elt_at_index (tsm->list_pool, elt->next);
-                      ses_index = elt->value;
+                      s = pool_elt_at_index (tsm->sessions,
+                                             u->sessions[ses_index - 1]);
 
                       if (!addr_only)
                         {
@@ -1179,6 +1364,7 @@ int snat_add_static_mapping(ip4_address_t l_addr, ip4_address_t e_addr,
                     }
                   if (addr_only && (u->nstaticsessions == 0) && (u->nsessions == 0))
                     {
+                      vec_free (u->sessions);
                       pool_put (tsm->users, u);
                       clib_bihash_add_del_8_8 (&tsm->user_hash, &kv, 0);
                     }
@@ -1230,12 +1416,11 @@ int nat44_add_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
   snat_address_t *a = 0;
   int i;
   nat44_lb_addr_port_t *local;
-  u32 elt_index, head_index, ses_index;
+  u32 ses_index;
   snat_main_per_thread_data_t *tsm;
   snat_user_key_t u_key;
   snat_user_t *u;
   snat_session_t * s;
-  dlist_elt_t * head, * elt;
   uword *bitmap = 0;
 
   if (!sm->endpoint_dependent)
@@ -1280,6 +1465,7 @@ int nat44_add_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
                       if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, e_port)) \
                         return VNET_API_ERROR_INVALID_VALUE; \
                       clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 1); \
+                      nat_free_ports_static_port (sm, a, proto, e_port, 1); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports++; \
@@ -1377,6 +1563,7 @@ int nat44_add_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
 #define _(N, j, n, s) \
                     case SNAT_PROTOCOL_##N: \
                       clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 0); \
+                      nat_free_ports_static_port (sm, a, proto, e_port, 0); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports--; \
@@ -1440,16 +1627,11 @@ int nat44_add_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
               u = pool_elt_at_index (tsm->users, value.value);
               if (u->nstaticsessions)
                 {
-                  head_index = u->sessions_per_user_list_head_index;
-                  head = pool_elt_at_index (tsm->list_pool, head_index);
-                  elt_index = head->next;
-                  elt = pool_elt_at_index (tsm->list_pool, elt_index);
-                  ses_index = elt->value;
-                  while (ses_index != ~0)
+                  /* Backwards, a delete moves the last session into the slot */
+                  for (ses_index = vec_len (u->sessions); ses_index > 0; ses_index--)
                     {
-                      s =  pool_elt_at_index (tsm->sessions, ses_index);
-                      elt = pool_elt_at_index (tsm->list_pool, elt->next);
-                      ses_index = elt->value;
+                      s = pool_elt_at_index (tsm->sessions,
+                                             u->sessions[ses_index - 1]);
 
                       if (!(is_lb_session (s)))
                         continue;
@@ -1533,7 +1715,7 @@ snat_del_address (snat_main_t *sm, ip4_address_t addr, u8 delete_sm,
           pool_foreach (ses, tsm->sessions, ({
             if (ses->out2in.addr.as_u32 == addr.as_u32)
               {
-                ses->outside_address_index = ~0;
+                nat44_session_cold (tsm, ses)->outside_address_index = ~0;
                 nat_free_session_data (sm, ses, tsm - sm->per_thread_data);
                 vec_add1 (ses_to_be_removed, ses - tsm->sessions);
               }
@@ -1549,6 +1731,7 @@ snat_del_address (snat_main_t *sm, ip4_address_t addr, u8 delete_sm,
        }
     }
 
+  nat_address_free_free_ports (a);
   if (twice_nat)
     {
       vec_del1 (sm->twice_nat_addresses, i);
@@ -1556,6 +1739,7 @@ snat_del_address (snat_main_t *sm, ip4_address_t addr, u8 delete_sm,
     }
   else
     vec_del1 (sm->addresses, i);
+  nat_sync_busy_ports_counters (sm);
 
   /* Delete external address from FIB */
   pool_foreach (interface, sm->interfaces,
@@ -1924,6 +2108,7 @@ int snat_set_workers (uword * bitmap)
 
   sm->port_per_thread = (0xffff - 1024) / _vec_len (sm->workers);
   sm->num_snat_thread = _vec_len (sm->workers);
+  nat_init_free_ports (sm);
 
   return 0;
 }
@@ -1947,15 +2132,6 @@ nat_ip4_add_del_addr_only_sm_cb (ip4_main_t * im,
                                  u32 if_address_index,
                                  u32 is_delete);
 
-static int
-nat_alloc_addr_and_port_default (snat_address_t * addresses,
-                                 u32 fib_index,
-                                 u32 thread_index,
-                                 snat_session_key_t * k,
-                                 u32 * address_indexp,
-                                 u16 port_per_thread,
-                                 u32 snat_thread_index);
-
 static clib_error_t * snat_init (vlib_main_t * vm)
 {
   snat_main_t * sm = &snat_main;
@@ -1987,6 +2163,12 @@ static clib_error_t * snat_init (vlib_main_t * vm)
   sm->tcp_transitory_timeout = SNAT_TCP_TRANSITORY_TIMEOUT;
   sm->icmp_timeout = SNAT_ICMP_TIMEOUT;
   sm->alloc_addr_and_port = nat_alloc_addr_and_port_default;
+#define _(N, i, n, s) \
+  sm->busy_##n##_ports_counters.name = "busy " s " ports"; \
+  sm->busy_##n##_ports_counters.stat_segment_name = \
+    "/nat44/addresses/busy-" s "-ports";
+  foreach_snat_protocol
+#undef _
   sm->forwarding_enabled = 0;
   sm->log_class = vlib_log_register_class ("nat", 0);
   error_drop_node = vlib_get_node_by_name (vm, (u8 *) "error-drop");
@@ -2058,7 +2240,9 @@ void snat_free_outside_address_and_port (snat_address_t * addresses,
                                          snat_session_key_t * k,
                                          u32 address_index)
 {
+  snat_main_t *sm = &snat_main;
   snat_address_t *a;
+  nat_free_ports_t *fp;
   u16 port_host_byte_order = clib_net_to_host_u16 (k->port);
 
   ASSERT (address_index < vec_len (addresses));
@@ -2075,6 +2259,15 @@ void snat_free_outside_address_and_port (snat_address_t * addresses,
         port_host_byte_order, 0); \
       a->busy_##n##_ports--; \
       a->busy_##n##_ports_per_thread[thread_index]--; \
+      fp = nat_free_ports_of_port (a->free_##n##_ports_per_thread, \
+                                   port_host_byte_order); \
+      if (fp) \
+        { \
+          nat_free_ports_put (fp, port_host_byte_order); \
+          if (addresses == sm->addresses) \
+            nat_free_ports_update_counter (&sm->busy_##n##_ports_counters, \
+                                           address_index, fp); \
+        } \
       break;
       foreach_snat_protocol
 #undef _
@@ -2214,6 +2407,10 @@ snat_alloc_outside_address_and_port (snat_address_t * addresses,
                                  snat_thread_index);
 }
 
+/**
+ * @brief Allocate an outside address and port from the free port ring of
+ * the thread port range, preferring the addresses of the given FIB.
+ */
 static int
 nat_alloc_addr_and_port_default (snat_address_t * addresses,
                                  u32 fib_index,
@@ -2223,9 +2420,11 @@ nat_alloc_addr_and_port_default (snat_address_t * addresses,
                                  u16 port_per_thread,
                                  u32 snat_thread_index)
 {
+  snat_main_t *sm = &snat_main;
   int i, gi = 0;
   snat_address_t *a, *ga = 0;
-  u32 portnum;
+  nat_free_ports_t *fp;
+  u16 portnum;
 
   for (i = 0; i < vec_len (addresses); i++)
     {
@@ -2234,25 +2433,23 @@ nat_alloc_addr_and_port_default (snat_address_t * addresses,
         {
 #define _(N, j, n, s) \
         case SNAT_PROTOCOL_##N: \
-          if (a->busy_##n##_ports_per_thread[thread_index] < port_per_thread) \
+          fp = vec_elt_at_index (a->free_##n##_ports_per_thread, \
+                                 snat_thread_index); \
+          if (fp->n_free) \
             { \
               if (a->fib_index == fib_index) \
                 { \
-                  while (1) \
-                    { \
-                      portnum = (port_per_thread * \
-                        snat_thread_index) + \
-                        snat_random_port(1, port_per_thread) + 1024; \
-                      if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                        continue; \
-                      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-                      a->busy_##n##_ports_per_thread[thread_index]++; \
-                      a->busy_##n##_ports++; \
-                      k->addr = a->addr; \
-                      k->port = clib_host_to_net_u16(portnum); \
-                      *address_indexp = i; \
-                      return 0; \
-                    } \
+                  nat_free_ports_get (fp, a->busy_##n##_port_bitmap, &portnum); \
+                  ASSERT (!clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)); \
+                  clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
+                  a->busy_##n##_ports_per_thread[thread_index]++; \
+                  a->busy_##n##_ports++; \
+                  if (addresses == sm->addresses) \
+                    nat_free_ports_update_counter (&sm->busy_##n##_ports_counters, i, fp); \
+                  k->addr = a->addr; \
+                  k->port = clib_host_to_net_u16(portnum); \
+                  *address_indexp = i; \
+                  return 0; \
                 } \
               else if (a->fib_index == ~0) \
                 { \
@@ -2277,22 +2474,20 @@ nat_alloc_addr_and_port_default (snat_address_t * addresses,
 	{
 #define _(N, j, n, s) \
         case SNAT_PROTOCOL_##N: \
-          while (1) \
-            { \
-              portnum = (port_per_thread * \
-                snat_thread_index) + \
-                snat_random_port(1, port_per_thread) + 1024; \
-              if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                continue; \
-              clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-              a->busy_##n##_ports_per_thread[thread_index]++; \
-              a->busy_##n##_ports++; \
-              k->addr = a->addr; \
-              k->port = clib_host_to_net_u16(portnum); \
-              *address_indexp = gi; \
-              return 0; \
-            }
-	  break;
+          fp = vec_elt_at_index (a->free_##n##_ports_per_thread, \
+                                 snat_thread_index); \
+          if (nat_free_ports_get (fp, a->busy_##n##_port_bitmap, &portnum)) \
+            break; \
+          ASSERT (!clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)); \
+          clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
+          a->busy_##n##_ports_per_thread[thread_index]++; \
+          a->busy_##n##_ports++; \
+          if (addresses == sm->addresses) \
+            nat_free_ports_update_counter (&sm->busy_##n##_ports_counters, gi, fp); \
+          k->addr = a->addr; \
+          k->port = clib_host_to_net_u16(portnum); \
+          *address_indexp = gi; \
+          return 0;
 	  foreach_snat_protocol
 #undef _
 	default:
@@ -2924,6 +3119,7 @@ u8 * format_snat_session (u8 * s, va_list * args)
 {
   snat_main_per_thread_data_t * sm = va_arg (*args, snat_main_per_thread_data_t *);
   snat_session_t * sess = va_arg (*args, snat_session_t *);
+  snat_session_cold_t * c = nat44_session_cold (sm, sess);
 
   if (snat_is_unk_proto_session (sess))
     {
@@ -2946,23 +3142,24 @@ u8 * format_snat_session (u8 * s, va_list * args)
       if (is_twice_nat_session (sess))
         {
           s = format (s, "       external host o2i %U:%d i2o %U:%d\n",
-                      format_ip4_address, &sess->ext_host_addr,
-                      clib_net_to_host_u16 (sess->ext_host_port),
-                      format_ip4_address, &sess->ext_host_nat_addr,
-                      clib_net_to_host_u16 (sess->ext_host_nat_port));
+                      format_ip4_address, &c->ext_host_addr,
+                      clib_net_to_host_u16 (c->ext_host_port),
+                      format_ip4_address, &c->ext_host_nat_addr,
+                      clib_net_to_host_u16 (c->ext_host_nat_port));
         }
       else
         {
-          if (sess->ext_host_addr.as_u32)
+          if (c->ext_host_addr.as_u32)
               s = format (s, "       external host %U:%u\n",
-                          format_ip4_address, &sess->ext_host_addr,
-                          clib_net_to_host_u16 (sess->ext_host_port));
+                          format_ip4_address, &c->ext_host_addr,
+                          clib_net_to_host_u16 (c->ext_host_port));
         }
     }
   s = format (s, "       index %llu\n", sess - sm->sessions);
   s = format (s, "       last heard %.2f\n", sess->last_heard);
   s = format (s, "       total pkts %d, total bytes %lld\n",
-              sess->total_pkts, sess->total_bytes);
+              nat44_session_total_pkts (sess, c),
+              nat44_session_total_bytes (sess, c));
   if (snat_is_session_static (sess))
     s = format (s, "       static translation\n");
   else
@@ -2982,9 +3179,7 @@ u8 * format_snat_user (u8 * s, va_list * args)
   snat_main_per_thread_data_t * sm = va_arg (*args, snat_main_per_thread_data_t *);
   snat_user_t * u = va_arg (*args, snat_user_t *);
   int verbose = va_arg (*args, int);
-  dlist_elt_t * head, * elt;
-  u32 elt_index, head_index;
-  u32 session_index;
+  u32 * session_index;
   snat_session_t * sess;
 
   s = format (s, "%U: %d dynamic translations, %d static translations\n",
@@ -2993,25 +3188,11 @@ u8 * format_snat_user (u8 * s, va_list * args)
   if (verbose == 0)
     return s;
 
-  if (u->nsessions || u->nstaticsessions)
+  vec_foreach (session_index, u->sessions)
     {
-      head_index = u->sessions_per_user_list_head_index;
-      head = pool_elt_at_index (sm->list_pool, head_index);
-
-      elt_index = head->next;
-      elt = pool_elt_at_index (sm->list_pool, elt_index);
-      session_index = elt->value;
+      sess = pool_elt_at_index (sm->sessions, session_index[0]);
 
-      while (session_index != ~0)
-        {
-          sess = pool_elt_at_index (sm->sessions, session_index);
-
-          s = format (s, "  %U\n", format_snat_session, sm, sess);
-
-          elt_index = elt->next;
-          elt = pool_elt_at_index (sm->list_pool, elt_index);
-          session_index = elt->value;
-        }
+      s = format (s, "  %U\n", format_snat_session, sm, sess);
     }
 
   return s;
@@ -3422,6 +3603,7 @@ nat_set_alloc_addr_and_port_mape (u16 psid, u16 psid_offset, u16 psid_length)
   sm->psid = psid;
   sm->psid_offset = psid_offset;
   sm->psid_length = psid_length;
+  nat_init_free_ports (sm);
 }
 
 void
@@ -3430,5 +3612,6 @@ nat_set_alloc_addr_and_port_default (void)
   snat_main_t *sm = &snat_main;
 
   sm->alloc_addr_and_port = nat_alloc_addr_and_port_default;
+  nat_init_free_ports (sm);
 }
 
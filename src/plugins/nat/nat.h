@@ -142,62 +142,94 @@ typedef enum {
 #define SNAT_SESSION_FLAG_TWICE_NAT            8
 #define SNAT_SESSION_FLAG_ENDPOINT_DEPENDENT   16
 #define SNAT_SESSION_FLAG_FWD_BYPASS           32
+/* used since the clock hand of the user last passed */
+#define SNAT_SESSION_FLAG_REFERENCED           64
 
 #define NAT_INTERFACE_FLAG_IS_INSIDE 1
 #define NAT_INTERFACE_FLAG_IS_OUTSIDE 2
 
+/* Session fields used to translate packets */
 typedef CLIB_PACKED(struct {
-  snat_session_key_t out2in;    /* 0-15 */
+  snat_session_key_t out2in;    /* 0-7 */
 
-  snat_session_key_t in2out;    /* 16-31 */
+  snat_session_key_t in2out;    /* 8-15 */
 
-  u32 flags;                    /* 32-35 */
+  /* Last heard timer */
+  f64 last_heard;               /* 16-23 */
 
-  /* per-user translations */
-  u32 per_user_index;           /* 36-39 */
+  u8 flags;                     /* 24 */
 
-  u32 per_user_list_head_index; /* 40-43 */
+  /* TCP session state */
+  u8 state;                     /* 25 */
 
-  /* Last heard timer */
-  f64 last_heard;               /* 44-51 */
+  /* Counts not yet added to the cold record totals */
+  u16 pkts_delta;               /* 26-27 */
+  u32 bytes_delta;              /* 28-31 */
+}) snat_session_t;
+
+STATIC_ASSERT (sizeof (snat_session_t) == 32,
+               "NAT session forwarding record must be 32 bytes");
+
+/* Session fields for logging, statistics and rare events, stored in
+   a vector parallel to the session pool */
+typedef CLIB_PACKED(struct {
+  /* position in the session vector of the user */
+  u32 per_user_index;
 
-  u64 total_bytes;              /* 52-59 */
+  u64 total_bytes;
 
-  u32 total_pkts;               /* 60-63 */
+  u32 total_pkts;
 
   /* Outside address */
-  u32 outside_address_index;    /* 64-67 */
+  u32 outside_address_index;
 
   /* External host address and port */
-  ip4_address_t ext_host_addr;  /* 68-71 */
-  u16 ext_host_port;            /* 72-73 */
+  ip4_address_t ext_host_addr;
+  u16 ext_host_port;
 
   /* External hos address and port after translation */
-  ip4_address_t ext_host_nat_addr; /* 74-77 */
-  u16 ext_host_nat_port;           /* 78-79 */
+  ip4_address_t ext_host_nat_addr;
+  u16 ext_host_nat_port;
 
-  /* TCP session state */
-  u8 state;
+  /* TCP FIN sequence numbers */
   u32 i2o_fin_seq;
   u32 o2i_fin_seq;
-}) snat_session_t;
+}) snat_session_cold_t;
 
 
 typedef struct {
   ip4_address_t addr;
   u32 fib_index;
-  u32 sessions_per_user_list_head_index;
+  /* indices of the sessions of the user */
+  u32 * sessions;
+  /* next session to consider for recycling */
+  u32 clock_hand;
   u32 nsessions;
   u32 nstaticsessions;
 } snat_user_t;
 
+/* Free ports of an outside address in the port range of one thread */
+typedef struct {
+  /* ring of free ports, as many slots as ports in the range, allocated
+     when the thread first takes a port of the range */
+  u16 * ports;
+  u32 head;
+  u32 n_free;
+  /* the range */
+  u16 first_port;
+  u16 n_ports;
+  /* thread allocating from the range */
+  u32 thread_index;
+} nat_free_ports_t;
+
 typedef struct {
   ip4_address_t addr;
   u32 fib_index;
 #define _(N, i, n, s) \
   u16 busy_##n##_ports; \
   u16 * busy_##n##_ports_per_thread; \
-  uword * busy_##n##_port_bitmap;
+  uword * busy_##n##_port_bitmap; \
+  nat_free_ports_t * free_##n##_ports_per_thread;
   foreach_snat_protocol
 #undef _
 } snat_address_t;
@@ -286,8 +318,8 @@ typedef struct {
   /* Session pool */
   snat_session_t * sessions;
 
-  /* Pool of doubly-linked list elements */
-  dlist_elt_t * list_pool;
+  /* Cold part of the sessions, indexed like the session pool */
+  snat_session_cold_t * sessions_cold;
 
   u32 snat_thread_index;
 } snat_main_per_thread_data_t;
@@ -345,6 +377,11 @@ typedef struct snat_main_s {
 
   /* Vector of outside addresses */
   snat_address_t * addresses;
+  /* Ports of the outside addresses in use, per thread port range */
+#define _(N, i, n, s) \
+  vlib_simple_counter_main_t busy_##n##_ports_counters;
+  foreach_snat_protocol
+#undef _
   nat_alloc_out_addr_and_port_function_t *alloc_addr_and_port;
   u8 psid_offset;
   u8 psid_length;
@@ -444,6 +481,13 @@ void snat_free_outside_address_and_port (snat_address_t * addresses,
                                          snat_session_key_t * k,
                                          u32 address_index);
 
+void nat_address_init_free_ports (snat_address_t * a, u16 port_per_thread,
+                                  u32 * threads);
+
+void nat_address_free_free_ports (snat_address_t * a);
+
+void nat_free_ports_fill (nat_free_ports_t * fp, uword * busy_port_bitmap);
+
 int snat_alloc_outside_address_and_port (snat_address_t * addresses,
                                          u32 fib_index,
                                          u32 thread_index,
@@ -512,6 +556,26 @@ typedef struct {
 */
 #define is_ed_session(s) (s->flags & SNAT_SESSION_FLAG_ENDPOINT_DEPENDENT)
 
+/** \brief Get the cold part of a NAT session.
+    @param tsm per thread data of the session
+    @param s NAT session
+    @return cold part of the NAT session
+*/
+#define nat44_session_cold(tsm, s) \
+  vec_elt_at_index ((tsm)->sessions_cold, (s) - (tsm)->sessions)
+
+/** \brief Total packets of a NAT session, including the batched ones.
+    @param s NAT session
+    @param c cold part of the NAT session
+*/
+#define nat44_session_total_pkts(s, c) ((c)->total_pkts + (s)->pkts_delta)
+
+/** \brief Total bytes of a NAT session, including the batched ones.
+    @param s NAT session
+    @param c cold part of the NAT session
+*/
+#define nat44_session_total_bytes(s, c) ((c)->total_bytes + (s)->bytes_delta)
+
 #define nat_interface_is_inside(i) i->flags & NAT_INTERFACE_FLAG_IS_INSIDE
 #define nat_interface_is_outside(i) i->flags & NAT_INTERFACE_FLAG_IS_OUTSIDE
 
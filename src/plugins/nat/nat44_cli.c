@@ -158,6 +158,29 @@ done:
   return error;
 }
 
+static clib_error_t *
+nat_show_ipfix_logging_command_fn (vlib_main_t * vm, unformat_input_t * input,
+				   vlib_cli_command_t * cmd)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  nat_ipfix_event_ring_t *r;
+  u32 thread_index;
+
+  vlib_cli_output (vm, "NAT IPFIX logging %s",
+		   silm->enabled ? "enabled" : "disabled");
+
+  vec_foreach (r, silm->rings)
+    {
+      thread_index = r - silm->rings;
+      vlib_cli_output (vm, "  thread %d %s: %u queued, %llu dropped",
+		       thread_index, vlib_worker_threads[thread_index].name,
+		       r->head - r->tail,
+		       silm->event_drops.counters[thread_index][0]);
+    }
+
+  return 0;
+}
+
 static clib_error_t *
 nat44_show_hash_commnad_fn (vlib_main_t * vm, unformat_input_t * input,
 			    vlib_cli_command_t * cmd)
@@ -355,6 +378,7 @@ nat44_show_addresses_command_fn (vlib_main_t * vm, unformat_input_t * input,
 {
   snat_main_t *sm = &snat_main;
   snat_address_t *ap;
+  nat_free_ports_t *fp;
 
   if (sm->deterministic)
     return clib_error_return (0, UNSUPPORTED_IN_DET_MODE_STR);
@@ -370,7 +394,14 @@ nat44_show_addresses_command_fn (vlib_main_t * vm, unformat_input_t * input,
       else
         vlib_cli_output (vm, "  tenant VRF independent");
     #define _(N, i, n, s) \
-      vlib_cli_output (vm, "  %d busy %s ports", ap->busy_##n##_ports, s);
+      vlib_cli_output (vm, "  %d busy %s ports", ap->busy_##n##_ports, s); \
+      vec_foreach (fp, ap->free_##n##_ports_per_thread) \
+        vlib_cli_output (vm, "    thread %u: %u/%u in use (%.1f%%)", \
+                         fp->thread_index, \
+                         fp->n_ports - fp->n_free, \
+                         fp->n_ports, \
+                         100.0 * (fp->n_ports - fp->n_free) / \
+                         fp->n_ports);
       foreach_snat_protocol
     #undef _
     }
@@ -1503,6 +1534,120 @@ done:
 
   return error;
 }
+
+static clib_error_t *
+nat44_ed_lookup_test_command_fn (vlib_main_t * vm, unformat_input_t * input,
+				 vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 n_sessions = 64 << 10, n_lookups = 1 << 20, n_rounds = 4;
+  u32 i, j, n, r, seed = 0xdeadbeef, n_found = 0, n_mismatch = 0;
+  clib_bihash_16_8_t h;
+  clib_bihash_kv_16_8_t kv, value, *keys = 0;
+  nat_ed_lookup_batch_t *batch;
+  u64 *values = 0, t0, scalar_clocks = 0, batch_clocks = 0;
+  ip4_address_t l_addr, r_addr;
+  clib_error_t *error = 0;
+
+  if (unformat_user (input, unformat_line_input, line_input))
+    {
+      while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+	{
+	  if (unformat (line_input, "sessions %u", &n_sessions))
+	    ;
+	  else if (unformat (line_input, "lookups %u", &n_lookups))
+	    ;
+	  else if (unformat (line_input, "rounds %u", &n_rounds))
+	    ;
+	  else
+	    {
+	      error = clib_error_return (0, "unknown input '%U'",
+					 format_unformat_error, line_input);
+	      unformat_free (line_input);
+	      return error;
+	    }
+	}
+      unformat_free (line_input);
+    }
+
+  if (!n_sessions || !n_lookups)
+    return clib_error_return (0, "sessions and lookups must be non-zero");
+
+  /* About 4 keys per bucket, with room for the buckets to split */
+  memset (&h, 0, sizeof (h));
+  clib_bihash_init_16_8 (&h, "nat44 ed lookup test",
+			 clib_max (n_sessions >> 2, 1024),
+			 (uword) n_sessions * 128);
+
+  vec_validate (keys, n_sessions - 1);
+  for (i = 0; i < n_sessions; i++)
+    {
+      l_addr.as_u32 = random_u32 (&seed);
+      r_addr.as_u32 = random_u32 (&seed);
+      make_ed_kv (&keys[i], &l_addr, &r_addr,
+		  (i & 1) ? IP_PROTOCOL_UDP : IP_PROTOCOL_TCP, 0,
+		  random_u32 (&seed) >> 16, random_u32 (&seed) >> 16);
+      keys[i].value = i;
+      clib_bihash_add_del_16_8 (&h, &keys[i], 1);
+    }
+
+  /* Random sessions, so consecutive lookups hit unrelated buckets */
+  vec_validate (values, n_lookups - 1);
+  batch = clib_mem_alloc_aligned (sizeof (*batch), CLIB_CACHE_LINE_BYTES);
+  for (r = 0; r < n_rounds; r++)
+    {
+      u32 *order = 0;
+
+      vec_validate (order, n_lookups - 1);
+      for (j = 0; j < n_lookups; j++)
+	order[j] = (random_u32 (&seed) >> 8) % n_sessions;
+
+      t0 = clib_cpu_time_now ();
+      for (j = 0; j < n_lookups; j++)
+	{
+	  kv = keys[order[j]];
+	  values[j] = clib_bihash_search_16_8 (&h, &kv, &value) ?
+	    ~0ULL : value.value;
+	}
+      scalar_clocks += clib_cpu_time_now () - t0;
+
+      /* A frame worth of keys per batch, as the ED nodes do */
+      t0 = clib_cpu_time_now ();
+      for (j = 0; j < n_lookups; j += n)
+	{
+	  n = clib_min (VLIB_FRAME_SIZE, n_lookups - j);
+	  for (i = 0; i < n; i++)
+	    batch->kv[i] = keys[order[j + i]];
+	  nat_ed_lookup_batch_search (&h, batch, n);
+	  for (i = 0; i < n; i++)
+	    {
+	      n_found += batch->kv[i].value != ~0ULL;
+	      n_mismatch += batch->kv[i].value != values[j + i];
+	    }
+	}
+      batch_clocks += clib_cpu_time_now () - t0;
+
+      vec_free (order);
+    }
+
+  vlib_cli_output (vm, "%u sessions, %u lookups, %u found, %u rounds",
+		   n_sessions, n_lookups, n_found / n_rounds, n_rounds);
+  vlib_cli_output (vm, "  scalar: %.2f clocks/lookup",
+		   (f64) scalar_clocks / n_lookups / n_rounds);
+  vlib_cli_output (vm, "  batch:  %.2f clocks/lookup (%.2fx)",
+		   (f64) batch_clocks / n_lookups / n_rounds,
+		   (f64) scalar_clocks / clib_max (batch_clocks, 1));
+  if (n_mismatch)
+    error = clib_error_return (0, "%u batch results differ from scalar",
+			       n_mismatch);
+
+  clib_mem_free (batch);
+  clib_bihash_free_16_8 (&h);
+  vec_free (keys);
+  vec_free (values);
+  return error;
+}
+
 /* *INDENT-OFF* */
 
 /*?
@@ -1549,6 +1694,22 @@ VLIB_CLI_COMMAND (snat_ipfix_logging_enable_disable_command, static) = {
   .short_help = "nat ipfix logging [domain <domain-id>] [src-port <port>] [disable]",
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{show nat ipfix logging}
+ * Show NAT IPFIX event queues and records dropped because a queue was full:
+ *  vpp# show nat ipfix logging
+ *  NAT IPFIX logging enabled
+ *    thread 0 vpp_main: 0 queued, 0 dropped
+ *    thread 1 vpp_wk_0: 12 queued, 0 dropped
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_show_ipfix_logging_command, static) = {
+  .path = "show nat ipfix logging",
+  .short_help = "show nat ipfix logging",
+  .function = nat_show_ipfix_logging_command_fn,
+};
+
 /*?
  * @cliexpar
  * @cliexstart{nat addr-port-assignment-alg}
@@ -1965,6 +2126,23 @@ VLIB_CLI_COMMAND (snat_det_close_session_in_command, static) = {
   .function = snat_det_close_session_in_fn,
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{test nat44 ed-lookup}
+ * Measure endpoint-dependent session lookups in a scratch table, one key
+ * at a time and a frame worth of keys at a time, to size the gain of the
+ * batched lookups of the ED nodes. Defaults to 64k sessions, a table
+ * far larger than the caches gives more realistic numbers:
+ *  vpp# test nat44 ed-lookup sessions 10000000 lookups 1000000 rounds 4
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat44_ed_lookup_test_command, static) = {
+  .path = "test nat44 ed-lookup",
+  .short_help = "test nat44 ed-lookup [sessions <n>] [lookups <n>] "
+                "[rounds <n>]",
+  .function = nat44_ed_lookup_test_command_fn,
+};
+
 /* *INDENT-ON* */
 
 /*
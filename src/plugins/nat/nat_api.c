@@ -1211,7 +1211,7 @@ vl_api_nat44_user_dump_t_print (vl_api_nat44_user_dump_t * mp, void *handle)
 }
 
 static void
-send_nat44_user_session_details (snat_session_t * s,
+send_nat44_user_session_details (snat_session_t * s, snat_session_cold_t * c,
 				 vl_api_registration_t * reg, u32 context)
 {
   vl_api_nat44_user_session_details_t *rmp;
@@ -1228,8 +1228,8 @@ send_nat44_user_session_details (snat_session_t * s,
   rmp->ext_host_valid = is_ed_session (s)
     || is_fwd_bypass_session (s) ? 1 : 0;
   rmp->last_heard = clib_host_to_net_u64 ((u64) s->last_heard);
-  rmp->total_bytes = clib_host_to_net_u64 (s->total_bytes);
-  rmp->total_pkts = ntohl (s->total_pkts);
+  rmp->total_bytes = clib_host_to_net_u64 (nat44_session_total_bytes (s, c));
+  rmp->total_pkts = ntohl (nat44_session_total_pkts (s, c));
   rmp->context = context;
   if (snat_is_unk_proto_session (s))
     {
@@ -1245,12 +1245,12 @@ send_nat44_user_session_details (snat_session_t * s,
     }
   if (is_ed_session (s) || is_fwd_bypass_session (s))
     {
-      clib_memcpy (rmp->ext_host_address, &s->ext_host_addr, 4);
-      rmp->ext_host_port = s->ext_host_port;
+      clib_memcpy (rmp->ext_host_address, &c->ext_host_addr, 4);
+      rmp->ext_host_port = c->ext_host_port;
       if (is_twice_nat_session (s))
 	{
-	  clib_memcpy (rmp->ext_host_nat_address, &s->ext_host_nat_addr, 4);
-	  rmp->ext_host_nat_port = s->ext_host_nat_port;
+	  clib_memcpy (rmp->ext_host_nat_address, &c->ext_host_nat_addr, 4);
+	  rmp->ext_host_nat_port = c->ext_host_nat_port;
 	}
     }
 
@@ -1268,8 +1268,7 @@ vl_api_nat44_user_session_dump_t_handler (vl_api_nat44_user_session_dump_t *
   clib_bihash_kv_8_8_t key, value;
   snat_user_key_t ukey;
   snat_user_t *u;
-  u32 session_index, head_index, elt_index;
-  dlist_elt_t *head, *elt;
+  u32 *session_index;
   ip4_header_t ip;
 
   if (sm->deterministic)
@@ -1295,20 +1294,11 @@ vl_api_nat44_user_session_dump_t_handler (vl_api_nat44_user_session_dump_t *
   if (!u->nsessions && !u->nstaticsessions)
     return;
 
-  head_index = u->sessions_per_user_list_head_index;
-  head = pool_elt_at_index (tsm->list_pool, head_index);
-  elt_index = head->next;
-  elt = pool_elt_at_index (tsm->list_pool, elt_index);
-  session_index = elt->value;
-  while (session_index != ~0)
+  vec_foreach (session_index, u->sessions)
     {
-      s = pool_elt_at_index (tsm->sessions, session_index);
-
-      send_nat44_user_session_details (s, reg, mp->context);
-
-      elt_index = elt->next;
-      elt = pool_elt_at_index (tsm->list_pool, elt_index);
-      session_index = elt->value;
+      s = pool_elt_at_index (tsm->sessions, session_index[0]);
+      send_nat44_user_session_details (s, nat44_session_cold (tsm, s), reg,
+				       mp->context);
     }
 }
 
@@ -149,6 +149,7 @@ nat44_delete_session (snat_main_t * sm, snat_session_t * ses,
   clib_bihash_kv_8_8_t kv, value;
   snat_user_key_t u_key;
   snat_user_t *u;
+  u32 per_user_index, last;
 
   nat_log_debug ("session deleted %U", format_snat_session, tsm, ses);
   u_key.addr = ses->in2out.addr;
@@ -161,9 +162,16 @@ nat44_delete_session (snat_main_t * sm, snat_session_t * ses,
 	u->nstaticsessions--;
       else
 	u->nsessions--;
+
+      /* Move the last session of the user into the freed slot */
+      per_user_index = nat44_session_cold (tsm, ses)->per_user_index;
+      last = vec_pop (u->sessions);
+      if (per_user_index < vec_len (u->sessions))
+	{
+	  u->sessions[per_user_index] = last;
+	  vec_elt (tsm->sessions_cold, last).per_user_index = per_user_index;
+	}
     }
-  clib_dlist_remove (tsm->list_pool, ses->per_user_index);
-  pool_put_index (tsm->list_pool, ses->per_user_index);
   pool_put (tsm->sessions, ses);
 }
 
@@ -174,20 +182,24 @@ always_inline int
 nat44_set_tcp_session_state_i2o (snat_main_t * sm, snat_session_t * ses,
 				 tcp_header_t * tcp, u32 thread_index)
 {
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+
   if (tcp->flags & TCP_FLAG_FIN)
     {
-      ses->i2o_fin_seq = clib_net_to_host_u32 (tcp->seq_number);
+      nat44_session_cold (tsm, ses)->i2o_fin_seq =
+	clib_net_to_host_u32 (tcp->seq_number);
       ses->state |= NAT44_SES_I2O_FIN;
     }
   if ((tcp->flags & TCP_FLAG_ACK) && (ses->state & NAT44_SES_O2I_FIN))
     {
-      if (clib_net_to_host_u32 (tcp->ack_number) > ses->o2i_fin_seq)
+      if (clib_net_to_host_u32 (tcp->ack_number) >
+	  nat44_session_cold (tsm, ses)->o2i_fin_seq)
 	ses->state |= NAT44_SES_O2I_FIN_ACK;
     }
   if (nat44_is_ses_closed (ses))
     {
-      nat_log_debug ("TCP close connection %U", format_snat_session,
-		     &sm->per_thread_data[thread_index], ses);
+      nat_log_debug ("TCP close connection %U", format_snat_session, tsm,
+		     ses);
       nat_free_session_data (sm, ses, thread_index);
       nat44_delete_session (sm, ses, thread_index);
       return 1;
@@ -199,20 +211,24 @@ always_inline int
 nat44_set_tcp_session_state_o2i (snat_main_t * sm, snat_session_t * ses,
 				 tcp_header_t * tcp, u32 thread_index)
 {
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+
   if (tcp->flags & TCP_FLAG_FIN)
     {
-      ses->o2i_fin_seq = clib_net_to_host_u32 (tcp->seq_number);
+      nat44_session_cold (tsm, ses)->o2i_fin_seq =
+	clib_net_to_host_u32 (tcp->seq_number);
       ses->state |= NAT44_SES_O2I_FIN;
     }
   if ((tcp->flags & TCP_FLAG_ACK) && (ses->state & NAT44_SES_I2O_FIN))
     {
-      if (clib_net_to_host_u32 (tcp->ack_number) > ses->i2o_fin_seq)
+      if (clib_net_to_host_u32 (tcp->ack_number) >
+	  nat44_session_cold (tsm, ses)->i2o_fin_seq)
 	ses->state |= NAT44_SES_I2O_FIN_ACK;
     }
   if (nat44_is_ses_closed (ses))
     {
-      nat_log_debug ("TCP close connection %U", format_snat_session,
-		     &sm->per_thread_data[thread_index], ses);
+      nat_log_debug ("TCP close connection %U", format_snat_session, tsm,
+		     ses);
       nat_free_session_data (sm, ses, thread_index);
       nat44_delete_session (sm, ses, thread_index);
       return 1;
@@ -221,22 +237,33 @@ nat44_set_tcp_session_state_o2i (snat_main_t * sm, snat_session_t * ses,
 }
 
 always_inline void
-nat44_session_update_counters (snat_session_t * s, f64 now, uword bytes)
+nat44_session_update_counters (snat_session_t * s, f64 now, uword bytes,
+			       u32 thread_index)
 {
+  snat_session_cold_t *c;
+
   s->last_heard = now;
-  s->total_pkts++;
-  s->total_bytes += bytes;
+
+  /* Count in the hot record, add to the cold totals only on overflow */
+  if (PREDICT_FALSE (s->pkts_delta == 0xffff
+		     || s->bytes_delta > (u32) ~ 0 - bytes))
+    {
+      c = nat44_session_cold (&snat_main.per_thread_data[thread_index], s);
+      c->total_pkts += s->pkts_delta;
+      c->total_bytes += s->bytes_delta;
+      s->pkts_delta = 0;
+      s->bytes_delta = 0;
+    }
+  s->pkts_delta++;
+  s->bytes_delta += bytes;
 }
 
-/** \brief Per-user LRU list maintenance */
+/** \brief Per-user LRU maintenance, mark the session for the clock hand */
 always_inline void
 nat44_session_update_lru (snat_main_t * sm, snat_session_t * s,
 			  u32 thread_index)
 {
-  clib_dlist_remove (sm->per_thread_data[thread_index].list_pool,
-		     s->per_user_index);
-  clib_dlist_addtail (sm->per_thread_data[thread_index].list_pool,
-		      s->per_user_list_head_index, s->per_user_index);
+  s->flags |= SNAT_SESSION_FLAG_REFERENCED;
 }
 
 always_inline void
@@ -271,6 +298,137 @@ make_sm_kv (clib_bihash_kv_8_8_t * kv, ip4_address_t * addr, u8 proto,
   kv->value = ~0ULL;
 }
 
+/** \brief Endpoint-dependent session lookups of a whole frame */
+typedef struct
+{
+  clib_bihash_kv_16_8_t kv[VLIB_FRAME_SIZE];
+  u64 hash[VLIB_FRAME_SIZE];
+  /* cleared once a packet of the frame deletes a session */
+  u8 is_valid;
+} nat_ed_lookup_batch_t;
+
+/**
+ * @brief Search the keys of a batch in an endpoint-dependent table.
+ *
+ * All keys are hashed first, then all buckets and after them the key/value
+ * pages are prefetched, and only then the keys are compared. The cache
+ * misses of the frame overlap instead of being taken one packet at a time.
+ * The value of a key which was not found stays ~0ULL.
+ */
+always_inline void
+nat_ed_lookup_batch_search (clib_bihash_16_8_t * h,
+			    nat_ed_lookup_batch_t * batch, u32 n)
+{
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    {
+      batch->hash[i] = clib_bihash_hash_16_8 (&batch->kv[i]);
+      clib_bihash_prefetch_bucket_16_8 (h, batch->hash[i]);
+    }
+  for (i = 0; i < n; i++)
+    clib_bihash_prefetch_data_16_8 (h, batch->hash[i]);
+  for (i = 0; i < n; i++)
+    if (clib_bihash_search_inline_with_hash_16_8 (h, batch->hash[i],
+						  &batch->kv[i]))
+      batch->kv[i].value = ~0ULL;
+  batch->is_valid = 1;
+}
+
+/**
+ * @brief Get the result of a packet from the batch.
+ *
+ * Falls back to a plain search if the batch is no longer valid or was
+ * built with a different key for the packet.
+ *
+ * @returns 0 if the session was found, -1 otherwise.
+ */
+always_inline int
+nat_ed_lookup_batch_get (clib_bihash_16_8_t * h,
+			 nat_ed_lookup_batch_t * batch, u32 i,
+			 clib_bihash_kv_16_8_t * kv,
+			 clib_bihash_kv_16_8_t * value)
+{
+  if (PREDICT_TRUE (batch->is_valid
+		    && batch->kv[i].key[0] == kv->key[0]
+		    && batch->kv[i].key[1] == kv->key[1]))
+    {
+      *value = batch->kv[i];
+      return value->value == ~0ULL ? -1 : 0;
+    }
+  return clib_bihash_search_16_8 (h, kv, value);
+}
+
+/**
+ * @brief Take the free port of a thread port range which was freed first.
+ *
+ * @returns 0 on success, 1 if all the ports of the range are in use.
+ */
+always_inline int
+nat_free_ports_get (nat_free_ports_t * fp, uword * busy_port_bitmap,
+		    u16 * port)
+{
+  if (PREDICT_FALSE (fp->n_free == 0))
+    return 1;
+  if (PREDICT_FALSE (!fp->ports))
+    nat_free_ports_fill (fp, busy_port_bitmap);
+  *port = fp->ports[fp->head];
+  if (++fp->head == vec_len (fp->ports))
+    fp->head = 0;
+  fp->n_free--;
+  return 0;
+}
+
+/* The port must be clear in the busy bitmap already */
+always_inline void
+nat_free_ports_put (nat_free_ports_t * fp, u16 port)
+{
+  u32 tail;
+
+  if (!fp)
+    return;
+  /* not filled yet, the fill finds the port in the bitmap */
+  if (!fp->ports)
+    {
+      fp->n_free++;
+      return;
+    }
+  ASSERT (fp->n_free < vec_len (fp->ports));
+  tail = fp->head + fp->n_free;
+  if (tail >= vec_len (fp->ports))
+    tail -= vec_len (fp->ports);
+  fp->ports[tail] = port;
+  fp->n_free++;
+}
+
+/* Take a given port out of the ring, for a static mapping */
+always_inline void
+nat_free_ports_remove (nat_free_ports_t * fp, u16 port)
+{
+  u32 i, index, last;
+
+  if (!fp || !fp->ports)
+    return;
+  for (i = 0; i < fp->n_free; i++)
+    {
+      index = (fp->head + i) % vec_len (fp->ports);
+      if (fp->ports[index] != port)
+	continue;
+      last = (fp->head + fp->n_free - 1) % vec_len (fp->ports);
+      fp->ports[index] = fp->ports[last];
+      fp->n_free--;
+      return;
+    }
+}
+
+/* Update the ports in use statistics of an outside address */
+always_inline void
+nat_free_ports_update_counter (vlib_simple_counter_main_t * cm,
+			       u32 address_index, nat_free_ports_t * fp)
+{
+  cm->counters[fp->thread_index][address_index] = fp->n_ports - fp->n_free;
+}
+
 #endif /* __included_nat_inlines_h__ */
 
 /*
@@ -111,6 +111,36 @@ typedef struct
   u32 vrf_id;
 } nat_ipfix_logging_nat64_bib_args_t;
 
+typedef enum
+{
+  NAT_IPFIX_EVENT_NAT44_SES,
+  NAT_IPFIX_EVENT_ADDR_EXHAUSTED,
+  NAT_IPFIX_EVENT_MAX_ENTRIES_PER_USER,
+  NAT_IPFIX_EVENT_MAX_SESSIONS,
+  NAT_IPFIX_EVENT_MAX_BIBS,
+  NAT_IPFIX_EVENT_MAX_FRAGS_IP4,
+  NAT_IPFIX_EVENT_MAX_FRAGS_IP6,
+  NAT_IPFIX_EVENT_NAT64_BIB,
+  NAT_IPFIX_EVENT_NAT64_SES,
+} nat_ipfix_event_type_t;
+
+typedef struct nat_ipfix_event_s
+{
+  u8 type;
+  union
+  {
+    snat_ipfix_logging_nat44_ses_args_t nat44_ses;
+    snat_ipfix_logging_addr_exhausted_args_t addr_exhausted;
+    snat_ipfix_logging_max_entries_per_user_args_t max_entries_per_user;
+    nat_ipfix_logging_max_sessions_args_t max_sessions;
+    nat_ipfix_logging_max_bibs_args_t max_bibs;
+    nat_ipfix_logging_max_frags_ip4_args_t max_frags_ip4;
+    nat_ipfix_logging_max_frags_ip6_args_t max_frags_ip6;
+    nat_ipfix_logging_nat64_bib_args_t nat64_bib;
+    nat_ipfix_logging_nat64_ses_args_t nat64_ses;
+  };
+} nat_ipfix_event_t;
+
 #define skip_if_disabled()                                    \
 do {                                                          \
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main; \
@@ -118,6 +148,43 @@ do {                                                          \
     return;                                                   \
 } while (0)
 
+/**
+ * @brief Queue NAT event for the exporter process
+ *
+ * Never blocks, if the ring of the calling thread is full the event is
+ * dropped and counted.
+ *
+ * @param type event type
+ * @param args event arguments
+ * @param len  size of the event arguments
+ */
+static inline void
+nat_ipfix_event_enqueue (nat_ipfix_event_type_t type, void *args, u32 len)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  nat_ipfix_event_ring_t *r;
+  nat_ipfix_event_t *e;
+  u32 head, thread_index = vlib_get_thread_index ();
+
+  r = vec_elt_at_index (silm->rings, thread_index);
+  head = r->head;
+  if (PREDICT_FALSE (head - r->tail >= NAT_IPFIX_EVENT_RING_SIZE))
+    {
+      vlib_increment_simple_counter (&silm->event_drops, thread_index, 0, 1);
+      return;
+    }
+
+  e = r->events + (head & (NAT_IPFIX_EVENT_RING_SIZE - 1));
+  e->type = type;
+  /* all argument types start at the union */
+  clib_memcpy (&e->nat44_ses, args, len);
+  /* publish the record before the index */
+  CLIB_MEMORY_BARRIER ();
+  r->head = head + 1;
+}
+
+static u32 nat_ipfix_logging_drain (u32 max_per_ring);
+
 /**
  * @brief Create an IPFIX template packet rewrite string
  *
@@ -1476,7 +1543,7 @@ nat_ipfix_logging_nat64_ses (u8 nat_event, ip6_address_t * src_ip,
 }
 
 static void
-snat_ipfix_logging_nat44_ses_rpc_cb (snat_ipfix_logging_nat44_ses_args_t * a)
+snat_ipfix_logging_nat44_ses_event_cb (snat_ipfix_logging_nat44_ses_args_t * a)
 {
   snat_ipfix_logging_nat44_ses (a->nat_event, a->src_ip, a->nat_src_ip,
 				a->snat_proto, a->src_port, a->nat_src_port,
@@ -1512,8 +1579,7 @@ snat_ipfix_logging_nat44_ses_create (u32 src_ip,
   a.nat_src_port = nat_src_port;
   a.vrf_id = vrf_id;
 
-  vl_api_rpc_call_main_thread (snat_ipfix_logging_nat44_ses_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_NAT44_SES, &a, sizeof (a));
 }
 
 /**
@@ -1545,8 +1611,7 @@ snat_ipfix_logging_nat44_ses_delete (u32 src_ip,
   a.nat_src_port = nat_src_port;
   a.vrf_id = vrf_id;
 
-  vl_api_rpc_call_main_thread (snat_ipfix_logging_nat44_ses_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_NAT44_SES, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1555,12 +1620,13 @@ snat_data_callback_nat44_session (flow_report_main_t * frm,
 				  vlib_frame_t * f,
 				  u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   snat_ipfix_logging_nat44_ses (0, 0, 0, 0, 0, 0, 0, 1);
   return f;
 }
 
 static void
-  snat_ipfix_logging_addr_exhausted_rpc_cb
+  snat_ipfix_logging_addr_exhausted_event_cb
   (snat_ipfix_logging_addr_exhausted_args_t * a)
 {
   snat_ipfix_logging_addr_exhausted (a->pool_id, 0);
@@ -1581,8 +1647,7 @@ snat_ipfix_logging_addresses_exhausted (u32 pool_id)
 
   a.pool_id = pool_id;
 
-  vl_api_rpc_call_main_thread (snat_ipfix_logging_addr_exhausted_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_ADDR_EXHAUSTED, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1591,12 +1656,13 @@ snat_data_callback_addr_exhausted (flow_report_main_t * frm,
 				   vlib_frame_t * f,
 				   u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   snat_ipfix_logging_addr_exhausted (0, 1);
   return f;
 }
 
 static void
-  snat_ipfix_logging_max_entries_per_usr_rpc_cb
+  snat_ipfix_logging_max_entries_per_usr_event_cb
   (snat_ipfix_logging_max_entries_per_user_args_t * a)
 {
   snat_ipfix_logging_max_entries_per_usr (a->limit, a->src_ip, 0);
@@ -1619,8 +1685,7 @@ snat_ipfix_logging_max_entries_per_user (u32 limit, u32 src_ip)
   a.limit = limit;
   a.src_ip = src_ip;
 
-  vl_api_rpc_call_main_thread (snat_ipfix_logging_max_entries_per_usr_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_MAX_ENTRIES_PER_USER, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1629,12 +1694,13 @@ snat_data_callback_max_entries_per_usr (flow_report_main_t * frm,
 					vlib_frame_t * f,
 					u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   snat_ipfix_logging_max_entries_per_usr (0, 0, 1);
   return f;
 }
 
 static void
-nat_ipfix_logging_max_ses_rpc_cb (nat_ipfix_logging_max_sessions_args_t * a)
+nat_ipfix_logging_max_ses_event_cb (nat_ipfix_logging_max_sessions_args_t * a)
 {
   nat_ipfix_logging_max_ses (a->limit, 0);
 }
@@ -1654,8 +1720,7 @@ nat_ipfix_logging_max_sessions (u32 limit)
 
   a.limit = limit;
 
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_max_ses_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_MAX_SESSIONS, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1664,12 +1729,13 @@ nat_data_callback_max_sessions (flow_report_main_t * frm,
 				vlib_frame_t * f,
 				u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   nat_ipfix_logging_max_ses (0, 1);
   return f;
 }
 
 static void
-nat_ipfix_logging_max_bib_rpc_cb (nat_ipfix_logging_max_bibs_args_t * a)
+nat_ipfix_logging_max_bib_event_cb (nat_ipfix_logging_max_bibs_args_t * a)
 {
   nat_ipfix_logging_max_bib (a->limit, 0);
 }
@@ -1689,8 +1755,7 @@ nat_ipfix_logging_max_bibs (u32 limit)
 
   a.limit = limit;
 
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_max_bib_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_MAX_BIBS, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1699,12 +1764,13 @@ nat_data_callback_max_bibs (flow_report_main_t * frm,
 			    vlib_frame_t * f,
 			    u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   nat_ipfix_logging_max_bib (0, 1);
   return f;
 }
 
 static void
-nat_ipfix_logging_max_frag_ip4_rpc_cb (nat_ipfix_logging_max_frags_ip4_args_t * a)
+nat_ipfix_logging_max_frag_ip4_event_cb (nat_ipfix_logging_max_frags_ip4_args_t * a)
 {
   nat_ipfix_logging_max_frag_ip4 (a->limit, a->src, 0);
 }
@@ -1726,8 +1792,7 @@ nat_ipfix_logging_max_fragments_ip4 (u32 limit, ip4_address_t * src)
   a.limit = limit;
   a.src = src->as_u32;
 
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_max_frag_ip4_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_MAX_FRAGS_IP4, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1736,12 +1801,13 @@ nat_data_callback_max_frags_ip4 (flow_report_main_t * frm,
 			         vlib_frame_t * f,
 			         u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   nat_ipfix_logging_max_frag_ip4 (0, 0, 1);
   return f;
 }
 
 static void
-nat_ipfix_logging_max_frag_ip6_rpc_cb (nat_ipfix_logging_max_frags_ip6_args_t * a)
+nat_ipfix_logging_max_frag_ip6_event_cb (nat_ipfix_logging_max_frags_ip6_args_t * a)
 {
   ip6_address_t src;
   src.as_u64[0] = a->src[0];
@@ -1767,8 +1833,7 @@ nat_ipfix_logging_max_fragments_ip6 (u32 limit, ip6_address_t * src)
   a.src[0] = src->as_u64[0];
   a.src[1] = src->as_u64[1];
 
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_max_frag_ip6_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_MAX_FRAGS_IP6, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1777,12 +1842,13 @@ nat_data_callback_max_frags_ip6 (flow_report_main_t * frm,
 			         vlib_frame_t * f,
 			         u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   nat_ipfix_logging_max_frag_ip6 (0, 0, 1);
   return f;
 }
 
 static void
-nat_ipfix_logging_nat64_bib_rpc_cb (nat_ipfix_logging_nat64_bib_args_t * a)
+nat_ipfix_logging_nat64_bib_event_cb (nat_ipfix_logging_nat64_bib_args_t * a)
 {
   ip6_address_t src_ip;
   src_ip.as_u64[0] = a->src_ip[0];
@@ -1822,8 +1888,7 @@ nat_ipfix_logging_nat64_bib (ip6_address_t * src_ip,
   a.vrf_id = vrf_id;
   a.nat_event = is_create ? NAT64_BIB_CREATE : NAT64_BIB_DELETE;
 
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_nat64_bib_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_NAT64_BIB, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1832,12 +1897,13 @@ nat_data_callback_nat64_bib (flow_report_main_t * frm,
 			     vlib_frame_t * f,
 			     u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   nat_ipfix_logging_nat64_bibe (0, 0, 0, 0, 0, 0, 0, 1);
   return f;
 }
 
 static void
-nat_ipfix_logging_nat64_ses_rpc_cb (nat_ipfix_logging_nat64_ses_args_t * a)
+nat_ipfix_logging_nat64_ses_event_cb (nat_ipfix_logging_nat64_ses_args_t * a)
 {
   ip6_address_t src_ip, dst_ip;
   src_ip.as_u64[0] = a->src_ip[0];
@@ -1891,8 +1957,7 @@ nat_ipfix_logging_nat64_session (ip6_address_t * src_ip,
   a.vrf_id = vrf_id;
   a.nat_event = is_create ? NAT64_SESSION_CREATE : NAT64_SESSION_DELETE;
 
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_nat64_ses_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_event_enqueue (NAT_IPFIX_EVENT_NAT64_SES, &a, sizeof (a));
 }
 
 vlib_frame_t *
@@ -1901,10 +1966,164 @@ nat_data_callback_nat64_session (flow_report_main_t * frm,
 			         vlib_frame_t * f,
 			         u32 * to_next, u32 node_index)
 {
+  nat_ipfix_logging_drain (~0);
   nat_ipfix_logging_nat64_ses (0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1);
   return f;
 }
 
+static void
+nat_ipfix_event_dispatch (nat_ipfix_event_t * e)
+{
+  switch (e->type)
+    {
+    case NAT_IPFIX_EVENT_NAT44_SES:
+      snat_ipfix_logging_nat44_ses_event_cb (&e->nat44_ses);
+      break;
+    case NAT_IPFIX_EVENT_ADDR_EXHAUSTED:
+      snat_ipfix_logging_addr_exhausted_event_cb (&e->addr_exhausted);
+      break;
+    case NAT_IPFIX_EVENT_MAX_ENTRIES_PER_USER:
+      snat_ipfix_logging_max_entries_per_usr_event_cb
+	(&e->max_entries_per_user);
+      break;
+    case NAT_IPFIX_EVENT_MAX_SESSIONS:
+      nat_ipfix_logging_max_ses_event_cb (&e->max_sessions);
+      break;
+    case NAT_IPFIX_EVENT_MAX_BIBS:
+      nat_ipfix_logging_max_bib_event_cb (&e->max_bibs);
+      break;
+    case NAT_IPFIX_EVENT_MAX_FRAGS_IP4:
+      nat_ipfix_logging_max_frag_ip4_event_cb (&e->max_frags_ip4);
+      break;
+    case NAT_IPFIX_EVENT_MAX_FRAGS_IP6:
+      nat_ipfix_logging_max_frag_ip6_event_cb (&e->max_frags_ip6);
+      break;
+    case NAT_IPFIX_EVENT_NAT64_BIB:
+      nat_ipfix_logging_nat64_bib_event_cb (&e->nat64_bib);
+      break;
+    case NAT_IPFIX_EVENT_NAT64_SES:
+      nat_ipfix_logging_nat64_ses_event_cb (&e->nat64_ses);
+      break;
+    default:
+      ASSERT (0);
+    }
+}
+
+/**
+ * @brief Encode queued NAT events into IPFIX records
+ *
+ * Must be called from the main thread only, it is the single consumer of
+ * the per-thread event rings.
+ *
+ * @param max_per_ring maximum number of events taken from each ring
+ *
+ * @returns number of events processed
+ */
+static u32
+nat_ipfix_logging_drain (u32 max_per_ring)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  nat_ipfix_event_ring_t *r;
+  u32 tail, n, i, n_total = 0;
+
+  ASSERT (vlib_get_thread_index () == 0);
+
+  vec_foreach (r, silm->rings)
+    {
+      tail = r->tail;
+      n = clib_min (r->head - tail, max_per_ring);
+      if (n == 0)
+	continue;
+      /* read the index before the records */
+      CLIB_MEMORY_BARRIER ();
+
+      for (i = 0; i < n; i++)
+	nat_ipfix_event_dispatch
+	  (r->events + ((tail + i) & (NAT_IPFIX_EVENT_RING_SIZE - 1)));
+
+      /* done with the records, let the producer reuse the slots */
+      CLIB_MEMORY_BARRIER ();
+      r->tail = tail + n;
+      n_total += n;
+    }
+
+  if (n_total && silm->n_unflushed == 0)
+    silm->first_unflushed_time = vlib_time_now (vlib_get_main ());
+  silm->n_unflushed += n_total;
+
+  return n_total;
+}
+
+/**
+ * @brief Send all partially filled IPFIX packets
+ */
+static void
+nat_ipfix_logging_flush (void)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+
+  snat_ipfix_logging_nat44_ses (0, 0, 0, 0, 0, 0, 0, 1);
+  snat_ipfix_logging_addr_exhausted (0, 1);
+  snat_ipfix_logging_max_entries_per_usr (0, 0, 1);
+  nat_ipfix_logging_max_ses (0, 1);
+  nat_ipfix_logging_max_bib (0, 1);
+  nat_ipfix_logging_max_frag_ip4 (0, 0, 1);
+  nat_ipfix_logging_max_frag_ip6 (0, 0, 1);
+  nat_ipfix_logging_nat64_bibe (0, 0, 0, 0, 0, 0, 0, 1);
+  nat_ipfix_logging_nat64_ses (0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1);
+
+  silm->n_unflushed = 0;
+}
+
+/**
+ * @brief NAT IPFIX exporter process
+ *
+ * Drains the per-thread event rings in batches. Records are sent when an
+ * IPFIX packet reaches the path MTU or when the oldest record waiting in a
+ * partially filled packet is older than NAT_IPFIX_EXPORTER_FLUSH_INTERVAL.
+ */
+static uword
+nat_ipfix_logging_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+			   vlib_frame_t * f)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  f64 timeout = NAT_IPFIX_EXPORTER_POLL_INTERVAL;
+  u32 n;
+
+  while (1)
+    {
+      if (silm->enabled)
+	vlib_process_wait_for_event_or_clock (vm, timeout);
+      else
+	vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, 0);
+
+      if (!silm->enabled)
+	continue;
+
+      n = nat_ipfix_logging_drain (NAT_IPFIX_EXPORTER_BATCH);
+
+      if (silm->n_unflushed
+	  && vlib_time_now (vm) - silm->first_unflushed_time >
+	  NAT_IPFIX_EXPORTER_FLUSH_INTERVAL)
+	nat_ipfix_logging_flush ();
+
+      /* backlog, come back as soon as the other processes had a go */
+      timeout = n >= NAT_IPFIX_EXPORTER_BATCH ?
+	0 : NAT_IPFIX_EXPORTER_POLL_INTERVAL;
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat_ipfix_logging_process_node, static) = {
+    .function = nat_ipfix_logging_process,
+    .name = "nat-ipfix-logging-process",
+    .type = VLIB_NODE_TYPE_PROCESS,
+};
+/* *INDENT-ON* */
+
 /**
  * @brief Enable/disable NAT plugin IPFIX logging
  *
@@ -1927,8 +2146,29 @@ snat_ipfix_logging_enable_disable (int enable, u32 domain_id, u16 src_port)
   if (silm->enabled == e)
     return 0;
 
+  if (e && !silm->rings)
+    {
+      nat_ipfix_event_ring_t *r;
+
+      vec_validate_aligned (silm->rings,
+			    vlib_get_thread_main ()->n_vlib_mains - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      vec_foreach (r, silm->rings)
+	vec_validate (r->events, NAT_IPFIX_EVENT_RING_SIZE - 1);
+    }
+
   silm->enabled = e;
 
+  if (e)
+    vlib_process_signal_event (frm->vlib_main,
+			       silm->exporter_node_index, 0, 0);
+  else
+    {
+      /* nothing gets encoded any more, just discard queued events */
+      nat_ipfix_logging_drain (~0);
+      silm->n_unflushed = 0;
+    }
+
   memset (&a, 0, sizeof (a));
   a.is_add = enable;
   a.domain_id = domain_id ? domain_id : 1;
@@ -2043,6 +2283,12 @@ snat_ipfix_logging_init (vlib_main_t * vm)
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
 
   silm->enabled = 0;
+  silm->exporter_node_index = nat_ipfix_logging_process_node.index;
+
+  silm->event_drops.name = "ipfix event ring drops";
+  silm->event_drops.stat_segment_name = "/nat44/ipfix/event-ring-drops";
+  vlib_validate_simple_counter (&silm->event_drops, 0);
+  vlib_zero_simple_counter (&silm->event_drops, 0);
 
   /* Set up time reference pair */
   silm->vlib_time_0 = vlib_time_now (vm);
@@ -39,10 +39,49 @@ typedef enum {
   MAX_FRAGMENTS_PENDING_REASSEMBLY_IP6,
 } quota_exceed_event_t;
 
+/** per-worker event ring size, must be a power of 2 */
+#define NAT_IPFIX_EVENT_RING_SIZE 4096
+/** maximum number of events the exporter takes from a ring per dispatch */
+#define NAT_IPFIX_EXPORTER_BATCH 256
+/** exporter poll interval (seconds) */
+#define NAT_IPFIX_EXPORTER_POLL_INTERVAL 10e-3
+/** maximum age of a partially filled IPFIX packet (seconds) */
+#define NAT_IPFIX_EXPORTER_FLUSH_INTERVAL 1.0
+
+struct nat_ipfix_event_s;
+
+/**
+ * Single producer, single consumer event ring. The owning thread
+ * enqueues events, the exporter process on the main thread drains them.
+ */
+typedef struct {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /** event records, NAT_IPFIX_EVENT_RING_SIZE of them */
+  struct nat_ipfix_event_s *events;
+  /** producer index, written by the owning thread only */
+  volatile u32 head;
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  /** consumer index, written by the exporter only */
+  volatile u32 tail;
+} nat_ipfix_event_ring_t;
+
 typedef struct {
   /** NAT plugin IPFIX logging enabled */
   u8 enabled;
 
+  /** per-thread event rings */
+  nat_ipfix_event_ring_t *rings;
+
+  /** events dropped because a ring was full, per thread */
+  vlib_simple_counter_main_t event_drops;
+
+  /** exporter process node index */
+  u32 exporter_node_index;
+
+  /** records encoded since the last flush and time of the first one */
+  u32 n_unflushed;
+  f64 first_unflushed_time;
+
   /** ipfix buffers under construction */
   vlib_buffer_t *nat44_session_buffer;
   vlib_buffer_t *addr_exhausted_buffer;
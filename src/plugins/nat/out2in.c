@@ -164,6 +164,7 @@ create_session_for_static_mapping (snat_main_t *sm,
 {
   snat_user_t *u;
   snat_session_t *s;
+  snat_session_cold_t *c;
   clib_bihash_kv_8_8_t kv0;
   ip4_header_t *ip0;
   udp_header_t *udp0;
@@ -192,10 +193,11 @@ create_session_for_static_mapping (snat_main_t *sm,
       return 0;
     }
 
-  s->outside_address_index = ~0;
+  c = nat44_session_cold (&sm->per_thread_data[thread_index], s);
+  c->outside_address_index = ~0;
   s->flags |= SNAT_SESSION_FLAG_STATIC_MAPPING;
-  s->ext_host_addr.as_u32 = ip0->src_address.as_u32;
-  s->ext_host_port = udp0->src_port;
+  c->ext_host_addr.as_u32 = ip0->src_address.as_u32;
+  c->ext_host_port = udp0->src_port;
   user_session_increment (sm, u, 1 /* static */);
   s->in2out = in2out;
   s->out2in = out2in;
@@ -604,7 +606,8 @@ static inline u32 icmp_out2in_slow_path (snat_main_t *sm,
     {
       /* Accounting */
       nat44_session_update_counters (s0, now,
-                                     vlib_buffer_length_in_chain (sm->vlib_main, b0));
+                                     vlib_buffer_length_in_chain (sm->vlib_main, b0),
+                                     thread_index);
       /* Per-user LRU list maintenance */
       nat44_session_update_lru (sm, s0, thread_index);
     }
@@ -848,7 +851,8 @@ snat_out2in_node_fn (vlib_main_t * vm,
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
         trace0:
@@ -1000,7 +1004,8 @@ snat_out2in_node_fn (vlib_main_t * vm,
 
           /* Accounting */
           nat44_session_update_counters (s1, now,
-                                         vlib_buffer_length_in_chain (vm, b1));
+                                         vlib_buffer_length_in_chain (vm, b1),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s1, thread_index);
         trace1:
@@ -1188,7 +1193,8 @@ snat_out2in_node_fn (vlib_main_t * vm,
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
         trace00:
@@ -1443,7 +1449,8 @@ nat44_out2in_reass_node_fn (vlib_main_t * vm,
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
 
@@ -1579,6 +1586,7 @@ create_session_for_static_mapping_ed (snat_main_t * sm,
                                       u8 is_lb)
 {
   snat_session_t *s;
+  snat_session_cold_t *c;
   snat_user_t *u;
   ip4_header_t *ip;
   udp_header_t *udp;
@@ -1611,21 +1619,22 @@ create_session_for_static_mapping_ed (snat_main_t * sm,
   ip = vlib_buffer_get_current (b);
   udp = ip4_next_header (ip);
 
-  s->ext_host_addr.as_u32 = ip->src_address.as_u32;
-  s->ext_host_port = e_key.protocol == SNAT_PROTOCOL_ICMP ? 0 : udp->src_port;
+  c = nat44_session_cold (tsm, s);
+  c->ext_host_addr.as_u32 = ip->src_address.as_u32;
+  c->ext_host_port = e_key.protocol == SNAT_PROTOCOL_ICMP ? 0 : udp->src_port;
   s->flags |= SNAT_SESSION_FLAG_STATIC_MAPPING;
   if (is_lb)
     s->flags |= SNAT_SESSION_FLAG_LOAD_BALANCING;
   s->flags |= SNAT_SESSION_FLAG_ENDPOINT_DEPENDENT;
-  s->outside_address_index = ~0;
+  c->outside_address_index = ~0;
   s->out2in = e_key;
   s->in2out = l_key;
   s->in2out.protocol = s->out2in.protocol;
   user_session_increment (sm, u, 1);
 
   /* Add to lookup tables */
-  make_ed_kv (&kv, &e_key.addr, &s->ext_host_addr, ip->protocol,
-              e_key.fib_index, e_key.port, s->ext_host_port);
+  make_ed_kv (&kv, &e_key.addr, &c->ext_host_addr, ip->protocol,
+              e_key.fib_index, e_key.port, c->ext_host_port);
   kv.value = s - tsm->sessions;
   if (clib_bihash_add_del_16_8 (&tsm->out2in_ed, &kv, 1))
     nat_log_notice ("out2in-ed key add failed");
@@ -1646,16 +1655,16 @@ create_session_for_static_mapping_ed (snat_main_t * sm,
             nat_log_notice ("out2in-ed key del failed");
           return 0;
         }
-      s->ext_host_nat_addr.as_u32 = eh_key.addr.as_u32;
-      s->ext_host_nat_port = eh_key.port;
+      c->ext_host_nat_addr.as_u32 = eh_key.addr.as_u32;
+      c->ext_host_nat_port = eh_key.port;
       s->flags |= SNAT_SESSION_FLAG_TWICE_NAT;
-      make_ed_kv (&kv, &l_key.addr, &s->ext_host_nat_addr, ip->protocol,
-                  l_key.fib_index, l_key.port, s->ext_host_nat_port);
+      make_ed_kv (&kv, &l_key.addr, &c->ext_host_nat_addr, ip->protocol,
+                  l_key.fib_index, l_key.port, c->ext_host_nat_port);
     }
   else
     {
-      make_ed_kv (&kv, &l_key.addr, &s->ext_host_addr, ip->protocol,
-                  l_key.fib_index, l_key.port, s->ext_host_port);
+      make_ed_kv (&kv, &l_key.addr, &c->ext_host_addr, ip->protocol,
+                  l_key.fib_index, l_key.port, c->ext_host_port);
     }
   kv.value = s - tsm->sessions;
   if (clib_bihash_add_del_16_8 (&tsm->in2out_ed, &kv, 1))
@@ -1737,6 +1746,7 @@ create_bypass_for_fwd(snat_main_t * sm, ip4_header_t * ip, u32 rx_fib_index,
   udp_header_t *udp;
   snat_user_t *u;
   snat_session_t *s = 0;
+  snat_session_cold_t *c;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
   f64 now = vlib_time_now (sm->vlib_main);
 
@@ -1789,10 +1799,11 @@ create_bypass_for_fwd(snat_main_t * sm, ip4_header_t * ip, u32 rx_fib_index,
           return;
         }
 
-      s->ext_host_addr = key.r_addr;
-      s->ext_host_port = key.r_port;
+      c = nat44_session_cold (tsm, s);
+      c->ext_host_addr = key.r_addr;
+      c->ext_host_port = key.r_port;
       s->flags |= SNAT_SESSION_FLAG_FWD_BYPASS;
-      s->outside_address_index = ~0;
+      c->outside_address_index = ~0;
       s->out2in.addr = key.l_addr;
       s->out2in.port = key.l_port;
       s->out2in.protocol = ip_proto_to_snat_proto (key.proto);
@@ -1815,7 +1826,7 @@ create_bypass_for_fwd(snat_main_t * sm, ip4_header_t * ip, u32 rx_fib_index,
   /* Per-user LRU list maintenance */
   nat44_session_update_lru (sm, s, thread_index);
   /* Accounting */
-  nat44_session_update_counters (s, now, 0);
+  nat44_session_update_counters (s, now, 0, thread_index);
 }
 
 u32
@@ -1940,6 +1951,7 @@ nat44_ed_out2in_unknown_proto (snat_main_t *sm,
   u32 old_addr, new_addr;
   ip_csum_t sum;
   snat_session_t * s;
+  snat_session_cold_t *c;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
   snat_user_t *u;
 
@@ -1989,11 +2001,12 @@ nat44_ed_out2in_unknown_proto (snat_main_t *sm,
           return 0;
         }
 
-      s->ext_host_addr.as_u32 = ip->src_address.as_u32;
+      c = nat44_session_cold (tsm, s);
+      c->ext_host_addr.as_u32 = ip->src_address.as_u32;
       s->flags |= SNAT_SESSION_FLAG_UNKNOWN_PROTO;
       s->flags |= SNAT_SESSION_FLAG_STATIC_MAPPING;
       s->flags |= SNAT_SESSION_FLAG_ENDPOINT_DEPENDENT;
-      s->outside_address_index = ~0;
+      c->outside_address_index = ~0;
       s->out2in.addr.as_u32 = old_addr;
       s->out2in.fib_index = rx_fib_index;
       s->in2out.addr.as_u32 = new_addr;
@@ -2022,13 +2035,54 @@ nat44_ed_out2in_unknown_proto (snat_main_t *sm,
 
   /* Accounting */
   nat44_session_update_counters (s, now,
-                                 vlib_buffer_length_in_chain (vm, b));
+                                 vlib_buffer_length_in_chain (vm, b),
+                                         thread_index);
   /* Per-user LRU list maintenance */
   nat44_session_update_lru (sm, s, thread_index);
 
   return s;
 }
 
+/* Build the out2in keys of a frame and search them all at once */
+static_always_inline void
+nat44_ed_out2in_lookup_batch (vlib_main_t * vm,
+                              snat_main_per_thread_data_t * tsm, u32 * from,
+                              u32 n, nat_ed_lookup_batch_t * batch)
+{
+  vlib_buffer_t *b, *p;
+  ip4_header_t *ip;
+  udp_header_t *udp;
+  u32 i, sw_if_index, last_sw_if_index = ~0, fib_index = ~0;
+
+  for (i = 0; i < n; i++)
+    {
+      if (i + 4 < n)
+        {
+          p = vlib_get_buffer (vm, from[i + 4]);
+          vlib_prefetch_buffer_header (p, LOAD);
+          CLIB_PREFETCH (p->data, CLIB_CACHE_LINE_BYTES, LOAD);
+        }
+
+      b = vlib_get_buffer (vm, from[i]);
+      ip = vlib_buffer_get_current (b);
+
+      sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_RX];
+      if (PREDICT_FALSE (sw_if_index != last_sw_if_index))
+        {
+          fib_index = fib_table_get_index_for_sw_if_index (FIB_PROTOCOL_IP4,
+                                                           sw_if_index);
+          last_sw_if_index = sw_if_index;
+        }
+
+      /* Keys of non TCP/UDP packets are never used, no need to skip them */
+      udp = ip4_next_header (ip);
+      make_ed_kv (&batch->kv[i], &ip->dst_address, &ip->src_address,
+                  ip->protocol, fib_index, udp->dst_port, udp->src_port);
+    }
+
+  nat_ed_lookup_batch_search (&tsm->out2in_ed, batch, n);
+}
+
 static inline uword
 nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
                                 vlib_node_runtime_t * node,
@@ -2040,6 +2094,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
   f64 now = vlib_time_now (vm);
   u32 thread_index = vlib_get_thread_index ();
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  nat_ed_lookup_batch_t batch;
 
   stats_node_index = is_slow_path ? nat44_ed_out2in_slowpath_node.index :
     nat44_ed_out2in_node.index;
@@ -2048,6 +2103,11 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
   n_left_from = frame->n_vectors;
   next_index = node->cached_next_index;
 
+  /* The fast path only looks sessions up, search the whole frame first */
+  batch.is_valid = 0;
+  if (!is_slow_path)
+    nat44_ed_out2in_lookup_batch (vm, tsm, from, n_left_from, &batch);
+
   while (n_left_from > 0)
     {
       u32 n_left_to_next;
@@ -2056,7 +2116,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
 
       while (n_left_from >= 4 && n_left_to_next >= 2)
 	{
-          u32 bi0, bi1;
+          u32 bi0, bi1, i0, i1;
 	  vlib_buffer_t *b0, *b1;
           u32 next0, sw_if_index0, rx_fib_index0, proto0, old_addr0, new_addr0;
           u32 next1, sw_if_index1, rx_fib_index1, proto1, old_addr1, new_addr1;
@@ -2066,6 +2126,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
           tcp_header_t *tcp0, *tcp1;
           icmp46_header_t *icmp0, *icmp1;
           snat_session_t *s0 = 0, *s1 = 0;
+          snat_session_cold_t *c0, *c1;
           clib_bihash_kv_16_8_t kv0, value0, kv1, value1;
           ip_csum_t sum0, sum1;
           snat_session_key_t e_key0, l_key0, e_key1, l_key1;
@@ -2087,6 +2148,8 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
 	  }
 
           /* speculatively enqueue b0 and b1 to the current next frame */
+	  i0 = frame->n_vectors - n_left_from;
+	  i1 = i0 + 1;
 	  to_next[0] = bi0 = from[0];
 	  to_next[1] = bi1 = from[1];
 	  from += 2;
@@ -2161,7 +2224,8 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
           make_ed_kv (&kv0, &ip0->dst_address, &ip0->src_address, ip0->protocol,
                       rx_fib_index0, udp0->dst_port, udp0->src_port);
 
-          if (clib_bihash_search_16_8 (&tsm->out2in_ed, &kv0, &value0))
+          if (nat_ed_lookup_batch_get (&tsm->out2in_ed, &batch, i0, &kv0,
+                                        &value0))
             {
               if (is_slow_path)
                 {
@@ -2230,6 +2294,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
               s0 = pool_elt_at_index (tsm->sessions, value0.value);
             }
 
+          c0 = nat44_session_cold (tsm, s0);
           old_addr0 = ip0->dst_address.as_u32;
           new_addr0 = ip0->dst_address.as_u32 = s0->in2out.addr.as_u32;
           vnet_buffer(b0)->sw_if_index[VLIB_TX] = s0->in2out.fib_index;
@@ -2239,7 +2304,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
                                  dst_address);
           if (PREDICT_FALSE (is_twice_nat_session (s0)))
             sum0 = ip_csum_update (sum0, ip0->src_address.as_u32,
-                                   s0->ext_host_nat_addr.as_u32, ip4_header_t,
+                                   c0->ext_host_nat_addr.as_u32, ip4_header_t,
                                    src_address);
           ip0->checksum = ip_csum_fold (sum0);
 
@@ -2256,32 +2321,36 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
               if (is_twice_nat_session (s0))
                 {
                   sum0 = ip_csum_update (sum0, ip0->src_address.as_u32,
-                                         s0->ext_host_nat_addr.as_u32,
+                                         c0->ext_host_nat_addr.as_u32,
                                          ip4_header_t, dst_address);
                   sum0 = ip_csum_update (sum0, tcp0->src_port,
-                                         s0->ext_host_nat_port, ip4_header_t,
+                                         c0->ext_host_nat_port, ip4_header_t,
                                          length);
-                  tcp0->src_port = s0->ext_host_nat_port;
-                  ip0->src_address.as_u32 = s0->ext_host_nat_addr.as_u32;
+                  tcp0->src_port = c0->ext_host_nat_port;
+                  ip0->src_address.as_u32 = c0->ext_host_nat_addr.as_u32;
                 }
               tcp0->checksum = ip_csum_fold(sum0);
               if (nat44_set_tcp_session_state_o2i (sm, s0, tcp0, thread_index))
-                goto trace00;
+                {
+                  batch.is_valid = 0;
+                  goto trace00;
+                }
             }
           else
             {
               udp0->dst_port = s0->in2out.port;
               if (is_twice_nat_session (s0))
                 {
-                  udp0->src_port = s0->ext_host_nat_port;
-                  ip0->src_address.as_u32 = s0->ext_host_nat_addr.as_u32;
+                  udp0->src_port = c0->ext_host_nat_port;
+                  ip0->src_address.as_u32 = c0->ext_host_nat_addr.as_u32;
                 }
               udp0->checksum = 0;
             }
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
 
@@ -2365,7 +2434,8 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
           make_ed_kv (&kv1, &ip1->dst_address, &ip1->src_address, ip1->protocol,
                       rx_fib_index1, udp1->dst_port, udp1->src_port);
 
-          if (clib_bihash_search_16_8 (&tsm->out2in_ed, &kv1, &value1))
+          if (nat_ed_lookup_batch_get (&tsm->out2in_ed, &batch, i1, &kv1,
+                                        &value1))
             {
               if (is_slow_path)
                 {
@@ -2434,6 +2504,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
               s1 = pool_elt_at_index (tsm->sessions, value1.value);
             }
 
+          c1 = nat44_session_cold (tsm, s1);
           old_addr1 = ip1->dst_address.as_u32;
           new_addr1 = ip1->dst_address.as_u32 = s1->in2out.addr.as_u32;
           vnet_buffer(b1)->sw_if_index[VLIB_TX] = s1->in2out.fib_index;
@@ -2443,7 +2514,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
                                  dst_address);
           if (PREDICT_FALSE (is_twice_nat_session (s1)))
             sum1 = ip_csum_update (sum1, ip1->src_address.as_u32,
-                                   s1->ext_host_nat_addr.as_u32, ip4_header_t,
+                                   c1->ext_host_nat_addr.as_u32, ip4_header_t,
                                    src_address);
           ip1->checksum = ip_csum_fold (sum1);
 
@@ -2460,32 +2531,36 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
               if (is_twice_nat_session (s1))
                 {
                   sum1 = ip_csum_update (sum1, ip1->src_address.as_u32,
-                                         s1->ext_host_nat_addr.as_u32,
+                                         c1->ext_host_nat_addr.as_u32,
                                          ip4_header_t, dst_address);
                   sum1 = ip_csum_update (sum1, tcp1->src_port,
-                                         s1->ext_host_nat_port, ip4_header_t,
+                                         c1->ext_host_nat_port, ip4_header_t,
                                          length);
-                  tcp1->src_port = s1->ext_host_nat_port;
-                  ip1->src_address.as_u32 = s1->ext_host_nat_addr.as_u32;
+                  tcp1->src_port = c1->ext_host_nat_port;
+                  ip1->src_address.as_u32 = c1->ext_host_nat_addr.as_u32;
                 }
               tcp1->checksum = ip_csum_fold(sum1);
               if (nat44_set_tcp_session_state_o2i (sm, s1, tcp1, thread_index))
-                goto trace01;
+                {
+                  batch.is_valid = 0;
+                  goto trace01;
+                }
             }
           else
             {
               udp1->dst_port = s1->in2out.port;
               if (is_twice_nat_session (s1))
                 {
-                  udp1->src_port = s1->ext_host_nat_port;
-                  ip1->src_address.as_u32 = s1->ext_host_nat_addr.as_u32;
+                  udp1->src_port = c1->ext_host_nat_port;
+                  ip1->src_address.as_u32 = c1->ext_host_nat_addr.as_u32;
                 }
               udp1->checksum = 0;
             }
 
           /* Accounting */
           nat44_session_update_counters (s1, now,
-                                         vlib_buffer_length_in_chain (vm, b1));
+                                         vlib_buffer_length_in_chain (vm, b1),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s1, thread_index);
 
@@ -2513,7 +2588,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
 
       while (n_left_from > 0 && n_left_to_next > 0)
 	{
-          u32 bi0;
+          u32 bi0, i0;
 	  vlib_buffer_t *b0;
           u32 next0, sw_if_index0, rx_fib_index0, proto0, old_addr0, new_addr0;
           u16 old_port0, new_port0;
@@ -2522,6 +2597,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
           tcp_header_t *tcp0;
           icmp46_header_t * icmp0;
           snat_session_t *s0 = 0;
+          snat_session_cold_t *c0;
           clib_bihash_kv_16_8_t kv0, value0;
           ip_csum_t sum0;
           snat_session_key_t e_key0, l_key0;
@@ -2529,6 +2605,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
           twice_nat_type_t twice_nat0;
 
           /* speculatively enqueue b0 to the current next frame */
+	  i0 = frame->n_vectors - n_left_from;
 	  bi0 = from[0];
 	  to_next[0] = bi0;
 	  from += 1;
@@ -2601,7 +2678,8 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
           make_ed_kv (&kv0, &ip0->dst_address, &ip0->src_address, ip0->protocol,
                       rx_fib_index0, udp0->dst_port, udp0->src_port);
 
-          if (clib_bihash_search_16_8 (&tsm->out2in_ed, &kv0, &value0))
+          if (nat_ed_lookup_batch_get (&tsm->out2in_ed, &batch, i0, &kv0,
+                                        &value0))
             {
               if (is_slow_path)
                 {
@@ -2670,6 +2748,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
               s0 = pool_elt_at_index (tsm->sessions, value0.value);
             }
 
+          c0 = nat44_session_cold (tsm, s0);
           old_addr0 = ip0->dst_address.as_u32;
           new_addr0 = ip0->dst_address.as_u32 = s0->in2out.addr.as_u32;
           vnet_buffer(b0)->sw_if_index[VLIB_TX] = s0->in2out.fib_index;
@@ -2679,7 +2758,7 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
                                  dst_address);
           if (PREDICT_FALSE (is_twice_nat_session (s0)))
             sum0 = ip_csum_update (sum0, ip0->src_address.as_u32,
-                                   s0->ext_host_nat_addr.as_u32, ip4_header_t,
+                                   c0->ext_host_nat_addr.as_u32, ip4_header_t,
                                    src_address);
           ip0->checksum = ip_csum_fold (sum0);
 
@@ -2696,32 +2775,36 @@ nat44_ed_out2in_node_fn_inline (vlib_main_t * vm,
               if (is_twice_nat_session (s0))
                 {
                   sum0 = ip_csum_update (sum0, ip0->src_address.as_u32,
-                                         s0->ext_host_nat_addr.as_u32,
+                                         c0->ext_host_nat_addr.as_u32,
                                          ip4_header_t, dst_address);
                   sum0 = ip_csum_update (sum0, tcp0->src_port,
-                                         s0->ext_host_nat_port, ip4_header_t,
+                                         c0->ext_host_nat_port, ip4_header_t,
                                          length);
-                  tcp0->src_port = s0->ext_host_nat_port;
-                  ip0->src_address.as_u32 = s0->ext_host_nat_addr.as_u32;
+                  tcp0->src_port = c0->ext_host_nat_port;
+                  ip0->src_address.as_u32 = c0->ext_host_nat_addr.as_u32;
                 }
               tcp0->checksum = ip_csum_fold(sum0);
               if (nat44_set_tcp_session_state_o2i (sm, s0, tcp0, thread_index))
-                goto trace0;
+                {
+                  batch.is_valid = 0;
+                  goto trace0;
+                }
             }
           else
             {
               udp0->dst_port = s0->in2out.port;
               if (is_twice_nat_session (s0))
                 {
-                  udp0->src_port = s0->ext_host_nat_port;
-                  ip0->src_address.as_u32 = s0->ext_host_nat_addr.as_u32;
+                  udp0->src_port = c0->ext_host_nat_port;
+                  ip0->src_address.as_u32 = c0->ext_host_nat_addr.as_u32;
                 }
               udp0->checksum = 0;
             }
 
           /* Accounting */
           nat44_session_update_counters (s0, now,
-                                         vlib_buffer_length_in_chain (vm, b0));
+                                         vlib_buffer_length_in_chain (vm, b0),
+                                         thread_index);
           /* Per-user LRU list maintenance */
           nat44_session_update_lru (sm, s0, thread_index);
 
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vnet/ip/ip4_packet.h>
+#include <vnet/tcp/tcp_packet.h>
+
+static clib_error_t *
+test_gso_command_fn (vlib_main_t * vm, unformat_input_t * input,
+		     vlib_cli_command_t * cmd)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vlib_node_runtime_t rt;
+  vnet_hw_interface_t *hi;
+  vlib_buffer_t *b;
+  ip4_header_t *ip4;
+  tcp_header_t *th;
+  u32 hw_if_index = 0, payload = 9000, gso_size = 1448, encap = 0;
+  u32 bi, i, *segs = 0;
+  u8 *data = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "%U", unformat_vnet_hw_interface, vnm,
+		    &hw_if_index))
+	;
+      else if (unformat (input, "payload %u", &payload))
+	;
+      else if (unformat (input, "gso-size %u", &gso_size))
+	;
+      else if (unformat (input, "encap %u", &encap))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (gso_size == 0 || gso_size > 0xffff || payload > 0xffff - 40
+      || encap > 128)
+    return clib_error_return (0, "payload, gso-size or encap out of range");
+
+  /* errors are counted on the output node of the interface */
+  hi = vnet_get_hw_interface (vnm, hw_if_index);
+  memset (&rt, 0, sizeof (rt));
+  rt.node_index = hi->output_node_index;
+
+  /* ethernet, ip4 and tcp headers behind encap bytes of outer headers */
+  vec_validate (data, encap + 54 + payload - 1);
+  for (i = 0; i < payload; i++)
+    data[encap + 54 + i] = i;
+  ip4 = (ip4_header_t *) (data + encap + 14);
+  ip4->ip_version_and_header_length = 0x45;
+  ip4->ttl = 64;
+  ip4->protocol = IP_PROTOCOL_TCP;
+  ip4->length = clib_host_to_net_u16 (40 + payload);
+  ip4->src_address.as_u32 = clib_host_to_net_u32 (0x0a000001);
+  ip4->dst_address.as_u32 = clib_host_to_net_u32 (0x0a000002);
+  th = (tcp_header_t *) (ip4 + 1);
+  th->data_offset_and_reserved = 5 << 4;
+  th->flags = TCP_FLAG_ACK | TCP_FLAG_PSH;
+  th->seq_number = clib_host_to_net_u32 (1000);
+
+  if (vlib_buffer_alloc (vm, &bi, 1) != 1)
+    {
+      vec_free (data);
+      return clib_error_return (0, "buffer allocation failure");
+    }
+  b = vlib_get_buffer (vm, bi);
+  b->current_data = 0;
+  b->current_length = 0;
+  b->flags = 0;
+  vlib_buffer_add_data (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX, bi, data,
+			vec_len (data));
+  vec_free (data);
+
+  b->flags |= VNET_BUFFER_F_GSO | VNET_BUFFER_F_IS_IP4;
+  vnet_buffer (b)->l2_hdr_offset = encap;
+  vnet_buffer (b)->l3_hdr_offset = encap + 14;
+  vnet_buffer (b)->l4_hdr_offset = encap + 34;
+  vnet_buffer2 (b)->gso_size = gso_size;
+
+  vnet_interface_output_segment (vm, &rt, &bi, 1, &segs, 0);
+
+  vlib_cli_output (vm, "%u segments", vec_len (segs));
+  vec_foreach_index (i, segs)
+  {
+    b = vlib_get_buffer (vm, segs[i]);
+    ip4 = (ip4_header_t *) (b->data + vnet_buffer (b)->l3_hdr_offset);
+    th = (tcp_header_t *) (b->data + vnet_buffer (b)->l4_hdr_offset);
+    vlib_cli_output (vm, "segment %u: length %u ip-length %u seq %u", i,
+		     vlib_buffer_length_in_chain (vm, b),
+		     clib_net_to_host_u16 (ip4->length),
+		     clib_net_to_host_u32 (th->seq_number));
+  }
+
+  vlib_buffer_free (vm, segs, vec_len (segs));
+  vec_free (segs);
+  return 0;
+}
+
+/*?
+ * Segment a chained TCP GSO packet the way the output node of an
+ * interface without GSO support does and show the segments. Errors are
+ * counted on the output node of the given interface, local0 by default.
+ * With encap, the packet starts with that many bytes of tunnel headers.
+ *
+ * @cliexpar
+ * @cliexcmd{test gso payload 9000 gso-size 1448}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_gso_command, static) = {
+  .path = "test gso",
+  .short_help = "test gso [<interface>] [payload <n>] [gso-size <n>] "
+    "[encap <n>]",
+  .function = test_gso_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Correctness check and benchmark of the UDP tunnel demux lookups.
+ *
+ * Creates a number of tunnels with random source addresses and ids, then
+ * looks up a stream of random keys (one in 16 of them for a tunnel which
+ * does not exist) three ways and reports the cost of each in clocks per
+ * lookup:
+ *  - hash:   a clib hash with a one entry cache, as the decap nodes used to
+ *  - scalar: the demux bihash, one key at a time with the same cache
+ *  - batch:  the demux bihash, a frame of keys at a time
+ */
+
+#include <vlib/vlib.h>
+#include <vppinfra/random.h>
+#include <vnet/udp/udp_tunnel_demux.h>
+
+typedef struct
+{
+  u32 n_tunnels;
+  u32 n_packets;
+  u32 seed;
+  u8 is_ip6;
+  u8 verbose;
+
+  /* tunnel keys */
+  ip6_address_t *src;
+  u32 *id;
+
+  /* per packet tunnel index, ~0 for a miss */
+  u32 *expected;
+  u32 *results;
+
+  /* the same tunnels in a clib hash, for comparison */
+  uword *hash;
+  clib_bihash_kv_24_8_t *hash_keys6;
+} udp_tunnel_demux_test_t;
+
+static void
+udp_tunnel_demux_test_random_src (udp_tunnel_demux_test_t * tm,
+				  ip6_address_t * a)
+{
+  a->as_u32[0] = random_u32 (&tm->seed);
+  a->as_u32[1] = random_u32 (&tm->seed);
+  a->as_u32[2] = random_u32 (&tm->seed);
+  a->as_u32[3] = random_u32 (&tm->seed);
+}
+
+static int
+udp_tunnel_demux_test_add (udp_tunnel_demux_test_t * tm,
+			   udp_tunnel_demux_t * d)
+{
+  ip6_address_t src;
+  u32 i, id;
+
+  for (i = 0; i < tm->n_tunnels; i++)
+    {
+      /* make sure every key is unique */
+      do
+	{
+	  udp_tunnel_demux_test_random_src (tm, &src);
+	  id = random_u32 (&tm->seed) & clib_host_to_net_u32 (0xffffff00);
+	}
+      while (tm->is_ip6 ?
+	     udp_tunnel_demux_find6 (d, &src, id) != ~0 :
+	     udp_tunnel_demux_find4 (d, src.as_u32[0], id) != ~0);
+
+      vec_add1 (tm->src, src);
+      vec_add1 (tm->id, id);
+
+      if (tm->is_ip6)
+	{
+	  clib_bihash_kv_24_8_t *kv = vec_elt_at_index (tm->hash_keys6, i);
+
+	  if (udp_tunnel_demux_add_del6 (d, &src, id, i, 1 /* is_add */ ))
+	    return -1;
+	  udp_tunnel_demux_key6 (kv, &src, id);
+	  hash_set_mem (tm->hash, kv->key, i);
+	}
+      else
+	{
+	  if (udp_tunnel_demux_add_del4 (d, src.as_u32[0], id, i,
+					 1 /* is_add */ ))
+	    return -1;
+	  hash_set (tm->hash, udp_tunnel_demux_key4 (src.as_u32[0], id), i);
+	}
+    }
+  return 0;
+}
+
+static void
+udp_tunnel_demux_test_make_keys (udp_tunnel_demux_test_t * tm,
+				 u64 ** keys4, clib_bihash_kv_24_8_t ** kvs6)
+{
+  ip6_address_t src;
+  u32 i, t, id;
+
+  for (i = 0; i < tm->n_packets; i++)
+    {
+      if ((random_u32 (&tm->seed) & 15) == 0)
+	{
+	  /* a miss, tunnel ids never have the low byte set */
+	  udp_tunnel_demux_test_random_src (tm, &src);
+	  id = clib_host_to_net_u32 (1);
+	  t = ~0;
+	}
+      else
+	{
+	  t = random_u32 (&tm->seed) % tm->n_tunnels;
+	  src = tm->src[t];
+	  id = tm->id[t];
+	}
+
+      vec_add1 (tm->expected, t);
+      if (tm->is_ip6)
+	{
+	  clib_bihash_kv_24_8_t kv;
+	  udp_tunnel_demux_key6 (&kv, &src, id);
+	  vec_add1 (*kvs6, kv);
+	}
+      else
+	vec_add1 (*keys4, udp_tunnel_demux_key4 (src.as_u32[0], id));
+    }
+}
+
+static u64
+udp_tunnel_demux_test_hash (udp_tunnel_demux_test_t * tm, u64 * keys4,
+			    clib_bihash_kv_24_8_t * kvs6)
+{
+  u64 last_key4 = ~0, t0;
+  clib_bihash_kv_24_8_t last_kv6;
+  u32 i, last_index = ~0;
+  uword *p;
+
+  memset (&last_kv6, 0xff, sizeof (last_kv6));
+  t0 = clib_cpu_time_now ();
+
+  for (i = 0; i < tm->n_packets; i++)
+    {
+      if (tm->is_ip6)
+	{
+	  if (memcmp (kvs6[i].key, last_kv6.key, sizeof (last_kv6.key)))
+	    {
+	      p = hash_get_mem (tm->hash, kvs6[i].key);
+	      last_index = p ? p[0] : ~0;
+	      last_kv6 = kvs6[i];
+	    }
+	}
+      else if (keys4[i] != last_key4)
+	{
+	  p = hash_get (tm->hash, keys4[i]);
+	  last_index = p ? p[0] : ~0;
+	  last_key4 = keys4[i];
+	}
+      tm->results[i] = last_index;
+    }
+
+  return clib_cpu_time_now () - t0;
+}
+
+static u64
+udp_tunnel_demux_test_scalar (udp_tunnel_demux_test_t * tm,
+			      udp_tunnel_demux_t * d, u64 * keys4,
+			      clib_bihash_kv_24_8_t * kvs6)
+{
+  u64 last_key4 = ~0, t0;
+  clib_bihash_kv_24_8_t last_kv6;
+  u32 i, last_index = ~0;
+
+  memset (&last_kv6, 0xff, sizeof (last_kv6));
+  t0 = clib_cpu_time_now ();
+
+  for (i = 0; i < tm->n_packets; i++)
+    {
+      if (tm->is_ip6)
+	{
+	  if (memcmp (kvs6[i].key, last_kv6.key, sizeof (last_kv6.key)))
+	    {
+	      ip6_address_t src;
+	      src.as_u64[0] = kvs6[i].key[0];
+	      src.as_u64[1] = kvs6[i].key[1];
+	      last_index = udp_tunnel_demux_find6 (d, &src, kvs6[i].key[2]);
+	      last_kv6 = kvs6[i];
+	    }
+	}
+      else if (keys4[i] != last_key4)
+	{
+	  last_index = udp_tunnel_demux_find4 (d, (u32) keys4[i],
+					       keys4[i] >> 32);
+	  last_key4 = keys4[i];
+	}
+      tm->results[i] = last_index;
+    }
+
+  return clib_cpu_time_now () - t0;
+}
+
+static u64
+udp_tunnel_demux_test_batch (udp_tunnel_demux_test_t * tm,
+			     udp_tunnel_demux_t * d, u64 * keys4,
+			     clib_bihash_kv_24_8_t * kvs6)
+{
+  u32 i, n;
+  u64 t0;
+
+  t0 = clib_cpu_time_now ();
+
+  for (i = 0; i < tm->n_packets; i += n)
+    {
+      n = clib_min (VLIB_FRAME_SIZE, tm->n_packets - i);
+      if (tm->is_ip6)
+	udp_tunnel_demux_lookup6 (d, kvs6 + i, tm->results + i, n);
+      else
+	udp_tunnel_demux_lookup4 (d, keys4 + i, tm->results + i, n);
+    }
+
+  return clib_cpu_time_now () - t0;
+}
+
+static int
+udp_tunnel_demux_test_check (vlib_main_t * vm, udp_tunnel_demux_test_t * tm,
+			     char *what)
+{
+  u32 i;
+
+  for (i = 0; i < tm->n_packets; i++)
+    if (tm->results[i] != tm->expected[i])
+      {
+	vlib_cli_output (vm, "%s lookup %u: found %d expected %d",
+			 what, i, tm->results[i], tm->expected[i]);
+	return -1;
+      }
+  return 0;
+}
+
+static clib_error_t *
+udp_tunnel_demux_test (vlib_main_t * vm,
+		       unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  udp_tunnel_demux_test_t _tm = { 0 }, *tm = &_tm;
+  clib_bihash_kv_24_8_t *kvs6 = 0;
+  udp_tunnel_demux_t _d, *d = &_d;
+  clib_error_t *error = 0;
+  u64 *keys4 = 0, hash, scalar, batch;
+  f64 clocks_per_second;
+
+  tm->n_tunnels = 10000;
+  tm->n_packets = 1 << 20;
+  tm->seed = 0xdaddabed;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "tunnels %u", &tm->n_tunnels))
+	;
+      else if (unformat (input, "packets %u", &tm->n_packets))
+	;
+      else if (unformat (input, "seed %u", &tm->seed))
+	;
+      else if (unformat (input, "ip6"))
+	tm->is_ip6 = 1;
+      else if (unformat (input, "verbose"))
+	tm->verbose = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (tm->n_tunnels == 0 || tm->n_packets == 0)
+    return clib_error_return (0, "tunnels and packets must be non-zero");
+
+  memset (d, 0, sizeof (*d));
+  udp_tunnel_demux_init (d, "test");
+  if (tm->is_ip6)
+    {
+      /* the hash keys point into hash_keys6, which must not move */
+      vec_validate (tm->hash_keys6, tm->n_tunnels - 1);
+      tm->hash = hash_create_mem (0, sizeof (tm->hash_keys6[0].key),
+				  sizeof (uword));
+    }
+  else
+    tm->hash = hash_create (0, sizeof (uword));
+
+  if (udp_tunnel_demux_test_add (tm, d))
+    {
+      error = clib_error_return (0, "Failed to add tunnels");
+      goto done;
+    }
+
+  udp_tunnel_demux_test_make_keys (tm, &keys4, &kvs6);
+  vec_validate (tm->results, tm->n_packets - 1);
+
+  /* warm the tables and the key vectors, then time each variant */
+  udp_tunnel_demux_test_batch (tm, d, keys4, kvs6);
+
+  hash = udp_tunnel_demux_test_hash (tm, keys4, kvs6);
+  if (udp_tunnel_demux_test_check (vm, tm, "hash"))
+    {
+      error = clib_error_return (0, "Failed hash lookups");
+      goto done;
+    }
+
+  scalar = udp_tunnel_demux_test_scalar (tm, d, keys4, kvs6);
+  if (udp_tunnel_demux_test_check (vm, tm, "scalar"))
+    {
+      error = clib_error_return (0, "Failed scalar lookups");
+      goto done;
+    }
+
+  batch = udp_tunnel_demux_test_batch (tm, d, keys4, kvs6);
+  if (udp_tunnel_demux_test_check (vm, tm, "batch"))
+    {
+      error = clib_error_return (0, "Failed batch lookups");
+      goto done;
+    }
+
+  clocks_per_second = vm->clib_time.clocks_per_second;
+  vlib_cli_output (vm, "%s: %u tunnels, %u random lookups",
+		   tm->is_ip6 ? "ip6" : "ip4", tm->n_tunnels, tm->n_packets);
+  vlib_cli_output (vm, "  hash:   %.2f clocks/lookup, %.2f Mlookups/s",
+		   (f64) hash / tm->n_packets,
+		   tm->n_packets / ((f64) hash / clocks_per_second) / 1e6);
+  vlib_cli_output (vm, "  scalar: %.2f clocks/lookup, %.2f Mlookups/s",
+		   (f64) scalar / tm->n_packets,
+		   tm->n_packets / ((f64) scalar / clocks_per_second) / 1e6);
+  vlib_cli_output (vm, "  batch:  %.2f clocks/lookup, %.2f Mlookups/s",
+		   (f64) batch / tm->n_packets,
+		   tm->n_packets / ((f64) batch / clocks_per_second) / 1e6);
+
+  if (tm->verbose)
+    vlib_cli_output (vm, "%U", tm->is_ip6 ? format_bihash_24_8 :
+		     format_bihash_8_8,
+		     tm->is_ip6 ? (void *) &d->tunnel6_by_key :
+		     (void *) &d->tunnel4_by_key, 0 /* verbose */ );
+
+done:
+  udp_tunnel_demux_free (d);
+  hash_free (tm->hash);
+  vec_free (tm->hash_keys6);
+  vec_free (keys4);
+  vec_free (kvs6);
+  vec_free (tm->src);
+  vec_free (tm->id);
+  vec_free (tm->expected);
+  vec_free (tm->results);
+  return error;
+}
+
+/*?
+ * Check and benchmark the UDP tunnel (VXLAN, Geneve, GTP-U) decap lookup.
+ *
+ * @cliexpar
+ * Example of how to benchmark 10000 ip6 tunnels:
+ * @cliexcmd{test udp tunnel-demux tunnels 10000 packets 1000000 ip6}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (udp_tunnel_demux_test_command, static) = {
+  .path = "test udp tunnel-demux",
+  .short_help = "test udp tunnel-demux [tunnels <n>] [packets <n>] "
+                "[seed <n>] [ip6] [verbose]",
+  .function = udp_tunnel_demux_test,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -50,6 +50,46 @@ ooo_segment_end_pos (svm_fifo_t * f, ooo_segment_t * s)
   return (s->start + s->length) % f->nitems;
 }
 
+/**
+ * Copy len bytes to fifo starting at position pos. Wraps at nitems.
+ */
+static inline void
+svm_fifo_copy_to_pos (svm_fifo_t * f, u32 nitems, u32 pos, const u8 * src,
+		      u32 len)
+{
+  u32 n_bytes;
+
+  while (len)
+    {
+      n_bytes = clib_min (len, svm_fifo_contig_bytes (f, pos));
+      clib_memcpy (svm_fifo_pos_ptr (f, pos), src, n_bytes);
+      src += n_bytes;
+      len -= n_bytes;
+      pos += n_bytes;
+      pos = (pos == nitems) ? 0 : pos;
+    }
+}
+
+/**
+ * Copy len bytes from fifo starting at position pos. Wraps at nitems.
+ */
+static inline void
+svm_fifo_copy_from_pos (svm_fifo_t * f, u32 nitems, u32 pos, u8 * dst,
+			u32 len)
+{
+  u32 n_bytes;
+
+  while (len)
+    {
+      n_bytes = clib_min (len, svm_fifo_contig_bytes (f, pos));
+      clib_memcpy (dst, svm_fifo_pos_ptr (f, pos), n_bytes);
+      dst += n_bytes;
+      len -= n_bytes;
+      pos += n_bytes;
+      pos = (pos == nitems) ? 0 : pos;
+    }
+}
+
 u8 *
 format_ooo_segment (u8 * s, va_list * args)
 {
@@ -177,6 +217,10 @@ format_svm_fifo (u8 * s, va_list * args)
   s = format (s, " head %d tail %d segment manager %u\n", f->head, f->tail,
 	      f->segment_manager);
 
+  if (f->chunks)
+    s = format (s, " base size %u chunks %u\n", f->base_nitems,
+		svm_fifo_n_chunks (f));
+
   if (verbose > 1)
     s = format
       (s, " server session %d thread %d client session %d thread %d\n",
@@ -209,7 +253,9 @@ svm_fifo_create (u32 data_size_in_bytes)
 
   memset (f, 0, sizeof (*f));
   f->nitems = data_size_in_bytes;
+  f->base_nitems = data_size_in_bytes;
   f->ooos_list_head = OOO_SEGMENT_INVALID_INDEX;
+  f->ooos_tree_root = OOO_SEGMENT_INVALID_INDEX;
   f->refcnt = 1;
   return (f);
 }
@@ -217,15 +263,455 @@ svm_fifo_create (u32 data_size_in_bytes)
 void
 svm_fifo_free (svm_fifo_t * f)
 {
+  svm_fifo_chunk_t *c, *next;
+
   ASSERT (f->refcnt > 0);
 
   if (--f->refcnt == 0)
     {
+      c = svm_fifo_detach_chunks (f);
+      while (c)
+	{
+	  next = c->next;
+	  clib_mem_free (c);
+	  c = next;
+	}
       pool_free (f->ooo_segments);
       clib_mem_free (f);
     }
 }
 
+u32
+svm_fifo_n_chunks (svm_fifo_t * f)
+{
+  svm_fifo_chunk_t *c = f->chunks;
+  u32 n_chunks = 0;
+
+  while (c)
+    {
+      n_chunks++;
+      c = c->next;
+    }
+  return n_chunks;
+}
+
+/**
+ * Grow fifo by appending chunk to the end of the ring
+ *
+ * Must be called by the producer. Fails if data or out-of-order segments
+ * wrap around the end of the fifo, since the chunk would then be inserted
+ * in the middle of the data. The caller should retry once the consumer has
+ * caught up.
+ *
+ * @return 0 on success, -1 if the chunk was not added
+ */
+int
+svm_fifo_add_chunk (svm_fifo_t * f, svm_fifo_chunk_t * c)
+{
+  svm_fifo_chunk_t *prev;
+  u32 cursize;
+
+  /* read cursize before head: head only moves towards tail */
+  cursize = svm_fifo_max_dequeue (f);
+  if (cursize == f->nitems || f->tail < f->head
+      || svm_fifo_has_ooo_data (f))
+    return -1;
+
+  c->start_byte = f->nitems;
+  c->next = 0;
+
+  if (f->chunks)
+    {
+      prev = f->chunks;
+      while (prev->next)
+	prev = prev->next;
+      prev->next = c;
+    }
+  else
+    f->chunks = c;
+
+  /* Chunk must be visible before the consumer can wrap past it */
+  CLIB_MEMORY_BARRIER ();
+  f->nitems += c->length;
+  return 0;
+}
+
+/**
+ * Shrink fifo back to its inline data area
+ *
+ * Must be called by the producer. Succeeds only if the fifo is empty and
+ * its pointers are within the inline data area, so neither head nor tail
+ * need to be moved.
+ *
+ * @return list of chunks removed from fifo, if any
+ */
+svm_fifo_chunk_t *
+svm_fifo_collect_chunks (svm_fifo_t * f)
+{
+  svm_fifo_chunk_t *c;
+
+  if (!f->chunks || svm_fifo_max_dequeue (f)
+      || svm_fifo_has_ooo_data (f) || f->tail >= f->base_nitems)
+    return 0;
+
+  f->nitems = f->base_nitems;
+  CLIB_MEMORY_BARRIER ();
+  c = f->chunks;
+  f->chunks = 0;
+  return c;
+}
+
+/**
+ * Unconditionally remove all chunks from fifo. Only to be used when
+ * the fifo is freed.
+ */
+svm_fifo_chunk_t *
+svm_fifo_detach_chunks (svm_fifo_t * f)
+{
+  svm_fifo_chunk_t *c = f->chunks;
+
+  f->chunks = 0;
+  f->nitems = f->base_nitems;
+  return c;
+}
+
+/*
+ * Out-of-order segments are kept in a list sorted by position and are also
+ * indexed by a red-black tree, so that finding where a new segment goes
+ * does not require walking the list. Tree order is given by segment
+ * distance from tail which, as segments never overlap the tail, does not
+ * change as the tail advances. Invalid indices map to the fifo's sentinel.
+ */
+
+#define OOO_TREE_BLACK 0
+#define OOO_TREE_RED 1
+
+always_inline ooo_segment_t *
+ooo_tree_node (svm_fifo_t * f, u32 index)
+{
+  if (index == OOO_SEGMENT_INVALID_INDEX)
+    return &f->ooos_tree_nil;
+  return pool_elt_at_index (f->ooo_segments, index);
+}
+
+static void
+ooo_tree_rotate_left (svm_fifo_t * f, u32 xi)
+{
+  ooo_segment_t *x, *y, *p;
+  u32 yi;
+
+  x = ooo_tree_node (f, xi);
+  yi = x->right;
+  y = ooo_tree_node (f, yi);
+
+  x->right = y->left;
+  if (y->left != OOO_SEGMENT_INVALID_INDEX)
+    ooo_tree_node (f, y->left)->parent = xi;
+  y->parent = x->parent;
+  if (x->parent == OOO_SEGMENT_INVALID_INDEX)
+    f->ooos_tree_root = yi;
+  else
+    {
+      p = ooo_tree_node (f, x->parent);
+      if (p->left == xi)
+	p->left = yi;
+      else
+	p->right = yi;
+    }
+  y->left = xi;
+  x->parent = yi;
+}
+
+static void
+ooo_tree_rotate_right (svm_fifo_t * f, u32 xi)
+{
+  ooo_segment_t *x, *y, *p;
+  u32 yi;
+
+  x = ooo_tree_node (f, xi);
+  yi = x->left;
+  y = ooo_tree_node (f, yi);
+
+  x->left = y->right;
+  if (y->right != OOO_SEGMENT_INVALID_INDEX)
+    ooo_tree_node (f, y->right)->parent = xi;
+  y->parent = x->parent;
+  if (x->parent == OOO_SEGMENT_INVALID_INDEX)
+    f->ooos_tree_root = yi;
+  else
+    {
+      p = ooo_tree_node (f, x->parent);
+      if (p->right == xi)
+	p->right = yi;
+      else
+	p->left = yi;
+    }
+  y->right = xi;
+  x->parent = yi;
+}
+
+static void
+ooo_tree_insert (svm_fifo_t * f, u32 zi)
+{
+  ooo_segment_t *z, *y, *x, *p, *g;
+  u32 xi, yi = OOO_SEGMENT_INVALID_INDEX, pi, gi;
+
+  z = ooo_tree_node (f, zi);
+  xi = f->ooos_tree_root;
+  while (xi != OOO_SEGMENT_INVALID_INDEX)
+    {
+      yi = xi;
+      x = ooo_tree_node (f, xi);
+      xi = position_lt (f, z->start, x->start) ? x->left : x->right;
+    }
+
+  z->parent = yi;
+  z->left = z->right = OOO_SEGMENT_INVALID_INDEX;
+  z->color = OOO_TREE_RED;
+  if (yi == OOO_SEGMENT_INVALID_INDEX)
+    f->ooos_tree_root = zi;
+  else
+    {
+      y = ooo_tree_node (f, yi);
+      if (position_lt (f, z->start, y->start))
+	y->left = zi;
+      else
+	y->right = zi;
+    }
+
+  /* Rebalance */
+  while ((p = ooo_tree_node (f, z->parent))->color == OOO_TREE_RED)
+    {
+      pi = z->parent;
+      gi = p->parent;
+      g = ooo_tree_node (f, gi);
+      if (pi == g->left)
+	{
+	  y = ooo_tree_node (f, g->right);
+	  if (y->color == OOO_TREE_RED)
+	    {
+	      p->color = OOO_TREE_BLACK;
+	      y->color = OOO_TREE_BLACK;
+	      g->color = OOO_TREE_RED;
+	      zi = gi;
+	      z = g;
+	      continue;
+	    }
+	  if (zi == p->right)
+	    {
+	      zi = pi;
+	      ooo_tree_rotate_left (f, zi);
+	      z = ooo_tree_node (f, zi);
+	      pi = z->parent;
+	      p = ooo_tree_node (f, pi);
+	    }
+	  p->color = OOO_TREE_BLACK;
+	  g->color = OOO_TREE_RED;
+	  ooo_tree_rotate_right (f, gi);
+	}
+      else
+	{
+	  y = ooo_tree_node (f, g->left);
+	  if (y->color == OOO_TREE_RED)
+	    {
+	      p->color = OOO_TREE_BLACK;
+	      y->color = OOO_TREE_BLACK;
+	      g->color = OOO_TREE_RED;
+	      zi = gi;
+	      z = g;
+	      continue;
+	    }
+	  if (zi == p->left)
+	    {
+	      zi = pi;
+	      ooo_tree_rotate_right (f, zi);
+	      z = ooo_tree_node (f, zi);
+	      pi = z->parent;
+	      p = ooo_tree_node (f, pi);
+	    }
+	  p->color = OOO_TREE_BLACK;
+	  g->color = OOO_TREE_RED;
+	  ooo_tree_rotate_left (f, gi);
+	}
+    }
+  ooo_tree_node (f, f->ooos_tree_root)->color = OOO_TREE_BLACK;
+}
+
+static void
+ooo_tree_transplant (svm_fifo_t * f, u32 ui, u32 vi)
+{
+  ooo_segment_t *u, *p;
+
+  u = ooo_tree_node (f, ui);
+  if (u->parent == OOO_SEGMENT_INVALID_INDEX)
+    f->ooos_tree_root = vi;
+  else
+    {
+      p = ooo_tree_node (f, u->parent);
+      if (p->left == ui)
+	p->left = vi;
+      else
+	p->right = vi;
+    }
+  ooo_tree_node (f, vi)->parent = u->parent;
+}
+
+static void
+ooo_tree_delete_fixup (svm_fifo_t * f, u32 xi)
+{
+  ooo_segment_t *x, *p, *w;
+  u32 wi;
+
+  x = ooo_tree_node (f, xi);
+  while (xi != f->ooos_tree_root && x->color == OOO_TREE_BLACK)
+    {
+      p = ooo_tree_node (f, x->parent);
+      if (xi == p->left)
+	{
+	  wi = p->right;
+	  w = ooo_tree_node (f, wi);
+	  if (w->color == OOO_TREE_RED)
+	    {
+	      w->color = OOO_TREE_BLACK;
+	      p->color = OOO_TREE_RED;
+	      ooo_tree_rotate_left (f, x->parent);
+	      wi = p->right;
+	      w = ooo_tree_node (f, wi);
+	    }
+	  if (ooo_tree_node (f, w->left)->color == OOO_TREE_BLACK
+	      && ooo_tree_node (f, w->right)->color == OOO_TREE_BLACK)
+	    {
+	      w->color = OOO_TREE_RED;
+	      xi = x->parent;
+	      x = p;
+	      continue;
+	    }
+	  if (ooo_tree_node (f, w->right)->color == OOO_TREE_BLACK)
+	    {
+	      ooo_tree_node (f, w->left)->color = OOO_TREE_BLACK;
+	      w->color = OOO_TREE_RED;
+	      ooo_tree_rotate_right (f, wi);
+	      wi = p->right;
+	      w = ooo_tree_node (f, wi);
+	    }
+	  w->color = p->color;
+	  p->color = OOO_TREE_BLACK;
+	  ooo_tree_node (f, w->right)->color = OOO_TREE_BLACK;
+	  ooo_tree_rotate_left (f, x->parent);
+	}
+      else
+	{
+	  wi = p->left;
+	  w = ooo_tree_node (f, wi);
+	  if (w->color == OOO_TREE_RED)
+	    {
+	      w->color = OOO_TREE_BLACK;
+	      p->color = OOO_TREE_RED;
+	      ooo_tree_rotate_right (f, x->parent);
+	      wi = p->left;
+	      w = ooo_tree_node (f, wi);
+	    }
+	  if (ooo_tree_node (f, w->right)->color == OOO_TREE_BLACK
+	      && ooo_tree_node (f, w->left)->color == OOO_TREE_BLACK)
+	    {
+	      w->color = OOO_TREE_RED;
+	      xi = x->parent;
+	      x = p;
+	      continue;
+	    }
+	  if (ooo_tree_node (f, w->left)->color == OOO_TREE_BLACK)
+	    {
+	      ooo_tree_node (f, w->right)->color = OOO_TREE_BLACK;
+	      w->color = OOO_TREE_RED;
+	      ooo_tree_rotate_left (f, wi);
+	      wi = p->left;
+	      w = ooo_tree_node (f, wi);
+	    }
+	  w->color = p->color;
+	  p->color = OOO_TREE_BLACK;
+	  ooo_tree_node (f, w->left)->color = OOO_TREE_BLACK;
+	  ooo_tree_rotate_right (f, x->parent);
+	}
+      xi = f->ooos_tree_root;
+      x = ooo_tree_node (f, xi);
+    }
+  x->color = OOO_TREE_BLACK;
+}
+
+static void
+ooo_tree_delete (svm_fifo_t * f, u32 zi)
+{
+  ooo_segment_t *z, *y;
+  u32 xi, yi;
+  u8 y_color;
+
+  z = ooo_tree_node (f, zi);
+  y_color = z->color;
+
+  if (z->left == OOO_SEGMENT_INVALID_INDEX)
+    {
+      xi = z->right;
+      ooo_tree_transplant (f, zi, xi);
+    }
+  else if (z->right == OOO_SEGMENT_INVALID_INDEX)
+    {
+      xi = z->left;
+      ooo_tree_transplant (f, zi, xi);
+    }
+  else
+    {
+      /* Successor is the next segment in the sorted list */
+      yi = z->next;
+      y = ooo_tree_node (f, yi);
+      ASSERT (y->left == OOO_SEGMENT_INVALID_INDEX);
+      y_color = y->color;
+      xi = y->right;
+      if (y->parent == zi)
+	ooo_tree_node (f, xi)->parent = yi;
+      else
+	{
+	  ooo_tree_transplant (f, yi, xi);
+	  y->right = z->right;
+	  ooo_tree_node (f, y->right)->parent = yi;
+	}
+      ooo_tree_transplant (f, zi, yi);
+      y->left = z->left;
+      ooo_tree_node (f, y->left)->parent = yi;
+      y->color = z->color;
+    }
+
+  if (y_color == OOO_TREE_BLACK)
+    ooo_tree_delete_fixup (f, xi);
+}
+
+/**
+ * Find first segment that does not start before position pos or, if all
+ * do, the last segment.
+ */
+static u32
+ooo_tree_search (svm_fifo_t * f, u32 pos)
+{
+  u32 index = f->ooos_tree_root, found = OOO_SEGMENT_INVALID_INDEX;
+  u32 last = OOO_SEGMENT_INVALID_INDEX;
+  ooo_segment_t *s;
+
+  while (index != OOO_SEGMENT_INVALID_INDEX)
+    {
+      s = pool_elt_at_index (f->ooo_segments, index);
+      if (position_lt (f, s->start, pos))
+	{
+	  last = index;
+	  index = s->right;
+	}
+      else
+	{
+	  found = index;
+	  index = s->left;
+	}
+    }
+  return found != OOO_SEGMENT_INVALID_INDEX ? found : last;
+}
+
 always_inline ooo_segment_t *
 ooo_segment_new (svm_fifo_t * f, u32 start, u32 length)
 {
@@ -263,6 +749,7 @@ ooo_segment_del (svm_fifo_t * f, u32 index)
       f->ooos_list_head = cur->next;
     }
 
+  ooo_tree_delete (f, index);
   pool_put (f->ooo_segments, cur);
 }
 
@@ -288,14 +775,13 @@ ooo_segment_add (svm_fifo_t * f, u32 offset, u32 length)
       s = ooo_segment_new (f, normalized_position, length);
       f->ooos_list_head = s - f->ooo_segments;
       f->ooos_newest = f->ooos_list_head;
+      ooo_tree_insert (f, f->ooos_list_head);
       return;
     }
 
   /* Find first segment that starts after new segment */
-  s = pool_elt_at_index (f->ooo_segments, f->ooos_list_head);
-  while (s->next != OOO_SEGMENT_INVALID_INDEX
-	 && position_lt (f, s->start, normalized_position))
-    s = pool_elt_at_index (f->ooo_segments, s->next);
+  s_index = ooo_tree_search (f, normalized_position);
+  s = pool_elt_at_index (f->ooo_segments, s_index);
 
   /* If we have a previous and we overlap it, use it as starting point */
   prev = ooo_segment_get_prev (f, s);
@@ -337,6 +823,7 @@ ooo_segment_add (svm_fifo_t * f, u32 offset, u32 length)
       new_s->next = s_index;
       s->prev = new_index;
       f->ooos_newest = new_index;
+      ooo_tree_insert (f, new_index);
       return;
     }
   /* No overlap, add after current segment */
@@ -354,6 +841,7 @@ ooo_segment_add (svm_fifo_t * f, u32 offset, u32 length)
       new_s->prev = s_index;
       s->next = new_index;
       f->ooos_newest = new_index;
+      ooo_tree_insert (f, new_index);
 
       return;
     }
@@ -455,7 +943,7 @@ static int
 svm_fifo_enqueue_internal (svm_fifo_t * f, u32 max_bytes,
 			   const u8 * copy_from_here)
 {
-  u32 total_copy_bytes, first_copy_bytes, second_copy_bytes;
+  u32 total_copy_bytes;
   u32 cursize, nitems;
 
   /* read cursize, which can only increase while we're working */
@@ -473,23 +961,10 @@ svm_fifo_enqueue_internal (svm_fifo_t * f, u32 max_bytes,
 
   if (PREDICT_TRUE (copy_from_here != 0))
     {
-      /* Number of bytes in first copy segment */
-      first_copy_bytes = ((nitems - f->tail) < total_copy_bytes)
-	? (nitems - f->tail) : total_copy_bytes;
-
-      clib_memcpy (&f->data[f->tail], copy_from_here, first_copy_bytes);
-      f->tail += first_copy_bytes;
-      f->tail = (f->tail == nitems) ? 0 : f->tail;
-
-      /* Number of bytes in second copy segment, if any */
-      second_copy_bytes = total_copy_bytes - first_copy_bytes;
-      if (second_copy_bytes)
-	{
-	  clib_memcpy (&f->data[f->tail], copy_from_here + first_copy_bytes,
-		       second_copy_bytes);
-	  f->tail += second_copy_bytes;
-	  f->tail = (f->tail == nitems) ? 0 : f->tail;
-	}
+      svm_fifo_copy_to_pos (f, nitems, f->tail, copy_from_here,
+			    total_copy_bytes);
+      f->tail += total_copy_bytes;
+      f->tail = (f->tail >= nitems) ? f->tail - nitems : f->tail;
     }
   else
     {
@@ -563,7 +1038,6 @@ svm_fifo_enqueue_with_offset_internal (svm_fifo_t * f,
 				       u32 required_bytes,
 				       u8 * copy_from_here)
 {
-  u32 total_copy_bytes, first_copy_bytes, second_copy_bytes;
   u32 cursize, nitems, normalized_offset;
 
   f->ooos_newest = OOO_SEGMENT_INVALID_INDEX;
@@ -583,28 +1057,8 @@ svm_fifo_enqueue_with_offset_internal (svm_fifo_t * f,
   svm_fifo_trace_add (f, offset, required_bytes, 1);
 
   ooo_segment_add (f, offset, required_bytes);
-
-  /* Number of bytes we're going to copy */
-  total_copy_bytes = required_bytes;
-
-  /* Number of bytes in first copy segment */
-  first_copy_bytes = ((nitems - normalized_offset) < total_copy_bytes)
-    ? (nitems - normalized_offset) : total_copy_bytes;
-
-  clib_memcpy (&f->data[normalized_offset], copy_from_here, first_copy_bytes);
-
-  /* Number of bytes in second copy segment, if any */
-  second_copy_bytes = total_copy_bytes - first_copy_bytes;
-  if (second_copy_bytes)
-    {
-      normalized_offset += first_copy_bytes;
-      normalized_offset %= nitems;
-
-      ASSERT (normalized_offset == 0);
-
-      clib_memcpy (&f->data[normalized_offset],
-		   copy_from_here + first_copy_bytes, second_copy_bytes);
-    }
+  svm_fifo_copy_to_pos (f, nitems, normalized_offset, copy_from_here,
+			required_bytes);
 
   return (0);
 }
@@ -622,22 +1076,14 @@ svm_fifo_enqueue_with_offset (svm_fifo_t * f,
 void
 svm_fifo_overwrite_head (svm_fifo_t * f, u8 * data, u32 len)
 {
-  u32 first_chunk;
-  first_chunk = f->nitems - f->head;
   ASSERT (len <= f->nitems);
-  if (len <= first_chunk)
-    clib_memcpy (&f->data[f->head], data, len);
-  else
-    {
-      clib_memcpy (&f->data[f->head], data, first_chunk);
-      clib_memcpy (&f->data[0], data + first_chunk, len - first_chunk);
-    }
+  svm_fifo_copy_to_pos (f, f->nitems, f->head, data, len);
 }
 
 static int
 svm_fifo_dequeue_internal (svm_fifo_t * f, u32 max_bytes, u8 * copy_here)
 {
-  u32 total_copy_bytes, first_copy_bytes, second_copy_bytes;
+  u32 total_copy_bytes;
   u32 cursize, nitems;
 
   /* read cursize, which can only increase while we're working */
@@ -652,22 +1098,10 @@ svm_fifo_dequeue_internal (svm_fifo_t * f, u32 max_bytes, u8 * copy_here)
 
   if (PREDICT_TRUE (copy_here != 0))
     {
-      /* Number of bytes in first copy segment */
-      first_copy_bytes = ((nitems - f->head) < total_copy_bytes)
-	? (nitems - f->head) : total_copy_bytes;
-      clib_memcpy (copy_here, &f->data[f->head], first_copy_bytes);
-      f->head += first_copy_bytes;
-      f->head = (f->head == nitems) ? 0 : f->head;
-
-      /* Number of bytes in second copy segment, if any */
-      second_copy_bytes = total_copy_bytes - first_copy_bytes;
-      if (second_copy_bytes)
-	{
-	  clib_memcpy (copy_here + first_copy_bytes,
-		       &f->data[f->head], second_copy_bytes);
-	  f->head += second_copy_bytes;
-	  f->head = (f->head == nitems) ? 0 : f->head;
-	}
+      svm_fifo_copy_from_pos (f, nitems, f->head, copy_here,
+			      total_copy_bytes);
+      f->head += total_copy_bytes;
+      f->head = (f->head >= nitems) ? f->head - nitems : f->head;
     }
   else
     {
@@ -725,7 +1159,7 @@ static int
 svm_fifo_peek_ma (svm_fifo_t * f, u32 relative_offset, u32 max_bytes,
 		  u8 * copy_here)
 {
-  u32 total_copy_bytes, first_copy_bytes, second_copy_bytes;
+  u32 total_copy_bytes;
   u32 cursize, nitems, real_head;
 
   /* read cursize, which can only increase while we're working */
@@ -742,21 +1176,8 @@ svm_fifo_peek_ma (svm_fifo_t * f, u32 relative_offset, u32 max_bytes,
     cursize - relative_offset : max_bytes;
 
   if (PREDICT_TRUE (copy_here != 0))
-    {
-      /* Number of bytes in first copy segment */
-      first_copy_bytes =
-	((nitems - real_head) < total_copy_bytes) ?
-	(nitems - real_head) : total_copy_bytes;
-      clib_memcpy (copy_here, &f->data[real_head], first_copy_bytes);
-
-      /* Number of bytes in second copy segment, if any */
-      second_copy_bytes = total_copy_bytes - first_copy_bytes;
-      if (second_copy_bytes)
-	{
-	  clib_memcpy (copy_here + first_copy_bytes, &f->data[0],
-		       second_copy_bytes);
-	}
-    }
+    svm_fifo_copy_from_pos (f, nitems, real_head, copy_here,
+			    total_copy_bytes);
   return total_copy_bytes;
 }
 
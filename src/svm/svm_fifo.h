@@ -31,6 +31,11 @@ typedef struct
 
   u32 start;	/**< Start of segment, normalized*/
   u32 length;	/**< Length of segment */
+
+  u32 left;	/**< Left child in lookup tree */
+  u32 right;	/**< Right child in lookup tree */
+  u32 parent;	/**< Parent in lookup tree */
+  u32 color;	/**< Lookup tree node color */
 } ooo_segment_t;
 
 format_function_t format_ooo_segment;
@@ -46,13 +51,26 @@ typedef struct
   u32 action;
 } svm_fifo_trace_elem_t;
 
+/** Fifo memory appended to the inline data area of a fifo */
+typedef struct svm_fifo_chunk_
+{
+  u32 start_byte;		/**< position of first chunk byte in fifo */
+  u32 length;			/**< length of chunk in bytes */
+  struct svm_fifo_chunk_ *next;	/**< next chunk in fifo or freelist */
+  u8 data[0];			/**< start of chunk data */
+} svm_fifo_chunk_t;
+
 typedef struct _svm_fifo
 {
   volatile u32 cursize;		/**< current fifo size */
   u32 nitems;
+  u32 base_nitems;		/**< bytes held in the inline data area */
+  u32 max_nitems;		/**< size fifo may grow to, 0 if fixed */
+  svm_fifo_chunk_t *chunks;	/**< chunks appended to inline data */
     CLIB_CACHE_LINE_ALIGN_MARK (end_cursize);
 
   volatile u32 has_event;	/**< non-zero if deq event exists */
+  volatile u8 want_tx_evt;	/**< consumer wants event on dequeue */
 
   /* Backpointers */
   u32 master_session_index;
@@ -70,6 +88,8 @@ typedef struct _svm_fifo
   ooo_segment_t *ooo_segments;	/**< Pool of ooo segments */
   u32 ooos_list_head;		/**< Head of out-of-order linked-list */
   u32 ooos_newest;		/**< Last segment to have been updated */
+  u32 ooos_tree_root;		/**< Root of ooo segment red-black tree */
+  ooo_segment_t ooos_tree_nil;	/**< Tree sentinel, always black */
   struct _svm_fifo *next;	/**< next in freelist/active chain */
   struct _svm_fifo *prev;	/**< prev in active chain */
 #if SVM_FIFO_TRACE
@@ -141,6 +161,32 @@ svm_fifo_unset_event (svm_fifo_t * f)
   __sync_lock_release (&f->has_event);
 }
 
+/**
+ * Ask the fifo's consumer to send an event once it dequeues data.
+ */
+always_inline void
+svm_fifo_set_want_tx_evt (svm_fifo_t * f)
+{
+  __atomic_store_n (&f->want_tx_evt, 1, __ATOMIC_SEQ_CST);
+}
+
+always_inline u8
+svm_fifo_want_tx_evt (svm_fifo_t * f)
+{
+  return f->want_tx_evt;
+}
+
+/**
+ * Clears the dequeue event request.
+ *
+ * @return 1 if an event was requested
+ */
+always_inline u8
+svm_fifo_clear_want_tx_evt (svm_fifo_t * f)
+{
+  return __atomic_exchange_n (&f->want_tx_evt, 0, __ATOMIC_SEQ_CST);
+}
+
 svm_fifo_t *svm_fifo_create (u32 data_size_in_bytes);
 void svm_fifo_free (svm_fifo_t * f);
 
@@ -157,6 +203,10 @@ u32 svm_fifo_number_ooo_segments (svm_fifo_t * f);
 ooo_segment_t *svm_fifo_first_ooo_segment (svm_fifo_t * f);
 void svm_fifo_init_pointers (svm_fifo_t * f, u32 pointer);
 void svm_fifo_overwrite_head (svm_fifo_t * f, u8 * data, u32 len);
+int svm_fifo_add_chunk (svm_fifo_t * f, svm_fifo_chunk_t * c);
+svm_fifo_chunk_t *svm_fifo_collect_chunks (svm_fifo_t * f);
+svm_fifo_chunk_t *svm_fifo_detach_chunks (svm_fifo_t * f);
+u32 svm_fifo_n_chunks (svm_fifo_t * f);
 
 format_function_t format_svm_fifo;
 
@@ -174,13 +224,56 @@ svm_fifo_newest_ooo_segment_reset (svm_fifo_t * f)
   f->ooos_newest = OOO_SEGMENT_INVALID_INDEX;
 }
 
+always_inline svm_fifo_chunk_t *
+svm_fifo_find_chunk (svm_fifo_t * f, u32 pos)
+{
+  svm_fifo_chunk_t *c = f->chunks;
+  while (pos >= c->start_byte + c->length)
+    c = c->next;
+  return c;
+}
+
+/**
+ * Pointer to fifo memory that backs position pos
+ */
+always_inline u8 *
+svm_fifo_pos_ptr (svm_fifo_t * f, u32 pos)
+{
+  svm_fifo_chunk_t *c;
+
+  if (PREDICT_TRUE (pos < f->base_nitems))
+    return (f->data + pos);
+
+  c = svm_fifo_find_chunk (f, pos);
+  return (c->data + pos - c->start_byte);
+}
+
+/**
+ * Number of bytes, starting at position pos, that are contiguous in memory
+ */
+always_inline u32
+svm_fifo_contig_bytes (svm_fifo_t * f, u32 pos)
+{
+  svm_fifo_chunk_t *c;
+
+  if (PREDICT_TRUE (pos < f->base_nitems))
+    return f->base_nitems - pos;
+
+  c = svm_fifo_find_chunk (f, pos);
+  return c->start_byte + c->length - pos;
+}
+
 /**
  * Max contiguous chunk of data that can be read
  */
 always_inline u32
 svm_fifo_max_read_chunk (svm_fifo_t * f)
 {
-  return ((f->tail > f->head) ? (f->tail - f->head) : (f->nitems - f->head));
+  u32 len;
+  len = ((f->tail > f->head) ? (f->tail - f->head) : (f->nitems - f->head));
+  if (PREDICT_FALSE (f->chunks != 0))
+    len = clib_min (len, svm_fifo_contig_bytes (f, f->head));
+  return len;
 }
 
 /**
@@ -189,7 +282,11 @@ svm_fifo_max_read_chunk (svm_fifo_t * f)
 always_inline u32
 svm_fifo_max_write_chunk (svm_fifo_t * f)
 {
-  return ((f->tail >= f->head) ? (f->nitems - f->tail) : (f->head - f->tail));
+  u32 len;
+  len = ((f->tail >= f->head) ? (f->nitems - f->tail) : (f->head - f->tail));
+  if (PREDICT_FALSE (f->chunks != 0))
+    len = clib_min (len, svm_fifo_contig_bytes (f, f->tail));
+  return len;
 }
 
 /**
@@ -208,13 +305,13 @@ svm_fifo_enqueue_nocopy (svm_fifo_t * f, u32 bytes)
 always_inline u8 *
 svm_fifo_head (svm_fifo_t * f)
 {
-  return (f->data + f->head);
+  return svm_fifo_pos_ptr (f, f->head);
 }
 
 always_inline u8 *
 svm_fifo_tail (svm_fifo_t * f)
 {
-  return (f->data + f->tail);
+  return svm_fifo_pos_ptr (f, f->tail);
 }
 
 always_inline u32
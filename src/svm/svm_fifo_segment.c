@@ -378,7 +378,9 @@ svm_fifo_segment_alloc_fifo (svm_fifo_segment_private_t * s,
 	  /* (re)initialize the fifo, as in svm_fifo_create */
 	  memset (f, 0, sizeof (*f));
 	  f->nitems = data_size_in_bytes;
+	  f->base_nitems = data_size_in_bytes;
 	  f->ooos_list_head = OOO_SEGMENT_INVALID_INDEX;
+	  f->ooos_tree_root = OOO_SEGMENT_INVALID_INDEX;
 	  f->refcnt = 1;
 	  f->freelist_index = freelist_index;
 	  goto found;
@@ -422,6 +424,109 @@ done:
   return (f);
 }
 
+static void
+svm_fifo_segment_put_chunks (svm_fifo_segment_header_t * fsh,
+			     svm_fifo_chunk_t * c)
+{
+  svm_fifo_chunk_t *next;
+  int freelist_index;
+
+  while (c)
+    {
+      next = c->next;
+      freelist_index = max_log2 (c->length)
+	- max_log2 (FIFO_SEGMENT_MIN_FIFO_SIZE);
+      ASSERT (freelist_index < vec_len (fsh->free_chunks));
+      c->next = fsh->free_chunks[freelist_index];
+      fsh->free_chunks[freelist_index] = c;
+      c = next;
+    }
+}
+
+/**
+ * Grow fifo by chunk_size bytes
+ *
+ * Chunks are taken from the segment's chunk freelists or, if none is
+ * available, allocated on the segment heap. Must be called by the fifo's
+ * producer.
+ *
+ * @return 0 on success, -1 if no memory was found or the fifo could not
+ * be grown at this time.
+ */
+int
+svm_fifo_segment_grow_fifo (svm_fifo_segment_private_t * s, svm_fifo_t * f,
+			    u32 chunk_size)
+{
+  ssvm_shared_header_t *sh;
+  svm_fifo_segment_header_t *fsh;
+  svm_fifo_chunk_t *c;
+  int freelist_index, rv = -1;
+  void *oldheap;
+
+  if (!is_pow2 (chunk_size) || chunk_size < FIFO_SEGMENT_MIN_FIFO_SIZE
+      || f->nitems + chunk_size > FIFO_SEGMENT_MAX_FIFO_SIZE)
+    return -1;
+
+  freelist_index = max_log2 (chunk_size)
+    - max_log2 (FIFO_SEGMENT_MIN_FIFO_SIZE);
+
+  sh = s->ssvm.sh;
+  ssvm_lock_non_recursive (sh, 3);
+  fsh = (svm_fifo_segment_header_t *) sh->opaque[0];
+
+  oldheap = ssvm_push_heap (sh);
+  vec_validate_init_empty (fsh->free_chunks, freelist_index, 0);
+  c = fsh->free_chunks[freelist_index];
+  if (c)
+    {
+      fsh->free_chunks[freelist_index] = c->next;
+    }
+  else
+    {
+      c = clib_mem_alloc_aligned_or_null (sizeof (*c) + chunk_size,
+					  CLIB_CACHE_LINE_BYTES);
+      if (PREDICT_FALSE (c == 0))
+	goto done;
+      c->length = chunk_size;
+    }
+
+  rv = svm_fifo_add_chunk (f, c);
+  if (rv)
+    {
+      c->next = fsh->free_chunks[freelist_index];
+      fsh->free_chunks[freelist_index] = c;
+    }
+
+done:
+  ssvm_pop_heap (oldheap);
+  ssvm_unlock_non_recursive (sh);
+  return rv;
+}
+
+/**
+ * Shrink fifo to its initial size and return its chunks to the segment's
+ * chunk freelists. Must be called by the fifo's producer.
+ *
+ * @return 0 if fifo was shrunk, -1 otherwise
+ */
+int
+svm_fifo_segment_shrink_fifo (svm_fifo_segment_private_t * s,
+			      svm_fifo_t * f)
+{
+  ssvm_shared_header_t *sh;
+  svm_fifo_chunk_t *c;
+
+  c = svm_fifo_collect_chunks (f);
+  if (!c)
+    return -1;
+
+  sh = s->ssvm.sh;
+  ssvm_lock_non_recursive (sh, 4);
+  svm_fifo_segment_put_chunks (s->h, c);
+  ssvm_unlock_non_recursive (sh);
+  return 0;
+}
+
 void
 svm_fifo_segment_free_fifo (svm_fifo_segment_private_t * s, svm_fifo_t * f,
 			    svm_fifo_segment_freelist_t list_index)
@@ -433,7 +538,8 @@ svm_fifo_segment_free_fifo (svm_fifo_segment_private_t * s, svm_fifo_t * f,
 
   ASSERT (f->refcnt > 0);
 
-  if (--f->refcnt > 0)
+  /* Spliced sessions may hold references from different threads */
+  if (__sync_sub_and_fetch (&f->refcnt, 1) > 0)
     return;
 
   sh = s->ssvm.sh;
@@ -446,6 +552,10 @@ svm_fifo_segment_free_fifo (svm_fifo_segment_private_t * s, svm_fifo_t * f,
   ssvm_lock_non_recursive (sh, 2);
   oldheap = ssvm_push_heap (sh);
 
+  /* Return the memory fifo has grown by before recycling it */
+  if (PREDICT_FALSE (f->chunks != 0))
+    svm_fifo_segment_put_chunks (fsh, svm_fifo_detach_chunks (f));
+
   switch (list_index)
     {
     case FIFO_SEGMENT_RX_FREELIST:
@@ -566,6 +676,34 @@ svm_fifo_segment_num_free_fifos (svm_fifo_segment_private_t * fifo_segment,
   return count;
 }
 
+u32
+svm_fifo_segment_num_free_chunks (svm_fifo_segment_private_t * fifo_segment,
+				  u32 chunk_size)
+{
+  svm_fifo_segment_header_t *fsh = fifo_segment->h;
+  svm_fifo_chunk_t *c;
+  u32 count = 0, freelist_index;
+  int i;
+
+  /* Count all free chunks? */
+  if (chunk_size == ~0)
+    {
+      for (i = 0; i < vec_len (fsh->free_chunks); i++)
+	for (c = fsh->free_chunks[i]; c; c = c->next)
+	  count++;
+      return count;
+    }
+
+  freelist_index = max_log2 (chunk_size)
+    - max_log2 (FIFO_SEGMENT_MIN_FIFO_SIZE);
+  if (freelist_index >= vec_len (fsh->free_chunks))
+    return 0;
+
+  for (c = fsh->free_chunks[freelist_index]; c; c = c->next)
+    count++;
+  return count;
+}
+
 void
 svm_fifo_segment_info (svm_fifo_segment_private_t * seg, uword * address,
 		       u64 * size)
@@ -619,6 +757,7 @@ format_svm_fifo_segment (u8 * s, va_list * args)
     = va_arg (*args, svm_fifo_segment_private_t *);
   int verbose = va_arg (*args, int);
   svm_fifo_segment_header_t *fsh = sp->h;
+  svm_fifo_chunk_t *c;
   u32 count, indent;
   svm_fifo_t *f;
   int i;
@@ -646,6 +785,20 @@ format_svm_fifo_segment (u8 * s, va_list * args)
 		  1 << (i + max_log2 (FIFO_SEGMENT_MIN_FIFO_SIZE) - 10),
 		  count);
     }
+
+  for (i = 0; i < vec_len (fsh->free_chunks); i++)
+    {
+      if (fsh->free_chunks[i] == 0)
+	continue;
+      count = 0;
+      for (c = fsh->free_chunks[i]; c; c = c->next)
+	count++;
+
+      s = format (s, "%U%-5u Kb: %u free chunks",
+		  format_white_space, indent + 2,
+		  1 << (i + max_log2 (FIFO_SEGMENT_MIN_FIFO_SIZE) - 10),
+		  count);
+    }
   return s;
 }
 
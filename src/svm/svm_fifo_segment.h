@@ -38,6 +38,7 @@ typedef struct
 {
   svm_fifo_t *fifos;		/**< Linked list of active RX fifos */
   svm_fifo_t **free_fifos;	/**< Freelists, by fifo size  */
+  svm_fifo_chunk_t **free_chunks;	/**< Freelists, by chunk size */
   u32 n_active_fifos;		/**< Number of active fifos */
   u8 flags;			/**< Segment flags */
 } svm_fifo_segment_header_t;
@@ -108,11 +109,17 @@ svm_fifo_t *svm_fifo_segment_alloc_fifo (svm_fifo_segment_private_t * s,
 void svm_fifo_segment_free_fifo (svm_fifo_segment_private_t * s,
 				 svm_fifo_t * f,
 				 svm_fifo_segment_freelist_t index);
+int svm_fifo_segment_grow_fifo (svm_fifo_segment_private_t * s,
+				svm_fifo_t * f, u32 chunk_size);
+int svm_fifo_segment_shrink_fifo (svm_fifo_segment_private_t * s,
+				  svm_fifo_t * f);
 void svm_fifo_segment_main_init (u64 baseva, u32 timeout_in_seconds);
 u32 svm_fifo_segment_index (svm_fifo_segment_private_t * s);
 u32 svm_fifo_segment_num_fifos (svm_fifo_segment_private_t * fifo_segment);
 u32 svm_fifo_segment_num_free_fifos (svm_fifo_segment_private_t *
 				     fifo_segment, u32 fifo_size_in_bytes);
+u32 svm_fifo_segment_num_free_chunks (svm_fifo_segment_private_t *
+				      fifo_segment, u32 chunk_size);
 void svm_fifo_segment_info (svm_fifo_segment_private_t * seg, uword * address,
 			    u64 * size);
 
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Out-of-order enqueue stress test and benchmark
+ *
+ * Replays a random-loss pattern against a fifo as a tcp receiver would see
+ * it: segments are lost with a given probability and retransmitted after
+ * a number of other segments have been sent. The receiver enqueues in-order
+ * data at the tail and everything else with an offset, and drains the fifo
+ * after each segment. All dequeued data is validated.
+ */
+
+#include <svm/svm_fifo.h>
+#include <vppinfra/random.h>
+#include <vppinfra/time.h>
+
+#define TEST_PATTERN_PERIOD 251
+
+typedef struct
+{
+  u64 seq;
+  u32 len;
+  u64 due;
+} test_segment_t;
+
+typedef struct
+{
+  u32 fifo_size;
+  u32 mss;
+  u64 total_bytes;
+  f64 loss;
+  u32 rtt;
+  u32 seed;
+  int verbose;
+
+  /* stats */
+  u64 n_segments;
+  u64 n_lost;
+  u64 n_ooo_enqueues;
+  u32 max_ooo_segments;
+  u64 enqueue_clocks;
+} test_ooo_main_t;
+
+static clib_error_t *
+test_ooo_run (test_ooo_main_t * tm)
+{
+  test_segment_t *rtx = 0, *seg, new_seg;
+  u8 *pattern = 0, *rx_buf = 0, *data;
+  u64 rcv_nxt = 0, snd_nxt = 0, now = 0, t0, rx_bytes = 0;
+  u32 rtx_head = 0, seed = tm->seed, n_ooo, i;
+  clib_time_t clib_time;
+  f64 start, elapsed;
+  svm_fifo_t *f;
+  int rv;
+
+  f = svm_fifo_create (tm->fifo_size);
+  if (!f)
+    return clib_error_return (0, "failed to create fifo");
+
+  vec_validate (pattern, TEST_PATTERN_PERIOD + tm->mss - 1);
+  for (i = 0; i < vec_len (pattern); i++)
+    pattern[i] = i % TEST_PATTERN_PERIOD;
+  vec_validate (rx_buf, tm->fifo_size - 1);
+
+  clib_time_init (&clib_time);
+  start = clib_time_now (&clib_time);
+
+  while (rx_bytes < tm->total_bytes)
+    {
+      /* Pick retransmission if due, otherwise send new data in window */
+      if (rtx_head < vec_len (rtx) && (rtx[rtx_head].due <= now
+				       || snd_nxt + tm->mss
+				       > rcv_nxt + tm->fifo_size))
+	{
+	  new_seg = rtx[rtx_head++];
+	  if (rtx_head == vec_len (rtx))
+	    {
+	      vec_reset_length (rtx);
+	      rtx_head = 0;
+	    }
+	}
+      else
+	{
+	  new_seg.seq = snd_nxt;
+	  new_seg.len = clib_min (tm->mss,
+				  rcv_nxt + tm->fifo_size - snd_nxt);
+	  if (new_seg.len == 0)
+	    return clib_error_return (0, "window closed with nothing to "
+				      "retransmit at %llu", rcv_nxt);
+	  snd_nxt += new_seg.len;
+	}
+
+      now++;
+      tm->n_segments++;
+
+      if (random_f64 (&seed) < tm->loss)
+	{
+	  tm->n_lost++;
+	  vec_add2 (rtx, seg, 1);
+	  *seg = new_seg;
+	  seg->due = now + tm->rtt;
+	  continue;
+	}
+
+      /* Old duplicate or partially acked retransmission */
+      if (new_seg.seq + new_seg.len <= rcv_nxt)
+	continue;
+      if (new_seg.seq < rcv_nxt)
+	{
+	  new_seg.len -= rcv_nxt - new_seg.seq;
+	  new_seg.seq = rcv_nxt;
+	}
+
+      data = pattern + new_seg.seq % TEST_PATTERN_PERIOD;
+      t0 = clib_cpu_time_now ();
+      if (new_seg.seq == rcv_nxt)
+	{
+	  rv = svm_fifo_enqueue_nowait (f, new_seg.len, data);
+	  if (rv < 0)
+	    return clib_error_return (0, "enqueue at %llu returned %d",
+				      new_seg.seq, rv);
+	  rcv_nxt += rv;
+	}
+      else
+	{
+	  rv = svm_fifo_enqueue_with_offset (f, new_seg.seq - rcv_nxt,
+					     new_seg.len, data);
+	  if (rv)
+	    return clib_error_return (0, "ooo enqueue at %llu (rcv_nxt "
+				      "%llu) returned %d", new_seg.seq,
+				      rcv_nxt, rv);
+	  tm->n_ooo_enqueues++;
+	}
+      tm->enqueue_clocks += clib_cpu_time_now () - t0;
+
+      n_ooo = svm_fifo_number_ooo_segments (f);
+      tm->max_ooo_segments = clib_max (tm->max_ooo_segments, n_ooo);
+
+      /* Drain and validate */
+      rv = svm_fifo_dequeue_nowait (f, tm->fifo_size, rx_buf);
+      if (rv > 0)
+	{
+	  for (i = 0; i < rv; i++)
+	    if (rx_buf[i] != (rx_bytes + i) % TEST_PATTERN_PERIOD)
+	      return clib_error_return (0, "data mismatch at offset %llu: "
+					"got %u expected %u", rx_bytes + i,
+					rx_buf[i], (rx_bytes + i)
+					% TEST_PATTERN_PERIOD);
+	  rx_bytes += rv;
+	}
+    }
+
+  elapsed = clib_time_now (&clib_time) - start;
+
+  fformat (stdout, "%llu bytes in %llu segments, %llu lost, %llu ooo "
+	   "enqueues, max %u ooo segments\n", rx_bytes, tm->n_segments,
+	   tm->n_lost, tm->n_ooo_enqueues, tm->max_ooo_segments);
+  fformat (stdout, "%.2f clocks/segment enqueue, %.3f Gbps total in "
+	   "%.2f sec\n", (f64) tm->enqueue_clocks / tm->n_segments,
+	   (f64) rx_bytes * 8 / elapsed / 1e9, elapsed);
+
+  svm_fifo_free (f);
+  vec_free (rtx);
+  vec_free (pattern);
+  vec_free (rx_buf);
+  return 0;
+}
+
+int
+test_svm_fifo_ooo (unformat_input_t * input)
+{
+  test_ooo_main_t _tm, *tm = &_tm;
+  clib_error_t *error = 0;
+  f64 loss_pct = 1.0;
+  uword fifo_size = 8 << 20;
+
+  memset (tm, 0, sizeof (*tm));
+  tm->mss = 1460;
+  tm->total_bytes = 1ULL << 30;
+  tm->rtt = 1000;
+  tm->seed = 0xdeadbeef;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "fifo-size %U", unformat_memory_size,
+		    &fifo_size))
+	;
+      else if (unformat (input, "mss %d", &tm->mss))
+	;
+      else if (unformat (input, "total-size %U", unformat_memory_size,
+			 &tm->total_bytes))
+	;
+      else if (unformat (input, "loss %f", &loss_pct))
+	;
+      else if (unformat (input, "rtt %d", &tm->rtt))
+	;
+      else if (unformat (input, "seed %d", &tm->seed))
+	;
+      else if (unformat (input, "verbose"))
+	tm->verbose = 1;
+      else
+	{
+	  error = clib_error_create ("unknown input `%U'\n",
+				     format_unformat_error, input);
+	  goto out;
+	}
+    }
+
+  tm->fifo_size = fifo_size;
+  if (tm->mss == 0 || tm->mss >= tm->fifo_size)
+    {
+      error = clib_error_create ("mss %u must be smaller than fifo size %u",
+				 tm->mss, tm->fifo_size);
+      goto out;
+    }
+
+  tm->loss = loss_pct / 100.0;
+  if (tm->verbose)
+    fformat (stdout, "fifo-size %u mss %u loss %.2f%% rtt %u segments "
+	     "seed %u\n", tm->fifo_size, tm->mss, loss_pct, tm->rtt,
+	     tm->seed);
+
+  error = test_ooo_run (tm);
+
+out:
+  if (error)
+    {
+      clib_error_report (error);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  unformat_input_t i;
+  int r;
+
+  clib_mem_init (0, 256 << 20);
+  unformat_init_command_line (&i, argv);
+  r = test_svm_fifo_ooo (&i);
+  unformat_free (&i);
+  return r;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -13757,6 +13757,7 @@ api_create_vhost_user_if (vat_main_t * vam)
   u32 custom_dev_instance = ~0;
   u8 hwaddr[6];
   u8 use_custom_mac = 0;
+  u8 enable_gso = 0;
   u8 *tag = 0;
   int ret;
 
@@ -13777,6 +13778,8 @@ api_create_vhost_user_if (vat_main_t * vam)
 	is_server = 1;
       else if (unformat (i, "tag %s", &tag))
 	;
+      else if (unformat (i, "gso"))
+	enable_gso = 1;
       else
 	break;
     }
@@ -13806,6 +13809,7 @@ api_create_vhost_user_if (vat_main_t * vam)
     }
   mp->use_custom_mac = use_custom_mac;
   clib_memcpy (mp->mac_address, hwaddr, 6);
+  mp->enable_gso = enable_gso;
   if (tag)
     strncpy ((char *) mp->tag, (char *) tag, ARRAY_LEN (mp->tag) - 1);
   vec_free (tag);
@@ -13826,6 +13830,7 @@ api_modify_vhost_user_if (vat_main_t * vam)
   u32 custom_dev_instance = ~0;
   u8 sw_if_index_set = 0;
   u32 sw_if_index = (u32) ~ 0;
+  u8 enable_gso = 0;
   int ret;
 
   while (unformat_check_input (i) != UNFORMAT_END_OF_INPUT)
@@ -13842,6 +13847,8 @@ api_modify_vhost_user_if (vat_main_t * vam)
 	;
       else if (unformat (i, "server"))
 	is_server = 1;
+      else if (unformat (i, "gso"))
+	enable_gso = 1;
       else
 	break;
     }
@@ -13876,6 +13883,7 @@ api_modify_vhost_user_if (vat_main_t * vam)
       mp->renumber = 1;
       mp->custom_dev_instance = ntohl (custom_dev_instance);
     }
+  mp->enable_gso = enable_gso;
 
   S (mp);
   W (ret);
@@ -19476,6 +19484,7 @@ api_af_packet_create (vat_main_t * vam)
   u8 *host_if_name = 0;
   u8 hw_addr[6];
   u8 random_hw_addr = 1;
+  u32 num_rx_queues = 0;
   int ret;
 
   memset (hw_addr, 0, sizeof (hw_addr));
@@ -19486,6 +19495,8 @@ api_af_packet_create (vat_main_t * vam)
 	vec_add1 (host_if_name, 0);
       else if (unformat (i, "hw_addr %U", unformat_ethernet_address, hw_addr))
 	random_hw_addr = 0;
+      else if (unformat (i, "num_rx_queues %u", &num_rx_queues))
+	;
       else
 	break;
     }
@@ -19507,6 +19518,7 @@ api_af_packet_create (vat_main_t * vam)
   clib_memcpy (mp->host_if_name, host_if_name, vec_len (host_if_name));
   clib_memcpy (mp->hw_addr, hw_addr, 6);
   mp->use_random_hw_addr = random_hw_addr;
+  mp->num_rx_queues = htons (num_rx_queues);
   vec_free (host_if_name);
 
   S (mp);
@@ -23331,10 +23343,10 @@ _(l2_interface_vlan_tag_rewrite,                                        \
   "[translate-2-[1|2]] [push_dot1q 0] tag1 <nn> tag2 <nn>")             \
 _(create_vhost_user_if,                                                 \
         "socket <filename> [server] [renumber <dev_instance>] "         \
-        "[mac <mac_address>]")                                          \
+        "[mac <mac_address>] [gso]")                                    \
 _(modify_vhost_user_if,                                                 \
         "<intfc> | sw_if_index <nn> socket <filename>\n"                \
-        "[server] [renumber <dev_instance>]")                           \
+        "[server] [renumber <dev_instance>] [gso]")                     \
 _(delete_vhost_user_if, "<intfc> | sw_if_index <nn>")                   \
 _(sw_interface_vhost_user_dump, "")                                     \
 _(show_version, "")                                                     \
@@ -23529,7 +23541,8 @@ _(lisp_get_map_request_itr_rlocs, "")                                   \
 _(show_lisp_pitr, "")                                                   \
 _(show_lisp_use_petr, "")                                               \
 _(show_lisp_map_request_mode, "")                                       \
-_(af_packet_create, "name <host interface name> [hw_addr <mac>]")       \
+_(af_packet_create, "name <host interface name> [hw_addr <mac>] "      \
+  "[num_rx_queues <n>]")                                                \
 _(af_packet_delete, "name <host interface name>")                       \
 _(af_packet_dump, "")							\
 _(policer_add_del, "name <policer name> <params> [del]")                \
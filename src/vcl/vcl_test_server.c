@@ -43,6 +43,8 @@ typedef struct
   uint32_t port;
   uint32_t address_ip6;
   uint32_t transport_udp;
+  uint32_t epoll_et;
+  uint32_t epoll_check;
 } sock_server_cfg_t;
 
 #define SOCK_SERVER_MAX_TEST_CONN  10
@@ -266,7 +268,7 @@ new_client (void)
     struct epoll_event ev;
     int rv;
 
-    ev.events = EPOLLIN;
+    ev.events = EPOLLIN | (ssm->cfg.epoll_et ? EPOLLET : 0);
     ev.data.u64 = conn - ssm->conn_pool;
     rv = vppcom_epoll_ctl (ssm->epfd, EPOLL_CTL_ADD, client_fd, &ev);
     if (rv < 0)
@@ -282,6 +284,40 @@ new_client (void)
   }
 }
 
+/*
+ * Wait again for events before reading the ones reported for a connection.
+ * Its data is still pending, so a level-triggered session must be reported
+ * again while an edge-triggered one must not, as no new data arrived. Only
+ * meaningful with a single client connection in lockstep, i.e., echo tests.
+ */
+static int
+epoll_check_rearm (sock_server_conn_t * conn)
+{
+  sock_server_main_t *ssm = &sock_server_main;
+  struct epoll_event wait_events[SOCK_SERVER_MAX_EPOLL_EVENTS];
+  uint32_t conn_index = conn - ssm->conn_pool;
+  int i, num_ev, reported = 0;
+
+  num_ev = vppcom_epoll_wait (ssm->epfd, wait_events,
+			      SOCK_SERVER_MAX_EPOLL_EVENTS,
+			      ssm->cfg.epoll_et ? 0.1 : 1.0);
+  if (num_ev < 0)
+    return num_ev;
+  for (i = 0; i < num_ev; i++)
+    if ((wait_events[i].data.u32 == conn_index)
+	&& (EPOLLIN & wait_events[i].events))
+      reported = 1;
+
+  if (reported != ssm->cfg.epoll_et)
+    return 0;
+
+  fprintf (stderr, "SERVER: ERROR: %s-triggered session (fd %d) was %s"
+	   "reported again before it was read!\n",
+	   ssm->cfg.epoll_et ? "edge" : "level", conn->fd,
+	   reported ? "" : "not ");
+  return -1;
+}
+
 void
 print_usage_and_exit (void)
 {
@@ -290,7 +326,10 @@ print_usage_and_exit (void)
 	   "  OPTIONS\n"
 	   "  -h               Print this message and exit.\n"
 	   "  -6               Use IPv6\n"
-	   "  -u               Use UDP transport layer\n");
+	   "  -u               Use UDP transport layer\n"
+	   "  -e               Register client sessions edge-triggered\n"
+	   "  -C               Check that unread level-triggered events\n"
+	   "                   are reported again, edge-triggered ones not\n");
   exit (1);
 }
 
@@ -311,7 +350,7 @@ main (int argc, char **argv)
   vppcom_endpt_t endpt;
 
   opterr = 0;
-  while ((c = getopt (argc, argv, "6D")) != -1)
+  while ((c = getopt (argc, argv, "6DeC")) != -1)
     switch (c)
       {
       case '6':
@@ -322,6 +361,14 @@ main (int argc, char **argv)
 	ssm->cfg.transport_udp = 1;
 	break;
 
+      case 'e':
+	ssm->cfg.epoll_et = 1;
+	break;
+
+      case 'C':
+	ssm->cfg.epoll_check = 1;
+	break;
+
       case '?':
 	switch (optopt)
 	  {
@@ -492,6 +539,11 @@ main (int argc, char **argv)
 
 	  if (EPOLLIN & ssm->wait_events[i].events)
 	    {
+	      if (ssm->cfg.epoll_check && epoll_check_rearm (conn))
+		{
+		  main_rv = -1;
+		  goto done;
+		}
 	      rx_bytes = vcl_test_read (client_fd, conn->buf,
 					conn->buf_size, &conn->stats);
 	      if (rx_bytes > 0)
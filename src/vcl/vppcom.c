@@ -88,9 +88,10 @@ typedef struct
   u32 prev_sid;
   u32 vep_idx;
   vppcom_epoll_event_t ev;
-#define VEP_DEFAULT_ET_MASK  (EPOLLIN|EPOLLOUT)
 #define VEP_UNSUPPORTED_EVENTS (EPOLLONESHOT|EPOLLEXCLUSIVE)
-  u32 et_mask;
+  u8 is_ready;			// session is on its vep's ready list
+  u32 ready_index;		// position in its vep's ready list
+  u32 *ready_sids;		// vep only: sessions with pending events
 } vppcom_epoll_t;
 
 typedef struct
@@ -150,7 +151,6 @@ typedef struct
   u8 is_vep;
   u8 is_vep_session;
   u32 attr;
-  u32 wait_cont_idx;
   vppcom_epoll_t vep;
   int libc_epfd;
   vppcom_ip46_t lcl_addr;
@@ -205,13 +205,22 @@ typedef struct vppcom_main_t_
 
   /* API client handle */
   u32 my_client_index;
-  /* Session pool */
+  /*
+   * Session pool, shared by all app threads under one lock. Epoll wait
+   * takes the lock once per pass over its ready list, not once per
+   * registered session. Per-thread workers with private session tables,
+   * which would remove this lock, are separate work: they first need the
+   * session layer to give an app one event queue per worker.
+   */
   clib_spinlock_t sessions_lockp;
   session_t *sessions;
 
   /* Hash table for disconnect processing */
   uword *session_index_by_vpp_handles;
 
+  /* Scratch vector of sessions re-armed by epoll wait */
+  u32 *vep_rearm_sids;
+
   /* Select bitmaps */
   clib_bitmap_t *rd_bitmap;
   clib_bitmap_t *wr_bitmap;
@@ -380,6 +389,95 @@ vppcom_session_at_index (u32 session_index, session_t * volatile *sess)
   return VPPCOM_OK;
 }
 
+/*
+ * Queue session on its vep's ready list. Sessions are only ever evaluated
+ * by vppcom_epoll_wait() once they make it to a ready list, so all events
+ * that could change a session's readiness must end up here.
+ */
+static inline void
+vep_session_mark_ready (u32 session_index)
+{
+  session_t *session, *vep_session;
+
+  /* Assumes caller has acquired spinlock: vcm->sessions_lockp */
+  if (PREDICT_FALSE (pool_is_free_index (vcm->sessions, session_index)))
+    return;
+  session = pool_elt_at_index (vcm->sessions, session_index);
+  if (!session->is_vep_session || session->vep.is_ready)
+    return;
+  if (PREDICT_FALSE (pool_is_free_index (vcm->sessions,
+					 session->vep.vep_idx)))
+    return;
+  vep_session = pool_elt_at_index (vcm->sessions, session->vep.vep_idx);
+  session->vep.ready_index = vec_len (vep_session->vep.ready_sids);
+  vec_add1 (vep_session->vep.ready_sids, session_index);
+  session->vep.is_ready = 1;
+}
+
+static inline void
+vep_session_unmark_ready (session_t * vep_session, session_t * session,
+			  u32 session_index)
+{
+  u32 *ready_sids = vep_session->vep.ready_sids;
+  u32 i, last;
+  session_t *moved;
+
+  /* Assumes caller has acquired spinlock: vcm->sessions_lockp */
+  if (!session->vep.is_ready)
+    return;
+
+  /* Last session on the list takes the removed one's place */
+  i = session->vep.ready_index;
+  last = vec_len (ready_sids) - 1;
+  ASSERT (ready_sids[i] == session_index);
+  if (i != last)
+    {
+      ready_sids[i] = ready_sids[last];
+      moved = pool_elt_at_index (vcm->sessions, ready_sids[i]);
+      moved->vep.ready_index = i;
+    }
+  _vec_len (ready_sids) = last;
+  session->vep.is_ready = 0;
+}
+
+/*
+ * Drain app event queue and move sessions with new rx data, or with tx
+ * fifo space freed by vpp, to the ready lists of their veps
+ */
+static void
+vppcom_dispatch_app_events (void)
+{
+  svm_queue_t *q = vcm->app_event_queue;
+  session_fifo_event_t e;
+  u32 i, n_to_dequeue;
+
+  /* Assumes caller has acquired spinlock: vcm->sessions_lockp */
+  if (!q->cursize || pthread_mutex_trylock (&q->mutex))
+    return;
+
+  n_to_dequeue = q->cursize;
+  for (i = 0; i < n_to_dequeue; i++)
+    {
+      svm_queue_sub_raw (q, (u8 *) & e);
+      switch (e.event_type)
+	{
+	case FIFO_EVENT_APP_RX:
+	  /* Let vpp know it should send new events for this fifo */
+	  svm_fifo_unset_event (e.fifo);
+	  vep_session_mark_ready (e.fifo->client_session_index);
+	  break;
+	case FIFO_EVENT_APP_TX:
+	  /* Vpp freed tx fifo space we asked to be told about */
+	  vep_session_mark_ready (e.fifo->client_session_index);
+	  break;
+	default:
+	  break;
+	}
+    }
+
+  pthread_mutex_unlock (&q->mutex);
+}
+
 static inline void
 vppcom_session_table_add_listener (u64 listener_handle, u32 value)
 {
@@ -877,6 +975,7 @@ vl_api_disconnect_session_t_handler (vl_api_disconnect_session_t * mp)
 
       VCL_SESSION_LOCK_AND_GET (session_index, &session);
       session->state = STATE_CLOSE_ON_EMPTY;
+      vep_session_mark_ready (session_index);
 
       if (VPPCOM_DEBUG > 1)
 	clib_warning ("VCL<%d>: vpp handle 0x%llx, sid %u: "
@@ -925,6 +1024,7 @@ vl_api_reset_session_t_handler (vl_api_reset_session_t * mp)
 	   * flush the fifos?
 	   */
 	  session->state = STATE_CLOSE_ON_EMPTY;
+	  vep_session_mark_ready (p[0]);
 
 	  if (VPPCOM_DEBUG > 1)
 	    clib_warning ("VCL<%d>: vpp handle 0x%llx, sid %u: "
@@ -2478,6 +2578,8 @@ vppcom_session_close (uint32_t session_index)
       if (p)
 	hash_unset (vcm->session_index_by_vpp_handles, vpp_handle);
     }
+  if (is_vep)
+    vec_free (session->vep.ready_sids);
   pool_put_index (vcm->sessions, session_index);
 
   VCL_SESSION_UNLOCK ();
@@ -2993,7 +3095,6 @@ vppcom_session_read_internal (uint32_t session_index, void *buf, int n,
   int is_nonblocking;
 
   u64 vpp_handle;
-  u32 poll_et;
   session_state_t state;
 
   ASSERT (buf);
@@ -3039,15 +3140,23 @@ vppcom_session_read_internal (uint32_t session_index, void *buf, int n,
     }
   while (!is_nonblocking && (n_read <= 0));
 
+  /* Fifo drained, make sure vpp notifies us of new data. Anything enqueued
+   * before the flag was cleared would go unnoticed, so check again */
+  if (!peek && svm_fifo_max_dequeue (rx_fifo) == 0)
+    {
+      svm_fifo_unset_event (rx_fifo);
+      if (PREDICT_FALSE (svm_fifo_max_dequeue (rx_fifo)))
+	{
+	  VCL_SESSION_LOCK ();
+	  vep_session_mark_ready (session_index);
+	  VCL_SESSION_UNLOCK ();
+	}
+    }
+
   if (n_read <= 0)
     {
       VCL_SESSION_LOCK_AND_GET (session_index, &session);
 
-      poll_et = (((EPOLLET | EPOLLIN) & session->vep.ev.events) ==
-		 (EPOLLET | EPOLLIN));
-      if (poll_et)
-	session->vep.et_mask |= EPOLLIN;
-
       if (state & STATE_CLOSE_ON_EMPTY)
 	{
 	  rv = VPPCOM_ECONNRESET;
@@ -3105,7 +3214,6 @@ static inline int
 vppcom_session_read_ready (session_t * session, u32 session_index)
 {
   int ready = 0;
-  u32 poll_et;
   int rv;
   session_state_t state = session->state;
   u64 vpp_handle = session->vpp_handle;
@@ -3119,6 +3227,9 @@ vppcom_session_read_ready (session_t * session, u32 session_index)
       goto done;
     }
 
+  /* Poll, select and ioctl users may never call epoll wait */
+  vppcom_dispatch_app_events ();
+
   if (session->state & STATE_LISTEN)
     {
       VCL_ACCEPT_FIFO_LOCK ();
@@ -3146,11 +3257,6 @@ vppcom_session_read_ready (session_t * session, u32 session_index)
 
   if (ready == 0)
     {
-      poll_et =
-	((EPOLLET | EPOLLIN) & session->vep.ev.events) == (EPOLLET | EPOLLIN);
-      if (poll_et)
-	session->vep.et_mask |= EPOLLIN;
-
       if (state & STATE_CLOSE_ON_EMPTY)
 	{
 	  rv = VPPCOM_ECONNRESET;
@@ -3173,17 +3279,6 @@ vppcom_session_read_ready (session_t * session, u32 session_index)
     }
   rv = ready;
 
-  if (vcm->app_event_queue->cursize &&
-      !pthread_mutex_trylock (&vcm->app_event_queue->mutex))
-    {
-      u32 i, n_to_dequeue = vcm->app_event_queue->cursize;
-      session_fifo_event_t e;
-
-      for (i = 0; i < n_to_dequeue; i++)
-	svm_queue_sub_raw (vcm->app_event_queue, (u8 *) & e);
-
-      pthread_mutex_unlock (&vcm->app_event_queue->mutex);
-    }
 done:
   return rv;
 }
@@ -3197,7 +3292,6 @@ vppcom_session_write (uint32_t session_index, void *buf, size_t n)
   session_fifo_event_t evt;
   session_state_t state;
   int rv, n_write, is_nonblocking;
-  u32 poll_et;
   u64 vpp_handle;
 
   ASSERT (buf);
@@ -3271,10 +3365,9 @@ vppcom_session_write (uint32_t session_index, void *buf, size_t n)
     {
       VCL_SESSION_LOCK_AND_GET (session_index, &session);
 
-      poll_et = (((EPOLLET | EPOLLOUT) & session->vep.ev.events) ==
-		 (EPOLLET | EPOLLOUT));
-      if (poll_et)
-	session->vep.et_mask |= EPOLLOUT;
+      /* Epoll wait asks vpp for a tx event if there is still no space */
+      if (EPOLLOUT & session->vep.ev.events)
+	vep_session_mark_ready (session_index);
 
       if (session->state & STATE_CLOSE_ON_EMPTY)
 	{
@@ -3322,7 +3415,6 @@ static inline int
 vppcom_session_write_ready (session_t * session, u32 session_index)
 {
   int ready;
-  u32 poll_et;
   int rv;
 
   ASSERT (session);
@@ -3371,11 +3463,6 @@ vppcom_session_write_ready (session_t * session, u32 session_index)
 
   if (ready == 0)
     {
-      poll_et = (((EPOLLET | EPOLLOUT) & session->vep.ev.events) ==
-		 (EPOLLET | EPOLLOUT));
-      if (poll_et)
-	session->vep.et_mask |= EPOLLOUT;
-
       if (session->state & STATE_CLOSE_ON_EMPTY)
 	{
 	  rv = VPPCOM_ECONNRESET;
@@ -3441,6 +3528,11 @@ vppcom_select (unsigned long n_bits, unsigned long *read_map,
 
   do
     {
+      /* Keep the app event queue drained for epoll's sake */
+      VCL_SESSION_LOCK ();
+      vppcom_dispatch_app_events ();
+      VCL_SESSION_UNLOCK ();
+
       /* *INDENT-OFF* */
       if (n_bits)
         {
@@ -3594,11 +3686,10 @@ vep_verify_epoll_chain (u32 vep_idx)
 		"   is_vep         = %u\n"
 		"   is_vep_session = %u\n"
 		"   next_sid       = 0x%x (%u)\n"
-		"   wait_cont_idx  = 0x%x (%u)\n"
+		"   ready_sids     = %u\n"
 		"}\n", getpid (), vep_idx,
 		session->is_vep, session->is_vep_session,
-		vep->next_sid, vep->next_sid,
-		session->wait_cont_idx, session->wait_cont_idx);
+		vep->next_sid, vep->next_sid, vec_len (vep->ready_sids));
 
   for (sid = vep->next_sid; sid != ~0; sid = vep->next_sid)
     {
@@ -3631,13 +3722,13 @@ vep_verify_epoll_chain (u32 vep_idx)
 			"   vep_idx        = 0x%x (%u)\n"
 			"   ev.events      = 0x%x\n"
 			"   ev.data.u64    = 0x%llx\n"
-			"   et_mask        = 0x%x\n"
+			"   is_ready       = %u\n"
 			"}\n",
 			vep_idx, sid, sid,
 			vep->next_sid, vep->next_sid,
 			vep->prev_sid, vep->prev_sid,
 			vep->vep_idx, vep->vep_idx,
-			vep->ev.events, vep->ev.data.u64, vep->et_mask);
+			vep->ev.events, vep->ev.data.u64, vep->is_ready);
 	}
     }
 
@@ -3662,7 +3753,6 @@ vppcom_epoll_create (void)
   vep_session->vep.vep_idx = ~0;
   vep_session->vep.next_sid = ~0;
   vep_session->vep.prev_sid = ~0;
-  vep_session->wait_cont_idx = ~0;
   vep_session->vpp_handle = ~0;
   vep_session->poll_reg = 0;
 
@@ -3780,11 +3870,12 @@ vppcom_epoll_ctl (uint32_t vep_idx, int op, uint32_t session_index,
       session->vep.next_sid = vep_session->vep.next_sid;
       session->vep.prev_sid = vep_idx;
       session->vep.vep_idx = vep_idx;
-      session->vep.et_mask = VEP_DEFAULT_ET_MASK;
       session->vep.ev = *event;
+      session->vep.is_ready = 0;
       session->is_vep = 0;
       session->is_vep_session = 1;
       vep_session->vep.next_sid = session_index;
+      vep_session_mark_ready (session_index);
 
       /* VCL Event Register handler */
       if (session->state & STATE_LISTEN)
@@ -3849,8 +3940,8 @@ vppcom_epoll_ctl (uint32_t vep_idx, int op, uint32_t session_index,
 	  rv = VPPCOM_EINVAL;
 	  goto done;
 	}
-      session->vep.et_mask = VEP_DEFAULT_ET_MASK;
       session->vep.ev = *event;
+      vep_session_mark_ready (session_index);
       if (VPPCOM_DEBUG > 1)
 	clib_warning
 	  ("VCL<%d>: EPOLL_CTL_MOD: vep_idx %u, sid %u, events 0x%x,"
@@ -3883,9 +3974,7 @@ vppcom_epoll_ctl (uint32_t vep_idx, int op, uint32_t session_index,
 					 vep_session->poll_reg);
 	}
 
-      vep_session->wait_cont_idx =
-	(vep_session->wait_cont_idx == session_index) ?
-	session->vep.next_sid : vep_session->wait_cont_idx;
+      vep_session_unmark_ready (vep_session, session, session_index);
 
       if (session->vep.prev_sid == vep_idx)
 	vep_session->vep.next_sid = session->vep.next_sid;
@@ -3962,13 +4051,13 @@ int
 vppcom_epoll_wait (uint32_t vep_idx, struct epoll_event *events,
 		   int maxevents, double wait_for_time)
 {
-  session_t *vep_session;
+  session_t *vep_session, *session;
   elog_track_t vep_elog_track;
   int rv;
   f64 timeout = clib_time_now (&vcm->clib_time) + wait_for_time;
   u32 keep_trying = 1;
   int num_ev = 0;
-  u32 vep_next_sid, wait_cont_idx;
+  u32 vep_next_sid;
   u8 is_vep;
 
   if (PREDICT_FALSE (maxevents <= 0))
@@ -3982,7 +4071,6 @@ vppcom_epoll_wait (uint32_t vep_idx, struct epoll_event *events,
   VCL_SESSION_LOCK_AND_GET (vep_idx, &vep_session);
   vep_next_sid = vep_session->vep.next_sid;
   is_vep = vep_session->is_vep;
-  wait_cont_idx = vep_session->wait_cont_idx;
   vep_elog_track = vep_session->elog_track;
   VCL_SESSION_UNLOCK ();
 
@@ -4019,114 +4107,50 @@ vppcom_epoll_wait (uint32_t vep_idx, struct epoll_event *events,
       goto done;
     }
 
+  /*
+   * Only sessions on the vep's ready list are looked at, so the cost of a
+   * wait is proportional to the number of pending events, not to the
+   * number of sessions registered. Sessions make it to the list when vpp
+   * signals new rx data, when their state changes or, once they asked for
+   * it with want_tx_evt, when vpp frees space in their tx fifo.
+   * Level-triggered sessions found ready are moved to the back of the list
+   * and are reported again until drained. Edge-triggered sessions are only
+   * reported once per event.
+   */
   do
     {
-      u32 sid;
-      u32 next_sid = ~0;
-      session_t *session;
-      elog_track_t session_elog_track;
-
-      for (sid = (wait_cont_idx == ~0) ? vep_next_sid : wait_cont_idx;
-	   sid != ~0; sid = next_sid)
-	{
-	  u32 session_events, et_mask, clear_et_mask, session_vep_idx;
-	  u8 add_event, is_vep_session;
-	  int ready;
-	  u64 session_ev_data;
-
-	  VCL_SESSION_LOCK_AND_GET (sid, &session);
-	  next_sid = session->vep.next_sid;
-	  session_events = session->vep.ev.events;
-	  et_mask = session->vep.et_mask;
-	  is_vep = session->is_vep;
-	  is_vep_session = session->is_vep_session;
-	  session_vep_idx = session->vep.vep_idx;
-	  session_ev_data = session->vep.ev.data.u64;
+      u32 i, sid, n_ready, session_events;
+      u8 add_event, rearm;
+      int ready;
 
-	  if (VPPCOM_DEBUG > 0)
-	    {
-	      session_elog_track = session->elog_track;
-	    }
+      VCL_SESSION_LOCK ();
+      vppcom_dispatch_app_events ();
 
+      rv = vppcom_session_at_index (vep_idx, &vep_session);
+      if (PREDICT_FALSE (rv))
+	{
 	  VCL_SESSION_UNLOCK ();
+	  goto done;
+	}
 
-	  if (PREDICT_FALSE (is_vep))
-	    {
-	      if (VPPCOM_DEBUG > 0)
-		clib_warning ("VCL<%d>: ERROR: sid (%u) is a vep!",
-			      getpid (), vep_idx);
-	      if (VPPCOM_DEBUG > 0)
-		{
-                  /* *INDENT-OFF* */
-		  ELOG_TYPE_DECLARE (e) =
-		    {
-		      .format = "ERR:vep_idx:%d is vep",
-		      .format_args = "i4",
-		    };
-		  struct
-		  {
-		    u32 data;
-		  } *ed;
-
-		  ed = ELOG_TRACK_DATA (&vcm->elog_main, e, session_elog_track);
-
-		  ed->data = vep_idx;
-		  /* *INDENT-ON* */
-		}
-
-	      rv = VPPCOM_EINVAL;
-	      goto done;
-	    }
-	  if (PREDICT_FALSE (!is_vep_session))
-	    {
-	      if (VPPCOM_DEBUG > 0)
-		clib_warning ("VCL<%d>: ERROR: session (%u) is not "
-			      "a vep session!", getpid (), sid);
-	      if (VPPCOM_DEBUG > 0)
-		{
-                  /* *INDENT-OFF* */
-		  ELOG_TYPE_DECLARE (e) =
-		    {
-		      .format = "ERR:SID:%d not vep",
-		      .format_args = "i4",
-		    };
-		  struct
-		  {
-		    u32 data;
-		  } *ed;
-
-		  ed = ELOG_TRACK_DATA (&vcm->elog_main, e, session_elog_track);
-
-		  ed->data = sid;
-		  /* *INDENT-ON* */
-		}
-
-	      rv = VPPCOM_EINVAL;
-	      goto done;
-	    }
-	  if (PREDICT_FALSE (session_vep_idx != vep_idx))
-	    {
-	      clib_warning ("VCL<%d>: ERROR: session (%u) "
-			    "vep_idx (%u) != vep_idx (%u)!",
-			    getpid (), sid, session_vep_idx, vep_idx);
-	      rv = VPPCOM_EINVAL;
-	      goto done;
-	    }
+      vec_reset_length (vcm->vep_rearm_sids);
+      n_ready = vec_len (vep_session->vep.ready_sids);
 
-	  add_event = clear_et_mask = 0;
+      for (i = 0; i < n_ready && num_ev < maxevents; i++)
+	{
+	  sid = vep_session->vep.ready_sids[i];
+	  session = pool_elt_at_index (vcm->sessions, sid);
+	  session_events = session->vep.ev.events;
+	  add_event = rearm = 0;
 
 	  if (EPOLLIN & session_events)
 	    {
-	      VCL_SESSION_LOCK_AND_GET (sid, &session);
 	      ready = vppcom_session_read_ready (session, sid);
-	      VCL_SESSION_UNLOCK ();
-	      if ((ready > 0) && (EPOLLIN & et_mask))
+	      if (ready > 0)
 		{
 		  add_event = 1;
 		  events[num_ev].events |= EPOLLIN;
-		  if (((EPOLLET | EPOLLIN) & session_events) ==
-		      (EPOLLET | EPOLLIN))
-		    clear_et_mask |= EPOLLIN;
+		  rearm = !(EPOLLET & session_events);
 		}
 	      else if (ready < 0)
 		{
@@ -4146,16 +4170,20 @@ vppcom_epoll_wait (uint32_t vep_idx, struct epoll_event *events,
 
 	  if (EPOLLOUT & session_events)
 	    {
-	      VCL_SESSION_LOCK_AND_GET (sid, &session);
 	      ready = vppcom_session_write_ready (session, sid);
-	      VCL_SESSION_UNLOCK ();
-	      if ((ready > 0) && (EPOLLOUT & et_mask))
+	      if (ready == 0)
+		{
+		  /* Have vpp send an event once it frees tx fifo space.
+		   * Space freed before it saw the request would go
+		   * unnoticed, so check again */
+		  svm_fifo_set_want_tx_evt (session->tx_fifo);
+		  ready = vppcom_session_write_ready (session, sid);
+		}
+	      if (ready > 0)
 		{
 		  add_event = 1;
 		  events[num_ev].events |= EPOLLOUT;
-		  if (((EPOLLET | EPOLLOUT) & session_events) ==
-		      (EPOLLET | EPOLLOUT))
-		    clear_et_mask |= EPOLLOUT;
+		  rearm |= !(EPOLLET & session_events);
 		}
 	      else if (ready < 0)
 		{
@@ -4175,41 +4203,37 @@ vppcom_epoll_wait (uint32_t vep_idx, struct epoll_event *events,
 
 	  if (add_event)
 	    {
-	      events[num_ev].data.u64 = session_ev_data;
+	      events[num_ev].data.u64 = session->vep.ev.data.u64;
 	      if (EPOLLONESHOT & session_events)
 		{
-		  VCL_SESSION_LOCK_AND_GET (sid, &session);
 		  session->vep.ev.events = 0;
-		  VCL_SESSION_UNLOCK ();
+		  rearm = 0;
 		}
 	      num_ev++;
-	      if (num_ev == maxevents)
-		{
-		  VCL_SESSION_LOCK_AND_GET (vep_idx, &vep_session);
-		  vep_session->wait_cont_idx = next_sid;
-		  VCL_SESSION_UNLOCK ();
-		  goto done;
-		}
-	    }
-	  if (wait_cont_idx != ~0)
-	    {
-	      if (next_sid == ~0)
-		next_sid = vep_next_sid;
-	      else if (next_sid == wait_cont_idx)
-		next_sid = ~0;
 	    }
+
+	  if (rearm)
+	    vec_add1 (vcm->vep_rearm_sids, sid);
+	  else
+	    session->vep.is_ready = 0;
+	}
+
+      /* Sessions not yet looked at stay first in line */
+      vec_delete (vep_session->vep.ready_sids, i, 0);
+      vec_append (vep_session->vep.ready_sids, vcm->vep_rearm_sids);
+      for (i = 0; i < vec_len (vep_session->vep.ready_sids); i++)
+	{
+	  sid = vep_session->vep.ready_sids[i];
+	  session = pool_elt_at_index (vcm->sessions, sid);
+	  session->vep.ready_index = i;
 	}
+      VCL_SESSION_UNLOCK ();
+
       if (wait_for_time != -1)
 	keep_trying = (clib_time_now (&vcm->clib_time) <= timeout) ? 1 : 0;
     }
   while ((num_ev == 0) && keep_trying);
 
-  if (wait_cont_idx != ~0)
-    {
-      VCL_SESSION_LOCK_AND_GET (vep_idx, &vep_session);
-      vep_session->wait_cont_idx = ~0;
-      VCL_SESSION_UNLOCK ();
-    }
 done:
   return (rv != VPPCOM_OK) ? rv : num_ev;
 }
@@ -5842,6 +5866,10 @@ vce_poll_wait_connect_request_handler_fn (void *arg)
 		  ecr->accepted_session_index);
   VCL_ACCEPT_FIFO_UNLOCK ();
 
+  VCL_SESSION_LOCK ();
+  vep_session_mark_ready (ev->evk.session_index);
+  VCL_SESSION_UNLOCK ();
+
   /* Recycling the event. */
   VCL_EVENTS_LOCK ();
   ev->recycle = 1;
@@ -64,7 +64,8 @@
   _(16, L4_HDR_OFFSET_VALID, 0)				\
   _(17, FLOW_REPORT, "flow-report")			\
   _(18, IS_DVR, "dvr")                                  \
-  _(19, QOS_DATA_VALID, 0)
+  _(19, QOS_DATA_VALID, 0)				\
+  _(20, GSO, "gso")
 
 #define VNET_BUFFER_FLAGS_VLAN_BITS \
   (VNET_BUFFER_F_VLAN_1_DEEP | VNET_BUFFER_F_VLAN_2_DEEP)
@@ -373,7 +374,12 @@ typedef struct
     u8 source;
   } qos;
 
-  u8 __unused[2];
+  /**
+   * TCP segment size of a GSO packet, valid when VNET_BUFFER_F_GSO is
+   * set. The egress device, or the interface-output node in software,
+   * cuts the payload into chunks of this size.
+   */
+  u16 gso_size;
 
   /* Group Based Policy */
   struct
@@ -19,6 +19,7 @@
 
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 #include <sys/ioctl.h>
 #include <net/if.h>
 #include <dirent.h>
@@ -44,13 +45,21 @@ af_packet_main_t af_packet_main;
 #define AF_PACKET_TX_BLOCK_SIZE	 	(AF_PACKET_TX_FRAME_SIZE * \
 					 AF_PACKET_TX_FRAMES_PER_BLOCK)
 
-#define AF_PACKET_RX_FRAMES_PER_BLOCK	1024
+/*
+ * The rx ring is TPACKET_V3: the kernel packs packets back to back into
+ * blocks and hands over a block at a time, once it is full or its retire
+ * timeout (in ms) expires. The frame size only bounds the frame count
+ * the kernel checks tp_frame_nr against.
+ */
+#define AF_PACKET_RX_BLOCK_SIZE		(1 << 18)
+#define AF_PACKET_RX_BLOCK_NR		32
 #define AF_PACKET_RX_FRAME_SIZE	 	(2048 * 5)
-#define AF_PACKET_RX_BLOCK_NR		1
 #define AF_PACKET_RX_FRAME_NR		(AF_PACKET_RX_BLOCK_NR * \
-					 AF_PACKET_RX_FRAMES_PER_BLOCK)
-#define AF_PACKET_RX_BLOCK_SIZE		(AF_PACKET_RX_FRAME_SIZE * \
-					 AF_PACKET_RX_FRAMES_PER_BLOCK)
+					 (AF_PACKET_RX_BLOCK_SIZE / \
+					  AF_PACKET_RX_FRAME_SIZE))
+#define AF_PACKET_RX_BLOCK_RETIRE_TOV	1
+
+#define AF_PACKET_MAX_RX_QUEUES		64
 
 /*defined in net/if.h but clashes with dpdk headers */
 unsigned int if_nametoindex (const char *ifname);
@@ -92,14 +101,15 @@ af_packet_fd_read_ready (clib_file_t * uf)
 {
   af_packet_main_t *apm = &af_packet_main;
   vnet_main_t *vnm = vnet_get_main ();
-  u32 idx = uf->private_data;
+  u32 idx = uf->private_data >> 16;
+  u16 qid = uf->private_data & 0xffff;
   af_packet_if_t *apif = pool_elt_at_index (apm->interfaces, idx);
 
   apm->pending_input_bitmap =
     clib_bitmap_set (apm->pending_input_bitmap, idx, 1);
 
   /* Schedule the rx node */
-  vnet_device_input_set_interrupt_pending (vnm, apif->hw_if_index, 0);
+  vnet_device_input_set_interrupt_pending (vnm, apif->hw_if_index, qid);
 
   return 0;
 }
@@ -124,16 +134,11 @@ is_bridge (const u8 * host_if_name)
 }
 
 static int
-create_packet_v2_sock (int host_if_index, tpacket_req_t * rx_req,
-		       tpacket_req_t * tx_req, int *fd, u8 ** ring)
+create_packet_sock (int host_if_index, int ver, int is_tx, int *fd)
 {
   af_packet_main_t *apm = &af_packet_main;
   int ret, err;
   struct sockaddr_ll sll;
-  int ver = TPACKET_V2;
-  socklen_t req_sz = sizeof (struct tpacket_req);
-  u32 ring_sz = rx_req->tp_block_size * rx_req->tp_block_nr +
-    tx_req->tp_block_size * tx_req->tp_block_nr;
 
   if ((*fd = socket (AF_PACKET, SOCK_RAW, htons (ETH_P_ALL))) < 0)
     {
@@ -142,6 +147,25 @@ create_packet_v2_sock (int host_if_index, tpacket_req_t * rx_req,
       goto error;
     }
 
+  /*
+   * the tx socket has no rx ring, so have the kernel drop what it
+   * would otherwise queue on it
+   */
+  if (is_tx)
+    {
+      struct sock_filter drop_all = BPF_STMT (BPF_RET | BPF_K, 0);
+      struct sock_fprog prog = {.len = 1,.filter = &drop_all };
+
+      if ((err = setsockopt (*fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+			     sizeof (prog))) < 0)
+	{
+	  vlib_log_debug (apm->log_class,
+			  "Failed to attach tx packet socket filter");
+	  ret = VNET_API_ERROR_SYSCALL_ERROR_1;
+	  goto error;
+	}
+    }
+
   /* bind before rx ring is cfged so we don't receive packets from other interfaces */
   memset (&sll, 0, sizeof (sll));
   sll.sll_family = PF_PACKET;
@@ -150,7 +174,7 @@ create_packet_v2_sock (int host_if_index, tpacket_req_t * rx_req,
   if ((err = bind (*fd, (struct sockaddr *) &sll, sizeof (sll))) < 0)
     {
       vlib_log_debug (apm->log_class,
-		      "Failed to bind rx packet socket (error %d)", err);
+		      "Failed to bind packet socket (error %d)", err);
       ret = VNET_API_ERROR_SYSCALL_ERROR_1;
       goto error;
     }
@@ -159,65 +183,152 @@ create_packet_v2_sock (int host_if_index, tpacket_req_t * rx_req,
        setsockopt (*fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof (ver))) < 0)
     {
       vlib_log_debug (apm->log_class,
-		      "Failed to set rx packet interface version");
+		      "Failed to set packet interface version");
       ret = VNET_API_ERROR_SYSCALL_ERROR_1;
       goto error;
     }
 
-  int opt = 1;
-  if ((err =
-       setsockopt (*fd, SOL_PACKET, PACKET_LOSS, &opt, sizeof (opt))) < 0)
+  return 0;
+error:
+  if (*fd >= 0)
+    close (*fd);
+  *fd = -1;
+  return ret;
+}
+
+static int
+create_packet_v3_rx_sock (int host_if_index, struct tpacket_req3 *rx_req,
+			  u32 fanout, int *fd, u8 ** ring)
+{
+  af_packet_main_t *apm = &af_packet_main;
+  int ret, err;
+  u32 ring_sz = rx_req->tp_block_size * rx_req->tp_block_nr;
+  u8 *r;
+
+  if ((ret = create_packet_sock (host_if_index, TPACKET_V3, 0, fd)))
+    return ret;
+
+  if ((err = setsockopt (*fd, SOL_PACKET, PACKET_RX_RING, rx_req,
+			 sizeof (*rx_req))) < 0)
     {
-      vlib_log_debug (apm->log_class,
-		      "Failed to set packet tx ring error handling option");
+      vlib_log_debug (apm->log_class, "Failed to set packet rx ring options");
       ret = VNET_API_ERROR_SYSCALL_ERROR_1;
       goto error;
     }
 
-  if ((err =
-       setsockopt (*fd, SOL_PACKET, PACKET_RX_RING, rx_req, req_sz)) < 0)
+  r = mmap (NULL, ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+	    *fd, 0);
+  if (r == MAP_FAILED)
     {
-      vlib_log_debug (apm->log_class, "Failed to set packet rx ring options");
+      vlib_log_debug (apm->log_class, "mmap failure");
+      ret = VNET_API_ERROR_SYSCALL_ERROR_1;
+      goto error;
+    }
+
+  /* join the fanout group last, once the ring can take its share */
+  if (fanout &&
+      (err = setsockopt (*fd, SOL_PACKET, PACKET_FANOUT, &fanout,
+			 sizeof (fanout))) < 0)
+    {
+      vlib_log_debug (apm->log_class, "Failed to join packet fanout group");
+      munmap (r, ring_sz);
       ret = VNET_API_ERROR_SYSCALL_ERROR_1;
       goto error;
     }
 
+  *ring = r;
+  return 0;
+error:
+  close (*fd);
+  *fd = -1;
+  return ret;
+}
+
+static int
+create_packet_v2_tx_sock (int host_if_index, tpacket_req_t * tx_req,
+			  int *fd, u8 ** ring)
+{
+  af_packet_main_t *apm = &af_packet_main;
+  int ret, err;
+  u32 ring_sz = tx_req->tp_block_size * tx_req->tp_block_nr;
+  u8 *r;
+
+  if ((ret = create_packet_sock (host_if_index, TPACKET_V2, 1, fd)))
+    return ret;
+
+  int opt = 1;
   if ((err =
-       setsockopt (*fd, SOL_PACKET, PACKET_TX_RING, tx_req, req_sz)) < 0)
+       setsockopt (*fd, SOL_PACKET, PACKET_LOSS, &opt, sizeof (opt))) < 0)
+    {
+      vlib_log_debug (apm->log_class,
+		      "Failed to set packet tx ring error handling option");
+      ret = VNET_API_ERROR_SYSCALL_ERROR_1;
+      goto error;
+    }
+
+  /* hand frames straight to the driver, older kernels go via the qdisc */
+  if ((err = setsockopt (*fd, SOL_PACKET, PACKET_QDISC_BYPASS, &opt,
+			 sizeof (opt))) < 0)
+    vlib_log_debug (apm->log_class,
+		    "Failed to set packet tx qdisc bypass option");
+
+  if ((err = setsockopt (*fd, SOL_PACKET, PACKET_TX_RING, tx_req,
+			 sizeof (*tx_req))) < 0)
     {
       vlib_log_debug (apm->log_class, "Failed to set packet tx ring options");
       ret = VNET_API_ERROR_SYSCALL_ERROR_1;
       goto error;
     }
 
-  *ring =
-    mmap (NULL, ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, *fd,
-	  0);
-  if (*ring == MAP_FAILED)
+  r = mmap (NULL, ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+	    *fd, 0);
+  if (r == MAP_FAILED)
     {
       vlib_log_debug (apm->log_class, "mmap failure");
       ret = VNET_API_ERROR_SYSCALL_ERROR_1;
       goto error;
     }
 
+  *ring = r;
   return 0;
 error:
-  if (*fd >= 0)
-    close (*fd);
+  close (*fd);
   *fd = -1;
   return ret;
 }
 
+static void
+free_rx_queues (af_packet_rx_queue_t * rx_queues,
+		struct tpacket_req3 *rx_req)
+{
+  af_packet_main_t *apm = &af_packet_main;
+  af_packet_rx_queue_t *rxq;
+
+  vec_foreach (rxq, rx_queues)
+  {
+    if (rxq->clib_file_index != ~0)
+      clib_file_del_by_index (&file_main, rxq->clib_file_index);
+    else if (rxq->fd >= 0)
+      close (rxq->fd);
+
+    if (rxq->rx_ring &&
+	munmap (rxq->rx_ring, rx_req->tp_block_size * rx_req->tp_block_nr))
+      vlib_log_warn (apm->log_class, "could not free rx ring");
+  }
+  vec_free (rx_queues);
+}
+
 int
 af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
-		     u32 * sw_if_index)
+		     u32 num_rx_queues, u32 * sw_if_index)
 {
   af_packet_main_t *apm = &af_packet_main;
   int ret, fd = -1, fd2 = -1;
-  struct tpacket_req *rx_req = 0;
-  struct tpacket_req *tx_req = 0;
+  struct tpacket_req3 rx_req;
+  struct tpacket_req tx_req;
   struct ifreq ifr;
-  u8 *ring = 0;
+  u8 *tx_ring = 0;
+  af_packet_rx_queue_t *rx_queues = 0, *rxq;
   af_packet_if_t *apif = 0;
   u8 hw_addr[6];
   clib_error_t *error;
@@ -229,6 +340,9 @@ af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
   uword if_index;
   u8 *host_if_name_dup = vec_dup (host_if_name);
   int host_if_index = -1;
+  u16 fanout_id = 0;
+  u32 fanout = 0;
+  u32 qid;
 
   p = mhash_get (&apm->if_index_by_host_if_name, host_if_name);
   if (p)
@@ -238,17 +352,26 @@ af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
       return VNET_API_ERROR_IF_ALREADY_EXISTS;
     }
 
-  vec_validate (rx_req, 0);
-  rx_req->tp_block_size = AF_PACKET_RX_BLOCK_SIZE;
-  rx_req->tp_frame_size = AF_PACKET_RX_FRAME_SIZE;
-  rx_req->tp_block_nr = AF_PACKET_RX_BLOCK_NR;
-  rx_req->tp_frame_nr = AF_PACKET_RX_FRAME_NR;
+  if (num_rx_queues == 0)
+    num_rx_queues = 1;
+
+  if (num_rx_queues > AF_PACKET_MAX_RX_QUEUES)
+    {
+      ret = VNET_API_ERROR_INVALID_VALUE;
+      goto error;
+    }
+
+  memset (&rx_req, 0, sizeof (rx_req));
+  rx_req.tp_block_size = AF_PACKET_RX_BLOCK_SIZE;
+  rx_req.tp_frame_size = AF_PACKET_RX_FRAME_SIZE;
+  rx_req.tp_block_nr = AF_PACKET_RX_BLOCK_NR;
+  rx_req.tp_frame_nr = AF_PACKET_RX_FRAME_NR;
+  rx_req.tp_retire_blk_tov = AF_PACKET_RX_BLOCK_RETIRE_TOV;
 
-  vec_validate (tx_req, 0);
-  tx_req->tp_block_size = AF_PACKET_TX_BLOCK_SIZE;
-  tx_req->tp_frame_size = AF_PACKET_TX_FRAME_SIZE;
-  tx_req->tp_block_nr = AF_PACKET_TX_BLOCK_NR;
-  tx_req->tp_frame_nr = AF_PACKET_TX_FRAME_NR;
+  tx_req.tp_block_size = AF_PACKET_TX_BLOCK_SIZE;
+  tx_req.tp_frame_size = AF_PACKET_TX_FRAME_SIZE;
+  tx_req.tp_block_nr = AF_PACKET_TX_BLOCK_NR;
+  tx_req.tp_frame_nr = AF_PACKET_TX_FRAME_NR;
 
   /*
    * make sure host side of interface is 'UP' before binding AF_PACKET
@@ -267,6 +390,7 @@ af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
     {
       vlib_log_debug (apm->log_class, "af_packet_create error: %d", ret);
       close (fd2);
+      vec_free (host_if_name_dup);
       return VNET_API_ERROR_INVALID_INTERFACE;
     }
 
@@ -287,14 +411,41 @@ af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
 	}
     }
 
-  if (fd2 > -1)
-    close (fd2);
+  close (fd2);
+  fd2 = -1;
 
-  ret = create_packet_v2_sock (host_if_index, rx_req, tx_req, &fd, &ring);
+  ret = create_packet_v2_tx_sock (host_if_index, &tx_req, &fd, &tx_ring);
 
   if (ret != 0)
     goto error;
 
+  /*
+   * With several queues each gets its own socket, and the kernel spreads
+   * the packets over them by flow hash. Fanout group ids are shared by
+   * the whole network namespace, so make ours unlikely to clash.
+   */
+  if (num_rx_queues > 1)
+    {
+      fanout_id = (getpid () ^ host_if_index) & 0xffff;
+      fanout = fanout_id |
+	((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+    }
+
+  vec_validate_aligned (rx_queues, num_rx_queues - 1, CLIB_CACHE_LINE_BYTES);
+  vec_foreach (rxq, rx_queues)
+  {
+    rxq->fd = -1;
+    rxq->clib_file_index = ~0;
+  }
+
+  vec_foreach (rxq, rx_queues)
+  {
+    ret = create_packet_v3_rx_sock (host_if_index, &rx_req, fanout,
+				    &rxq->fd, &rxq->rx_ring);
+    if (ret != 0)
+      goto error;
+  }
+
   ret = is_bridge (host_if_name);
 
   if (ret == 0)			/* is a bridge, ignore state */
@@ -306,27 +457,30 @@ af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
 
   apif->host_if_index = host_if_index;
   apif->fd = fd;
-  apif->rx_ring = ring;
-  apif->tx_ring = ring + rx_req->tp_block_size * rx_req->tp_block_nr;
-  apif->rx_req = rx_req;
+  apif->tx_ring = tx_ring;
   apif->tx_req = tx_req;
+  apif->rx_req = rx_req;
+  apif->rx_queues = rx_queues;
+  apif->fanout_id = fanout_id;
   apif->host_if_name = host_if_name_dup;
   apif->per_interface_next_index = ~0;
   apif->next_tx_frame = 0;
-  apif->next_rx_frame = 0;
 
   if (tm->n_vlib_mains > 1)
     clib_spinlock_init (&apif->lockp);
 
+  vec_foreach_index (qid, rx_queues)
   {
     clib_file_t template = { 0 };
+    rxq = vec_elt_at_index (rx_queues, qid);
     template.read_function = af_packet_fd_read_ready;
-    template.file_descriptor = fd;
-    template.private_data = if_index;
+    template.file_descriptor = rxq->fd;
+    template.private_data = (if_index << 16) | qid;
     template.flags = UNIX_FILE_EVENT_EDGE_TRIGGERED;
-    template.description = format (0, "%U", format_af_packet_device_name,
-				   if_index);
-    apif->clib_file_index = clib_file_add (&file_main, &template);
+    template.description = format (0, "%U queue %u",
+				   format_af_packet_device_name, if_index,
+				   qid);
+    rxq->clib_file_index = clib_file_add (&file_main, &template);
   }
 
   /*use configured or generate random MAC address */
@@ -365,15 +519,17 @@ af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
   vnet_hw_interface_set_input_node (vnm, apif->hw_if_index,
 				    af_packet_input_node.index);
 
-  vnet_hw_interface_assign_rx_thread (vnm, apif->hw_if_index, 0,	/* queue */
-				      ~0 /* any cpu */ );
+  for (qid = 0; qid < num_rx_queues; qid++)
+    vnet_hw_interface_assign_rx_thread (vnm, apif->hw_if_index, qid,
+					~0 /* any cpu */ );
 
   hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_INT_MODE;
   vnet_hw_interface_set_flags (vnm, apif->hw_if_index,
 			       VNET_HW_INTERFACE_FLAG_LINK_UP);
 
-  vnet_hw_interface_set_rx_mode (vnm, apif->hw_if_index, 0,
-				 VNET_HW_INTERFACE_RX_MODE_INTERRUPT);
+  for (qid = 0; qid < num_rx_queues; qid++)
+    vnet_hw_interface_set_rx_mode (vnm, apif->hw_if_index, qid,
+				   VNET_HW_INTERFACE_RX_MODE_INTERRUPT);
 
   mhash_set_mem (&apm->if_index_by_host_if_name, host_if_name_dup, &if_index,
 		 0);
@@ -385,9 +541,12 @@ af_packet_create_if (vlib_main_t * vm, u8 * host_if_name, u8 * hw_addr_set,
 error:
   if (fd2 > -1)
     close (fd2);
+  free_rx_queues (rx_queues, &rx_req);
+  if (tx_ring)
+    munmap (tx_ring, tx_req.tp_block_size * tx_req.tp_block_nr);
+  if (fd > -1)
+    close (fd);
   vec_free (host_if_name_dup);
-  vec_free (rx_req);
-  vec_free (tx_req);
   return ret;
 }
 
@@ -399,7 +558,7 @@ af_packet_delete_if (vlib_main_t * vm, u8 * host_if_name)
   af_packet_if_t *apif;
   uword *p;
   uword if_index;
-  u32 ring_sz;
+  u32 qid;
 
   p = mhash_get (&apm->if_index_by_host_if_name, host_if_name);
   if (p == NULL)
@@ -413,32 +572,22 @@ af_packet_delete_if (vlib_main_t * vm, u8 * host_if_name)
 
   /* bring down the interface */
   vnet_hw_interface_set_flags (vnm, apif->hw_if_index, 0);
-  vnet_hw_interface_unassign_rx_thread (vnm, apif->hw_if_index, 0);
+  vec_foreach_index (qid, apif->rx_queues)
+    vnet_hw_interface_unassign_rx_thread (vnm, apif->hw_if_index, qid);
 
   /* clean up */
-  if (apif->clib_file_index != ~0)
-    {
-      clib_file_del (&file_main, file_main.file_pool + apif->clib_file_index);
-      apif->clib_file_index = ~0;
-    }
-  else
-    close (apif->fd);
+  free_rx_queues (apif->rx_queues, &apif->rx_req);
+  apif->rx_queues = NULL;
 
-  ring_sz = apif->rx_req->tp_block_size * apif->rx_req->tp_block_nr +
-    apif->tx_req->tp_block_size * apif->tx_req->tp_block_nr;
-  if (munmap (apif->rx_ring, ring_sz))
+  if (munmap (apif->tx_ring,
+	      apif->tx_req.tp_block_size * apif->tx_req.tp_block_nr))
     vlib_log_warn (apm->log_class,
-		   "Host interface %s could not free rx/tx ring",
+		   "Host interface %s could not free tx ring",
 		   host_if_name);
-  apif->rx_ring = NULL;
   apif->tx_ring = NULL;
+  close (apif->fd);
   apif->fd = -1;
 
-  vec_free (apif->rx_req);
-  apif->rx_req = NULL;
-  vec_free (apif->tx_req);
-  apif->tx_req = NULL;
-
   vec_free (apif->host_if_name);
   apif->host_if_name = NULL;
   apif->host_if_index = -1;
@@ -17,6 +17,8 @@
  *------------------------------------------------------------------
  */
 
+#include <linux/if_packet.h>
+
 #include <vppinfra/lock.h>
 
 #include <vlib/log.h>
@@ -27,23 +29,42 @@ typedef struct
   u8 host_if_name[64];
 } af_packet_if_detail_t;
 
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  int fd;
+  u8 *rx_ring;
+  u32 clib_file_index;
+
+  /* block being read, and the next packet in it */
+  u32 next_rx_block;
+  u32 next_rx_pkt;
+  u32 next_rx_offset;
+
+  /* packets received on this queue, for checking the fanout spread */
+  u64 n_rx_packets;
+} af_packet_rx_queue_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   clib_spinlock_t lockp;
   u8 *host_if_name;
   int host_if_index;
+
+  /* tx socket, with a TPACKET_V2 frame ring */
   int fd;
-  struct tpacket_req *rx_req;
-  struct tpacket_req *tx_req;
-  u8 *rx_ring;
+  struct tpacket_req tx_req;
   u8 *tx_ring;
+  u32 next_tx_frame;
+
+  /* rx sockets, one TPACKET_V3 block ring per queue */
+  struct tpacket_req3 rx_req;
+  af_packet_rx_queue_t *rx_queues;
+  u16 fanout_id;
+
   u32 hw_if_index;
   u32 sw_if_index;
-  u32 clib_file_index;
-
-  u32 next_rx_frame;
-  u32 next_tx_frame;
 
   u32 per_interface_next_index;
   u8 is_admin_up;
@@ -72,7 +93,8 @@ extern vnet_device_class_t af_packet_device_class;
 extern vlib_node_registration_t af_packet_input_node;
 
 int af_packet_create_if (vlib_main_t * vm, u8 * host_if_name,
-			 u8 * hw_addr_set, u32 * sw_if_index);
+			 u8 * hw_addr_set, u32 num_rx_queues,
+			 u32 * sw_if_index);
 int af_packet_delete_if (vlib_main_t * vm, u8 * host_if_name);
 int af_packet_set_l4_cksum_offload (vlib_main_t * vm, u32 sw_if_index,
 				    u8 set);
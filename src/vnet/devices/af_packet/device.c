@@ -65,7 +65,26 @@ format_af_packet_device_name (u8 * s, va_list * args)
 static u8 *
 format_af_packet_device (u8 * s, va_list * args)
 {
+  u32 dev_instance = va_arg (*args, u32);
+  int verbose = va_arg (*args, int);
+  af_packet_main_t *apm = &af_packet_main;
+  af_packet_if_t *apif = pool_elt_at_index (apm->interfaces, dev_instance);
+  af_packet_rx_queue_t *rxq;
+  u32 indent = format_get_indent (s);
+
   s = format (s, "Linux PACKET socket interface");
+  if (verbose)
+    {
+      s = format (s, "\n%Urx queues %u, block size %u, blocks %u",
+		  format_white_space, indent + 2, vec_len (apif->rx_queues),
+		  apif->rx_req.tp_block_size, apif->rx_req.tp_block_nr);
+      if (vec_len (apif->rx_queues) > 1)
+	s = format (s, ", fanout group %u", apif->fanout_id);
+      vec_foreach (rxq, apif->rx_queues)
+	s = format (s, "\n%Uqueue %u: rx packets %llu",
+		    format_white_space, indent + 2, rxq - apif->rx_queues,
+		    rxq->n_rx_packets);
+    }
   return s;
 }
 
@@ -89,9 +108,9 @@ af_packet_interface_tx (vlib_main_t * vm,
     pool_elt_at_index (apm->interfaces, rd->dev_instance);
   clib_spinlock_lock_if_init (&apif->lockp);
   int block = 0;
-  u32 block_size = apif->tx_req->tp_block_size;
-  u32 frame_size = apif->tx_req->tp_frame_size;
-  u32 frame_num = apif->tx_req->tp_frame_nr;
+  u32 block_size = apif->tx_req.tp_block_size;
+  u32 frame_size = apif->tx_req.tp_frame_size;
+  u32 frame_num = apif->tx_req.tp_frame_nr;
   u8 *block_start = apif->tx_ring + block * block_size;
   u32 tx_frame = apif->next_tx_frame;
   struct tpacket2_hdr *tph;
@@ -196,7 +215,11 @@ af_packet_set_interface_next_node (vnet_main_t * vnm, u32 hw_if_index,
 static void
 af_packet_clear_hw_interface_counters (u32 instance)
 {
-  /* Nothing for now */
+  af_packet_main_t *apm = &af_packet_main;
+  af_packet_if_t *apif = pool_elt_at_index (apm->interfaces, instance);
+  af_packet_rx_queue_t *rxq;
+
+  vec_foreach (rxq, apif->rx_queues) rxq->n_rx_packets = 0;
 }
 
 static clib_error_t *
@@ -30,7 +30,8 @@
 #include <vnet/devices/af_packet/af_packet.h>
 
 #define foreach_af_packet_input_error \
-  _(PARTIAL_PKT, "partial packet")
+  _(PARTIAL_PKT, "partial packet")          \
+  _(OUTGOING_PKT, "outgoing packet")
 
 typedef enum
 {
@@ -50,8 +51,9 @@ typedef struct
 {
   u32 next_index;
   u32 hw_if_index;
-  int block;
-  struct tpacket2_hdr tph;
+  u16 queue_id;
+  u32 block;
+  struct tpacket3_hdr tph;
 } af_packet_input_trace_t;
 
 static u8 *
@@ -62,13 +64,13 @@ format_af_packet_input_trace (u8 * s, va_list * args)
   af_packet_input_trace_t *t = va_arg (*args, af_packet_input_trace_t *);
   u32 indent = format_get_indent (s);
 
-  s = format (s, "af_packet: hw_if_index %d next-index %d",
-	      t->hw_if_index, t->next_index);
+  s = format (s, "af_packet: hw_if_index %d queue %u block %u next-index %d",
+	      t->hw_if_index, t->queue_id, t->block, t->next_index);
 
   s =
     format (s,
-	    "\n%Utpacket2_hdr:\n%Ustatus 0x%x len %u snaplen %u mac %u net %u"
-	    "\n%Usec 0x%x nsec 0x%x vlan %U"
+	    "\n%Utpacket3_hdr:\n%Ustatus 0x%x len %u snaplen %u mac %u net %u"
+	    "\n%Usec 0x%x nsec 0x%x rxhash 0x%x vlan %U"
 #ifdef TP_STATUS_VLAN_TPID_VALID
 	    " vlan_tpid %u"
 #endif
@@ -82,9 +84,10 @@ format_af_packet_input_trace (u8 * s, va_list * args)
 	    t->tph.tp_net,
 	    format_white_space, indent + 4,
 	    t->tph.tp_sec,
-	    t->tph.tp_nsec, format_ethernet_vlan_tci, t->tph.tp_vlan_tci
+	    t->tph.tp_nsec, t->tph.hv1.tp_rxhash,
+	    format_ethernet_vlan_tci, t->tph.hv1.tp_vlan_tci
 #ifdef TP_STATUS_VLAN_TPID_VALID
-	    , t->tph.tp_vlan_tpid
+	    , t->tph.hv1.tp_vlan_tpid
 #endif
     );
   return s;
@@ -173,59 +176,126 @@ mark_tcp_udp_cksum_calc (vlib_buffer_t * b)
     }
 }
 
+/* Top up the free rx buffers of the thread to at least n_min */
+static_always_inline u32
+af_packet_rx_buffers_refill (vlib_main_t * vm, u32 thread_index, u32 n_min)
+{
+  af_packet_main_t *apm = &af_packet_main;
+  u32 n_free_bufs = vec_len (apm->rx_buffers[thread_index]);
+  u32 n_alloc;
+
+  if (PREDICT_TRUE (n_free_bufs >= n_min))
+    return n_free_bufs;
+
+  n_alloc = n_min - n_free_bufs + VLIB_FRAME_SIZE;
+  vec_validate (apm->rx_buffers[thread_index], n_free_bufs + n_alloc - 1);
+  n_free_bufs +=
+    vlib_buffer_alloc (vm, &apm->rx_buffers[thread_index][n_free_bufs],
+		       n_alloc);
+  _vec_len (apm->rx_buffers[thread_index]) = n_free_bufs;
+  return n_free_bufs;
+}
+
 always_inline uword
 af_packet_device_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
-			   vlib_frame_t * frame, af_packet_if_t * apif)
+			   vlib_frame_t * frame, af_packet_if_t * apif,
+			   u16 queue_id)
 {
   af_packet_main_t *apm = &af_packet_main;
-  struct tpacket2_hdr *tph;
+  af_packet_rx_queue_t *rxq = vec_elt_at_index (apif->rx_queues, queue_id);
+  struct tpacket_block_desc *bd;
+  struct tpacket3_hdr *tph;
   u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
-  u32 block = 0;
-  u32 rx_frame;
+  u32 block = rxq->next_rx_block;
+  u32 pkt = rxq->next_rx_pkt;
+  u32 offset_in_block = rxq->next_rx_offset;
   u32 n_free_bufs;
   u32 n_rx_packets = 0;
   u32 n_rx_bytes = 0;
+  u32 n_outgoing = 0;
   u32 *to_next = 0;
-  u32 block_size = apif->rx_req->tp_block_size;
-  u32 frame_size = apif->rx_req->tp_frame_size;
-  u32 frame_num = apif->rx_req->tp_frame_nr;
-  u8 *block_start = apif->rx_ring + block * block_size;
+  u32 block_size = apif->rx_req.tp_block_size;
+  u32 block_num = apif->rx_req.tp_block_nr;
   uword n_trace = vlib_get_trace_count (vm, node);
   u32 thread_index = vlib_get_thread_index ();
   u32 n_buffer_bytes = vlib_buffer_free_list_buffer_size (vm,
 							  VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
-  u32 min_bufs = apif->rx_req->tp_frame_size / n_buffer_bytes;
+  int out_of_buffers = 0;
 
   if (apif->per_interface_next_index != ~0)
     next_index = apif->per_interface_next_index;
 
-  n_free_bufs = vec_len (apm->rx_buffers[thread_index]);
-  if (PREDICT_FALSE (n_free_bufs < VLIB_FRAME_SIZE))
-    {
-      vec_validate (apm->rx_buffers[thread_index],
-		    VLIB_FRAME_SIZE + n_free_bufs - 1);
-      n_free_bufs +=
-	vlib_buffer_alloc (vm, &apm->rx_buffers[thread_index][n_free_bufs],
-			   VLIB_FRAME_SIZE);
-      _vec_len (apm->rx_buffers[thread_index]) = n_free_bufs;
-    }
-
-  rx_frame = apif->next_rx_frame;
-  tph = (struct tpacket2_hdr *) (block_start + rx_frame * frame_size);
-  while ((tph->tp_status & TP_STATUS_USER) && (n_free_bufs > min_bufs))
+  n_free_bufs = af_packet_rx_buffers_refill (vm, thread_index,
+					     VLIB_FRAME_SIZE);
+
+  /*
+   * The kernel owns a block until it retires it, then the whole block is
+   * ours until we hand it back. Packets are walked in place, so a block
+   * can be left part way through when we run out of buffers, or once a
+   * frame's worth of packets was read, and resumed on the next call. The
+   * latter keeps a busy ring from starving the other queues and nodes.
+   */
+  bd = (struct tpacket_block_desc *) (rxq->rx_ring + block * block_size);
+  while ((bd->hdr.bh1.block_status & TP_STATUS_USER) && !out_of_buffers
+	 && n_rx_packets < VLIB_FRAME_SIZE)
     {
       vlib_buffer_t *b0 = 0, *first_b0 = 0;
       u32 next0 = next_index;
+      u32 num_pkts = bd->hdr.bh1.num_pkts;
+
+      if (pkt == 0)
+	offset_in_block = bd->hdr.bh1.offset_to_first_pkt;
 
       u32 n_left_to_next;
       vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
-      while ((tph->tp_status & TP_STATUS_USER) && (n_free_bufs > min_bufs) &&
-	     n_left_to_next)
+      while (pkt < num_pkts && n_left_to_next
+	     && n_rx_packets < VLIB_FRAME_SIZE)
 	{
-	  u32 data_len = tph->tp_snaplen;
-	  u32 offset = 0;
+	  u32 data_len, n_bufs;
+	  u32 offset = 0, pkt_vlan_len = 0;
 	  u32 bi0 = 0, first_bi0 = 0, prev_bi0;
+	  struct sockaddr_ll *sll;
+
+	  tph = (struct tpacket3_hdr *) ((u8 *) bd + offset_in_block);
+
+	  /*
+	   * without qdisc bypass the kernel loops our own tx back to the
+	   * other packet sockets on the interface
+	   */
+	  sll = (struct sockaddr_ll *) ((u8 *) tph +
+					TPACKET_ALIGN (sizeof (*tph)));
+	  if (PREDICT_FALSE (sll->sll_pkttype == PACKET_OUTGOING))
+	    {
+	      offset_in_block += tph->tp_next_offset;
+	      pkt++;
+	      n_outgoing++;
+	      continue;
+	    }
+
+	  /*
+	   * A packet can take up to a whole block, so the buffers it needs
+	   * come from its own length. Without them, it stays in the block
+	   * for the next call.
+	   */
+	  if (PREDICT_FALSE (tph->tp_status & TP_STATUS_VLAN_VALID))
+	    pkt_vlan_len = sizeof (ethernet_vlan_header_t);
+	  n_bufs = (tph->tp_snaplen + pkt_vlan_len + n_buffer_bytes - 1) /
+	    n_buffer_bytes;
+	  if (PREDICT_FALSE (n_bufs > n_free_bufs))
+	    {
+	      n_free_bufs = af_packet_rx_buffers_refill (vm, thread_index,
+							 n_bufs);
+	      if (n_bufs > n_free_bufs)
+		{
+		  out_of_buffers = 1;
+		  break;
+		}
+	    }
 
+	  offset_in_block += tph->tp_next_offset;
+	  pkt++;
+
+	  data_len = tph->tp_snaplen;
 	  while (data_len)
 	    {
 	      /* grab free buffer */
@@ -237,10 +307,11 @@ af_packet_device_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 	      _vec_len (apm->rx_buffers[thread_index]) = last_empty_buffer;
 	      n_free_bufs--;
 
-	      /* copy data */
-	      u32 bytes_to_copy =
-		data_len > n_buffer_bytes ? n_buffer_bytes : data_len;
+	      /* copy data, the first buffer also takes the VLAN tag */
 	      u32 vlan_len = 0;
+	      u32 bytes_to_copy =
+		clib_min (data_len,
+			  n_buffer_bytes - (offset ? 0 : pkt_vlan_len));
 	      u32 bytes_copied = 0;
 	      b0->current_data = 0;
 	      /* Kernel removes VLAN headers, so reconstruct VLAN */
@@ -255,7 +326,7 @@ af_packet_device_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 		      ethernet_vlan_header_t *vlan =
 			(ethernet_vlan_header_t *) (eth + 1);
 		      vlan->priority_cfi_and_id =
-			clib_host_to_net_u16 (tph->tp_vlan_tci);
+			clib_host_to_net_u16 (tph->hv1.tp_vlan_tci);
 		      vlan->type = eth->type;
 		      eth->type = clib_host_to_net_u16 (ETHERNET_TYPE_VLAN);
 		      vlan_len = sizeof (ethernet_vlan_header_t);
@@ -319,23 +390,44 @@ af_packet_device_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 	      tr = vlib_add_trace (vm, node, first_b0, sizeof (*tr));
 	      tr->next_index = next0;
 	      tr->hw_if_index = apif->hw_if_index;
-	      clib_memcpy (&tr->tph, tph, sizeof (struct tpacket2_hdr));
+	      tr->queue_id = queue_id;
+	      tr->block = block;
+	      clib_memcpy (&tr->tph, tph, sizeof (struct tpacket3_hdr));
 	    }
 
 	  /* enque and take next packet */
 	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
 					   n_left_to_next, first_bi0, next0);
-
-	  /* next packet */
-	  tph->tp_status = TP_STATUS_KERNEL;
-	  rx_frame = (rx_frame + 1) % frame_num;
-	  tph = (struct tpacket2_hdr *) (block_start + rx_frame * frame_size);
 	}
 
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+
+      /* hand the block back once all of it has been read */
+      if (pkt == num_pkts)
+	{
+	  CLIB_MEMORY_BARRIER ();
+	  bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+	  block = (block + 1) % block_num;
+	  pkt = 0;
+	  bd = (struct tpacket_block_desc *) (rxq->rx_ring +
+					      block * block_size);
+	}
     }
 
-  apif->next_rx_frame = rx_frame;
+  rxq->next_rx_block = block;
+  rxq->next_rx_pkt = pkt;
+  rxq->next_rx_offset = offset_in_block;
+  rxq->n_rx_packets += n_rx_packets;
+
+  /* the kernel does not signal a block it already handed over again */
+  if ((bd->hdr.bh1.block_status & TP_STATUS_USER) &&
+      node->state == VLIB_NODE_STATE_INTERRUPT)
+    vnet_device_input_set_interrupt_pending (vnet_get_main (),
+					     apif->hw_if_index, queue_id);
+
+  if (PREDICT_FALSE (n_outgoing))
+    vlib_error_count (vm, node->node_index,
+		      AF_PACKET_INPUT_ERROR_OUTGOING_PKT, n_outgoing);
 
   vlib_increment_combined_counter
     (vnet_get_main ()->interface_main.combined_sw_if_counters
@@ -360,7 +452,8 @@ af_packet_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
     af_packet_if_t *apif;
     apif = vec_elt_at_index (apm->interfaces, dq->dev_instance);
     if (apif->is_admin_up)
-      n_rx_packets += af_packet_device_input_fn (vm, node, frame, apif);
+      n_rx_packets += af_packet_device_input_fn (vm, node, frame, apif,
+						 dq->queue_id);
   }
 
   return n_rx_packets;
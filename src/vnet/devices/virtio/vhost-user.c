@@ -442,86 +442,180 @@ vhost_user_tx_thread_placement (vhost_user_intf_t * vui)
     }
 }
 
+/** @brief Returns whether at least one TX and one RX vring are enabled */
+int
+vhost_user_intf_ready (vhost_user_intf_t * vui)
+{
+  int i, found[2] = { };	//RX + TX
+
+  for (i = 0; i < VHOST_VRING_MAX_N; i++)
+    if (vui->vrings[i].started && vui->vrings[i].enabled)
+      found[i & 1] = 1;
+
+  return found[0] && found[1];
+}
+
 /**
- * @brief Unassign existing interface/queue to thread mappings and re-assign
- * new interface/queue to thread mappings
+ * @brief Drop the adaptive state of an rx queue and ask the guest for kicks
+ *
+ * Queue placement and rx mode changes can take a polling input node away
+ * from a vring which had guest kicks suppressed, so the vring restarts in
+ * interrupt mode. Anything the guest queued while kicks were suppressed is
+ * picked up through a pending interrupt.
  */
 static void
-vhost_user_rx_thread_placement ()
+vhost_user_adaptive_reset (vnet_main_t * vnm, vhost_user_intf_t * vui,
+			   u16 qid)
+{
+  vhost_user_vring_t *txvq = &vui->vrings[VHOST_VRING_IDX_TX (qid)];
+
+  if (!txvq->adaptive_polling)
+    return;
+  txvq->adaptive_polling = 0;
+  txvq->used->flags = 0;
+  CLIB_MEMORY_BARRIER ();
+  if (vhost_user_intf_ready (vui))
+    vnet_device_input_set_interrupt_pending (vnm, vui->hw_if_index, qid);
+}
+
+/**
+ * @brief Let the adaptive vrings of a thread see its input node stop polling
+ *
+ * A polling queue leaving a thread, or leaving polling mode, can put the
+ * thread's input node in interrupt mode at once. Each vring polled there in
+ * adaptive mode gets one more dispatch, which sends it back to guest kicks
+ * if the node stopped polling and leaves it polling otherwise.
+ */
+static void
+vhost_user_adaptive_wake (vnet_main_t * vnm, uword thread_index)
 {
   vhost_user_main_t *vum = &vhost_user_main;
   vhost_user_intf_t *vui;
-  vhost_user_vring_t *txvq;
-  vnet_main_t *vnm = vnet_get_main ();
-  u32 qid;
-  int rv;
+  vnet_hw_interface_t *hw;
   u16 *queue;
 
-  // Scrap all existing mappings for all interfaces/queues
   /* *INDENT-OFF* */
   pool_foreach (vui, vum->vhost_user_interfaces, {
+      hw = vnet_get_hw_interface (vnm, vui->hw_if_index);
       vec_foreach (queue, vui->rx_queues)
 	{
-	  rv = vnet_hw_interface_unassign_rx_thread (vnm, vui->hw_if_index,
+	  if (vui->vrings[VHOST_VRING_IDX_TX (*queue)].adaptive_polling &&
+	      hw->input_node_thread_index_by_queue[*queue] == thread_index)
+	    vnet_device_input_set_interrupt_pending (vnm, vui->hw_if_index,
 						     *queue);
-	  if (rv)
-	    clib_warning ("Warning: unable to unassign interface %d, "
-			  "queue %d: rc=%d", vui->hw_if_index, *queue, rv);
 	}
-      vec_reset_length (vui->rx_queues);
   });
   /* *INDENT-ON* */
+}
+
+/**
+ * @brief Pick the thread for a new rx queue
+ *
+ * Every queue counts as one packet/sec on top of its measured rate, so idle
+ * queues are spread evenly and busy workers are avoided.
+ */
+static uword
+vhost_user_rx_pick_thread (vnet_main_t * vnm)
+{
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vhost_user_main_t *vum = &vhost_user_main;
+  vhost_user_intf_t *vui;
+  vhost_user_vring_t *txvq;
+  vnet_hw_interface_t *hw;
+  uword thread_index, best = ~0;
+  u64 *load = 0;
+  u16 *queue;
+
+  if (vdm->first_worker_thread_index == 0)
+    return 0;
+
+  vec_validate (load, vdm->last_worker_thread_index);
 
-  // Create the rx_queues for all interfaces
   /* *INDENT-OFF* */
   pool_foreach (vui, vum->vhost_user_interfaces, {
-      for (qid = 0; qid < VHOST_VRING_MAX_N / 2; qid++)
+      hw = vnet_get_hw_interface (vnm, vui->hw_if_index);
+      vec_foreach (queue, vui->rx_queues)
 	{
-	  txvq = &vui->vrings[VHOST_VRING_IDX_TX (qid)];
-	  if (txvq->started)
-	    {
-	      if (txvq->mode == VNET_HW_INTERFACE_RX_MODE_UNKNOWN)
-		/* Set polling as the default */
-		txvq->mode = VNET_HW_INTERFACE_RX_MODE_POLLING;
-	      vec_add1 (vui->rx_queues, qid);
-	    }
+	  txvq = &vui->vrings[VHOST_VRING_IDX_TX (*queue)];
+	  thread_index = hw->input_node_thread_index_by_queue[*queue];
+	  load[thread_index] += txvq->rx_rate + 1;
 	}
   });
   /* *INDENT-ON* */
 
-  // Assign new mappings for all interfaces/queues
+  for (thread_index = vdm->first_worker_thread_index;
+       thread_index <= vdm->last_worker_thread_index; thread_index++)
+    if (best == ~0 || load[thread_index] < load[best])
+      best = thread_index;
+
+  vec_free (load);
+  return best;
+}
+
+/**
+ * @brief Unassign the rx queues of stopped vrings and assign the queues of
+ * newly started vrings to the least loaded worker
+ *
+ * Queues which keep running stay where they are, so the work done here is
+ * proportional to the vrings which changed state.
+ */
+static void
+vhost_user_rx_thread_placement ()
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  vhost_user_intf_t *vui;
+  vhost_user_vring_t *txvq;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 qid, i;
+  int rv;
+
   /* *INDENT-OFF* */
   pool_foreach (vui, vum->vhost_user_interfaces, {
+      for (i = 0; i < vec_len (vui->rx_queues);)
+	{
+	  qid = vui->rx_queues[i];
+	  if (vui->vrings[VHOST_VRING_IDX_TX (qid)].started)
+	    {
+	      i++;
+	      continue;
+	    }
+	  rv = vnet_hw_interface_unassign_rx_thread (vnm, vui->hw_if_index,
+						     qid);
+	  if (rv)
+	    clib_warning ("Warning: unable to unassign interface %d, "
+			  "queue %d: rc=%d", vui->hw_if_index, qid, rv);
+	  vec_delete (vui->rx_queues, 1, i);
+	}
+
       vnet_hw_interface_set_input_node (vnm, vui->hw_if_index,
 					vhost_user_input_node.index);
-      vec_foreach (queue, vui->rx_queues)
+      for (qid = 0; qid < VHOST_VRING_MAX_N / 2; qid++)
 	{
-	  vnet_hw_interface_assign_rx_thread (vnm, vui->hw_if_index, *queue,
-					      ~0);
-	  txvq = &vui->vrings[VHOST_VRING_IDX_TX (*queue)];
-	  rv = vnet_hw_interface_set_rx_mode (vnm, vui->hw_if_index, *queue,
+	  txvq = &vui->vrings[VHOST_VRING_IDX_TX (qid)];
+	  if (!txvq->started || vec_search (vui->rx_queues, qid) != ~0)
+	    continue;
+
+	  if (txvq->mode == VNET_HW_INTERFACE_RX_MODE_UNKNOWN)
+	    /* Set polling as the default */
+	    txvq->mode = VNET_HW_INTERFACE_RX_MODE_POLLING;
+	  txvq->rx_rate = 0;
+	  txvq->n_rx_packets_last = txvq->n_rx_packets;
+
+	  vnet_hw_interface_assign_rx_thread (vnm, vui->hw_if_index, qid,
+					      vhost_user_rx_pick_thread
+					      (vnm));
+	  vec_add1 (vui->rx_queues, qid);
+	  rv = vnet_hw_interface_set_rx_mode (vnm, vui->hw_if_index, qid,
 					      txvq->mode);
 	  if (rv)
 	    clib_warning ("Warning: unable to set rx mode for interface %d, "
-			  "queue %d: rc=%d", vui->hw_if_index, *queue, rv);
+			  "queue %d: rc=%d", vui->hw_if_index, qid, rv);
+	  vhost_user_adaptive_reset (vnm, vui, qid);
 	}
   });
   /* *INDENT-ON* */
 }
 
-/** @brief Returns whether at least one TX and one RX vring are enabled */
-int
-vhost_user_intf_ready (vhost_user_intf_t * vui)
-{
-  int i, found[2] = { };	//RX + TX
-
-  for (i = 0; i < VHOST_VRING_MAX_N; i++)
-    if (vui->vrings[i].started && vui->vrings[i].enabled)
-      found[i & 1] = 1;
-
-  return found[0] && found[1];
-}
-
 static void
 vhost_user_update_iface_state (vhost_user_intf_t * vui)
 {
@@ -733,6 +827,29 @@ vhost_user_log_dirty_pages (vhost_user_intf_t * vui, u64 addr, u64 len)
                              sizeof(vq->used->member)); \
   }
 
+/*
+ * Let the interface-output node know what the guest can take: it then
+ * leaves checksums and segmentation of packets sent to the guest to us.
+ */
+static void
+vhost_user_update_offload_flags (vnet_main_t * vnm, vhost_user_intf_t * vui)
+{
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, vui->hw_if_index);
+  u64 tso = (1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO4) |
+    (1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO6);
+
+  if (vui->features & (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM))
+    hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD;
+  else
+    hw->flags &= ~VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD;
+
+  if ((vui->features & tso) == tso &&
+      (vui->features & (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM)))
+    hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO;
+  else
+    hw->flags &= ~VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO;
+}
+
 static clib_error_t *
 vhost_user_socket_read (clib_file_t * uf)
 {
@@ -840,7 +957,9 @@ vhost_user_socket_read (clib_file_t * uf)
 	(1ULL << FEAT_VIRTIO_NET_F_GUEST_ANNOUNCE) |
 	(1ULL << FEAT_VIRTIO_NET_F_MQ) |
 	(1ULL << FEAT_VHOST_USER_F_PROTOCOL_FEATURES) |
-	(1ULL << FEAT_VIRTIO_F_VERSION_1);
+	(1ULL << FEAT_VIRTIO_F_VERSION_1) | VHOST_USER_CSUM_FEATURES;
+      if (vui->enable_gso)
+	msg.u64 |= VHOST_USER_GSO_FEATURES;
       msg.u64 &= vui->feature_mask;
       msg.size = sizeof (msg.u64);
       DBG_SOCK ("if %d msg VHOST_USER_GET_FEATURES - reply 0x%016llx",
@@ -863,6 +982,8 @@ vhost_user_socket_read (clib_file_t * uf)
       vui->is_any_layout =
 	(vui->features & (1 << FEAT_VIRTIO_F_ANY_LAYOUT)) ? 1 : 0;
 
+      vhost_user_update_offload_flags (vnm, vui);
+
       ASSERT (vui->virtio_net_hdr_sz < VLIB_BUFFER_PRE_DATA_SIZE);
       vnet_hw_interface_set_flags (vnm, vui->hw_if_index, 0);
       vui->is_up = 0;
@@ -1313,6 +1434,9 @@ vhost_user_init (vlib_main_t * vm)
 
   vum->coalesce_frames = 32;
   vum->coalesce_time = 1e-3;
+  vum->adaptive_poll_frames = 32;
+  vum->adaptive_idle_time = 1e-3;
+  vum->rebalance_interval = 1.0;
 
   vec_validate (vum->cpus, tm->n_vlib_mains - 1);
 
@@ -1481,6 +1605,95 @@ vhost_user_input_copy (vhost_user_intf_t * vui, vhost_copy_t * cpy,
   return 0;
 }
 
+/**
+ * Turn the virtio header of a received packet into buffer offload
+ * metadata. Partial checksums are cleared and left to the egress
+ * interface, large TCP packets stay in one buffer chain until an
+ * interface without segmentation offload has to send them. The segment
+ * size comes from the guest, packets with one outside
+ * [VHOST_USER_MIN_GSO_SIZE, mtu] are not marked GSO.
+ */
+static_always_inline void
+vhost_user_handle_rx_offload (vlib_buffer_t * b0, virtio_net_hdr_t * hdr,
+			      u32 mtu)
+{
+  ethernet_header_t *eh = vlib_buffer_get_current (b0);
+  u16 ethertype = clib_net_to_host_u16 (eh->type);
+  u16 l2hdr_sz = sizeof (ethernet_header_t);
+  u8 gso_type = hdr->gso_type & ~VIRTIO_NET_HDR_GSO_ECN;
+  u8 *csum;
+
+  if (ethernet_frame_is_tagged (ethertype))
+    {
+      ethernet_vlan_header_t *vlan = (ethernet_vlan_header_t *) (eh + 1);
+
+      ethertype = clib_net_to_host_u16 (vlan->type);
+      l2hdr_sz += sizeof (*vlan);
+      if (ethertype == ETHERNET_TYPE_VLAN)
+	{
+	  vlan++;
+	  ethertype = clib_net_to_host_u16 (vlan->type);
+	  l2hdr_sz += sizeof (*vlan);
+	}
+    }
+
+  /* the L4 header and the checksum must be in the first buffer */
+  if (PREDICT_FALSE (hdr->csum_start < l2hdr_sz ||
+		     hdr->csum_start + hdr->csum_offset + sizeof (u16) >
+		     b0->current_length))
+    return;
+
+  if (ethertype == ETHERNET_TYPE_IP4)
+    b0->flags |= VNET_BUFFER_F_IS_IP4;
+  else if (ethertype == ETHERNET_TYPE_IP6)
+    b0->flags |= VNET_BUFFER_F_IS_IP6;
+  else
+    return;
+
+  vnet_buffer (b0)->l2_hdr_offset = b0->current_data;
+  vnet_buffer (b0)->l3_hdr_offset = b0->current_data + l2hdr_sz;
+  vnet_buffer (b0)->l4_hdr_offset = b0->current_data + hdr->csum_start;
+  b0->flags |= VNET_BUFFER_F_L2_HDR_OFFSET_VALID |
+    VNET_BUFFER_F_L3_HDR_OFFSET_VALID | VNET_BUFFER_F_L4_HDR_OFFSET_VALID;
+
+  if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM)
+    {
+      csum = vlib_buffer_get_current (b0) + hdr->csum_start +
+	hdr->csum_offset;
+      if (hdr->csum_offset == STRUCT_OFFSET_OF (tcp_header_t, checksum))
+	b0->flags |= VNET_BUFFER_F_OFFLOAD_TCP_CKSUM;
+      else if (hdr->csum_offset == STRUCT_OFFSET_OF (udp_header_t, checksum))
+	b0->flags |= VNET_BUFFER_F_OFFLOAD_UDP_CKSUM;
+      else
+	return;
+      /* the guest only filled in the pseudo header sum */
+      clib_mem_unaligned (csum, u16) = 0;
+    }
+
+  if ((gso_type == VIRTIO_NET_HDR_GSO_TCPV4 ||
+       gso_type == VIRTIO_NET_HDR_GSO_TCPV6) &&
+      hdr->gso_size >= VHOST_USER_MIN_GSO_SIZE && hdr->gso_size <= mtu)
+    {
+      b0->flags |= VNET_BUFFER_F_GSO;
+      vnet_buffer2 (b0)->gso_size = hdr->gso_size;
+    }
+}
+
+static_always_inline void
+vhost_user_rx_offload_flush (vlib_main_t * vm, vhost_cpu_t * cpu,
+			     vhost_user_intf_t * vui)
+{
+  u32 i, mtu;
+
+  mtu = vnet_sw_interface_get_mtu (vnet_get_main (), vui->sw_if_index,
+				   VNET_MTU_L3);
+  for (i = 0; i < cpu->rx_offload_len; i++)
+    vhost_user_handle_rx_offload (vlib_get_buffer
+				  (vm, cpu->rx_offload_buffers[i]),
+				  &cpu->rx_offload_hdrs[i], mtu);
+  cpu->rx_offload_len = 0;
+}
+
 /**
  * Try to discard packets from the tx ring (VPP RX path).
  * Returns the number of discarded packets.
@@ -1547,8 +1760,7 @@ static u32
 vhost_user_if_input (vlib_main_t * vm,
 		     vhost_user_main_t * vum,
 		     vhost_user_intf_t * vui,
-		     u16 qid, vlib_node_runtime_t * node,
-		     vnet_hw_interface_rx_mode mode)
+		     u16 qid, vlib_node_runtime_t * node)
 {
   vhost_user_vring_t *txvq = &vui->vrings[VHOST_VRING_IDX_TX (qid)];
   u16 n_rx_packets = 0;
@@ -1573,26 +1785,6 @@ vhost_user_if_input (vlib_main_t * vm,
       vhost_user_send_call (vm, rxvq);
   }
 
-  /*
-   * For adaptive mode, it is optimized to reduce interrupts.
-   * If the scheduler switches the input node to polling due
-   * to burst of traffic, we tell the driver no interrupt.
-   * When the traffic subsides, the scheduler switches the node back to
-   * interrupt mode. We must tell the driver we want interrupt.
-   */
-  if (PREDICT_FALSE (mode == VNET_HW_INTERFACE_RX_MODE_ADAPTIVE))
-    {
-      if ((node->flags &
-	   VLIB_NODE_FLAG_SWITCH_FROM_POLLING_TO_INTERRUPT_MODE) ||
-	  !(node->flags &
-	    VLIB_NODE_FLAG_SWITCH_FROM_INTERRUPT_TO_POLLING_MODE))
-	/* Tell driver we want notification */
-	txvq->used->flags = 0;
-      else
-	/* Tell driver we don't want notification */
-	txvq->used->flags = VRING_USED_F_NO_NOTIFY;
-    }
-
   if (PREDICT_FALSE (txvq->avail->flags & 0xFFFE))
     return 0;
 
@@ -1681,6 +1873,7 @@ vhost_user_if_input (vlib_main_t * vm,
 	  u16 desc_current;
 	  u32 desc_data_offset;
 	  vring_desc_t *desc_table = txvq->desc;
+	  virtio_net_hdr_t *offload_hdr = 0;
 
 	  if (PREDICT_FALSE (vum->cpus[thread_index].rx_buffers_len <= 1))
 	    {
@@ -1748,6 +1941,17 @@ vhost_user_if_input (vlib_main_t * vm,
 		}
 	    }
 
+	  if (PREDICT_FALSE (vui->features &
+			     (1ULL << FEAT_VIRTIO_NET_F_CSUM)))
+	    {
+	      /* the header is at the start of the first descriptor */
+	      virtio_net_hdr_t *hdr =
+		map_guest_mem (vui, desc_table[desc_current].addr,
+			       &map_hint);
+	      if (hdr && (hdr->flags || hdr->gso_type))
+		offload_hdr = hdr;
+	    }
+
 	  if (PREDICT_TRUE (vui->is_any_layout) ||
 	      (!(desc_table[desc_current].flags & VIRTQ_DESC_F_NEXT)))
 	    {
@@ -1840,6 +2044,15 @@ vhost_user_if_input (vlib_main_t * vm,
 	  b_head->total_length_not_including_first_buffer -=
 	    b_head->current_length;
 
+	  if (PREDICT_FALSE (offload_hdr != 0))
+	    {
+	      vhost_cpu_t *cpu = &vum->cpus[thread_index];
+	      cpu->rx_offload_buffers[cpu->rx_offload_len] = to_next[-1];
+	      clib_memcpy (&cpu->rx_offload_hdrs[cpu->rx_offload_len],
+			   offload_hdr, sizeof (virtio_net_hdr_t));
+	      cpu->rx_offload_len++;
+	    }
+
 	  /* consume the descriptor and return it as used */
 	  txvq->last_avail_idx++;
 	  txvq->last_used_idx++;
@@ -1881,6 +2094,10 @@ vhost_user_if_input (vlib_main_t * vm,
 		}
 	      copy_len = 0;
 
+	      if (PREDICT_FALSE (vum->cpus[thread_index].rx_offload_len))
+		vhost_user_rx_offload_flush (vm, &vum->cpus[thread_index],
+					     vui);
+
 	      /* give buffers back to driver */
 	      CLIB_MEMORY_BARRIER ();
 	      txvq->used->idx = txvq->last_used_idx;
@@ -1900,6 +2117,9 @@ vhost_user_if_input (vlib_main_t * vm,
 			VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
     }
 
+  if (PREDICT_FALSE (vum->cpus[thread_index].rx_offload_len))
+    vhost_user_rx_offload_flush (vm, &vum->cpus[thread_index], vui);
+
   /* give buffers back to driver */
   CLIB_MEMORY_BARRIER ();
   txvq->used->idx = txvq->last_used_idx;
@@ -1922,10 +2142,67 @@ vhost_user_if_input (vlib_main_t * vm,
      vlib_get_thread_index (), vui->sw_if_index, n_rx_packets, n_rx_bytes);
 
   vnet_device_increment_rx_packets (thread_index, n_rx_packets);
+  txvq->n_rx_packets += n_rx_packets;
 
   return n_rx_packets;
 }
 
+/**
+ * @brief Per-vring poll/interrupt switching for adaptive mode queues
+ *
+ * vlib decides whether the input node polls at all from the vector rate of
+ * the whole node. Inside a polling node only busy vrings are polled with
+ * guest kicks suppressed; the others keep kicks enabled and are only looked
+ * at when kicked, so a few busy guests do not make the node poll every idle
+ * one. A vring starts polling when a kick brings in adaptive_poll_frames
+ * packets or kicks come in quick succession, and only goes back to kicks
+ * after adaptive_idle_time without packets.
+ */
+static_always_inline void
+vhost_user_adaptive_update (vlib_main_t * vm, vhost_user_main_t * vum,
+			    vlib_node_runtime_t * node,
+			    vnet_device_and_queue_t * dq,
+			    vhost_user_vring_t * txvq, u32 n_rx_packets)
+{
+  f64 now = vlib_time_now (vm);
+  int node_polling = (node->state == VLIB_NODE_STATE_POLLING) &&
+    !(node->flags & VLIB_NODE_FLAG_SWITCH_FROM_POLLING_TO_INTERRUPT_MODE);
+
+  if (txvq->adaptive_polling)
+    {
+      if (n_rx_packets)
+	txvq->adaptive_last_rx = now;
+      if (node_polling &&
+	  now - txvq->adaptive_last_rx < vum->adaptive_idle_time)
+	return;
+
+      /* Idle for too long, or vlib is about to stop polling the node.
+       * Tell driver we want notification */
+      txvq->adaptive_polling = 0;
+      txvq->used->flags = 0;
+      CLIB_MEMORY_BARRIER ();
+      /* catch packets queued before the driver saw the flag */
+      if (txvq->avail->idx != txvq->last_avail_idx)
+	{
+	  dq->interrupt_pending = 1;
+	  vlib_node_set_interrupt_pending (vm, node->node_index);
+	}
+      return;
+    }
+
+  if (node_polling &&
+      (n_rx_packets >= vum->adaptive_poll_frames ||
+       now - txvq->adaptive_last_kick <
+       vum->adaptive_idle_time / VHOST_USER_ADAPTIVE_KICK_RATIO))
+    {
+      /* Tell driver we don't want notification */
+      txvq->adaptive_polling = 1;
+      txvq->used->flags = VRING_USED_F_NO_NOTIFY;
+      txvq->adaptive_last_rx = now;
+    }
+  txvq->adaptive_last_kick = now;
+}
+
 static uword
 vhost_user_input (vlib_main_t * vm,
 		  vlib_node_runtime_t * node, vlib_frame_t * f)
@@ -1933,20 +2210,32 @@ vhost_user_input (vlib_main_t * vm,
   vhost_user_main_t *vum = &vhost_user_main;
   uword n_rx_packets = 0;
   vhost_user_intf_t *vui;
+  vhost_user_vring_t *txvq;
   vnet_device_input_runtime_t *rt =
     (vnet_device_input_runtime_t *) node->runtime_data;
   vnet_device_and_queue_t *dq;
+  int kicked;
+  u32 n;
 
   vec_foreach (dq, rt->devices_and_queues)
   {
-    if (clib_smp_swap (&dq->interrupt_pending, 0) ||
-	(node->state == VLIB_NODE_STATE_POLLING))
+    kicked = clib_smp_swap (&dq->interrupt_pending, 0);
+    if (!kicked && (node->state != VLIB_NODE_STATE_POLLING))
+      continue;
+
+    vui = pool_elt_at_index (vum->vhost_user_interfaces, dq->dev_instance);
+    if (PREDICT_FALSE (dq->mode == VNET_HW_INTERFACE_RX_MODE_ADAPTIVE))
       {
-	vui =
-	  pool_elt_at_index (vum->vhost_user_interfaces, dq->dev_instance);
-	n_rx_packets = vhost_user_if_input (vm, vum, vui, dq->queue_id, node,
-					    dq->mode);
+	txvq = &vui->vrings[VHOST_VRING_IDX_TX (dq->queue_id)];
+	/* an idle adaptive vring waits for its kick */
+	if (!kicked && !txvq->adaptive_polling)
+	  continue;
+	n = vhost_user_if_input (vm, vum, vui, dq->queue_id, node);
+	vhost_user_adaptive_update (vm, vum, node, dq, txvq, n);
       }
+    else
+      n = vhost_user_if_input (vm, vum, vui, dq->queue_id, node);
+    n_rx_packets += n;
   }
 
   return n_rx_packets;
@@ -2056,6 +2345,84 @@ vhost_user_tx_copy (vhost_user_intf_t * vui, vhost_copy_t * cpy,
 }
 
 
+/**
+ * Describe the checksum and segmentation offloads of a packet to the
+ * guest. The L4 checksum field is seeded with the pseudo header sum, as
+ * a device doing the checksum would expect.
+ */
+static_always_inline void
+vhost_user_handle_tx_offload (vlib_buffer_t * b, virtio_net_hdr_t * hdr)
+{
+  u16 l4_offset = vnet_buffer (b)->l4_hdr_offset - b->current_data;
+  tcp_header_t *th = (tcp_header_t *) (b->data +
+				       vnet_buffer (b)->l4_hdr_offset);
+  udp_header_t *uh = (udp_header_t *) th;
+  int is_tcp = (b->flags & (VNET_BUFFER_F_OFFLOAD_TCP_CKSUM |
+			    VNET_BUFFER_F_GSO)) != 0;
+  u16 *csum = is_tcp ? &th->checksum : &uh->checksum;
+  ip_csum_t sum;
+  u32 l4_len;
+
+  if (b->flags & VNET_BUFFER_F_IS_IP4)
+    {
+      ip4_header_t *ip4 = (ip4_header_t *) (b->data +
+					    vnet_buffer (b)->l3_hdr_offset);
+      if (b->flags & VNET_BUFFER_F_OFFLOAD_IP_CKSUM)
+	ip4->checksum = ip4_header_checksum (ip4);
+
+      l4_len = clib_net_to_host_u16 (ip4->length) - ip4_header_bytes (ip4);
+      sum = clib_host_to_net_u32 (l4_len + ((is_tcp ? IP_PROTOCOL_TCP :
+					     IP_PROTOCOL_UDP) << 16));
+      sum = ip_csum_with_carry (sum, clib_mem_unaligned (&ip4->src_address,
+							 u32));
+      sum = ip_csum_with_carry (sum, clib_mem_unaligned (&ip4->dst_address,
+							 u32));
+      hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+    }
+  else if (b->flags & VNET_BUFFER_F_IS_IP6)
+    {
+      ip6_header_t *ip6 = (ip6_header_t *) (b->data +
+					    vnet_buffer (b)->l3_hdr_offset);
+      int i;
+
+      l4_len = clib_net_to_host_u16 (ip6->payload_length) +
+	sizeof (ip6_header_t) -
+	(vnet_buffer (b)->l4_hdr_offset - vnet_buffer (b)->l3_hdr_offset);
+      sum = clib_host_to_net_u32 (l4_len + ((is_tcp ? IP_PROTOCOL_TCP :
+					     IP_PROTOCOL_UDP) << 16));
+      for (i = 0; i < ARRAY_LEN (ip6->src_address.as_uword); i++)
+	{
+	  sum = ip_csum_with_carry
+	    (sum, clib_mem_unaligned (&ip6->src_address.as_uword[i], uword));
+	  sum = ip_csum_with_carry
+	    (sum, clib_mem_unaligned (&ip6->dst_address.as_uword[i], uword));
+	}
+      hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
+    }
+  else
+    {
+      hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+      return;
+    }
+
+  if (b->flags & (VNET_BUFFER_F_OFFLOAD_TCP_CKSUM |
+		  VNET_BUFFER_F_OFFLOAD_UDP_CKSUM | VNET_BUFFER_F_GSO))
+    {
+      *csum = ip_csum_fold (sum);
+      hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+      hdr->csum_start = l4_offset;
+      hdr->csum_offset = (u8 *) csum - (u8 *) th;
+    }
+
+  if (b->flags & VNET_BUFFER_F_GSO)
+    {
+      hdr->hdr_len = l4_offset + tcp_header_bytes (th);
+      hdr->gso_size = vnet_buffer2 (b)->gso_size;
+    }
+  else
+    hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+}
+
 static uword
 vhost_user_tx (vlib_main_t * vm,
 	       vlib_node_runtime_t * node, vlib_frame_t * frame)
@@ -2106,6 +2473,7 @@ retry:
       uword buffer_map_addr;
       u32 buffer_len;
       u16 bytes_left;
+      vhost_copy_t hdr_cpy;
 
       if (PREDICT_TRUE (n_left > 1))
 	vlib_prefetch_buffer_with_index (vm, buffers[1], LOAD);
@@ -2165,12 +2533,19 @@ retry:
 	hdr->hdr.gso_type = 0;
 	hdr->num_buffers = 1;	//This is local, no need to check
 
+	if (PREDICT_FALSE (b0->flags & (VNET_BUFFER_F_OFFLOAD_TCP_CKSUM |
+					VNET_BUFFER_F_OFFLOAD_UDP_CKSUM |
+					VNET_BUFFER_F_OFFLOAD_IP_CKSUM |
+					VNET_BUFFER_F_GSO)))
+	  vhost_user_handle_tx_offload (b0, &hdr->hdr);
+
 	// Prepare a copy order executed later for the header
 	vhost_copy_t *cpy = &vum->cpus[thread_index].copy[copy_len];
 	copy_len++;
 	cpy->len = vui->virtio_net_hdr_sz;
 	cpy->dst = buffer_map_addr;
 	cpy->src = (uword) hdr;
+	hdr_cpy = *cpy;
       }
 
       buffer_map_addr += vui->virtio_net_hdr_sz;
@@ -2252,6 +2627,25 @@ retry:
 		}
 	    }
 
+	  if (PREDICT_FALSE (copy_len >= VHOST_USER_COPY_ARRAY_N - 1))
+	    {
+	      /*
+	       * A GSO packet may need more copies than the array holds.
+	       * Run the pending ones; the header is queued again as its
+	       * num_buffers is not final yet. The guest does not see any
+	       * of it before the used index moves.
+	       */
+	      if (PREDICT_FALSE
+		  (vhost_user_tx_copy (vui, vum->cpus[thread_index].copy,
+				       copy_len, &map_hint)))
+		{
+		  vlib_error_count (vm, node->node_index,
+				    VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL, 1);
+		}
+	      vum->cpus[thread_index].copy[0] = hdr_cpy;
+	      copy_len = 1;
+	    }
+
 	  {
 	    vhost_copy_t *cpy = &vum->cpus[thread_index].copy[copy_len];
 	    copy_len++;
@@ -2480,6 +2874,163 @@ VLIB_REGISTER_NODE (vhost_user_send_interrupt_node,static) = {
 };
 /* *INDENT-ON* */
 
+static void
+vhost_user_rx_queue_move (vlib_main_t * vm, vnet_main_t * vnm,
+			  vhost_user_intf_t * vui, u16 qid,
+			  uword thread_index)
+{
+  vhost_user_vring_t *txvq = &vui->vrings[VHOST_VRING_IDX_TX (qid)];
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, vui->hw_if_index);
+  uword old_thread_index = hw->input_node_thread_index_by_queue[qid];
+  int rv;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  rv = vnet_hw_interface_unassign_rx_thread (vnm, vui->hw_if_index, qid);
+  if (rv)
+    {
+      clib_warning ("Warning: unable to unassign interface %d, "
+		    "queue %d: rc=%d", vui->hw_if_index, qid, rv);
+      goto done;
+    }
+  vnet_hw_interface_assign_rx_thread (vnm, vui->hw_if_index, qid,
+				      thread_index);
+  rv = vnet_hw_interface_set_rx_mode (vnm, vui->hw_if_index, qid,
+				      txvq->mode);
+  if (rv)
+    clib_warning ("Warning: unable to set rx mode for interface %d, "
+		  "queue %d: rc=%d", vui->hw_if_index, qid, rv);
+  vhost_user_adaptive_reset (vnm, vui, qid);
+  if (txvq->mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
+    vhost_user_adaptive_wake (vnm, old_thread_index);
+
+done:
+  vlib_worker_thread_barrier_release (vm);
+}
+
+/**
+ * @brief Move one rx queue from the busiest to the idlest worker
+ *
+ * The queue picked is the one which best halves the gap between the two
+ * workers. A queue carrying more than the whole gap is never moved, as that
+ * would just swap the roles of the two workers. Moving at most one queue
+ * per run, together with the smoothed rates, keeps queues from bouncing.
+ */
+static void
+vhost_user_rx_rebalance (vlib_main_t * vm, f64 dt)
+{
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vhost_user_main_t *vum = &vhost_user_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  vhost_user_intf_t *vui, *best_vui = 0;
+  vhost_user_vring_t *txvq;
+  vnet_hw_interface_t *hw;
+  uword thread_index, tmax, tmin;
+  u64 *load = 0, gap, score, best_score = 0;
+  u16 *queue, best_qid = 0;
+  u32 rate;
+
+  vec_validate (load, vdm->last_worker_thread_index);
+
+  /* *INDENT-OFF* */
+  pool_foreach (vui, vum->vhost_user_interfaces, {
+      hw = vnet_get_hw_interface (vnm, vui->hw_if_index);
+      vec_foreach (queue, vui->rx_queues)
+	{
+	  txvq = &vui->vrings[VHOST_VRING_IDX_TX (*queue)];
+	  rate = (txvq->n_rx_packets - txvq->n_rx_packets_last) / dt;
+	  txvq->n_rx_packets_last = txvq->n_rx_packets;
+	  txvq->rx_rate = (txvq->rx_rate + rate) / 2;
+	  thread_index = hw->input_node_thread_index_by_queue[*queue];
+	  load[thread_index] += txvq->rx_rate;
+	}
+  });
+  /* *INDENT-ON* */
+
+  tmax = tmin = vdm->first_worker_thread_index;
+  for (thread_index = vdm->first_worker_thread_index;
+       thread_index <= vdm->last_worker_thread_index; thread_index++)
+    {
+      if (load[thread_index] > load[tmax])
+	tmax = thread_index;
+      if (load[thread_index] < load[tmin])
+	tmin = thread_index;
+    }
+
+  gap = load[tmax] - load[tmin];
+  if (load[tmax] < VHOST_USER_REBALANCE_MIN_RATE ||
+      gap * 100 < load[tmax] * VHOST_USER_REBALANCE_IMBALANCE_PCT)
+    goto done;
+
+  /* *INDENT-OFF* */
+  pool_foreach (vui, vum->vhost_user_interfaces, {
+      hw = vnet_get_hw_interface (vnm, vui->hw_if_index);
+      vec_foreach (queue, vui->rx_queues)
+	{
+	  if (hw->input_node_thread_index_by_queue[*queue] != tmax)
+	    continue;
+	  txvq = &vui->vrings[VHOST_VRING_IDX_TX (*queue)];
+	  if (txvq->rx_rate >= gap)
+	    continue;
+	  score = clib_min (txvq->rx_rate, gap - txvq->rx_rate);
+	  if (score > best_score)
+	    {
+	      best_score = score;
+	      best_vui = vui;
+	      best_qid = *queue;
+	    }
+	}
+  });
+  /* *INDENT-ON* */
+
+  if (best_vui)
+    vhost_user_rx_queue_move (vm, vnm, best_vui, best_qid, tmin);
+
+done:
+  vec_free (load);
+}
+
+static uword
+vhost_user_rebalance_process (vlib_main_t * vm,
+			      vlib_node_runtime_t * rt, vlib_frame_t * f)
+{
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vhost_user_main_t *vum = &vhost_user_main;
+  f64 now;
+
+  while (1)
+    {
+      /* nothing to balance without interfaces or at least two workers,
+         sleep until an interface gets created */
+      if (vum->rebalance_interval <= 0.0 ||
+	  vdm->first_worker_thread_index == 0 ||
+	  vdm->last_worker_thread_index == vdm->first_worker_thread_index ||
+	  pool_elts (vum->vhost_user_interfaces) == 0)
+	{
+	  vlib_process_wait_for_event (vm);
+	  vlib_process_get_events (vm, 0);
+	  vum->rebalance_last_time = vlib_time_now (vm);
+	  continue;
+	}
+
+      vlib_process_suspend (vm, vum->rebalance_interval);
+
+      now = vlib_time_now (vm);
+      if (now > vum->rebalance_last_time)
+	vhost_user_rx_rebalance (vm, now - vum->rebalance_last_time);
+      vum->rebalance_last_time = now;
+    }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (vhost_user_rebalance_node,static) = {
+    .function = vhost_user_rebalance_process,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "vhost-user-rebalance-process",
+};
+/* *INDENT-ON* */
+
 static clib_error_t *
 vhost_user_interface_rx_mode_change (vnet_main_t * vnm, u32 hw_if_index,
 				     u32 qid, vnet_hw_interface_rx_mode mode)
@@ -2527,6 +3078,12 @@ vhost_user_interface_rx_mode_change (vnet_main_t * vnm, u32 hw_if_index,
 	}
     }
 
+  vhost_user_adaptive_reset (vnm, vui, qid);
+  if (txvq->mode == VNET_HW_INTERFACE_RX_MODE_POLLING &&
+      mode != VNET_HW_INTERFACE_RX_MODE_POLLING)
+    vhost_user_adaptive_wake (vnm,
+			      hif->input_node_thread_index_by_queue[qid]);
+
   txvq->mode = mode;
   if (mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
     txvq->used->flags = VRING_USED_F_NO_NOTIFY;
@@ -2715,6 +3272,9 @@ vhost_user_term_if (vhost_user_intf_t * vui)
 
   mhash_unset (&vum->if_index_by_sock_name, vui->sock_filename,
 	       &vui->if_index);
+
+  if (vui->enable_gso)
+    vnet_get_main ()->interface_main.gso_interface_count--;
 }
 
 int
@@ -2878,7 +3438,7 @@ vhost_user_vui_init (vnet_main_t * vnm,
 		     vhost_user_intf_t * vui,
 		     int server_sock_fd,
 		     const char *sock_filename,
-		     u64 feature_mask, u32 * sw_if_index)
+		     u64 feature_mask, u32 * sw_if_index, u8 enable_gso)
 {
   vnet_sw_interface_t *sw;
   int q;
@@ -2906,6 +3466,7 @@ vhost_user_vui_init (vnet_main_t * vnm,
   vui->sock_errno = 0;
   vui->is_up = 0;
   vui->feature_mask = feature_mask;
+  vui->enable_gso = enable_gso;
   vui->clib_file_index = ~0;
   vui->log_base_addr = 0;
   vui->if_index = vui - vum->vhost_user_interfaces;
@@ -2918,6 +3479,10 @@ vhost_user_vui_init (vnet_main_t * vnm,
   hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_INT_MODE;
   vnet_hw_interface_set_flags (vnm, vui->hw_if_index, 0);
 
+  /* GSO packets from the guest may go to any interface */
+  if (enable_gso)
+    vnm->interface_main.gso_interface_count++;
+
   if (sw_if_index)
     *sw_if_index = vui->sw_if_index;
 
@@ -2939,7 +3504,8 @@ vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 		      u8 is_server,
 		      u32 * sw_if_index,
 		      u64 feature_mask,
-		      u8 renumber, u32 custom_dev_instance, u8 * hwaddr)
+		      u8 renumber, u32 custom_dev_instance, u8 * hwaddr,
+		      u8 enable_gso)
 {
   vhost_user_intf_t *vui = NULL;
   u32 sw_if_idx = ~0;
@@ -2977,7 +3543,7 @@ vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 
   vhost_user_create_ethernet (vnm, vm, vui, hwaddr);
   vhost_user_vui_init (vnm, vui, server_sock_fd, sock_filename,
-		       feature_mask, &sw_if_idx);
+		       feature_mask, &sw_if_idx, enable_gso);
 
   if (renumber)
     vnet_interface_name_renumber (sw_if_idx, custom_dev_instance);
@@ -2987,6 +3553,7 @@ vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 
   // Process node must connect
   vlib_process_signal_event (vm, vhost_user_process_node.index, 0, 0);
+  vlib_process_signal_event (vm, vhost_user_rebalance_node.index, 0, 0);
 
   return rv;
 }
@@ -2996,7 +3563,8 @@ vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 		      const char *sock_filename,
 		      u8 is_server,
 		      u32 sw_if_index,
-		      u64 feature_mask, u8 renumber, u32 custom_dev_instance)
+		      u64 feature_mask, u8 renumber, u32 custom_dev_instance,
+		      u8 enable_gso)
 {
   vhost_user_main_t *vum = &vhost_user_main;
   vhost_user_intf_t *vui = NULL;
@@ -3031,7 +3599,7 @@ vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 
   vhost_user_term_if (vui);
   vhost_user_vui_init (vnm, vui, server_sock_fd,
-		       sock_filename, feature_mask, &sw_if_idx);
+		       sock_filename, feature_mask, &sw_if_idx, enable_gso);
 
   if (renumber)
     vnet_interface_name_renumber (sw_if_idx, custom_dev_instance);
@@ -3056,6 +3624,7 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
   u32 custom_dev_instance = ~0;
   u8 hwaddr[6];
   u8 *hw = NULL;
+  u8 enable_gso = 0;
   clib_error_t *error = NULL;
 
   /* Get a line of input. */
@@ -3078,6 +3647,8 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
 	{
 	  renumber = 1;
 	}
+      else if (unformat (line_input, "gso"))
+	enable_gso = 1;
       else
 	{
 	  error = clib_error_return (0, "unknown input `%U'",
@@ -3091,7 +3662,8 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
   int rv;
   if ((rv = vhost_user_create_if (vnm, vm, (char *) sock_filename,
 				  is_server, &sw_if_index, feature_mask,
-				  renumber, custom_dev_instance, hw)))
+				  renumber, custom_dev_instance, hw,
+				  enable_gso)))
     {
       error = clib_error_return (0, "vhost_user_create_if returned %d", rv);
       goto done;
@@ -3279,6 +3851,9 @@ show_vhost_user_command_fn (vlib_main_t * vm,
 		   vum->coalesce_frames, vum->coalesce_time);
   vlib_cli_output (vm, "  number of rx virtqueues in interrupt mode: %d",
 		   vum->ifq_count);
+  vlib_cli_output (vm, "  adaptive poll frames %d idle time %e",
+		   vum->adaptive_poll_frames, vum->adaptive_idle_time);
+  vlib_cli_output (vm, "  rx rebalance interval %e", vum->rebalance_interval);
 
   for (i = 0; i < vec_len (hw_if_indices); i++)
     {
@@ -3292,6 +3867,8 @@ show_vhost_user_command_fn (vlib_main_t * vm,
 		       " features (0x%llx): \n",
 		       vui->virtio_net_hdr_sz, vui->feature_mask,
 		       vui->features);
+      if (vui->enable_gso)
+	vlib_cli_output (vm, " gso enabled");
 
       feat_entry = (struct feat_struct *) &feat_array;
       while (feat_entry->str)
@@ -3327,14 +3904,18 @@ show_vhost_user_command_fn (vlib_main_t * vm,
 	vnet_main_t *vnm = vnet_get_main ();
 	uword thread_index;
 	vnet_hw_interface_rx_mode mode;
+	vhost_user_vring_t *txvq = &vui->vrings[VHOST_VRING_IDX_TX (*queue)];
 
 	thread_index = vnet_get_device_input_thread_index (vnm,
 							   vui->hw_if_index,
 							   *queue);
 	vnet_hw_interface_get_rx_mode (vnm, vui->hw_if_index, *queue, &mode);
-	vlib_cli_output (vm, "   thread %d on vring %d, %U\n",
+	vlib_cli_output (vm, "   thread %d on vring %d, %U%s, %u pps\n",
 			 thread_index, VHOST_VRING_IDX_TX (*queue),
-			 format_vnet_hw_interface_rx_mode, mode);
+			 format_vnet_hw_interface_rx_mode, mode,
+			 (mode != VNET_HW_INTERFACE_RX_MODE_ADAPTIVE) ? "" :
+			 txvq->adaptive_polling ? " (polling)" :
+			 " (interrupt)", txvq->rx_rate);
       }
 
       vlib_cli_output (vm, " tx placement: %s\n",
@@ -3454,6 +4035,12 @@ done:
  * startup. <b>This is intended for degugging only.</b> It is recommended that this
  * parameter not be used except by experienced users. By default, all supported
  * features will be advertised. Otherwise, provide the set of features desired.
+ *   - 0x000000001 (0)  - VIRTIO_NET_F_CSUM
+ *   - 0x000000002 (1)  - VIRTIO_NET_F_GUEST_CSUM
+ *   - 0x000000080 (7)  - VIRTIO_NET_F_GUEST_TSO4 (with gso only)
+ *   - 0x000000100 (8)  - VIRTIO_NET_F_GUEST_TSO6 (with gso only)
+ *   - 0x000000800 (11) - VIRTIO_NET_F_HOST_TSO4 (with gso only)
+ *   - 0x000001000 (12) - VIRTIO_NET_F_HOST_TSO6 (with gso only)
  *   - 0x000008000 (15) - VIRTIO_NET_F_MRG_RXBUF
  *   - 0x000020000 (17) - VIRTIO_NET_F_CTRL_VQ
  *   - 0x000200000 (21) - VIRTIO_NET_F_GUEST_ANNOUNCE
@@ -3464,6 +4051,11 @@ done:
  *   - 0x040000000 (30) - VHOST_USER_F_PROTOCOL_FEATURES
  *   - 0x100000000 (32) - VIRTIO_F_VERSION_1
  *
+ * - <b>gso</b> - Optional flag to advertise TCP segmentation offload to the
+ * guest. Large TCP packets from the guest are then carried through VPP in
+ * one buffer chain and only segmented when the egress interface can not do
+ * it; large packets are passed to the guest as they are.
+ *
  * - <b>hwaddr <mac-addr></b> - Optional ethernet address, can be in either
  * X:X:X:X:X:X unix or X.X.X cisco format.
  *
@@ -3488,7 +4080,8 @@ done:
 VLIB_CLI_COMMAND (vhost_user_connect_command, static) = {
     .path = "create vhost-user",
     .short_help = "create vhost-user socket <socket-filename> [server] "
-    "[feature-mask <hex>] [hwaddr <mac-addr>] [renumber <dev_instance>] ",
+    "[feature-mask <hex>] [hwaddr <mac-addr>] [renumber <dev_instance>] "
+    "[gso]",
     .function = vhost_user_connect_command_fn,
 };
 /* *INDENT-ON* */
@@ -3525,6 +4118,9 @@ VLIB_CLI_COMMAND (vhost_user_delete_command, static) = {
  * Virtio vhost-user interfaces
  * Global:
  *   coalesce frames 32 time 1e-3
+ *   number of rx virtqueues in interrupt mode: 2
+ *   adaptive poll frames 32 idle time 1e-3
+ *   rx rebalance interval 1e0
  * Interface: VirtualEthernet0/0/0 (ifindex 1)
  * virtio_net_hdr_sz 12
  *  features mask (0xffffffffffffffff):
@@ -3540,10 +4136,10 @@ VLIB_CLI_COMMAND (vhost_user_delete_command, static) = {
  *  socket filename /var/run/vpp/vhost1.sock type client errno "Success"
  *
  * rx placement:
- *    thread 1 on vring 1
- *    thread 1 on vring 5
- *    thread 2 on vring 3
- *    thread 2 on vring 7
+ *    thread 1 on vring 1, polling, 1488095 pps
+ *    thread 1 on vring 5, adaptive (interrupt), 12 pps
+ *    thread 2 on vring 3, adaptive (polling), 1376412 pps
+ *    thread 2 on vring 7, polling, 0 pps
  *  tx placement: spin-lock
  *    thread 0 on vring 0
  *    thread 1 on vring 2
@@ -3722,6 +4318,15 @@ vhost_user_config (vlib_main_t * vm, unformat_input_t * input)
 	;
       else if (unformat (input, "coalesce-time %f", &vum->coalesce_time))
 	;
+      else if (unformat (input, "adaptive-poll-frames %d",
+			 &vum->adaptive_poll_frames))
+	;
+      else if (unformat (input, "adaptive-idle-time %f",
+			 &vum->adaptive_idle_time))
+	;
+      else if (unformat (input, "rebalance-interval %f",
+			 &vum->rebalance_interval))
+	;
       else if (unformat (input, "dont-dump-memory"))
 	vum->dont_dump_vhost_user_memory = 1;
       else
@@ -46,6 +46,12 @@
 #define VRING_AVAIL_F_NO_INTERRUPT 1
 
 #define foreach_virtio_net_feature      \
+ _ (VIRTIO_NET_F_CSUM, 0)               \
+ _ (VIRTIO_NET_F_GUEST_CSUM, 1)         \
+ _ (VIRTIO_NET_F_GUEST_TSO4, 7)         \
+ _ (VIRTIO_NET_F_GUEST_TSO6, 8)         \
+ _ (VIRTIO_NET_F_HOST_TSO4, 11)         \
+ _ (VIRTIO_NET_F_HOST_TSO6, 12)         \
  _ (VIRTIO_NET_F_MRG_RXBUF, 15)         \
  _ (VIRTIO_NET_F_CTRL_VQ, 17)           \
  _ (VIRTIO_NET_F_GUEST_ANNOUNCE, 21)    \
@@ -64,14 +70,38 @@ typedef enum
 #undef _
 } virtio_net_feature_t;
 
+/* checksum offload, always advertised */
+#define VHOST_USER_CSUM_FEATURES			\
+  ((1ULL << FEAT_VIRTIO_NET_F_CSUM) |			\
+   (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM))
+
+/* TCP segmentation offload, advertised on interfaces created with gso */
+#define VHOST_USER_GSO_FEATURES				\
+  ((1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO4) |		\
+   (1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO6) |		\
+   (1ULL << FEAT_VIRTIO_NET_F_HOST_TSO4) |		\
+   (1ULL << FEAT_VIRTIO_NET_F_HOST_TSO6))
+
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	1
+
+#define VIRTIO_NET_HDR_GSO_NONE		0
+#define VIRTIO_NET_HDR_GSO_TCPV4	1
+#define VIRTIO_NET_HDR_GSO_TCPV6	4
+#define VIRTIO_NET_HDR_GSO_ECN		0x80
+
+/* smallest segment size taken from a guest, as the linux stack does */
+#define VHOST_USER_MIN_GSO_SIZE		64
+
 int vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  const char *sock_filename, u8 is_server,
 			  u32 * sw_if_index, u64 feature_mask,
-			  u8 renumber, u32 custom_dev_instance, u8 * hwaddr);
+			  u8 renumber, u32 custom_dev_instance, u8 * hwaddr,
+			  u8 enable_gso);
 int vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  const char *sock_filename, u8 is_server,
 			  u32 sw_if_index, u64 feature_mask,
-			  u8 renumber, u32 custom_dev_instance);
+			  u8 renumber, u32 custom_dev_instance,
+			  u8 enable_gso);
 int vhost_user_delete_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  u32 sw_if_index);
 
@@ -203,6 +233,15 @@ typedef struct
   u8 started;
   u8 enabled;
   u8 log_used;
+
+  /* Adaptive mode: set while the vring is polled with guest kicks
+   * suppressed, clear while it waits for kicks */
+  u8 adaptive_polling;
+  f64 adaptive_last_rx;
+  f64 adaptive_last_kick;
+
+  /* Packets received on this vring, read by the rx rebalancer */
+  u64 n_rx_packets;
   //Put non-runtime in a different cache line
     CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
   int errfd;
@@ -212,11 +251,24 @@ typedef struct
 
   /* The rx queue policy (interrupt/adaptive/polling) for this queue */
   u32 mode;
+
+  /* Smoothed receive rate in packets/sec, owned by the rx rebalancer */
+  u64 n_rx_packets_last;
+  u32 rx_rate;
 } vhost_user_vring_t;
 
 #define VHOST_USER_EVENT_START_TIMER 1
 #define VHOST_USER_EVENT_STOP_TIMER  2
 
+/* Adaptive vrings also start polling when kicks arrive closer together
+ * than adaptive_idle_time / VHOST_USER_ADAPTIVE_KICK_RATIO */
+#define VHOST_USER_ADAPTIVE_KICK_RATIO 4
+
+/* The rebalancer leaves workers alone below this rate (packets/sec) or when
+ * the busiest and idlest workers are within this percentage */
+#define VHOST_USER_REBALANCE_MIN_RATE 100000
+#define VHOST_USER_REBALANCE_IMBALANCE_PCT 25
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -249,6 +301,9 @@ typedef struct
   int virtio_net_hdr_sz;
   int is_any_layout;
 
+  /* Advertise TCP segmentation offload to the guest */
+  u8 enable_gso;
+
   void *log_base_addr;
   u64 log_size;
 
@@ -288,6 +343,12 @@ typedef struct
   virtio_net_hdr_mrg_rxbuf_t tx_headers[VLIB_FRAME_SIZE];
   vhost_copy_t copy[VHOST_USER_COPY_ARRAY_N];
 
+  /* Received packets with checksum or segmentation offload requests,
+   * applied once the packet data has been copied */
+  u32 rx_offload_len;
+  u32 rx_offload_buffers[VLIB_FRAME_SIZE];
+  virtio_net_hdr_t rx_offload_hdrs[VLIB_FRAME_SIZE];
+
   /* This is here so it doesn't end-up
    * using stack or registers. */
   vhost_trace_t *current_trace;
@@ -312,6 +373,15 @@ typedef struct
   /* The number of rx interface/queue pairs in interrupt mode */
   u32 ifq_count;
 
+  /* Adaptive mode: a vring starts polling after a kick delivers this many
+   * packets, and goes back to interrupts after adaptive_idle_time */
+  u32 adaptive_poll_frames;
+  f64 adaptive_idle_time;
+
+  /* Seconds between rx queue rebalancing runs, 0 disables rebalancing */
+  f64 rebalance_interval;
+  f64 rebalance_last_time;
+
   /* debug on or off */
   u8 debug;
 } vhost_user_main_t;
@@ -69,6 +69,12 @@ validate_geneve_fib (vlib_buffer_t * b, geneve_tunnel_t * t, u32 is_ip4)
   return (fib_index == t->encap_fib_index);
 }
 
+static_always_inline u32
+geneve_tunnel_id (void *h)
+{
+  return vnet_get_geneve_vni_bigendian (h);
+}
+
 always_inline uword
 geneve_input (vlib_main_t * vm,
 	      vlib_node_runtime_t * node,
@@ -78,21 +84,17 @@ geneve_input (vlib_main_t * vm,
   geneve_main_t *vxm = &geneve_main;
   vnet_main_t *vnm = vxm->vnet_main;
   vnet_interface_main_t *im = &vnm->interface_main;
-  u32 last_tunnel_index = ~0;
-  geneve4_tunnel_key_t last_key4;
-  geneve6_tunnel_key_t last_key6;
+  u32 tunnel_indices[VLIB_FRAME_SIZE], *ti = tunnel_indices;
   u32 pkts_decapsulated = 0;
   u32 thread_index = vlib_get_thread_index ();
   u32 stats_sw_if_index, stats_n_packets, stats_n_bytes;
 
-  if (is_ip4)
-    last_key4.as_u64 = ~0;
-  else
-    memset (&last_key6, 0xff, sizeof (last_key6));
-
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
 
+  udp_tunnel_demux_lookup_buffers (vm, &vxm->tunnel_demux, from, n_left_from,
+				   tunnel_indices, is_ip4, geneve_tunnel_id);
+
   next_index = node->cached_next_index;
   stats_sw_if_index = node->runtime_data[0];
   stats_n_packets = stats_n_bytes = 0;
@@ -110,7 +112,7 @@ geneve_input (vlib_main_t * vm,
 	  ip4_header_t *ip4_0, *ip4_1;
 	  ip6_header_t *ip6_0, *ip6_1;
 	  geneve_header_t *geneve0, *geneve1;
-	  uword *p0, *p1;
+	  u32 mcast_index0, mcast_index1;
 	  u32 tunnel_index0, tunnel_index1;
 	  geneve_tunnel_t *t0, *t1, *mt0 = NULL, *mt1 = NULL;
 	  geneve4_tunnel_key_t key4_0, key4_1;
@@ -219,24 +221,14 @@ geneve_input (vlib_main_t * vm,
 #endif
 	  if (is_ip4)
 	    {
-	      key4_0.remote = ip4_0->src_address.as_u32;
-	      key4_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
-
 	      /* Make sure GENEVE tunnel exist according to packet SIP and VNI */
-	      if (PREDICT_FALSE (key4_0.as_u64 != last_key4.as_u64))
+	      tunnel_index0 = ti[0];
+	      if (PREDICT_FALSE (tunnel_index0 == ~0))
 		{
-		  p0 = hash_get (vxm->geneve4_tunnel_by_key, key4_0.as_u64);
-		  if (PREDICT_FALSE (p0 == NULL))
-		    {
-		      error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
-		      next0 = GENEVE_INPUT_NEXT_DROP;
-		      goto trace0;
-		    }
-		  last_key4.as_u64 = key4_0.as_u64;
-		  tunnel_index0 = last_tunnel_index = p0[0];
+		  error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
+		  next0 = GENEVE_INPUT_NEXT_DROP;
+		  goto trace0;
 		}
-	      else
-		tunnel_index0 = last_tunnel_index;
 	      t0 = pool_elt_at_index (vxm->tunnels, tunnel_index0);
 
 	      /* Validate GENEVE tunnel encap-fib index agaist packet */
@@ -257,10 +249,12 @@ geneve_input (vlib_main_t * vm,
 		  key4_0.remote = ip4_0->dst_address.as_u32;
 		  key4_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
 		  /* Make sure mcast GENEVE tunnel exist by packet DIP and VNI */
-		  p0 = hash_get (vxm->geneve4_tunnel_by_key, key4_0.as_u64);
-		  if (PREDICT_TRUE (p0 != NULL))
+		  mcast_index0 =
+		    udp_tunnel_demux_find4 (&vxm->tunnel_demux,
+					    key4_0.remote, key4_0.vni);
+		  if (PREDICT_TRUE (mcast_index0 != ~0))
 		    {
-		      mt0 = pool_elt_at_index (vxm->tunnels, p0[0]);
+		      mt0 = pool_elt_at_index (vxm->tunnels, mcast_index0);
 		      goto next0;	/* valid packet */
 		    }
 		}
@@ -271,26 +265,14 @@ geneve_input (vlib_main_t * vm,
 	    }
 	  else			/* !is_ip4 */
 	    {
-	      key6_0.remote.as_u64[0] = ip6_0->src_address.as_u64[0];
-	      key6_0.remote.as_u64[1] = ip6_0->src_address.as_u64[1];
-	      key6_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
-
 	      /* Make sure GENEVE tunnel exist according to packet SIP and VNI */
-	      if (PREDICT_FALSE
-		  (memcmp (&key6_0, &last_key6, sizeof (last_key6)) != 0))
+	      tunnel_index0 = ti[0];
+	      if (PREDICT_FALSE (tunnel_index0 == ~0))
 		{
-		  p0 = hash_get_mem (vxm->geneve6_tunnel_by_key, &key6_0);
-		  if (PREDICT_FALSE (p0 == NULL))
-		    {
-		      error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
-		      next0 = GENEVE_INPUT_NEXT_DROP;
-		      goto trace0;
-		    }
-		  clib_memcpy (&last_key6, &key6_0, sizeof (key6_0));
-		  tunnel_index0 = last_tunnel_index = p0[0];
+		  error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
+		  next0 = GENEVE_INPUT_NEXT_DROP;
+		  goto trace0;
 		}
-	      else
-		tunnel_index0 = last_tunnel_index;
 	      t0 = pool_elt_at_index (vxm->tunnels, tunnel_index0);
 
 	      /* Validate GENEVE tunnel encap-fib index agaist packet */
@@ -311,10 +293,12 @@ geneve_input (vlib_main_t * vm,
 		  key6_0.remote.as_u64[0] = ip6_0->dst_address.as_u64[0];
 		  key6_0.remote.as_u64[1] = ip6_0->dst_address.as_u64[1];
 		  key6_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
-		  p0 = hash_get_mem (vxm->geneve6_tunnel_by_key, &key6_0);
-		  if (PREDICT_TRUE (p0 != NULL))
+		  mcast_index0 =
+		    udp_tunnel_demux_find6 (&vxm->tunnel_demux,
+					    &key6_0.remote, key6_0.vni);
+		  if (PREDICT_TRUE (mcast_index0 != ~0))
 		    {
-		      mt0 = pool_elt_at_index (vxm->tunnels, p0[0]);
+		      mt0 = pool_elt_at_index (vxm->tunnels, mcast_index0);
 		      goto next0;	/* valid packet */
 		    }
 		}
@@ -386,24 +370,14 @@ geneve_input (vlib_main_t * vm,
 #endif
 	  if (is_ip4)
 	    {
-	      key4_1.remote = ip4_1->src_address.as_u32;
-	      key4_1.vni = vnet_get_geneve_vni_bigendian (geneve1);
-
 	      /* Make sure unicast GENEVE tunnel exist by packet SIP and VNI */
-	      if (PREDICT_FALSE (key4_1.as_u64 != last_key4.as_u64))
+	      tunnel_index1 = ti[1];
+	      if (PREDICT_FALSE (tunnel_index1 == ~0))
 		{
-		  p1 = hash_get (vxm->geneve4_tunnel_by_key, key4_1.as_u64);
-		  if (PREDICT_FALSE (p1 == NULL))
-		    {
-		      error1 = GENEVE_ERROR_NO_SUCH_TUNNEL;
-		      next1 = GENEVE_INPUT_NEXT_DROP;
-		      goto trace1;
-		    }
-		  last_key4.as_u64 = key4_1.as_u64;
-		  tunnel_index1 = last_tunnel_index = p1[0];
+		  error1 = GENEVE_ERROR_NO_SUCH_TUNNEL;
+		  next1 = GENEVE_INPUT_NEXT_DROP;
+		  goto trace1;
 		}
-	      else
-		tunnel_index1 = last_tunnel_index;
 	      t1 = pool_elt_at_index (vxm->tunnels, tunnel_index1);
 
 	      /* Validate GENEVE tunnel encap-fib index agaist packet */
@@ -424,10 +398,12 @@ geneve_input (vlib_main_t * vm,
 		  key4_1.remote = ip4_1->dst_address.as_u32;
 		  key4_1.vni = vnet_get_geneve_vni_bigendian (geneve1);
 		  /* Make sure mcast GENEVE tunnel exist by packet DIP and VNI */
-		  p1 = hash_get (vxm->geneve4_tunnel_by_key, key4_1.as_u64);
-		  if (PREDICT_TRUE (p1 != NULL))
+		  mcast_index1 =
+		    udp_tunnel_demux_find4 (&vxm->tunnel_demux,
+					    key4_1.remote, key4_1.vni);
+		  if (PREDICT_TRUE (mcast_index1 != ~0))
 		    {
-		      mt1 = pool_elt_at_index (vxm->tunnels, p1[0]);
+		      mt1 = pool_elt_at_index (vxm->tunnels, mcast_index1);
 		      goto next1;	/* valid packet */
 		    }
 		}
@@ -438,28 +414,14 @@ geneve_input (vlib_main_t * vm,
 	    }
 	  else			/* !is_ip4 */
 	    {
-	      key6_1.remote.as_u64[0] = ip6_1->src_address.as_u64[0];
-	      key6_1.remote.as_u64[1] = ip6_1->src_address.as_u64[1];
-	      key6_1.vni = vnet_get_geneve_vni_bigendian (geneve1);
-
 	      /* Make sure GENEVE tunnel exist according to packet SIP and VNI */
-	      if (PREDICT_FALSE
-		  (memcmp (&key6_1, &last_key6, sizeof (last_key6)) != 0))
+	      tunnel_index1 = ti[1];
+	      if (PREDICT_FALSE (tunnel_index1 == ~0))
 		{
-		  p1 = hash_get_mem (vxm->geneve6_tunnel_by_key, &key6_1);
-
-		  if (PREDICT_FALSE (p1 == NULL))
-		    {
-		      error1 = GENEVE_ERROR_NO_SUCH_TUNNEL;
-		      next1 = GENEVE_INPUT_NEXT_DROP;
-		      goto trace1;
-		    }
-
-		  clib_memcpy (&last_key6, &key6_1, sizeof (key6_1));
-		  tunnel_index1 = last_tunnel_index = p1[0];
+		  error1 = GENEVE_ERROR_NO_SUCH_TUNNEL;
+		  next1 = GENEVE_INPUT_NEXT_DROP;
+		  goto trace1;
 		}
-	      else
-		tunnel_index1 = last_tunnel_index;
 	      t1 = pool_elt_at_index (vxm->tunnels, tunnel_index1);
 
 	      /* Validate GENEVE tunnel encap-fib index agaist packet */
@@ -480,10 +442,12 @@ geneve_input (vlib_main_t * vm,
 		  key6_1.remote.as_u64[0] = ip6_1->dst_address.as_u64[0];
 		  key6_1.remote.as_u64[1] = ip6_1->dst_address.as_u64[1];
 		  key6_1.vni = vnet_get_geneve_vni_bigendian (geneve1);
-		  p1 = hash_get_mem (vxm->geneve6_tunnel_by_key, &key6_1);
-		  if (PREDICT_TRUE (p1 != NULL))
+		  mcast_index1 =
+		    udp_tunnel_demux_find6 (&vxm->tunnel_demux,
+					    &key6_1.remote, key6_1.vni);
+		  if (PREDICT_TRUE (mcast_index1 != ~0))
 		    {
-		      mt1 = pool_elt_at_index (vxm->tunnels, p1[0]);
+		      mt1 = pool_elt_at_index (vxm->tunnels, mcast_index1);
 		      goto next1;	/* valid packet */
 		    }
 		}
@@ -538,6 +502,8 @@ geneve_input (vlib_main_t * vm,
 	      tr->vni_rsvd = vnet_get_geneve_vni (geneve1);
 	    }
 
+	  ti += 2;
+
 	  vlib_validate_buffer_enqueue_x2 (vm, node, next_index,
 					   to_next, n_left_to_next,
 					   bi0, bi1, next0, next1);
@@ -551,7 +517,7 @@ geneve_input (vlib_main_t * vm,
 	  ip4_header_t *ip4_0;
 	  ip6_header_t *ip6_0;
 	  geneve_header_t *geneve0;
-	  uword *p0;
+	  u32 mcast_index0;
 	  u32 tunnel_index0;
 	  geneve_tunnel_t *t0, *mt0 = NULL;
 	  geneve4_tunnel_key_t key4_0;
@@ -623,24 +589,14 @@ geneve_input (vlib_main_t * vm,
 #endif
 	  if (is_ip4)
 	    {
-	      key4_0.remote = ip4_0->src_address.as_u32;
-	      key4_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
-
 	      /* Make sure unicast GENEVE tunnel exist by packet SIP and VNI */
-	      if (PREDICT_FALSE (key4_0.as_u64 != last_key4.as_u64))
+	      tunnel_index0 = ti[0];
+	      if (PREDICT_FALSE (tunnel_index0 == ~0))
 		{
-		  p0 = hash_get (vxm->geneve4_tunnel_by_key, key4_0.as_u64);
-		  if (PREDICT_FALSE (p0 == NULL))
-		    {
-		      error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
-		      next0 = GENEVE_INPUT_NEXT_DROP;
-		      goto trace00;
-		    }
-		  last_key4.as_u64 = key4_0.as_u64;
-		  tunnel_index0 = last_tunnel_index = p0[0];
+		  error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
+		  next0 = GENEVE_INPUT_NEXT_DROP;
+		  goto trace00;
 		}
-	      else
-		tunnel_index0 = last_tunnel_index;
 	      t0 = pool_elt_at_index (vxm->tunnels, tunnel_index0);
 
 	      /* Validate GENEVE tunnel encap-fib index agaist packet */
@@ -661,10 +617,12 @@ geneve_input (vlib_main_t * vm,
 		  key4_0.remote = ip4_0->dst_address.as_u32;
 		  key4_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
 		  /* Make sure mcast GENEVE tunnel exist by packet DIP and VNI */
-		  p0 = hash_get (vxm->geneve4_tunnel_by_key, key4_0.as_u64);
-		  if (PREDICT_TRUE (p0 != NULL))
+		  mcast_index0 =
+		    udp_tunnel_demux_find4 (&vxm->tunnel_demux,
+					    key4_0.remote, key4_0.vni);
+		  if (PREDICT_TRUE (mcast_index0 != ~0))
 		    {
-		      mt0 = pool_elt_at_index (vxm->tunnels, p0[0]);
+		      mt0 = pool_elt_at_index (vxm->tunnels, mcast_index0);
 		      goto next00;	/* valid packet */
 		    }
 		}
@@ -675,26 +633,14 @@ geneve_input (vlib_main_t * vm,
 	    }
 	  else			/* !is_ip4 */
 	    {
-	      key6_0.remote.as_u64[0] = ip6_0->src_address.as_u64[0];
-	      key6_0.remote.as_u64[1] = ip6_0->src_address.as_u64[1];
-	      key6_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
-
 	      /* Make sure GENEVE tunnel exist according to packet SIP and VNI */
-	      if (PREDICT_FALSE
-		  (memcmp (&key6_0, &last_key6, sizeof (last_key6)) != 0))
+	      tunnel_index0 = ti[0];
+	      if (PREDICT_FALSE (tunnel_index0 == ~0))
 		{
-		  p0 = hash_get_mem (vxm->geneve6_tunnel_by_key, &key6_0);
-		  if (PREDICT_FALSE (p0 == NULL))
-		    {
-		      error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
-		      next0 = GENEVE_INPUT_NEXT_DROP;
-		      goto trace00;
-		    }
-		  clib_memcpy (&last_key6, &key6_0, sizeof (key6_0));
-		  tunnel_index0 = last_tunnel_index = p0[0];
+		  error0 = GENEVE_ERROR_NO_SUCH_TUNNEL;
+		  next0 = GENEVE_INPUT_NEXT_DROP;
+		  goto trace00;
 		}
-	      else
-		tunnel_index0 = last_tunnel_index;
 	      t0 = pool_elt_at_index (vxm->tunnels, tunnel_index0);
 
 	      /* Validate GENEVE tunnel encap-fib index agaist packet */
@@ -715,10 +661,12 @@ geneve_input (vlib_main_t * vm,
 		  key6_0.remote.as_u64[0] = ip6_0->dst_address.as_u64[0];
 		  key6_0.remote.as_u64[1] = ip6_0->dst_address.as_u64[1];
 		  key6_0.vni = vnet_get_geneve_vni_bigendian (geneve0);
-		  p0 = hash_get_mem (vxm->geneve6_tunnel_by_key, &key6_0);
-		  if (PREDICT_TRUE (p0 != NULL))
+		  mcast_index0 =
+		    udp_tunnel_demux_find6 (&vxm->tunnel_demux,
+					    &key6_0.remote, key6_0.vni);
+		  if (PREDICT_TRUE (mcast_index0 != ~0))
 		    {
-		      mt0 = pool_elt_at_index (vxm->tunnels, p0[0]);
+		      mt0 = pool_elt_at_index (vxm->tunnels, mcast_index0);
 		      goto next00;	/* valid packet */
 		    }
 		}
@@ -772,6 +720,8 @@ geneve_input (vlib_main_t * vm,
 	      tr->tunnel_index = tunnel_index0;
 	      tr->vni_rsvd = vnet_get_geneve_vni (geneve0);
 	    }
+	  ti += 1;
+
 	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
 					   to_next, n_left_to_next,
 					   bi0, next0);
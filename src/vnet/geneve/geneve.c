@@ -201,26 +201,29 @@ geneve_rewrite (geneve_tunnel_t * t, bool is_ip6)
 {
   union
   {
-    ip4_geneve_header_t *h4;
-    ip6_geneve_header_t *h6;
-    u8 *rw;
-  } r =
-  {
-  .rw = 0};
-  int len = is_ip6 ? sizeof *r.h6 : sizeof *r.h4;
+    ip4_geneve_header_t h4;
+    ip6_geneve_header_t h6;
+    u8 rw[sizeof (t->rewrite_data)];
+  } r;
+  ip4_geneve_header_t *h4 = &r.h4;
+  ip6_geneve_header_t *h6 = &r.h6;
+  int len = is_ip6 ? sizeof *h6 : sizeof *h4;
 #if SUPPORT_OPTIONS_HEADER==1
   len += t->options_len;
 #endif
 
-  vec_validate_aligned (r.rw, len - 1, CLIB_CACHE_LINE_BYTES);
+  if (len >= sizeof (t->rewrite_data))
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  memset (&r, 0, sizeof (r));
 
   udp_header_t *udp;
   geneve_header_t *geneve;
   /* Fixed portion of the (outer) ip header */
   if (!is_ip6)
     {
-      ip4_header_t *ip = &r.h4->ip4;
-      udp = &r.h4->udp, geneve = &r.h4->geneve;
+      ip4_header_t *ip = &h4->ip4;
+      udp = &h4->udp, geneve = &h4->geneve;
       ip->ip_version_and_header_length = 0x45;
       ip->ttl = 254;
       ip->protocol = IP_PROTOCOL_UDP;
@@ -233,8 +236,8 @@ geneve_rewrite (geneve_tunnel_t * t, bool is_ip6)
     }
   else
     {
-      ip6_header_t *ip = &r.h6->ip6;
-      udp = &r.h6->udp, geneve = &r.h6->geneve;
+      ip6_header_t *ip = &h6->ip6;
+      udp = &h6->udp, geneve = &h6->geneve;
       ip->ip_version_traffic_class_and_flow_label =
 	clib_host_to_net_u32 (6 << 28);
       ip->hop_limit = 255;
@@ -263,7 +266,7 @@ geneve_rewrite (geneve_tunnel_t * t, bool is_ip6)
 
   vnet_set_geneve_vni (geneve, t->vni);
 
-  t->rewrite = r.rw;
+  vnet_rewrite_set_data (*t, &r, len);
   return (0);
 }
 
@@ -357,35 +360,27 @@ int vnet_geneve_add_del_tunnel
   geneve_main_t *vxm = &geneve_main;
   geneve_tunnel_t *t = 0;
   vnet_main_t *vnm = vxm->vnet_main;
-  uword *p;
   u32 hw_if_index = ~0;
   u32 sw_if_index = ~0;
+  u32 tunnel_index;
   int rv;
-  geneve4_tunnel_key_t key4;
-  geneve6_tunnel_key_t key6;
   u32 is_ip6 = a->is_ip6;
+  u32 vni =
+    clib_host_to_net_u32 ((a->vni << GENEVE_VNI_SHIFT) & GENEVE_VNI_MASK);
 
   if (!is_ip6)
-    {
-      key4.remote = a->remote.ip4.as_u32;
-      key4.vni =
-	clib_host_to_net_u32 ((a->vni << GENEVE_VNI_SHIFT) & GENEVE_VNI_MASK);
-      p = hash_get (vxm->geneve4_tunnel_by_key, key4.as_u64);
-    }
+    tunnel_index = udp_tunnel_demux_find4 (&vxm->tunnel_demux,
+					   a->remote.ip4.as_u32, vni);
   else
-    {
-      key6.remote = a->remote.ip6;
-      key6.vni =
-	clib_host_to_net_u32 ((a->vni << GENEVE_VNI_SHIFT) & GENEVE_VNI_MASK);
-      p = hash_get_mem (vxm->geneve6_tunnel_by_key, &key6);
-    }
+    tunnel_index = udp_tunnel_demux_find6 (&vxm->tunnel_demux,
+					   &a->remote.ip6, vni);
 
   if (a->is_add)
     {
       l2input_main_t *l2im = &l2input_main;
 
       /* adding a tunnel: tunnel must not already exist */
-      if (p)
+      if (tunnel_index != ~0)
 	return VNET_API_ERROR_TUNNEL_EXIST;
 
       /*if not set explicitly, default to l2 */
@@ -411,10 +406,11 @@ int vnet_geneve_add_del_tunnel
 
       /* copy the key */
       if (is_ip6)
-	hash_set_mem_alloc (&vxm->geneve6_tunnel_by_key, &key6,
-			    t - vxm->tunnels);
+	udp_tunnel_demux_add_del6 (&vxm->tunnel_demux, &a->remote.ip6, vni,
+				   t - vxm->tunnels, 1 /* is_add */ );
       else
-	hash_set (vxm->geneve4_tunnel_by_key, key4.as_u64, t - vxm->tunnels);
+	udp_tunnel_demux_add_del4 (&vxm->tunnel_demux, a->remote.ip4.as_u32,
+				   vni, t - vxm->tunnels, 1 /* is_add */ );
 
       vnet_hw_interface_t *hi;
       if (vec_len (vxm->free_geneve_tunnel_hw_if_indices) > 0)
@@ -570,10 +566,10 @@ int vnet_geneve_add_del_tunnel
   else
     {
       /* deleting a tunnel: tunnel must exist */
-      if (!p)
+      if (tunnel_index == ~0)
 	return VNET_API_ERROR_NO_SUCH_ENTRY;
 
-      t = pool_elt_at_index (vxm->tunnels, p[0]);
+      t = pool_elt_at_index (vxm->tunnels, tunnel_index);
 
       sw_if_index = t->sw_if_index;
       vnet_sw_interface_set_flags (vnm, t->sw_if_index, 0 /* down */ );
@@ -588,9 +584,11 @@ int vnet_geneve_add_del_tunnel
       vxm->tunnel_index_by_sw_if_index[t->sw_if_index] = ~0;
 
       if (!is_ip6)
-	hash_unset (vxm->geneve4_tunnel_by_key, key4.as_u64);
+	udp_tunnel_demux_add_del4 (&vxm->tunnel_demux, a->remote.ip4.as_u32,
+				   vni, tunnel_index, 0 /* is_add */ );
       else
-	hash_unset_mem_free (&vxm->geneve6_tunnel_by_key, &key6);
+	udp_tunnel_demux_add_del6 (&vxm->tunnel_demux, &a->remote.ip6, vni,
+				   tunnel_index, 0 /* is_add */ );
 
       if (!ip46_address_is_multicast (&t->remote))
 	{
@@ -604,7 +602,6 @@ int vnet_geneve_add_del_tunnel
 	}
 
       fib_node_deinit (&t->node);
-      vec_free (t->rewrite);
       pool_put (vxm->tunnels, t);
     }
 
@@ -1094,10 +1091,9 @@ geneve_init (vlib_main_t * vm)
   vxm->vnet_main = vnet_get_main ();
   vxm->vlib_main = vm;
 
+  udp_tunnel_demux_init (&vxm->tunnel_demux, "geneve");
+
   /* initialize the ip6 hash */
-  vxm->geneve6_tunnel_by_key = hash_create_mem (0,
-						sizeof (geneve6_tunnel_key_t),
-						sizeof (uword));
   vxm->vtep6 = hash_create_mem (0, sizeof (ip6_address_t), sizeof (uword));
   vxm->mcast_shared = hash_create_mem (0,
 				       sizeof (ip46_address_t),
@@ -27,6 +27,8 @@
 #include <vnet/ip/ip4_packet.h>
 #include <vnet/ip/ip6_packet.h>
 #include <vnet/udp/udp.h>
+#include <vnet/udp/udp_tunnel_demux.h>
+#include <vnet/udp/udp_tunnel_encap.h>
 #include <vnet/dpo/dpo.h>
 #include <vnet/adj/adj_types.h>
 
@@ -78,9 +80,6 @@ typedef struct
   /* Required for pool_get_aligned */
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
 
-  /* Rewrite string. $$$$ embed vnet_rewrite header */
-  u8 *rewrite;
-
   /* FIB DPO for IP forwarding of GENEVE encap packet */
   dpo_id_t next_dpo;
 
@@ -128,6 +127,9 @@ typedef struct
    * The tunnels sibling index on the FIB entry's dependency list.
    */
   u32 sibling_index;
+
+  /* outer ip/udp/geneve header, see udp_tunnel_encap_stamp */
+  vnet_declare_rewrite (VLIB_BUFFER_PRE_DATA_SIZE);
 } geneve_tunnel_t;
 
 #define foreach_geneve_input_next        \
@@ -155,9 +157,8 @@ typedef struct
   /* vector of encap tunnel instances */
   geneve_tunnel_t *tunnels;
 
-  /* lookup tunnel by key */
-  uword *geneve4_tunnel_by_key;	/* keyed on ipv4.remote + vni */
-  uword *geneve6_tunnel_by_key;	/* keyed on ipv6.remote + vni */
+  /* lookup tunnel by key, keyed on ip remote + vni */
+  udp_tunnel_demux_t tunnel_demux;
 
   /* local VTEP IPs ref count used by geneve-bypass node to check if
      received GENEVE packet DIP matches any local VTEP address */
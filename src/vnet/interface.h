@@ -498,6 +498,10 @@ typedef struct vnet_hw_interface_t
   /* tx checksum offload */
 #define VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD (1 << 17)
 
+  /* tx segmentation offload, packets marked VNET_BUFFER_F_GSO are
+     passed to the device as they are */
+#define VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO (1 << 18)
+
   /* Hardware address as vector.  Zero (e.g. zero-length vector) if no
      address for this class (e.g. PPP). */
   u8 *hw_address;
@@ -781,6 +785,15 @@ typedef struct
   u32 tx_node_index;
 } vnet_hw_interface_nodes_t;
 
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* the GSO packets of a frame cut into segments */
+  u32 *split_buffers;
+  /* buffers allocated for the segments of one packet */
+  u32 *seg_buffers;
+} vnet_interface_per_thread_data_t;
+
 typedef struct
 {
   /* Hardware interfaces. */
@@ -821,6 +834,13 @@ typedef struct
 
   /* feature_arc_index */
   u8 output_feature_arc_index;
+
+  /* number of interfaces which may receive GSO packets, the output
+     node only looks for packets to segment when non-zero */
+  u32 gso_interface_count;
+
+  /* per-thread data */
+  vnet_interface_per_thread_data_t *per_thread_data;
 } vnet_interface_main_t;
 
 static inline void
@@ -199,6 +199,15 @@ u32 vnet_register_interface (vnet_main_t * vnm,
 void vnet_set_interface_output_node (vnet_main_t * vnm,
 				     u32 hw_if_index, u32 node_index);
 
+/**
+ * Segment the GSO packets of the given buffers, as the output node of an
+ * interface does, into segs. Errors are counted on the given node.
+ */
+u32 vnet_interface_output_segment (vlib_main_t * vm,
+				   vlib_node_runtime_t * node, u32 * from,
+				   u32 n_buffers, u32 ** segs,
+				   int supports_gso);
+
 /* Creates a software interface given template. */
 clib_error_t *vnet_create_sw_interface (vnet_main_t * vnm,
 					vnet_sw_interface_t * template,
@@ -406,6 +415,9 @@ typedef enum
 {
   VNET_INTERFACE_OUTPUT_ERROR_INTERFACE_DOWN,
   VNET_INTERFACE_OUTPUT_ERROR_INTERFACE_DELETED,
+  VNET_INTERFACE_OUTPUT_ERROR_NO_BUFFERS_FOR_GSO,
+  VNET_INTERFACE_OUTPUT_ERROR_TOO_MANY_GSO_SEGS,
+  VNET_INTERFACE_OUTPUT_ERROR_ENCAPSULATED_GSO,
 } vnet_interface_output_error_t;
 
 /* Format for interface output traces. */
@@ -38,10 +38,13 @@
  */
 
 #include <vnet/vnet.h>
+#include <vnet/ethernet/packet.h>
+#include <vnet/mpls/packet.h>
 #include <vnet/ip/icmp46_packet.h>
 #include <vnet/ip/ip4.h>
 #include <vnet/ip/ip6.h>
 #include <vnet/udp/udp_packet.h>
+#include <vnet/tcp/tcp_packet.h>
 #include <vnet/feature/feature.h>
 
 typedef struct
@@ -180,18 +183,39 @@ calc_checksums (vlib_main_t * vm, vlib_buffer_t * b)
       ip4 = (ip4_header_t *) (b->data + vnet_buffer (b)->l3_hdr_offset);
       if (b->flags & VNET_BUFFER_F_OFFLOAD_IP_CKSUM)
 	ip4->checksum = ip4_header_checksum (ip4);
+      /* the field may hold a partial sum, e.g. from a virtio guest, or
+         have been updated incrementally on the way */
       if (b->flags & VNET_BUFFER_F_OFFLOAD_TCP_CKSUM)
-	th->checksum = ip4_tcp_udp_compute_checksum (vm, b, ip4);
+	{
+	  th->checksum = 0;
+	  th->checksum = ip4_tcp_udp_compute_checksum (vm, b, ip4);
+	}
       if (b->flags & VNET_BUFFER_F_OFFLOAD_UDP_CKSUM)
-	uh->checksum = ip4_tcp_udp_compute_checksum (vm, b, ip4);
+	{
+	  uh->checksum = 0;
+	  uh->checksum = ip4_tcp_udp_compute_checksum (vm, b, ip4);
+	  /* zero means no checksum */
+	  if (uh->checksum == 0)
+	    uh->checksum = 0xffff;
+	}
     }
   if (is_ip6)
     {
       int bogus;
       if (b->flags & VNET_BUFFER_F_OFFLOAD_TCP_CKSUM)
-	th->checksum = ip6_tcp_udp_icmp_compute_checksum (vm, b, ip6, &bogus);
+	{
+	  th->checksum = 0;
+	  th->checksum =
+	    ip6_tcp_udp_icmp_compute_checksum (vm, b, ip6, &bogus);
+	}
       if (b->flags & VNET_BUFFER_F_OFFLOAD_UDP_CKSUM)
-	uh->checksum = ip6_tcp_udp_icmp_compute_checksum (vm, b, ip6, &bogus);
+	{
+	  uh->checksum = 0;
+	  uh->checksum =
+	    ip6_tcp_udp_icmp_compute_checksum (vm, b, ip6, &bogus);
+	  if (uh->checksum == 0)
+	    uh->checksum = 0xffff;
+	}
     }
 
   b->flags &= ~VNET_BUFFER_F_OFFLOAD_TCP_CKSUM;
@@ -199,17 +223,297 @@ calc_checksums (vlib_main_t * vm, vlib_buffer_t * b)
   b->flags &= ~VNET_BUFFER_F_OFFLOAD_IP_CKSUM;
 }
 
+/*
+ * Software TCP segmentation for interfaces which can not take GSO packets.
+ * Every segment gets a copy of the L2-L4 headers followed by up to
+ * gso_size bytes of payload, and asks for its IP and TCP checksums
+ * through the regular checksum offload flags.
+ */
+static_always_inline void
+tso_fixup_segment (vlib_buffer_t * b, u32 l234_sz, u32 seg_len,
+		   u32 seg_index, u32 n_segs, u32 seq, u16 ip_id)
+{
+  tcp_header_t *th;
+  u16 l3_sz;
+
+  l3_sz = l234_sz - (vnet_buffer (b)->l3_hdr_offset - b->current_data);
+  th = (tcp_header_t *) (b->data + vnet_buffer (b)->l4_hdr_offset);
+
+  if (b->flags & VNET_BUFFER_F_IS_IP4)
+    {
+      ip4_header_t *ip4;
+      ip4 = (ip4_header_t *) (b->data + vnet_buffer (b)->l3_hdr_offset);
+      ip4->length = clib_host_to_net_u16 (l3_sz + seg_len);
+      ip4->fragment_id = clib_host_to_net_u16 (ip_id + seg_index);
+      ip4->checksum = 0;
+      b->flags |= VNET_BUFFER_F_OFFLOAD_IP_CKSUM;
+    }
+  else
+    {
+      ip6_header_t *ip6;
+      ip6 = (ip6_header_t *) (b->data + vnet_buffer (b)->l3_hdr_offset);
+      ip6->payload_length =
+	clib_host_to_net_u16 (l3_sz - sizeof (ip6_header_t) + seg_len);
+    }
+
+  th->seq_number = clib_host_to_net_u32 (seq);
+  if (seg_index != n_segs - 1)
+    th->flags &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+  if (seg_index != 0)
+    th->flags &= ~TCP_FLAG_CWR;
+  th->checksum = 0;
+  b->flags |= VNET_BUFFER_F_OFFLOAD_TCP_CKSUM;
+}
+
+/* Segments of a 64K packet cut into chunks of the smallest gso_size */
+#define TSO_MAX_SEGS 1024
+
+/*
+ * The header offsets of a GSO packet are those of the packet as it was
+ * received. Tunnels encapsulating it past its interface-output node
+ * (midchain adjacencies, IPsec tunnel mode) put their headers in front,
+ * and only the inner headers would be fixed up. So the packet must reach
+ * its l3 header through ethernet, VLAN tags and MPLS labels only, or start
+ * with it on an l3 interface.
+ */
+static_always_inline int
+tso_is_encapsulated (vlib_buffer_t * b)
+{
+  u8 *p = vlib_buffer_get_current (b);
+  i16 l3 = vnet_buffer (b)->l3_hdr_offset - b->current_data;
+  i16 off = sizeof (ethernet_header_t);
+  u16 type;
+
+  if (l3 == 0)
+    return 0;
+  if (l3 < off || l3 > b->current_length)
+    return 1;
+
+  type = clib_net_to_host_u16 (((ethernet_header_t *) p)->type);
+  while ((type == ETHERNET_TYPE_VLAN || type == ETHERNET_TYPE_DOT1AD)
+	 && off + sizeof (ethernet_vlan_header_t) <= l3)
+    {
+      type = clib_net_to_host_u16 (((ethernet_vlan_header_t *) (p + off))->
+				   type);
+      off += sizeof (ethernet_vlan_header_t);
+    }
+
+  if (type == ETHERNET_TYPE_MPLS)
+    {
+      mpls_unicast_header_t *h;
+      do
+	{
+	  if (off + sizeof (*h) > l3)
+	    return 1;
+	  h = (mpls_unicast_header_t *) (p + off);
+	  off += sizeof (*h);
+	}
+      while (!vnet_mpls_uc_get_s (clib_net_to_host_u32
+				  (h->label_exp_s_ttl)));
+    }
+  else if (type != ETHERNET_TYPE_IP4 && type != ETHERNET_TYPE_IP6)
+    return 1;
+
+  return off != l3;
+}
+
+/**
+ * @brief Segment a GSO packet and append the segments to segs
+ *
+ * Packets which can not be segmented are passed on unchanged with the GSO
+ * flag cleared. The original buffer is consumed, packets dropped for lack
+ * of buffers or too many segments are counted on the node.
+ */
+static never_inline void
+tso_segment_buffer (vlib_main_t * vm, vlib_node_runtime_t * node, u32 bi0,
+		    u32 ** segs)
+{
+  vnet_interface_per_thread_data_t *ptd =
+    vec_elt_at_index (vnet_get_main ()->interface_main.per_thread_data,
+		      vm->thread_index);
+  vlib_buffer_t *b0, *sb, *d, *fd;
+  tcp_header_t *th;
+  u32 l234_sz, payload, n_segs, n_bufs, n_alloc, seg_len, left, n;
+  u32 i, k, room, s_off, seq;
+  u16 gso_size, ip_id = 0;
+  u32 flag_mask = VLIB_BUFFER_NEXT_PRESENT | VLIB_BUFFER_TOTAL_LENGTH_VALID |
+    VNET_BUFFER_F_GSO;
+  u8 *hdr;
+
+  b0 = vlib_get_buffer (vm, bi0);
+  gso_size = vnet_buffer2 (b0)->gso_size;
+  th = (tcp_header_t *) (b0->data + vnet_buffer (b0)->l4_hdr_offset);
+  l234_sz = vnet_buffer (b0)->l4_hdr_offset - b0->current_data;
+  payload = vlib_buffer_length_in_chain (vm, b0);
+
+  /* all headers must be in the first buffer */
+  if (l234_sz + sizeof (tcp_header_t) <= b0->current_length)
+    l234_sz += tcp_header_bytes (th);
+  else
+    l234_sz = ~0;
+
+  if (PREDICT_FALSE (gso_size == 0 || l234_sz > b0->current_length ||
+		     payload <= l234_sz + gso_size ||
+		     !(b0->flags & (VNET_BUFFER_F_IS_IP4 |
+				    VNET_BUFFER_F_IS_IP6))))
+    {
+      b0->flags &= ~VNET_BUFFER_F_GSO;
+      vec_add1 (*segs, bi0);
+      return;
+    }
+
+  payload -= l234_sz;
+  n_segs = (payload + gso_size - 1) / gso_size;
+  if (PREDICT_FALSE (n_segs > TSO_MAX_SEGS))
+    {
+      vlib_error_count (vm, node->node_index,
+			VNET_INTERFACE_OUTPUT_ERROR_TOO_MANY_GSO_SEGS, 1);
+      vlib_buffer_free (vm, &bi0, 1);
+      return;
+    }
+
+  /* headers stay at the same offset in the first buffer of each segment */
+  room = VLIB_BUFFER_DATA_SIZE - (b0->current_data + l234_sz);
+  n_bufs = n_segs;
+  if (gso_size > room)
+    n_bufs += n_segs * ((gso_size - room + VLIB_BUFFER_DATA_SIZE - 1) /
+			VLIB_BUFFER_DATA_SIZE);
+
+  vec_validate (ptd->seg_buffers, n_bufs - 1);
+  n_alloc = vlib_buffer_alloc (vm, ptd->seg_buffers, n_bufs);
+  if (PREDICT_FALSE (n_alloc < n_bufs))
+    {
+      if (n_alloc)
+	vlib_buffer_free (vm, ptd->seg_buffers, n_alloc);
+      vlib_error_count (vm, node->node_index,
+			VNET_INTERFACE_OUTPUT_ERROR_NO_BUFFERS_FOR_GSO, 1);
+      vlib_buffer_free (vm, &bi0, 1);
+      return;
+    }
+
+  hdr = vlib_buffer_get_current (b0);
+  if (b0->flags & VNET_BUFFER_F_IS_IP4)
+    {
+      ip4_header_t *ip4;
+      ip4 = (ip4_header_t *) (b0->data + vnet_buffer (b0)->l3_hdr_offset);
+      ip_id = clib_net_to_host_u16 (ip4->fragment_id);
+    }
+  seq = clib_net_to_host_u32 (th->seq_number);
+
+  sb = b0;
+  s_off = l234_sz;
+  k = 0;
+
+  for (i = 0; i < n_segs; i++)
+    {
+      seg_len = clib_min (gso_size, payload);
+      payload -= seg_len;
+
+      vec_add1 (*segs, ptd->seg_buffers[k]);
+      fd = d = vlib_get_buffer (vm, ptd->seg_buffers[k++]);
+      fd->current_data = b0->current_data;
+      fd->current_length = l234_sz;
+      fd->total_length_not_including_first_buffer = 0;
+      fd->flags = (b0->flags & ~flag_mask) | VLIB_BUFFER_TOTAL_LENGTH_VALID;
+      fd->trace_index = b0->trace_index;
+      clib_memcpy (fd->opaque, b0->opaque, sizeof (b0->opaque));
+      clib_memcpy (fd->opaque2, b0->opaque2, sizeof (b0->opaque2));
+      clib_memcpy (vlib_buffer_get_current (fd), hdr, l234_sz);
+
+      left = seg_len;
+      while (left)
+	{
+	  if (s_off == sb->current_length)
+	    {
+	      sb = vlib_get_buffer (vm, sb->next_buffer);
+	      s_off = 0;
+	      continue;
+	    }
+	  if (d->current_data + d->current_length == VLIB_BUFFER_DATA_SIZE)
+	    {
+	      d->next_buffer = ptd->seg_buffers[k];
+	      d->flags |= VLIB_BUFFER_NEXT_PRESENT;
+	      d = vlib_get_buffer (vm, ptd->seg_buffers[k++]);
+	      d->current_data = 0;
+	      d->current_length = 0;
+	      d->flags &= ~VLIB_BUFFER_NEXT_PRESENT;
+	    }
+	  n = clib_min (left, sb->current_length - s_off);
+	  n = clib_min (n, VLIB_BUFFER_DATA_SIZE -
+			(d->current_data + d->current_length));
+	  clib_memcpy (vlib_buffer_get_current (d) + d->current_length,
+		       vlib_buffer_get_current (sb) + s_off, n);
+	  d->current_length += n;
+	  if (d != fd)
+	    fd->total_length_not_including_first_buffer += n;
+	  s_off += n;
+	  left -= n;
+	}
+
+      tso_fixup_segment (fd, l234_sz, seg_len, i, n_segs,
+			 seq + i * gso_size, ip_id);
+    }
+
+  /* the last segment may need fewer buffers than estimated */
+  if (k < n_bufs)
+    vlib_buffer_free (vm, ptd->seg_buffers + k, n_bufs - k);
+
+  vlib_buffer_free (vm, &bi0, 1);
+}
+
+/*
+ * Segment the GSO packets of a frame, or with supports_gso only drop the
+ * encapsulated ones the device would segment wrongly.
+ */
+never_inline u32
+vnet_interface_output_segment (vlib_main_t * vm, vlib_node_runtime_t * node,
+			       u32 * from, u32 n_buffers, u32 ** segs,
+			       int supports_gso)
+{
+  u32 n_encapsulated = 0;
+
+  vec_reset_length (*segs);
+
+  while (n_buffers)
+    {
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, from[0]);
+
+      if (!(b0->flags & VNET_BUFFER_F_GSO))
+	vec_add1 (*segs, from[0]);
+      else if (PREDICT_FALSE (tso_is_encapsulated (b0)))
+	{
+	  vlib_buffer_free (vm, from, 1);
+	  n_encapsulated++;
+	}
+      else if (supports_gso)
+	vec_add1 (*segs, from[0]);
+      else
+	tso_segment_buffer (vm, node, from[0], segs);
+
+      from += 1;
+      n_buffers -= 1;
+    }
+
+  if (n_encapsulated)
+    vlib_error_count (vm, node->node_index,
+		      VNET_INTERFACE_OUTPUT_ERROR_ENCAPSULATED_GSO,
+		      n_encapsulated);
+
+  return vec_len (*segs);
+}
+
 static_always_inline uword
 vnet_interface_output_node_inline (vlib_main_t * vm,
 				   vlib_node_runtime_t * node,
-				   vlib_frame_t * frame, vnet_main_t * vnm,
+				   u32 * from, u32 n_buffers,
+				   vnet_main_t * vnm,
 				   vnet_hw_interface_t * hi,
 				   int do_tx_offloads)
 {
   vnet_interface_output_runtime_t *rt = (void *) node->runtime_data;
   vnet_sw_interface_t *si;
-  u32 n_left_to_tx, *from, *from_end, *to_tx;
-  u32 n_bytes, n_buffers, n_packets;
+  u32 n_left_to_tx, *from_end, *to_tx;
+  u32 n_bytes, n_packets;
   u32 n_bytes_b0, n_bytes_b1, n_bytes_b2, n_bytes_b3;
   u32 thread_index = vm->thread_index;
   vnet_interface_main_t *im = &vnm->interface_main;
@@ -217,13 +521,6 @@ vnet_interface_output_node_inline (vlib_main_t * vm,
   u32 current_config_index = ~0;
   u8 arc = im->output_feature_arc_index;
 
-  n_buffers = frame->n_vectors;
-
-  if (node->flags & VLIB_NODE_FLAG_TRACE)
-    vnet_interface_output_trace (vm, node, frame, n_buffers);
-
-  from = vlib_frame_args (frame);
-
   if (rt->is_deleted)
     return vlib_error_drop_buffers (vm, node, from,
 				    /* buffer stride */ 1,
@@ -450,13 +747,42 @@ vnet_interface_output_node (vlib_main_t * vm, vlib_node_runtime_t * node,
   vnet_main_t *vnm = vnet_get_main ();
   vnet_hw_interface_t *hi;
   vnet_interface_output_runtime_t *rt = (void *) node->runtime_data;
+  vnet_interface_per_thread_data_t *ptd;
+  u32 *from, n_buffers;
+
   hi = vnet_get_sup_hw_interface (vnm, rt->sw_if_index);
+  from = vlib_frame_args (frame);
+  n_buffers = frame->n_vectors;
+
+  if (node->flags & VLIB_NODE_FLAG_TRACE)
+    vnet_interface_output_trace (vm, node, frame, n_buffers);
+
+  if (PREDICT_FALSE (vnm->interface_main.gso_interface_count))
+    {
+      u32 i, or_flags = 0;
+
+      for (i = 0; i < n_buffers; i++)
+	or_flags |= vlib_get_buffer (vm, from[i])->flags;
+
+      /* segment them here if the device can not take GSO packets */
+      if (PREDICT_FALSE (or_flags & VNET_BUFFER_F_GSO))
+	{
+	  ptd = vec_elt_at_index (vnm->interface_main.per_thread_data,
+				  vm->thread_index);
+	  n_buffers = vnet_interface_output_segment
+	    (vm, node, from, n_buffers, &ptd->split_buffers,
+	     hi->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO);
+	  from = ptd->split_buffers;
+	}
+    }
 
   if (hi->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD)
-    return vnet_interface_output_node_inline (vm, node, frame, vnm, hi,
+    return vnet_interface_output_node_inline (vm, node, from, n_buffers,
+					      vnm, hi,
 					      /* do_tx_offloads */ 0);
   else
-    return vnet_interface_output_node_inline (vm, node, frame, vnm, hi,
+    return vnet_interface_output_node_inline (vm, node, from, n_buffers,
+					      vnm, hi,
 					      /* do_tx_offloads */ 1);
 }
 
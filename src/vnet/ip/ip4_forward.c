@@ -2047,7 +2047,8 @@ always_inline void
 ip4_mtu_check (vlib_buffer_t * b, u16 packet_len,
 	       u16 adj_packet_bytes, bool df, u32 * next, u32 * error)
 {
-  if (packet_len > adj_packet_bytes)
+  /* GSO packets are cut into MTU sized segments on the way out */
+  if (packet_len > adj_packet_bytes && !(b->flags & VNET_BUFFER_F_GSO))
     {
       *error = IP4_ERROR_MTU_EXCEEDED;
       if (df)
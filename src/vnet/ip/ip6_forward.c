@@ -1561,7 +1561,9 @@ ip6_mtu_check (vlib_buffer_t * b, u16 packet_bytes,
 	       u16 adj_packet_bytes, bool is_locally_generated,
 	       u32 * next, u32 * error)
 {
-  if (adj_packet_bytes >= 1280 && packet_bytes > adj_packet_bytes)
+  /* GSO packets are cut into MTU sized segments on the way out */
+  if (adj_packet_bytes >= 1280 && packet_bytes > adj_packet_bytes &&
+      !(b->flags & VNET_BUFFER_F_GSO))
     {
       if (is_locally_generated)
 	{
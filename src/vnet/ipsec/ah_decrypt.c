@@ -43,7 +43,8 @@ typedef enum
  _(DECRYPTION_FAILED, "AH decryption failed")      \
  _(INTEG_ERROR, "Integrity check failed")           \
  _(REPLAY, "SA replayed packet")                    \
- _(NOT_IP, "Not IP packet (dropped)")
+ _(NOT_IP, "Not IP packet (dropped)")              \
+ _(HANDOFF_CONGESTED, "SA owner queue congested (packet dropped)")
 
 
 typedef enum
@@ -82,10 +83,24 @@ ah_decrypt_node_fn (vlib_main_t * vm,
 		    vlib_node_runtime_t * node, vlib_frame_t * from_frame)
 {
   u32 n_left_from, *from, next_index, *to_next;
+  u32 local[VLIB_FRAME_SIZE], n_congested, n_rx;
   ipsec_main_t *im = &ipsec_main;
   ipsec_proto_main_t *em = &ipsec_proto_main;
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
+
+  /* packets of SAs pinned to other threads continue there */
+  if (PREDICT_FALSE (im->ah_decrypt_fq_index != ~0))
+    {
+      n_left_from = ipsec_handoff (vm, im->ah_decrypt_fq_index, from,
+				   n_left_from, local, &n_congested);
+      from = local;
+      if (n_congested)
+	vlib_node_increment_counter (vm, ah_decrypt_node.index,
+				     AH_DECRYPT_ERROR_HANDOFF_CONGESTED,
+				     n_congested);
+    }
+  n_rx = n_left_from;
   int icv_size = 0;
 
   next_index = node->cached_next_index;
@@ -306,8 +321,7 @@ ah_decrypt_node_fn (vlib_main_t * vm,
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
   vlib_node_increment_counter (vm, ah_decrypt_node.index,
-			       AH_DECRYPT_ERROR_RX_PKTS,
-			       from_frame->n_vectors);
+			       AH_DECRYPT_ERROR_RX_PKTS, n_rx);
 
   return from_frame->n_vectors;
 }
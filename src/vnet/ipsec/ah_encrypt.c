@@ -39,7 +39,8 @@ typedef enum
 
 #define foreach_ah_encrypt_error                   \
  _(RX_PKTS, "AH pkts received")                    \
- _(SEQ_CYCLED, "sequence number cycled")
+ _(SEQ_CYCLED, "sequence number cycled")           \
+ _(HANDOFF_CONGESTED, "SA owner queue congested (packet dropped)")
 
 
 typedef enum
@@ -83,11 +84,25 @@ ah_encrypt_node_fn (vlib_main_t * vm,
 		    vlib_node_runtime_t * node, vlib_frame_t * from_frame)
 {
   u32 n_left_from, *from, *to_next = 0, next_index;
+  u32 local[VLIB_FRAME_SIZE], n_congested, n_rx;
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_proto_main_t *em = &ipsec_proto_main;
   int icv_size = 0;
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
-  ipsec_main_t *im = &ipsec_main;
-  ipsec_proto_main_t *em = &ipsec_proto_main;
+
+  /* packets of SAs pinned to other threads continue there */
+  if (PREDICT_FALSE (im->ah_encrypt_fq_index != ~0))
+    {
+      n_left_from = ipsec_handoff (vm, im->ah_encrypt_fq_index, from,
+				   n_left_from, local, &n_congested);
+      from = local;
+      if (n_congested)
+	vlib_node_increment_counter (vm, ah_encrypt_node.index,
+				     AH_ENCRYPT_ERROR_HANDOFF_CONGESTED,
+				     n_congested);
+    }
+  n_rx = n_left_from;
   next_index = node->cached_next_index;
 
   while (n_left_from > 0)
@@ -305,8 +320,7 @@ ah_encrypt_node_fn (vlib_main_t * vm,
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
   vlib_node_increment_counter (vm, ah_encrypt_node.index,
-			       AH_ENCRYPT_ERROR_RX_PKTS,
-			       from_frame->n_vectors);
+			       AH_ENCRYPT_ERROR_RX_PKTS, n_rx);
 
   return from_frame->n_vectors;
 }
@@ -104,11 +104,48 @@ typedef struct
 
 extern ipsec_proto_main_t ipsec_proto_main;
 
-#define ESP_WINDOW_SIZE		(64)
 #define ESP_SEQ_MAX 		(4294967295UL)
 
 u8 *format_esp_header (u8 * s, va_list * args);
 
+always_inline int
+esp_replay_bit_test (ipsec_sa_t * sa, u32 seq)
+{
+  u32 bit = seq & sa->replay_bitmap_mask;
+
+  return (sa->replay_bitmap[bit >> 6] >> (bit & 63)) & 1;
+}
+
+/* returns the previous value of the bit */
+always_inline int
+esp_replay_bit_test_and_set (ipsec_sa_t * sa, u32 seq)
+{
+  u32 bit = seq & sa->replay_bitmap_mask;
+  u64 mask = 1ULL << (bit & 63);
+  u64 old = sa->replay_bitmap[bit >> 6];
+
+  sa->replay_bitmap[bit >> 6] = old | mask;
+  return (old & mask) != 0;
+}
+
+/*
+ * Move the top of the window from last to seq. Only the words the top
+ * moves into are cleared, bits below the top are never shifted.
+ */
+always_inline void
+esp_replay_slide (ipsec_sa_t * sa, u64 last, u64 seq)
+{
+  u32 n_words = (sa->replay_bitmap_mask >> 6) + 1;
+  u64 n = (seq >> 6) - (last >> 6);
+  u32 i, w = last >> 6;
+
+  if (n > n_words)
+    n = n_words;
+
+  for (i = 1; i <= n; i++)
+    sa->replay_bitmap[(w + i) & (n_words - 1)] = 0;
+}
+
 always_inline int
 esp_replay_check (ipsec_sa_t * sa, u32 seq)
 {
@@ -119,8 +156,8 @@ esp_replay_check (ipsec_sa_t * sa, u32 seq)
 
   diff = sa->last_seq - seq;
 
-  if (ESP_WINDOW_SIZE > diff)
-    return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
+  if (sa->replay_window_size > diff)
+    return esp_replay_bit_test (sa, seq);
   else
     return 1;
 
@@ -132,15 +169,15 @@ esp_replay_check_esn (ipsec_sa_t * sa, u32 seq)
 {
   u32 tl = sa->last_seq;
   u32 th = sa->last_seq_hi;
-  u32 diff = tl - seq;
+  u32 window = sa->replay_window_size;
 
-  if (PREDICT_TRUE (tl >= (ESP_WINDOW_SIZE - 1)))
+  if (PREDICT_TRUE (tl >= (window - 1)))
     {
-      if (seq >= (tl - ESP_WINDOW_SIZE + 1))
+      if (seq >= (tl - window + 1))
 	{
 	  sa->seq_hi = th;
 	  if (seq <= tl)
-	    return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
+	    return esp_replay_bit_test (sa, seq);
 	  else
 	    return 0;
 	}
@@ -152,16 +189,16 @@ esp_replay_check_esn (ipsec_sa_t * sa, u32 seq)
     }
   else
     {
-      if (seq >= (tl - ESP_WINDOW_SIZE + 1))
+      if (seq >= (tl - window + 1))
 	{
 	  sa->seq_hi = th - 1;
-	  return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
+	  return esp_replay_bit_test (sa, seq);
 	}
       else
 	{
 	  sa->seq_hi = th;
 	  if (seq <= tl)
-	    return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
+	    return esp_replay_bit_test (sa, seq);
 	  else
 	    return 0;
 	}
@@ -170,63 +207,49 @@ esp_replay_check_esn (ipsec_sa_t * sa, u32 seq)
   return 0;
 }
 
-/* TODO seq increment should be atomic to be accessed by multiple workers */
-always_inline void
+/*
+ * The advance functions record seq in the window. They return 1 if seq
+ * was already there, which catches duplicates that passed the check
+ * because they arrived in the same frame.
+ */
+
+/* esp, ah and the dpdk cryptodev nodes hand packets of an SA to the
+   thread owning it, so the window has a single writer */
+always_inline int
 esp_replay_advance (ipsec_sa_t * sa, u32 seq)
 {
-  u32 pos;
-
   if (seq > sa->last_seq)
     {
-      pos = seq - sa->last_seq;
-      if (pos < ESP_WINDOW_SIZE)
-	sa->replay_window = ((sa->replay_window) << pos) | 1;
-      else
-	sa->replay_window = 1;
+      esp_replay_slide (sa, sa->last_seq, seq);
       sa->last_seq = seq;
     }
-  else
-    {
-      pos = sa->last_seq - seq;
-      sa->replay_window |= (1ULL << pos);
-    }
+  else if (sa->last_seq - seq >= sa->replay_window_size)
+    return 1;
+
+  return esp_replay_bit_test_and_set (sa, seq);
 }
 
-always_inline void
+always_inline int
 esp_replay_advance_esn (ipsec_sa_t * sa, u32 seq)
 {
   int wrap = sa->seq_hi - sa->last_seq_hi;
-  u32 pos;
 
   if (wrap == 0 && seq > sa->last_seq)
     {
-      pos = seq - sa->last_seq;
-      if (pos < ESP_WINDOW_SIZE)
-	sa->replay_window = ((sa->replay_window) << pos) | 1;
-      else
-	sa->replay_window = 1;
+      esp_replay_slide (sa, sa->last_seq, seq);
       sa->last_seq = seq;
     }
   else if (wrap > 0)
     {
-      pos = ~seq + sa->last_seq + 1;
-      if (pos < ESP_WINDOW_SIZE)
-	sa->replay_window = ((sa->replay_window) << pos) | 1;
-      else
-	sa->replay_window = 1;
+      esp_replay_slide (sa, (u64) sa->last_seq_hi << 32 | sa->last_seq,
+			(u64) sa->seq_hi << 32 | seq);
       sa->last_seq = seq;
       sa->last_seq_hi = sa->seq_hi;
     }
-  else if (wrap < 0)
-    {
-      pos = ~seq + sa->last_seq + 1;
-      sa->replay_window |= (1ULL << pos);
-    }
-  else
-    {
-      pos = sa->last_seq - seq;
-      sa->replay_window |= (1ULL << pos);
-    }
+  else if ((u32) (sa->last_seq - seq) >= sa->replay_window_size)
+    return 1;
+
+  return esp_replay_bit_test_and_set (sa, seq);
 }
 
 always_inline int
@@ -0,0 +1,424 @@
+/*
+ * esp_crypto.c : IPSec ESP crypto engines
+ *
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/api_errno.h>
+
+#include <vnet/ipsec/ipsec.h>
+#include <vnet/ipsec/esp.h>
+#include <vnet/ipsec/esp_crypto.h>
+
+esp_crypto_main_t esp_crypto_main;
+
+static void
+esp_crypto_openssl_encrypt (esp_crypto_op_t * ops, u32 n_ops)
+{
+  ipsec_proto_main_t *em = &ipsec_proto_main;
+  u32 thread_index = vlib_get_thread_index ();
+  ipsec_proto_main_per_thread_data_t *ptd = &em->per_thread_data[thread_index];
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  EVP_CIPHER_CTX *ctx = ptd->encrypt_ctx;
+#else
+  EVP_CIPHER_CTX *ctx = &(ptd->encrypt_ctx);
+#endif
+  const EVP_CIPHER *cipher = NULL;
+  int out_len;
+  u32 i;
+
+  if (PREDICT_FALSE (ops[0].alg != ptd->last_encrypt_alg))
+    {
+      cipher = em->ipsec_proto_main_crypto_algs[ops[0].alg].type;
+      ptd->last_encrypt_alg = ops[0].alg;
+    }
+
+  for (i = 0; i < n_ops; i++)
+    {
+      EVP_EncryptInit_ex (ctx, cipher, NULL, ops[i].key, ops[i].iv);
+      /* ESP does its own padding */
+      EVP_CIPHER_CTX_set_padding (ctx, 0);
+      EVP_EncryptUpdate (ctx, ops[i].dst, &out_len, ops[i].src, ops[i].len);
+      EVP_EncryptFinal_ex (ctx, ops[i].dst + out_len, &out_len);
+      cipher = NULL;
+    }
+}
+
+static void
+esp_crypto_openssl_decrypt (esp_crypto_op_t * ops, u32 n_ops)
+{
+  ipsec_proto_main_t *em = &ipsec_proto_main;
+  u32 thread_index = vlib_get_thread_index ();
+  ipsec_proto_main_per_thread_data_t *ptd = &em->per_thread_data[thread_index];
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  EVP_CIPHER_CTX *ctx = ptd->decrypt_ctx;
+#else
+  EVP_CIPHER_CTX *ctx = &(ptd->decrypt_ctx);
+#endif
+  const EVP_CIPHER *cipher = NULL;
+  int out_len;
+  u32 i;
+
+  if (PREDICT_FALSE (ops[0].alg != ptd->last_decrypt_alg))
+    {
+      cipher = em->ipsec_proto_main_crypto_algs[ops[0].alg].type;
+      ptd->last_decrypt_alg = ops[0].alg;
+    }
+
+  for (i = 0; i < n_ops; i++)
+    {
+      EVP_DecryptInit_ex (ctx, cipher, NULL, ops[i].key, ops[i].iv);
+      EVP_CIPHER_CTX_set_padding (ctx, 0);
+      EVP_DecryptUpdate (ctx, ops[i].dst, &out_len, ops[i].src, ops[i].len);
+      EVP_DecryptFinal_ex (ctx, ops[i].dst + out_len, &out_len);
+      cipher = NULL;
+    }
+}
+
+#define foreach_esp_crypto_openssl_alg \
+  _(AES_CBC_128)                        \
+  _(AES_CBC_192)                        \
+  _(AES_CBC_256)                        \
+  _(DES_CBC)                            \
+  _(3DES_CBC)
+
+/* *INDENT-OFF* */
+static esp_crypto_engine_t esp_crypto_openssl_engine = {
+  .name = "openssl",
+  .description = "OpenSSL EVP, one packet at a time",
+  .priority = 0,
+#define _(a) \
+  .encrypt[IPSEC_CRYPTO_ALG_##a] = esp_crypto_openssl_encrypt, \
+  .decrypt[IPSEC_CRYPTO_ALG_##a] = esp_crypto_openssl_decrypt,
+  foreach_esp_crypto_openssl_alg
+#undef _
+};
+/* *INDENT-ON* */
+
+/**
+ * @brief Register ESP crypto engine
+ *
+ * The engine becomes the active one if it runs on this CPU and has a
+ * higher priority than the current one.
+ *
+ * @param e engine, copied
+ *
+ * @returns engine index
+ */
+u32
+esp_crypto_register_engine (esp_crypto_engine_t * e)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+  esp_crypto_engine_t *active;
+  u32 index = vec_len (ecm->engines);
+
+  vec_add1 (ecm->engines, *e);
+  hash_set_mem (ecm->engine_index_by_name, e->name, index);
+
+  active = vec_elt_at_index (ecm->engines, ecm->active_engine_index);
+  if ((e->is_supported == 0 || e->is_supported ())
+      && e->priority > active->priority)
+    ecm->active_engine_index = index;
+
+  return index;
+}
+
+/**
+ * @brief Select ESP crypto engine
+ *
+ * @param name engine name
+ *
+ * @returns 0 on success, non-zero value otherwise
+ */
+int
+esp_crypto_set_engine (char *name)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+  esp_crypto_engine_t *e;
+  uword *p;
+
+  p = hash_get_mem (ecm->engine_index_by_name, name);
+  if (!p)
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+  e = vec_elt_at_index (ecm->engines, p[0]);
+  if (e->is_supported && !e->is_supported ())
+    return VNET_API_ERROR_UNSUPPORTED;
+
+  ecm->active_engine_index = p[0];
+  return 0;
+}
+
+/**
+ * @brief Expand the SA cipher key for the engines
+ *
+ * Must be called whenever the key of an SA is set, so the engines need
+ * not expand it on the data path. All engines that run on this CPU get
+ * to expand it, as the active one can be changed at any time.
+ *
+ * @param sa security association with the new key
+ */
+void
+esp_crypto_sa_key_update (ipsec_sa_t * sa)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+  esp_crypto_engine_t *e;
+
+  vec_foreach (e, ecm->engines)
+  {
+    if (e->key_update && (e->is_supported == 0 || e->is_supported ()))
+      e->key_update (sa);
+  }
+}
+
+static clib_error_t *
+set_esp_crypto_engine_command_fn (vlib_main_t * vm,
+				  unformat_input_t * input,
+				  vlib_cli_command_t * cmd)
+{
+  u8 *name = 0;
+  clib_error_t *error = 0;
+  int rv;
+
+  if (!unformat (input, "%s", &name))
+    return clib_error_return (0, "engine name required");
+
+  vec_add1 (name, 0);
+  rv = esp_crypto_set_engine ((char *) name);
+  if (rv == VNET_API_ERROR_NO_SUCH_ENTRY)
+    error = clib_error_return (0, "unknown engine `%s'", name);
+  else if (rv)
+    error = clib_error_return (0, "engine `%s' not supported on this cpu",
+			       name);
+
+  vec_free (name);
+  return error;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_esp_crypto_engine_command, static) = {
+    .path = "set ipsec crypto engine",
+    .short_help = "set ipsec crypto engine <name>",
+    .function = set_esp_crypto_engine_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_esp_crypto_engines_command_fn (vlib_main_t * vm,
+				    unformat_input_t * input,
+				    vlib_cli_command_t * cmd)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+  esp_crypto_engine_t *e;
+  u8 *s = 0;
+  u32 i;
+
+  vec_foreach (e, ecm->engines)
+  {
+    vec_reset_length (s);
+    for (i = 0; i < IPSEC_CRYPTO_N_ALG; i++)
+      if (e->encrypt[i])
+	s = format (s, " %U", format_ipsec_crypto_alg, i);
+
+    vlib_cli_output (vm, "%c %-10s %s%s", e - ecm->engines ==
+		     ecm->active_engine_index ? '*' : ' ', e->name,
+		     e->description, e->is_supported && !e->is_supported () ?
+		     " (not supported)" : "");
+    vlib_cli_output (vm, "  algs:%v", s);
+  }
+
+  vec_free (s);
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_esp_crypto_engines_command, static) = {
+    .path = "show ipsec crypto engines",
+    .short_help = "show ipsec crypto engines",
+    .function = show_esp_crypto_engines_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+test_esp_crypto_command_fn (vlib_main_t * vm,
+			    unformat_input_t * input,
+			    vlib_cli_command_t * cmd)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+  ipsec_proto_main_t *em = &ipsec_proto_main;
+  esp_crypto_engine_t *e, *ossl;
+  esp_crypto_op_t *ops = 0, *op;
+  ipsec_crypto_alg_t alg = IPSEC_CRYPTO_ALG_AES_CBC_128;
+  u32 size = 1024, n_packets = VLIB_FRAME_SIZE, n_rounds = 1000;
+  u8 *plain = 0, *ref = 0, *out = 0, *ivs = 0;
+  ipsec_sa_t sa;
+  clib_error_t *error = 0;
+  f64 t0, t_enc, t_dec;
+  u32 i, block_size;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "alg %U", unformat_ipsec_crypto_alg, &alg))
+	;
+      else if (unformat (input, "size %u", &size))
+	;
+      else if (unformat (input, "packets %u", &n_packets))
+	;
+      else if (unformat (input, "rounds %u", &n_rounds))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  ossl = vec_elt_at_index (ecm->engines, ESP_CRYPTO_ENGINE_OPENSSL);
+  if (!ossl->encrypt[alg])
+    return clib_error_return (0, "unsupported crypto alg %U",
+			      format_ipsec_crypto_alg, alg);
+
+  block_size = em->ipsec_proto_main_crypto_algs[alg].block_size;
+  size = round_pow2 (clib_max (size, block_size), block_size);
+  n_packets = clib_max (n_packets, 1);
+
+  vec_validate (plain, size * n_packets - 1);
+  vec_validate (ref, size * n_packets - 1);
+  vec_validate (out, size * n_packets - 1);
+  vec_validate (ivs, 16 * n_packets - 1);
+  RAND_bytes (plain, vec_len (plain));
+  RAND_bytes (ivs, vec_len (ivs));
+  memset (&sa, 0, sizeof (sa));
+  sa.crypto_alg = alg;
+  RAND_bytes (sa.crypto_key, sizeof (sa.crypto_key));
+  esp_crypto_sa_key_update (&sa);
+
+  for (i = 0; i < n_packets; i++)
+    {
+      vec_add2 (ops, op, 1);
+      op->alg = alg;
+      op->key = sa.crypto_key;
+      op->sa = &sa;
+      op->iv = ivs + 16 * i;
+      op->len = size;
+    }
+
+  /* reference ciphertext */
+  vec_foreach (op, ops)
+  {
+    op->src = plain + (op - ops) * size;
+    op->dst = ref + (op - ops) * size;
+  }
+  esp_crypto_run_engine (ossl, ops, n_packets, 1);
+
+  vlib_cli_output (vm, "%U, %u packets of %u bytes, %u rounds",
+		   format_ipsec_crypto_alg, alg, n_packets, size, n_rounds);
+
+  vec_foreach (e, ecm->engines)
+  {
+    if (e->is_supported && !e->is_supported ())
+      continue;
+
+    vec_foreach (op, ops)
+    {
+      op->src = plain + (op - ops) * size;
+      op->dst = out + (op - ops) * size;
+    }
+    memset (out, 0, vec_len (out));
+    esp_crypto_run_engine (e, ops, n_packets, 1);
+    if (memcmp (out, ref, vec_len (out)))
+      {
+	error = clib_error_return (0, "%s: encrypt result mismatch", e->name);
+	goto done;
+      }
+
+    t0 = vlib_time_now (vm);
+    for (i = 0; i < n_rounds; i++)
+      esp_crypto_run_engine (e, ops, n_packets, 1);
+    t_enc = vlib_time_now (vm) - t0;
+
+    vec_foreach (op, ops)
+    {
+      op->src = ref + (op - ops) * size;
+      op->dst = out + (op - ops) * size;
+    }
+    memset (out, 0, vec_len (out));
+    esp_crypto_run_engine (e, ops, n_packets, 0);
+    if (memcmp (out, plain, vec_len (out)))
+      {
+	error = clib_error_return (0, "%s: decrypt result mismatch", e->name);
+	goto done;
+      }
+
+    t0 = vlib_time_now (vm);
+    for (i = 0; i < n_rounds; i++)
+      esp_crypto_run_engine (e, ops, n_packets, 0);
+    t_dec = vlib_time_now (vm) - t0;
+
+    vlib_cli_output (vm, "  %-10s encrypt %.2f Gbps, decrypt %.2f Gbps",
+		     e->name,
+		     (f64) vec_len (out) * n_rounds * 8 / t_enc * 1e-9,
+		     (f64) vec_len (out) * n_rounds * 8 / t_dec * 1e-9);
+  }
+
+done:
+  vec_free (ops);
+  vec_free (plain);
+  vec_free (ref);
+  vec_free (out);
+  vec_free (ivs);
+  return error;
+}
+
+/*?
+ * Check that all ESP crypto engines supported on this CPU produce the same
+ * result as the openssl engine and show their throughput.
+ *
+ * @cliexpar
+ * @cliexstart{test ipsec crypto}
+ *  vpp# test ipsec crypto alg aes-cbc-128 size 1024 rounds 1000
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_esp_crypto_command, static) = {
+    .path = "test ipsec crypto",
+    .short_help = "test ipsec crypto [alg <alg>] [size <bytes>] "
+      "[packets <n>] [rounds <n>]",
+    .function = test_esp_crypto_command_fn,
+};
+/* *INDENT-ON* */
+
+clib_error_t *
+esp_crypto_init (vlib_main_t * vm)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+
+  ecm->engine_index_by_name = hash_create_string (0, sizeof (uword));
+  vec_validate_aligned (ecm->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+
+  esp_crypto_register_engine (&esp_crypto_openssl_engine);
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (esp_crypto_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,140 @@
+/*
+ * esp_crypto.h : IPSec ESP crypto engines
+ *
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __ESP_CRYPTO_H__
+#define __ESP_CRYPTO_H__
+
+#include <vnet/ipsec/ipsec.h>
+
+/*
+ * The ESP nodes do not run the cipher packet by packet. They queue one
+ * operation per packet and hand the whole frame to the active engine, so
+ * an engine can keep several packets in flight at once.
+ *
+ * Only the cipher goes through the engines. The ICV is still computed
+ * packet by packet with OpenSSL HMAC (hmac_calc in esp.h), after the
+ * cipher pass on encrypt and before it on decrypt, whichever engine is
+ * active. With HMAC-SHA the integrity pass costs about as much as the
+ * cipher, so single core throughput stays below the multi-buffer
+ * cryptodev path, which also batches the hash.
+ */
+
+typedef struct
+{
+  u8 *src;
+  u8 *dst;
+  u8 *key;
+  /* engines find the round keys they expanded beforehand here */
+  ipsec_sa_t *sa;
+  u8 *iv;
+  /* payload length, a multiple of the cipher block size */
+  u32 len;
+  ipsec_crypto_alg_t alg;
+} esp_crypto_op_t;
+
+/* all ops passed to a handler use the same algorithm */
+typedef void (esp_crypto_ops_fn_t) (esp_crypto_op_t * ops, u32 n_ops);
+
+typedef struct
+{
+  char *name;
+  char *description;
+  /* the supported engine with the highest priority is the default */
+  u32 priority;
+  int (*is_supported) (void);
+  /* per algorithm handlers, missing ones fall back to the openssl engine */
+  esp_crypto_ops_fn_t *encrypt[IPSEC_CRYPTO_N_ALG];
+  esp_crypto_ops_fn_t *decrypt[IPSEC_CRYPTO_N_ALG];
+  /* expands the SA key into its round keys, optional */
+  void (*key_update) (ipsec_sa_t * sa);
+} esp_crypto_engine_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  esp_crypto_op_t *ops;
+} esp_crypto_per_thread_data_t;
+
+typedef struct
+{
+  esp_crypto_engine_t *engines;
+  uword *engine_index_by_name;
+  u32 active_engine_index;
+  esp_crypto_per_thread_data_t *per_thread_data;
+} esp_crypto_main_t;
+
+extern esp_crypto_main_t esp_crypto_main;
+
+/* the openssl engine is always registered first */
+#define ESP_CRYPTO_ENGINE_OPENSSL 0
+
+u32 esp_crypto_register_engine (esp_crypto_engine_t * e);
+int esp_crypto_set_engine (char *name);
+void esp_crypto_sa_key_update (ipsec_sa_t * sa);
+
+/**
+ * @brief Run cipher operations on the given engine
+ *
+ * Consecutive ops with the same algorithm go to the engine in one call.
+ */
+always_inline void
+esp_crypto_run_engine (esp_crypto_engine_t * e, esp_crypto_op_t * ops,
+		       u32 n_ops, int is_encrypt)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+  esp_crypto_engine_t *fallback;
+  esp_crypto_ops_fn_t *fn;
+  u32 i, n;
+
+  fallback = vec_elt_at_index (ecm->engines, ESP_CRYPTO_ENGINE_OPENSSL);
+
+  while (n_ops)
+    {
+      for (n = 1; n < n_ops; n++)
+	if (ops[n].alg != ops[0].alg)
+	  break;
+
+      i = ops[0].alg;
+      fn = is_encrypt ? e->encrypt[i] : e->decrypt[i];
+      if (PREDICT_FALSE (fn == 0))
+	fn = is_encrypt ? fallback->encrypt[i] : fallback->decrypt[i];
+      if (PREDICT_TRUE (fn != 0))
+	fn (ops, n);
+
+      ops += n;
+      n_ops -= n;
+    }
+}
+
+always_inline void
+esp_crypto_run (esp_crypto_op_t * ops, u32 n_ops, int is_encrypt)
+{
+  esp_crypto_main_t *ecm = &esp_crypto_main;
+
+  esp_crypto_run_engine (vec_elt_at_index (ecm->engines,
+					   ecm->active_engine_index),
+			 ops, n_ops, is_encrypt);
+}
+
+#endif /* __ESP_CRYPTO_H__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,426 @@
+/*
+ * esp_crypto_aesni.c : IPSec ESP AES-NI multi-buffer crypto engine
+ *
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/ipsec/ipsec.h>
+#include <vnet/ipsec/esp_crypto.h>
+
+#if defined (__x86_64__)
+#include <x86intrin.h>
+
+/*
+ * CBC encryption is serial within a packet, every block depends on the
+ * previous one. To keep the AES units busy the engine encrypts
+ * AESNI_MB_LANES packets at once and interleaves their rounds, refilling
+ * a lane with the next packet as soon as one finishes. CBC decryption is
+ * parallel within a packet, so it works on AESNI_MB_LANES blocks of the
+ * same packet instead.
+ */
+#define AESNI_MB_LANES 4
+#define AESNI_MAX_ROUNDS 14
+
+#define __aesni_target __attribute__ ((target ("aes,sse4.1")))
+
+typedef struct
+{
+  __m128i k[AESNI_MAX_ROUNDS + 1];
+} aesni_key_schedule_t;
+
+static_always_inline __aesni_target __m128i
+aesni_key_shift_xor (__m128i a)
+{
+  a = _mm_xor_si128 (a, _mm_slli_si128 (a, 4));
+  a = _mm_xor_si128 (a, _mm_slli_si128 (a, 4));
+  return _mm_xor_si128 (a, _mm_slli_si128 (a, 4));
+}
+
+static_always_inline __aesni_target __m128i
+aesni_key_128_assist (__m128i k, __m128i t)
+{
+  return _mm_xor_si128 (aesni_key_shift_xor (k),
+			_mm_shuffle_epi32 (t, 0xff));
+}
+
+static_always_inline __aesni_target void
+aesni_key_expand_128 (u8 * key, __m128i * k)
+{
+  k[0] = _mm_loadu_si128 ((__m128i *) key);
+#define _(i, rcon) \
+  k[i] = aesni_key_128_assist (k[i - 1], \
+			       _mm_aeskeygenassist_si128 (k[i - 1], rcon));
+  _(1, 0x01) _(2, 0x02) _(3, 0x04) _(4, 0x08) _(5, 0x10)
+  _(6, 0x20) _(7, 0x40) _(8, 0x80) _(9, 0x1b) _(10, 0x36)
+#undef _
+}
+
+static_always_inline __aesni_target void
+aesni_key_192_assist (__m128i * t1, __m128i t2, __m128i * t3)
+{
+  *t1 = _mm_xor_si128 (aesni_key_shift_xor (*t1),
+		       _mm_shuffle_epi32 (t2, 0x55));
+  t2 = _mm_shuffle_epi32 (*t1, 0xff);
+  *t3 = _mm_xor_si128 (*t3, _mm_slli_si128 (*t3, 4));
+  *t3 = _mm_xor_si128 (*t3, t2);
+}
+
+static_always_inline __aesni_target __m128i
+aesni_key_192_lo (__m128i a, __m128i b)
+{
+  return (__m128i) _mm_shuffle_pd ((__m128d) a, (__m128d) b, 0);
+}
+
+static_always_inline __aesni_target __m128i
+aesni_key_192_hi (__m128i a, __m128i b)
+{
+  return (__m128i) _mm_shuffle_pd ((__m128d) a, (__m128d) b, 1);
+}
+
+static_always_inline __aesni_target void
+aesni_key_expand_192 (u8 * key, __m128i * k)
+{
+  __m128i t1, t3;
+
+  /* reads 8 bytes past the 24 byte key, the SA key buffer is larger */
+  t1 = _mm_loadu_si128 ((__m128i *) key);
+  t3 = _mm_loadu_si128 ((__m128i *) (key + 16));
+
+  k[0] = t1;
+  k[1] = t3;
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x01), &t3);
+  k[1] = aesni_key_192_lo (k[1], t1);
+  k[2] = aesni_key_192_hi (t1, t3);
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x02), &t3);
+  k[3] = t1;
+  k[4] = t3;
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x04), &t3);
+  k[4] = aesni_key_192_lo (k[4], t1);
+  k[5] = aesni_key_192_hi (t1, t3);
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x08), &t3);
+  k[6] = t1;
+  k[7] = t3;
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x10), &t3);
+  k[7] = aesni_key_192_lo (k[7], t1);
+  k[8] = aesni_key_192_hi (t1, t3);
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x20), &t3);
+  k[9] = t1;
+  k[10] = t3;
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x40), &t3);
+  k[10] = aesni_key_192_lo (k[10], t1);
+  k[11] = aesni_key_192_hi (t1, t3);
+  aesni_key_192_assist (&t1, _mm_aeskeygenassist_si128 (t3, 0x80), &t3);
+  k[12] = t1;
+}
+
+static_always_inline __aesni_target __m128i
+aesni_key_256_assist_1 (__m128i k, __m128i t)
+{
+  return _mm_xor_si128 (aesni_key_shift_xor (k),
+			_mm_shuffle_epi32 (t, 0xff));
+}
+
+static_always_inline __aesni_target __m128i
+aesni_key_256_assist_2 (__m128i k1, __m128i k3)
+{
+  __m128i t = _mm_shuffle_epi32 (_mm_aeskeygenassist_si128 (k1, 0), 0xaa);
+  return _mm_xor_si128 (aesni_key_shift_xor (k3), t);
+}
+
+static_always_inline __aesni_target void
+aesni_key_expand_256 (u8 * key, __m128i * k)
+{
+  k[0] = _mm_loadu_si128 ((__m128i *) key);
+  k[1] = _mm_loadu_si128 ((__m128i *) (key + 16));
+#define _(i, rcon) \
+  k[i] = aesni_key_256_assist_1 (k[i - 2], \
+				 _mm_aeskeygenassist_si128 (k[i - 1], rcon)); \
+  if (i < 14)								\
+    k[i + 1] = aesni_key_256_assist_2 (k[i], k[i - 1]);
+  _(2, 0x01) _(4, 0x02) _(6, 0x04) _(8, 0x08) _(10, 0x10) _(12, 0x20)
+  _(14, 0x40)
+#undef _
+}
+
+static_always_inline __aesni_target void
+aesni_key_expand (u8 * key, __m128i * k, int rounds)
+{
+  if (rounds == 10)
+    aesni_key_expand_128 (key, k);
+  else if (rounds == 12)
+    aesni_key_expand_192 (key, k);
+  else
+    aesni_key_expand_256 (key, k);
+}
+
+/* equivalent inverse cipher round keys, in the order they are used */
+static_always_inline __aesni_target void
+aesni_key_dec (__m128i * k, __m128i * dk, int rounds)
+{
+  int i;
+
+  dk[0] = k[rounds];
+  for (i = 1; i < rounds; i++)
+    dk[i] = _mm_aesimc_si128 (k[rounds - i]);
+  dk[rounds] = k[0];
+}
+
+/* round keys are expanded once, when the SA key is set */
+static_always_inline __aesni_target __m128i *
+aesni_sa_round_keys (ipsec_sa_t * sa, int is_encrypt)
+{
+  return (__m128i *) (is_encrypt ? sa->crypto_enc_round_keys :
+		      sa->crypto_dec_round_keys);
+}
+
+static_always_inline __aesni_target void
+aesni_cbc_enc_mb (esp_crypto_op_t * ops, u32 n_ops, int rounds)
+{
+  aesni_key_schedule_t dummy_ks;
+  __m128i *ks[AESNI_MB_LANES];
+  __m128i s[AESNI_MB_LANES];
+  u8 *src[AESNI_MB_LANES], *dst[AESNI_MB_LANES];
+  u32 n_left[AESNI_MB_LANES];
+  u8 dummy[16] = { 0 };
+  u32 next_op = 0, n_active = 0, n, i, j;
+  int l, r;
+
+  memset (&dummy_ks, 0, sizeof (dummy_ks));
+  for (l = 0; l < AESNI_MB_LANES; l++)
+    {
+      src[l] = dst[l] = dummy;
+      n_left[l] = 0;
+      ks[l] = dummy_ks.k;
+      s[l] = _mm_setzero_si128 ();
+    }
+
+  while (1)
+    {
+      /* load finished lanes with the next packets */
+      for (l = 0; l < AESNI_MB_LANES; l++)
+	{
+	  if (n_left[l])
+	    continue;
+	  if (src[l] != dummy)
+	    {
+	      src[l] = dst[l] = dummy;
+	      n_active--;
+	    }
+	  /* nothing to do for empty payloads */
+	  while (next_op < n_ops && ops[next_op].len < 16)
+	    next_op++;
+	  if (next_op == n_ops)
+	    continue;
+
+	  esp_crypto_op_t *op = ops + next_op++;
+	  ks[l] = aesni_sa_round_keys (op->sa, 1 /* is_encrypt */ );
+	  s[l] = _mm_loadu_si128 ((__m128i *) op->iv);
+	  src[l] = op->src;
+	  dst[l] = op->dst;
+	  n_left[l] = op->len / 16;
+	  n_active++;
+	}
+
+      if (n_active == 0)
+	break;
+
+      /* run all lanes until the shortest one is done */
+      n = ~0;
+      for (l = 0; l < AESNI_MB_LANES; l++)
+	if (n_left[l] && n_left[l] < n)
+	  n = n_left[l];
+
+      for (i = 0; i < n; i++)
+	{
+	  for (l = 0; l < AESNI_MB_LANES; l++)
+	    s[l] = _mm_xor_si128 (_mm_xor_si128 (s[l],
+						 _mm_loadu_si128 (ks[l])),
+				  _mm_loadu_si128 ((__m128i *) src[l]));
+	  for (r = 1; r < rounds; r++)
+	    for (l = 0; l < AESNI_MB_LANES; l++)
+	      s[l] = _mm_aesenc_si128 (s[l], _mm_loadu_si128 (ks[l] + r));
+	  for (l = 0; l < AESNI_MB_LANES; l++)
+	    {
+	      s[l] = _mm_aesenclast_si128 (s[l],
+					   _mm_loadu_si128 (ks[l] + rounds));
+	      _mm_storeu_si128 ((__m128i *) dst[l], s[l]);
+	      if (src[l] != dummy)
+		{
+		  src[l] += 16;
+		  dst[l] += 16;
+		}
+	    }
+	}
+
+      for (j = 0; j < AESNI_MB_LANES; j++)
+	if (n_left[j])
+	  n_left[j] -= n;
+    }
+}
+
+static_always_inline __aesni_target void
+aesni_cbc_dec (esp_crypto_op_t * ops, u32 n_ops, int rounds)
+{
+  __m128i dk[AESNI_MAX_ROUNDS + 1], *sa_dk;
+  __m128i c[AESNI_MB_LANES], s[AESNI_MB_LANES], prev;
+  ipsec_sa_t *last_sa = 0;
+  u8 *src, *dst;
+  u32 i, n_blocks;
+  int l, r;
+
+  for (i = 0; i < n_ops; i++)
+    {
+      esp_crypto_op_t *op = ops + i;
+
+      if (op->sa != last_sa)
+	{
+	  sa_dk = aesni_sa_round_keys (op->sa, 0 /* is_encrypt */ );
+	  for (r = 0; r <= rounds; r++)
+	    dk[r] = _mm_loadu_si128 (sa_dk + r);
+	  last_sa = op->sa;
+	}
+
+      prev = _mm_loadu_si128 ((__m128i *) op->iv);
+      src = op->src;
+      dst = op->dst;
+      n_blocks = op->len / 16;
+
+      while (n_blocks >= AESNI_MB_LANES)
+	{
+	  for (l = 0; l < AESNI_MB_LANES; l++)
+	    {
+	      c[l] = _mm_loadu_si128 ((__m128i *) src + l);
+	      s[l] = _mm_xor_si128 (c[l], dk[0]);
+	    }
+	  for (r = 1; r < rounds; r++)
+	    for (l = 0; l < AESNI_MB_LANES; l++)
+	      s[l] = _mm_aesdec_si128 (s[l], dk[r]);
+	  for (l = 0; l < AESNI_MB_LANES; l++)
+	    {
+	      s[l] = _mm_aesdeclast_si128 (s[l], dk[rounds]);
+	      s[l] = _mm_xor_si128 (s[l], prev);
+	      prev = c[l];
+	      _mm_storeu_si128 ((__m128i *) dst + l, s[l]);
+	    }
+	  src += AESNI_MB_LANES * 16;
+	  dst += AESNI_MB_LANES * 16;
+	  n_blocks -= AESNI_MB_LANES;
+	}
+
+      while (n_blocks)
+	{
+	  c[0] = _mm_loadu_si128 ((__m128i *) src);
+	  s[0] = _mm_xor_si128 (c[0], dk[0]);
+	  for (r = 1; r < rounds; r++)
+	    s[0] = _mm_aesdec_si128 (s[0], dk[r]);
+	  s[0] = _mm_aesdeclast_si128 (s[0], dk[rounds]);
+	  _mm_storeu_si128 ((__m128i *) dst, _mm_xor_si128 (s[0], prev));
+	  prev = c[0];
+	  src += 16;
+	  dst += 16;
+	  n_blocks--;
+	}
+    }
+}
+
+#define foreach_aesni_key_size \
+  _(128, 10)                   \
+  _(192, 12)                   \
+  _(256, 14)
+
+#define _(b, r)								\
+static __aesni_target void						\
+esp_crypto_aesni_encrypt_##b (esp_crypto_op_t * ops, u32 n_ops)	\
+{									\
+  aesni_cbc_enc_mb (ops, n_ops, r);					\
+}									\
+									\
+static __aesni_target void						\
+esp_crypto_aesni_decrypt_##b (esp_crypto_op_t * ops, u32 n_ops)	\
+{									\
+  aesni_cbc_dec (ops, n_ops, r);					\
+}
+foreach_aesni_key_size
+#undef _
+
+static __aesni_target void
+esp_crypto_aesni_key_update (ipsec_sa_t * sa)
+{
+  __m128i k[AESNI_MAX_ROUNDS + 1], dk[AESNI_MAX_ROUNDS + 1];
+  int rounds;
+
+  switch (sa->crypto_alg)
+    {
+#define _(b, r) \
+    case IPSEC_CRYPTO_ALG_AES_CBC_##b: rounds = r; break;
+      foreach_aesni_key_size
+#undef _
+    default:
+      return;
+    }
+
+  aesni_key_expand (sa->crypto_key, k, rounds);
+  aesni_key_dec (k, dk, rounds);
+  clib_memcpy (sa->crypto_enc_round_keys, k, (rounds + 1) * sizeof (k[0]));
+  clib_memcpy (sa->crypto_dec_round_keys, dk, (rounds + 1) * sizeof (dk[0]));
+}
+
+static int
+esp_crypto_aesni_is_supported (void)
+{
+  return clib_cpu_supports_aes () && clib_cpu_supports_sse41 ();
+}
+
+/* *INDENT-OFF* */
+static esp_crypto_engine_t esp_crypto_aesni_engine = {
+  .name = "aesni-mb",
+  .description = "AES-NI multi-buffer CBC, HMAC on OpenSSL",
+  .priority = 10,
+  .is_supported = esp_crypto_aesni_is_supported,
+  .key_update = esp_crypto_aesni_key_update,
+#define _(b, r) \
+  .encrypt[IPSEC_CRYPTO_ALG_AES_CBC_##b] = esp_crypto_aesni_encrypt_##b, \
+  .decrypt[IPSEC_CRYPTO_ALG_AES_CBC_##b] = esp_crypto_aesni_decrypt_##b,
+  foreach_aesni_key_size
+#undef _
+};
+/* *INDENT-ON* */
+
+#endif /* __x86_64__ */
+
+static clib_error_t *
+esp_crypto_aesni_init (vlib_main_t * vm)
+{
+  clib_error_t *error;
+
+  if ((error = vlib_call_init_function (vm, esp_crypto_init)))
+    return error;
+
+#if defined (__x86_64__)
+  esp_crypto_register_engine (&esp_crypto_aesni_engine);
+#endif
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (esp_crypto_aesni_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -21,6 +21,7 @@
 
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/esp.h>
+#include <vnet/ipsec/esp_crypto.h>
 
 #define foreach_esp_decrypt_next                \
 _(DROP, "error-drop")                           \
@@ -43,7 +44,8 @@ typedef enum
  _(DECRYPTION_FAILED, "ESP decryption failed")      \
  _(INTEG_ERROR, "Integrity check failed")           \
  _(REPLAY, "SA replayed packet")                    \
- _(NOT_IP, "Not IP packet (dropped)")
+ _(NOT_IP, "Not IP packet (dropped)")              \
+ _(HANDOFF_CONGESTED, "SA owner queue congested (packet dropped)")
 
 
 typedef enum
@@ -80,51 +82,57 @@ format_esp_decrypt_trace (u8 * s, va_list * args)
   return s;
 }
 
-always_inline void
-esp_decrypt_cbc (ipsec_crypto_alg_t alg,
-		 u8 * in, u8 * out, size_t in_len, u8 * key, u8 * iv)
+/* per packet state kept between queueing the cipher and parsing the
+   decrypted payload */
+typedef struct
 {
-  ipsec_proto_main_t *em = &ipsec_proto_main;
-  u32 thread_index = vlib_get_thread_index ();
-#if OPENSSL_VERSION_NUMBER >= 0x10100000L
-  EVP_CIPHER_CTX *ctx = em->per_thread_data[thread_index].decrypt_ctx;
-#else
-  EVP_CIPHER_CTX *ctx = &(em->per_thread_data[thread_index].decrypt_ctx);
-#endif
-  const EVP_CIPHER *cipher = NULL;
-  int out_len;
-
-  ASSERT (alg < IPSEC_CRYPTO_N_ALG);
-
-  if (PREDICT_FALSE (em->ipsec_proto_main_crypto_algs[alg].type == 0))
-    return;
-
-  if (PREDICT_FALSE
-      (alg != em->per_thread_data[thread_index].last_decrypt_alg))
-    {
-      cipher = em->ipsec_proto_main_crypto_algs[alg].type;
-      em->per_thread_data[thread_index].last_decrypt_alg = alg;
-    }
-
-  EVP_DecryptInit_ex (ctx, cipher, NULL, key, iv);
-
-  EVP_DecryptUpdate (ctx, out, &out_len, in, in_len);
-  EVP_DecryptFinal_ex (ctx, out + out_len, &out_len);
-}
+  vlib_buffer_t *i_b;
+  vlib_buffer_t *o_b;
+  ipsec_sa_t *sa;
+  ip4_header_t *ih4;
+  u32 len;
+  u32 seq;
+  u32 seq_hi;
+  u8 replayed;
+  u8 ip_hdr_size;
+  u8 tunnel_mode;
+  u8 transport_ip6;
+  u8 needs_finish;
+} esp_decrypt_packet_t;
 
 static uword
 esp_decrypt_node_fn (vlib_main_t * vm,
 		     vlib_node_runtime_t * node, vlib_frame_t * from_frame)
 {
-  u32 n_left_from, *from, next_index, *to_next;
+  u32 n_left_from, *from;
   ipsec_main_t *im = &ipsec_main;
   ipsec_proto_main_t *em = &ipsec_proto_main;
   u32 *recycle = 0;
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
   u32 thread_index = vlib_get_thread_index ();
+  esp_crypto_per_thread_data_t *ptd =
+    vec_elt_at_index (esp_crypto_main.per_thread_data, thread_index);
+  esp_decrypt_packet_t pkts[VLIB_FRAME_SIZE], *p;
+  u32 bis[VLIB_FRAME_SIZE];
+  u16 nexts[VLIB_FRAME_SIZE];
+  u32 i, n_pkts = 0;
+  u32 local[VLIB_FRAME_SIZE], n_congested;
+
+  /* packets of SAs pinned to other threads continue there */
+  if (PREDICT_FALSE (im->esp_decrypt_fq_index != ~0))
+    {
+      n_left_from = ipsec_handoff (vm, im->esp_decrypt_fq_index, from,
+				   n_left_from, local, &n_congested);
+      from = local;
+      if (n_congested)
+	vlib_node_increment_counter (vm, esp_decrypt_node.index,
+				     ESP_DECRYPT_ERROR_HANDOFF_CONGESTED,
+				     n_congested);
+    }
 
   ipsec_alloc_empty_buffers (vm, im);
+  vec_reset_length (ptd->ops);
 
   u32 *empty_buffers = im->empty_buffers[thread_index];
 
@@ -135,279 +143,303 @@ esp_decrypt_node_fn (vlib_main_t * vm,
       goto free_buffers_and_exit;
     }
 
-  next_index = node->cached_next_index;
-
-  while (n_left_from > 0)
+  /* anti-replay check of the whole frame before any ICV is computed,
+     the window itself only moves once a packet is authenticated */
+  for (i = 0; i < n_left_from; i++)
     {
-      u32 n_left_to_next;
+      esp_header_t *esp0;
+      ipsec_sa_t *sa0;
+
+      p = pkts + i;
+      memset (p, 0, sizeof (*p));
 
-      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+      p->i_b = vlib_get_buffer (vm, from[i]);
+      esp0 = vlib_buffer_get_current (p->i_b);
+      sa0 = pool_elt_at_index (im->sad,
+			       vnet_buffer (p->i_b)->ipsec.sad_index);
+      p->sa = sa0;
+      p->tunnel_mode = 1;
+      p->seq = clib_net_to_host_u32 (esp0->seq);
 
-      while (n_left_from > 0 && n_left_to_next > 0)
+      if (sa0->use_anti_replay)
 	{
-	  u32 i_bi0, o_bi0 = (u32) ~ 0, next0;
-	  vlib_buffer_t *i_b0;
-	  vlib_buffer_t *o_b0 = 0;
-	  esp_header_t *esp0;
-	  ipsec_sa_t *sa0;
-	  u32 sa_index0 = ~0;
-	  u32 seq;
-	  ip4_header_t *ih4 = 0, *oh4 = 0;
-	  ip6_header_t *ih6 = 0, *oh6 = 0;
-	  u8 tunnel_mode = 1;
-	  u8 transport_ip6 = 0;
+	  if (PREDICT_TRUE (sa0->use_esn))
+	    p->replayed = esp_replay_check_esn (sa0, p->seq);
+	  else
+	    p->replayed = esp_replay_check (sa0, p->seq);
+	}
+      p->seq_hi = sa0->seq_hi;
+    }
 
+  /* verify, update the window and queue the cipher for every packet */
+  while (n_left_from > 0)
+    {
+      u32 i_bi0, o_bi0 = (u32) ~ 0, next0;
+      vlib_buffer_t *i_b0;
+      vlib_buffer_t *o_b0 = 0;
+      esp_header_t *esp0;
+      ipsec_sa_t *sa0;
+      esp_crypto_op_t *op;
 
-	  i_bi0 = from[0];
-	  from += 1;
-	  n_left_from -= 1;
-	  n_left_to_next -= 1;
+      i_bi0 = from[0];
+      from += 1;
+      n_left_from -= 1;
 
-	  next0 = ESP_DECRYPT_NEXT_DROP;
+      p = pkts + n_pkts;
+      i_b0 = p->i_b;
+      sa0 = p->sa;
+      esp0 = vlib_buffer_get_current (i_b0);
 
-	  i_b0 = vlib_get_buffer (vm, i_bi0);
-	  esp0 = vlib_buffer_get_current (i_b0);
+      next0 = ESP_DECRYPT_NEXT_DROP;
 
-	  sa_index0 = vnet_buffer (i_b0)->ipsec.sad_index;
-	  sa0 = pool_elt_at_index (im->sad, sa_index0);
+      if (PREDICT_FALSE (p->replayed))
+	{
+	replayed:
+	  clib_warning ("anti-replay SPI %u seq %u", sa0->spi, p->seq);
+	  vlib_node_increment_counter (vm, esp_decrypt_node.index,
+				       ESP_DECRYPT_ERROR_REPLAY, 1);
+	  o_bi0 = i_bi0;
+	  goto next;
+	}
 
-	  seq = clib_host_to_net_u32 (esp0->seq);
+      sa0->total_data_size += i_b0->current_length;
 
-	  /* anti-replay check */
-	  if (sa0->use_anti_replay)
+      if (PREDICT_TRUE (sa0->integ_alg != IPSEC_INTEG_ALG_NONE))
+	{
+	  u8 sig[64];
+	  int icv_size =
+	    em->ipsec_proto_main_integ_algs[sa0->integ_alg].trunc_size;
+	  memset (sig, 0, sizeof (sig));
+	  u8 *icv =
+	    vlib_buffer_get_current (i_b0) + i_b0->current_length - icv_size;
+	  i_b0->current_length -= icv_size;
+
+	  hmac_calc (sa0->integ_alg, sa0->integ_key, sa0->integ_key_len,
+		     (u8 *) esp0, i_b0->current_length, sig, sa0->use_esn,
+		     p->seq_hi);
+
+	  if (PREDICT_FALSE (memcmp (icv, sig, icv_size)))
 	    {
-	      int rv = 0;
-
-	      if (PREDICT_TRUE (sa0->use_esn))
-		rv = esp_replay_check_esn (sa0, seq);
-	      else
-		rv = esp_replay_check (sa0, seq);
-
-	      if (PREDICT_FALSE (rv))
-		{
-		  clib_warning ("anti-replay SPI %u seq %u", sa0->spi, seq);
-		  vlib_node_increment_counter (vm, esp_decrypt_node.index,
-					       ESP_DECRYPT_ERROR_REPLAY, 1);
-		  o_bi0 = i_bi0;
-		  to_next[0] = o_bi0;
-		  to_next += 1;
-		  goto trace;
-		}
+	      vlib_node_increment_counter (vm, esp_decrypt_node.index,
+					   ESP_DECRYPT_ERROR_INTEG_ERROR, 1);
+	      o_bi0 = i_bi0;
+	      goto next;
 	    }
+	}
 
-	  sa0->total_data_size += i_b0->current_length;
-
-	  if (PREDICT_TRUE (sa0->integ_alg != IPSEC_INTEG_ALG_NONE))
-	    {
-	      u8 sig[64];
-	      int icv_size =
-		em->ipsec_proto_main_integ_algs[sa0->integ_alg].trunc_size;
-	      memset (sig, 0, sizeof (sig));
-	      u8 *icv =
-		vlib_buffer_get_current (i_b0) + i_b0->current_length -
-		icv_size;
-	      i_b0->current_length -= icv_size;
-
-	      hmac_calc (sa0->integ_alg, sa0->integ_key, sa0->integ_key_len,
-			 (u8 *) esp0, i_b0->current_length, sig, sa0->use_esn,
-			 sa0->seq_hi);
-
-	      if (PREDICT_FALSE (memcmp (icv, sig, icv_size)))
-		{
-		  vlib_node_increment_counter (vm, esp_decrypt_node.index,
-					       ESP_DECRYPT_ERROR_INTEG_ERROR,
-					       1);
-		  o_bi0 = i_bi0;
-		  to_next[0] = o_bi0;
-		  to_next += 1;
-		  goto trace;
-		}
-	    }
+      /* a duplicate of a packet earlier in this frame passes the check
+         above but is caught here */
+      if (PREDICT_TRUE (sa0->use_anti_replay))
+	{
+	  int rv;
 
-	  if (PREDICT_TRUE (sa0->use_anti_replay))
+	  if (PREDICT_TRUE (sa0->use_esn))
 	    {
-	      if (PREDICT_TRUE (sa0->use_esn))
-		esp_replay_advance_esn (sa0, seq);
-	      else
-		esp_replay_advance (sa0, seq);
+	      sa0->seq_hi = p->seq_hi;
+	      rv = esp_replay_advance_esn (sa0, p->seq);
 	    }
+	  else
+	    rv = esp_replay_advance (sa0, p->seq);
 
-	  /* grab free buffer */
-	  uword last_empty_buffer = vec_len (empty_buffers) - 1;
-	  o_bi0 = empty_buffers[last_empty_buffer];
-	  to_next[0] = o_bi0;
-	  to_next += 1;
-	  o_b0 = vlib_get_buffer (vm, o_bi0);
-	  vlib_prefetch_buffer_with_index (vm,
-					   empty_buffers[last_empty_buffer -
-							 1], STORE);
-	  _vec_len (empty_buffers) = last_empty_buffer;
-
-	  /* add old buffer to the recycle list */
-	  vec_add1 (recycle, i_bi0);
-
-	  if ((sa0->crypto_alg >= IPSEC_CRYPTO_ALG_AES_CBC_128 &&
-	       sa0->crypto_alg <= IPSEC_CRYPTO_ALG_AES_CBC_256) ||
-	      (sa0->crypto_alg >= IPSEC_CRYPTO_ALG_DES_CBC &&
-	       sa0->crypto_alg <= IPSEC_CRYPTO_ALG_3DES_CBC))
-	    {
-	      const int BLOCK_SIZE =
-		em->ipsec_proto_main_crypto_algs[sa0->crypto_alg].block_size;;
-	      const int IV_SIZE =
-		em->ipsec_proto_main_crypto_algs[sa0->crypto_alg].iv_size;
-	      esp_footer_t *f0;
-	      u8 ip_hdr_size = 0;
+	  if (PREDICT_FALSE (rv))
+	    goto replayed;
+	}
 
-	      int blocks =
-		(i_b0->current_length - sizeof (esp_header_t) -
-		 IV_SIZE) / BLOCK_SIZE;
+      /* grab free buffer */
+      uword last_empty_buffer = vec_len (empty_buffers) - 1;
+      o_bi0 = empty_buffers[last_empty_buffer];
+      o_b0 = vlib_get_buffer (vm, o_bi0);
+      vlib_prefetch_buffer_with_index (vm,
+				       empty_buffers[last_empty_buffer - 1],
+				       STORE);
+      _vec_len (empty_buffers) = last_empty_buffer;
+      p->o_b = o_b0;
+
+      /* add old buffer to the recycle list */
+      vec_add1 (recycle, i_bi0);
+
+      if ((sa0->crypto_alg >= IPSEC_CRYPTO_ALG_AES_CBC_128 &&
+	   sa0->crypto_alg <= IPSEC_CRYPTO_ALG_AES_CBC_256) ||
+	  (sa0->crypto_alg >= IPSEC_CRYPTO_ALG_DES_CBC &&
+	   sa0->crypto_alg <= IPSEC_CRYPTO_ALG_3DES_CBC))
+	{
+	  const int BLOCK_SIZE =
+	    em->ipsec_proto_main_crypto_algs[sa0->crypto_alg].block_size;;
+	  const int IV_SIZE =
+	    em->ipsec_proto_main_crypto_algs[sa0->crypto_alg].iv_size;
+	  ip4_header_t *ih4;
 
-	      o_b0->current_data = sizeof (ethernet_header_t);
+	  int blocks =
+	    (i_b0->current_length - sizeof (esp_header_t) -
+	     IV_SIZE) / BLOCK_SIZE;
 
-	      /* transport mode */
-	      if (PREDICT_FALSE (!sa0->is_tunnel && !sa0->is_tunnel_ip6))
-		{
-		  tunnel_mode = 0;
+	  o_b0->current_data = sizeof (ethernet_header_t);
 
-		  if (i_b0->flags & VNET_BUFFER_F_IS_IP4)
-		    ih4 =
-		      (ip4_header_t *) ((u8 *) esp0 - sizeof (ip4_header_t));
-		  else
-		    ih4 =
-		      (ip4_header_t *) ((u8 *) esp0 - sizeof (ip6_header_t));
+	  /* transport mode */
+	  if (PREDICT_FALSE (!sa0->is_tunnel && !sa0->is_tunnel_ip6))
+	    {
+	      p->tunnel_mode = 0;
 
-		  if (PREDICT_TRUE
-		      ((ih4->ip_version_and_header_length & 0xF0) != 0x40))
-		    {
-		      if (PREDICT_TRUE
-			  ((ih4->ip_version_and_header_length & 0xF0) ==
-			   0x60))
-			{
-			  transport_ip6 = 1;
-			  ip_hdr_size = sizeof (ip6_header_t);
-			  ih6 = (ip6_header_t *) ih4;
-			  oh6 = vlib_buffer_get_current (o_b0);
-			}
-		      else
-			{
-			  vlib_node_increment_counter (vm,
-						       esp_decrypt_node.index,
-						       ESP_DECRYPT_ERROR_NOT_IP,
-						       1);
-			  o_b0 = 0;
-			  goto trace;
-			}
-		    }
-		  else
-		    {
-		      oh4 = vlib_buffer_get_current (o_b0);
-		      ip_hdr_size = sizeof (ip4_header_t);
-		    }
-		}
+	      if (i_b0->flags & VNET_BUFFER_F_IS_IP4)
+		ih4 = (ip4_header_t *) ((u8 *) esp0 - sizeof (ip4_header_t));
+	      else
+		ih4 = (ip4_header_t *) ((u8 *) esp0 - sizeof (ip6_header_t));
 
-	      esp_decrypt_cbc (sa0->crypto_alg,
-			       esp0->data + IV_SIZE,
-			       (u8 *) vlib_buffer_get_current (o_b0) +
-			       ip_hdr_size, BLOCK_SIZE * blocks,
-			       sa0->crypto_key, esp0->data);
-
-	      o_b0->current_length = (blocks * BLOCK_SIZE) - 2 + ip_hdr_size;
-	      o_b0->flags = VLIB_BUFFER_TOTAL_LENGTH_VALID;
-	      f0 =
-		(esp_footer_t *) ((u8 *) vlib_buffer_get_current (o_b0) +
-				  o_b0->current_length);
-	      o_b0->current_length -= f0->pad_length;
-
-	      /* tunnel mode */
-	      if (PREDICT_TRUE (tunnel_mode))
+	      if (PREDICT_TRUE
+		  ((ih4->ip_version_and_header_length & 0xF0) != 0x40))
 		{
-		  if (PREDICT_TRUE (f0->next_header == IP_PROTOCOL_IP_IN_IP))
+		  if (PREDICT_TRUE
+		      ((ih4->ip_version_and_header_length & 0xF0) == 0x60))
 		    {
-		      next0 = ESP_DECRYPT_NEXT_IP4_INPUT;
-		      oh4 = vlib_buffer_get_current (o_b0);
+		      p->transport_ip6 = 1;
+		      p->ip_hdr_size = sizeof (ip6_header_t);
 		    }
-		  else if (f0->next_header == IP_PROTOCOL_IPV6)
-		    next0 = ESP_DECRYPT_NEXT_IP6_INPUT;
 		  else
 		    {
-		      clib_warning ("next header: 0x%x", f0->next_header);
-		      vlib_node_increment_counter (vm, esp_decrypt_node.index,
-						   ESP_DECRYPT_ERROR_DECRYPTION_FAILED,
+		      vlib_node_increment_counter (vm,
+						   esp_decrypt_node.index,
+						   ESP_DECRYPT_ERROR_NOT_IP,
 						   1);
-		      o_b0 = 0;
-		      goto trace;
+		      p->o_b = 0;
+		      goto next;
 		    }
 		}
-	      /* transport mode */
 	      else
-		{
-		  if (PREDICT_FALSE (transport_ip6))
-		    {
-		      next0 = ESP_DECRYPT_NEXT_IP6_INPUT;
-		      oh6->ip_version_traffic_class_and_flow_label =
-			ih6->ip_version_traffic_class_and_flow_label;
-		      oh6->protocol = f0->next_header;
-		      oh6->hop_limit = ih6->hop_limit;
-		      oh6->src_address.as_u64[0] = ih6->src_address.as_u64[0];
-		      oh6->src_address.as_u64[1] = ih6->src_address.as_u64[1];
-		      oh6->dst_address.as_u64[0] = ih6->dst_address.as_u64[0];
-		      oh6->dst_address.as_u64[1] = ih6->dst_address.as_u64[1];
-		      oh6->payload_length =
-			clib_host_to_net_u16 (vlib_buffer_length_in_chain
-					      (vm,
-					       o_b0) - sizeof (ip6_header_t));
-		    }
-		  else
-		    {
-		      next0 = ESP_DECRYPT_NEXT_IP4_INPUT;
-		      oh4->ip_version_and_header_length = 0x45;
-		      oh4->tos = ih4->tos;
-		      oh4->fragment_id = 0;
-		      oh4->flags_and_fragment_offset = 0;
-		      oh4->ttl = ih4->ttl;
-		      oh4->protocol = f0->next_header;
-		      oh4->src_address.as_u32 = ih4->src_address.as_u32;
-		      oh4->dst_address.as_u32 = ih4->dst_address.as_u32;
-		      oh4->length =
-			clib_host_to_net_u16 (vlib_buffer_length_in_chain
-					      (vm, o_b0));
-		      oh4->checksum = ip4_header_checksum (oh4);
-		    }
-		}
-
-	      /* for IPSec-GRE tunnel next node is ipsec-gre-input */
-	      if (PREDICT_FALSE
-		  ((vnet_buffer (i_b0)->ipsec.flags) &
-		   IPSEC_FLAG_IPSEC_GRE_TUNNEL))
-		next0 = ESP_DECRYPT_NEXT_IPSEC_GRE_INPUT;
+		p->ip_hdr_size = sizeof (ip4_header_t);
 
-	      vnet_buffer (o_b0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
-	      vnet_buffer (o_b0)->sw_if_index[VLIB_RX] =
-		vnet_buffer (i_b0)->sw_if_index[VLIB_RX];
+	      p->ih4 = ih4;
 	    }
 
-	trace:
-	  if (PREDICT_FALSE (i_b0->flags & VLIB_BUFFER_IS_TRACED))
+	  p->len = BLOCK_SIZE * blocks;
+	  p->needs_finish = 1;
+
+	  vec_add2 (ptd->ops, op, 1);
+	  op->alg = sa0->crypto_alg;
+	  op->key = sa0->crypto_key;
+	  op->sa = sa0;
+	  op->iv = esp0->data;
+	  op->src = esp0->data + IV_SIZE;
+	  op->dst = (u8 *) vlib_buffer_get_current (o_b0) + p->ip_hdr_size;
+	  op->len = p->len;
+	}
+
+    next:
+      bis[n_pkts] = o_bi0;
+      nexts[n_pkts] = next0;
+      n_pkts++;
+    }
+
+  /* the input buffers stay around until the end of the frame */
+  esp_crypto_run (ptd->ops, vec_len (ptd->ops), 0 /* is_encrypt */ );
+
+  /* parse the decrypted payloads */
+  for (i = 0; i < n_pkts; i++)
+    {
+      vlib_buffer_t *i_b0, *o_b0;
+      esp_footer_t *f0;
+      ip4_header_t *ih4, *oh4 = 0;
+      ip6_header_t *ih6, *oh6 = 0;
+      u32 next0;
+
+      p = pkts + i;
+      if (!p->needs_finish)
+	goto trace;
+
+      i_b0 = p->i_b;
+      o_b0 = p->o_b;
+      ih4 = p->ih4;
+      ih6 = (ip6_header_t *) ih4;
+
+      o_b0->current_length = p->len - 2 + p->ip_hdr_size;
+      o_b0->flags = VLIB_BUFFER_TOTAL_LENGTH_VALID;
+      f0 =
+	(esp_footer_t *) ((u8 *) vlib_buffer_get_current (o_b0) +
+			  o_b0->current_length);
+      o_b0->current_length -= f0->pad_length;
+
+      /* tunnel mode */
+      if (PREDICT_TRUE (p->tunnel_mode))
+	{
+	  if (PREDICT_TRUE (f0->next_header == IP_PROTOCOL_IP_IN_IP))
+	    next0 = ESP_DECRYPT_NEXT_IP4_INPUT;
+	  else if (f0->next_header == IP_PROTOCOL_IPV6)
+	    next0 = ESP_DECRYPT_NEXT_IP6_INPUT;
+	  else
 	    {
-	      if (o_b0)
-		{
-		  o_b0->flags |= VLIB_BUFFER_IS_TRACED;
-		  o_b0->trace_index = i_b0->trace_index;
-		  esp_decrypt_trace_t *tr =
-		    vlib_add_trace (vm, node, o_b0, sizeof (*tr));
-		  tr->crypto_alg = sa0->crypto_alg;
-		  tr->integ_alg = sa0->integ_alg;
-		}
+	      clib_warning ("next header: 0x%x", f0->next_header);
+	      vlib_node_increment_counter (vm, esp_decrypt_node.index,
+					   ESP_DECRYPT_ERROR_DECRYPTION_FAILED,
+					   1);
+	      p->o_b = 0;
+	      goto trace;
+	    }
+	}
+      /* transport mode */
+      else
+	{
+	  if (PREDICT_FALSE (p->transport_ip6))
+	    {
+	      next0 = ESP_DECRYPT_NEXT_IP6_INPUT;
+	      oh6 = vlib_buffer_get_current (o_b0);
+	      oh6->ip_version_traffic_class_and_flow_label =
+		ih6->ip_version_traffic_class_and_flow_label;
+	      oh6->protocol = f0->next_header;
+	      oh6->hop_limit = ih6->hop_limit;
+	      oh6->src_address.as_u64[0] = ih6->src_address.as_u64[0];
+	      oh6->src_address.as_u64[1] = ih6->src_address.as_u64[1];
+	      oh6->dst_address.as_u64[0] = ih6->dst_address.as_u64[0];
+	      oh6->dst_address.as_u64[1] = ih6->dst_address.as_u64[1];
+	      oh6->payload_length =
+		clib_host_to_net_u16 (vlib_buffer_length_in_chain
+				      (vm, o_b0) - sizeof (ip6_header_t));
 	    }
+	  else
+	    {
+	      next0 = ESP_DECRYPT_NEXT_IP4_INPUT;
+	      oh4 = vlib_buffer_get_current (o_b0);
+	      oh4->ip_version_and_header_length = 0x45;
+	      oh4->tos = ih4->tos;
+	      oh4->fragment_id = 0;
+	      oh4->flags_and_fragment_offset = 0;
+	      oh4->ttl = ih4->ttl;
+	      oh4->protocol = f0->next_header;
+	      oh4->src_address.as_u32 = ih4->src_address.as_u32;
+	      oh4->dst_address.as_u32 = ih4->dst_address.as_u32;
+	      oh4->length =
+		clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm, o_b0));
+	      oh4->checksum = ip4_header_checksum (oh4);
+	    }
+	}
+
+      /* for IPSec-GRE tunnel next node is ipsec-gre-input */
+      if (PREDICT_FALSE
+	  ((vnet_buffer (i_b0)->ipsec.flags) & IPSEC_FLAG_IPSEC_GRE_TUNNEL))
+	next0 = ESP_DECRYPT_NEXT_IPSEC_GRE_INPUT;
+
+      vnet_buffer (o_b0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
+      vnet_buffer (o_b0)->sw_if_index[VLIB_RX] =
+	vnet_buffer (i_b0)->sw_if_index[VLIB_RX];
+      nexts[i] = next0;
 
-	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
-					   n_left_to_next, o_bi0, next0);
+    trace:
+      if (PREDICT_FALSE (p->i_b->flags & VLIB_BUFFER_IS_TRACED))
+	{
+	  if (p->o_b)
+	    {
+	      p->o_b->flags |= VLIB_BUFFER_IS_TRACED;
+	      p->o_b->trace_index = p->i_b->trace_index;
+	      esp_decrypt_trace_t *tr =
+		vlib_add_trace (vm, node, p->o_b, sizeof (*tr));
+	      tr->crypto_alg = p->sa->crypto_alg;
+	      tr->integ_alg = p->sa->integ_alg;
+	    }
 	}
-      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
+
+  vlib_buffer_enqueue_to_next (vm, node, bis, nexts, n_pkts);
+
   vlib_node_increment_counter (vm, esp_decrypt_node.index,
-			       ESP_DECRYPT_ERROR_RX_PKTS,
-			       from_frame->n_vectors);
+			       ESP_DECRYPT_ERROR_RX_PKTS, n_pkts);
 
 free_buffers_and_exit:
   if (recycle)
@@ -22,6 +22,7 @@
 
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/esp.h>
+#include <vnet/ipsec/esp_crypto.h>
 
 ipsec_proto_main_t ipsec_proto_main;
 
@@ -43,7 +44,8 @@ typedef enum
  _(RX_PKTS, "ESP pkts received")                    \
  _(NO_BUFFER, "No buffer (packet dropped)")         \
  _(DECRYPTION_FAILED, "ESP encryption failed")      \
- _(SEQ_CYCLED, "sequence number cycled")
+ _(SEQ_CYCLED, "sequence number cycled")           \
+ _(HANDOFF_CONGESTED, "SA owner queue congested (packet dropped)")
 
 
 typedef enum
@@ -87,52 +89,47 @@ format_esp_encrypt_trace (u8 * s, va_list * args)
   return s;
 }
 
-always_inline void
-esp_encrypt_cbc (ipsec_crypto_alg_t alg,
-		 u8 * in, u8 * out, size_t in_len, u8 * key, u8 * iv)
+typedef struct
 {
-  ipsec_proto_main_t *em = &ipsec_proto_main;
-  u32 thread_index = vlib_get_thread_index ();
-#if OPENSSL_VERSION_NUMBER >= 0x10100000L
-  EVP_CIPHER_CTX *ctx = em->per_thread_data[thread_index].encrypt_ctx;
-#else
-  EVP_CIPHER_CTX *ctx = &(em->per_thread_data[thread_index].encrypt_ctx);
-#endif
-  const EVP_CIPHER *cipher = NULL;
-  int out_len;
-
-  ASSERT (alg < IPSEC_CRYPTO_N_ALG);
-
-  if (PREDICT_FALSE
-      (em->ipsec_proto_main_crypto_algs[alg].type == IPSEC_CRYPTO_ALG_NONE))
-    return;
-
-  if (PREDICT_FALSE
-      (alg != em->per_thread_data[thread_index].last_encrypt_alg))
-    {
-      cipher = em->ipsec_proto_main_crypto_algs[alg].type;
-      em->per_thread_data[thread_index].last_encrypt_alg = alg;
-    }
-
-  EVP_EncryptInit_ex (ctx, cipher, NULL, key, iv);
-
-  EVP_EncryptUpdate (ctx, out, &out_len, in, in_len);
-  EVP_EncryptFinal_ex (ctx, out + out_len, &out_len);
-}
+  ipsec_sa_t *sa;
+  u8 *data;
+  u8 *digest;
+  u32 len;
+  u32 seq_hi;
+} esp_encrypt_integ_op_t;
 
 static uword
 esp_encrypt_node_fn (vlib_main_t * vm,
 		     vlib_node_runtime_t * node, vlib_frame_t * from_frame)
 {
-  u32 n_left_from, *from, *to_next = 0, next_index;
+  u32 n_left_from, *from, *to_next = 0, next_index, n_pkts;
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
   ipsec_main_t *im = &ipsec_main;
   ipsec_proto_main_t *em = &ipsec_proto_main;
   u32 *recycle = 0;
   u32 thread_index = vlib_get_thread_index ();
+  esp_crypto_per_thread_data_t *ptd =
+    vec_elt_at_index (esp_crypto_main.per_thread_data, thread_index);
+  esp_encrypt_integ_op_t integ_ops[VLIB_FRAME_SIZE], *integ_op;
+  u32 n_integ_ops = 0;
+  u32 local[VLIB_FRAME_SIZE], n_congested;
+
+  /* packets of SAs pinned to other threads continue there */
+  if (PREDICT_FALSE (im->esp_encrypt_fq_index != ~0))
+    {
+      n_left_from = ipsec_handoff (vm, im->esp_encrypt_fq_index, from,
+				   n_left_from, local, &n_congested);
+      from = local;
+      if (n_congested)
+	vlib_node_increment_counter (vm, esp_encrypt_node.index,
+				     ESP_ENCRYPT_ERROR_HANDOFF_CONGESTED,
+				     n_congested);
+    }
+  n_pkts = n_left_from;
 
   ipsec_alloc_empty_buffers (vm, im);
+  vec_reset_length (ptd->ops);
 
   u32 *empty_buffers = im->empty_buffers[thread_index];
 
@@ -169,6 +166,7 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	  u8 next_hdr_type;
 	  u32 ip_proto = 0;
 	  u8 transport_mode = 0;
+	  esp_crypto_op_t *op;
 
 	  i_bi0 = from[0];
 	  from += 1;
@@ -352,31 +350,36 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	      vnet_buffer (o_b0)->sw_if_index[VLIB_RX] =
 		vnet_buffer (i_b0)->sw_if_index[VLIB_RX];
 
-	      u8 iv[em->
-		    ipsec_proto_main_crypto_algs[sa0->crypto_alg].iv_size];
-	      RAND_bytes (iv, sizeof (iv));
-
-	      clib_memcpy ((u8 *) vlib_buffer_get_current (o_b0) +
-			   ip_udp_hdr_size + sizeof (esp_header_t), iv,
-			   em->ipsec_proto_main_crypto_algs[sa0->
-							    crypto_alg].iv_size);
-
-	      esp_encrypt_cbc (sa0->crypto_alg,
-			       (u8 *) vlib_buffer_get_current (i_b0),
-			       (u8 *) vlib_buffer_get_current (o_b0) +
-			       ip_udp_hdr_size + sizeof (esp_header_t) +
-			       IV_SIZE, BLOCK_SIZE * blocks,
-			       sa0->crypto_key, iv);
+	      /* the IV goes straight into the packet, the cipher runs once
+	         the whole frame is queued */
+	      u8 *iv = (u8 *) vlib_buffer_get_current (o_b0) +
+		ip_udp_hdr_size + sizeof (esp_header_t);
+	      RAND_bytes (iv, IV_SIZE);
+
+	      vec_add2 (ptd->ops, op, 1);
+	      op->alg = sa0->crypto_alg;
+	      op->key = sa0->crypto_key;
+	      op->sa = sa0;
+	      op->iv = iv;
+	      op->src = (u8 *) vlib_buffer_get_current (i_b0);
+	      op->dst = iv + IV_SIZE;
+	      op->len = BLOCK_SIZE * blocks;
 	    }
 
-	  o_b0->current_length += hmac_calc (sa0->integ_alg, sa0->integ_key,
-					     sa0->integ_key_len,
-					     (u8 *) o_esp0,
-					     o_b0->current_length -
-					     ip_udp_hdr_size,
-					     vlib_buffer_get_current (o_b0) +
-					     o_b0->current_length,
-					     sa0->use_esn, sa0->seq_hi);
+	  /* the ICV covers the ciphertext, compute it after the cipher */
+	  if (PREDICT_TRUE (em->ipsec_proto_main_integ_algs[sa0->integ_alg].md
+			    != 0))
+	    {
+	      integ_op = integ_ops + n_integ_ops++;
+	      integ_op->sa = sa0;
+	      integ_op->data = (u8 *) o_esp0;
+	      integ_op->len = o_b0->current_length - ip_udp_hdr_size;
+	      integ_op->digest = (u8 *) vlib_buffer_get_current (o_b0) +
+		o_b0->current_length;
+	      integ_op->seq_hi = sa0->seq_hi;
+	      o_b0->current_length +=
+		em->ipsec_proto_main_integ_algs[sa0->integ_alg].trunc_size;
+	    }
 
 
 	  if (PREDICT_FALSE (is_ipv6))
@@ -424,9 +427,18 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	}
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
+
+  /* buffers are enqueued already but nobody looks at them before we
+     return */
+  esp_crypto_run (ptd->ops, vec_len (ptd->ops), 1 /* is_encrypt */ );
+
+  for (integ_op = integ_ops; integ_op < integ_ops + n_integ_ops; integ_op++)
+    hmac_calc (integ_op->sa->integ_alg, integ_op->sa->integ_key,
+	       integ_op->sa->integ_key_len, integ_op->data, integ_op->len,
+	       integ_op->digest, integ_op->sa->use_esn, integ_op->seq_hi);
+
   vlib_node_increment_counter (vm, esp_encrypt_node.index,
-			       ESP_ENCRYPT_ERROR_RX_PKTS,
-			       from_frame->n_vectors);
+			       ESP_ENCRYPT_ERROR_RX_PKTS, n_pkts);
 
 free_buffers_and_exit:
   if (recycle)
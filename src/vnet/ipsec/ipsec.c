@@ -24,6 +24,7 @@
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ikev2.h>
 #include <vnet/ipsec/esp.h>
+#include <vnet/ipsec/esp_crypto.h>
 #include <vnet/ipsec/ah.h>
 
 
@@ -444,6 +445,7 @@ ipsec_add_del_sa (vlib_main_t * vm, ipsec_sa_t * new_sa, int is_add,
 	  if (err)
 	    return VNET_API_ERROR_SYSCALL_ERROR_1;
 	}
+      ipsec_sa_replay_free (sa);
       pool_put (im->sad, sa);
     }
   else				/* create new SA */
@@ -452,6 +454,12 @@ ipsec_add_del_sa (vlib_main_t * vm, ipsec_sa_t * new_sa, int is_add,
       clib_memcpy (sa, new_sa, sizeof (*sa));
       sa_index = sa - im->sad;
       sa->udp_encap = udp_encap ? 1 : 0;
+      sa->replay_bitmap = 0;
+      esp_crypto_sa_key_update (sa);
+      ipsec_sa_replay_init (sa, new_sa->replay_window_size ?
+			    new_sa->replay_window_size :
+			    im->replay_window_size);
+      ipsec_sa_assign_thread (sa);
       hash_set (im->sa_index_by_sa_id, sa->id, sa_index);
       if (im->cb.add_del_sa_sess_cb)
 	{
@@ -485,6 +493,7 @@ ipsec_set_sa_key (vlib_main_t * vm, ipsec_sa_t * sa_update)
       clib_memcpy (sa->crypto_key, sa_update->crypto_key,
 		   sa_update->crypto_key_len);
       sa->crypto_key_len = sa_update->crypto_key_len;
+      esp_crypto_sa_key_update (sa);
     }
 
   /* new integ key */
@@ -508,6 +517,121 @@ ipsec_set_sa_key (vlib_main_t * vm, ipsec_sa_t * sa_update)
   return 0;
 }
 
+void
+ipsec_sa_replay_init (ipsec_sa_t * sa, u32 window_size)
+{
+  u32 n_words;
+
+  window_size = clib_max (window_size, IPSEC_REPLAY_WINDOW_MIN);
+  window_size = clib_min (window_size, IPSEC_REPLAY_WINDOW_MAX);
+  window_size = max_pow2 (window_size);
+
+  sa->replay_window_size = window_size;
+  sa->last_seq = 0;
+  sa->last_seq_hi = 0;
+
+  if (!sa->use_anti_replay)
+    return;
+
+  /* one word more than the window, rounded up so the index is a mask */
+  n_words = max_pow2 (window_size / 64 + 1);
+  vec_validate_aligned (sa->replay_bitmap, n_words - 1,
+			CLIB_CACHE_LINE_BYTES);
+  memset (sa->replay_bitmap, 0, n_words * sizeof (u64));
+  sa->replay_bitmap_mask = n_words * 64 - 1;
+}
+
+void
+ipsec_sa_replay_free (ipsec_sa_t * sa)
+{
+  vec_free (sa->replay_bitmap);
+}
+
+/* the 64 bits below last_seq, bit 0 being last_seq itself */
+u64
+ipsec_sa_replay_window_u64 (ipsec_sa_t * sa)
+{
+  u64 w = 0;
+  u32 i;
+
+  if (!sa->replay_bitmap)
+    return 0;
+
+  for (i = 0; i < 64 && (i <= sa->last_seq || sa->use_esn); i++)
+    w |= (u64) esp_replay_bit_test (sa, sa->last_seq - i) << i;
+
+  return w;
+}
+
+static void
+ipsec_crypto_threads_init (ipsec_main_t * im)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 i;
+
+  if (vec_len (im->crypto_thread_indices))
+    return;
+
+  /* worker n is thread n + 1 */
+  for (i = 1; i < tm->n_vlib_mains; i++)
+    if (!im->crypto_worker_bitmap ||
+	clib_bitmap_get (im->crypto_worker_bitmap, i - 1))
+      vec_add1 (im->crypto_thread_indices, i);
+
+  if (vec_len (im->crypto_thread_indices) == 0)
+    vec_add1 (im->crypto_thread_indices, 0);
+
+  if (tm->n_vlib_mains > 1)
+    {
+      im->esp_encrypt_fq_index =
+	vlib_frame_queue_main_init (esp_encrypt_node.index, 0);
+      im->esp_decrypt_fq_index =
+	vlib_frame_queue_main_init (esp_decrypt_node.index, 0);
+      im->ah_encrypt_fq_index =
+	vlib_frame_queue_main_init (ah_encrypt_node.index, 0);
+      im->ah_decrypt_fq_index =
+	vlib_frame_queue_main_init (ah_decrypt_node.index, 0);
+    }
+}
+
+/* spread new SAs round robin over the crypto workers */
+void
+ipsec_sa_assign_thread (ipsec_sa_t * sa)
+{
+  ipsec_main_t *im = &ipsec_main;
+
+  ipsec_crypto_threads_init (im);
+
+  sa->thread_index = im->crypto_thread_indices[im->crypto_thread_next++ %
+					       vec_len
+					       (im->crypto_thread_indices)];
+}
+
+int
+ipsec_sa_set_worker (u32 sa_id, u32 worker_index)
+{
+  ipsec_main_t *im = &ipsec_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  ipsec_sa_t *sa;
+  uword *p;
+
+  p = hash_get (im->sa_index_by_sa_id, sa_id);
+  if (!p)
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+  /* the main thread does not take handoffs, it only runs SAs without
+     workers */
+  if (worker_index >= clib_max (tm->n_vlib_mains - 1, 1))
+    return VNET_API_ERROR_INVALID_WORKER;
+
+  ipsec_crypto_threads_init (im);
+
+  sa = pool_elt_at_index (im->sad, p[0]);
+  sa->thread_index = tm->n_vlib_mains > 1 ? worker_index + 1 : 0;
+
+  return 0;
+}
+
 static void
 ipsec_rand_seed (void)
 {
@@ -584,6 +708,11 @@ ipsec_init (vlib_main_t * vm)
   im->ah_decrypt_next_index = IPSEC_INPUT_NEXT_AH_DECRYPT;
 
   im->cb.check_support_cb = ipsec_check_support;
+  im->replay_window_size = IPSEC_REPLAY_WINDOW_DEFAULT;
+  im->esp_encrypt_fq_index = ~0;
+  im->esp_decrypt_fq_index = ~0;
+  im->ah_encrypt_fq_index = ~0;
+  im->ah_decrypt_fq_index = ~0;
 
   if ((error = vlib_call_init_function (vm, ipsec_cli_init)))
     return error;
@@ -601,6 +730,37 @@ ipsec_init (vlib_main_t * vm)
 
 VLIB_INIT_FUNCTION (ipsec_init);
 
+static clib_error_t *
+ipsec_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  ipsec_main_t *im = &ipsec_main;
+  u32 window;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "anti-replay-window %u", &window))
+	{
+	  if (window < IPSEC_REPLAY_WINDOW_MIN ||
+	      window > IPSEC_REPLAY_WINDOW_MAX || !is_pow2 (window))
+	    return clib_error_return (0, "anti-replay window must be a "
+				      "power of 2 between %u and %u",
+				      IPSEC_REPLAY_WINDOW_MIN,
+				      IPSEC_REPLAY_WINDOW_MAX);
+	  im->replay_window_size = window;
+	}
+      else if (unformat (input, "crypto-workers %U", unformat_bitmap_list,
+			 &im->crypto_worker_bitmap))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (ipsec_config, "ipsec");
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -102,6 +102,15 @@ typedef enum
     IPSEC_INTEG_N_ALG,
 } ipsec_integ_alg_t;
 
+#define IPSEC_REPLAY_WINDOW_MIN 64
+#define IPSEC_REPLAY_WINDOW_MAX 4096
+#define IPSEC_REPLAY_WINDOW_DEFAULT 1024
+
+#define IPSEC_HANDOFF_QUEUE_HI_THRESH 30
+
+/* AES-256 has the most round keys, 15 of 16 bytes */
+#define IPSEC_CRYPTO_ROUND_KEYS_SIZE (15 * 16)
+
 typedef enum
 {
   IPSEC_PROTOCOL_AH = 0,
@@ -118,6 +127,11 @@ typedef struct
   u8 crypto_key_len;
   u8 crypto_key[128];
 
+  /* cipher and inverse cipher round keys, expanded by the crypto engines
+     whenever the key is set, see esp_crypto_sa_key_update */
+  u8 crypto_enc_round_keys[IPSEC_CRYPTO_ROUND_KEYS_SIZE];
+  u8 crypto_dec_round_keys[IPSEC_CRYPTO_ROUND_KEYS_SIZE];
+
   ipsec_integ_alg_t integ_alg;
   u8 integ_key_len;
   u8 integ_key[128];
@@ -138,7 +152,16 @@ typedef struct
   u32 seq_hi;
   u32 last_seq;
   u32 last_seq_hi;
-  u64 replay_window;
+
+  /* anti-replay bitmap (RFC 6479), twice the window so it can slide a
+     whole word at a time, indexed by the low bits of the sequence number */
+  u64 *replay_bitmap;
+  u32 replay_bitmap_mask;
+  u32 replay_window_size;
+
+  /* the thread all packets of the SA are handed to, which keeps the
+     sequence number and the replay window single writer */
+  u32 thread_index;
 
   /*lifetime data */
   u64 total_data_size;
@@ -297,6 +320,20 @@ typedef struct
   u32 ah_encrypt_next_index;
   u32 ah_decrypt_next_index;
 
+  /* anti-replay window of new SAs, in packets */
+  u32 replay_window_size;
+
+  /* workers SAs are spread over, all of them if not configured */
+  uword *crypto_worker_bitmap;
+  u32 *crypto_thread_indices;
+  u32 crypto_thread_next;
+
+  /* frame queues handing packets to the thread owning the SA */
+  u32 esp_encrypt_fq_index;
+  u32 esp_decrypt_fq_index;
+  u32 ah_encrypt_fq_index;
+  u32 ah_decrypt_fq_index;
+
   /* callbacks */
   ipsec_main_callbacks_t cb;
 
@@ -324,6 +361,11 @@ int ipsec_add_del_policy (vlib_main_t * vm, ipsec_policy_t * policy,
 int ipsec_add_del_sa (vlib_main_t * vm, ipsec_sa_t * new_sa, int is_add,
 		      u8 udp_encap);
 int ipsec_set_sa_key (vlib_main_t * vm, ipsec_sa_t * sa_update);
+void ipsec_sa_replay_init (ipsec_sa_t * sa, u32 window_size);
+void ipsec_sa_replay_free (ipsec_sa_t * sa);
+u64 ipsec_sa_replay_window_u64 (ipsec_sa_t * sa);
+void ipsec_sa_assign_thread (ipsec_sa_t * sa);
+int ipsec_sa_set_worker (u32 sa_id, u32 worker_index);
 
 u32 ipsec_get_sa_index_by_sa_id (u32 sa_id);
 u8 ipsec_is_sa_used (u32 sa_index);
@@ -373,6 +415,82 @@ ipsec_alloc_empty_buffers (vlib_main_t * vm, ipsec_main_t * im)
     }
 }
 
+/**
+ * @brief Hand packets of SAs owned by other threads to their owner
+ *
+ * Buffers of SAs owned by this thread are copied to local, the others
+ * are enqueued to the owner's frame queue in batches, or freed when that
+ * queue is congested.
+ *
+ * @return number of buffers in local
+ */
+always_inline u32
+ipsec_handoff (vlib_main_t * vm, u32 fq_index, u32 * from, u32 n_left,
+	       u32 * local, u32 * n_congested)
+{
+  static __thread vlib_frame_queue_elt_t **elt_by_thread;
+  static __thread vlib_frame_queue_t **congested_by_thread;
+  ipsec_main_t *im = &ipsec_main;
+  u32 thread_index = vm->thread_index;
+  u32 drop[VLIB_FRAME_SIZE];
+  u32 i, n_local = 0, n_drop = 0;
+  vlib_frame_queue_elt_t *hf;
+  vlib_buffer_t *b;
+  ipsec_sa_t *sa;
+
+  if (PREDICT_FALSE (elt_by_thread == 0))
+    {
+      vec_validate (elt_by_thread, vlib_get_thread_main ()->n_vlib_mains - 1);
+      vec_validate_init_empty (congested_by_thread,
+			       vec_len (elt_by_thread) - 1,
+			       (vlib_frame_queue_t *) (~0));
+    }
+
+  while (n_left > 0)
+    {
+      b = vlib_get_buffer (vm, from[0]);
+      sa = pool_elt_at_index (im->sad, vnet_buffer (b)->ipsec.sad_index);
+
+      if (PREDICT_TRUE (sa->thread_index == thread_index))
+	local[n_local++] = from[0];
+      else if (is_vlib_frame_queue_congested (fq_index, sa->thread_index,
+					      IPSEC_HANDOFF_QUEUE_HI_THRESH,
+					      congested_by_thread))
+	drop[n_drop++] = from[0];
+      else
+	{
+	  hf = vlib_get_worker_handoff_queue_elt (fq_index, sa->thread_index,
+						  elt_by_thread);
+	  hf->buffer_index[hf->n_vectors++] = from[0];
+	  if (hf->n_vectors == VLIB_FRAME_SIZE)
+	    {
+	      vlib_put_frame_queue_elt (hf);
+	      elt_by_thread[sa->thread_index] = 0;
+	    }
+	}
+
+      from += 1;
+      n_left -= 1;
+    }
+
+  /* ship the partial batches */
+  for (i = 0; i < vec_len (elt_by_thread); i++)
+    {
+      if (elt_by_thread[i])
+	{
+	  vlib_put_frame_queue_elt (elt_by_thread[i]);
+	  elt_by_thread[i] = 0;
+	}
+      congested_by_thread[i] = (vlib_frame_queue_t *) (~0);
+    }
+
+  if (n_drop)
+    vlib_buffer_free (vm, drop, n_drop);
+
+  *n_congested = n_drop;
+  return n_local;
+}
+
 static_always_inline u32
 get_next_output_feature_node_index (vlib_buffer_t * b,
 				    vlib_node_runtime_t * nr)
@@ -455,7 +455,8 @@ send_ipsec_sa_details (ipsec_sa_t * sa, vl_api_registration_t * reg,
       mp->last_seq_inbound |= (u64) (clib_host_to_net_u32 (sa->last_seq_hi));
     }
   if (sa->use_anti_replay)
-    mp->replay_window = clib_host_to_net_u64 (sa->replay_window);
+    mp->replay_window =
+      clib_host_to_net_u64 (ipsec_sa_replay_window_u64 (sa));
   mp->total_data_size = clib_host_to_net_u64 (sa->total_data_size);
   mp->udp_encap = sa->udp_encap;
 
@@ -130,6 +130,23 @@ ipsec_sa_add_del_command_fn (vlib_main_t * vm,
 	      goto done;
 	    }
 	}
+      else if (unformat (line_input, "anti-replay-window %u",
+			 &sa.replay_window_size))
+	{
+	  if (sa.replay_window_size < IPSEC_REPLAY_WINDOW_MIN ||
+	      sa.replay_window_size > IPSEC_REPLAY_WINDOW_MAX ||
+	      !is_pow2 (sa.replay_window_size))
+	    {
+	      error = clib_error_return (0, "anti-replay window must be a "
+					 "power of 2 between %u and %u",
+					 IPSEC_REPLAY_WINDOW_MIN,
+					 IPSEC_REPLAY_WINDOW_MAX);
+	      goto done;
+	    }
+	  sa.use_anti_replay = 1;
+	}
+      else if (unformat (line_input, "anti-replay"))
+	sa.use_anti_replay = 1;
       else if (unformat (line_input, "tunnel-src %U",
 			 unformat_ip4_address, &sa.tunnel_src_addr.ip4))
 	sa.is_tunnel = 1;
@@ -188,7 +205,7 @@ done:
 VLIB_CLI_COMMAND (ipsec_sa_add_del_command, static) = {
     .path = "ipsec sa",
     .short_help =
-    "ipsec sa [add|del]",
+    "ipsec sa [add|del] [anti-replay] [anti-replay-window <n>]",
     .function = ipsec_sa_add_del_command_fn,
 };
 /* *INDENT-ON* */
@@ -382,7 +399,9 @@ set_ipsec_sa_key_command_fn (vlib_main_t * vm,
   unformat_input_t _line_input, *line_input = &_line_input;
   ipsec_sa_t sa;
   u8 *ck = 0, *ik = 0;
+  u32 worker = ~0;
   clib_error_t *error = NULL;
+  int rv;
 
   memset (&sa, 0, sizeof (sa));
 
@@ -393,6 +412,8 @@ set_ipsec_sa_key_command_fn (vlib_main_t * vm,
     {
       if (unformat (line_input, "%u", &sa.id))
 	;
+      else if (unformat (line_input, "worker %u", &worker))
+	;
       else
 	if (unformat (line_input, "crypto-key %U", unformat_hex_string, &ck))
 	sa.crypto_key_len = vec_len (ck);
@@ -421,6 +442,15 @@ set_ipsec_sa_key_command_fn (vlib_main_t * vm,
 
   ipsec_set_sa_key (vm, &sa);
 
+  if (worker != ~0)
+    {
+      rv = ipsec_sa_set_worker (sa.id, worker);
+      if (rv == VNET_API_ERROR_NO_SUCH_ENTRY)
+	error = clib_error_return (0, "no such sa %u", sa.id);
+      else if (rv)
+	error = clib_error_return (0, "invalid worker %u", worker);
+    }
+
 done:
   unformat_free (line_input);
 
@@ -431,7 +461,7 @@ done:
 VLIB_CLI_COMMAND (set_ipsec_sa_key_command, static) = {
     .path = "set ipsec sa",
     .short_help =
-    "set ipsec sa <id> crypto-key <key> integ-key <key>",
+    "set ipsec sa <id> [crypto-key <key>] [integ-key <key>] [worker <n>]",
     .function = set_ipsec_sa_key_command_fn,
 };
 /* *INDENT-ON* */
@@ -475,6 +505,11 @@ show_ipsec_command_fn (vlib_main_t * vm,
                         format_ip4_address, &sa->tunnel_src_addr.ip4,
                         format_ip4_address, &sa->tunnel_dst_addr.ip4);
       }
+      if (sa->use_anti_replay)
+        vlib_cli_output(vm, "  anti-replay window %u last-seq %u last-seq-hi %u",
+                        sa->replay_window_size, sa->last_seq,
+                        sa->last_seq_hi);
+      vlib_cli_output(vm, "  thread %u", sa->thread_index);
     }
   }));
   /* *INDENT-ON* */
@@ -673,7 +708,8 @@ show_ipsec_command_fn (vlib_main_t * vm,
     vlib_cli_output(vm, "   last-seq %u last-seq-hi %u esn %u anti-replay %u window %U",
                     sa->last_seq, sa->last_seq_hi, sa->use_esn,
                     sa->use_anti_replay,
-                    format_ipsec_replay_window, sa->replay_window);
+                    format_ipsec_replay_window,
+                    ipsec_sa_replay_window_u64 (sa));
     vlib_cli_output(vm, "   remote-spi %u remote-ip %U", sa->spi,
                     format_ip4_address, &sa->tunnel_src_addr.ip4);
     vlib_cli_output(vm, "   remote-crypto %U %U",
@@ -21,6 +21,7 @@
 
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/esp.h>
+#include <vnet/ipsec/esp_crypto.h>
 
 void vl_api_rpc_call_main_thread (void *fp, u8 * data, u32 data_length);
 
@@ -331,6 +332,9 @@ ipsec_add_del_tunnel_if_internal (vnet_main_t * vnm,
 	  clib_memcpy (sa->crypto_key, args->remote_crypto_key,
 		       args->remote_crypto_key_len);
 	}
+      esp_crypto_sa_key_update (sa);
+      ipsec_sa_replay_init (sa, im->replay_window_size);
+      ipsec_sa_assign_thread (sa);
 
       pool_get (im->sad, sa);
       memset (sa, 0, sizeof (*sa));
@@ -355,6 +359,9 @@ ipsec_add_del_tunnel_if_internal (vnet_main_t * vnm,
 	  clib_memcpy (sa->crypto_key, args->local_crypto_key,
 		       args->local_crypto_key_len);
 	}
+      esp_crypto_sa_key_update (sa);
+      ipsec_sa_replay_init (sa, im->replay_window_size);
+      ipsec_sa_assign_thread (sa);
 
       hash_set (im->ipsec_if_pool_index_by_key, key,
 		t - im->tunnel_interfaces);
@@ -401,9 +408,11 @@ ipsec_add_del_tunnel_if_internal (vnet_main_t * vnm,
       /* delete input and output SA */
 
       sa = pool_elt_at_index (im->sad, t->input_sa_index);
+      ipsec_sa_replay_free (sa);
       pool_put (im->sad, sa);
 
       sa = pool_elt_at_index (im->sad, t->output_sa_index);
+      ipsec_sa_replay_free (sa);
       pool_put (im->sad, sa);
 
       hash_unset (im->ipsec_if_pool_index_by_key, key);
@@ -501,6 +510,7 @@ ipsec_set_interface_key (vnet_main_t * vnm, u32 hw_if_index,
       sa->crypto_alg = alg;
       sa->crypto_key_len = vec_len (key);
       clib_memcpy (sa->crypto_key, key, vec_len (key));
+      esp_crypto_sa_key_update (sa);
     }
   else if (type == IPSEC_IF_SET_KEY_TYPE_LOCAL_INTEG)
     {
@@ -515,6 +525,7 @@ ipsec_set_interface_key (vnet_main_t * vnm, u32 hw_if_index,
       sa->crypto_alg = alg;
       sa->crypto_key_len = vec_len (key);
       clib_memcpy (sa->crypto_key, key, vec_len (key));
+      esp_crypto_sa_key_update (sa);
     }
   else if (type == IPSEC_IF_SET_KEY_TYPE_REMOTE_INTEG)
     {
@@ -603,6 +614,7 @@ ipsec_set_interface_sa (vnet_main_t * vnm, u32 hw_if_index, u32 sa_id,
 	return VNET_API_ERROR_SYSCALL_ERROR_1;
     }
 
+  ipsec_sa_replay_free (old_sa);
   pool_put (im->sad, old_sa);
 
   return 0;
@@ -291,9 +291,12 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		  p0->counter.bytes +=
 		    clib_net_to_host_u16 (ip6_0->payload_length);
 		  p0->counter.bytes += sizeof (ip6_header_t);
+		  /* as in interface-output, the l4 checksum field may hold
+		     a partial sum, e.g. from a virtio guest */
 		  if (PREDICT_FALSE
 		      (b0->flags & VNET_BUFFER_F_OFFLOAD_TCP_CKSUM))
 		    {
+		      tcp0->checksum = 0;
 		      tcp0->checksum =
 			ip6_tcp_udp_icmp_compute_checksum (vm, b0, ip6_0,
 							   &bogus);
@@ -302,9 +305,12 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		  if (PREDICT_FALSE
 		      (b0->flags & VNET_BUFFER_F_OFFLOAD_UDP_CKSUM))
 		    {
+		      udp0->checksum = 0;
 		      udp0->checksum =
 			ip6_tcp_udp_icmp_compute_checksum (vm, b0, ip6_0,
 							   &bogus);
+		      if (udp0->checksum == 0)
+			udp0->checksum = 0xffff;
 		      b0->flags &= ~VNET_BUFFER_F_OFFLOAD_UDP_CKSUM;
 		    }
 		}
@@ -319,6 +325,7 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		  if (PREDICT_FALSE
 		      (b0->flags & VNET_BUFFER_F_OFFLOAD_TCP_CKSUM))
 		    {
+		      tcp0->checksum = 0;
 		      tcp0->checksum =
 			ip4_tcp_udp_compute_checksum (vm, b0, ip0);
 		      b0->flags &= ~VNET_BUFFER_F_OFFLOAD_TCP_CKSUM;
@@ -326,8 +333,11 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		  if (PREDICT_FALSE
 		      (b0->flags & VNET_BUFFER_F_OFFLOAD_UDP_CKSUM))
 		    {
+		      udp0->checksum = 0;
 		      udp0->checksum =
 			ip4_tcp_udp_compute_checksum (vm, b0, ip0);
+		      if (udp0->checksum == 0)
+			udp0->checksum = 0xffff;
 		      b0->flags &= ~VNET_BUFFER_F_OFFLOAD_UDP_CKSUM;
 		    }
 		}
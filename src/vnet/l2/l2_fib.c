@@ -272,6 +272,11 @@ show_l2fib (vlib_main_t * vm,
 			 "Max macs in event: %d",
 			 lm->client_pid, msm->evt_scan_duration,
 			 msm->event_scan_delay, msm->max_macs_in_event);
+      if (vlib_num_workers ())
+	vlib_cli_output (vm, "Worker learn events applied: %llu  "
+			 "Not learned due to limit: %llu  Batches: %llu",
+			 lm->n_events_applied, lm->n_events_limited,
+			 lm->n_drains);
     }
 
   if (raw)
@@ -45,6 +45,12 @@ l2learn_main_t l2learn_main;
  * differ in certain cases (mac move tests), but this not expected to cause
  * problems in real-world networks. It is much simpler to separate learning
  * and forwarding into separate nodes.
+ *
+ * Worker threads do not write the mac table. They queue learn events on a
+ * per-thread ring which the l2-learn-queue-process node on the main thread
+ * drains and applies in batches, so the mac table only has a single writer.
+ * A small per-worker cache of recently queued keys keeps a new mac from being
+ * queued once per packet until the learner catches up.
  */
 
 
@@ -81,7 +87,8 @@ _(MAC_MOVE,          "L2 mac moves")			\
 _(MAC_MOVE_VIOLATE,  "L2 mac move violations")		\
 _(LIMIT,             "L2 not learned due to limit")	\
 _(HIT_UPDATE,        "L2 learn hit updates")		\
-_(FILTER_DROP,       "L2 filter mac drops")
+_(FILTER_DROP,       "L2 filter mac drops")		\
+_(QUEUE_FULL,        "L2 not learned due to full queue")
 
 typedef enum
 {
@@ -104,12 +111,56 @@ typedef enum
   L2LEARN_N_NEXT,
 } l2learn_next_t;
 
+static vlib_node_registration_t l2learn_queue_process_node;
+
+static_always_inline l2learn_cache_entry_t *
+l2learn_cache_entry (l2learn_per_thread_t * ptd, u64 key)
+{
+  u64 h = key * 0x9e3779b97f4a7c15ULL;
+  return ptd->cache + (h >> 56);
+}
+
+/**
+ * Queue a learn event for the learner process.
+ * Returns 0 if the event could not be queued because the queue is full.
+ */
+static_always_inline int
+l2learn_enqueue (l2learn_main_t * msm, l2learn_per_thread_t * ptd,
+		 u64 key, u32 sw_if_index, u16 sn, u8 timestamp)
+{
+  l2learn_cache_entry_t *ce;
+  l2learn_event_t *e;
+  u32 head = ptd->head;
+
+  ce = l2learn_cache_entry (ptd, key);
+  if (ce->key == key && ce->sw_if_index == sw_if_index)
+    return 1;			/* already queued */
+
+  if (head - ptd->tail >= msm->queue_size)
+    return 0;
+
+  e = ptd->events + (head & (msm->queue_size - 1));
+  e->key = key;
+  e->sw_if_index = sw_if_index;
+  e->sn = sn;
+  e->timestamp = timestamp;
+
+  ce->key = key;
+  ce->sw_if_index = sw_if_index;
+  ptd->cache_dirty = 1;
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  ptd->head = head + 1;
+  return 1;
+}
+
 
 /** Perform learning on one packet based on the mac table lookup result. */
 
 static_always_inline void
 l2learn_process (vlib_node_runtime_t * node,
 		 l2learn_main_t * msm,
+		 l2learn_per_thread_t * ptd,
 		 u64 * counter_base,
 		 vlib_buffer_t * b0,
 		 u32 sw_if_index0,
@@ -168,7 +219,8 @@ l2learn_process (vlib_node_runtime_t * node,
 	return;
 
       /* It is ok to learn */
-      msm->global_learn_count++;
+      if (ptd == 0)
+	msm->global_learn_count++;
       result0->raw = 0;		/* clear all fields */
       result0->fields.sw_if_index = sw_if_index0;
       result0->fields.lrn_evt = (msm->client_pid != 0);
@@ -201,7 +253,7 @@ l2learn_process (vlib_node_runtime_t * node,
        * TODO: check global/bridge domain/interface learn limits
        */
       result0->fields.sw_if_index = sw_if_index0;
-      if (result0->fields.age_not)	/* The mac was provisioned */
+      if (result0->fields.age_not && ptd == 0)	/* The mac was provisioned */
 	{
 	  msm->global_learn_count++;
 	  result0->fields.age_not = 0;
@@ -211,6 +263,15 @@ l2learn_process (vlib_node_runtime_t * node,
       counter_base[L2LEARN_ERROR_MAC_MOVE] += 1;
     }
 
+  if (ptd)
+    {
+      /* Leave the mac table update to the learner */
+      if (!l2learn_enqueue (msm, ptd, key0->raw, sw_if_index0,
+			    vnet_buffer (b0)->l2.l2fib_sn, timestamp))
+	counter_base[L2LEARN_ERROR_QUEUE_FULL] += 1;
+      return;
+    }
+
   /* Update the entry */
   result0->fields.timestamp = timestamp;
   result0->fields.sn.as_u16 = vnet_buffer (b0)->l2.l2fib_sn;
@@ -239,6 +300,20 @@ l2learn_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   l2fib_entry_result_t cached_result;
   u8 timestamp = (u8) (vlib_time_now (vm) / 60);
   u32 count = 0;
+  l2learn_per_thread_t *ptd = 0;
+
+  if (vm->thread_index)
+    {
+      ptd = vec_elt_at_index (msm->per_thread_data, vm->thread_index);
+
+      /* Once the learner has caught up the cached keys are in the table */
+      if (ptd->cache_dirty && ptd->tail == ptd->head)
+	{
+	  memset (ptd->cache, 0xff,
+		  L2LEARN_CACHE_SIZE * sizeof (ptd->cache[0]));
+	  ptd->cache_dirty = 0;
+	}
+    }
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;	/* number of packets to process */
@@ -372,19 +447,23 @@ l2learn_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			  &bucket0, &bucket1, &bucket2, &bucket3,
 			  &result0, &result1, &result2, &result3);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b0, sw_if_index0, &key0, &cached_key,
 			   &count, &result0, &next0, timestamp);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b1, sw_if_index1, &key1, &cached_key,
 			   &count, &result1, &next1, timestamp);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b2, sw_if_index2, &key2, &cached_key,
 			   &count, &result2, &next2, timestamp);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b3, sw_if_index3, &key3, &cached_key,
 			   &count, &result3, &next3, timestamp);
 
@@ -439,7 +518,8 @@ l2learn_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			  h0->src_address, vnet_buffer (b0)->l2.bd_index,
 			  &key0, &bucket0, &result0);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b0, sw_if_index0, &key0, &cached_key,
 			   &count, &result0, &next0, timestamp);
 
@@ -452,6 +532,13 @@ l2learn_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
 
+  if (ptd && ptd->head != ptd->tail && !ptd->signalled)
+    {
+      ptd->signalled = 1;
+      vlib_process_signal_event_mt (vm, l2learn_queue_process_node.index,
+				    0, 0);
+    }
+
   return frame->n_vectors;
 }
 
@@ -486,7 +573,115 @@ VLIB_REGISTER_NODE (l2learn_node,static) = {
 /* *INDENT-ON* */
 
 VLIB_NODE_FUNCTION_MULTIARCH (l2learn_node, l2learn_node_fn)
-     clib_error_t *l2learn_init (vlib_main_t * vm)
+
+/** Apply one worker learn event to the mac table. */
+static void
+l2learn_apply_event (l2learn_main_t * msm, l2learn_event_t * e)
+{
+  BVT (clib_bihash_kv) kv;
+  l2fib_entry_result_t result;
+
+  kv.key = e->key;
+  if (BV (clib_bihash_search) (msm->mac_table, &kv, &kv))
+    {
+      /* Still a miss, another worker may have hit the limit meanwhile */
+      if (msm->global_learn_count >= msm->global_learn_limit)
+	{
+	  msm->n_events_limited++;
+	  return;
+	}
+      msm->global_learn_count++;
+      result.raw = 0;
+      result.fields.sw_if_index = e->sw_if_index;
+      result.fields.lrn_evt = (msm->client_pid != 0);
+    }
+  else
+    {
+      result.raw = kv.value;
+
+      /* Provisioned since the event was queued, leave it alone */
+      if (result.fields.filter || result.fields.static_mac)
+	return;
+
+      if (result.fields.sw_if_index != e->sw_if_index)
+	{
+	  result.fields.sw_if_index = e->sw_if_index;
+	  if (result.fields.age_not)
+	    {
+	      msm->global_learn_count++;
+	      result.fields.age_not = 0;
+	    }
+	  result.fields.lrn_evt = (msm->client_pid != 0);
+	  result.fields.lrn_mov = (msm->client_pid != 0);
+	}
+      else if (result.fields.age_not)
+	return;
+    }
+
+  result.fields.timestamp = e->timestamp;
+  result.fields.sn.as_u16 = e->sn;
+
+  kv.key = e->key;
+  kv.value = result.raw;
+  BV (clib_bihash_add_del) (msm->mac_table, &kv, 1 /* is_add */ );
+  msm->n_events_applied++;
+}
+
+static void
+l2learn_drain_queues (l2learn_main_t * msm)
+{
+  l2learn_per_thread_t *ptd;
+  u32 mask = msm->queue_size - 1;
+  u32 head, tail;
+
+  vec_foreach (ptd, msm->per_thread_data)
+  {
+    /* Clear first, events queued from here on signal us again */
+    ptd->signalled = 0;
+    CLIB_MEMORY_BARRIER ();
+
+    head = ptd->head;
+    tail = ptd->tail;
+    if (head == tail)
+      continue;
+
+    while (tail != head)
+      {
+	l2learn_apply_event (msm, ptd->events + (tail & mask));
+	tail++;
+      }
+
+    CLIB_MEMORY_BARRIER ();
+    ptd->tail = tail;
+  }
+  msm->n_drains++;
+}
+
+static uword
+l2learn_queue_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+		       vlib_frame_t * f)
+{
+  l2learn_main_t *msm = &l2learn_main;
+
+  while (1)
+    {
+      vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, 0);
+      l2learn_drain_queues (msm);
+    }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (l2learn_queue_process_node, static) = {
+    .function = l2learn_queue_process,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "l2-learn-queue-process",
+};
+/* *INDENT-ON* */
+
+clib_error_t *
+l2learn_init (vlib_main_t * vm)
 {
   l2learn_main_t *mp = &l2learn_main;
 
@@ -508,6 +703,7 @@ VLIB_NODE_FUNCTION_MULTIARCH (l2learn_node, l2learn_node_fn)
    * of buckets.
    */
   mp->global_learn_limit = L2LEARN_DEFAULT_LIMIT;
+  mp->queue_size = L2LEARN_DEFAULT_QUEUE_SIZE;
 
   return 0;
 }
@@ -573,17 +769,40 @@ static clib_error_t *
 l2learn_config (vlib_main_t * vm, unformat_input_t * input)
 {
   l2learn_main_t *mp = &l2learn_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  l2learn_per_thread_t *ptd;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
       if (unformat (input, "limit %d", &mp->global_learn_limit))
 	;
 
+      else if (unformat (input, "queue-size %d", &mp->queue_size))
+	;
+
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
     }
 
+  if (mp->queue_size == 0 || !is_pow2 (mp->queue_size))
+    return clib_error_return (0, "queue-size %u is not a power of 2",
+			      mp->queue_size);
+
+  /* Thread 0 updates the mac table directly, the rest queue events */
+  vec_validate_aligned (mp->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (ptd, mp->per_thread_data)
+  {
+    if (ptd == mp->per_thread_data)
+      continue;
+    vec_validate_aligned (ptd->events, mp->queue_size - 1,
+			  CLIB_CACHE_LINE_BYTES);
+    vec_validate_aligned (ptd->cache, L2LEARN_CACHE_SIZE - 1,
+			  CLIB_CACHE_LINE_BYTES);
+    memset (ptd->cache, 0xff, L2LEARN_CACHE_SIZE * sizeof (ptd->cache[0]));
+  }
+
   return 0;
 }
 
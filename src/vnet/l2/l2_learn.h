@@ -22,6 +22,47 @@
 #include <vnet/ethernet/ethernet.h>
 
 
+/*
+ * A mac learned (or refreshed) by a worker thread. Workers do not write
+ * the mac table themselves, they queue these events for the learner
+ * process on the main thread which applies them in batches.
+ */
+typedef struct
+{
+  u64 key;			/* l2fib_entry_key_t */
+  u32 sw_if_index;
+  u16 sn;
+  u8 timestamp;
+  u8 pad;
+} l2learn_event_t;
+
+/* Keys recently queued by a worker, to avoid queuing a mac per packet */
+typedef struct
+{
+  u64 key;
+  u32 sw_if_index;
+  u32 pad;
+} l2learn_cache_entry_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* written by the worker */
+  volatile u32 head;
+  u32 cache_dirty;
+  l2learn_event_t *events;
+  l2learn_cache_entry_t *cache;
+
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+
+  /* written by the learner */
+  volatile u32 tail;
+
+  /* set by the worker when it has signalled the learner */
+  volatile u32 signalled;
+} l2learn_per_thread_t;
+
 typedef struct
 {
 
@@ -41,12 +82,25 @@ typedef struct
   /* Next nodes for each feature */
   u32 feat_next_node_index[32];
 
+  /* per-thread learn event queues, thread 0 learns directly */
+  l2learn_per_thread_t *per_thread_data;
+
+  /* learn event queue size, power of 2 */
+  u32 queue_size;
+
+  /* learner statistics */
+  u64 n_events_applied;
+  u64 n_events_limited;
+  u64 n_drains;
+
   /* convenience variables */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
 } l2learn_main_t;
 
 #define L2LEARN_DEFAULT_LIMIT (L2FIB_NUM_BUCKETS * 64)
+#define L2LEARN_DEFAULT_QUEUE_SIZE 4096
+#define L2LEARN_CACHE_SIZE 256
 
 extern l2learn_main_t l2learn_main;
 
@@ -358,6 +358,7 @@ echo_clients_init (vlib_main_t * vm)
   vec_validate (ecm->connection_index_by_thread, vtm->n_vlib_mains);
   vec_validate (ecm->connections_this_batch_by_thread, vtm->n_vlib_mains);
   vec_validate (ecm->vpp_event_queue, vtm->n_vlib_mains);
+  vec_validate (ecm->connects_by_thread, vtm->n_vlib_mains);
 
   return 0;
 }
@@ -413,6 +414,7 @@ echo_clients_session_connected_callback (u32 app_index, u32 api_context,
     }
 
   vec_add1 (ecm->connection_index_by_thread[thread_index], session_index);
+  __sync_fetch_and_add (&ecm->connects_by_thread[thread_index], 1);
   __sync_fetch_and_add (&ecm->ready_connections, 1);
   if (ecm->ready_connections == ecm->expected_connections)
     {
@@ -612,20 +614,124 @@ echo_clients_connect (vlib_main_t * vm, u32 n_clients)
   if (!ecm->no_output)  				\
     vlib_cli_output(vm, _fmt, ##_args)
 
+/**
+ * Connect n_clients, run the transfer test over them and wait for all of
+ * them to be disconnected. The time it took to establish all sessions is
+ * returned in connect_time.
+ */
+static clib_error_t *
+echo_clients_run_round (vlib_main_t * vm, u32 n_clients, f64 syn_timeout,
+			f64 test_timeout, f64 * connect_time)
+{
+  echo_client_main_t *ecm = &echo_client_main;
+  uword *event_data = 0, event_type;
+  f64 time_before_connects, delta;
+  char *transfer_type;
+  clib_error_t *error;
+  u64 total_bytes;
+
+  *connect_time = 0;
+  ecm->run_test = 0;
+  ecm->ready_connections = 0;
+  ecm->rx_total = 0;
+  ecm->tx_total = 0;
+
+  /* Fire off connect requests */
+  time_before_connects = vlib_time_now (vm);
+  if ((error = echo_clients_connect (vm, n_clients)))
+    return error;
+
+  /* Park until the sessions come up, or ten seconds elapse... */
+  vlib_process_wait_for_event_or_clock (vm, syn_timeout);
+  event_type = vlib_process_get_events (vm, &event_data);
+  switch (event_type)
+    {
+    case ~0:
+      ec_cli_output ("Timeout with only %d sessions active...",
+		     ecm->ready_connections);
+      error = clib_error_return (0, "failed: syn timeout with %d sessions",
+				 ecm->ready_connections);
+      goto done;
+
+    case 1:
+      delta = *connect_time = vlib_time_now (vm) - time_before_connects;
+      if (delta != 0.0)
+	ec_cli_output ("%d three-way handshakes in %.2f seconds %.2f/s",
+		       n_clients, delta, ((f64) n_clients) / delta);
+
+      ecm->test_start_time = vlib_time_now (ecm->vlib_main);
+      ec_cli_output ("Test started at %.6f", ecm->test_start_time);
+      break;
+
+    default:
+      ec_cli_output ("unexpected event(1): %d", event_type);
+      error = clib_error_return (0, "failed: unexpected event(1): %d",
+				 event_type);
+      goto done;
+    }
+
+  /* Now wait for the sessions to finish... */
+  vlib_process_wait_for_event_or_clock (vm, test_timeout);
+  event_type = vlib_process_get_events (vm, &event_data);
+  switch (event_type)
+    {
+    case ~0:
+      ec_cli_output ("Timeout with %d sessions still active...",
+		     ecm->ready_connections);
+      error = clib_error_return (0, "failed: timeout with %d sessions",
+				 ecm->ready_connections);
+      goto done;
+
+    case 2:
+      ecm->test_end_time = vlib_time_now (vm);
+      ec_cli_output ("Test finished at %.6f", ecm->test_end_time);
+      break;
+
+    default:
+      ec_cli_output ("unexpected event(2): %d", event_type);
+      error = clib_error_return (0, "failed: unexpected event(2): %d",
+				 event_type);
+      goto done;
+    }
+
+  /* Connection rate tests need not move any data */
+  delta = ecm->test_end_time - ecm->test_start_time;
+  if (!ecm->cps_rounds)
+    {
+      if (delta == 0.0)
+	{
+	  ec_cli_output ("zero delta-t?");
+	  error = clib_error_return (0, "failed: zero delta-t");
+	  goto done;
+	}
+      total_bytes = (ecm->no_return ? ecm->tx_total : ecm->rx_total);
+      transfer_type = ecm->no_return ? "half-duplex" : "full-duplex";
+      ec_cli_output ("%lld bytes (%lld mbytes, %lld gbytes) in %.2f seconds",
+		     total_bytes, total_bytes / (1ULL << 20),
+		     total_bytes / (1ULL << 30), delta);
+      ec_cli_output ("%.2f bytes/second %s", ((f64) total_bytes) / (delta),
+		     transfer_type);
+      ec_cli_output ("%.4f gbit/second %s",
+		     (((f64) total_bytes * 8.0) / delta / 1e9),
+		     transfer_type);
+    }
+
+done:
+  vec_free (event_data);
+  return error;
+}
+
 static clib_error_t *
 echo_clients_command_fn (vlib_main_t * vm,
 			 unformat_input_t * input, vlib_cli_command_t * cmd)
 {
   echo_client_main_t *ecm = &echo_client_main;
   vlib_thread_main_t *thread_main = vlib_get_thread_main ();
-  u64 tmp, total_bytes, appns_flags = 0, appns_secret = 0;
-  f64 test_timeout = 20.0, syn_timeout = 20.0, delta;
+  u64 tmp, appns_flags = 0, appns_secret = 0;
+  f64 test_timeout = 20.0, syn_timeout = 20.0, delta, connect_time;
   char *default_uri = "tcp://6.0.1.1/1234";
-  uword *event_data = 0, event_type;
-  f64 time_before_connects;
-  u32 n_clients = 1;
+  u32 n_clients = 1, n_rounds, round;
   int preallocate_sessions = 0;
-  char *transfer_type;
   clib_error_t *error = 0;
   u8 *appns_id = 0;
   int i;
@@ -642,6 +748,7 @@ echo_clients_command_fn (vlib_main_t * vm,
   ecm->vlib_main = vm;
   ecm->tls_engine = TLS_ENGINE_OPENSSL;
   ecm->no_copy = 0;
+  ecm->cps_rounds = 0;
 
   if (thread_main->n_vlib_mains > 1)
     clib_spinlock_init (&ecm->sessions_lock);
@@ -702,6 +809,8 @@ echo_clients_command_fn (vlib_main_t * vm,
 	ecm->test_bytes = 1;
       else if (unformat (input, "tls-engine %d", &ecm->tls_engine))
 	;
+      else if (unformat (input, "cps-rounds %d", &ecm->cps_rounds))
+	;
       else
 	return clib_error_return (0, "failed: unknown input `%U'",
 				  format_unformat_error, input);
@@ -718,10 +827,8 @@ echo_clients_command_fn (vlib_main_t * vm,
     }
 
 
-  ecm->ready_connections = 0;
   ecm->expected_connections = n_clients;
-  ecm->rx_total = 0;
-  ecm->tx_total = 0;
+  n_rounds = clib_max (ecm->cps_rounds, 1);
 
   if (!ecm->connect_uri)
     {
@@ -758,85 +865,27 @@ echo_clients_command_fn (vlib_main_t * vm,
 			 VLIB_NODE_STATE_POLLING);
 
   if (preallocate_sessions)
-    pool_init_fixed (ecm->sessions, 1.1 * n_clients);
-
-  /* Fire off connect requests */
-  time_before_connects = vlib_time_now (vm);
-  if ((error = echo_clients_connect (vm, n_clients)))
-    return error;
+    pool_init_fixed (ecm->sessions, 1.1 * n_clients * n_rounds);
 
-  /* Park until the sessions come up, or ten seconds elapse... */
-  vlib_process_wait_for_event_or_clock (vm, syn_timeout);
-  event_type = vlib_process_get_events (vm, &event_data);
-  switch (event_type)
+  memset (ecm->connects_by_thread, 0, vec_bytes (ecm->connects_by_thread));
+  connect_time = 0;
+  for (round = 0; round < n_rounds; round++)
     {
-    case ~0:
-      ec_cli_output ("Timeout with only %d sessions active...",
-		     ecm->ready_connections);
-      error = clib_error_return (0, "failed: syn timeout with %d sessions",
-				 ecm->ready_connections);
-      goto cleanup;
-
-    case 1:
-      delta = vlib_time_now (vm) - time_before_connects;
-      if (delta != 0.0)
-	ec_cli_output ("%d three-way handshakes in %.2f seconds %.2f/s",
-		       n_clients, delta, ((f64) n_clients) / delta);
-
-      ecm->test_start_time = vlib_time_now (ecm->vlib_main);
-      ec_cli_output ("Test started at %.6f", ecm->test_start_time);
-      break;
-
-    default:
-      ec_cli_output ("unexpected event(1): %d", event_type);
-      error = clib_error_return (0, "failed: unexpected event(1): %d",
-				 event_type);
-      goto cleanup;
-    }
-
-  /* Now wait for the sessions to finish... */
-  vlib_process_wait_for_event_or_clock (vm, test_timeout);
-  event_type = vlib_process_get_events (vm, &event_data);
-  switch (event_type)
-    {
-    case ~0:
-      ec_cli_output ("Timeout with %d sessions still active...",
-		     ecm->ready_connections);
-      error = clib_error_return (0, "failed: timeout with %d sessions",
-				 ecm->ready_connections);
-      goto cleanup;
-
-    case 2:
-      ecm->test_end_time = vlib_time_now (vm);
-      ec_cli_output ("Test finished at %.6f", ecm->test_end_time);
-      break;
-
-    default:
-      ec_cli_output ("unexpected event(2): %d", event_type);
-      error = clib_error_return (0, "failed: unexpected event(2): %d",
-				 event_type);
-      goto cleanup;
+      if ((error = echo_clients_run_round (vm, n_clients, syn_timeout,
+					   test_timeout, &delta)))
+	goto cleanup;
+      connect_time += delta;
     }
 
-  delta = ecm->test_end_time - ecm->test_start_time;
-  if (delta != 0.0)
-    {
-      total_bytes = (ecm->no_return ? ecm->tx_total : ecm->rx_total);
-      transfer_type = ecm->no_return ? "half-duplex" : "full-duplex";
-      ec_cli_output ("%lld bytes (%lld mbytes, %lld gbytes) in %.2f seconds",
-		     total_bytes, total_bytes / (1ULL << 20),
-		     total_bytes / (1ULL << 30), delta);
-      ec_cli_output ("%.2f bytes/second %s", ((f64) total_bytes) / (delta),
-		     transfer_type);
-      ec_cli_output ("%.4f gbit/second %s",
-		     (((f64) total_bytes * 8.0) / delta / 1e9),
-		     transfer_type);
-    }
-  else
+  if (ecm->cps_rounds)
     {
-      ec_cli_output ("zero delta-t?");
-      error = clib_error_return (0, "failed: zero delta-t");
-      goto cleanup;
+      ec_cli_output ("%u connects in %u rounds, %.2f connects/s", n_clients
+		     * n_rounds, n_rounds, (f64) n_clients * n_rounds
+		     / connect_time);
+      for (i = 0; i < vec_len (ecm->connects_by_thread); i++)
+	if (ecm->connects_by_thread[i])
+	  ec_cli_output ("  thread %u: %u connects", i,
+			 ecm->connects_by_thread[i]);
     }
 
   if (ecm->test_bytes && ecm->test_failed)
@@ -875,7 +924,7 @@ VLIB_CLI_COMMAND (echo_clients_command, static) =
       "[test-timeout <time>][syn-timeout <time>][no-return][fifo-size <size>]"
       "[private-segment-count <count>][private-segment-size <bytes>[m|g]]"
       "[preallocate-fifos][preallocate-sessions][client-batch <batch-size>]"
-      "[uri <tcp://ip/port>][test-bytes][no-output]",
+      "[uri <tcp://ip/port>][test-bytes][no-output][cps-rounds <n>]",
   .function = echo_clients_command_fn,
   .is_mp_safe = 1,
 };
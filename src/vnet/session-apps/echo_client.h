@@ -66,6 +66,7 @@ typedef struct
   u32 tls_engine;			/**< TLS engine mbedtls/openssl */
   u8 is_dgram;
   u32 no_copy;				/**< Don't memcpy data to tx fifo */
+  u32 cps_rounds;			/**< Connect/close rounds to time */
 
   /*
    * Test state variables
@@ -76,6 +77,7 @@ typedef struct
   u8 *connect_test_data;		/**< Pre-computed test data */
   u32 **connection_index_by_thread;
   u32 **connections_this_batch_by_thread; /**< active connection batch */
+  u32 *connects_by_thread;		/**< Sessions connected per thread */
   pthread_t client_thread_handle;
 
   volatile u32 ready_connections;
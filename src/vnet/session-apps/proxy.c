@@ -193,8 +193,6 @@ proxy_rx_callback (stream_session_t * s)
   proxy_session_t *ps;
   int proxy_index;
   uword *p;
-  svm_fifo_t *active_open_tx_fifo;
-  session_fifo_event_t evt;
 
   ASSERT (s->thread_index == thread_index);
 
@@ -203,21 +201,9 @@ proxy_rx_callback (stream_session_t * s)
 
   if (PREDICT_TRUE (p != 0))
     {
+      /* Active open still connecting. Data is forwarded once the sessions
+       * are spliced */
       clib_spinlock_unlock_if_init (&pm->sessions_lock);
-      active_open_tx_fifo = s->server_rx_fifo;
-
-      /*
-       * Send event for active open tx fifo
-       */
-      if (svm_fifo_set_event (active_open_tx_fifo))
-	{
-	  u32 ao_thread_index = active_open_tx_fifo->master_thread_index;
-	  evt.fifo = active_open_tx_fifo;
-	  evt.event_type = FIFO_EVENT_APP_TX;
-	  if (svm_queue_add (pm->active_open_event_queue[ao_thread_index],
-			     (u8 *) & evt, 0 /* do wait for mutex */ ))
-	    clib_warning ("failed to enqueue tx evt");
-	}
     }
   else
     {
@@ -230,7 +216,10 @@ proxy_rx_callback (stream_session_t * s)
       max_dequeue = svm_fifo_max_dequeue (s->server_rx_fifo);
 
       if (PREDICT_FALSE (max_dequeue == 0))
-	return 0;
+	{
+	  clib_spinlock_unlock_if_init (&pm->sessions_lock);
+	  return 0;
+	}
 
       actual_transfer = svm_fifo_peek (rx_fifo, 0 /* relative_offset */ ,
 				       max_dequeue, pm->rx_buf[thread_index]);
@@ -239,7 +228,6 @@ proxy_rx_callback (stream_session_t * s)
 
       memset (a, 0, sizeof (*a));
 
-      clib_spinlock_lock_if_init (&pm->sessions_lock);
       pool_get (pm->sessions, ps);
       memset (ps, 0, sizeof (*ps));
       ps->server_rx_fifo = rx_fifo;
@@ -276,9 +264,9 @@ active_open_connected_callback (u32 app_index, u32 opaque,
 				stream_session_t * s, u8 is_fail)
 {
   proxy_main_t *pm = &proxy_main;
+  stream_session_t *server_session;
   proxy_session_t *ps;
-  u8 thread_index = vlib_get_thread_index ();
-  session_fifo_event_t evt;
+  int rv;
 
   if (is_fail)
     {
@@ -294,40 +282,23 @@ active_open_connected_callback (u32 app_index, u32 opaque,
   ps = pool_elt_at_index (pm->sessions, opaque);
   ps->vpp_active_open_handle = session_handle (s);
 
-  s->server_tx_fifo = ps->server_rx_fifo;
-  s->server_rx_fifo = ps->server_tx_fifo;
-
-  /*
-   * Reset the active-open tx-fifo master indices so the active-open session
-   * will receive data, etc.
-   */
-  s->server_tx_fifo->master_session_index = s->session_index;
-  s->server_tx_fifo->master_thread_index = s->thread_index;
-
-  /*
-   * Account for the active-open session's use of the fifos
-   * so they won't disappear until the last session which uses
-   * them disappears
-   */
-  s->server_tx_fifo->refcnt++;
-  s->server_rx_fifo->refcnt++;
-
   hash_set (pm->proxy_session_by_active_open_handle,
 	    ps->vpp_active_open_handle, opaque);
 
+  server_session = session_get_from_handle (ps->vpp_server_handle);
+
   clib_spinlock_unlock_if_init (&pm->sessions_lock);
 
   /*
-   * Send event for active open tx fifo
+   * Have the active open use the server session's fifos crosswise. The
+   * server session may be on another thread, which then does its half of
+   * the splice. From there on, data moves between the two sessions without
+   * our involvement.
    */
-  if (svm_fifo_set_event (s->server_tx_fifo))
+  if ((rv = session_splice (server_session, s)))
     {
-      evt.fifo = s->server_tx_fifo;
-      evt.event_type = FIFO_EVENT_APP_TX;
-      if (svm_queue_add
-	  (pm->active_open_event_queue[thread_index], (u8 *) & evt,
-	   0 /* do wait for mutex */ ))
-	clib_warning ("failed to enqueue tx evt");
+      clib_warning ("failed to splice sessions: %d", rv);
+      return -1;
     }
 
   return 0;
@@ -354,25 +325,7 @@ active_open_disconnect_callback (stream_session_t * s)
 static int
 active_open_rx_callback (stream_session_t * s)
 {
-  proxy_main_t *pm = &proxy_main;
-  session_fifo_event_t evt;
-  svm_fifo_t *proxy_tx_fifo;
-
-  proxy_tx_fifo = s->server_rx_fifo;
-
-  /*
-   * Send event for server tx fifo
-   */
-  if (svm_fifo_set_event (proxy_tx_fifo))
-    {
-      u32 p_thread_index = proxy_tx_fifo->master_thread_index;
-      evt.fifo = proxy_tx_fifo;
-      evt.event_type = FIFO_EVENT_APP_TX;
-      if (svm_queue_add (pm->server_event_queue[p_thread_index], (u8 *) & evt,
-			 0 /* do wait for mutex */ ))
-	clib_warning ("failed to enqueue server rx evt");
-    }
-
+  /* Never called, active opens are spliced as soon as they connect */
   return 0;
 }
 
@@ -421,6 +374,7 @@ proxy_server_attach ()
   a->options[APP_OPTIONS_SEGMENT_SIZE] = segment_size;
   a->options[APP_OPTIONS_RX_FIFO_SIZE] = pm->fifo_size;
   a->options[APP_OPTIONS_TX_FIFO_SIZE] = pm->fifo_size;
+  a->options[APP_OPTIONS_MAX_FIFO_SIZE] = pm->max_fifo_size;
   a->options[APP_OPTIONS_PRIVATE_SEGMENT_COUNT] = pm->private_segment_count;
   a->options[APP_OPTIONS_PREALLOC_FIFO_PAIRS] =
     pm->prealloc_fifos ? pm->prealloc_fifos : 0;
@@ -454,6 +408,7 @@ active_open_attach (void)
   options[APP_OPTIONS_SEGMENT_SIZE] = 512 << 20;
   options[APP_OPTIONS_RX_FIFO_SIZE] = pm->fifo_size;
   options[APP_OPTIONS_TX_FIFO_SIZE] = pm->fifo_size;
+  options[APP_OPTIONS_MAX_FIFO_SIZE] = pm->max_fifo_size;
   options[APP_OPTIONS_PRIVATE_SEGMENT_COUNT] = pm->private_segment_count;
   options[APP_OPTIONS_PREALLOC_FIFO_PAIRS] =
     pm->prealloc_fifos ? pm->prealloc_fifos : 0;
@@ -494,8 +449,6 @@ proxy_server_create (vlib_main_t * vm)
     create_api_loopbacks (vm);
 
   num_threads = 1 /* main thread */  + vtm->n_threads;
-  vec_validate (proxy_main.server_event_queue, num_threads - 1);
-  vec_validate (proxy_main.active_open_event_queue, num_threads - 1);
   vec_validate (pm->rx_buf, num_threads - 1);
 
   for (i = 0; i < num_threads; i++)
@@ -517,16 +470,6 @@ proxy_server_create (vlib_main_t * vm)
       return -1;
     }
 
-  for (i = 0; i < num_threads; i++)
-    {
-      pm->active_open_event_queue[i] =
-	session_manager_get_vpp_event_queue (i);
-
-      ASSERT (pm->active_open_event_queue[i]);
-
-      pm->server_event_queue[i] = session_manager_get_vpp_event_queue (i);
-    }
-
   return 0;
 }
 
@@ -541,6 +484,7 @@ proxy_server_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
   u64 tmp;
 
   pm->fifo_size = 64 << 10;
+  pm->max_fifo_size = 0;
   pm->rcv_buffer_size = 1024;
   pm->prealloc_fifos = 0;
   pm->private_segment_count = 0;
@@ -551,6 +495,8 @@ proxy_server_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
     {
       if (unformat (input, "fifo-size %d", &pm->fifo_size))
 	pm->fifo_size <<= 10;
+      else if (unformat (input, "max-fifo-size %d", &pm->max_fifo_size))
+	pm->max_fifo_size <<= 10;
       else if (unformat (input, "rcv-buf-size %d", &pm->rcv_buffer_size))
 	;
       else if (unformat (input, "prealloc-fifos %d", &pm->prealloc_fifos))
@@ -607,7 +553,8 @@ VLIB_CLI_COMMAND (proxy_create_command, static) =
 {
   .path = "test proxy server",
   .short_help = "test proxy server [server-uri <tcp://ip/port>]"
-      "[client-uri <tcp://ip/port>][fifo-size <nn>][rcv-buf-size <nn>]"
+      "[client-uri <tcp://ip/port>][fifo-size <nn>][max-fifo-size <nn>]"
+      "[rcv-buf-size <nn>]"
       "[prealloc-fifos <nn>][private-segment-size <mem>]"
       "[private-segment-count <nn>]",
   .function = proxy_server_create_command_fn,
@@ -40,8 +40,6 @@ typedef struct
 {
   svm_queue_t *vl_input_queue;	/**< vpe input queue */
   /** per-thread vectors */
-  svm_queue_t **server_event_queue;
-  svm_queue_t **active_open_event_queue;
   u8 **rx_buf;				/**< intermediate rx buffers */
 
   u32 cli_node_index;			/**< cli process node index */
@@ -59,6 +57,7 @@ typedef struct
   u8 *connect_uri;			/**< URI for slave's connect */
   u32 configured_segment_size;
   u32 fifo_size;
+  u32 max_fifo_size;			/**< size fifos may grow to */
   u32 private_segment_count;		/**< Number of private fifo segs */
   u32 private_segment_size;		/**< size of private fifo segs */
   int rcv_buffer_size;
@@ -129,6 +129,7 @@ typedef enum
   APP_OPTIONS_PROXY_TRANSPORT,
   APP_OPTIONS_ACCEPT_COOKIE,
   APP_OPTIONS_TLS_ENGINE,
+  APP_OPTIONS_MAX_FIFO_SIZE,
   APP_OPTIONS_N_OPTIONS
 } app_attach_options_index_t;
 
@@ -515,6 +515,9 @@ alloc_check:
       sm_index = segment_manager_index (sm);
       (*tx_fifo)->segment_manager = sm_index;
       (*rx_fifo)->segment_manager = sm_index;
+      /* Fifos of spliced sessions are filled by vpp in both directions */
+      (*tx_fifo)->max_nitems = props->max_fifo_size;
+      (*rx_fifo)->max_nitems = props->max_fifo_size;
       *fifo_segment_index = segment_manager_segment_index (sm, fifo_segment);
 
       if (added_a_segment)
@@ -556,6 +559,58 @@ alloc_check:
     }
 }
 
+/**
+ * Grow fifo filled by vpp, up to its max size
+ *
+ * Fifo size is doubled, or increased by the largest power of two that
+ * still fits within the max size.
+ */
+int
+segment_manager_grow_fifo (u32 segment_index, svm_fifo_t * f)
+{
+  svm_fifo_segment_private_t *fifo_segment;
+  segment_manager_t *sm;
+  u32 chunk_size;
+  int rv;
+
+  chunk_size = 1 << max_log2 (f->nitems);
+  while (chunk_size > FIFO_SEGMENT_MIN_FIFO_SIZE
+	 && f->nitems + chunk_size > f->max_nitems)
+    chunk_size >>= 1;
+
+  if (f->nitems + chunk_size > f->max_nitems)
+    return -1;
+
+  if (!(sm = segment_manager_get_if_valid (f->segment_manager)))
+    return -1;
+
+  fifo_segment = segment_manager_get_segment_w_lock (sm, segment_index);
+  rv = svm_fifo_segment_grow_fifo (fifo_segment, f, chunk_size);
+  segment_manager_segment_reader_unlock (sm);
+
+  return rv;
+}
+
+/**
+ * Shrink fifo filled by vpp back to its initial size
+ */
+int
+segment_manager_shrink_fifo (u32 segment_index, svm_fifo_t * f)
+{
+  svm_fifo_segment_private_t *fifo_segment;
+  segment_manager_t *sm;
+  int rv;
+
+  if (!(sm = segment_manager_get_if_valid (f->segment_manager)))
+    return -1;
+
+  fifo_segment = segment_manager_get_segment_w_lock (sm, segment_index);
+  rv = svm_fifo_segment_shrink_fifo (fifo_segment, f);
+  segment_manager_segment_reader_unlock (sm);
+
+  return rv;
+}
+
 void
 segment_manager_dealloc_fifos (u32 segment_index, svm_fifo_t * rx_fifo,
 			       svm_fifo_t * tx_fifo)
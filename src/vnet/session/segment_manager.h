@@ -29,6 +29,10 @@ typedef struct _segment_manager_properties
   u32 tx_fifo_size;
   u32 evt_q_size;
 
+  /** Size fifos filled by vpp may grow to under load. If 0, or not larger
+   * than the initial fifo sizes, fifos are not grown. */
+  u32 max_fifo_size;
+
   /** Configured additional segment size */
   u32 add_segment_size;
 
@@ -150,6 +154,8 @@ int segment_manager_try_alloc_fifos (svm_fifo_segment_private_t * fs,
 				     u32 rx_fifo_size, u32 tx_fifo_size,
 				     svm_fifo_t ** rx_fifo,
 				     svm_fifo_t ** tx_fifo);
+int segment_manager_grow_fifo (u32 segment_index, svm_fifo_t * f);
+int segment_manager_shrink_fifo (u32 segment_index, svm_fifo_t * f);
 void segment_manager_dealloc_fifos (u32 segment_index, svm_fifo_t * rx_fifo,
 				    svm_fifo_t * tx_fifo);
 svm_queue_t *segment_manager_alloc_queue (svm_fifo_segment_private_t * fs,
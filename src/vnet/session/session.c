@@ -171,9 +171,6 @@ session_alloc_and_init (segment_manager_t * sm, transport_connection_t * tc,
       return rv;
     }
 
-  /* Add to the main lookup table */
-  session_lookup_add_connection (tc, session_handle (s));
-
   *ret_s = s;
   return 0;
 }
@@ -288,6 +285,30 @@ session_enqueue_chain_tail (stream_session_t * s, vlib_buffer_t * b,
   return 0;
 }
 
+/**
+ * Grow rx fifo if it is about to fill up and shrink it back to its initial
+ * size once the app has drained it. Only for fifos with a max size set.
+ */
+static inline void
+session_rx_fifo_resize (stream_session_t * s, u32 n_bytes)
+{
+  svm_fifo_t *f = s->server_rx_fifo;
+
+  if (PREDICT_TRUE (f->max_nitems == 0))
+    return;
+
+  if (svm_fifo_max_dequeue (f) == 0)
+    {
+      if (f->chunks)
+	segment_manager_shrink_fifo (s->svm_segment_index, f);
+      return;
+    }
+
+  if (f->nitems < f->max_nitems
+      && svm_fifo_max_enqueue (f) < n_bytes + (f->nitems >> 2))
+    segment_manager_grow_fifo (s->svm_segment_index, f);
+}
+
 /*
  * Enqueue data for delivery to session peer. Does not notify peer of enqueue
  * event but on request can queue notification events for later delivery by
@@ -314,6 +335,7 @@ session_enqueue_stream_connection (transport_connection_t * tc,
 
   if (is_in_order)
     {
+      session_rx_fifo_resize (s, b->current_length);
       enqueued = svm_fifo_enqueue_nowait (s->server_rx_fifo,
 					  b->current_length,
 					  vlib_buffer_get_current (b));
@@ -434,7 +456,84 @@ u32
 stream_session_dequeue_drop (transport_connection_t * tc, u32 max_bytes)
 {
   stream_session_t *s = session_get (tc->s_index, tc->thread_index);
-  return svm_fifo_dequeue_drop (s->server_tx_fifo, max_bytes);
+  u32 rv;
+
+  rv = svm_fifo_dequeue_drop (s->server_tx_fifo, max_bytes);
+  if (PREDICT_FALSE (svm_fifo_want_tx_evt (s->server_tx_fifo)))
+    session_dequeue_notify (s);
+  return rv;
+}
+
+/**
+ * Notify app that tx fifo space was freed, if it asked to be told.
+ *
+ * If the event cannot be sent, the request is kept so that the next
+ * dequeue tries again.
+ */
+void
+session_dequeue_notify (stream_session_t * s)
+{
+  application_t *app;
+  session_fifo_event_t evt;
+  svm_queue_t *q;
+
+  if (!svm_fifo_clear_want_tx_evt (s->server_tx_fifo))
+    return;
+
+  app = application_get_if_valid (s->app_index);
+  if (PREDICT_FALSE (app == 0 || app->event_queue == 0))
+    return;
+
+  evt.fifo = s->server_tx_fifo;
+  evt.event_type = FIFO_EVENT_APP_TX;
+  q = app->event_queue;
+  if (PREDICT_TRUE (q->cursize < q->maxsize))
+    svm_queue_add (q, (u8 *) & evt, 0 /* do wait for mutex */ );
+  else
+    svm_fifo_set_want_tx_evt (s->server_tx_fifo);
+}
+
+/**
+ * Notify spliced peer that new data is available for sending.
+ *
+ * The rx fifo of a spliced session is its peer's tx fifo, so rather than
+ * waking the application, a tx event is sent to the peer's thread.
+ */
+static int
+session_splice_enqueue_notify (stream_session_t * s)
+{
+  svm_fifo_t *f = s->server_rx_fifo;
+  session_fifo_event_t evt;
+  svm_queue_t *q;
+
+  /* Peer is gone, nobody will ever dequeue */
+  if (PREDICT_FALSE (f->master_session_index == INVALID_INDEX))
+    {
+      svm_fifo_dequeue_drop_all (f);
+      return 0;
+    }
+
+  if (svm_fifo_set_event (f))
+    {
+      evt.fifo = f;
+      evt.event_type = FIFO_EVENT_APP_TX;
+      q = session_manager_get_vpp_event_queue (f->master_thread_index);
+      if (PREDICT_FALSE (q->cursize == q->maxsize))
+	{
+	  svm_fifo_unset_event (f);
+	  return -1;
+	}
+      svm_queue_add (q, (u8 *) & evt, 0 /* do wait for mutex */ );
+    }
+
+  /* *INDENT-OFF* */
+  SESSION_EVT_DBG(SESSION_EVT_ENQ, s, ({
+      ed->data[0] = FIFO_EVENT_APP_TX;
+      ed->data[1] = svm_fifo_max_dequeue (f);
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
 }
 
 /**
@@ -459,6 +558,10 @@ session_enqueue_notify (stream_session_t * s, u8 block)
       return 0;
     }
 
+  /* Spliced session? Data goes straight to the peer's transport */
+  if (s->splice_role)
+    return session_splice_enqueue_notify (s);
+
   /* Get session's server */
   app = application_get_if_valid (s->app_index);
 
@@ -604,6 +707,7 @@ session_stream_connect_notify (transport_connection_t * tc, u8 is_fail)
 	}
       else
 	{
+	  session_lookup_add_connection (tc, session_handle (new_s));
 	  new_s->app_index = app->index;
 	  new_si = new_s->session_index;
 	  new_ti = new_s->thread_index;
@@ -653,6 +757,7 @@ session_switch_pool (void *cb_args)
   s = session_get (args->session_index, args->thread_index);
   s->server_tx_fifo->master_session_index = args->new_session_index;
   s->server_tx_fifo->master_thread_index = args->new_thread_index;
+  session_lookup_del_session (s);
   tp = session_get_transport_proto (s);
   tp_vfts[tp].cleanup (s->connection_index, s->thread_index);
   session_free (s);
@@ -743,11 +848,210 @@ stream_session_delete (stream_session_t * s)
     clib_warning ("hash delete error, rv %d", rv);
 
   /* Cleanup fifo segments */
-  segment_manager_dealloc_fifos (s->svm_segment_index, s->server_rx_fifo,
-				 s->server_tx_fifo);
+  if (PREDICT_FALSE (s->splice_role))
+    stream_session_unsplice (s);
+  else
+    segment_manager_dealloc_fifos (s->svm_segment_index, s->server_rx_fifo,
+				   s->server_tx_fifo);
   session_free (s);
 }
 
+typedef struct _session_splice_args
+{
+  u32 session_index;
+  u32 thread_index;
+  u32 peer_session_index;
+  u32 peer_thread_index;
+  svm_fifo_t *rx_fifo;
+} session_splice_args_t;
+
+/**
+ * Undo the peer's half of a splice whose owner went away, run on the peer's
+ * thread.
+ *
+ * The peer holds the last references to the owner's fifos, so nobody else
+ * uses them anymore. Stop the peer from sending events to the stale owner
+ * and have the app tear the peer down. The references are dropped when the
+ * peer is deleted.
+ */
+static void
+session_splice_abort (void *cb_args)
+{
+  session_splice_args_t *args = (session_splice_args_t *) cb_args;
+  stream_session_t *peer;
+  application_t *app;
+
+  ASSERT (args->peer_thread_index == vlib_get_thread_index ());
+  peer = session_get_if_valid (args->peer_session_index,
+			       args->peer_thread_index);
+  if (!peer || peer->splice_role != SESSION_SPLICE_PEER
+      || peer->server_tx_fifo != args->rx_fifo)
+    {
+      clib_mem_free (cb_args);
+      return;
+    }
+
+  peer->server_rx_fifo->master_session_index = INVALID_INDEX;
+  peer->server_tx_fifo->master_session_index = INVALID_INDEX;
+  svm_fifo_dequeue_drop_all (peer->server_rx_fifo);
+
+  app = application_get (peer->app_index);
+  app->cb_fns.session_reset_callback (peer);
+
+  clib_mem_free (cb_args);
+}
+
+/**
+ * Owner half of a splice, run on the owner session's thread.
+ *
+ * The owner's rx path is only touched from its own thread, so this is
+ * where its rx fifo is handed to the peer for transmission. If the owner
+ * went away meanwhile, the peer's half is undone on the peer's thread.
+ */
+static void
+session_splice_owner (void *cb_args)
+{
+  session_splice_args_t *args = (session_splice_args_t *) cb_args;
+  stream_session_t *s;
+
+  ASSERT (args->thread_index == vlib_get_thread_index ());
+  s = session_get_if_valid (args->session_index, args->thread_index);
+  if (!s || s->server_rx_fifo != args->rx_fifo)
+    {
+      session_send_rpc_evt_to_thread (args->peer_thread_index,
+				      session_splice_abort, cb_args);
+      return;
+    }
+
+  /* Only one splice can hold a reference to the owner's rx fifo */
+  ASSERT (!s->splice_role);
+
+  /* Fifos are dequeued, i.e., transmitted from, by the session that uses
+   * them as tx fifos. Point the rx fifo's backpointers at the peer */
+  s->server_rx_fifo->master_session_index = args->peer_session_index;
+  s->server_rx_fifo->master_thread_index = args->peer_thread_index;
+  s->splice_role = SESSION_SPLICE_OWNER;
+
+  /* Flush whatever was received before the splice. A builtin rx event
+   * still queued for the app may hold the fifo's event flag */
+  svm_fifo_unset_event (s->server_rx_fifo);
+  if (svm_fifo_max_dequeue (s->server_rx_fifo))
+    session_splice_enqueue_notify (s);
+
+  clib_mem_free (cb_args);
+}
+
+/**
+ * Splice two sessions so data received on one is sent on the other.
+ *
+ * The peer's own fifos, if it has any, are released and the peer starts
+ * using the session's fifos crosswise: the session's rx fifo becomes the
+ * peer's tx fifo and the peer's rx fifo is the session's tx fifo.
+ * Thereafter, bytes received by either transport are handed to the other
+ * transport without being copied and without involving the application,
+ * which only gets connect, disconnect and reset notifications.
+ *
+ * Must be called on the peer's thread, which does the peer's half right
+ * away. The session may belong to another thread, so its half is done by
+ * an rpc queued to that thread and the splice completes after this returns.
+ * Until then, data the session receives still goes to its app. If the
+ * session is closed before that, the peer is reset.
+ *
+ * Only sessions of builtin applications can be spliced, since fifos of
+ * external apps are mapped by the apps. The peer's fifos must be empty.
+ *
+ * @param s Session whose fifos are to be shared
+ * @param peer Session that will use s's fifos
+ * @return 0 if the splice was started or a negative error code
+ */
+int
+session_splice (stream_session_t * s, stream_session_t * peer)
+{
+  session_splice_args_t *args;
+  application_t *app;
+
+  ASSERT (peer->thread_index == vlib_get_thread_index ());
+
+  if (s->splice_role || peer->splice_role || s == peer)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  app = application_get (s->app_index);
+  if (!application_is_builtin (app))
+    return VNET_API_ERROR_APP_UNSUPPORTED_CFG;
+  app = application_get (peer->app_index);
+  if (!application_is_builtin (app))
+    return VNET_API_ERROR_APP_UNSUPPORTED_CFG;
+
+  /* Sessions of builtin proxies are not given fifos of their own */
+  if (peer->server_rx_fifo && (svm_fifo_max_dequeue (peer->server_rx_fifo)
+			       || svm_fifo_max_dequeue (peer->server_tx_fifo)))
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  /* The peer's references. Fifo references are dropped atomically, so
+   * they can be taken while the owner's thread may be releasing its own.
+   * The owner's splice_role is only set by its own thread, so the rx fifo
+   * reference also tells if the session is already spliced */
+  if (!__sync_bool_compare_and_swap (&s->server_rx_fifo->refcnt, 1, 2))
+    return VNET_API_ERROR_INVALID_VALUE;
+  __sync_fetch_and_add (&s->server_tx_fifo->refcnt, 1);
+
+  if (peer->server_rx_fifo)
+    segment_manager_dealloc_fifos (peer->svm_segment_index,
+				   peer->server_rx_fifo,
+				   peer->server_tx_fifo);
+  peer->server_rx_fifo = s->server_tx_fifo;
+  peer->server_tx_fifo = s->server_rx_fifo;
+  peer->svm_segment_index = s->svm_segment_index;
+  peer->splice_role = SESSION_SPLICE_PEER;
+
+  /* Flush whatever the owner's app left to be sent */
+  if (svm_fifo_max_dequeue (peer->server_rx_fifo))
+    session_splice_enqueue_notify (peer);
+
+  args = clib_mem_alloc (sizeof (*args));
+  args->session_index = s->session_index;
+  args->thread_index = s->thread_index;
+  args->peer_session_index = peer->session_index;
+  args->peer_thread_index = peer->thread_index;
+  args->rx_fifo = s->server_rx_fifo;
+
+  /* Queued even if the session is on this thread, so its half runs after
+   * the events already pending for it */
+  session_send_evt_to_thread (0, FIFO_EVENT_RPC, args->thread_index,
+			      session_splice_owner, args);
+  return 0;
+}
+
+/**
+ * Drop a spliced session's references to the shared fifos.
+ *
+ * Fifos are returned to the freelists they were allocated from, i.e., from
+ * the owner's perspective, regardless of which session goes away last.
+ */
+void
+stream_session_unsplice (stream_session_t * s)
+{
+  svm_fifo_t *rx_fifo, *tx_fifo;
+
+  if (s->splice_role == SESSION_SPLICE_OWNER)
+    {
+      rx_fifo = s->server_rx_fifo;
+      tx_fifo = s->server_tx_fifo;
+    }
+  else
+    {
+      rx_fifo = s->server_tx_fifo;
+      tx_fifo = s->server_rx_fifo;
+    }
+
+  /* Stop the peer from sending events on our behalf */
+  if (s->server_tx_fifo->master_session_index == s->session_index
+      && s->server_tx_fifo->master_thread_index == s->thread_index)
+    s->server_tx_fifo->master_session_index = INVALID_INDEX;
+
+  segment_manager_dealloc_fifos (s->svm_segment_index, rx_fifo, tx_fifo);
+}
+
 /**
  * Notification from transport that connection is being deleted
  *
@@ -802,6 +1106,7 @@ stream_session_accept (transport_connection_t * tc, u32 listener_index,
   if ((rv = session_alloc_and_init (sm, tc, 1, &s)))
     return rv;
 
+  session_lookup_add_connection (tc, session_handle (s));
   s->app_index = server->index;
   s->listener_index = listener_index;
   s->session_state = SESSION_STATE_ACCEPTING;
@@ -845,6 +1150,11 @@ session_open_cl (u32 app_index, session_endpoint_t * rmt, u32 opaque)
   s->app_index = app->index;
   s->session_state = SESSION_STATE_OPENED;
 
+  /* Until its first packet is received, and it is moved to the thread that
+   * received it, the session is not owned by any thread. So, like the
+   * listeners, it goes into the shared hash that all threads search. */
+  session_lookup_add_listener (tc, session_handle (s));
+
   /* Tell the app about the new event fifo for this session */
   app->cb_fns.session_connected_callback (app->index, opaque, s, 0);
 
@@ -949,7 +1259,7 @@ session_listen_vc (stream_session_t * s, session_endpoint_t * sep)
     return -1;
 
   /* Add to the main lookup table */
-  session_lookup_add_connection (tc, s->session_index);
+  session_lookup_add_listener (tc, s->session_index);
   return 0;
 }
 
@@ -983,7 +1293,7 @@ session_listen_cl (stream_session_t * s, session_endpoint_t * sep)
     return -1;
 
   /* Add to the main lookup table */
-  session_lookup_add_connection (tc, s->session_index);
+  session_lookup_add_listener (tc, s->session_index);
   return 0;
 }
 
@@ -1048,7 +1358,7 @@ stream_session_stop_listen (stream_session_t * s)
       return VNET_API_ERROR_ADDRESS_NOT_IN_USE;
     }
 
-  session_lookup_del_connection (tc);
+  session_lookup_del_listener (tc);
   tp_vfts[tp].unbind (s->connection_index);
   return 0;
 }
@@ -1500,6 +1810,12 @@ session_config_fn (vlib_main_t * vm, unformat_input_t * input)
       else if (unformat (input, "v6-halfopen-table-buckets %d",
 			 &smm->configured_v6_halfopen_table_buckets))
 	;
+      else if (unformat (input, "v4-listener-table-buckets %d",
+			 &smm->configured_v4_listener_table_buckets))
+	;
+      else if (unformat (input, "v6-listener-table-buckets %d",
+			 &smm->configured_v6_listener_table_buckets))
+	;
       else if (unformat (input, "v4-session-table-memory %U",
 			 unformat_memory_size, &tmp))
 	{
@@ -1532,6 +1848,22 @@ session_config_fn (vlib_main_t * vm, unformat_input_t * input)
 				      tmp, tmp);
 	  smm->configured_v6_halfopen_table_memory = tmp;
 	}
+      else if (unformat (input, "v4-listener-table-memory %U",
+			 unformat_memory_size, &tmp))
+	{
+	  if (tmp >= 0x100000000)
+	    return clib_error_return (0, "memory size %llx (%lld) too large",
+				      tmp, tmp);
+	  smm->configured_v4_listener_table_memory = tmp;
+	}
+      else if (unformat (input, "v6-listener-table-memory %U",
+			 unformat_memory_size, &tmp))
+	{
+	  if (tmp >= 0x100000000)
+	    return clib_error_return (0, "memory size %llx (%lld) too large",
+				      tmp, tmp);
+	  smm->configured_v6_listener_table_memory = tmp;
+	}
       else if (unformat (input, "local-endpoints-table-memory %U",
 			 unformat_memory_size, &tmp))
 	{
@@ -234,6 +234,10 @@ struct _session_manager_main
   u32 configured_v6_session_table_memory;
   u32 configured_v6_halfopen_table_buckets;
   u32 configured_v6_halfopen_table_memory;
+  u32 configured_v4_listener_table_buckets;
+  u32 configured_v4_listener_table_memory;
+  u32 configured_v6_listener_table_buckets;
+  u32 configured_v6_listener_table_memory;
 
   /** Transport table (preallocation) size parameters */
   u32 local_endpoints_table_memory;
@@ -512,6 +516,7 @@ int session_enqueue_dgram_connection (stream_session_t * s,
 int stream_session_peek_bytes (transport_connection_t * tc, u8 * buffer,
 			       u32 offset, u32 max_bytes);
 u32 stream_session_dequeue_drop (transport_connection_t * tc, u32 max_bytes);
+void session_dequeue_notify (stream_session_t * s);
 
 int session_stream_connect_notify (transport_connection_t * tc, u8 is_fail);
 int session_dgram_connect_notify (transport_connection_t * tc,
@@ -532,6 +537,8 @@ int stream_session_stop_listen (stream_session_t * s);
 void stream_session_disconnect (stream_session_t * s);
 void stream_session_disconnect_transport (stream_session_t * s);
 void stream_session_cleanup (stream_session_t * s);
+int session_splice (stream_session_t * s, stream_session_t * peer);
+void stream_session_unsplice (stream_session_t * s);
 void session_send_session_evt_to_thread (u64 session_handle,
 					 fifo_event_type_t evt_type,
 					 u32 thread_index);
@@ -241,14 +241,16 @@ session_lookup_add_connection (transport_connection_t * tc, u64 value)
     {
       make_v4_ss_kv_from_tc (&kv4, tc);
       kv4.value = value;
-      return clib_bihash_add_del_16_8 (&st->v4_session_hash, &kv4,
+      return clib_bihash_add_del_16_8 (session_table_v4_shard
+				       (st, tc->thread_index), &kv4,
 				       1 /* is_add */ );
     }
   else
     {
       make_v6_ss_kv_from_tc (&kv6, tc);
       kv6.value = value;
-      return clib_bihash_add_del_48_8 (&st->v6_session_hash, &kv6,
+      return clib_bihash_add_del_48_8 (session_table_v6_shard
+				       (st, tc->thread_index), &kv6,
 				       1 /* is_add */ );
     }
 }
@@ -320,6 +322,76 @@ session_lookup_del_connection (transport_connection_t * tc)
   session_kv4_t kv4;
   session_kv6_t kv6;
 
+  st = session_table_get_for_connection (tc);
+  if (!st)
+    return -1;
+  if (tc->is_ip4)
+    {
+      make_v4_ss_kv_from_tc (&kv4, tc);
+      return clib_bihash_add_del_16_8 (session_table_v4_shard
+				       (st, tc->thread_index), &kv4,
+				       0 /* is_add */ );
+    }
+  else
+    {
+      make_v6_ss_kv_from_tc (&kv6, tc);
+      return clib_bihash_add_del_48_8 (session_table_v6_shard
+				       (st, tc->thread_index), &kv6,
+				       0 /* is_add */ );
+    }
+}
+
+/**
+ * Add transport listener to session table
+ *
+ * Unlike established connections, listeners are looked up by all threads
+ * so they go into the table's shared hash, not into a thread's shard.
+ *
+ * @param tc		transport listener to be added
+ * @param value	 	value to be stored
+ *
+ * @return non-zero if failure
+ */
+int
+session_lookup_add_listener (transport_connection_t * tc, u64 value)
+{
+  session_table_t *st;
+  session_kv4_t kv4;
+  session_kv6_t kv6;
+
+  st = session_table_get_or_alloc_for_connection (tc);
+  if (!st)
+    return -1;
+  if (tc->is_ip4)
+    {
+      make_v4_ss_kv_from_tc (&kv4, tc);
+      kv4.value = value;
+      return clib_bihash_add_del_16_8 (&st->v4_session_hash, &kv4,
+				       1 /* is_add */ );
+    }
+  else
+    {
+      make_v6_ss_kv_from_tc (&kv6, tc);
+      kv6.value = value;
+      return clib_bihash_add_del_48_8 (&st->v6_session_hash, &kv6,
+				       1 /* is_add */ );
+    }
+}
+
+/**
+ * Delete transport listener from session table
+ *
+ * @param tc		transport listener to be removed
+ *
+ * @return non-zero if failure
+ */
+int
+session_lookup_del_listener (transport_connection_t * tc)
+{
+  session_table_t *st;
+  session_kv4_t kv4;
+  session_kv6_t kv6;
+
   st = session_table_get_for_connection (tc);
   if (!st)
     return -1;
@@ -343,6 +415,9 @@ session_lookup_del_session (stream_session_t * s)
   transport_proto_t tp = session_get_transport_proto (s);
   transport_connection_t *ts;
   ts = tp_vfts[tp].get_connection (s->connection_index, s->thread_index);
+  /* Opened dgram sessions are not owned by any thread's shard yet */
+  if (s->session_state == SESSION_STATE_OPENED)
+    return session_lookup_del_listener (ts);
   return session_lookup_del_connection (ts);
 }
 
@@ -829,7 +904,8 @@ session_lookup_half_open_connection (u64 handle, u8 proto, u8 is_ip4)
  *
  * The lookup is incremental and returns whenever something is matched. The
  * steps are:
- * - Try to find an established session
+ * - Try to find an established session in the thread's shard. Flows are
+ *   expected to be steered to the thread that owns their session
  * - Try to find a half-open connection
  * - Try session rules table
  * - Try to find a fully-formed or local source wildcarded (listener bound to
@@ -867,7 +943,8 @@ session_lookup_connection_wt4 (u32 fib_index, ip4_address_t * lcl,
    * Lookup session amongst established ones
    */
   make_v4_ss_kv (&kv4, lcl, rmt, lcl_port, rmt_port, proto);
-  rv = clib_bihash_search_inline_16_8 (&st->v4_session_hash, &kv4);
+  rv = clib_bihash_search_inline_16_8 (session_table_v4_shard
+				       (st, thread_index), &kv4);
   if (rv == 0)
     {
       ASSERT ((u32) (kv4.value >> 32) == thread_index);
@@ -908,12 +985,63 @@ session_lookup_connection_wt4 (u32 fib_index, ip4_address_t * lcl,
   return 0;
 }
 
+/**
+ * Lookup established session
+ *
+ * The caller's shard is searched first and then the table's shared hash
+ * which, apart from listeners, holds the dgram sessions that are not yet
+ * owned by any thread (see @ref session_open_cl). Flows are steered to the
+ * thread that owns their session, so that is all the data path needs. Only
+ * slow path callers should ask for the other threads' shards to be searched.
+ *
+ * @return 0 and kv4 value filled in if found, non-zero otherwise
+ */
+static int
+session_lookup_established4 (session_table_t * st, session_kv4_t * kv4,
+			     u8 all_shards)
+{
+  u32 thread_index = vlib_get_thread_index (), i;
+
+  if (!clib_bihash_search_inline_16_8 (session_table_v4_shard
+				       (st, thread_index), kv4))
+    return 0;
+  if (!clib_bihash_search_inline_16_8 (&st->v4_session_hash, kv4))
+    return 0;
+  if (PREDICT_TRUE (!all_shards))
+    return -1;
+  for (i = 0; i < vec_len (st->v4_session_shards); i++)
+    if (i != thread_index
+	&& !clib_bihash_search_inline_16_8 (&st->v4_session_shards[i], kv4))
+      return 0;
+  return -1;
+}
+
+static int
+session_lookup_established6 (session_table_t * st, session_kv6_t * kv6,
+			     u8 all_shards)
+{
+  u32 thread_index = vlib_get_thread_index (), i;
+
+  if (!clib_bihash_search_inline_48_8 (session_table_v6_shard
+				       (st, thread_index), kv6))
+    return 0;
+  if (!clib_bihash_search_inline_48_8 (&st->v6_session_hash, kv6))
+    return 0;
+  if (PREDICT_TRUE (!all_shards))
+    return -1;
+  for (i = 0; i < vec_len (st->v6_session_shards); i++)
+    if (i != thread_index
+	&& !clib_bihash_search_inline_48_8 (&st->v6_session_shards[i], kv6))
+      return 0;
+  return -1;
+}
+
 /**
  * Lookup connection with ip4 and transport layer information
  *
- * Not optimized. This is used on the fast path so it needs to be fast.
- * Thereby, duplication of code and 'hacks' allowed. Lookup logic is identical
- * to that of @ref session_lookup_connection_wt4
+ * Not optimized. Lookup logic is identical to that of
+ * @ref session_lookup_connection_wt4 but established sessions are searched
+ * for in all threads' shards. Meant for the cli and other slow path callers.
  *
  * @param fib_index	index of the fib wherein the connection was received
  * @param lcl		local ip4 address
@@ -943,7 +1071,7 @@ session_lookup_connection4 (u32 fib_index, ip4_address_t * lcl,
    * Lookup session amongst established ones
    */
   make_v4_ss_kv (&kv4, lcl, rmt, lcl_port, rmt_port, proto);
-  rv = clib_bihash_search_inline_16_8 (&st->v4_session_hash, &kv4);
+  rv = session_lookup_established4 (st, &kv4, 1 /* all_shards */ );
   if (rv == 0)
     {
       s = session_get_from_handle (kv4.value);
@@ -996,9 +1124,10 @@ session_lookup_connection4 (u32 fib_index, ip4_address_t * lcl,
  *
  * Typically used by dgram connections
  */
-stream_session_t *
-session_lookup_safe4 (u32 fib_index, ip4_address_t * lcl, ip4_address_t * rmt,
-		      u16 lcl_port, u16 rmt_port, u8 proto)
+static stream_session_t *
+session_lookup_safe4_i (u32 fib_index, ip4_address_t * lcl,
+			ip4_address_t * rmt, u16 lcl_port, u16 rmt_port,
+			u8 proto, u8 all_shards)
 {
   session_table_t *st;
   session_kv4_t kv4;
@@ -1014,7 +1143,7 @@ session_lookup_safe4 (u32 fib_index, ip4_address_t * lcl, ip4_address_t * rmt,
    * Lookup session amongst established ones
    */
   make_v4_ss_kv (&kv4, lcl, rmt, lcl_port, rmt_port, proto);
-  rv = clib_bihash_search_inline_16_8 (&st->v4_session_hash, &kv4);
+  rv = session_lookup_established4 (st, &kv4, all_shards);
   if (rv == 0)
     return session_get_from_handle_safe (kv4.value);
 
@@ -1040,6 +1169,31 @@ session_lookup_safe4 (u32 fib_index, ip4_address_t * lcl, ip4_address_t * rmt,
   return 0;
 }
 
+/**
+ * Data path lookup. Established sessions are only searched for in the
+ * caller's shard and in the shared hash.
+ */
+stream_session_t *
+session_lookup_safe4 (u32 fib_index, ip4_address_t * lcl, ip4_address_t * rmt,
+		      u16 lcl_port, u16 rmt_port, u8 proto)
+{
+  return session_lookup_safe4_i (fib_index, lcl, rmt, lcl_port, rmt_port,
+				 proto, 0 /* all_shards */ );
+}
+
+/**
+ * Slow path lookup, e.g., for the cli. Established sessions are searched for
+ * in all threads' shards.
+ */
+stream_session_t *
+session_lookup_safe_any4 (u32 fib_index, ip4_address_t * lcl,
+			  ip4_address_t * rmt, u16 lcl_port, u16 rmt_port,
+			  u8 proto)
+{
+  return session_lookup_safe4_i (fib_index, lcl, rmt, lcl_port, rmt_port,
+				 proto, 1 /* all_shards */ );
+}
+
 /**
  * Lookup connection with ip6 and transport layer information
  *
@@ -1048,7 +1202,8 @@ session_lookup_safe4 (u32 fib_index, ip4_address_t * lcl, ip4_address_t * rmt,
  *
  * The lookup is incremental and returns whenever something is matched. The
  * steps are:
- * - Try to find an established session
+ * - Try to find an established session in the thread's shard. Flows are
+ *   expected to be steered to the thread that owns their session
  * - Try to find a half-open connection
  * - Try session rules table
  * - Try to find a fully-formed or local source wildcarded (listener bound to
@@ -1082,7 +1237,8 @@ session_lookup_connection_wt6 (u32 fib_index, ip6_address_t * lcl,
     return 0;
 
   make_v6_ss_kv (&kv6, lcl, rmt, lcl_port, rmt_port, proto);
-  rv = clib_bihash_search_inline_48_8 (&st->v6_session_hash, &kv6);
+  rv = clib_bihash_search_inline_48_8 (session_table_v6_shard
+				       (st, thread_index), &kv6);
   if (rv == 0)
     {
       ASSERT ((u32) (kv6.value >> 32) == thread_index);
@@ -1120,9 +1276,9 @@ session_lookup_connection_wt6 (u32 fib_index, ip6_address_t * lcl,
 /**
  * Lookup connection with ip6 and transport layer information
  *
- * Not optimized. This is used on the fast path so it needs to be fast.
- * Thereby, duplication of code and 'hacks' allowed. Lookup logic is identical
- * to that of @ref session_lookup_connection_wt4
+ * Not optimized. Lookup logic is identical to that of
+ * @ref session_lookup_connection_wt4 but established sessions are searched
+ * for in all threads' shards. Meant for the cli and other slow path callers.
  *
  * @param fib_index	index of the fib wherein the connection was received
  * @param lcl		local ip6 address
@@ -1149,7 +1305,7 @@ session_lookup_connection6 (u32 fib_index, ip6_address_t * lcl,
     return 0;
 
   make_v6_ss_kv (&kv6, lcl, rmt, lcl_port, rmt_port, proto);
-  rv = clib_bihash_search_inline_48_8 (&st->v6_session_hash, &kv6);
+  rv = session_lookup_established6 (st, &kv6, 1 /* all_shards */ );
   if (rv == 0)
     {
       s = session_get_from_handle (kv6.value);
@@ -1196,9 +1352,10 @@ session_lookup_connection6 (u32 fib_index, ip6_address_t * lcl,
  *
  * Typically used by dgram connections
  */
-stream_session_t *
-session_lookup_safe6 (u32 fib_index, ip6_address_t * lcl, ip6_address_t * rmt,
-		      u16 lcl_port, u16 rmt_port, u8 proto)
+static stream_session_t *
+session_lookup_safe6_i (u32 fib_index, ip6_address_t * lcl,
+			ip6_address_t * rmt, u16 lcl_port, u16 rmt_port,
+			u8 proto, u8 all_shards)
 {
   session_table_t *st;
   session_kv6_t kv6;
@@ -1211,7 +1368,7 @@ session_lookup_safe6 (u32 fib_index, ip6_address_t * lcl, ip6_address_t * rmt,
     return 0;
 
   make_v6_ss_kv (&kv6, lcl, rmt, lcl_port, rmt_port, proto);
-  rv = clib_bihash_search_inline_48_8 (&st->v6_session_hash, &kv6);
+  rv = session_lookup_established6 (st, &kv6, all_shards);
   if (rv == 0)
     return session_get_from_handle_safe (kv6.value);
 
@@ -1232,6 +1389,31 @@ session_lookup_safe6 (u32 fib_index, ip6_address_t * lcl, ip6_address_t * rmt,
   return 0;
 }
 
+/**
+ * Data path lookup. Established sessions are only searched for in the
+ * caller's shard and in the shared hash.
+ */
+stream_session_t *
+session_lookup_safe6 (u32 fib_index, ip6_address_t * lcl, ip6_address_t * rmt,
+		      u16 lcl_port, u16 rmt_port, u8 proto)
+{
+  return session_lookup_safe6_i (fib_index, lcl, rmt, lcl_port, rmt_port,
+				 proto, 0 /* all_shards */ );
+}
+
+/**
+ * Slow path lookup, e.g., for the cli. Established sessions are searched for
+ * in all threads' shards.
+ */
+stream_session_t *
+session_lookup_safe_any6 (u32 fib_index, ip6_address_t * lcl,
+			  ip6_address_t * rmt, u16 lcl_port, u16 rmt_port,
+			  u8 proto)
+{
+  return session_lookup_safe6_i (fib_index, lcl, rmt, lcl_port, rmt_port,
+				 proto, 1 /* all_shards */ );
+}
+
 clib_error_t *
 vnet_session_rule_add_del (session_rule_add_del_args_t * args)
 {
@@ -1349,6 +1531,8 @@ session_lookup_show_table_entries (vlib_main_t * vm, session_table_t * table,
     .vm = vm,
     .is_local = is_local,
   };
+  u32 i;
+
   if (!is_local)
     vlib_cli_output (vm, "%-40s%-30s", "Session", "Application");
   else
@@ -1359,6 +1543,9 @@ session_lookup_show_table_entries (vlib_main_t * vm, session_table_t * table,
     case 0:
       ip4_session_table_walk (&table->v4_session_hash, ip4_session_table_show,
 			      &ctx);
+      for (i = 0; i < vec_len (table->v4_session_shards); i++)
+	ip4_session_table_walk (&table->v4_session_shards[i],
+				ip4_session_table_show, &ctx);
       break;
     default:
       clib_warning ("not supported");
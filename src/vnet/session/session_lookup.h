@@ -27,6 +27,14 @@ stream_session_t *session_lookup_safe4 (u32 fib_index, ip4_address_t * lcl,
 stream_session_t *session_lookup_safe6 (u32 fib_index, ip6_address_t * lcl,
 					ip6_address_t * rmt, u16 lcl_port,
 					u16 rmt_port, u8 proto);
+stream_session_t *session_lookup_safe_any4 (u32 fib_index,
+					    ip4_address_t * lcl,
+					    ip4_address_t * rmt, u16 lcl_port,
+					    u16 rmt_port, u8 proto);
+stream_session_t *session_lookup_safe_any6 (u32 fib_index,
+					    ip6_address_t * lcl,
+					    ip6_address_t * rmt, u16 lcl_port,
+					    u16 rmt_port, u8 proto);
 transport_connection_t *session_lookup_connection_wt4 (u32 fib_index,
 						       ip4_address_t * lcl,
 						       ip4_address_t * rmt,
@@ -61,6 +69,8 @@ stream_session_t *session_lookup_listener (u32 table_index,
 					   session_endpoint_t * sep);
 int session_lookup_add_connection (transport_connection_t * tc, u64 value);
 int session_lookup_del_connection (transport_connection_t * tc);
+int session_lookup_add_listener (transport_connection_t * tc, u64 value);
+int session_lookup_del_listener (transport_connection_t * tc);
 u64 session_lookup_endpoint_listener (u32 table_index,
 				      session_endpoint_t * sepi,
 				      u8 use_rules);
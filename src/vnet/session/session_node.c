@@ -520,6 +520,10 @@ session_tx_fifo_read_and_snd_i (vlib_main_t * vm, vlib_node_runtime_t * node,
 	if (svm_fifo_set_event (s->server_tx_fifo))
 	  vec_add1 (smm->pending_event_vector[thread_index], *e);
     }
+
+  if (!peek_data
+      && PREDICT_FALSE (svm_fifo_want_tx_evt (s->server_tx_fifo)))
+    session_dequeue_notify (s);
   return 0;
 }
 
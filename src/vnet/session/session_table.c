@@ -58,7 +58,33 @@ session_table_get (u32 table_index)
   _(v4,halfopen,buckets,20000)                  \
   _(v4,halfopen,memory,(64<<20))                \
   _(v6,halfopen,buckets,20000)                  \
-  _(v6,halfopen,memory,(64<<20))
+  _(v6,halfopen,memory,(64<<20))                \
+  _(v4,listener,buckets,1024)                   \
+  _(v4,listener,memory,(8<<20))                 \
+  _(v6,listener,buckets,1024)                   \
+  _(v6,listener,memory,(8<<20))
+
+/**
+ * Buckets per established session shard. With workers, the main thread
+ * only owns the sessions of its own (rare) flows, so the configured
+ * buckets are split among the workers.
+ */
+static u32
+session_table_shard_buckets (u32 configured_buckets, u32 n_shards)
+{
+  u32 n_workers = n_shards > 1 ? n_shards - 1 : 1;
+  return clib_max (configured_buckets / n_workers, 1024);
+}
+
+/**
+ * Memory per established session shard, split like the buckets.
+ */
+static u32
+session_table_shard_memory (u32 configured_memory, u32 n_shards)
+{
+  u32 n_workers = n_shards > 1 ? n_shards - 1 : 1;
+  return clib_max (configured_memory / n_workers, 8 << 20);
+}
 
 /**
  * Initialize session table hash tables
@@ -70,6 +96,7 @@ void
 session_table_init (session_table_t * slt, u8 fib_proto)
 {
   u8 all = fib_proto > FIB_PROTOCOL_IP6 ? 1 : 0;
+  u32 n_shards = vec_len (session_manager_main.sessions);
   int i;
 
 #define _(af,table,parm,value) 						\
@@ -84,24 +111,55 @@ session_table_init (session_table_t * slt, u8 fib_proto)
   foreach_hash_table_parameter;
 #undef _
 
+  /*
+   * With shards, the shared hash only holds listeners, proxy/local
+   * endpoints and the dgram sessions not yet owned by a thread. Local
+   * tables have no shards, so their shared hash holds all sessions.
+   */
   if (fib_proto == FIB_PROTOCOL_IP4 || all)
     {
       clib_bihash_init_16_8 (&slt->v4_session_hash, "v4 session table",
-			     configured_v4_session_table_buckets,
-			     configured_v4_session_table_memory);
+			     all ? configured_v4_session_table_buckets :
+			     configured_v4_listener_table_buckets,
+			     all ? configured_v4_session_table_memory :
+			     configured_v4_listener_table_memory);
       clib_bihash_init_16_8 (&slt->v4_half_open_hash, "v4 half-open table",
 			     configured_v4_halfopen_table_buckets,
 			     configured_v4_halfopen_table_memory);
     }
+  if (fib_proto == FIB_PROTOCOL_IP4 && n_shards)
+    {
+      vec_validate (slt->v4_session_shards, n_shards - 1);
+      for (i = 0; i < n_shards; i++)
+	clib_bihash_init_16_8 (&slt->v4_session_shards[i],
+			       "v4 session shard",
+			       session_table_shard_buckets
+			       (configured_v4_session_table_buckets, n_shards),
+			       session_table_shard_memory
+			       (configured_v4_session_table_memory, n_shards));
+    }
   if (fib_proto == FIB_PROTOCOL_IP6 || all)
     {
       clib_bihash_init_48_8 (&slt->v6_session_hash, "v6 session table",
-			     configured_v6_session_table_buckets,
-			     configured_v6_session_table_memory);
+			     all ? configured_v6_session_table_buckets :
+			     configured_v6_listener_table_buckets,
+			     all ? configured_v6_session_table_memory :
+			     configured_v6_listener_table_memory);
       clib_bihash_init_48_8 (&slt->v6_half_open_hash, "v6 half-open table",
 			     configured_v6_halfopen_table_buckets,
 			     configured_v6_halfopen_table_memory);
     }
+  if (fib_proto == FIB_PROTOCOL_IP6 && n_shards)
+    {
+      vec_validate (slt->v6_session_shards, n_shards - 1);
+      for (i = 0; i < n_shards; i++)
+	clib_bihash_init_48_8 (&slt->v6_session_shards[i],
+			       "v6 session shard",
+			       session_table_shard_buckets
+			       (configured_v6_session_table_buckets, n_shards),
+			       session_table_shard_memory
+			       (configured_v6_session_table_memory, n_shards));
+    }
 
   for (i = 0; i < TRANSPORT_N_PROTO; i++)
     session_rules_table_init (&slt->session_rules[i]);
@@ -23,11 +23,21 @@
 typedef struct _session_lookup_table
 {
   /**
-   * Lookup tables for established sessions and listeners
+   * Lookup tables for listeners, proxy/local endpoints and the dgram
+   * sessions that are not yet owned by a thread
    */
   clib_bihash_16_8_t v4_session_hash;
   clib_bihash_48_8_t v6_session_hash;
 
+  /**
+   * Per thread lookup tables for established sessions. Sessions are only
+   * added to the shard of the thread that owns them so, with rss steering
+   * flows to their owners, workers neither contend on a bihash writer lock
+   * nor share buckets on the fast path. Not allocated for local tables.
+   */
+  clib_bihash_16_8_t *v4_session_shards;
+  clib_bihash_48_8_t *v6_session_shards;
+
   /**
    * Lookup tables for half-open sessions
    */
@@ -71,6 +81,20 @@ session_table_t *session_table_get (u32 table_index);
 u32 session_table_index (session_table_t * slt);
 void session_table_init (session_table_t * slt, u8 fib_proto);
 
+static inline clib_bihash_16_8_t *
+session_table_v4_shard (session_table_t * st, u32 thread_index)
+{
+  ASSERT (thread_index < vec_len (st->v4_session_shards));
+  return &st->v4_session_shards[thread_index];
+}
+
+static inline clib_bihash_48_8_t *
+session_table_v6_shard (session_table_t * st, u32 thread_index)
+{
+  ASSERT (thread_index < vec_len (st->v6_session_shards));
+  return &st->v6_session_shards[thread_index];
+}
+
 /* Internal, try not to use it! */
 session_table_t *_get_session_tables ();
 
@@ -39,10 +39,12 @@
     }								\
 }
 
+static u32 dummy_reset;
+
 void
 dummy_session_reset_callback (stream_session_t * s)
 {
-  clib_warning ("called...");
+  dummy_reset = 1;
 }
 
 int
@@ -1491,6 +1493,114 @@ session_test_proxy (vlib_main_t * vm, unformat_input_t * input)
   return 0;
 }
 
+static int
+session_test_splice (vlib_main_t * vm, unformat_input_t * input)
+{
+  u64 options[APP_OPTIONS_N_OPTIONS];
+  stream_session_t *s, *peer;
+  svm_fifo_t *rx_fifo, *tx_fifo;
+  clib_error_t *error = 0;
+  segment_manager_t *sm;
+  application_t *app;
+  u32 app_index;
+  int rv;
+
+  memset (options, 0, sizeof (options));
+  options[APP_OPTIONS_FLAGS] = APP_OPTIONS_FLAGS_IS_BUILTIN;
+  options[APP_OPTIONS_FLAGS] |= APP_OPTIONS_FLAGS_USE_GLOBAL_SCOPE;
+  vnet_app_attach_args_t attach_args = {
+    .api_client_index = ~0,
+    .options = options,
+    .namespace_id = 0,
+    .session_cb_vft = &dummy_session_cbs,
+    .name = format (0, "session_test"),
+  };
+
+  error = vnet_application_attach (&attach_args);
+  SESSION_TEST ((error == 0), "app attached");
+  app_index = attach_args.app_index;
+  vec_free (attach_args.name);
+  app = application_get (app_index);
+  SESSION_TEST ((application_alloc_connects_segment_manager (app) == 0),
+		"connects segment manager should be allocated");
+  sm = application_get_connect_segment_manager (app);
+
+  s = session_alloc (0);
+  s->app_index = app_index;
+  SESSION_TEST ((session_alloc_fifos (sm, s) == 0), "owner fifos");
+  peer = session_alloc (0);
+  peer->app_index = app_index;
+  SESSION_TEST ((session_alloc_fifos (sm, peer) == 0), "peer fifos");
+  rx_fifo = s->server_rx_fifo;
+  tx_fifo = s->server_tx_fifo;
+
+  /*
+   * Splice and let the owner's half run
+   */
+  rv = session_splice (s, peer);
+  SESSION_TEST ((rv == 0), "splice should work");
+  SESSION_TEST ((peer->splice_role == SESSION_SPLICE_PEER),
+		"peer's half should be done right away");
+  SESSION_TEST ((peer->server_rx_fifo == tx_fifo
+		 && peer->server_tx_fifo == rx_fifo),
+		"peer should use the owner's fifos crosswise");
+  SESSION_TEST ((rx_fifo->refcnt == 2 && tx_fifo->refcnt == 2),
+		"peer should hold references to the owner's fifos");
+  SESSION_TEST ((session_splice (s, peer) != 0),
+		"second splice should not work");
+
+  vlib_process_suspend (vm, 10e-3);
+  SESSION_TEST ((s->splice_role == SESSION_SPLICE_OWNER),
+		"owner's half should be done by the rpc");
+  SESSION_TEST ((rx_fifo->master_session_index == peer->session_index),
+		"owner's rx fifo should be dequeued by the peer");
+
+  stream_session_unsplice (s);
+  session_free (s);
+  SESSION_TEST ((rx_fifo->refcnt == 1 && tx_fifo->refcnt == 1),
+		"owner's references should be dropped");
+  SESSION_TEST ((tx_fifo->master_session_index == INVALID_INDEX),
+		"peer should stop sending events to the owner");
+  stream_session_unsplice (peer);
+  session_free (peer);
+
+  /*
+   * Close the owner before its half runs
+   */
+  s = session_alloc (0);
+  s->app_index = app_index;
+  SESSION_TEST ((session_alloc_fifos (sm, s) == 0), "owner fifos");
+  peer = session_alloc (0);
+  peer->app_index = app_index;
+  SESSION_TEST ((session_alloc_fifos (sm, peer) == 0), "peer fifos");
+  rx_fifo = s->server_rx_fifo;
+  tx_fifo = s->server_tx_fifo;
+
+  rv = session_splice (s, peer);
+  SESSION_TEST ((rv == 0), "splice should work");
+  segment_manager_dealloc_fifos (s->svm_segment_index, s->server_rx_fifo,
+				 s->server_tx_fifo);
+  session_free (s);
+  SESSION_TEST ((rx_fifo->refcnt == 1 && tx_fifo->refcnt == 1),
+		"peer should hold the last references");
+
+  dummy_reset = 0;
+  vlib_process_suspend (vm, 10e-3);
+  SESSION_TEST ((dummy_reset == 1), "peer should be reset");
+  SESSION_TEST ((rx_fifo->master_session_index == INVALID_INDEX
+		 && tx_fifo->master_session_index == INVALID_INDEX),
+		"peer should not send events to the stale owner");
+
+  stream_session_unsplice (peer);
+  session_free (peer);
+
+  vnet_app_detach_args_t detach_args = {
+    .app_index = app_index,
+  };
+  vnet_application_detach (&detach_args);
+  return 0;
+}
+
 static clib_error_t *
 session_test (vlib_main_t * vm,
 	      unformat_input_t * input, vlib_cli_command_t * cmd_arg)
@@ -1511,6 +1621,8 @@ session_test (vlib_main_t * vm,
 	res = session_test_rules (vm, input);
       else if (unformat (input, "proxy"))
 	res = session_test_proxy (vm, input);
+      else if (unformat (input, "splice"))
+	res = session_test_splice (vm, input);
       else if (unformat (input, "all"))
 	{
 	  if ((res = session_test_basic (vm, input)))
@@ -1523,6 +1635,8 @@ session_test (vlib_main_t * vm,
 	    goto done;
 	  if ((res = session_test_proxy (vm, input)))
 	    goto done;
+	  if ((res = session_test_splice (vm, input)))
+	    goto done;
 	}
       else
 	break;
@@ -37,6 +37,16 @@ typedef enum
   SESSION_STATE_N_STATES,
 } stream_session_state_t;
 
+/*
+ * Session splice roles
+ */
+typedef enum
+{
+  SESSION_SPLICE_NONE,
+  SESSION_SPLICE_OWNER,		/**< owns the fifos shared by the splice */
+  SESSION_SPLICE_PEER,		/**< uses the owner's fifos crosswise */
+} session_splice_role_t;
+
 typedef struct generic_session_
 {
   svm_fifo_t *rx_fifo;		/**< rx fifo */
@@ -69,6 +79,9 @@ typedef struct _stream_session_t
   /** To avoid n**2 "one event per frame" check */
   u8 enqueue_epoch;
 
+  /** Role in a splice, if any. See @ref session_splice */
+  u8 splice_role;
+
   /** svm segment index where fifos were allocated */
   u32 svm_segment_index;
 
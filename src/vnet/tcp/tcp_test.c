@@ -1426,6 +1426,108 @@ tcp_test_fifo5 (vlib_main_t * vm, unformat_input_t * input)
   return 0;
 }
 
+static int
+tcp_test_fifo6 (vlib_main_t * vm, unformat_input_t * input)
+{
+  svm_fifo_t *f;
+  svm_fifo_chunk_t *c, *collected;
+  u32 fifo_size = 4096, chunk_size = 8192, j = 0;
+  u8 *test_data = 0, *data_buf = 0;
+  int i, rv, verbose = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "verbose"))
+	verbose = 1;
+      else
+	{
+	  clib_error_t *e = clib_error_return
+	    (0, "unknown input `%U'", format_unformat_error, input);
+	  clib_error_report (e);
+	  return -1;
+	}
+    }
+
+  f = fifo_prepare (fifo_size);
+  c = clib_mem_alloc_aligned (sizeof (*c) + chunk_size,
+			      CLIB_CACHE_LINE_BYTES);
+  c->length = chunk_size;
+
+  vec_validate (test_data, fifo_size + chunk_size - 1);
+  for (i = 0; i < vec_len (test_data); i++)
+    test_data[i] = i;
+  vec_validate (data_buf, vec_len (test_data) - 1);
+
+  /*
+   * Grow fifo while data does not wrap
+   */
+  rv = svm_fifo_enqueue_nowait (f, 1000, test_data);
+  TCP_TEST ((rv == 1000), "enqueued %d expected %u", rv, 1000);
+  rv = svm_fifo_add_chunk (f, c);
+  TCP_TEST ((rv == 0), "add chunk returned %d", rv);
+  TCP_TEST ((f->nitems == fifo_size + chunk_size), "nitems %u expected %u",
+	    f->nitems, fifo_size + chunk_size);
+
+  /* Enqueue across inline data and chunk boundary */
+  rv = svm_fifo_enqueue_nowait (f, 10000, test_data + 1000);
+  TCP_TEST ((rv == 10000), "enqueued %d expected %u", rv, 10000);
+  TCP_TEST ((svm_fifo_max_read_chunk (f) == fifo_size),
+	    "max read chunk %u expected %u", svm_fifo_max_read_chunk (f),
+	    fifo_size);
+  if (verbose)
+    vlib_cli_output (vm, "fifo after grow: %U", format_svm_fifo, f, 1);
+
+  rv = svm_fifo_peek (f, 4000, 200, data_buf);
+  TCP_TEST ((rv == 200), "peeked %d expected %u", rv, 200);
+  rv = compare_data (data_buf, test_data + 4000, 0, 200, &j);
+  TCP_TEST ((rv == 0), "[%d] peeked %u expected %u", j, data_buf[j],
+	    test_data[4000 + j]);
+
+  rv = svm_fifo_dequeue_nowait (f, 11000, data_buf);
+  TCP_TEST ((rv == 11000), "dequeued %d expected %u", rv, 11000);
+  rv = compare_data (data_buf, test_data, 0, 11000, &j);
+  TCP_TEST ((rv == 0), "[%d] dequeued %u expected %u", j, data_buf[j],
+	    test_data[j]);
+
+  /*
+   * Can't shrink with tail outside of inline data
+   */
+  collected = svm_fifo_collect_chunks (f);
+  TCP_TEST ((collected == 0), "collect with tail %u should fail", f->tail);
+
+  /* Wrap tail and drain */
+  rv = svm_fifo_enqueue_nowait (f, f->nitems - f->tail, test_data);
+  TCP_TEST ((f->tail == 0), "tail %u expected 0", f->tail);
+  svm_fifo_dequeue_drop (f, rv);
+
+  collected = svm_fifo_collect_chunks (f);
+  TCP_TEST ((collected == c), "collect returned %p expected %p",
+	    collected, c);
+  TCP_TEST ((f->nitems == fifo_size), "nitems %u expected %u", f->nitems,
+	    fifo_size);
+
+  /*
+   * Can't grow if data wraps
+   */
+  svm_fifo_enqueue_nowait (f, 3000, test_data);
+  svm_fifo_dequeue_drop (f, 3000);
+  svm_fifo_enqueue_nowait (f, 2000, test_data);
+  TCP_TEST ((f->tail < f->head), "tail %u head %u", f->tail, f->head);
+  rv = svm_fifo_add_chunk (f, c);
+  TCP_TEST ((rv != 0), "add chunk to wrapped fifo returned %d", rv);
+
+  rv = svm_fifo_dequeue_nowait (f, 2000, data_buf);
+  rv = compare_data (data_buf, test_data, 0, 2000, &j);
+  TCP_TEST ((rv == 0), "[%d] dequeued %u expected %u", j, data_buf[j],
+	    test_data[j]);
+
+  clib_mem_free (c);
+  svm_fifo_free (f);
+  vec_free (test_data);
+  vec_free (data_buf);
+  return 0;
+}
+
 /* *INDENT-OFF* */
 svm_fifo_trace_elem_t fifo_trace[] = {};
 /* *INDENT-ON* */
@@ -1518,6 +1620,10 @@ tcp_test_fifo (vlib_main_t * vm, unformat_input_t * input)
       res = tcp_test_fifo5 (vm, input);
       if (res)
 	return res;
+
+      res = tcp_test_fifo6 (vm, input);
+      if (res)
+	return res;
     }
   else
     {
@@ -1541,6 +1647,10 @@ tcp_test_fifo (vlib_main_t * vm, unformat_input_t * input)
 	{
 	  res = tcp_test_fifo5 (vm, input);
 	}
+      else if (unformat (input, "fifo6"))
+	{
+	  res = tcp_test_fifo6 (vm, input);
+	}
       else if (unformat (input, "replay"))
 	{
 	  res = tcp_test_fifo_replay (vm, input);
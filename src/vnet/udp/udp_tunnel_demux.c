@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/udp/udp_tunnel_demux.h>
+
+void
+udp_tunnel_demux_init (udp_tunnel_demux_t * d, char *name)
+{
+  u8 *s;
+
+  /* the tables keep the name vectors, udp_tunnel_demux_free frees them */
+  s = format (0, "%s ip4 tunnels%c", name, 0);
+  clib_bihash_init_8_8 (&d->tunnel4_by_key, (char *) s,
+			UDP_TUNNEL_DEMUX_NUM_BUCKETS,
+			UDP_TUNNEL_DEMUX_MEMORY_SIZE);
+
+  s = format (0, "%s ip6 tunnels%c", name, 0);
+  clib_bihash_init_24_8 (&d->tunnel6_by_key, (char *) s,
+			 UDP_TUNNEL_DEMUX_NUM_BUCKETS,
+			 UDP_TUNNEL_DEMUX_MEMORY_SIZE);
+}
+
+void
+udp_tunnel_demux_free (udp_tunnel_demux_t * d)
+{
+  vec_free (d->tunnel4_by_key.name);
+  vec_free (d->tunnel6_by_key.name);
+  clib_bihash_free_8_8 (&d->tunnel4_by_key);
+  clib_bihash_free_24_8 (&d->tunnel6_by_key);
+}
+
+/**
+ * Add or delete an ip4 tunnel.
+ * Returns 0 on success, -1 if the key to delete does not exist.
+ */
+int
+udp_tunnel_demux_add_del4 (udp_tunnel_demux_t * d, u32 src, u32 id,
+			   u32 tunnel_index, int is_add)
+{
+  clib_bihash_kv_8_8_t kv;
+
+  kv.key = udp_tunnel_demux_key4 (src, id);
+  kv.value = tunnel_index;
+  return clib_bihash_add_del_8_8 (&d->tunnel4_by_key, &kv, is_add);
+}
+
+/**
+ * Add or delete an ip6 tunnel.
+ * Returns 0 on success, -1 if the key to delete does not exist.
+ */
+int
+udp_tunnel_demux_add_del6 (udp_tunnel_demux_t * d, const ip6_address_t * src,
+			   u32 id, u32 tunnel_index, int is_add)
+{
+  clib_bihash_kv_24_8_t kv;
+
+  udp_tunnel_demux_key6 (&kv, src, id);
+  kv.value = tunnel_index;
+  return clib_bihash_add_del_24_8 (&d->tunnel6_by_key, &kv, is_add);
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
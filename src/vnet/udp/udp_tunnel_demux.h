@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * @brief Tunnel lookup shared by the UDP tunnel decap nodes.
+ *
+ * VXLAN, Geneve and GTP-U all find the receiving tunnel from the outer
+ * source address and a 32 bit tunnel id (VNI or TEID) taken from the
+ * packet. The tunnels are kept in one bihash per address family, and the
+ * decap nodes look up all the packets of a frame in one go so the hash,
+ * bucket and key/value fetches of consecutive packets overlap instead of
+ * each packet stalling on its own cache misses.
+ *
+ * VXLAN-GPE tunnels are also keyed on their local address. Its decap
+ * checks that address on the tunnel found here and falls back to its own
+ * full key hash when it differs.
+ */
+
+#ifndef included_udp_tunnel_demux_h
+#define included_udp_tunnel_demux_h
+
+#include <vnet/ip/ip.h>
+#include <vnet/udp/udp_packet.h>
+#include <vppinfra/bihash_24_8.h>
+#include <vppinfra/bihash_8_8.h>
+
+typedef struct
+{
+  /* keyed on ip4 src address + tunnel id */
+  clib_bihash_8_8_t tunnel4_by_key;
+
+  /* keyed on ip6 src address + tunnel id */
+  clib_bihash_24_8_t tunnel6_by_key;
+} udp_tunnel_demux_t;
+
+#define UDP_TUNNEL_DEMUX_NUM_BUCKETS (16 * 1024)
+#define UDP_TUNNEL_DEMUX_MEMORY_SIZE (16 << 20)
+
+/* Lookahead, in packets, of the bucket and key/value prefetches */
+#define UDP_TUNNEL_DEMUX_BUCKET_STRIDE 8
+#define UDP_TUNNEL_DEMUX_DATA_STRIDE 4
+
+/* Both the address and the id are in network byte order */
+always_inline u64
+udp_tunnel_demux_key4 (u32 src, u32 id)
+{
+  return ((u64) id << 32) | src;
+}
+
+always_inline void
+udp_tunnel_demux_key6 (clib_bihash_kv_24_8_t * kv,
+		       const ip6_address_t * src, u32 id)
+{
+  kv->key[0] = src->as_u64[0];
+  kv->key[1] = src->as_u64[1];
+  kv->key[2] = id;
+}
+
+void udp_tunnel_demux_init (udp_tunnel_demux_t * d, char *name);
+void udp_tunnel_demux_free (udp_tunnel_demux_t * d);
+int udp_tunnel_demux_add_del4 (udp_tunnel_demux_t * d, u32 src, u32 id,
+			       u32 tunnel_index, int is_add);
+int udp_tunnel_demux_add_del6 (udp_tunnel_demux_t * d,
+			       const ip6_address_t * src, u32 id,
+			       u32 tunnel_index, int is_add);
+
+/** Find one ip4 tunnel, returns the tunnel index or ~0 */
+always_inline u32
+udp_tunnel_demux_find4 (udp_tunnel_demux_t * d, u32 src, u32 id)
+{
+  clib_bihash_kv_8_8_t kv;
+
+  kv.key = udp_tunnel_demux_key4 (src, id);
+  if (clib_bihash_search_inline_8_8 (&d->tunnel4_by_key, &kv))
+    return ~0;
+  return kv.value;
+}
+
+/** Find one ip6 tunnel, returns the tunnel index or ~0 */
+always_inline u32
+udp_tunnel_demux_find6 (udp_tunnel_demux_t * d, const ip6_address_t * src,
+			u32 id)
+{
+  clib_bihash_kv_24_8_t kv;
+
+  udp_tunnel_demux_key6 (&kv, src, id);
+  if (clib_bihash_search_inline_24_8 (&d->tunnel6_by_key, &kv))
+    return ~0;
+  return kv.value;
+}
+
+/**
+ * @brief Look up n ip4 keys, storing the tunnel index or ~0 for each.
+ *
+ * The bucket of packet i + 8 and the key/value page of packet i + 4 are
+ * prefetched while packet i is searched. A key equal to the previous one
+ * reuses its result, which keeps the single tunnel case as cheap as the
+ * one entry cache it replaces.
+ */
+static_always_inline void
+udp_tunnel_demux_lookup4 (udp_tunnel_demux_t * d, const u64 * keys,
+			  u32 * indices, u32 n)
+{
+  clib_bihash_8_8_t *h = &d->tunnel4_by_key;
+  clib_bihash_kv_8_8_t kv;
+  u64 hashes[n];
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    {
+      kv.key = keys[i];
+      hashes[i] = clib_bihash_hash_8_8 (&kv);
+    }
+
+  for (i = 0; i < clib_min (n, UDP_TUNNEL_DEMUX_BUCKET_STRIDE); i++)
+    clib_bihash_prefetch_bucket_8_8 (h, hashes[i]);
+  for (i = 0; i < clib_min (n, UDP_TUNNEL_DEMUX_DATA_STRIDE); i++)
+    clib_bihash_prefetch_data_8_8 (h, hashes[i]);
+
+  for (i = 0; i < n; i++)
+    {
+      if (i + UDP_TUNNEL_DEMUX_BUCKET_STRIDE < n)
+	clib_bihash_prefetch_bucket_8_8
+	  (h, hashes[i + UDP_TUNNEL_DEMUX_BUCKET_STRIDE]);
+      if (i + UDP_TUNNEL_DEMUX_DATA_STRIDE < n)
+	clib_bihash_prefetch_data_8_8
+	  (h, hashes[i + UDP_TUNNEL_DEMUX_DATA_STRIDE]);
+
+      if (i && keys[i] == keys[i - 1])
+	{
+	  indices[i] = indices[i - 1];
+	  continue;
+	}
+
+      kv.key = keys[i];
+      if (clib_bihash_search_inline_with_hash_8_8 (h, hashes[i], &kv))
+	indices[i] = ~0;
+      else
+	indices[i] = kv.value;
+    }
+}
+
+/** @brief Look up n ip6 keys, see udp_tunnel_demux_lookup4 */
+static_always_inline void
+udp_tunnel_demux_lookup6 (udp_tunnel_demux_t * d,
+			  clib_bihash_kv_24_8_t * kvs, u32 * indices, u32 n)
+{
+  clib_bihash_24_8_t *h = &d->tunnel6_by_key;
+  u64 hashes[n];
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    hashes[i] = clib_bihash_hash_24_8 (&kvs[i]);
+
+  for (i = 0; i < clib_min (n, UDP_TUNNEL_DEMUX_BUCKET_STRIDE); i++)
+    clib_bihash_prefetch_bucket_24_8 (h, hashes[i]);
+  for (i = 0; i < clib_min (n, UDP_TUNNEL_DEMUX_DATA_STRIDE); i++)
+    clib_bihash_prefetch_data_24_8 (h, hashes[i]);
+
+  for (i = 0; i < n; i++)
+    {
+      if (i + UDP_TUNNEL_DEMUX_BUCKET_STRIDE < n)
+	clib_bihash_prefetch_bucket_24_8
+	  (h, hashes[i + UDP_TUNNEL_DEMUX_BUCKET_STRIDE]);
+      if (i + UDP_TUNNEL_DEMUX_DATA_STRIDE < n)
+	clib_bihash_prefetch_data_24_8
+	  (h, hashes[i + UDP_TUNNEL_DEMUX_DATA_STRIDE]);
+
+      if (i && hashes[i] == hashes[i - 1] &&
+	  kvs[i].key[0] == kvs[i - 1].key[0] &&
+	  kvs[i].key[1] == kvs[i - 1].key[1] &&
+	  kvs[i].key[2] == kvs[i - 1].key[2])
+	{
+	  indices[i] = indices[i - 1];
+	  continue;
+	}
+
+      /* the search overwrites the value only */
+      if (clib_bihash_search_inline_with_hash_24_8 (h, hashes[i], &kvs[i]))
+	indices[i] = ~0;
+      else
+	indices[i] = kvs[i].value;
+    }
+}
+
+/** Tunnel id, in network byte order, from the tunnel header */
+typedef u32 (udp_tunnel_demux_get_id_t) (void *tunnel_header);
+
+static_always_inline void *
+udp_tunnel_demux_buffer_header (vlib_main_t * vm, u32 * from, u32 i, u32 n)
+{
+  if (i + 4 < n)
+    {
+      vlib_buffer_t *p4 = vlib_get_buffer (vm, from[i + 4]);
+      vlib_prefetch_buffer_header (p4, LOAD);
+      CLIB_PREFETCH (p4->data, 2 * CLIB_CACHE_LINE_BYTES, LOAD);
+    }
+  return vlib_buffer_get_current (vlib_get_buffer (vm, from[i]));
+}
+
+/**
+ * @brief Look up the tunnels of n received packets before processing them
+ *
+ * current_data of the buffers points at the tunnel header, right after the
+ * outer ip and udp headers. get_id extracts the tunnel id from the tunnel
+ * header, is_ip4 selects the outer address family and so the table.
+ */
+static_always_inline void
+udp_tunnel_demux_lookup_buffers (vlib_main_t * vm, udp_tunnel_demux_t * d,
+				 u32 * from, u32 n, u32 * indices,
+				 int is_ip4, udp_tunnel_demux_get_id_t * get_id)
+{
+  void *h;
+  u32 i;
+
+  if (is_ip4)
+    {
+      ip4_header_t *ip4;
+      u64 keys[n];
+
+      for (i = 0; i < n; i++)
+	{
+	  h = udp_tunnel_demux_buffer_header (vm, from, i, n);
+	  ip4 = h - sizeof (udp_header_t) - sizeof (ip4_header_t);
+	  keys[i] = udp_tunnel_demux_key4 (ip4->src_address.as_u32,
+					   get_id (h));
+	}
+      udp_tunnel_demux_lookup4 (d, keys, indices, n);
+    }
+  else
+    {
+      ip6_header_t *ip6;
+      clib_bihash_kv_24_8_t kvs[n];
+
+      for (i = 0; i < n; i++)
+	{
+	  h = udp_tunnel_demux_buffer_header (vm, from, i, n);
+	  ip6 = h - sizeof (udp_header_t) - sizeof (ip6_header_t);
+	  udp_tunnel_demux_key6 (&kvs[i], &ip6->src_address, get_id (h));
+	}
+      udp_tunnel_demux_lookup6 (d, kvs, indices, n);
+    }
+}
+
+#endif /* included_udp_tunnel_demux_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * @brief Header rewrite shared by the UDP tunnel encap nodes.
+ *
+ * VXLAN, Geneve and GTP-U tunnels keep their outer ip/udp/tunnel header
+ * as a vnet_rewrite, right aligned in VLIB_BUFFER_PRE_DATA_SIZE bytes.
+ * That lets the encap nodes stamp it onto a packet with a few whole
+ * vector stores that end where the packet starts; the bytes written in
+ * front of the new header land in the buffer headroom.
+ *
+ * The per packet fields - lengths, ip4 checksum and udp source port -
+ * are then fixed up for the whole frame in one pass.
+ */
+
+#ifndef included_udp_tunnel_encap_h
+#define included_udp_tunnel_encap_h
+
+#include <vnet/ip/ip.h>
+#include <vnet/udp/udp_packet.h>
+#include <vnet/adj/rewrite.h>
+
+static_always_inline void
+udp_tunnel_encap_copy64 (u8 * dst, u8 * src)
+{
+#if defined (CLIB_HAVE_VEC512)
+  u8x64_store_unaligned (u8x64_load_unaligned (src), dst);
+#elif defined (CLIB_HAVE_VEC256)
+  u8x32_store_unaligned (u8x32_load_unaligned (src), dst);
+  u8x32_store_unaligned (u8x32_load_unaligned (src + 32), dst + 32);
+#elif defined (CLIB_HAVE_VEC128) && \
+  defined (CLIB_HAVE_VEC128_UNALIGNED_LOAD_STORE)
+  u8x16_store_unaligned (u8x16_load_unaligned (src), dst);
+  u8x16_store_unaligned (u8x16_load_unaligned (src + 16), dst + 16);
+  u8x16_store_unaligned (u8x16_load_unaligned (src + 32), dst + 32);
+  u8x16_store_unaligned (u8x16_load_unaligned (src + 48), dst + 48);
+#else
+  clib_memcpy (dst, src, 64);
+#endif
+}
+
+/**
+ * @brief Prepend the rewrite to the packet and make it current.
+ *
+ * Headers of up to 64 bytes take one 64 byte copy, longer ones two.
+ * The copy reads from the start of the rewrite struct at most, so the
+ * rewrite must be declared with vnet_declare_rewrite
+ * (VLIB_BUFFER_PRE_DATA_SIZE). Packets which do not leave enough
+ * headroom in front of the new header are copied byte exact.
+ */
+static_always_inline void
+udp_tunnel_encap_stamp_inline (vlib_buffer_t * b, vnet_rewrite_header_t * rw,
+			       int max_size)
+{
+  u16 len = rw->data_bytes;
+  u8 *src = rw->data + max_size;
+  u8 *dst;
+
+  ASSERT (len <= max_size);
+  ASSERT (max_size + sizeof (*rw) == VLIB_BUFFER_PRE_DATA_SIZE);
+
+  vlib_buffer_advance (b, -(word) len);
+  dst = vlib_buffer_get_current (b) + len;
+
+  if (PREDICT_TRUE (len <= 64 && b->current_data + len >=
+		    64 - VLIB_BUFFER_PRE_DATA_SIZE))
+    udp_tunnel_encap_copy64 (dst - 64, src - 64);
+  else if (PREDICT_TRUE (b->current_data + len >= 0))
+    {
+      udp_tunnel_encap_copy64 (dst - 128, src - 128);
+      udp_tunnel_encap_copy64 (dst - 64, src - 64);
+    }
+  else
+    clib_memcpy (dst - len, src - len, len);
+}
+
+#define udp_tunnel_encap_stamp(b,t)				\
+  udp_tunnel_encap_stamp_inline ((b), &(t)->rewrite_header,	\
+				 sizeof ((t)->rewrite_data))
+
+/** UDP source port entropy from the inner flow hash, in any byte order */
+always_inline u16
+udp_tunnel_encap_src_port (u32 flow_hash)
+{
+  return flow_hash ^ (flow_hash >> 16);
+}
+
+/**
+ * @brief Fix up n ip4 tunnel headers stamped by udp_tunnel_encap_stamp.
+ *
+ * Sets the ip4 and udp lengths and the udp source ports. Unless the
+ * checksum is offloaded the ip4 checksum is updated too, which relies on
+ * the rewrite's checksum having been computed with a zero length.
+ */
+static_always_inline void
+udp_tunnel_encap_fixup4 (vlib_main_t * vm, vlib_buffer_t ** b,
+			 u16 * src_ports, u32 n, int ip4_csum)
+{
+  u16 lengths[n];
+  u32 sums[n];
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    {
+      ip4_header_t *ip4 = vlib_buffer_get_current (b[i]);
+      lengths[i] = clib_host_to_net_u16 (vlib_buffer_length_in_chain (vm,
+								      b[i]));
+      sums[i] = ip4->checksum;
+    }
+
+  /* ip_csum_update of the length from 0, over the whole frame */
+  if (ip4_csum)
+    for (i = 0; i < n; i++)
+      {
+	u32 sum = sums[i] - lengths[i];
+	sum -= sum > sums[i];
+	sum = (sum & 0xffff) + (sum >> 16);
+	sums[i] = (sum & 0xffff) + (sum >> 16);
+      }
+
+  for (i = 0; i < n; i++)
+    {
+      ip4_header_t *ip4 = vlib_buffer_get_current (b[i]);
+      udp_header_t *udp = (udp_header_t *) (ip4 + 1);
+
+      ASSERT (ip4->ip_version_and_header_length == 0x45);
+      ip4->length = lengths[i];
+      if (ip4_csum)
+	ip4->checksum = sums[i];
+      udp->length = clib_host_to_net_u16
+	(clib_net_to_host_u16 (lengths[i]) - sizeof (*ip4));
+      udp->src_port = src_ports[i];
+    }
+}
+
+/**
+ * @brief Fix up n ip6 tunnel headers stamped by udp_tunnel_encap_stamp.
+ *
+ * Sets the ip6 payload and udp lengths and the udp source ports, and
+ * computes the udp checksum unless it is offloaded.
+ */
+static_always_inline void
+udp_tunnel_encap_fixup6 (vlib_main_t * vm, vlib_buffer_t ** b,
+			 u16 * src_ports, u32 n, int udp_csum)
+{
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    {
+      ip6_header_t *ip6 = vlib_buffer_get_current (b[i]);
+      udp_header_t *udp = (udp_header_t *) (ip6 + 1);
+      u16 len = vlib_buffer_length_in_chain (vm, b[i]) - sizeof (*ip6);
+
+      ip6->payload_length = udp->length = clib_host_to_net_u16 (len);
+      udp->src_port = src_ports[i];
+    }
+
+  /* IPv6 UDP checksum is mandatory */
+  if (udp_csum)
+    for (i = 0; i < n; i++)
+      {
+	ip6_header_t *ip6 = vlib_buffer_get_current (b[i]);
+	udp_header_t *udp = (udp_header_t *) (ip6 + 1);
+	int bogus = 0;
+
+	udp->checksum = ip6_tcp_udp_icmp_compute_checksum (vm, b[i], ip6,
+							   &bogus);
+	ASSERT (bogus == 0);
+	if (udp->checksum == 0)
+	  udp->checksum = 0xffff;
+      }
+}
+
+#endif /* included_udp_tunnel_encap_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -85,6 +85,73 @@ format_vxlan_gpe_with_length (u8 * s, va_list * args)
   return s;
 }
 
+/*
+ * The tunnels of all the packets in the frame are looked up before
+ * processing them, so the lookups are pipelined. The shared demux is keyed
+ * on the remote address and vni only, while a vxlan-gpe tunnel is also
+ * keyed on its local address: the demux entry points at one of the tunnels
+ * from that remote and vni, and a packet to another local address falls
+ * back to the full key.
+ */
+static_always_inline u32
+vxlan_gpe_tunnel_id (void *h)
+{
+  return ((vxlan_gpe_header_t *) h)->vni_res;
+}
+
+always_inline u32
+vxlan4_gpe_find_tunnel (vxlan_gpe_main_t * nngm, u32 tunnel_index,
+			ip4_vxlan_gpe_header_t * iuvn4_0)
+{
+  vxlan4_gpe_tunnel_key_t key4_0;
+  vxlan_gpe_tunnel_t *t0;
+  uword *p0;
+
+  /* no tunnel from that remote with that vni */
+  if (PREDICT_FALSE (tunnel_index == ~0))
+    return ~0;
+
+  t0 = pool_elt_at_index (nngm->tunnels, tunnel_index);
+  if (PREDICT_TRUE (t0->local.ip4.as_u32 ==
+		    iuvn4_0->ip4.dst_address.as_u32))
+    return tunnel_index;
+
+  key4_0.local = iuvn4_0->ip4.dst_address.as_u32;
+  key4_0.remote = iuvn4_0->ip4.src_address.as_u32;
+  key4_0.vni = iuvn4_0->vxlan.vni_res;
+  key4_0.pad = 0;
+
+  p0 = hash_get_mem (nngm->vxlan4_gpe_tunnel_by_key, &key4_0);
+  return p0 ? p0[0] : ~0;
+}
+
+always_inline u32
+vxlan6_gpe_find_tunnel (vxlan_gpe_main_t * nngm, u32 tunnel_index,
+			ip6_vxlan_gpe_header_t * iuvn6_0)
+{
+  vxlan6_gpe_tunnel_key_t key6_0;
+  vxlan_gpe_tunnel_t *t0;
+  uword *p0;
+
+  /* no tunnel from that remote with that vni */
+  if (PREDICT_FALSE (tunnel_index == ~0))
+    return ~0;
+
+  t0 = pool_elt_at_index (nngm->tunnels, tunnel_index);
+  if (PREDICT_TRUE (ip6_address_is_equal (&t0->local.ip6,
+					  &iuvn6_0->ip6.dst_address)))
+    return tunnel_index;
+
+  key6_0.local.as_u64[0] = iuvn6_0->ip6.dst_address.as_u64[0];
+  key6_0.local.as_u64[1] = iuvn6_0->ip6.dst_address.as_u64[1];
+  key6_0.remote.as_u64[0] = iuvn6_0->ip6.src_address.as_u64[0];
+  key6_0.remote.as_u64[1] = iuvn6_0->ip6.src_address.as_u64[1];
+  key6_0.vni = iuvn6_0->vxlan.vni_res;
+
+  p0 = hash_get_mem (nngm->vxlan6_gpe_tunnel_by_key, &key6_0);
+  return p0 ? p0[0] : ~0;
+}
+
 /**
  * @brief Common processing for IPv4 and IPv6 VXLAN GPE decap dispatch functions
  *
@@ -113,21 +180,18 @@ vxlan_gpe_input (vlib_main_t * vm,
   vxlan_gpe_main_t *nngm = &vxlan_gpe_main;
   vnet_main_t *vnm = nngm->vnet_main;
   vnet_interface_main_t *im = &vnm->interface_main;
-  u32 last_tunnel_index = ~0;
-  vxlan4_gpe_tunnel_key_t last_key4;
-  vxlan6_gpe_tunnel_key_t last_key6;
+  u32 tunnel_indices[VLIB_FRAME_SIZE], *ti = tunnel_indices;
   u32 pkts_decapsulated = 0;
   u32 thread_index = vlib_get_thread_index ();
   u32 stats_sw_if_index, stats_n_packets, stats_n_bytes;
 
-  if (is_ip4)
-    memset (&last_key4, 0xff, sizeof (last_key4));
-  else
-    memset (&last_key6, 0xff, sizeof (last_key6));
-
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
 
+  udp_tunnel_demux_lookup_buffers (vm, &nngm->tunnel_demux, from,
+				   n_left_from, tunnel_indices, is_ip4,
+				   vxlan_gpe_tunnel_id);
+
   next_index = node->cached_next_index;
   stats_sw_if_index = node->runtime_data[0];
   stats_n_packets = stats_n_bytes = 0;
@@ -145,11 +209,8 @@ vxlan_gpe_input (vlib_main_t * vm,
 	  u32 next0, next1;
 	  ip4_vxlan_gpe_header_t *iuvn4_0, *iuvn4_1;
 	  ip6_vxlan_gpe_header_t *iuvn6_0, *iuvn6_1;
-	  uword *p0, *p1;
 	  u32 tunnel_index0, tunnel_index1;
 	  vxlan_gpe_tunnel_t *t0, *t1;
-	  vxlan4_gpe_tunnel_key_t key4_0, key4_1;
-	  vxlan6_gpe_tunnel_key_t key6_0, key6_1;
 	  u32 error0, error1;
 	  u32 sw_if_index0, sw_if_index1, len0, len1;
 
@@ -214,8 +275,6 @@ vxlan_gpe_input (vlib_main_t * vm,
 	      vlib_buffer_advance (b1, sizeof (*iuvn6_1));
 	    }
 
-	  tunnel_index0 = ~0;
-	  tunnel_index1 = ~0;
 	  error0 = 0;
 	  error1 = 0;
 
@@ -230,61 +289,8 @@ vxlan_gpe_input (vlib_main_t * vm,
 		nngm->decap_next_node_list[iuvn4_1->vxlan.protocol] :
 		VXLAN_GPE_INPUT_NEXT_DROP;
 
-	      key4_0.local = iuvn4_0->ip4.dst_address.as_u32;
-	      key4_1.local = iuvn4_1->ip4.dst_address.as_u32;
-
-	      key4_0.remote = iuvn4_0->ip4.src_address.as_u32;
-	      key4_1.remote = iuvn4_1->ip4.src_address.as_u32;
-
-	      key4_0.vni = iuvn4_0->vxlan.vni_res;
-	      key4_1.vni = iuvn4_1->vxlan.vni_res;
-
-	      key4_0.pad = 0;
-	      key4_1.pad = 0;
-	    }
-	  else			/* is_ip6 */
-	    {
-	      next0 = (iuvn6_0->vxlan.protocol < node->n_next_nodes) ?
-		iuvn6_0->vxlan.protocol : VXLAN_GPE_INPUT_NEXT_DROP;
-	      next1 = (iuvn6_1->vxlan.protocol < node->n_next_nodes) ?
-		iuvn6_1->vxlan.protocol : VXLAN_GPE_INPUT_NEXT_DROP;
-
-	      key6_0.local.as_u64[0] = iuvn6_0->ip6.dst_address.as_u64[0];
-	      key6_0.local.as_u64[1] = iuvn6_0->ip6.dst_address.as_u64[1];
-	      key6_1.local.as_u64[0] = iuvn6_1->ip6.dst_address.as_u64[0];
-	      key6_1.local.as_u64[1] = iuvn6_1->ip6.dst_address.as_u64[1];
-
-	      key6_0.remote.as_u64[0] = iuvn6_0->ip6.src_address.as_u64[0];
-	      key6_0.remote.as_u64[1] = iuvn6_0->ip6.src_address.as_u64[1];
-	      key6_1.remote.as_u64[0] = iuvn6_1->ip6.src_address.as_u64[0];
-	      key6_1.remote.as_u64[1] = iuvn6_1->ip6.src_address.as_u64[1];
-
-	      key6_0.vni = iuvn6_0->vxlan.vni_res;
-	      key6_1.vni = iuvn6_1->vxlan.vni_res;
-	    }
-
-	  /* Processing packet 0 */
-	  if (is_ip4)
-	    {
-	      /* Processing for key4_0 */
-	      if (PREDICT_FALSE ((key4_0.as_u64[0] != last_key4.as_u64[0])
-				 || (key4_0.as_u64[1] !=
-				     last_key4.as_u64[1])))
-		{
-		  p0 = hash_get_mem (nngm->vxlan4_gpe_tunnel_by_key, &key4_0);
-
-		  if (p0 == 0)
-		    {
-		      error0 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
-		      goto trace0;
-		    }
-
-		  last_key4.as_u64[0] = key4_0.as_u64[0];
-		  last_key4.as_u64[1] = key4_0.as_u64[1];
-		  tunnel_index0 = last_tunnel_index = p0[0];
-		}
-	      else
-		tunnel_index0 = last_tunnel_index;
+	      tunnel_index0 = vxlan4_gpe_find_tunnel (nngm, ti[0], iuvn4_0);
+	      tunnel_index1 = vxlan4_gpe_find_tunnel (nngm, ti[1], iuvn4_1);
 	    }
 	  else			/* is_ip6 */
 	    {
@@ -297,36 +303,16 @@ vxlan_gpe_input (vlib_main_t * vm,
 		nngm->decap_next_node_list[iuvn6_1->vxlan.protocol] :
 		VXLAN_GPE_INPUT_NEXT_DROP;
 
-	      key6_0.local.as_u64[0] = iuvn6_0->ip6.dst_address.as_u64[0];
-	      key6_0.local.as_u64[1] = iuvn6_0->ip6.dst_address.as_u64[1];
-	      key6_1.local.as_u64[0] = iuvn6_1->ip6.dst_address.as_u64[0];
-	      key6_1.local.as_u64[1] = iuvn6_1->ip6.dst_address.as_u64[1];
-
-	      key6_0.remote.as_u64[0] = iuvn6_0->ip6.src_address.as_u64[0];
-	      key6_0.remote.as_u64[1] = iuvn6_0->ip6.src_address.as_u64[1];
-	      key6_1.remote.as_u64[0] = iuvn6_1->ip6.src_address.as_u64[0];
-	      key6_1.remote.as_u64[1] = iuvn6_1->ip6.src_address.as_u64[1];
-
-	      key6_0.vni = iuvn6_0->vxlan.vni_res;
-	      key6_1.vni = iuvn6_1->vxlan.vni_res;
-
-	      /* Processing for key6_0 */
-	      if (PREDICT_FALSE
-		  (memcmp (&key6_0, &last_key6, sizeof (last_key6)) != 0))
-		{
-		  p0 = hash_get_mem (nngm->vxlan6_gpe_tunnel_by_key, &key6_0);
-
-		  if (p0 == 0)
-		    {
-		      error0 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
-		      goto trace0;
-		    }
+	      tunnel_index0 = vxlan6_gpe_find_tunnel (nngm, ti[0], iuvn6_0);
+	      tunnel_index1 = vxlan6_gpe_find_tunnel (nngm, ti[1], iuvn6_1);
+	    }
+	  ti += 2;
 
-		  memcpy (&last_key6, &key6_0, sizeof (key6_0));
-		  tunnel_index0 = last_tunnel_index = p0[0];
-		}
-	      else
-		tunnel_index0 = last_tunnel_index;
+	  /* Processing packet 0 */
+	  if (PREDICT_FALSE (tunnel_index0 == ~0))
+	    {
+	      error0 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
+	      goto trace0;
 	    }
 
 	  t0 = pool_elt_at_index (nngm->tunnels, tunnel_index0);
@@ -378,47 +364,10 @@ vxlan_gpe_input (vlib_main_t * vm,
 	    }
 
 	  /* Process packet 1 */
-	  if (is_ip4)
+	  if (PREDICT_FALSE (tunnel_index1 == ~0))
 	    {
-	      /* Processing for key4_1 */
-	      if (PREDICT_FALSE ((key4_1.as_u64[0] != last_key4.as_u64[0])
-				 || (key4_1.as_u64[1] !=
-				     last_key4.as_u64[1])))
-		{
-		  p1 = hash_get_mem (nngm->vxlan4_gpe_tunnel_by_key, &key4_1);
-
-		  if (p1 == 0)
-		    {
-		      error1 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
-		      goto trace1;
-		    }
-
-		  last_key4.as_u64[0] = key4_1.as_u64[0];
-		  last_key4.as_u64[1] = key4_1.as_u64[1];
-		  tunnel_index1 = last_tunnel_index = p1[0];
-		}
-	      else
-		tunnel_index1 = last_tunnel_index;
-	    }
-	  else			/* is_ip6 */
-	    {
-	      /* Processing for key6_1 */
-	      if (PREDICT_FALSE
-		  (memcmp (&key6_1, &last_key6, sizeof (last_key6)) != 0))
-		{
-		  p1 = hash_get_mem (nngm->vxlan6_gpe_tunnel_by_key, &key6_1);
-
-		  if (p1 == 0)
-		    {
-		      error1 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
-		      goto trace1;
-		    }
-
-		  memcpy (&last_key6, &key6_1, sizeof (key6_1));
-		  tunnel_index1 = last_tunnel_index = p1[0];
-		}
-	      else
-		tunnel_index1 = last_tunnel_index;
+	      error1 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
+	      goto trace1;
 	    }
 
 	  t1 = pool_elt_at_index (nngm->tunnels, tunnel_index1);
@@ -483,11 +432,8 @@ vxlan_gpe_input (vlib_main_t * vm,
 	  u32 next0;
 	  ip4_vxlan_gpe_header_t *iuvn4_0;
 	  ip6_vxlan_gpe_header_t *iuvn6_0;
-	  uword *p0;
 	  u32 tunnel_index0;
 	  vxlan_gpe_tunnel_t *t0;
-	  vxlan4_gpe_tunnel_key_t key4_0;
-	  vxlan6_gpe_tunnel_key_t key6_0;
 	  u32 error0;
 	  u32 sw_if_index0, len0;
 
@@ -525,7 +471,6 @@ vxlan_gpe_input (vlib_main_t * vm,
 	      vlib_buffer_advance (b0, sizeof (*iuvn6_0));
 	    }
 
-	  tunnel_index0 = ~0;
 	  error0 = 0;
 
 	  if (is_ip4)
@@ -535,30 +480,7 @@ vxlan_gpe_input (vlib_main_t * vm,
 		nngm->decap_next_node_list[iuvn4_0->vxlan.protocol] :
 		VXLAN_GPE_INPUT_NEXT_DROP;
 
-	      key4_0.local = iuvn4_0->ip4.dst_address.as_u32;
-	      key4_0.remote = iuvn4_0->ip4.src_address.as_u32;
-	      key4_0.vni = iuvn4_0->vxlan.vni_res;
-	      key4_0.pad = 0;
-
-	      /* Processing for key4_0 */
-	      if (PREDICT_FALSE ((key4_0.as_u64[0] != last_key4.as_u64[0])
-				 || (key4_0.as_u64[1] !=
-				     last_key4.as_u64[1])))
-		{
-		  p0 = hash_get_mem (nngm->vxlan4_gpe_tunnel_by_key, &key4_0);
-
-		  if (p0 == 0)
-		    {
-		      error0 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
-		      goto trace00;
-		    }
-
-		  last_key4.as_u64[0] = key4_0.as_u64[0];
-		  last_key4.as_u64[1] = key4_0.as_u64[1];
-		  tunnel_index0 = last_tunnel_index = p0[0];
-		}
-	      else
-		tunnel_index0 = last_tunnel_index;
+	      tunnel_index0 = vxlan4_gpe_find_tunnel (nngm, ti[0], iuvn4_0);
 	    }
 	  else			/* is_ip6 */
 	    {
@@ -567,29 +489,14 @@ vxlan_gpe_input (vlib_main_t * vm,
 		nngm->decap_next_node_list[iuvn6_0->vxlan.protocol] :
 		VXLAN_GPE_INPUT_NEXT_DROP;
 
-	      key6_0.local.as_u64[0] = iuvn6_0->ip6.dst_address.as_u64[0];
-	      key6_0.local.as_u64[1] = iuvn6_0->ip6.dst_address.as_u64[1];
-	      key6_0.remote.as_u64[0] = iuvn6_0->ip6.src_address.as_u64[0];
-	      key6_0.remote.as_u64[1] = iuvn6_0->ip6.src_address.as_u64[1];
-	      key6_0.vni = iuvn6_0->vxlan.vni_res;
-
-	      /* Processing for key6_0 */
-	      if (PREDICT_FALSE
-		  (memcmp (&key6_0, &last_key6, sizeof (last_key6)) != 0))
-		{
-		  p0 = hash_get_mem (nngm->vxlan6_gpe_tunnel_by_key, &key6_0);
-
-		  if (p0 == 0)
-		    {
-		      error0 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
-		      goto trace00;
-		    }
+	      tunnel_index0 = vxlan6_gpe_find_tunnel (nngm, ti[0], iuvn6_0);
+	    }
+	  ti += 1;
 
-		  memcpy (&last_key6, &key6_0, sizeof (key6_0));
-		  tunnel_index0 = last_tunnel_index = p0[0];
-		}
-	      else
-		tunnel_index0 = last_tunnel_index;
+	  if (PREDICT_FALSE (tunnel_index0 == ~0))
+	    {
+	      error0 = VXLAN_GPE_ERROR_NO_SUCH_TUNNEL;
+	      goto trace00;
 	    }
 
 	  t0 = pool_elt_at_index (nngm->tunnels, tunnel_index0);
@@ -456,6 +456,61 @@ mcast_shared_remove (ip46_address_t * remote)
   hash_unset_mem_free (&vxlan_gpe_main.mcast_shared, remote);
 }
 
+/**
+ * @brief Keep the decap demux entry of a tunnel's remote and vni
+ *
+ * The demux entry points at one of the tunnels from that remote with that
+ * vni. When that tunnel goes away, the entry moves to another such tunnel,
+ * if any, so decap only needs the full key for the other local addresses.
+ */
+static void
+vxlan_gpe_tunnel_demux_add_del (vxlan_gpe_main_t * ngm,
+				vxlan_gpe_tunnel_t * t, u8 is_ip6, u8 is_add)
+{
+  udp_tunnel_demux_t *d = &ngm->tunnel_demux;
+  u32 vni = clib_host_to_net_u32 (t->vni << 8);
+  u32 ti = t - ngm->tunnels, next_ti = ~0, cur;
+  vxlan_gpe_tunnel_t *t1;
+
+  cur = is_ip6 ? udp_tunnel_demux_find6 (d, &t->remote.ip6, vni) :
+    udp_tunnel_demux_find4 (d, t->remote.ip4.as_u32, vni);
+
+  if (is_add)
+    {
+      if (cur == ~0)
+	goto add;
+      return;
+    }
+
+  if (cur != ti)
+    return;
+
+  /* *INDENT-OFF* */
+  pool_foreach (t1, ngm->tunnels,
+  ({
+    if (t1 != t && t1->vni == t->vni &&
+        ip46_address_is_equal (&t1->remote, &t->remote))
+      next_ti = t1 - ngm->tunnels;
+  }));
+  /* *INDENT-ON* */
+
+  if (is_ip6)
+    udp_tunnel_demux_add_del6 (d, &t->remote.ip6, vni, ti, 0 /* is_add */ );
+  else
+    udp_tunnel_demux_add_del4 (d, t->remote.ip4.as_u32, vni, ti,
+			       0 /* is_add */ );
+  if (next_ti == ~0)
+    return;
+  ti = next_ti;
+
+add:
+  if (is_ip6)
+    udp_tunnel_demux_add_del6 (d, &t->remote.ip6, vni, ti, 1 /* is_add */ );
+  else
+    udp_tunnel_demux_add_del4 (d, t->remote.ip4.as_u32, vni, ti,
+			       1 /* is_add */ );
+}
+
 /**
  * @brief Add or Del a VXLAN GPE tunnel
  *
@@ -554,6 +609,7 @@ int vnet_vxlan_gpe_add_del_tunnel
 	  hash_set_mem (ngm->vxlan6_gpe_tunnel_by_key, key6_copy,
 			t - ngm->tunnels);
 	}
+      vxlan_gpe_tunnel_demux_add_del (ngm, t, is_ip6, 1 /* is_add */ );
 
       if (vec_len (ngm->free_vxlan_gpe_tunnel_hw_if_indices) > 0)
 	{
@@ -723,6 +779,7 @@ int vnet_vxlan_gpe_add_del_tunnel
 	hash_unset (ngm->vxlan4_gpe_tunnel_by_key, key4.as_u64);
       else
 	hash_unset_mem_free (&ngm->vxlan6_gpe_tunnel_by_key, &key6);
+      vxlan_gpe_tunnel_demux_add_del (ngm, t, is_ip6, 0 /* is_add */ );
 
       if (!ip46_address_is_multicast (&t->remote))
 	{
@@ -1246,6 +1303,7 @@ vxlan_gpe_init (vlib_main_t * vm)
 
   ngm->vxlan6_gpe_tunnel_by_key
     = hash_create_mem (0, sizeof (vxlan6_gpe_tunnel_key_t), sizeof (uword));
+  udp_tunnel_demux_init (&ngm->tunnel_demux, "vxlan-gpe");
 
 
   ngm->mcast_shared = hash_create_mem (0,
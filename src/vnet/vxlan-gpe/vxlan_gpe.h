@@ -32,6 +32,7 @@
 #include <vnet/ip/ip4_packet.h>
 #include <vnet/ip/ip6_packet.h>
 #include <vnet/udp/udp.h>
+#include <vnet/udp/udp_tunnel_demux.h>
 #include <vnet/dpo/dpo.h>
 #include <vnet/adj/adj_types.h>
 
@@ -202,6 +203,8 @@ typedef struct
   uword *vxlan4_gpe_tunnel_by_key;
   /** lookup IPv6 VXLAN GPE tunnel by key */
   uword *vxlan6_gpe_tunnel_by_key;
+  /** batched decap lookup on remote address + vni, see decap.c */
+  udp_tunnel_demux_t tunnel_demux;
 
   /* local VTEP IPs ref count used by vxlan-bypass node to check if
      received VXLAN packet DIP matches any local VTEP address */
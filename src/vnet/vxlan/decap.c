@@ -62,39 +62,27 @@ validate_vxlan_fib (vlib_buffer_t *b, vxlan_tunnel_t *t, u32 is_ip4)
   return (fib_index == t->encap_fib_index);
 }
 
-typedef struct
-{
-  vxlan4_tunnel_key_t key4;
-  u32 tunnel_index;
-}last_tunnel_cache4;
-
-typedef struct
+/*
+ * The tunnels of all the packets in the frame are looked up before
+ * processing them, so the lookups are pipelined. udp leaves current_data
+ * pointing at the vxlan header.
+ */
+static_always_inline u32
+vxlan_tunnel_id (void * h)
 {
-  vxlan6_tunnel_key_t key6;
-  u32 tunnel_index;
-}last_tunnel_cache6;
+  return ((vxlan_header_t *) h)->vni_reserved;
+}
 
 always_inline vxlan_tunnel_t *
-vxlan4_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache4 * cache,
+vxlan4_find_tunnel (vxlan_main_t * vxm, u32 tunnel_index,
                     ip4_header_t * ip4_0, vxlan_header_t * vxlan0,
                     vxlan_tunnel_t ** stats_t0)
 {
   /* Make sure VXLAN tunnel exist according to packet SIP and VNI */
-  vxlan4_tunnel_key_t key4_0 = {
-    .src = ip4_0->src_address.as_u32,
-    .vni = vxlan0->vni_reserved,
-  };
-
-  if (PREDICT_FALSE (key4_0.as_u64 != cache->key4.as_u64))
-  {
-    uword * p = hash_get (vxm->vxlan4_tunnel_by_key, key4_0.as_u64);
-    if (PREDICT_FALSE (p == 0))
-      return 0;
+  if (PREDICT_FALSE (tunnel_index == ~0))
+    return 0;
 
-    cache->key4 = key4_0;
-    cache->tunnel_index = p[0];
-  }
-  vxlan_tunnel_t * t0 = pool_elt_at_index (vxm->tunnels, cache->tunnel_index);
+  vxlan_tunnel_t * t0 = pool_elt_at_index (vxm->tunnels, tunnel_index);
 
   /* Validate VXLAN tunnel SIP against packet DIP */
   if (PREDICT_TRUE (ip4_0->dst_address.as_u32 == t0->src.ip4.as_u32))
@@ -105,38 +93,28 @@ vxlan4_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache4 * cache,
     if (PREDICT_TRUE (!ip4_address_is_multicast (&ip4_0->dst_address)))
       return 0;
 
-    key4_0.src = ip4_0->dst_address.as_u32;
     /* Make sure mcast VXLAN tunnel exist by packet DIP and VNI */
-    uword * p = hash_get (vxm->vxlan4_tunnel_by_key, key4_0.as_u64);
-    if (PREDICT_FALSE (p == NULL))
+    u32 mcast_index = udp_tunnel_demux_find4 (&vxm->tunnel_demux,
+                                              ip4_0->dst_address.as_u32,
+                                              vxlan0->vni_reserved);
+    if (PREDICT_FALSE (mcast_index == ~0))
       return 0;
-    *stats_t0 = pool_elt_at_index (vxm->tunnels, p[0]);
+    *stats_t0 = pool_elt_at_index (vxm->tunnels, mcast_index);
   }
 
   return t0;
 }
 
 always_inline vxlan_tunnel_t *
-vxlan6_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache6 * cache,
+vxlan6_find_tunnel (vxlan_main_t * vxm, u32 tunnel_index,
                     ip6_header_t * ip6_0, vxlan_header_t * vxlan0,
                     vxlan_tunnel_t ** stats_t0)
 {
   /* Make sure VXLAN tunnel exist according to packet SIP and VNI */
-  vxlan6_tunnel_key_t key6_0 = {
-    .src = ip6_0->src_address,
-    .vni = vxlan0->vni_reserved,
-  };
-
-  if (PREDICT_FALSE (memcmp(&key6_0, &cache->key6, sizeof key6_0) != 0))
-  {
-    uword * p = hash_get_mem (vxm->vxlan6_tunnel_by_key, &key6_0);
-    if (PREDICT_FALSE (p == NULL))
-      return 0;
+  if (PREDICT_FALSE (tunnel_index == ~0))
+    return 0;
 
-    cache->key6 = key6_0;
-    cache->tunnel_index = p[0];
-  }
-  vxlan_tunnel_t * t0 = pool_elt_at_index (vxm->tunnels, cache->tunnel_index);
+  vxlan_tunnel_t * t0 = pool_elt_at_index (vxm->tunnels, tunnel_index);
 
   /* Validate VXLAN tunnel SIP against packet DIP */
   if (PREDICT_TRUE (ip6_address_is_equal (&ip6_0->dst_address, &t0->src.ip6)))
@@ -147,12 +125,13 @@ vxlan6_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache6 * cache,
     if (PREDICT_TRUE (!ip6_address_is_multicast (&ip6_0->dst_address)))
       return 0;
 
-    key6_0.src = ip6_0->dst_address;
     /* Make sure mcast VXLAN tunnel exist by packet DIP and VNI */
-    uword * p = hash_get_mem (vxm->vxlan6_tunnel_by_key, &key6_0);
-    if (PREDICT_FALSE (p == NULL))
+    u32 mcast_index = udp_tunnel_demux_find6 (&vxm->tunnel_demux,
+                                              &ip6_0->dst_address,
+                                              vxlan0->vni_reserved);
+    if (PREDICT_FALSE (mcast_index == ~0))
       return 0;
-    *stats_t0 = pool_elt_at_index (vxm->tunnels, p[0]);
+    *stats_t0 = pool_elt_at_index (vxm->tunnels, mcast_index);
   }
 
   return t0;
@@ -169,21 +148,18 @@ vxlan_input (vlib_main_t * vm,
   vnet_interface_main_t * im = &vnm->interface_main;
   vlib_combined_counter_main_t * rx_counter = im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX;
   vlib_combined_counter_main_t * drop_counter = im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_DROP;
-  last_tunnel_cache4 last4 = { .tunnel_index = ~0 };
-  last_tunnel_cache6 last6 = { .tunnel_index = ~0 };
   u32 pkts_decapsulated = 0;
   u32 thread_index = vlib_get_thread_index();
-
-  if (is_ip4)
-    last4.key4.as_u64 = ~0;
-  else
-    memset (&last6.key6, 0xff, sizeof last6.key6);
+  u32 tunnel_indices[VLIB_FRAME_SIZE], * ti = tunnel_indices;
 
   u32 next_index = node->cached_next_index;
 
   u32 * from = vlib_frame_vector_args (from_frame);
   u32 n_left_from = from_frame->n_vectors;
 
+  udp_tunnel_demux_lookup_buffers (vm, &vxm->tunnel_demux, from, n_left_from,
+                                   tunnel_indices, is_ip4, vxlan_tunnel_id);
+
   while (n_left_from > 0)
     {
       u32 * to_next, n_left_to_next;
@@ -240,14 +216,15 @@ vxlan_input (vlib_main_t * vm,
           vxlan_tunnel_t * t1, * stats_t1;
           if (is_ip4)
           {
-            t0 = vxlan4_find_tunnel (vxm, &last4, ip4_0, vxlan0, &stats_t0);
-            t1 = vxlan4_find_tunnel (vxm, &last4, ip4_1, vxlan1, &stats_t1);
+            t0 = vxlan4_find_tunnel (vxm, ti[0], ip4_0, vxlan0, &stats_t0);
+            t1 = vxlan4_find_tunnel (vxm, ti[1], ip4_1, vxlan1, &stats_t1);
           }
           else
           {
-            t0 = vxlan6_find_tunnel (vxm, &last6, ip6_0, vxlan0, &stats_t0);
-            t1 = vxlan6_find_tunnel (vxm, &last6, ip6_1, vxlan1, &stats_t1);
+            t0 = vxlan6_find_tunnel (vxm, ti[0], ip6_0, vxlan0, &stats_t0);
+            t1 = vxlan6_find_tunnel (vxm, ti[1], ip6_1, vxlan1, &stats_t1);
           }
+          ti += 2;
 
           u32 len0 = vlib_buffer_length_in_chain (vm, b0);
           u32 len1 = vlib_buffer_length_in_chain (vm, b1);
@@ -364,9 +341,10 @@ vxlan_input (vlib_main_t * vm,
 
           vxlan_tunnel_t * t0, * stats_t0;
           if (is_ip4)
-            t0 = vxlan4_find_tunnel (vxm, &last4, ip4_0, vxlan0, &stats_t0);
+            t0 = vxlan4_find_tunnel (vxm, ti[0], ip4_0, vxlan0, &stats_t0);
           else
-            t0 = vxlan6_find_tunnel (vxm, &last6, ip6_0, vxlan0, &stats_t0);
+            t0 = vxlan6_find_tunnel (vxm, ti[0], ip6_0, vxlan0, &stats_t0);
+          ti += 1;
 
           uword len0 = vlib_buffer_length_in_chain (vm, b0);
 
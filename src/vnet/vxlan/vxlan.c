@@ -369,24 +369,18 @@ int vnet_vxlan_add_del_tunnel
   vxlan_main_t *vxm = &vxlan_main;
   vxlan_tunnel_t *t = 0;
   vnet_main_t *vnm = vxm->vnet_main;
-  uword *p;
   u32 sw_if_index = ~0;
-  vxlan4_tunnel_key_t key4;
-  vxlan6_tunnel_key_t key6;
+  u32 tunnel_index;
   u32 is_ip6 = a->is_ip6;
+  u32 vni = clib_host_to_net_u32 (a->vni << 8);
 
+  /* decap src in key is encap dst in config */
   if (!is_ip6)
-    {
-      key4.src = a->dst.ip4.as_u32;	/* decap src in key is encap dst in config */
-      key4.vni = clib_host_to_net_u32 (a->vni << 8);
-      p = hash_get (vxm->vxlan4_tunnel_by_key, key4.as_u64);
-    }
+    tunnel_index = udp_tunnel_demux_find4 (&vxm->tunnel_demux,
+					   a->dst.ip4.as_u32, vni);
   else
-    {
-      key6.src = a->dst.ip6;
-      key6.vni = clib_host_to_net_u32 (a->vni << 8);
-      p = hash_get_mem (vxm->vxlan6_tunnel_by_key, &key6);
-    }
+    tunnel_index = udp_tunnel_demux_find6 (&vxm->tunnel_demux,
+					   &a->dst.ip6, vni);
 
   if (a->is_add)
     {
@@ -395,7 +389,7 @@ int vnet_vxlan_add_del_tunnel
       u32 user_instance;	/* request and actual instance number */
 
       /* adding a tunnel: tunnel must not already exist */
-      if (p)
+      if (tunnel_index != ~0)
 	return VNET_API_ERROR_TUNNEL_EXIST;
 
       /*if not set explicitly, default to l2 */
@@ -433,9 +427,11 @@ int vnet_vxlan_add_del_tunnel
 
       /* copy the key */
       if (is_ip6)
-	hash_set_mem_alloc (&vxm->vxlan6_tunnel_by_key, &key6, dev_instance);
+	udp_tunnel_demux_add_del6 (&vxm->tunnel_demux, &a->dst.ip6, vni,
+				   dev_instance, 1 /* is_add */ );
       else
-	hash_set (vxm->vxlan4_tunnel_by_key, key4.as_u64, dev_instance);
+	udp_tunnel_demux_add_del4 (&vxm->tunnel_demux, a->dst.ip4.as_u32,
+				   vni, dev_instance, 1 /* is_add */ );
 
       t->hw_if_index = vnet_register_interface
 	(vnm, vxlan_device_class.index, dev_instance,
@@ -560,11 +556,10 @@ int vnet_vxlan_add_del_tunnel
   else
     {
       /* deleting a tunnel: tunnel must exist */
-      if (!p)
+      if (tunnel_index == ~0)
 	return VNET_API_ERROR_NO_SUCH_ENTRY;
 
-      u32 instance = p[0];
-      t = pool_elt_at_index (vxm->tunnels, instance);
+      t = pool_elt_at_index (vxm->tunnels, tunnel_index);
 
       sw_if_index = t->sw_if_index;
       vnet_sw_interface_set_flags (vnm, sw_if_index, 0 /* down */ );
@@ -572,9 +567,11 @@ int vnet_vxlan_add_del_tunnel
       vxm->tunnel_index_by_sw_if_index[sw_if_index] = ~0;
 
       if (!is_ip6)
-	hash_unset (vxm->vxlan4_tunnel_by_key, key4.as_u64);
+	udp_tunnel_demux_add_del4 (&vxm->tunnel_demux, a->dst.ip4.as_u32,
+				   vni, tunnel_index, 0 /* is_add */ );
       else
-	hash_unset_mem_free (&vxm->vxlan6_tunnel_by_key, &key6);
+	udp_tunnel_demux_add_del6 (&vxm->tunnel_demux, &a->dst.ip6, vni,
+				   tunnel_index, 0 /* is_add */ );
 
       if (!ip46_address_is_multicast (&t->dst))
 	{
@@ -1156,10 +1153,9 @@ vxlan_init (vlib_main_t * vm)
   vnet_flow_get_range (vxm->vnet_main, "vxlan", 1024 * 1024,
 		       &vxm->flow_id_start);
 
+  udp_tunnel_demux_init (&vxm->tunnel_demux, "vxlan");
+
   /* initialize the ip6 hash */
-  vxm->vxlan6_tunnel_by_key = hash_create_mem (0,
-					       sizeof (vxlan6_tunnel_key_t),
-					       sizeof (uword));
   vxm->vtep6 = hash_create_mem (0, sizeof (ip6_address_t), sizeof (uword));
   vxm->mcast_shared = hash_create_mem (0,
 				       sizeof (ip46_address_t),
@@ -27,6 +27,8 @@
 #include <vnet/ip/ip4_packet.h>
 #include <vnet/ip/ip6_packet.h>
 #include <vnet/udp/udp.h>
+#include <vnet/udp/udp_tunnel_demux.h>
+#include <vnet/udp/udp_tunnel_encap.h>
 #include <vnet/dpo/dpo.h>
 #include <vnet/adj/adj_types.h>
 
@@ -42,29 +44,6 @@ typedef CLIB_PACKED (struct {
   vxlan_header_t vxlan;        /* 8 bytes */
 }) ip6_vxlan_header_t;
 
-typedef CLIB_PACKED(struct {
-  /* 
-   * Key fields: ip src and vxlan vni on incoming VXLAN packet
-   * all fields in NET byte order
-   */
-  union {
-    struct {
-      u32 src;
-      u32 vni;                 /* shifted left 8 bits */
-    };
-    u64 as_u64;
-  };
-}) vxlan4_tunnel_key_t;
-
-typedef CLIB_PACKED(struct {
-  /*
-   * Key fields: ip src and vxlan vni on incoming VXLAN packet
-   * all fields in NET byte order
-   */
-  ip6_address_t src;
-  u32 vni;                 /* shifted left 8 bits */
-}) vxlan6_tunnel_key_t;
-
 typedef struct {
   /* Required for pool_get_aligned */
   CLIB_CACHE_LINE_ALIGN_MARK(cacheline0);
@@ -141,9 +120,8 @@ typedef struct {
   /* vector of encap tunnel instances */
   vxlan_tunnel_t * tunnels;
 
-  /* lookup tunnel by key */
-  uword * vxlan4_tunnel_by_key; /* keyed on ipv4.dst + vni */
-  uword * vxlan6_tunnel_by_key; /* keyed on ipv6.dst + vni */
+  /* lookup tunnel by key, keyed on ip src + vni of received packets */
+  udp_tunnel_demux_t tunnel_demux;
 
   /* local VTEP IPs ref count used by vxlan-bypass node to check if
      received VXLAN packet DIP matches any local VTEP address */
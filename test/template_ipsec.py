@@ -1,3 +1,5 @@
+import multiprocessing
+import re
 import unittest
 
 from scapy.layers.inet import IP, ICMP, TCP
@@ -204,5 +206,53 @@ class IpsecTunTests(object):
             self.logger.info(self.vapi.ppcli("show ipsec"))
 
 
+@unittest.skipUnless(multiprocessing.cpu_count() >= 3,
+                     "needs a cpu for the main thread and each of 2 workers")
+class IpsecWorkerTests(object):
+    """ SAs pinned to the second of two workers
+
+    packet-generator streams run on the first worker, so with the SAs
+    owned by the second one every packet of the tunnel is handed off.
+    Classes using this list the nodes doing the crypto in handoff_nodes.
+    """
+
+    handoff_nodes = []
+
+    @classmethod
+    def setUpConstants(cls):
+        super(IpsecWorkerTests, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "2", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(IpsecWorkerTests, cls).setUpClass()
+        for sa_id in [cls.scapy_tun_sa_id, cls.vpp_tun_sa_id]:
+            cls.vapi.cli("set ipsec sa %u worker 1" % sa_id)
+
+    def node_vectors(self, node):
+        """ vectors processed by a node, by thread index """
+        vectors = {}
+        thread = 0
+        for line in self.vapi.cli("show runtime").splitlines():
+            m = re.match(r"Thread (\d+) ", line)
+            if m:
+                thread = int(m.group(1))
+            elif line.split()[:1] == [node]:
+                vectors[thread] = int(line.split()[3])
+        return vectors
+
+    def test_sa_worker_handoff(self):
+        """ tunnel traffic is processed by the SA worker """
+        count = 17
+        self.vapi.cli("clear runtime")
+        self.test_tun_basic(count=count)
+        self.logger.info(self.vapi.ppcli("show runtime"))
+        for node in self.handoff_nodes:
+            vectors = self.node_vectors(node)
+            # the receiving worker hands off, the owner does the crypto
+            self.assertEqual(vectors.get(1, 0), count, node)
+            self.assertEqual(vectors.get(2, 0), count, node)
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
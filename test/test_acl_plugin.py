@@ -1433,5 +1433,36 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0315")
 
+    def test_0320_match_5tuple_batch(self):
+        """ batch 5-tuple match gives the same results as the scalar one
+        """
+        self.logger.info("ACLP_TEST_START_0320")
+
+        for af in ["", " ip6"]:
+            reply = self.vapi.cli("test acl-plugin match-5tuple rules 1000 "
+                                  "tuples 4096 rounds 1" + af)
+            self.logger.info(reply)
+            self.assertEqual(reply.find("differ"), -1)
+            self.assertNotEqual(reply.find("scalar"), -1)
+
+        self.logger.info("ACLP_TEST_FINISH_0320")
+
+
+class TestACLpluginBitvector(TestACLplugin):
+    """ ACL plugin Test Case with the bit vector classifier """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestACLpluginBitvector, cls).setUpClass()
+        # lookup contexts created from now on use the bit vector backend
+        cls.vapi.ppcli("set acl-plugin use-bitvector-acl-matching 1")
+
+    def tearDown(self):
+        super(TestACLpluginBitvector, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.ppcli(
+                "show acl-plugin tables bitvector"))
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 """ ACL plugin extended stateful tests """
 
+import re
 import unittest
 from framework import VppTestCase, VppTestRunner, running_extended_tests
 from scapy.layers.l2 import Ether
@@ -155,6 +156,17 @@ class ACLPluginConnTestCase(VppTestCase):
             self.logger.info(self.vapi.cli("show acl-plugin tables"))
             self.logger.info(self.vapi.cli("show event-logger all"))
 
+    def active_sessions(self):
+        show = self.vapi.cli("show acl-plugin sessions")
+        m = re.search(r"Sessions active: add \d+ - deact \d+ = (\d+)", show)
+        self.assertTrue(m, show)
+        return int(m.group(1))
+
+    def timer_expired_sessions(self):
+        show = self.vapi.cli("show acl-plugin sessions")
+        return sum(int(n) for n in
+                   re.findall(r"Sessions expired by timer: (\d+)", show))
+
     def run_basic_conn_test(self, af, acl_side):
         """ Basic conn timeout test """
         conn1 = Conn(self, self.pg0, self.pg1, af, UDP, 42001, 4242)
@@ -309,6 +321,30 @@ class ACLPluginConnTestCase(VppTestCase):
         """ IPv4: Basic conn timeout test reflect on egress """
         self.run_basic_conn_test(AF_INET, 1)
 
+    def test_0003_timer_expiry_counted(self):
+        """ IPv4: idle session expired by its timer is counted """
+        self.vapi.ppcli("set acl-plugin session timeout udp idle 1")
+        stats = self.vapi.cli("show statistics segment")
+        self.assertIn("/acl/sessions/expiry-latency-total-usec", stats)
+        self.assertIn("/acl/sessions/expiry-latency-max-usec", stats)
+
+        active = self.active_sessions()
+        expired = self.timer_expired_sessions()
+        conn1 = Conn(self, self.pg0, self.pg1, AF_INET, UDP, 42003, 4242)
+        conn1.apply_acls(0, 0)
+        conn1.send_through(0)
+        self.assertEqual(self.active_sessions(), active + 1)
+
+        # well past the timeout and the timer tick
+        self.sleep(3)
+        self.assertLessEqual(self.active_sessions(), active)
+        self.assertGreater(self.timer_expired_sessions(), expired)
+        try:
+            p2 = conn1.send_through(1).command()
+        except:
+            p2 = None
+        self.assert_equal(p2, None, "packet on expired conn")
+
     def test_0005_clear_conn_test(self):
         """ IPv4: reflect egress, clear conn """
         self.run_clear_conn_test(AF_INET, 1)
@@ -0,0 +1,135 @@
+#!/usr/bin/env python
+
+import os
+import re
+import socket
+import struct
+import subprocess
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+ETH_P_EXPERIMENTAL = 0x88b5
+
+
+def ip(*args):
+    subprocess.check_call(["ip"] + list(args))
+
+
+@unittest.skipUnless(os.geteuid() == 0, "needs root to create veths")
+class TestAfPacket(VppTestCase):
+    """ AF_PACKET host interface test """
+
+    host_if = "vpp-afp0"
+    peer_if = "vpp-afp1"
+    # packets of up to 32 buffers, a quarter of an rx block
+    mtu = 65000
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestAfPacket, cls).setUpClass()
+        ip("link", "add", cls.host_if, "type", "veth", "peer", "name",
+           cls.peer_if)
+        for ifname in (cls.host_if, cls.peer_if):
+            with open("/proc/sys/net/ipv6/conf/%s/disable_ipv6" % ifname,
+                      "w") as f:
+                f.write("1")
+            ip("link", "set", ifname, "mtu", str(cls.mtu), "up")
+        cls.sock = socket.socket(socket.AF_PACKET, socket.SOCK_RAW)
+        cls.sock.bind((cls.peer_if, 0))
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.sock.close()
+        ip("link", "del", cls.host_if)
+        super(TestAfPacket, cls).tearDownClass()
+
+    def setUp(self):
+        super(TestAfPacket, self).setUp()
+        self.vapi.cli("create host-interface name %s num-rx-queues 2" %
+                      self.host_if)
+        self.vpp_if = "host-%s" % self.host_if
+        self.vapi.cli("set interface state %s up" % self.vpp_if)
+
+    def tearDown(self):
+        self.vapi.cli("delete host-interface name %s" % self.host_if)
+        super(TestAfPacket, self).tearDown()
+
+    def send(self, sizes):
+        """ Send numbered frames of the given sizes from the peer """
+        for i, size in enumerate(sizes):
+            hdr = b"\x02\x00\x00\x00\x00\x01" + b"\x02\x00\x00\x00\x00\x02" + \
+                struct.pack("!HI", ETH_P_EXPERIMENTAL, i)
+            self.sock.send(hdr + b"\xa5" * (size - len(hdr)))
+
+    def rx_counters(self):
+        show = self.vapi.cli("show interface %s" % self.vpp_if)
+        m = re.search(r"rx packets\s+(\d+)\s+rx bytes\s+(\d+)", show)
+        if not m:
+            return 0, 0
+        return int(m.group(1)), int(m.group(2))
+
+    def verify_rx(self, sizes):
+        self.vapi.cli("clear interfaces")
+        self.send(sizes)
+        # blocks are retired to VPP after at most 1ms
+        self.sleep(0.2)
+        self.assertEqual(self.rx_counters(), (len(sizes), sum(sizes)))
+        errors = self.vapi.cli("show errors")
+        self.assertNotIn("partial", errors)
+
+    def test_af_packet_v3_fanout(self):
+        """ AF_PACKET TPACKET_V3 rx with fanout """
+        show = self.vapi.cli("show hardware-interfaces verbose %s" %
+                             self.vpp_if)
+        self.assertIn("rx queues 2", show)
+        self.assertIn("fanout group", show)
+
+        # small, jumbo and packets larger than the old frame size
+        sizes = [60, 1514, 9000, self.mtu + 14] * 64
+        self.verify_rx(sizes)
+
+        for mode in ("polling", "interrupt"):
+            self.vapi.cli("set interface rx-mode %s %s" %
+                          (self.vpp_if, mode))
+            self.verify_rx(sizes)
+
+    def queue_counters(self):
+        show = self.vapi.cli("show hardware-interfaces verbose %s" %
+                             self.vpp_if)
+        return [int(n) for n in re.findall(r"queue \d+: rx packets (\d+)",
+                                           show)]
+
+    def send_udp_flows(self, n_flows, n_per_flow):
+        """ Send ipv4 udp flows differing in their source port """
+        eth = b"\x02\x00\x00\x00\x00\x01" + \
+            b"\x02\x00\x00\x00\x00\x02" + struct.pack("!H", 0x0800)
+        payload = b"\xa5" * 18
+        for flow in range(n_flows):
+            udp = struct.pack("!HHHH", 1024 + flow, 4789, 8 + len(payload), 0)
+            ip4 = struct.pack("!BBHHHBBH4s4s", 0x45, 0, 20 + len(udp) +
+                              len(payload), 0, 0, 64, socket.IPPROTO_UDP,
+                              0, socket.inet_aton("10.0.0.2"),
+                              socket.inet_aton("10.0.0.1"))
+            for i in range(n_per_flow):
+                self.sock.send(eth + ip4 + udp + payload)
+
+    def test_af_packet_v3_fanout_spread(self):
+        """ AF_PACKET fanout spreads flows over the rx queues """
+        n_flows = 64
+        n_per_flow = 4
+        self.vapi.cli("clear interfaces")
+        self.send_udp_flows(n_flows, n_per_flow)
+        self.sleep(0.2)
+
+        counters = self.queue_counters()
+        self.assertEqual(len(counters), 2)
+        self.assertEqual(sum(counters), n_flows * n_per_flow)
+        # the fanout hashes the flow, so no queue is left empty
+        for n in counters:
+            self.assertGreater(n, 0)
+        self.assertEqual(self.rx_counters()[0], n_flows * n_per_flow)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -5,7 +5,7 @@ from scapy.layers.ipsec import AH
 
 from framework import VppTestRunner
 from template_ipsec import TemplateIpsec, IpsecTraTests, IpsecTunTests
-from template_ipsec import IpsecTcpTests
+from template_ipsec import IpsecTcpTests, IpsecWorkerTests
 
 
 class TemplateIpsecAh(TemplateIpsec):
@@ -160,5 +160,11 @@ class TestIpsecAh2(TemplateIpsecAh, IpsecTcpTests):
     pass
 
 
+class TestIpsecAhWorker(IpsecWorkerTests, TemplateIpsecAh, IpsecTunTests):
+    """ Ipsec AH - TUN tests with SAs pinned to a worker """
+
+    handoff_nodes = ["ah-decrypt", "ah-encrypt"]
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -1,9 +1,11 @@
 import socket
 import unittest
+from scapy.layers.inet import IP, ICMP
 from scapy.layers.ipsec import ESP
+from scapy.layers.l2 import Ether
 
 from framework import VppTestRunner
-from template_ipsec import IpsecTraTests, IpsecTunTests
+from template_ipsec import IpsecTraTests, IpsecTunTests, IpsecWorkerTests
 from template_ipsec import TemplateIpsec, IpsecTcpTests
 
 
@@ -41,6 +43,7 @@ class TemplateIpsecEsp(TemplateIpsec):
     """
 
     encryption_type = ESP
+    tun_anti_replay = 0
 
     @classmethod
     def setUpClass(cls):
@@ -70,7 +73,8 @@ class TemplateIpsecEsp(TemplateIpsec):
                                          cls.crypt_algo_vpp_id,
                                          cls.crypt_key, cls.vpp_esp_protocol,
                                          cls.tun_if.remote_ip4n,
-                                         cls.tun_if.local_ip4n)
+                                         cls.tun_if.local_ip4n,
+                                         use_anti_replay=cls.tun_anti_replay)
         cls.vapi.ipsec_spd_add_del(cls.tun_spd_id)
         cls.vapi.ipsec_interface_add_del_spd(cls.tun_spd_id,
                                              cls.tun_if.sw_if_index)
@@ -157,5 +161,87 @@ class TestIpsecEsp2(TemplateIpsecEsp, IpsecTcpTests):
     pass
 
 
+class TestIpsecEspOpenssl(TemplateIpsecEsp, IpsecTraTests, IpsecTunTests):
+    """ Ipsec ESP - TUN & TRA tests with the openssl crypto engine """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestIpsecEspOpenssl, cls).setUpClass()
+        cls.vapi.cli("set ipsec crypto engine openssl")
+
+    def test_crypto_engines(self):
+        """ every crypto engine matches the openssl one """
+        self.logger.info(self.vapi.ppcli("show ipsec crypto engines"))
+        for alg in ["aes-cbc-128", "aes-cbc-192", "aes-cbc-256",
+                    "des-cbc", "3des-cbc"]:
+            reply = self.vapi.cli("test ipsec crypto alg %s size 1024 "
+                                  "packets 64 rounds 1" % alg)
+            self.logger.info(reply)
+            self.assertEqual(reply.find("mismatch"), -1)
+            self.assertNotEqual(reply.find("openssl"), -1)
+
+
+class TestIpsecEspWorker(IpsecWorkerTests, TemplateIpsecEsp, IpsecTunTests):
+    """ Ipsec ESP - TUN tests with SAs pinned to a worker """
+
+    handoff_nodes = ["esp-decrypt", "esp-encrypt"]
+
+    def test_sa_worker(self):
+        """ SA worker pinning """
+        reply = self.vapi.cli("show ipsec")
+        self.assertIn("thread 2", reply)
+        reply = self.vapi.cli("set ipsec sa %u worker 2" % self.vpp_tun_sa_id)
+        self.assertIn("invalid worker", reply)
+        reply = self.vapi.cli("set ipsec sa 12345 worker 0")
+        self.assertIn("no such sa", reply)
+
+
+class TestIpsecEspAntiReplay(TemplateIpsecEsp):
+    """ Ipsec ESP - anti-replay window """
+
+    tun_anti_replay = 1
+
+    def replayed_count(self):
+        for line in self.vapi.cli("show errors").splitlines():
+            if "esp-decrypt" in line and "SA replayed packet" in line:
+                return int(line.split()[0])
+        return 0
+
+    def send_seqs(self, sa, seqs, n_expected):
+        pkts = [Ether(src=self.tun_if.remote_mac, dst=self.tun_if.local_mac) /
+                sa.encrypt(IP(src=self.remote_tun_if_host,
+                              dst=self.pg1.remote_ip4) /
+                           ICMP() / self.payload, seq_num=seq)
+                for seq in seqs]
+        self.tun_if.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        if n_expected:
+            self.pg1.get_capture(n_expected)
+        else:
+            self.pg1.assert_nothing_captured()
+
+    def test_anti_replay_window(self):
+        """ reordering inside the window passes, replays do not """
+        vpp_tun_sa, scapy_tun_sa = self.configure_sa_tun()
+        self.logger.info(self.vapi.ppcli("show ipsec"))
+
+        # far more reordering than a 64 packet window takes, all in one
+        # frame
+        self.send_seqs(scapy_tun_sa, [1000, 1001, 101, 500, 999, 2], 6)
+        self.assertEqual(self.replayed_count(), 0)
+
+        # replays, including one repeated within the same frame
+        self.send_seqs(scapy_tun_sa, [1000, 500, 2], 0)
+        self.assertEqual(self.replayed_count(), 3)
+        self.send_seqs(scapy_tun_sa, [1500, 1500], 1)
+        self.assertEqual(self.replayed_count(), 4)
+
+        # older than the window
+        self.send_seqs(scapy_tun_sa, [3000, 1900], 1)
+        self.assertEqual(self.replayed_count(), 5)
+        self.logger.info(self.vapi.ppcli("show ipsec"))
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
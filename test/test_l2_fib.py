@@ -62,13 +62,15 @@
 
 import unittest
 import random
+import multiprocessing
+import re
 
 from scapy.packet import Raw
 from scapy.layers.l2 import Ether
 from scapy.layers.inet import IP, UDP
 
 from framework import VppTestCase, VppTestRunner
-from util import Host, ppp
+from util import Host, ppp, mactobinary
 
 # from src/vnet/l2/l2_fib.h
 MAC_EVENT_ACTION_ADD = 0
@@ -521,5 +523,130 @@ class TestL2fib(VppTestCase):
         self.assertEqual(len(learned_macs ^ macs), 0)
 
 
+
+@unittest.skipUnless(multiprocessing.cpu_count() >= 2,
+                     "needs a cpu for the main thread and the worker")
+class TestL2fibLearnWorker(VppTestCase):
+    """ L2 FIB learning on a worker Test Case
+
+    The pg interfaces are polled by the worker, which queues its learn
+    events for the main thread instead of writing the mac table itself.
+    """
+
+    queue_size = 16
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestL2fibLearnWorker, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "1", "}",
+                                "l2learn", "{", "queue-size",
+                                str(cls.queue_size), "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestL2fibLearnWorker, cls).setUpClass()
+
+        try:
+            cls.create_pg_interfaces(range(2))
+            for i in cls.pg_interfaces:
+                i.admin_up()
+        except Exception:
+            super(TestL2fibLearnWorker, cls).tearDownClass()
+            raise
+
+    def setUp(self):
+        super(TestL2fibLearnWorker, self).setUp()
+        self.bd_id = 1
+        self.vapi.bridge_domain_add_del(self.bd_id)
+        for i in self.pg_interfaces:
+            self.vapi.sw_interface_set_l2_bridge(i.sw_if_index,
+                                                 bd_id=self.bd_id)
+
+    def tearDown(self):
+        super(TestL2fibLearnWorker, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.ppcli("show l2fib"))
+            self.logger.info(self.vapi.ppcli("show errors"))
+        self.vapi.l2fib_flush_bd(self.bd_id)
+        for i in self.pg_interfaces:
+            self.vapi.sw_interface_set_l2_bridge(i.sw_if_index,
+                                                 bd_id=self.bd_id, enable=0)
+        self.vapi.bridge_domain_add_del(self.bd_id, is_add=0)
+
+    def send_macs(self, pg_if, macs):
+        """ broadcast one frame from each mac, flooded to the other pg """
+        pkts = [Ether(dst="ff:ff:ff:ff:ff:ff", src=mac) /
+                IP(src="10.0.0.1", dst="10.0.0.2") /
+                UDP(sport=1234, dport=1234) / Raw('\xa5' * 18)
+                for mac in macs]
+        pg_if.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        return pkts
+
+    def learned(self):
+        """ learned entries of the bridge domain, mac -> sw_if_index """
+        return {e.mac: e.sw_if_index
+                for e in self.vapi.l2_fib_table_dump(self.bd_id)
+                if not e.static_mac}
+
+    def queue_full_count(self):
+        """ the last match is the total over the threads """
+        count = 0
+        for line in self.vapi.cli("show errors").splitlines():
+            if "l2-learn" in line and "due to full queue" in line:
+                count = int(line.split()[0])
+        return count
+
+    def worker_events_applied(self):
+        m = re.search(r"Worker learn events applied: (\d+)",
+                      self.vapi.cli("show l2fib"))
+        return int(m.group(1)) if m else 0
+
+    def test_learn_on_worker(self):
+        """ MACs learned on a worker show up in the l2fib """
+        n = self.queue_size // 2
+        n_applied = self.worker_events_applied()
+        macs = {pg_if.sw_if_index: ["00:00:00:aa:%02x:%02x" %
+                                    (pg_if.sw_if_index, j)
+                                    for j in range(n)]
+                for pg_if in self.pg_interfaces}
+
+        for pg_if in self.pg_interfaces:
+            pkts = self.send_macs(pg_if, macs[pg_if.sw_if_index])
+            for other in self.pg_interfaces:
+                if other != pg_if:
+                    other.get_capture(len(pkts))
+        self.sleep(1, "wait for the learner")
+
+        learned = self.learned()
+        self.assertEqual(len(learned), n * len(self.pg_interfaces))
+        for sw_if_index, if_macs in macs.items():
+            for mac in if_macs:
+                self.assertEqual(learned[mactobinary(mac)], sw_if_index)
+        self.assertEqual(self.queue_full_count(), 0)
+        self.assertEqual(self.worker_events_applied() - n_applied,
+                         len(learned))
+
+    def test_learn_queue_full(self):
+        """ Learns beyond a full worker queue are counted and dropped """
+        n = 8 * self.queue_size
+        macs = ["00:00:00:bb:%02x:%02x" % (j >> 8, j & 0xff)
+                for j in range(n)]
+        n_full = self.queue_full_count()
+
+        # the frame is larger than the queue, so some learns must be lost
+        pkts = self.send_macs(self.pg0, macs)
+        # but every packet is still forwarded
+        self.pg1.get_capture(len(pkts))
+        self.sleep(1, "wait for the learner")
+
+        n_full = self.queue_full_count() - n_full
+        learned = self.learned()
+        self.assertGreater(n_full, 0)
+        self.assertEqual(len(learned) + n_full, n)
+        for mac in learned:
+            self.assertEqual(learned[mac], self.pg0.sw_if_index)
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -5,6 +5,7 @@ import unittest
 import struct
 import StringIO
 import random
+import re
 
 from framework import VppTestCase, VppTestRunner, running_extended_tests
 from scapy.layers.inet import IP, TCP, UDP, ICMP
@@ -1087,6 +1088,34 @@ class TestNAT44(MethodHolder):
         capture = self.pg0.get_capture(len(pkts))
         self.verify_capture_in(capture, self.pg0)
 
+    def test_dynamic_port_utilization(self):
+        """ NAT44 outside port utilization """
+
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+
+        addresses = self.vapi.cli("show nat44 addresses")
+        self.assertEqual(addresses.count("0/64511 in use"), 3)
+
+        # one TCP, UDP and ICMP session each
+        pkts = self.create_stream_in(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.verify_capture_out(capture)
+
+        addresses = self.vapi.cli("show nat44 addresses")
+        self.assertEqual(addresses.count("1/64511 in use"), 3)
+
+        # the ports go back to the pool with the sessions
+        self.vapi.nat44_del_session(self.pg0.remote_ip4n, self.tcp_port_in,
+                                    IP_PROTOS.tcp)
+        addresses = self.vapi.cli("show nat44 addresses")
+        self.assertEqual(addresses.count("0/64511 in use"), 1)
+
     def test_dynamic_icmp_errors_in2out_ttl_1(self):
         """ NAT44 handling of client packets with TTL=1 """
 
@@ -2045,6 +2074,53 @@ class TestNAT44(MethodHolder):
                                  nat44_config.max_translations_per_user - 1)
                 self.assertEqual(user.nstaticsessions, 1)
 
+    def test_max_translations_per_user_clock(self):
+        """ MAX translations per user - recycle by clock """
+
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        max_sessions = self.vapi.nat_show_config().max_translations_per_user
+
+        def send(ports):
+            pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                     IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                     TCP(sport=port)) for port in ports]
+            self.pg0.add_stream(pkts)
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.pg1.get_capture(len(pkts))
+
+        def inside_ports():
+            sessions = self.vapi.nat44_user_session_dump(
+                self.pg0.remote_ip4n, 0)
+            self.assertEqual(len(sessions), max_sessions)
+            return [s.inside_port for s in sessions]
+
+        # fill the user, every new session is marked as referenced
+        ports = list(range(1025, 1025 + max_sessions))
+        send(ports)
+        self.assertEqual(inside_ports(), ports)
+
+        # the hand goes round once clearing the marks and takes the first
+        # session, the new one keeps its place in the user's list
+        send([3000])
+        ports[0] = 3000
+        self.assertEqual(inside_ports(), ports)
+
+        # the second session is used again so it gets a second chance and
+        # the third one, idle since the hand passed, is recycled
+        send([1026])
+        send([3001])
+        ports[2] = 3001
+        self.assertEqual(inside_ports(), ports)
+
+        # the recycled record starts with clean counters
+        sessions = self.vapi.nat44_user_session_dump(self.pg0.remote_ip4n, 0)
+        self.assertEqual(sessions[2].total_pkts, 1)
+        self.assertEqual(sessions[1].total_pkts, 2)
+
     def test_interface_addr(self):
         """ Acquire NAT44 addresses from interface """
         self.vapi.nat44_add_interface_addr(self.pg7.sw_if_index)
@@ -2206,6 +2282,14 @@ class TestNAT44(MethodHolder):
             if p.haslayer(Data):
                 data = ipfix.decode_data_set(p.getlayer(Set))
                 self.verify_ipfix_nat44_ses(data)
+        # all events made it through the per-thread event queues
+        out = self.vapi.cli("show nat ipfix logging")
+        self.assertIn("NAT IPFIX logging enabled", out)
+        for line in out.splitlines()[1:]:
+            counts = re.search(r"(\d+) queued, (\d+) dropped$", line)
+            self.assertIsNotNone(counts, line)
+            self.assertEqual(int(counts.group(1)), 0, line)
+            self.assertEqual(int(counts.group(2)), 0, line)
 
     def test_ipfix_addr_exhausted(self):
         """ IPFIX logging NAT addresses exhausted """
@@ -3234,6 +3318,18 @@ class TestNAT44EndpointDependent(MethodHolder):
         capture = self.pg0.get_capture(len(pkts))
         self.verify_capture_in(capture, self.pg0)
 
+    def test_ed_lookup_batch(self):
+        """ NAT44 batched session lookups match single lookups """
+
+        reply = self.vapi.cli("test nat44 ed-lookup sessions 100000 "
+                              "lookups 4096 rounds 1")
+        self.logger.info(reply)
+        self.assertEqual(reply.find("differ"), -1)
+        found = re.search(r"(\d+) lookups, (\d+) found", reply)
+        self.assertIsNotNone(found)
+        self.assertEqual(int(found.group(1)), 4096)
+        self.assertEqual(int(found.group(2)), 4096)
+
     def test_forwarding(self):
         """ NAT44 forwarding test """
 
@@ -53,10 +53,7 @@ class TestTCP(VppTestCase):
             self.logger.critical(error)
         self.assertEqual(error.find("failed"), -1)
 
-    def test_tcp_transfer(self):
-        """ TCP echo client/server transfer """
-
-        # Add inter-table routes
+    def add_inter_table_routes(self):
         ip_t01 = VppIpRoute(self, self.loop1.local_ip4, 32,
                             [VppRoutePath("0.0.0.0",
                                           0xffffffff,
@@ -67,6 +64,13 @@ class TestTCP(VppTestCase):
                                           nh_table_id=0)], table_id=1)
         ip_t01.add_vpp_config()
         ip_t10.add_vpp_config()
+        return [ip_t01, ip_t10]
+
+    def test_tcp_transfer(self):
+        """ TCP echo client/server transfer """
+
+        # Add inter-table routes
+        routes = self.add_inter_table_routes()
 
         # Start builtin server and client
         uri = "tcp://" + self.loop0.local_ip4 + "/1234"
@@ -84,8 +88,34 @@ class TestTCP(VppTestCase):
             self.assertEqual(error.find("failed"), -1)
 
         # Delete inter-table routes
-        ip_t01.remove_vpp_config()
-        ip_t10.remove_vpp_config()
+        for route in routes:
+            route.remove_vpp_config()
+
+    def test_tcp_connect_rate(self):
+        """ TCP echo client connects per second """
+
+        # Add inter-table routes
+        routes = self.add_inter_table_routes()
+
+        # Start builtin server and open/close sessions in rounds
+        uri = "tcp://" + self.loop0.local_ip4 + "/1235"
+        error = self.vapi.cli("test echo server appns 0 fifo-size 4 uri " +
+                              uri)
+        if error:
+            self.logger.critical(error)
+            self.assertEqual(error.find("failed"), -1)
+
+        error = self.vapi.cli("test echo client nclients 100 bytes 64 " +
+                              "cps-rounds 3 appns 1 fifo-size 4 " +
+                              "syn-timeout 2 uri " + uri)
+        if error:
+            self.logger.critical(error)
+            self.assertEqual(error.find("failed"), -1)
+        self.vapi.cli("test echo server stop")
+
+        # Delete inter-table routes
+        for route in routes:
+            route.remove_vpp_config()
 
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
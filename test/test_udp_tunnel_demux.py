@@ -0,0 +1,40 @@
+#!/usr/bin/env python
+
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestUdpTunnelDemux(VppTestCase):
+    """ UDP Tunnel Demux Test Case """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestUdpTunnelDemux, cls).setUpClass()
+
+    def setUp(self):
+        super(TestUdpTunnelDemux, self).setUp()
+
+    def tearDown(self):
+        super(TestUdpTunnelDemux, self).tearDown()
+
+    def test_demux_ip4(self):
+        """ UDP tunnel demux ip4 lookups """
+        error = self.vapi.cli("test udp tunnel-demux "
+                              "tunnels 1000 packets 100000")
+
+        if error:
+            self.logger.info(error)
+        self.assertEqual(error.find("Failed"), -1)
+
+    def test_demux_ip6(self):
+        """ UDP tunnel demux ip6 lookups """
+        error = self.vapi.cli("test udp tunnel-demux "
+                              "tunnels 1000 packets 100000 ip6")
+
+        if error:
+            self.logger.info(error)
+        self.assertEqual(error.find("Failed"), -1)
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -282,6 +282,18 @@ class VCLCutThruTestCase(VCLTestCase):
         self.cut_thru_test("vcl_test_server", self.server_args,
                            "vcl_test_client", self.client_echo_test_args)
 
+    def test_vcl_cut_thru_echo_epoll_lt(self):
+        """ run VCL cut thru echo test, level-triggered events re-arm """
+
+        self.cut_thru_test("vcl_test_server", ["-C"] + self.server_args,
+                           "vcl_test_client", self.client_echo_test_args)
+
+    def test_vcl_cut_thru_echo_epoll_et(self):
+        """ run VCL cut thru echo test, edge-triggered events fire once """
+
+        self.cut_thru_test("vcl_test_server", ["-e", "-C"] + self.server_args,
+                           "vcl_test_client", self.client_echo_test_args)
+
     @unittest.skipUnless(running_extended_tests(), "part of extended tests")
     def test_vcl_cut_thru_uni_dir_nsock(self):
         """ run VCL cut thru uni-directional (multiple sockets) test """
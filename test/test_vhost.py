@@ -1,9 +1,11 @@
 #!/usr/bin/env python
 
+import re
 import unittest
 
 from framework import VppTestCase, VppTestRunner
 
+from vpp_vhost_guest import VhostUserGuest, VRING_USED_F_NO_NOTIFY
 from vpp_vhost_interface import VppVhostInterface
 
 
@@ -70,5 +72,148 @@ class TesVhostInterface(VppTestCase):
         if_dump = self.vapi.sw_interface_vhost_user_dump()
         self.assertFalse(vhost_if1.is_interface_config_in_dump(if_dump))
 
+    def test_vhost_gso(self):
+        """ Vhost User interface with segmentation offload """
+        vhost_if = VppVhostInterface(self, sock_filename='/tmp/sock3',
+                                     enable_gso=1)
+        vhost_if.add_vpp_config()
+        vhost_if.admin_up()
+
+        show = self.vapi.cli("show vhost-user %s" % vhost_if.name)
+        self.assertIn("gso enabled", show)
+
+        vhost_if.remove_vpp_config()
+
+        vhost_if = VppVhostInterface(self, sock_filename='/tmp/sock4')
+        vhost_if.add_vpp_config()
+        show = self.vapi.cli("show vhost-user %s" % vhost_if.name)
+        self.assertNotIn("gso enabled", show)
+        vhost_if.remove_vpp_config()
+
+    def test_vhost_gso_segmentation(self):
+        """ GSO packet segmentation on output """
+        # 9000 bytes of payload in 1448 byte segments, the last one short
+        show = self.vapi.cli("test gso payload 9000 gso-size 1448")
+        segs = re.findall(r"length (\d+) ip-length (\d+) seq (\d+)", show)
+        self.assertIn("7 segments", show)
+        self.assertEqual(len(segs), 7)
+        for i, (length, ip_length, seq) in enumerate(segs):
+            size = 1448 if i < 6 else 9000 - 6 * 1448
+            self.assertEqual(int(length), 54 + size)
+            self.assertEqual(int(ip_length), 40 + size)
+            self.assertEqual(int(seq), 1000 + i * 1448)
+
+        # too many segments and tunnel headers in front get dropped
+        self.vapi.cli("clear errors")
+        show = self.vapi.cli("test gso payload 9000 gso-size 8")
+        self.assertIn("0 segments", show)
+        show = self.vapi.cli("test gso payload 9000 encap 50")
+        self.assertIn("0 segments", show)
+        errors = self.vapi.cli("show errors")
+        self.assertIn("GSO packet with too many segments", errors)
+        self.assertIn("GSO packet inside a tunnel", errors)
+
+    def test_vhost_adaptive_defaults(self):
+        """ Vhost User adaptive rx mode and rebalancing defaults """
+        vhost_if = VppVhostInterface(self, sock_filename='/tmp/sock5')
+        vhost_if.add_vpp_config()
+
+        show = self.vapi.cli("show vhost-user %s" % vhost_if.name)
+        self.assertIn("adaptive poll frames 32", show)
+        self.assertIn("rx rebalance interval", show)
+
+        vhost_if.remove_vpp_config()
+
+
+class TestVhostAdaptive(VppTestCase):
+    """ Vhost User adaptive rx mode transitions """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestVhostAdaptive, cls).setUpConstants()
+        # a vring which went polling stays there for the whole test
+        cls.vpp_cmdline.extend(["vhost-user", "{", "adaptive-idle-time",
+                                "10", "}"])
+
+    def setUp(self):
+        super(TestVhostAdaptive, self).setUp()
+        self.vifs = []
+        self.guests = []
+        for i in range(3):
+            sock = "%s/vhost-adaptive%d.sock" % (self.tempdir, i)
+            vif = VppVhostInterface(self, sock_filename=sock, is_server=1)
+            vif.add_vpp_config()
+            vif.admin_up()
+            guest = VhostUserGuest(sock)
+            guest.connect()
+            self.vifs.append(vif)
+            self.guests.append(guest)
+        # let VPP go through the guest setup messages
+        self.sleep(0.1)
+        for vif in self.vifs:
+            self.assertIn("thread 0 on vring 1", self.show(vif))
+
+    def tearDown(self):
+        for guest in self.guests:
+            guest.disconnect()
+        for vif in self.vifs:
+            vif.remove_vpp_config()
+        super(TestVhostAdaptive, self).tearDown()
+
+    def show(self, vif):
+        return self.vapi.cli("show vhost-user %s" % vif.name)
+
+    def set_rx_mode(self, vif, mode):
+        self.vapi.cli("set interface rx-mode %s %s" % (vif.name, mode))
+
+    def test_vhost_adaptive_transitions(self):
+        """ Vhost User adaptive rx mode transitions """
+        # the third interface stays in polling mode and keeps the input
+        # node polling, which adaptive vrings need to switch to polling
+        vif, other, poller = self.vifs
+        guest = self.guests[0]
+        frame = b"\xff" * 6 + b"\x02" * 6 + b"\x88\xb5" + b"\0" * 46
+
+        self.set_rx_mode(vif, "adaptive")
+        self.set_rx_mode(other, "adaptive")
+        self.assertIn("adaptive (interrupt)", self.show(vif))
+        self.assertEqual(guest.used_flags(1), 0)
+
+        # a kick bringing in a burst makes the vring poll, kicks off
+        guest.send([frame] * 64)
+        self.sleep(0.1)
+        self.assertIn("adaptive (polling)", self.show(vif))
+        self.assertEqual(guest.used_flags(1), VRING_USED_F_NO_NOTIFY)
+
+        # changing another interface leaves the polling vring alone
+        self.set_rx_mode(other, "interrupt")
+        self.set_rx_mode(other, "adaptive")
+        self.assertIn("adaptive (polling)", self.show(vif))
+        self.assertEqual(guest.used_flags(1), VRING_USED_F_NO_NOTIFY)
+
+        # unless the input node stops polling, then it goes back to kicks
+        self.set_rx_mode(poller, "interrupt")
+        self.sleep(0.1)
+        self.assertIn("adaptive (interrupt)", self.show(vif))
+        self.assertEqual(guest.used_flags(1), 0)
+        self.set_rx_mode(poller, "polling")
+
+        # switching away from adaptive and back restarts with kicks
+        self.set_rx_mode(vif, "interrupt")
+        self.assertIn("interrupt", self.show(vif))
+        self.assertEqual(guest.used_flags(1), 0)
+        self.set_rx_mode(vif, "polling")
+        self.assertEqual(guest.used_flags(1), VRING_USED_F_NO_NOTIFY)
+        self.set_rx_mode(vif, "adaptive")
+        self.assertIn("adaptive (interrupt)", self.show(vif))
+        self.assertEqual(guest.used_flags(1), 0)
+
+        # the packets all made it in
+        guest.send([frame] * 8)
+        self.sleep(0.1)
+        counters = self.vapi.cli("show interface %s" % vif.name)
+        self.assertRegexpMatches(counters, r"rx packets\s+72")
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
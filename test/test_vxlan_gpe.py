@@ -160,8 +160,8 @@ class TestVxlanGpe(BridgeDomain, VppTestCase):
             cls.dport = 4790
             cls.flags = 0x0c
 
-            # Create 2 pg interfaces.
-            cls.create_pg_interfaces(range(4))
+            # Create 5 pg interfaces.
+            cls.create_pg_interfaces(range(5))
             for pg in cls.pg_interfaces:
                 pg.admin_up()
 
@@ -231,6 +231,50 @@ class TestVxlanGpe(BridgeDomain, VppTestCase):
         """ inherited from BridgeDomain """
         pass
 
+    def test_shared_remote_vni(self):
+        """ Decap to two local addresses from one remote and vni """
+        vni = 14
+        local2 = '10.99.0.1'
+        local2n = socket.inet_pton(socket.AF_INET, local2)
+        self.vapi.sw_interface_add_del_address(self.pg0.sw_if_index,
+                                               local2n, 32)
+        # the first tunnel owns the remote + vni demux entry, the second
+        # one is found by its full key
+        self.vapi.vxlan_gpe_add_del_tunnel(src_addr=self.pg0.local_ip4n,
+                                           dst_addr=self.pg0.remote_ip4n,
+                                           vni=vni)
+        r = self.vapi.vxlan_gpe_add_del_tunnel(src_addr=local2n,
+                                               dst_addr=self.pg0.remote_ip4n,
+                                               vni=vni)
+        self.vapi.sw_interface_set_l2_bridge(r.sw_if_index, bd_id=vni)
+        self.vapi.sw_interface_set_l2_bridge(self.pg4.sw_if_index,
+                                             bd_id=vni)
+
+        inner = (Ether(src='00:00:00:00:00:02', dst='00:00:00:00:00:01') /
+                 IP(src='4.3.2.1', dst='1.2.3.4') /
+                 UDP(sport=20000, dport=10000) /
+                 Raw('\xa5' * 100))
+        pkt = (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+               IP(src=self.pg0.remote_ip4, dst=local2) /
+               UDP(sport=self.dport, dport=self.dport, chksum=0) /
+               VXLAN(vni=vni, flags=self.flags) /
+               inner)
+        self.send_and_expect(self.pg0, [pkt], self.pg4)
+
+        # deleting the first tunnel hands the demux entry to the second
+        self.vapi.vxlan_gpe_add_del_tunnel(src_addr=self.pg0.local_ip4n,
+                                           dst_addr=self.pg0.remote_ip4n,
+                                           vni=vni, is_add=0)
+        self.send_and_expect(self.pg0, [pkt], self.pg4)
+
+        self.vapi.sw_interface_set_l2_bridge(self.pg4.sw_if_index,
+                                             bd_id=vni, enable=0)
+        self.vapi.vxlan_gpe_add_del_tunnel(src_addr=local2n,
+                                           dst_addr=self.pg0.remote_ip4n,
+                                           vni=vni, is_add=0)
+        self.vapi.sw_interface_add_del_address(self.pg0.sw_if_index,
+                                               local2n, 32, is_add=0)
+
     # Method to define VPP actions before tear down of the test case.
     #  Overrides tearDown method in VppTestCase class.
     #  @param self The object pointer.
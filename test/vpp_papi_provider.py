@@ -622,6 +622,13 @@ class VppPapiProvider(object):
         """
         return self.api(self.papi.l2fib_flush_all, {})
 
+    def l2_fib_table_dump(self, bd_id):
+        """Dump the L2 FIB entries of a bridge domain.
+
+        :param int bd_id: Bridge Domain id, ~0 for all of them.
+        """
+        return self.api(self.papi.l2_fib_table_dump, {'bd_id': bd_id})
+
     def sw_interface_set_l2_bridge(self, sw_if_index, bd_id,
                                    shg=0, bvi=0, enable=1):
         """Add/remove interface to/from bridge domain.
@@ -3172,7 +3179,8 @@ class VppPapiProvider(object):
                                 tunnel_dst_address='',
                                 is_tunnel=1,
                                 is_add=1,
-                                udp_encap=0):
+                                udp_encap=0,
+                                use_anti_replay=0):
         """ IPSEC SA add/del
         :param sad_id: security association ID
         :param spi: security param index of the SA in decimal
@@ -3185,6 +3193,7 @@ class VppPapiProvider(object):
         :param tunnel_dst_address: tunnel mode outer dst address
         :param is_add:
         :param is_tunnel:
+        :param use_anti_replay: check inbound sequence numbers
         :** reference /vpp/src/vnet/ipsec/ipsec.h file for enum values of
              crypto and ipsec algorithms
         """
@@ -3204,7 +3213,8 @@ class VppPapiProvider(object):
              'crypto_key': crypto_key,
              'is_add': is_add,
              'is_tunnel': is_tunnel,
-             'udp_encap': udp_encap})
+             'udp_encap': udp_encap,
+             'use_anti_replay': use_anti_replay})
 
     def ipsec_spd_add_del_entry(self,
                                 spd_id,
@@ -3593,7 +3603,8 @@ class VppPapiProvider(object):
             custom_dev_instance,
             use_custom_mac,
             mac_address,
-            tag=''):
+            tag='',
+            enable_gso=0):
         """
         :param is_server: is server
         :param sock_filename: socket name
@@ -3602,6 +3613,7 @@ class VppPapiProvider(object):
         :param use_custom_mac: use custom mac
         :param mac_address: mac address
         :param tag: tag (default ''
+        :param enable_gso: advertise TCP segmentation offload (default 0)
         """
         return self.api(
             self.papi.create_vhost_user_if,
@@ -3611,7 +3623,8 @@ class VppPapiProvider(object):
              'custom_dev_instance': custom_dev_instance,
              'use_custom_mac': use_custom_mac,
              'mac_address': mac_address,
-             'tag': tag
+             'tag': tag,
+             'enable_gso': enable_gso
              })
 
     def delete_vhost_user_if(
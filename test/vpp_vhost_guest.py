@@ -0,0 +1,157 @@
+""" Minimal vhost-user guest driver for exercising the vhost-user device """
+
+import ctypes
+import mmap
+import os
+import socket
+import struct
+
+VHOST_USER_SET_FEATURES = 2
+VHOST_USER_SET_OWNER = 3
+VHOST_USER_SET_MEM_TABLE = 5
+VHOST_USER_SET_VRING_NUM = 8
+VHOST_USER_SET_VRING_ADDR = 9
+VHOST_USER_SET_VRING_BASE = 10
+VHOST_USER_SET_VRING_KICK = 12
+VHOST_USER_SET_VRING_CALL = 13
+
+VRING_USED_F_NO_NOTIFY = 1
+
+# guest memory layout, vring n at n * VRING_SPAN, buffers after the vrings
+VRING_SIZE = 256
+VRING_SPAN = 0x4000
+VRING_AVAIL_OFFSET = 0x1000
+VRING_USED_OFFSET = 0x2000
+BUFFER_OFFSET = 0x10000
+BUFFER_SIZE = 2048
+MEMORY_SIZE = BUFFER_OFFSET + VRING_SIZE * BUFFER_SIZE
+USERSPACE_ADDR = 0x100000000
+VIRTIO_NET_HDR_SZ = 10
+
+libc = ctypes.CDLL(None, use_errno=True)
+
+
+class iovec(ctypes.Structure):
+    _fields_ = [("iov_base", ctypes.c_void_p),
+                ("iov_len", ctypes.c_size_t)]
+
+
+class msghdr(ctypes.Structure):
+    _fields_ = [("msg_name", ctypes.c_void_p),
+                ("msg_namelen", ctypes.c_uint32),
+                ("msg_iov", ctypes.POINTER(iovec)),
+                ("msg_iovlen", ctypes.c_size_t),
+                ("msg_control", ctypes.c_void_p),
+                ("msg_controllen", ctypes.c_size_t),
+                ("msg_flags", ctypes.c_int)]
+
+
+class VhostUserGuest(object):
+    """ Guest side of a vhost-user interface created in server mode
+
+    Sets up one queue pair in a shared memory file and sends packets to
+    VPP on the guest tx vring (vring 1).
+    """
+
+    def __init__(self, sock_filename):
+        self.sock_filename = sock_filename
+        self.mem_filename = "/dev/shm/%s" % \
+            os.path.basename(sock_filename).replace(".", "-")
+        self.sock = None
+        self.mem = None
+        self.kickfds = []
+        self.callfds = []
+        self.tx_avail_idx = 0
+
+    def _send(self, request, payload=b"", fd=None):
+        data = struct.pack("<III", request, 1, len(payload)) + payload
+        buf = ctypes.create_string_buffer(data, len(data))
+        iov = iovec(ctypes.cast(buf, ctypes.c_void_p), len(data))
+        mh = msghdr(None, 0, ctypes.pointer(iov), 1, None, 0, 0)
+        if fd is not None:
+            # struct cmsghdr: u64 len, int level, int type, then the fd
+            cmsg = struct.pack("<Qiii", 20, socket.SOL_SOCKET, 1, fd)
+            cbuf = ctypes.create_string_buffer(cmsg, 24)
+            mh.msg_control = ctypes.cast(cbuf, ctypes.c_void_p)
+            mh.msg_controllen = 24
+        if libc.sendmsg(self.sock.fileno(), ctypes.byref(mh), 0) != len(data):
+            raise OSError(ctypes.get_errno(), "vhost-user sendmsg failed")
+
+    def _eventfd(self):
+        fd = libc.eventfd(0, 0)
+        if fd < 0:
+            raise OSError(ctypes.get_errno(), "eventfd failed")
+        return fd
+
+    def connect(self):
+        """ Connect to VPP and start the rx and tx vrings """
+        memfd = os.open(self.mem_filename, os.O_RDWR | os.O_CREAT, 0o600)
+        os.ftruncate(memfd, MEMORY_SIZE)
+        self.mem = mmap.mmap(memfd, MEMORY_SIZE)
+
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(self.sock_filename)
+        self._send(VHOST_USER_SET_OWNER)
+        self._send(VHOST_USER_SET_FEATURES, struct.pack("<Q", 0))
+        self._send(VHOST_USER_SET_MEM_TABLE,
+                   struct.pack("<IIQQQQ", 1, 0, 0, MEMORY_SIZE,
+                               USERSPACE_ADDR, 0), memfd)
+        os.close(memfd)
+
+        for q in range(2):
+            base = USERSPACE_ADDR + q * VRING_SPAN
+            self._send(VHOST_USER_SET_VRING_NUM,
+                       struct.pack("<II", q, VRING_SIZE))
+            self._send(VHOST_USER_SET_VRING_ADDR,
+                       struct.pack("<IIQQQQ", q, 0, base,
+                                   base + VRING_USED_OFFSET,
+                                   base + VRING_AVAIL_OFFSET, 0))
+            self._send(VHOST_USER_SET_VRING_BASE, struct.pack("<II", q, 0))
+            self.callfds.append(self._eventfd())
+            self._send(VHOST_USER_SET_VRING_CALL, struct.pack("<Q", q),
+                       self.callfds[q])
+            self.kickfds.append(self._eventfd())
+            self._send(VHOST_USER_SET_VRING_KICK, struct.pack("<Q", q),
+                       self.kickfds[q])
+
+        # the first kick starts a vring
+        for q in range(2):
+            self.kick(q)
+
+    def disconnect(self):
+        if self.sock:
+            self.sock.close()
+            self.sock = None
+        for fd in self.kickfds + self.callfds:
+            os.close(fd)
+        self.kickfds = []
+        self.callfds = []
+        if self.mem:
+            self.mem.close()
+            self.mem = None
+            os.unlink(self.mem_filename)
+
+    def kick(self, q):
+        os.write(self.kickfds[q], struct.pack("<Q", 1))
+
+    def used_flags(self, q):
+        """ Flags of a used ring, VRING_USED_F_NO_NOTIFY while polled """
+        offset = q * VRING_SPAN + VRING_USED_OFFSET
+        return struct.unpack_from("<H", self.mem, offset)[0]
+
+    def send(self, frames):
+        """ Put ethernet frames on the tx vring and kick if VPP wants it """
+        desc = VRING_SPAN
+        avail = VRING_SPAN + VRING_AVAIL_OFFSET
+        for frame in frames:
+            slot = self.tx_avail_idx % VRING_SIZE
+            addr = BUFFER_OFFSET + slot * BUFFER_SIZE
+            data = b"\0" * VIRTIO_NET_HDR_SZ + frame
+            self.mem[addr:addr + len(data)] = data
+            struct.pack_into("<QIHH", self.mem, desc + slot * 16, addr,
+                             len(data), 0, 0)
+            struct.pack_into("<H", self.mem, avail + 4 + slot * 2, slot)
+            self.tx_avail_idx = (self.tx_avail_idx + 1) & 0xffff
+        struct.pack_into("<H", self.mem, avail + 2, self.tx_avail_idx)
+        if not self.used_flags(1) & VRING_USED_F_NO_NOTIFY:
+            self.kick(1)
@@ -6,7 +6,7 @@ class VppVhostInterface(VppInterface):
 
     def __init__(self, test, sock_filename, is_server=0, renumber=0,
                  custom_dev_instance=0, use_custom_mac=0, mac_address='',
-                 tag=''):
+                 tag='', enable_gso=0):
 
         """ Create VPP Vhost interface """
         super(VppVhostInterface, self).__init__(test)
@@ -17,6 +17,7 @@ class VppVhostInterface(VppInterface):
         self.use_custom_mac = use_custom_mac
         self.mac_address = mac_address
         self.tag = tag
+        self.enable_gso = enable_gso
 
     def add_vpp_config(self):
         r = self.test.vapi.create_vhost_user_if(self.is_server,
@@ -25,7 +26,8 @@ class VppVhostInterface(VppInterface):
                                                 self.custom_dev_instance,
                                                 self.use_custom_mac,
                                                 self.mac_address,
-                                                self.tag)
+                                                self.tag,
+                                                self.enable_gso)
         self.set_sw_if_index(r.sw_if_index)
 
     def remove_vpp_config(self):